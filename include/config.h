@@ -5,8 +5,16 @@
 #define LED48_GPIO          48  // WS2812 RGB LED
 #define BOOT_BUTTON_GPIO    0   // Boot button (GPIO0)
 
-// NVS Storage Keys - Display Settings
+// NVS namespace and the blob holding all settings (see config_store.h)
 #define NVS_NAMESPACE       "storage"
+#define NVS_CONFIG_BLOB     "config"
+#define NVS_TILES_BLOB      "tiles"    // Tile ETags of the composed frame (see tiles.h)
+#define NVS_WIDGET_TEMPLATE "widget_tmpl"  // Widget template JSON (see widgets.h)
+
+// Individual keys used by older firmware, only read to migrate them into
+// the config blob (then erased)
+
+// NVS Storage Keys - Display Settings
 #define NVS_IMAGE_URL       "image_url"
 #define NVS_IMG_WIDTH       "img_width"
 #define NVS_IMG_HEIGHT      "img_height"
@@ -18,6 +26,7 @@
 #define NVS_REFRESH_MIN     "refresh_min"
 #define NVS_LED_DISABLED    "led_disabled"
 #define NVS_SSL_SKIP        "ssl_skip"
+#define NVS_PANEL_LAYOUT    "panel_layout"
 
 // NVS Storage Keys - WiFi Settings
 #define NVS_WIFI_SSID       "wifi_ssid"
@@ -37,6 +46,7 @@
 // NVS Storage Keys - Time Configuration
 #define NVS_NTP_SERVER      "ntp_server"
 #define NVS_TIMEZONE        "timezone"
+#define NVS_NTP_MAX_ERR     "ntp_max_err"
 // NVS Storage Keys - Schedule Plans
 #define NVS_SCHEDULE_JSON   "sched_json"
 #define NVS_SCHEDULE_ENABLE "sched_en"
@@ -53,12 +63,17 @@
 #define WIFI_CONNECTED_BIT  BIT0
 #define WIFI_FAIL_BIT       BIT1
 
+// Wake cycle pipeline (display preparation runs alongside the WiFi connect)
+#define CYCLE_BUFFERS_READY_BIT BIT0  // Image processor buffers allocated
+#define CYCLE_PANEL_READY_BIT   BIT1  // Panel reset and powered on
+
 // AP Mode Configuration
 #define AP_SSID             "ESP32-Display-Setup"
 #define AP_PASSWORD         ""  // Open network (empty = no password)
 #define AP_CHANNEL          1
 #define AP_MAX_CONNECTIONS  4
 #define WIFI_STA_TIMEOUT_MS 60000   // 1 minute timeout for STA connection
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 5000  // Cached BSSID/channel attempt before a full scan
 #define AP_MODE_TIMEOUT_MS  300000  // 5 minutes in AP mode before retry
 
 // Web Server Configuration
@@ -67,6 +82,8 @@
 
 // Deep Sleep Configuration
 #define DEEP_SLEEP_WAKEUP_TIME  0  // 0 = wake only on button press
+#define RTC_SLOW_MEM_SIZE       8192  // RTC_DATA_ATTR state kept across deep sleep
+#define RTC_MODULE_STATE_MAX    128   // Private RTC state of one module (WiFi cache, playlist)
 
 // LED Blink Timing (milliseconds)
 #define LED_BLINK_INTERVAL  500
@@ -83,6 +100,14 @@
 #define MAX_TIMEZONE_LEN    48
 #define MAX_SCHEDULE_JSON   2048  // Max size for schedule plans JSON
 #define MAX_SYSLOG_HOST_LEN 64
+#define MAX_PANEL_LAYOUT_LEN 96   // "CxR" plus one "cs,dc,rst,busy" group per panel
+#define MAX_TILE_LAYOUT_LEN 512   // One "x,y,w,h,url" line per tile
+#define MAX_WIDGET_TEMPLATE_LEN 2048  // Widget template JSON
+#define CONFIG_PUT_MAX_BODY 16384    // PUT /api/config request body
+#define DISPLAY_PUSH_MAX_BODY (4 * 1024 * 1024)  // POST /api/display request body
+#define DISPLAY_PUSH_CHUNK 4096      // Receive buffer for POST /api/display
+#define OTA_RECV_CHUNK 4096          // Receive buffer for POST /ota
+#define OTA_FORM_OVERHEAD 1024       // Multipart framing allowed on top of the partition size
 
 // Schedule Plan limits
 #define MAX_SCHEDULE_PLANS  4     // Maximum number of schedule plans
@@ -92,7 +117,19 @@
 #define DEFAULT_HOSTNAME    "esp32-display"
 #define DEFAULT_NTP_SERVER  "pool.ntp.org"
 #define DEFAULT_TIMEZONE    "Europe/Berlin"
+#define DEFAULT_NTP_MAX_ERR_S 2   // Clock error (s) tolerated before a wake syncs NTP
+#define DEFAULT_CACHE_MIN_MIN 5    // Shortest sleep (minutes) a server cache hint can ask for
+#define DEFAULT_CACHE_MAX_MIN 1440 // Longest sleep (minutes) a server cache hint can ask for
+#define DEFAULT_PLAYLIST_CHECK_MIN 1440 // Minutes between playlist manifest checks
 #define DEFAULT_SYSLOG_PORT 514
 
+// Failed downloads in a row before the cached frame is redrawn with a stale-data banner
+#define FRAMECACHE_STALE_FAILURES 3
+
+// Rough supply figures for the energy-per-frame estimate in /api/status
+#define ENERGY_SUPPLY_MV    3300
+#define ENERGY_AWAKE_MA     45    // CPU awake, radio off (incl. panel refresh)
+#define ENERGY_RADIO_MA     110   // Average while WiFi is up
+
 #endif // CONFIG_H
 
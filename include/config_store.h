@@ -0,0 +1,108 @@
+/**
+ * @file config_store.h
+ * @brief Settings stored as one versioned, CRC-checked NVS blob
+ *
+ * The caller owns the settings struct; this module only stores its bytes.
+ * The blob header carries a layout version, the struct size and a CRC32.
+ * Layouts grow by appending fields: a shorter blob written by an older
+ * build is loaded as a prefix, leaving the new fields at their defaults.
+ *
+ * The last loaded or saved blob is mirrored in RTC memory, so timer wakes
+ * restore the settings without touching flash, and saves that would not
+ * change the blob are skipped. The caller declares the mirror for its
+ * settings struct, so it takes no more RTC memory than the struct.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/** Blob header, stored in front of the settings bytes */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;           /**< Layout version */
+    uint16_t size;              /**< Size of the settings that follow */
+    uint32_t crc;               /**< CRC32 of the settings that follow */
+} config_store_header_t;
+
+/**
+ * @brief Type of the RTC mirror for a settings struct
+ *
+ * Declare it with RTC_DATA_ATTR. The settings bytes must follow the header
+ * without padding (a packed struct), as the blob is stored in one piece.
+ */
+#define CONFIG_STORE_MIRROR(type) struct { config_store_header_t header; type data; }
+
+/** Where the settings of this boot came from */
+typedef enum {
+    CONFIG_SOURCE_DEFAULTS = 0,     /**< Nothing stored */
+    CONFIG_SOURCE_RTC,              /**< RTC mirror (timer wake) */
+    CONFIG_SOURCE_BLOB,             /**< NVS blob */
+    CONFIG_SOURCE_LEGACY,           /**< Individual NVS keys (migrated) */
+} config_source_t;
+
+/** Load/save timing of this boot */
+typedef struct {
+    config_source_t source;
+    uint32_t load_us;           /**< Time to restore the settings */
+    uint32_t save_us;           /**< Time of the last save that wrote flash */
+    uint32_t saves;             /**< Saves written to flash */
+    uint32_t saves_skipped;     /**< Saves skipped because nothing changed */
+} config_store_stats_t;
+
+/**
+ * @brief Load the settings
+ *
+ * A blob larger than the struct (written by a newer build) is ignored.
+ * @param mirror Header of the RTC mirror (see CONFIG_STORE_MIRROR)
+ * @param data Settings struct, pre-filled with defaults
+ * @param size Size of the struct (at most UINT16_MAX)
+ * @param version Layout version; blobs with another version are ignored
+ * @param use_rtc Try the RTC mirror first (only valid on deep sleep wakes)
+ * @return ESP_OK if loaded, ESP_ERR_NOT_FOUND if there is no valid blob
+ */
+esp_err_t config_store_load(config_store_header_t *mirror, void *data, size_t size,
+                            uint16_t version, bool use_rtc);
+
+/**
+ * @brief Save the settings if they differ from the stored blob
+ * @param mirror Header of the RTC mirror (see CONFIG_STORE_MIRROR)
+ * @param data Settings struct
+ * @param size Size of the struct
+ * @param version Layout version
+ * @return ESP_OK if saved or unchanged
+ */
+esp_err_t config_store_save(config_store_header_t *mirror, const void *data, size_t size,
+                            uint16_t version);
+
+/**
+ * @brief Remove settings stored under individual keys after migrating them
+ * @param keys Key names in the NVS namespace
+ * @param count Number of keys
+ */
+void config_store_erase_keys(const char *const *keys, size_t count);
+
+/**
+ * @brief Record that the settings were read from legacy keys
+ * @param load_us Time the legacy read took
+ */
+void config_store_note_legacy(uint32_t load_us);
+
+/**
+ * @brief Get load/save statistics
+ * @param out Receives the statistics
+ */
+void config_store_get_stats(config_store_stats_t *out);
+
+/**
+ * @brief Name of a settings source (for logs and the status API)
+ * @param source Source
+ * @return Static string
+ */
+const char *config_store_source_name(config_source_t source);
+
+#endif // CONFIG_STORE_H
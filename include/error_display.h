@@ -30,7 +30,7 @@ typedef enum {
  * - Technical details (from image_processor_get_error)
  * - Suggestion for resolution
  * 
- * @param buffer Output buffer (must be IMAGE_BUFFER_SIZE bytes, 192000)
+ * @param buffer Output buffer (must be IMAGE_BUFFER_SIZE bytes)
  * @param error_type Category of error
  * @param error_detail Technical error message (can be NULL)
  */
@@ -58,5 +58,21 @@ esp_err_t error_display_show(error_type_t error_type, const char *error_detail);
  */
 error_type_t error_display_categorize(const char *error_msg);
 
+// Height of the stale-data banner along the bottom edge
+#define ERROR_OVERLAY_HEIGHT 24
+
+/**
+ * @brief Draw one row of the stale-data banner over a frame row
+ *
+ * The banner is a small box with black text in the bottom-left corner.
+ * It is drawn row by row, so a frame can be streamed from flash through a
+ * single row buffer. Rows above the banner are left unchanged.
+ *
+ * @param row Packed frame row (IMAGE_ROW_BYTES bytes)
+ * @param y Row index
+ * @param text Banner text (one line)
+ */
+void error_display_overlay_row(uint8_t *row, uint32_t y, const char *text);
+
 #endif // ERROR_DISPLAY_H
 
@@ -0,0 +1,95 @@
+/**
+ * @file framecache.h
+ * @brief Last displayed frame kept in a flash partition
+ *
+ * The "framecache" partition is split into equal slots, each holding one
+ * packed frame and a metadata sector. Writes go round-robin to the slot
+ * after the current one (wear levelling) and the metadata is written last
+ * with a sequence number and CRC, so an interrupted write leaves the
+ * previous frame in place. Frames are read in place through a flash
+ * mapping, without a RAM copy.
+ */
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "config.h"
+
+#define FRAMECACHE_ETAG_LEN 64
+
+/** Metadata of a cached frame */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                       /**< Increases with every write; highest valid slot is current */
+    uint32_t frame_size;
+    uint32_t frame_crc;                 /**< CRC32 of the packed frame */
+    int64_t timestamp;                  /**< When the frame was last stored (0 = clock not set) */
+    char etag[FRAMECACHE_ETAG_LEN];     /**< ETag of the download */
+    char url[MAX_URL_LEN];              /**< Source URL */
+    uint32_t meta_crc;                  /**< CRC32 of the fields above */
+} framecache_meta_t;
+
+/** Cache statistics (kept across deep sleep) */
+typedef struct {
+    uint32_t read_us;       /**< Last map + verify of a frame */
+    uint32_t write_us;      /**< Last erase + write of a slot */
+    uint32_t writes;        /**< Frames written */
+    uint32_t skipped;       /**< Stores skipped because the frame was unchanged */
+    uint8_t slots;          /**< Slots in the partition */
+} framecache_stats_t;
+
+/**
+ * @brief Find the partition and the current frame
+ * @param frame_size Size of one packed frame
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without a partition, ESP_ERR_INVALID_SIZE
+ *         if it cannot hold two frames
+ */
+esp_err_t framecache_init(size_t frame_size);
+
+/**
+ * @brief Metadata of the current frame
+ * @return Metadata, NULL if no frame is cached
+ */
+const framecache_meta_t *framecache_current(void);
+
+/**
+ * @brief Store a frame as the new current frame
+ *
+ * If the frame and URL equal the current ones the frame is not rewritten;
+ * only the timestamp of the current frame is updated.
+ * @param frame Packed frame (frame_size bytes)
+ * @param url Source URL
+ * @param etag ETag of the download, may be NULL
+ * @param timestamp Current time (seconds since the epoch, 0 if unknown)
+ * @return ESP_OK on success
+ */
+esp_err_t framecache_store(const uint8_t *frame, const char *url, const char *etag, int64_t timestamp);
+
+/**
+ * @brief Map the current frame for reading
+ *
+ * The frame CRC is checked before returning. Release with framecache_unmap().
+ * @param frame Receives a pointer to the packed frame in flash
+ * @param handle Receives the mapping handle
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no frame is cached, ESP_ERR_INVALID_CRC
+ */
+esp_err_t framecache_map(const uint8_t **frame, esp_partition_mmap_handle_t *handle);
+
+/**
+ * @brief Release a mapping from framecache_map()
+ * @param handle Mapping handle
+ */
+void framecache_unmap(esp_partition_mmap_handle_t handle);
+
+/**
+ * @brief Get cache statistics
+ * @param out Receives the statistics
+ */
+void framecache_get_stats(framecache_stats_t *out);
+
+#endif // FRAMECACHE_H
@@ -0,0 +1,88 @@
+/**
+ * @file gfx.h
+ * @brief Drawing primitives for packed 4bpp e-Paper frames
+ *
+ * Frames are IMAGE_BUFFER_SIZE bytes in panel layout: two pixels per byte,
+ * the even pixel in the high nibble. Colors are panel color codes
+ * (EPD_PANEL_BLACK etc.). Everything is clipped to the panel, so shapes may
+ * extend past its edges. No ESP-IDF dependencies, so this also builds on a
+ * host.
+ */
+
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "epd_panel.h"
+
+// Font cell (8x16 pixels per character at scale 1)
+#define GFX_FONT_WIDTH  8
+#define GFX_FONT_HEIGHT 16
+
+// Icon cell (16x16 pixels at scale 1)
+#define GFX_ICON_SIZE   16
+
+// Extra space between wrapped text lines
+#define GFX_LINE_GAP    4
+
+/**
+ * @brief Set a single pixel
+ */
+void gfx_set_pixel(uint8_t *fb, int x, int y, uint8_t color);
+
+/**
+ * @brief Fill a rectangle
+ */
+void gfx_fill_rect(uint8_t *fb, int x, int y, int w, int h, uint8_t color);
+
+/**
+ * @brief Draw a rectangle outline
+ * @param thickness Border width in pixels, drawn inside the rectangle
+ */
+void gfx_draw_rect(uint8_t *fb, int x, int y, int w, int h, uint8_t color, int thickness);
+
+/**
+ * @brief Draw a straight line
+ * @param thickness Line width in pixels (square pen)
+ */
+void gfx_draw_line(uint8_t *fb, int x0, int y0, int x1, int y1, uint8_t color, int thickness);
+
+/**
+ * @brief Font bitmap of one character row
+ * @param c Character (unsupported characters are drawn as '?')
+ * @param row Row 0 .. GFX_FONT_HEIGHT-1
+ * @return 8 pixels, bit 7 = leftmost
+ */
+uint8_t gfx_font_row(char c, int row);
+
+/**
+ * @brief Draw a single character
+ * @param scale Integer magnification (1 = 8x16)
+ */
+void gfx_draw_char(uint8_t *fb, int x, int y, char c, uint8_t color, int scale);
+
+/**
+ * @brief Draw text, wrapping at '\n' and before characters that pass max_x
+ * @param max_x Right edge for wrapping (exclusive)
+ * @return y of the line below the last one drawn
+ */
+int gfx_draw_text(uint8_t *fb, int x, int y, const char *str, uint8_t color, int scale, int max_x);
+
+/**
+ * @brief Width of one line of text
+ * @return Pixels up to the first '\n' or the end of the string
+ */
+int gfx_text_width(const char *str, int scale);
+
+/**
+ * @brief Draw a built-in 16x16 icon
+ *
+ * Icons: sun, cloud, rain, snow, storm, fog, bus, calendar, home, warning.
+ * @param name Icon name
+ * @param scale Integer magnification
+ * @return false if there is no icon with that name (nothing is drawn)
+ */
+bool gfx_draw_icon(uint8_t *fb, int x, int y, const char *name, uint8_t color, int scale);
+
+#endif // GFX_H
@@ -0,0 +1,92 @@
+/**
+ * @file http_cache.h
+ * @brief Next-wake hints from HTTP cache headers
+ *
+ * The image server can say when new content will exist: Cache-Control
+ * max-age (minus Age) or Expires on a successful response, Retry-After on
+ * 429/503. Headers are collected while the response arrives and turned into
+ * a delay once the status is known; the policy bounds that delay and fits
+ * it into the refresh schedule.
+ *
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flags of http_cache_hints_t
+#define HTTP_CACHE_HAS_MAX_AGE      0x01
+#define HTTP_CACHE_HAS_AGE          0x02
+#define HTTP_CACHE_HAS_DATE         0x04
+#define HTTP_CACHE_HAS_EXPIRES      0x08
+#define HTTP_CACHE_HAS_RETRY_DELTA  0x10
+#define HTTP_CACHE_HAS_RETRY_DATE   0x20
+#define HTTP_CACHE_NO_CACHE         0x40   // no-cache / no-store: content may change any time
+
+#define HTTP_CACHE_ETAG_LEN 64  // Longer ETags are not kept
+
+/** Cache headers of one response */
+typedef struct {
+    uint32_t flags;         /**< HTTP_CACHE_* bits */
+    uint32_t max_age_s;     /**< Cache-Control max-age */
+    uint32_t age_s;         /**< Age */
+    uint32_t retry_s;       /**< Retry-After in seconds */
+    int64_t date;           /**< Date (seconds since the epoch) */
+    int64_t expires;        /**< Expires (seconds since the epoch, 0 if invalid) */
+    int64_t retry_at;       /**< Retry-After as an HTTP-date */
+    char etag[HTTP_CACHE_ETAG_LEN];  /**< ETag, empty if none (or too long) */
+} http_cache_hints_t;
+
+/**
+ * @brief Clear collected headers before a request
+ * @param h Hints
+ */
+void http_cache_hints_reset(http_cache_hints_t *h);
+
+/**
+ * @brief Collect one response header (others are ignored)
+ * @param h Hints
+ * @param name Header name (case-insensitive)
+ * @param value Header value
+ */
+void http_cache_parse_header(http_cache_hints_t *h, const char *name, const char *value);
+
+/**
+ * @brief Parse an HTTP-date (IMF-fixdate, RFC 850 or asctime format)
+ * @param s Date string
+ * @param out Receives seconds since the epoch
+ * @return true on success
+ */
+bool http_cache_parse_date(const char *s, int64_t *out);
+
+/**
+ * @brief Time until the server expects new content
+ *
+ * Retry-After counts for 429 and 503, max-age (before Expires) for 200
+ * and 304.
+ * Absolute dates are taken relative to the response's Date header, or to
+ * now if there is none.
+ * @param h Collected headers
+ * @param status HTTP status code
+ * @param now Current time (seconds since the epoch), 0 if the clock is not set
+ * @param out_s Receives the delay in seconds
+ * @return true if the response carried a usable hint
+ */
+bool http_cache_next_change_s(const http_cache_hints_t *h, int status, int64_t now,
+                              uint32_t *out_s);
+
+/**
+ * @brief Sleep duration for a hint
+ * @param hint_s Delay from http_cache_next_change_s()
+ * @param min_s Shortest sleep
+ * @param max_s Longest sleep
+ * @param limit_s Sleep must not end later than this (e.g. a schedule
+ *                boundary), UINT32_MAX for no limit
+ * @return Sleep duration in seconds
+ */
+uint32_t http_cache_policy_s(uint32_t hint_s, uint32_t min_s, uint32_t max_s, uint32_t limit_s);
+
+#endif // HTTP_CACHE_H
@@ -8,14 +8,26 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
+#include "epd_panel.h"
 
-// E-paper display dimensions
-#define IMAGE_WIDTH  800
-#define IMAGE_HEIGHT 480
+// E-paper display dimensions (from the panel selected at build time)
+#define IMAGE_WIDTH  EPD_PANEL_WIDTH
+#define IMAGE_HEIGHT EPD_PANEL_HEIGHT
 
 // Image buffer size (2 pixels per byte for 6-color palette)
-#define IMAGE_BUFFER_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT / 2)
+#define IMAGE_BUFFER_SIZE EPD_PANEL_BUFFER_SIZE
+#define IMAGE_ROW_BYTES   EPD_PANEL_ROW_BYTES
+
+/**
+ * @brief Receives packed output rows in top-to-bottom order
+ * @param row Output row index (0 .. IMAGE_HEIGHT-1)
+ * @param data Packed row (IMAGE_ROW_BYTES bytes, valid only during the call)
+ * @param len Row length in bytes
+ * @param ctx User context passed to image_download_and_stream()
+ */
+typedef void (*image_row_sink_t)(uint32_t row, const uint8_t *data, size_t len, void *ctx);
 
 /**
  * @brief Initialize the image processor
@@ -27,7 +39,7 @@ esp_err_t image_processor_init(void);
  * @brief Set scaling parameters for image processing
  * @param src_width Expected source image width (0 = auto-detect)
  * @param src_height Expected source image height (0 = auto-detect)
- * @param scale_to_fit If true, scale image to fit 800x480 display
+ * @param scale_to_fit If true, scale image to fit the display (IMAGE_WIDTH x IMAGE_HEIGHT)
  */
 void image_processor_set_scaling(uint16_t src_width, uint16_t src_height, bool scale_to_fit);
 
@@ -40,12 +52,36 @@ void image_processor_set_scaling(uint16_t src_width, uint16_t src_height, bool s
  */
 void image_processor_set_transform(uint16_t rotation, bool mirror_h, bool mirror_v, bool rotate_first);
 
+/**
+ * @brief Select the part of a larger image shown on this display
+ *
+ * Used when several panels show one image: the canvas is the combined area
+ * of all panels and (x, y) is this panel's top-left corner in it. Scaling
+ * (if enabled) maps the source image onto the whole canvas.
+ * @param canvas_width Canvas width (0 = IMAGE_WIDTH)
+ * @param canvas_height Canvas height (0 = IMAGE_HEIGHT)
+ * @param x Horizontal offset of this display in the canvas
+ * @param y Vertical offset of this display in the canvas
+ */
+void image_processor_set_region(uint16_t canvas_width, uint16_t canvas_height,
+                                uint16_t x, uint16_t y);
+
 /**
  * @brief Set SSL certificate verification mode
  * @param skip If true, skip SSL certificate verification (allow self-signed certs)
  */
 void image_processor_set_ssl_skip(bool skip);
 
+/**
+ * @brief Keep one HTTP connection open across fetches
+ *
+ * While on, consecutive fetches from the same server reuse the connection
+ * (HTTP keep-alive), saving a TCP and TLS handshake per request. Turning it
+ * off closes the connection.
+ * @param keep true to keep the connection
+ */
+void image_processor_set_keep_alive(bool keep);
+
 /**
  * @brief Download and process an image from URL
  * @param url The URL to download the image from
@@ -54,6 +90,135 @@ void image_processor_set_ssl_skip(bool skip);
  */
 esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer);
 
+/**
+ * @brief Download and process an image, passing output rows to a sink
+ *
+ * If the current transform keeps raster order (rotation 0/180 without a net
+ * vertical flip) each row goes to the sink as soon as it is dithered, so the
+ * transfer overlaps the computation. Other transforms are dithered into a
+ * full frame first and then passed to the sink. The sink is only called once
+ * download and decode have succeeded.
+ * @param url The URL to download the image from
+ * @param output_buffer Optional buffer for a full copy of the frame (IMAGE_BUFFER_SIZE bytes), may be NULL
+ * @param sink Row sink, may be NULL if output_buffer is given
+ * @param sink_ctx User context for the sink
+ * @return ESP_OK on success
+ */
+esp_err_t image_download_and_stream(const char *url, uint8_t *output_buffer,
+                                    image_row_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Download an image and keep it for one or more image_processor_render() calls
+ * @param url The URL to download the image from
+ * @return ESP_OK on success
+ */
+esp_err_t image_processor_fetch(const char *url);
+
+/**
+ * @brief Download only if the content no longer matches an ETag
+ *
+ * Sends If-None-Match; on 304 nothing is downloaded and *changed is false.
+ * Otherwise behaves like image_processor_fetch().
+ * @param url The URL to download
+ * @param etag ETag of the copy already held, empty or NULL for a plain fetch
+ * @param changed Receives false if the server replied 304
+ * @return ESP_OK on success (including 304)
+ */
+esp_err_t image_processor_fetch_if_changed(const char *url, const char *etag, bool *changed);
+
+/**
+ * @brief Raw body of the last download (e.g. a manifest rather than an image)
+ * @param len Receives the length
+ * @return Data, valid until the next fetch or image_processor_release()
+ */
+const uint8_t *image_processor_get_data(size_t *len);
+
+/**
+ * @brief Decode and dither the downloaded image for the current region
+ *
+ * Same output behaviour as image_download_and_stream(); may be called
+ * repeatedly with different regions/transforms for the same download.
+ * @param output_buffer Optional buffer for a full copy of the frame, may be NULL
+ * @param sink Row sink, may be NULL if output_buffer is given
+ * @param sink_ctx User context for the sink
+ * @return ESP_OK on success
+ */
+esp_err_t image_processor_render(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Decode and dither a PNG into a rectangle of a packed frame
+ *
+ * The image is scaled to the tile if scaling is enabled, otherwise cropped
+ * or padded with white. Error diffusion is clipped at the tile edges, so
+ * the rest of the frame is left untouched and a tile can be redrawn on its
+ * own. The rectangle is in image coordinates; the current transform applies.
+ * @param png PNG data
+ * @param len Length of the PNG data
+ * @param frame Packed frame (IMAGE_BUFFER_SIZE bytes)
+ * @param x Left edge of the tile
+ * @param y Top edge of the tile
+ * @param w Tile width
+ * @param h Tile height
+ * @return ESP_OK on success
+ */
+esp_err_t image_processor_render_tile(const uint8_t *png, size_t len, uint8_t *frame,
+                                      uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+/**
+ * @brief Start decoding a PNG that arrives in pieces (e.g. an upload)
+ *
+ * The data is passed to image_processor_png_feed() as it arrives and
+ * decoded on the fly, so the file is never held in memory; then
+ * image_processor_png_end() dithers it. Scaling, transform and region apply
+ * as for image_processor_render().
+ * @return ESP_OK on success
+ */
+esp_err_t image_processor_png_begin(void);
+
+/**
+ * @brief Decode the next piece of a PNG
+ * @param data PNG data
+ * @param len Length of the data (any size)
+ * @return ESP_OK on success; on error the decode is over
+ */
+esp_err_t image_processor_png_feed(const uint8_t *data, size_t len);
+
+/**
+ * @brief Finish a pushed PNG and dither it
+ * @param output_buffer Optional buffer for a full copy of the frame, may be NULL
+ * @param sink Row sink, may be NULL if output_buffer is given
+ * @param sink_ctx User context for the sink
+ * @return ESP_OK on success
+ */
+esp_err_t image_processor_png_end(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Free the downloaded image data
+ */
+void image_processor_release(void);
+
+/**
+ * @brief Check whether the current transform allows row streaming
+ * @return true if output rows are produced in raster order
+ */
+bool image_processor_can_stream(void);
+
+/**
+ * @brief Time until the server expects new content
+ *
+ * From the cache headers (Cache-Control max-age, Expires, Retry-After on
+ * 429/503) of this wake's downloads; the earliest one if there were several.
+ * @param seconds Receives the remaining time (0 if already due)
+ * @return true if any download carried a hint
+ */
+bool image_processor_get_next_change(uint32_t *seconds);
+
+/**
+ * @brief ETag of the last download
+ * @return ETag, empty string if the server sent none
+ */
+const char *image_processor_get_etag(void);
+
 /**
  * @brief Get the last error message
  * @return Pointer to error message string
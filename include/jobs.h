@@ -0,0 +1,117 @@
+/**
+ * @file jobs.h
+ * @brief Background queue for display actions started from the web UI
+ *
+ * Actions such as "show image" take a download, decode and a 20-30 s panel
+ * refresh. They run one at a time in a worker task instead of the HTTP
+ * server task, so the server keeps answering while the panel is busy. Each
+ * job gets an ID; its state, current stage and the time spent in each stage
+ * can be read back (as JSON) while it runs and for a while after.
+ *
+ * Submitting an action that is already waiting in the queue returns the
+ * waiting job instead of adding a second one.
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define JOBS_QUEUE_LEN   4     // Jobs waiting to run
+#define JOBS_HISTORY     8     // Jobs kept for status queries (> JOBS_QUEUE_LEN)
+#define JOBS_ACTION_LEN  16    // Longest action name + 1
+#define JOBS_ERROR_LEN   96    // Longest error message + 1
+
+/** Job state */
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+} job_state_t;
+
+/** Stage of a running job, set by the runner */
+typedef enum {
+    JOB_STAGE_WAITING,       /**< In the queue */
+    JOB_STAGE_DOWNLOADING,
+    JOB_STAGE_DECODING,
+    JOB_STAGE_DITHERING,
+    JOB_STAGE_TRANSFERRING,  /**< Sending the frame to the panel */
+    JOB_STAGE_REFRESHING,
+    JOB_STAGE_COUNT
+} job_stage_t;
+
+/**
+ * @brief Runs one job in the worker task
+ *
+ * Reports progress with jobs_stage().
+ * @param action Action name given to jobs_submit()
+ * @return NULL on success, otherwise an error message
+ */
+typedef const char *(*jobs_runner_t)(const char *action);
+
+/**
+ * @brief Create the queue and start the worker task
+ * @param runner Called for every job
+ * @return ESP_OK on success (also if already started)
+ */
+esp_err_t jobs_start(jobs_runner_t runner);
+
+/**
+ * @brief Queue an action
+ * @param action Action name (shorter than JOBS_ACTION_LEN)
+ * @return Job ID (> 0), or 0 if the queue is full or not started
+ */
+uint32_t jobs_submit(const char *action);
+
+/**
+ * @brief Enter the next stage of the running job (call from the runner)
+ * @param stage Stage
+ */
+void jobs_stage(job_stage_t stage);
+
+/**
+ * @brief Check whether a job is waiting or running
+ */
+bool jobs_busy(void);
+
+/**
+ * @brief Keep the worker from starting a job, for other users of the panel
+ *
+ * Waits for a running job to finish; queued jobs stay queued until
+ * jobs_release().
+ * @param timeout_ms Maximum time to wait for the running job
+ * @return true if held; then call jobs_release()
+ */
+bool jobs_hold(uint32_t timeout_ms);
+
+/**
+ * @brief Let the worker continue after jobs_hold()
+ */
+void jobs_release(void);
+
+/**
+ * @brief Wait until no job is waiting or running
+ * @param timeout_ms Maximum time to wait
+ * @return true if idle
+ */
+bool jobs_wait_idle(uint32_t timeout_ms);
+
+/**
+ * @brief Describe a job as JSON
+ *
+ * {"id": 3, "action": "show", "state": "running", "stage": "dithering",
+ *  "error": "...", "ms": {"waiting": 0, "downloading": 812, ..., "total": 1930}}
+ * Stages not entered are left out of "ms"; "error" is only present for
+ * failed jobs. With id 0, all kept jobs are listed as a JSON array.
+ * @param id Job ID, or 0 for all
+ * @param buf Output buffer
+ * @param len Size of buf
+ * @return Length written, 0 if the job is unknown (or buf too small)
+ */
+size_t jobs_format_json(uint32_t id, char *buf, size_t len);
+
+#endif // JOBS_H
@@ -0,0 +1,144 @@
+/**
+ * @file json_stream.h
+ * @brief Incremental JSON tokenizer for request bodies
+ *
+ * The document is fed in arbitrary chunks (e.g. as they come from
+ * httpd_req_recv()) and reported through a callback, so the whole body is
+ * never held in memory. Only one token at a time is buffered, in a buffer
+ * supplied by the caller; strings are delivered unescaped and UTF-8 encoded.
+ *
+ * A callback may ask for the next value to be captured as raw JSON text
+ * (json_stream_capture()), for values that are handed on as a whole, such as
+ * a nested document for another parser.
+ *
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_STREAM_MAX_DEPTH 16    // Nesting of objects and arrays
+
+/** Events reported to the callback */
+typedef enum {
+    JSON_STREAM_OBJECT_START,
+    JSON_STREAM_OBJECT_END,
+    JSON_STREAM_ARRAY_START,
+    JSON_STREAM_ARRAY_END,
+    JSON_STREAM_KEY,        /**< Object key, the value follows */
+    JSON_STREAM_STRING,
+    JSON_STREAM_NUMBER,     /**< Text of the number, checked to be valid JSON */
+    JSON_STREAM_BOOL,       /**< "true" or "false" */
+    JSON_STREAM_NULL,
+    JSON_STREAM_RAW,        /**< Captured object or array, see json_stream_capture() */
+} json_stream_event_t;
+
+typedef struct json_stream json_stream_t;
+
+/**
+ * @brief Receives tokens
+ * @param js Tokenizer (for json_stream_depth(), json_stream_capture(), json_stream_fail())
+ * @param ev Event
+ * @param str Token text, NUL-terminated (NULL for start/end events)
+ * @param len Length of str
+ * @param ctx User context
+ * @return false to stop; the feed then fails with the message from json_stream_fail()
+ */
+typedef bool (*json_stream_cb_t)(json_stream_t *js, json_stream_event_t ev,
+                                 const char *str, size_t len, void *ctx);
+
+/** Tokenizer state; use the functions below rather than the fields */
+struct json_stream {
+    json_stream_cb_t cb;
+    void *ctx;
+    char *tok;              /**< Token buffer */
+    size_t tok_size;
+    size_t tok_len;
+    uint8_t lex;            /**< Token being scanned */
+    uint8_t expect;         /**< Grammar state */
+    uint8_t depth;
+    uint8_t stack[JSON_STREAM_MAX_DEPTH];   /**< '{' or '[' per level */
+    bool is_key;            /**< Current string is an object key */
+    uint8_t hex_digits;     /**< \u escape progress */
+    uint32_t code;          /**< \u escape value */
+    uint32_t high_surrogate;
+    const char *literal;    /**< true/false/null being matched */
+    uint8_t literal_pos;
+    char *cap;              /**< Capture buffer */
+    size_t cap_size;
+    size_t cap_len;
+    bool cap_pending;       /**< Capture the next value */
+    bool capturing;
+    uint8_t cap_depth;      /**< Depth the captured value started at */
+    size_t offset;          /**< Bytes consumed */
+    const char *error;
+};
+
+/**
+ * @brief Start a document
+ * @param js Tokenizer
+ * @param tok Token buffer; strings and numbers longer than tok_size - 1 are an error
+ * @param tok_size Size of tok
+ * @param cb Callback
+ * @param ctx User context for the callback
+ */
+void json_stream_init(json_stream_t *js, char *tok, size_t tok_size,
+                      json_stream_cb_t cb, void *ctx);
+
+/**
+ * @brief Feed the next chunk of the document
+ * @param js Tokenizer
+ * @param data Chunk
+ * @param len Length of the chunk
+ * @return false on a syntax error or if the callback stopped
+ */
+bool json_stream_feed(json_stream_t *js, const char *data, size_t len);
+
+/**
+ * @brief End the document
+ * @param js Tokenizer
+ * @return true if exactly one complete value was fed
+ */
+bool json_stream_finish(json_stream_t *js);
+
+/**
+ * @brief Capture the next value as raw JSON text (call from the callback)
+ *
+ * If the next value is an object or array, its text is collected in buf and
+ * reported as one JSON_STREAM_RAW event instead of its tokens (the syntax
+ * is still checked). Other values are reported as usual.
+ * @param js Tokenizer
+ * @param buf Capture buffer, NUL-terminated on delivery
+ * @param size Size of buf; longer values are an error
+ */
+void json_stream_capture(json_stream_t *js, char *buf, size_t size);
+
+/**
+ * @brief Stop with an error (call from the callback)
+ * @param js Tokenizer
+ * @param msg Message, must outlive the tokenizer
+ * @return false, for returning from the callback
+ */
+bool json_stream_fail(json_stream_t *js, const char *msg);
+
+/**
+ * @brief Nesting level of the current token (1 = members of the top-level object)
+ */
+int json_stream_depth(const json_stream_t *js);
+
+/**
+ * @brief Error message after a failed feed or finish
+ * @return Message, NULL if there was no error
+ */
+const char *json_stream_error(const json_stream_t *js);
+
+/**
+ * @brief Bytes consumed, i.e. the position of an error
+ */
+size_t json_stream_offset(const json_stream_t *js);
+
+#endif // JSON_STREAM_H
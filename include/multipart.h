@@ -0,0 +1,103 @@
+/**
+ * @file multipart.h
+ * @brief Streaming multipart/form-data parser for request bodies
+ *
+ * The body is fed in arbitrary chunks (e.g. as they come from
+ * httpd_req_recv()) and the parts are reported through a callback, so an
+ * upload is never held in memory. Part data is passed on in the largest
+ * runs possible; only a partial boundary match at the end of a chunk is
+ * held back until the next chunk decides it.
+ *
+ * Boundaries follow RFC 2046: 1-70 characters, no CR or LF. A boundary
+ * followed by anything but "--" or optional whitespace and CRLF does not
+ * end the part and is passed on as data.
+ *
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MULTIPART_BOUNDARY_MAX 70      // RFC 2046 limit
+#define MULTIPART_LINE_MAX     256     // Longest header line kept (longer ones are cut)
+#define MULTIPART_HEADERS_MAX  8192    // Header section of one part
+
+/** Events reported to the callback */
+typedef enum {
+    MULTIPART_PART_BEGIN,   /**< Headers done; data is the Content-Disposition value, NUL-terminated ("" if none) */
+    MULTIPART_DATA,         /**< Next piece of the part body */
+    MULTIPART_PART_END,
+} multipart_event_t;
+
+/**
+ * @brief Receives parts
+ * @param ev Event
+ * @param data Event data (NULL for PART_END), valid only during the call
+ * @param len Length of data
+ * @param ctx User context
+ * @return false to stop; the feed then fails
+ */
+typedef bool (*multipart_cb_t)(multipart_event_t ev, const uint8_t *data, size_t len, void *ctx);
+
+/** Parser state; use the functions below rather than the fields */
+typedef struct {
+    multipart_cb_t cb;
+    void *ctx;
+    char delim[4 + MULTIPART_BOUNDARY_MAX + 1];  /**< "\r\n--" boundary */
+    size_t delim_len;
+    uint8_t state;
+    uint8_t tail;           /**< Progress after a full delimiter */
+    size_t match;           /**< Delimiter bytes matched and held back */
+    uint8_t tail_buf[16];   /**< Bytes after the delimiter, held back */
+    size_t tail_len;
+    char line[MULTIPART_LINE_MAX];
+    size_t line_len;
+    size_t header_bytes;
+    char disposition[MULTIPART_LINE_MAX];
+    uint32_t parts;
+    size_t offset;          /**< Bytes consumed */
+    const char *error;
+} multipart_t;
+
+/**
+ * @brief Start a body
+ * @param mp Parser
+ * @param content_type Content-Type header of the request
+ * @param cb Callback
+ * @param ctx User context for the callback
+ * @return false if the type is not multipart or has no valid boundary
+ */
+bool multipart_init(multipart_t *mp, const char *content_type, multipart_cb_t cb, void *ctx);
+
+/**
+ * @brief Feed the next chunk of the body
+ * @param mp Parser
+ * @param data Chunk
+ * @param len Length of the chunk
+ * @return false on a format error or if the callback stopped
+ */
+bool multipart_feed(multipart_t *mp, const uint8_t *data, size_t len);
+
+/**
+ * @brief End the body
+ * @param mp Parser
+ * @return true if the closing boundary was seen
+ */
+bool multipart_finish(multipart_t *mp);
+
+/**
+ * @brief Error message after a failed init, feed or finish
+ * @return Message, NULL if there was no error
+ */
+const char *multipart_error(const multipart_t *mp);
+
+/**
+ * @brief Bytes consumed, i.e. the position of an error
+ */
+size_t multipart_offset(const multipart_t *mp);
+
+#endif // MULTIPART_H
@@ -0,0 +1,99 @@
+/**
+ * @file ota_writer.h
+ * @brief Pipelined flash writer for firmware uploads
+ *
+ * Received firmware is copied into a ring of buffers that a writer task
+ * drains into the OTA partition, so the network keeps receiving while the
+ * flash is erased and programmed. The writer task first erases the range
+ * needed for the image (esp_ota_begin() with the image size) while the
+ * receiver fills the ring, after which writes are plain programming.
+ *
+ * The receiver only blocks when all buffers are waiting to be written. If
+ * a flash write fails, the writer keeps draining the ring and further
+ * writes fail, so the receiver stops early instead of hanging.
+ *
+ * One upload at a time; begin, write and end/abort are called from the
+ * same (receiving) task, the status from any task.
+ */
+
+#ifndef OTA_WRITER_H
+#define OTA_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#define OTA_WRITER_BUFFERS      4       // Buffers in the ring
+#define OTA_WRITER_BUFFER_SIZE  16384   // Bytes per buffer (multiple of the 4 KB flash sector)
+#define OTA_WRITER_ERROR_LEN    64      // Longest error message + 1
+
+/** Upload state */
+typedef enum {
+    OTA_WRITER_IDLE,
+    OTA_WRITER_RECEIVING,   /**< Between begin and end */
+    OTA_WRITER_VERIFYING,   /**< Last buffers written, image being checked */
+    OTA_WRITER_DONE,
+    OTA_WRITER_FAILED,
+} ota_writer_state_t;
+
+/** Status of the current or last upload */
+typedef struct {
+    ota_writer_state_t state;
+    uint32_t image_size;    /**< Expected image size (upper bound) */
+    uint32_t queued;        /**< Bytes passed to ota_writer_write() */
+    uint32_t written;       /**< Bytes written to flash */
+    uint32_t erase_ms;      /**< Pre-erase time */
+    uint32_t write_ms;      /**< Time in esp_ota_write() */
+    uint32_t stall_ms;      /**< Time the receiver waited for a free buffer */
+    uint32_t elapsed_ms;    /**< Since begin (until end for a finished upload) */
+    char error[OTA_WRITER_ERROR_LEN];   /**< Set in state OTA_WRITER_FAILED */
+} ota_writer_status_t;
+
+/**
+ * @brief Start an upload: allocate the ring and start the writer task
+ *
+ * The writer task erases image_size bytes (rounded up to sectors) of the
+ * partition before the first write.
+ * @param partition Target OTA partition
+ * @param image_size Upper bound of the image size (at most the partition size)
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if an upload is running,
+ *         ESP_ERR_NO_MEM if the ring or task could not be created
+ */
+esp_err_t ota_writer_begin(const esp_partition_t *partition, size_t image_size);
+
+/**
+ * @brief Queue firmware data (copied; blocks while the ring is full)
+ * @param data Data
+ * @param len Length of the data
+ * @return ESP_OK, or ESP_FAIL once the writer has failed; ota_writer_end()
+ *         then returns the error
+ */
+esp_err_t ota_writer_write(const void *data, size_t len);
+
+/**
+ * @brief Write the rest, wait for the writer and finish the image
+ * @return ESP_OK if the image was written and validated;
+ *         ESP_ERR_OTA_VALIDATE_FAILED for a corrupted image
+ */
+esp_err_t ota_writer_end(void);
+
+/**
+ * @brief Stop an upload and discard the image
+ * @param reason Error message for the status
+ */
+void ota_writer_abort(const char *reason);
+
+/**
+ * @brief Status of the current or last upload
+ * @param status Filled in
+ */
+void ota_writer_get_status(ota_writer_status_t *status);
+
+/**
+ * @brief Name of a state for JSON ("idle", "receiving", ...)
+ */
+const char *ota_writer_state_name(ota_writer_state_t state);
+
+#endif // OTA_WRITER_H
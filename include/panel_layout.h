@@ -0,0 +1,73 @@
+/**
+ * @file panel_layout.h
+ * @brief Multi-panel layout description and parser
+ *
+ * Several panels can be driven from one MCU, arranged in a grid and sharing
+ * the SPI bus. The layout is stored in NVS as a string:
+ *
+ *   "<cols>x<rows>;<cs>,<dc>,<rst>,<busy>;<cs>,<dc>,<rst>,<busy>;..."
+ *
+ * with one pin group per panel in row-major order, e.g.
+ * "2x1;10,9,8,7;4,5,6,15" for two panels side by side. An empty string
+ * means a single panel on the default EPD_PIN_* pins. Panels with two
+ * controllers (EPD_PANEL_CONTROLLERS > 1) take a fifth pin per group, the
+ * CS of the second controller: "<cs>,<dc>,<rst>,<busy>,<cs2>".
+ *
+ * Every pin must be a valid GPIO (an output-capable one except BUSY) and
+ * may appear only once in the layout; the SPI bus pins (EPD_PIN_MOSI,
+ * EPD_PIN_CLK) are taken.
+ */
+
+#ifndef PANEL_LAYOUT_H
+#define PANEL_LAYOUT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "epd_7in3e.h"
+
+/** Parsed panel layout */
+typedef struct {
+    uint8_t cols;                               /**< Panels per row */
+    uint8_t rows;                               /**< Panel rows */
+    uint8_t count;                              /**< cols * rows */
+    epd_transport_pins_t pins[EPD_MAX_PANELS];  /**< Control pins, row-major */
+} panel_layout_t;
+
+/**
+ * @brief Parse a layout string
+ * @param str Layout string (NULL or empty = single default panel)
+ * @param layout Receives the parsed layout
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the string is malformed
+ *         or uses an invalid or duplicate pin (the layout is then the default)
+ */
+esp_err_t panel_layout_parse(const char *str, panel_layout_t *layout);
+
+/**
+ * @brief Part of a shared image shown by one panel
+ *
+ * With one image across all panels, the canvas is the whole grid and each
+ * panel shows its cell of it (see image_processor_set_region()).
+ * @param layout Layout
+ * @param index Panel index (row-major)
+ * @param canvas_width Receives the width of the grid in pixels
+ * @param canvas_height Receives the height of the grid in pixels
+ * @param x Receives the left edge of the panel in the canvas
+ * @param y Receives the top edge of the panel in the canvas
+ */
+void panel_layout_region(const panel_layout_t *layout, int index,
+                         uint16_t *canvas_width, uint16_t *canvas_height, uint16_t *x, uint16_t *y);
+
+/**
+ * @brief Build the image URL for one panel
+ *
+ * A "{panel}" placeholder in the template is replaced by the panel index,
+ * giving one image per panel. Without it all panels share one image.
+ * @param tmpl URL template
+ * @param index Panel index
+ * @param out Output buffer
+ * @param out_len Output buffer size
+ * @return true if the template contains the placeholder
+ */
+bool panel_layout_url(const char *tmpl, int index, char *out, size_t out_len);
+
+#endif // PANEL_LAYOUT_H
@@ -0,0 +1,172 @@
+/**
+ * @file playlist.h
+ * @brief Offline slideshow: playlist manifest and index of the stored frames
+ *
+ * In playlist mode the image URL points to a JSON manifest instead of an
+ * image:
+ *
+ *   {"frames": ["a.png", {"url": "https://host/b.png", "rev": "3"}, ...]}
+ *
+ * Frame URLs may be relative to the manifest. A frame with a "rev" is reused
+ * from flash as long as URL and rev are unchanged; one without is
+ * revalidated with its ETag whenever the manifest changes.
+ *
+ * The frames are kept compressed in a ring in the data area of the "slides"
+ * partition (see slides.h). This module holds the index of that ring and
+ * decides where a new frame goes and which stored frames it evicts: free
+ * space first, then frames no longer in the manifest, and frames of the
+ * current playlist only if nothing else makes room (oldest first).
+ *
+ * Plain C without ESP-IDF dependencies (uses cJSON).
+ */
+
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PLAYLIST_MAX_FRAMES   32    // Frames in one manifest
+#define PLAYLIST_MAX_ENTRIES  40    // Stored frames, including ones no longer listed
+#define PLAYLIST_ETAG_LEN     64
+#define PLAYLIST_UNLISTED     0xFF  // Entry not in the current manifest
+#define PLAYLIST_HASH_INIT    2166136261u
+
+/** One compressed frame in the data area */
+typedef struct {
+    uint32_t offset;                    /**< Start in the data area (sector aligned) */
+    uint32_t size;                      /**< Compressed size */
+    uint32_t crc;                       /**< CRC32 of the compressed data */
+    uint32_t key;                       /**< playlist_frame_key() of URL and rev */
+    uint8_t position;                   /**< Position in the manifest or PLAYLIST_UNLISTED */
+    char etag[PLAYLIST_ETAG_LEN];       /**< ETag of the download, empty if none */
+} playlist_entry_t;
+
+/** Index of the stored frames */
+typedef struct {
+    uint32_t data_size;                 /**< Size of the data area */
+    uint32_t sector_size;               /**< Erase unit, frames start on it */
+    uint32_t head;                      /**< Where the ring continues */
+    uint32_t render_key;                /**< Settings the frames were dithered with */
+    uint8_t count;                      /**< Entries, oldest first */
+    uint8_t frames;                     /**< Frames in the manifest */
+    char etag[PLAYLIST_ETAG_LEN];       /**< ETag of the manifest */
+    playlist_entry_t entry[PLAYLIST_MAX_ENTRIES];
+} playlist_index_t;
+
+/** Parsed manifest */
+typedef struct {
+    int count;
+    char *url[PLAYLIST_MAX_FRAMES];     /**< Absolute frame URLs (heap) */
+    uint32_t key[PLAYLIST_MAX_FRAMES];  /**< playlist_frame_key() */
+    bool has_rev[PLAYLIST_MAX_FRAMES];  /**< Frame is versioned by "rev" */
+} playlist_manifest_t;
+
+/**
+ * @brief FNV-1a over a block of data
+ * @param data Data
+ * @param len Length
+ * @param h Previous hash, PLAYLIST_HASH_INIT to start
+ * @return Hash
+ */
+uint32_t playlist_hash(const void *data, size_t len, uint32_t h);
+
+/**
+ * @brief Key of a frame: its URL and rev (NULL if none)
+ */
+uint32_t playlist_frame_key(const char *url, const char *rev);
+
+/**
+ * @brief Resolve a frame URL against the manifest URL
+ *
+ * Handles absolute URLs, "//host/..." , "/path" and paths relative to the
+ * manifest's directory.
+ * @param base Manifest URL
+ * @param ref URL from the manifest
+ * @param out Receives the absolute URL
+ * @param len Size of out
+ * @return false if it does not fit
+ */
+bool playlist_resolve_url(const char *base, const char *ref, char *out, size_t len);
+
+/**
+ * @brief Parse a manifest
+ * @param json Manifest (need not be terminated)
+ * @param len Length of json
+ * @param base_url Manifest URL, for relative frame URLs
+ * @param out Receives the frames; free with playlist_manifest_free()
+ * @param err Receives a message on error, may be NULL
+ * @param err_len Size of err
+ * @return true on success (at least one frame)
+ */
+bool playlist_parse(const char *json, size_t len, const char *base_url,
+                    playlist_manifest_t *out, char *err, size_t err_len);
+
+/**
+ * @brief Free the URLs of a parsed manifest
+ */
+void playlist_manifest_free(playlist_manifest_t *m);
+
+/**
+ * @brief Empty index for a data area
+ * @param idx Index
+ * @param data_size Size of the data area (multiple of sector_size)
+ * @param sector_size Erase unit
+ * @param render_key Settings the frames will be dithered with
+ */
+void playlist_index_reset(playlist_index_t *idx, uint32_t data_size, uint32_t sector_size,
+                          uint32_t render_key);
+
+/**
+ * @brief Drop all frames from the playlist before a resync (they stay stored)
+ */
+void playlist_index_unlist(playlist_index_t *idx);
+
+/**
+ * @brief Find a stored frame
+ * @param idx Index
+ * @param key playlist_frame_key()
+ * @return Entry index or -1
+ */
+int playlist_index_find(const playlist_index_t *idx, uint32_t key);
+
+/**
+ * @brief Choose where a new frame goes and evict the frames in the way
+ *
+ * Evicted entries are removed from the index; persist it before erasing.
+ * Also frees an entry if the index is full.
+ * @param idx Index
+ * @param size Compressed size of the new frame
+ * @param offset Receives the start in the data area
+ * @param erase_len Receives the length to erase from offset
+ * @return Number of evicted entries, -1 if the frame is larger than the data area
+ */
+int playlist_index_place(playlist_index_t *idx, uint32_t size, uint32_t *offset,
+                         uint32_t *erase_len);
+
+/**
+ * @brief Add a frame written at an offset from playlist_index_place()
+ *
+ * An older entry with the same key is replaced.
+ */
+void playlist_index_add(playlist_index_t *idx, uint32_t offset, uint32_t size, uint32_t crc,
+                        uint32_t key, const char *etag, uint8_t position);
+
+/**
+ * @brief Next frame of the playlist to show
+ * @param idx Index
+ * @param cursor Position to start at; advanced past the returned frame
+ * @return Entry index, -1 if no frame of the playlist is stored
+ */
+int playlist_index_next(const playlist_index_t *idx, uint8_t *cursor);
+
+/**
+ * @brief Frames of the playlist that are stored
+ * @param idx Index
+ * @param bytes Receives their compressed size, may be NULL
+ * @return Number of frames
+ */
+int playlist_index_listed(const playlist_index_t *idx, uint32_t *bytes);
+
+#endif // PLAYLIST_H
@@ -0,0 +1,83 @@
+/**
+ * @file png_stream.h
+ * @brief Row-by-row indexed PNG encoder
+ *
+ * Encodes palette images (such as packed panel frames, 4 bits per pixel)
+ * as they are produced: each row is deflated on arrival and the compressed
+ * data leaves in IDAT chunks of at most PNG_STREAM_IDAT_SIZE bytes through
+ * a write callback, e.g. as HTTP chunks. Neither the image nor the
+ * compressed file is held in memory; the state is the deflate compressor
+ * (supplied by the caller, about 320 KB) and one chunk buffer.
+ *
+ * Rows are stored unfiltered, which suits dithered palette images.
+ *
+ * Plain C (miniz) without ESP-IDF dependencies.
+ */
+
+#ifndef PNG_STREAM_H
+#define PNG_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "miniz.h"
+
+#define PNG_STREAM_IDAT_SIZE 4096   // Compressed data per IDAT chunk
+
+/**
+ * @brief Receives encoded PNG data
+ * @param data Data, valid only during the call
+ * @param len Length of the data
+ * @param ctx User context
+ * @return false to abort the encode
+ */
+typedef bool (*png_stream_write_t)(const uint8_t *data, size_t len, void *ctx);
+
+/** Encoder state; use the functions below rather than the fields */
+typedef struct {
+    tdefl_compressor *comp;
+    png_stream_write_t write;
+    void *ctx;
+    uint32_t height;
+    size_t row_bytes;
+    uint32_t rows;          /**< Rows received */
+    bool failed;
+    size_t chunk_len;       /**< Data bytes in chunk */
+    uint8_t chunk[8 + PNG_STREAM_IDAT_SIZE + 4];   /**< IDAT being filled: header, data, CRC */
+} png_stream_t;
+
+/**
+ * @brief Start an image and write the signature, header and palette
+ * @param ps Encoder
+ * @param comp Deflate compressor (work area, not initialized)
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param bit_depth Bits per pixel: 1, 2, 4 or 8
+ * @param palette RGB triplets, indexed by pixel value
+ * @param colors Number of palette entries (1 .. 2^bit_depth)
+ * @param write Output callback
+ * @param ctx User context for the callback
+ * @return false on invalid parameters or if the callback failed
+ */
+bool png_stream_begin(png_stream_t *ps, tdefl_compressor *comp,
+                      uint32_t width, uint32_t height, uint8_t bit_depth,
+                      const uint8_t (*palette)[3], size_t colors,
+                      png_stream_write_t write, void *ctx);
+
+/**
+ * @brief Add the next row
+ * @param ps Encoder
+ * @param row Packed pixels, leftmost pixel in the high bits
+ *            ((width * bit_depth + 7) / 8 bytes)
+ * @return false if the encode failed (callback error or too many rows)
+ */
+bool png_stream_row(png_stream_t *ps, const uint8_t *row);
+
+/**
+ * @brief Finish the image and write the remaining data and IEND
+ * @param ps Encoder
+ * @return false if the encode failed or rows are missing
+ */
+bool png_stream_end(png_stream_t *ps);
+
+#endif // PNG_STREAM_H
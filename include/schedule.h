@@ -0,0 +1,101 @@
+/**
+ * @file schedule.h
+ * @brief Refresh schedule compiled from the schedule JSON into a binary table
+ *
+ * The schedule JSON (plans of time periods, one plan per weekday) is
+ * validated and compiled once when it is saved. Each plan becomes a sorted
+ * list of segments covering the day, so evaluation is a short linear scan
+ * and the time until the refresh interval next changes is known.
+ *
+ * Period semantics (unchanged from the JSON evaluator): periods are matched
+ * in order and the first match wins; start == end covers the whole day and
+ * start > end wraps around midnight within the same day's plan.
+ *
+ * Plain C without ESP-IDF dependencies (uses cJSON).
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config.h"
+
+#define SCHEDULE_DAYS           7     // Monday = 0
+#define SCHEDULE_NO_PLAN        0xFF  // Day without a plan (default interval)
+#define SCHEDULE_MAX_INTERVAL   1440  // Minutes
+// A plan with n periods has at most 2n + 1 segments
+#define SCHEDULE_MAX_SEGMENTS   (MAX_SCHEDULE_PLANS * (2 * MAX_PERIODS_PER_PLAN + 1))
+// Boundaries closer than this are folded into the next sleep
+#define SCHEDULE_MIN_SLEEP_S    60
+
+/** Part of a day with one refresh interval; ends where the next one starts */
+typedef struct {
+    uint16_t start;     /**< Minute of the day */
+    uint16_t interval;  /**< Minutes, 0 = default interval */
+} schedule_segment_t;
+
+/** Compiled schedule */
+typedef struct {
+    uint8_t valid;                          /**< Compiled (0 = never compiled) */
+    uint8_t plan_count;
+    uint8_t day_plan[SCHEDULE_DAYS];        /**< Plan index or SCHEDULE_NO_PLAN */
+    uint8_t plan_first[MAX_SCHEDULE_PLANS + 1];  /**< Segments of plan p: [plan_first[p], plan_first[p+1]) */
+    schedule_segment_t seg[SCHEDULE_MAX_SEGMENTS];
+} schedule_table_t;
+
+/**
+ * @brief Validate and compile a schedule JSON
+ *
+ * An empty string compiles to a schedule without plans (default interval
+ * all week).
+ * @param json Schedule JSON
+ * @param out Receives the table (left unchanged on error)
+ * @param err Receives a message on error, may be NULL
+ * @param err_len Size of err
+ * @return true on success
+ */
+bool schedule_compile(const char *json, schedule_table_t *out, char *err, size_t err_len);
+
+/**
+ * @brief Refresh interval at a point in the week
+ * @param t Compiled schedule
+ * @param day Day of the week (0 = Monday)
+ * @param minute Minute of the day (0-1439)
+ * @return Interval in minutes, 0 if no period applies
+ */
+uint32_t schedule_interval_at(const schedule_table_t *t, int day, uint32_t minute);
+
+/**
+ * @brief Seconds until the next refresh
+ *
+ * The current interval, but no later than the next point where the
+ * effective interval changes, so a new period takes effect on time.
+ * @param t Compiled schedule
+ * @param day Day of the week (0 = Monday)
+ * @param second Second of the day (0-86399)
+ * @param default_min Interval used where no period applies
+ * @return Sleep duration in seconds
+ */
+uint32_t schedule_next_wake_s(const schedule_table_t *t, int day, uint32_t second,
+                              uint32_t default_min);
+
+/**
+ * @brief Seconds until a wake that lands on the wall-clock grid of the interval
+ *
+ * The grid counts from local midnight (every 15 min: :00, :15, :30, :45)
+ * and restarts there, so intervals that do not divide a day are cut short
+ * at midnight. The wake is lead_s before the grid point, so that the work
+ * that follows the wake reaches the grid point just after it passes.
+ * @param second Second of the day (0-86399)
+ * @param interval_min Grid spacing in minutes
+ * @param lead_s Time from wake to the moment that should be aligned
+ * @param limit_s Sleep must not end later than this (e.g. a schedule
+ *                boundary), UINT32_MAX for no limit
+ * @return Sleep duration in seconds
+ */
+uint32_t schedule_align_s(uint32_t second, uint32_t interval_min, uint32_t lead_s,
+                          uint32_t limit_s);
+
+#endif // SCHEDULE_H
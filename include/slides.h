@@ -0,0 +1,88 @@
+/**
+ * @file slides.h
+ * @brief Offline slideshow frames stored compressed in a flash partition
+ *
+ * A sync downloads the playlist manifest and every new frame over one
+ * kept-alive HTTP connection. Each frame is dithered once and its packed
+ * rows are deflated straight into RAM, then written to the "slides"
+ * partition. Later wakes inflate the next frame from flash to the panel
+ * without starting WiFi. The manifest is checked with If-None-Match, so a
+ * check of an unchanged playlist costs one 304 reply and no frame traffic.
+ *
+ * Partition layout: two index sectors written alternately (sequence number
+ * and CRC, the newer valid one wins), then the data area managed by
+ * playlist.h. Evicted frames are dropped from the stored index before
+ * their sectors are erased, so an interrupted sync never leaves the index
+ * pointing at overwritten data.
+ */
+
+#ifndef SLIDES_H
+#define SLIDES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "image_processor.h"
+
+/** Slideshow statistics (kept across deep sleep) */
+typedef struct {
+    uint32_t checks;        /**< Manifest checks */
+    uint32_t changes;       /**< Checks that found a changed manifest */
+    uint32_t downloads;     /**< Frames downloaded and stored */
+    uint32_t reused;        /**< Frames kept from flash during a resync */
+    uint32_t evictions;     /**< Stored frames evicted to make room */
+    uint32_t shown;         /**< Frames displayed from flash */
+    uint32_t last_sync_ms;  /**< Duration of the last resync */
+    uint32_t last_show_ms;  /**< Map + verify + inflate of the last frame shown */
+    uint8_t frames;         /**< Frames in the playlist */
+    uint8_t stored;         /**< Of those, frames held in flash */
+    uint32_t stored_bytes;  /**< Their compressed size */
+    uint32_t capacity;      /**< Size of the data area */
+} slides_stats_t;
+
+/**
+ * @brief Find the partition and load the frame index
+ *
+ * Stored frames dithered with other settings are dropped.
+ * @param render_key Hash of the settings that affect dithered frames
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without a partition
+ */
+esp_err_t slides_init(uint32_t render_key);
+
+/**
+ * @brief Whether this wake has to go online
+ * @param check_min Minutes between manifest checks
+ * @return true if no frame is stored or the manifest is due for a check
+ */
+bool slides_sync_due(uint32_t check_min);
+
+/**
+ * @brief Check the manifest and download the frames it added or changed
+ *
+ * Uses the image processor with its current scaling, transform and SSL
+ * settings; it must be initialized.
+ * @param manifest_url Manifest URL
+ * @return ESP_OK if the manifest was checked (some frames may have failed)
+ */
+esp_err_t slides_sync(const char *manifest_url);
+
+/**
+ * @brief Inflate the next stored frame and pass its rows to a sink
+ * @param sink Row sink
+ * @param sink_ctx User context for the sink
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if no frame is stored
+ */
+esp_err_t slides_show_next(image_row_sink_t sink, void *sink_ctx);
+
+/**
+ * @brief Get the last error message
+ */
+const char *slides_get_error(void);
+
+/**
+ * @brief Get slideshow statistics
+ * @param out Receives the statistics
+ */
+void slides_get_stats(slides_stats_t *out);
+
+#endif // SLIDES_H
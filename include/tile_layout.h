@@ -0,0 +1,112 @@
+/**
+ * @file tile_layout.h
+ * @brief Composite dashboard layout: image URLs mapped to frame regions
+ *
+ * A dashboard can be assembled on the device from independent tiles
+ * (weather, calendar, ...) instead of one server-rendered image. The layout
+ * is one tile per line:
+ *
+ *   <x>,<y>,<w>,<h>,<url>
+ *
+ * in image coordinates (before rotation/mirroring), e.g.
+ *
+ *   0,0,400,240,weather.png
+ *   400,0,400,480,https://cal.example/today.png
+ *
+ * URLs may be relative to the image URL. Tiles must lie inside the image
+ * and should not overlap (later tiles would be drawn over earlier ones);
+ * area covered by no tile stays white.
+ *
+ * The tile state records the ETag of every tile in the composed frame and
+ * the CRC of that frame. A new frame starts from the cached one only while
+ * the cache still holds it; tiles are then requested with their ETags and
+ * those answered 304 are left as they are.
+ *
+ * Plain C without ESP-IDF dependencies.
+ */
+
+#ifndef TILE_LAYOUT_H
+#define TILE_LAYOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TILE_MAX 8      // Tiles in one layout
+#define TILE_ETAG_LEN 64
+#define TILE_STATE_MAGIC 0x544C5331  // "TLS1"
+
+/** One tile */
+typedef struct {
+    uint16_t x, y, w, h;    /**< Region in image coordinates */
+    const char *url;        /**< URL, points into the layout string (not terminated) */
+    uint16_t url_len;       /**< Length of url */
+} tile_t;
+
+/** Parsed layout */
+typedef struct {
+    uint8_t count;
+    tile_t tile[TILE_MAX];
+} tile_layout_t;
+
+/**
+ * @brief Parse a layout string
+ * @param str Layout, one tile per line ('\n' or "\r\n"); must outlive the result
+ * @param width Image width
+ * @param height Image height
+ * @param out Receives the tiles
+ * @param err Receives a message on error, may be NULL
+ * @param err_len Size of err
+ * @return true on success (at least one tile)
+ */
+bool tile_layout_parse(const char *str, uint16_t width, uint16_t height,
+                       tile_layout_t *out, char *err, size_t err_len);
+
+/** Tile ETags of a composed frame */
+typedef struct {
+    uint32_t magic;                         /**< TILE_STATE_MAGIC */
+    uint32_t key;                           /**< Layout, base URL and render settings */
+    uint32_t frame_crc;                     /**< CRC32 of the frame the tiles were composed into */
+    char etag[TILE_MAX][TILE_ETAG_LEN];     /**< ETag of each tile, empty if none */
+} tile_state_t;
+
+/** How a tile's response is used */
+typedef enum {
+    TILE_DRAW,      /**< New content: decode and draw it */
+    TILE_KEEP,      /**< Not modified: the base frame already shows it */
+    TILE_FAILED,    /**< Failed or unexpected status: nothing is drawn */
+} tile_action_t;
+
+/**
+ * @brief Start the state of a new frame
+ *
+ * The stored ETags are carried over only if they belong to the same layout
+ * and to the frame the cache holds; that frame is then the base of the new
+ * one. Otherwise the new frame starts white without ETags.
+ * @param stored State of the last frame (may be invalid)
+ * @param key Key of the current layout and settings
+ * @param cached_crc CRC32 of the cached frame, NULL if none is cached
+ * @param out Receives the state of the new frame
+ * @return true if the cached frame is the base
+ */
+bool tile_state_begin(const tile_state_t *stored, uint32_t key, const uint32_t *cached_crc,
+                      tile_state_t *out);
+
+/**
+ * @brief How to use a tile's response
+ * @param ok Download completed
+ * @param status HTTP status
+ * @param have_base The new frame starts from the cached frame
+ * @return Action
+ */
+tile_action_t tile_state_action(bool ok, int status, bool have_base);
+
+/**
+ * @brief Record the ETag of a tile that was drawn
+ * @param s State of the new frame
+ * @param index Tile index
+ * @param etag ETag of the download (empty or NULL if none; too long ones are dropped)
+ */
+void tile_state_drawn(tile_state_t *s, int index, const char *etag);
+
+#endif // TILE_LAYOUT_H
@@ -0,0 +1,82 @@
+/**
+ * @file tiles.h
+ * @brief Composite dashboard: tiles fetched concurrently, redrawn only when changed
+ *
+ * The tiles of a layout (see tile_layout.h) are downloaded by a few worker
+ * tasks, each keeping its HTTP connection open across its tiles, while the
+ * calling task decodes and dithers the tiles that have arrived. Each tile
+ * is requested with the ETag of the copy in the last composed frame; tiles
+ * answered with 304 are taken from that frame (read from the frame cache)
+ * and cost neither decode nor dither.
+ *
+ * The tile ETags are kept in NVS together with the CRC of the frame they
+ * belong to, so they are only used while the frame cache holds that frame.
+ */
+
+#ifndef TILES_H
+#define TILES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/** Statistics of the last update (kept across deep sleep) */
+typedef struct {
+    uint8_t tiles;          /**< Tiles in the layout */
+    uint8_t fetched;        /**< Downloaded and redrawn */
+    uint8_t unchanged;      /**< Answered 304, reused from the cached frame */
+    uint8_t failed;         /**< Failed (the cached tile is kept if there is one) */
+    uint32_t bytes;         /**< Downloaded PNG bytes */
+    uint32_t fetch_ms;      /**< Until the last tile arrived */
+    uint32_t render_ms;     /**< Decode + dither of the changed tiles */
+} tiles_stats_t;
+
+/**
+ * @brief Set SSL certificate verification mode for tile downloads
+ * @param skip If true, skip SSL certificate verification
+ */
+void tiles_set_ssl_skip(bool skip);
+
+/**
+ * @brief Fetch the tiles of a layout and compose them into a frame
+ *
+ * Uses the image processor (which must be initialized) with its current
+ * scaling and transform settings.
+ * @param layout Layout string (see tile_layout.h)
+ * @param base_url URL relative tile URLs are resolved against
+ * @param render_key Hash of the settings that affect dithered frames
+ * @param frame Receives the packed frame (IMAGE_BUFFER_SIZE bytes)
+ * @param changed Receives false if every tile was reused from the cached frame
+ * @return ESP_OK if a complete frame was composed
+ */
+esp_err_t tiles_update(const char *layout, const char *base_url, uint32_t render_key,
+                       uint8_t *frame, bool *changed);
+
+/**
+ * @brief Remember the tile ETags of the last update
+ *
+ * Call once the composed frame is in the frame cache.
+ * @param frame_crc CRC32 of the cached frame (0 if it was not cached)
+ * @return ESP_OK on success
+ */
+esp_err_t tiles_commit(uint32_t frame_crc);
+
+/**
+ * @brief Time until the first tile is expected to change
+ * @param seconds Receives the remaining time (0 if already due)
+ * @return true if any tile carried a cache hint
+ */
+bool tiles_get_next_change(uint32_t *seconds);
+
+/**
+ * @brief Get the last error message
+ */
+const char *tiles_get_error(void);
+
+/**
+ * @brief Get statistics of the last update
+ * @param out Receives the statistics
+ */
+void tiles_get_stats(tiles_stats_t *out);
+
+#endif // TILES_H
@@ -0,0 +1,87 @@
+/**
+ * @file time_drift.h
+ * @brief RTC clock drift estimation and NTP scheduling
+ *
+ * The RTC keeps time through deep sleep, but its rate is off by some ppm.
+ * Each NTP sync measures how far the clock had drifted since the previous
+ * one; the smoothed rate is used to correct the clock on wakes without NTP
+ * and to predict when the remaining error exceeds the configured bound.
+ *
+ * Plain C without ESP-IDF dependencies; the caller reads and sets the clock.
+ * All times are microseconds since the epoch.
+ */
+
+#ifndef TIME_DRIFT_H
+#define TIME_DRIFT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Assumed rate error before any measurement (RTC RC oscillator, after calibration)
+#define TIME_DRIFT_UNKNOWN_PPB   200000   // 200 ppm
+// Assumed residual error once the drift is compensated
+#define TIME_DRIFT_RESIDUAL_PPB  20000    // 20 ppm
+// Measurements over shorter intervals are too noisy to estimate the rate
+#define TIME_DRIFT_MIN_INTERVAL_S 600
+// Rates beyond this are treated as clock jumps, not drift
+#define TIME_DRIFT_MAX_PPB       2000000  // 2000 ppm
+// Sync at least this often even if the predicted error is small
+#define TIME_DRIFT_MAX_AGE_S     (24 * 3600)
+
+/** Drift state, kept in RTC memory by the caller */
+typedef struct {
+    uint32_t magic;
+    int64_t last_sync_us;   /**< NTP time of the last sync */
+    int64_t applied_us;     /**< Corrections applied to the clock since then */
+    int32_t drift_ppb;      /**< Clock rate error, positive = clock runs fast */
+    uint8_t samples;        /**< Measurements folded into drift_ppb */
+} time_drift_t;
+
+/**
+ * @brief Record an NTP sync
+ * @param d Drift state
+ * @param clock_us Local clock just before it was set
+ * @param ntp_us Time received from NTP
+ */
+void time_drift_on_sync(time_drift_t *d, int64_t clock_us, int64_t ntp_us);
+
+/**
+ * @brief Predicted clock error (after compensation)
+ * @param d Drift state
+ * @param clock_us Current local clock
+ * @return Error bound in ms, UINT32_MAX if the clock was never synced
+ */
+uint32_t time_drift_predicted_error_ms(const time_drift_t *d, int64_t clock_us);
+
+/**
+ * @brief Decide whether this wake needs an NTP sync
+ * @param d Drift state
+ * @param clock_us Current local clock
+ * @param max_error_ms Allowed predicted error (0 = always sync)
+ * @param max_age_s Sync at least this often regardless of the prediction
+ * @return true if NTP should run
+ */
+bool time_drift_sync_needed(const time_drift_t *d, int64_t clock_us,
+                            uint32_t max_error_ms, uint32_t max_age_s);
+
+/**
+ * @brief Compute the drift correction due now and mark it applied
+ *
+ * The caller sets the clock to clock_us - return value.
+ * @param d Drift state
+ * @param clock_us Current local clock
+ * @return Correction in microseconds (positive = clock is ahead)
+ */
+int64_t time_drift_compensate(time_drift_t *d, int64_t clock_us);
+
+/**
+ * @brief Convert a true duration into local clock time
+ *
+ * For timers that run off the same clock, e.g. the deep sleep wake timer.
+ * @param d Drift state
+ * @param duration_us True duration
+ * @return Duration as counted by the local clock
+ */
+uint64_t time_drift_clock_duration_us(const time_drift_t *d, uint64_t duration_us);
+
+#endif // TIME_DRIFT_H
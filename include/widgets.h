@@ -0,0 +1,68 @@
+/**
+ * @file widgets.h
+ * @brief On-device dashboard rendering from a JSON data feed
+ *
+ * Instead of a server-rendered PNG, the device fetches a small JSON
+ * document and draws it into the packed frame using a stored template:
+ *
+ *   {"bg": "white", "items": [
+ *     {"type": "text", "x": 20, "y": 20, "size": 3, "text": "{city} {temp:%.1f} C"},
+ *     {"type": "icon", "x": 600, "y": 20, "size": 6, "key": "now.icon"},
+ *     {"type": "bars", "x": 20, "y": 300, "w": 760, "h": 150, "key": "rain", "color": "blue"},
+ *     {"type": "chart", "x": 20, "y": 120, "w": 760, "h": 150, "key": "hourly.0.temps"},
+ *     {"type": "rect", "x": 10, "y": 10, "w": 780, "h": 460, "thickness": 2},
+ *     {"type": "line", "x": 20, "y": 290, "x2": 780, "y2": 290}
+ *   ]}
+ *
+ * Item fields:
+ *   - all: x, y, color (black, white, yellow, red, orange, blue, green;
+ *     default black)
+ *   - text: text with {path} or {path:printf-format} placeholders, size
+ *     (font scale, default 1), w and align (left, center, right)
+ *   - rect: w, h, fill (true/false), thickness
+ *   - line: x2, y2, thickness
+ *   - bars, chart: w, h, key (array of numbers), min and max (default from
+ *     the data; bars include 0), gap (bars) or thickness (chart)
+ *   - icon: name or key (path to the name, see gfx.h), size
+ *
+ * Paths are dot-separated object keys and array indexes ("a.b.0.c").
+ * Missing values are shown as "--" and empty charts are skipped, so one bad
+ * field does not lose the whole frame. Coordinates are panel coordinates;
+ * the image transform settings do not apply.
+ *
+ * Plain C (cJSON and gfx) without other ESP-IDF dependencies.
+ */
+
+#ifndef WIDGETS_H
+#define WIDGETS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WIDGETS_MAX_ITEMS 64    // Items in one template
+#define WIDGETS_TEXT_LEN  256   // Longest text item after substitution
+
+/**
+ * @brief Check a template without rendering it
+ * @param tmpl Template JSON
+ * @param err Receives a message on error, may be NULL
+ * @param err_len Size of err
+ * @return true if the template is valid
+ */
+bool widgets_check(const char *tmpl, char *err, size_t err_len);
+
+/**
+ * @brief Render a data document into a frame
+ * @param tmpl Template JSON
+ * @param data Data JSON
+ * @param data_len Length of data
+ * @param frame Packed frame (IMAGE_BUFFER_SIZE bytes), fully overwritten
+ * @param err Receives a message on error, may be NULL
+ * @param err_len Size of err
+ * @return true on success; on false the frame is undefined
+ */
+bool widgets_render(const char *tmpl, const char *data, size_t data_len,
+                    uint8_t *frame, char *err, size_t err_len);
+
+#endif // WIDGETS_H
@@ -0,0 +1,125 @@
+/**
+ * @file wifi_cache.h
+ * @brief Fast WiFi reconnect using AP and DHCP lease data kept in RTC memory
+ *
+ * After a successful connection the BSSID, channel and IP configuration are
+ * kept in RTC memory, which survives deep sleep. On the next wake the station
+ * connects straight to that BSSID on that channel (no full scan) and, while
+ * the DHCP lease is still in its first half (before T1 renewal), reuses the
+ * lease as a temporary static configuration instead of waiting for DHCP.
+ * Any failure falls back to the normal scan + DHCP path. The lease time is
+ * read from lwIP's DHCP client state (lwIP 2.0 to 2.2); with other lwIP
+ * versions only the AP is cached.
+ *
+ * The PMK is cached by the WiFi driver itself (WIFI_STORAGE_FLASH), so the
+ * passphrase is not re-hashed on every wake as long as SSID and password
+ * stay the same.
+ */
+
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+/** How a connection was established */
+typedef enum {
+    WIFI_PATH_NONE = 0,     /**< Not connected this boot */
+    WIFI_PATH_FULL,         /**< Scan + DHCP */
+    WIFI_PATH_FAST,         /**< Cached BSSID/channel + DHCP */
+    WIFI_PATH_FAST_LEASE,   /**< Cached BSSID/channel + cached lease */
+} wifi_path_t;
+
+/** Connect statistics (kept across deep sleep) */
+typedef struct {
+    wifi_path_t last_path;      /**< Path of the most recent connect attempt */
+    uint32_t last_ms;           /**< Latency of the most recent successful connect */
+    uint32_t last_fast_ms;      /**< Latency of the last successful fast connect */
+    uint32_t last_full_ms;      /**< Latency of the last successful full connect */
+    uint32_t fast_ok;           /**< Successful fast connects */
+    uint32_t fast_fail;         /**< Fast attempts that fell back to a full connect */
+    uint32_t full_ok;           /**< Successful full connects */
+} wifi_cache_stats_t;
+
+/**
+ * @brief Seconds a cached lease can still be reused
+ *
+ * A lease is reused while the DHCP client would still be BOUND, from the
+ * time it was obtained until T1 (half the lease time).
+ * @param lease_start Time the lease was obtained
+ * @param lease_s Lease time from the server
+ * @param now Current time
+ * @return Seconds until T1, 0 if the lease must not be reused
+ */
+uint32_t wifi_cache_lease_left_s(time_t lease_start, uint32_t lease_s, time_t now);
+
+/**
+ * @brief Set up a fast connect from the cache
+ *
+ * If an AP is cached for these credentials, its BSSID and channel are put
+ * into the STA config and, with DHCP in use, the cached lease is applied as
+ * a temporary static configuration (DHCP client stopped) while it is before
+ * T1.
+ * @param ssid Configured SSID
+ * @param password Configured password
+ * @param use_dhcp The address comes from DHCP (else it is static)
+ * @param netif STA interface
+ * @param sta STA config to update (bssid, bssid_set, channel)
+ * @return WIFI_PATH_FAST_LEASE, WIFI_PATH_FAST, or WIFI_PATH_FULL if nothing
+ *         usable is cached (sta unchanged)
+ */
+wifi_path_t wifi_cache_begin(const char *ssid, const char *password, bool use_dhcp,
+                             esp_netif_t *netif, wifi_sta_config_t *sta);
+
+/**
+ * @brief Clean up after a failed fast connect, before the full one
+ *
+ * Restarts the DHCP client if the cached lease was applied and forgets the
+ * cached AP and lease.
+ * @param netif STA interface
+ * @param path Path returned by wifi_cache_begin()
+ */
+void wifi_cache_fast_failed(esp_netif_t *netif, wifi_path_t path);
+
+/**
+ * @brief Store the current AP and IP configuration after a connect
+ *
+ * Call from the IP_EVENT_STA_GOT_IP handler.
+ * @param netif STA interface
+ * @param ssid Configured SSID
+ * @param password Configured password
+ * @param from_dhcp true if the address came from DHCP (lease time is read
+ *                  from the client), false if a cached lease was reused
+ */
+void wifi_cache_store(esp_netif_t *netif, const char *ssid, const char *password, bool from_dhcp);
+
+/**
+ * @brief Forget the cached AP and lease
+ */
+void wifi_cache_invalidate(void);
+
+/**
+ * @brief Record the outcome of a connect attempt
+ * @param path Path used
+ * @param ok true if connected
+ * @param elapsed_ms Time from start to IP (or to giving up)
+ */
+void wifi_cache_record(wifi_path_t path, bool ok, uint32_t elapsed_ms);
+
+/**
+ * @brief Get connect statistics
+ * @param out Receives the statistics
+ */
+void wifi_cache_get_stats(wifi_cache_stats_t *out);
+
+/**
+ * @brief Name of a connect path (for logs and the status API)
+ * @param path Path
+ * @return Static string
+ */
+const char *wifi_cache_path_name(wifi_path_t path);
+
+#endif // WIFI_CACHE_H
@@ -190,8 +190,8 @@
 // functions (such as tdefl_compress_mem_to_heap() and tinfl_decompress_mem_to_heap()) won't work.
 //#define MINIZ_NO_MALLOC
 
-// 
-#define MINIZ_NO_COMPRESSION
+// Define MINIZ_NO_COMPRESSION to disable tdefl (compression is used by the offline slideshow).
+//#define MINIZ_NO_COMPRESSION
 
 
 #if defined(__TINYC__) && (defined(__linux) || defined(__linux__))
@@ -0,0 +1,176 @@
+/**
+ * @file config_store.c
+ * @brief Settings stored as one versioned, CRC-checked NVS blob
+ */
+
+#include "config_store.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "CONFIG_STORE";
+
+#define CONFIG_STORE_MAGIC 0x43464731  // "CFG1"
+
+static config_store_stats_t stats;
+
+static uint32_t blob_crc(const void *data, size_t size) {
+    return esp_rom_crc32_le(0, (const uint8_t *)data, size);
+}
+
+// Settings bytes of the mirror (the caller's struct, right after the header);
+// the mirror survives deep sleep (not a power cycle)
+static uint8_t *mirror_data(config_store_header_t *mirror) {
+    return (uint8_t *)(mirror + 1);
+}
+
+// Header is valid for this layout version and a struct of at most max_size,
+// and its data matches the CRC
+static bool header_valid(config_store_header_t *h, size_t max_size, uint16_t version) {
+    return h->magic == CONFIG_STORE_MAGIC && h->version == version &&
+           h->size > 0 && h->size <= max_size &&
+           h->crc == blob_crc(mirror_data(h), h->size);
+}
+
+// Remember the stored blob (size bytes of data) in RTC memory
+static void mirror_update(config_store_header_t *mirror, const void *data, size_t size,
+                          uint16_t version) {
+    memcpy(mirror_data(mirror), data, size);
+    mirror->magic = CONFIG_STORE_MAGIC;
+    mirror->version = version;
+    mirror->size = (uint16_t)size;
+    mirror->crc = blob_crc(data, size);
+}
+
+// Copy a stored blob into the caller's struct (shorter blobs are a prefix)
+static void load_prefix(void *data, size_t size, const void *blob, size_t blob_size) {
+    memcpy(data, blob, blob_size < size ? blob_size : size);
+}
+
+esp_err_t config_store_load(config_store_header_t *mirror, void *data, size_t size,
+                            uint16_t version, bool use_rtc) {
+    int64_t start_us = esp_timer_get_time();
+
+    if (size > UINT16_MAX) {
+        ESP_LOGE(TAG, "Settings struct too large (%u bytes)", (unsigned)size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (use_rtc && header_valid(mirror, size, version)) {
+        load_prefix(data, size, mirror_data(mirror), mirror->size);
+        stats.source = CONFIG_SOURCE_RTC;
+        stats.load_us = (uint32_t)(esp_timer_get_time() - start_us);
+        ESP_LOGI(TAG, "Settings restored from RTC memory in %lu us", (unsigned long)stats.load_us);
+        return ESP_OK;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Read straight into the mirror, which then holds the stored blob
+    size_t len = sizeof(*mirror) + size;
+    err = nvs_get_blob(nvs_handle, NVS_CONFIG_BLOB, mirror, &len);
+    nvs_close(nvs_handle);
+
+    if (err != ESP_OK || len < sizeof(*mirror) || len != sizeof(*mirror) + mirror->size ||
+        !header_valid(mirror, size, version)) {
+        if (err == ESP_OK) {
+            ESP_LOGW(TAG, "Stored settings blob is invalid, ignoring it");
+        } else if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+            ESP_LOGW(TAG, "Stored settings blob is larger than this build's settings, ignoring it");
+        }
+        memset(mirror, 0, sizeof(*mirror));
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    load_prefix(data, size, mirror_data(mirror), mirror->size);
+    uint16_t stored_size = mirror->size;
+
+    stats.source = CONFIG_SOURCE_BLOB;
+    stats.load_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Settings loaded from NVS blob (%u bytes) in %lu us",
+             stored_size, (unsigned long)stats.load_us);
+
+    if (stored_size != size) {
+        // Written by a build with a shorter layout: store it in the current one
+        ESP_LOGI(TAG, "Upgrading settings blob from %u to %u bytes", stored_size, (unsigned)size);
+        config_store_save(mirror, data, size, version);
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_store_save(config_store_header_t *mirror, const void *data, size_t size,
+                            uint16_t version) {
+    if (size > UINT16_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // The mirror holds what is in flash; identical settings need no write
+    if (header_valid(mirror, size, version) && mirror->size == size &&
+        memcmp(mirror_data(mirror), data, size) == 0) {
+        stats.saves_skipped++;
+        ESP_LOGI(TAG, "Settings unchanged, not writing flash");
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    mirror_update(mirror, data, size, version);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs_handle, NVS_CONFIG_BLOB, mirror, sizeof(*mirror) + size);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+
+    if (err != ESP_OK) {
+        memset(mirror, 0, sizeof(*mirror));  // Flash state unknown
+        ESP_LOGE(TAG, "Failed to save settings: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    stats.saves++;
+    stats.save_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Settings saved (%u bytes) in %lu us", (unsigned)size, (unsigned long)stats.save_us);
+    return ESP_OK;
+}
+
+void config_store_erase_keys(const char *const *keys, size_t count) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        nvs_erase_key(nvs_handle, keys[i]);  // ESP_ERR_NVS_NOT_FOUND is fine
+    }
+    nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+}
+
+void config_store_note_legacy(uint32_t load_us) {
+    stats.source = CONFIG_SOURCE_LEGACY;
+    stats.load_us = load_us;
+    ESP_LOGI(TAG, "Settings read from individual NVS keys in %lu us", (unsigned long)load_us);
+}
+
+void config_store_get_stats(config_store_stats_t *out) {
+    *out = stats;
+}
+
+const char *config_store_source_name(config_source_t source) {
+    switch (source) {
+        case CONFIG_SOURCE_RTC:    return "rtc";
+        case CONFIG_SOURCE_BLOB:   return "blob";
+        case CONFIG_SOURCE_LEGACY: return "legacy";
+        default:                   return "defaults";
+    }
+}
@@ -1,329 +1,468 @@
 /**
  * @file epd_7in3e.c
  * @brief Waveshare 7.3inch e-Paper (E) Spectra 6 Driver for ESP32-S3
+ *
+ * Each panel is an instance with its own transport (CS/DC/RST/BUSY pins on
+ * the shared SPI bus) and refresh state. The epd_7in3e_* functions without a
+ * panel argument operate on the default panel wired to the EPD_PIN_* pins.
  */
 
 #include "epd_7in3e.h"
-#include "driver/spi_master.h"
-#include "driver/gpio.h"
+#include "epd_transport.h"
 #include "esp_log.h"
-#include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <stdlib.h>
 
 static const char *TAG = "EPD_7IN3E";
 
-// Yield to other tasks periodically to prevent watchdog timeout
-// Call this every N iterations during long loops
-// Using vTaskDelay(1) ensures proper watchdog feeding
-#define EPD_YIELD_INTERVAL 4000
-static inline void epd_yield_if_needed(uint32_t counter) {
-    if ((counter % EPD_YIELD_INTERVAL) == 0) {
-        vTaskDelay(1);  // Minimum delay to feed watchdog and yield to other tasks
-    }
-}
+struct epd_7in3e_panel {
+    epd_transport_t *transport;
+    bool transport_owned;           // Created here (vs. epd_7in3e_set_transport)
+
+    // Asynchronous refresh: DISPLAY_REFRESH issued, POWER_OFF still outstanding
+    bool refresh_pending;
+    bool stream_active;             // Caller-driven data phase in progress
+    size_t stream_col;              // Byte position within the current row
+    int64_t refresh_start_us;
+    int64_t refresh_sleep_start_us;
+};
 
-static spi_device_handle_t spi_handle = NULL;
+// Default panel; its transport is created by epd_7in3e_init_hw()
+static epd_7in3e_panel_t default_panel = {0};
 
 // Delay helper
 static void epd_delay_ms(uint32_t ms) {
     vTaskDelay(pdMS_TO_TICKS(ms));
 }
 
-// GPIO write helper
-static void epd_gpio_write(gpio_num_t pin, uint32_t level) {
-    gpio_set_level(pin, level);
+// Hardware reset
+static void epd_reset(epd_7in3e_panel_t *p) {
+    p->transport->ops->reset(p->transport);
 }
 
-// GPIO read helper
-static int epd_gpio_read(gpio_num_t pin) {
-    return gpio_get_level(pin);
+// Send command
+static void epd_send_command(epd_7in3e_panel_t *p, uint8_t cmd) {
+    p->transport->ops->command(p->transport, cmd);
 }
 
-// SPI write byte
-static void epd_spi_write_byte(uint8_t data) {
-    spi_transaction_t t = {
-        .length = 8,
-        .tx_buffer = &data,
-    };
-    spi_device_transmit(spi_handle, &t);
+// Send data byte
+static void epd_send_data(epd_7in3e_panel_t *p, uint8_t data) {
+    p->transport->ops->data(p->transport, &data, 1);
 }
 
-// Hardware reset
-static void epd_reset(void) {
-    epd_gpio_write(EPD_PIN_RST, 1);
-    epd_delay_ms(20);
-    epd_gpio_write(EPD_PIN_RST, 0);
-    epd_delay_ms(2);
-    epd_gpio_write(EPD_PIN_RST, 1);
-    epd_delay_ms(20);
+// Select the controllers for the following transfers (two-controller panels)
+static void epd_set_target(epd_7in3e_panel_t *p, epd_target_t target) {
+    if (p->transport->ops->set_target != NULL) {
+        p->transport->ops->set_target(p->transport, target);
+    }
 }
 
-// Send command
-static void epd_send_command(uint8_t cmd) {
-    epd_gpio_write(EPD_PIN_DC, 0);
-    epd_gpio_write(EPD_PIN_CS, 0);
-    epd_spi_write_byte(cmd);
-    epd_gpio_write(EPD_PIN_CS, 1);
+// Wait up to timeout_ms for busy pin to go HIGH (idle)
+static esp_err_t epd_wait_busy_timeout(epd_7in3e_panel_t *p, uint32_t timeout_ms) {
+    return p->transport->ops->wait_busy(p->transport, timeout_ms);
 }
 
-// Send data byte
-static void epd_send_data(uint8_t data) {
-    epd_gpio_write(EPD_PIN_DC, 1);
-    epd_gpio_write(EPD_PIN_CS, 0);
-    epd_spi_write_byte(data);
-    epd_gpio_write(EPD_PIN_CS, 1);
-}
-
-// Wait for busy pin to go HIGH (idle)
-static void epd_wait_busy(void) {
-    ESP_LOGI(TAG, "Waiting for display...");
-    while (epd_gpio_read(EPD_PIN_BUSY) == 0) {
-        epd_delay_ms(10);
+// Wait for busy pin to go HIGH (idle) with the default timeout
+static esp_err_t epd_wait_busy(epd_7in3e_panel_t *p) {
+    return epd_wait_busy_timeout(p, EPD_BUSY_TIMEOUT_MS);
+}
+
+// Run a command sequence from the panel descriptor (see epd_panel.h)
+static void epd_run_sequence(epd_7in3e_panel_t *p, const uint8_t *seq, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        uint8_t op = seq[i++];
+        switch (op) {
+        case EPD_SEQ_CMD:
+        case EPD_SEQ_CMD_M:
+        case EPD_SEQ_CMD_S: {
+            uint8_t cmd = seq[i];
+            uint8_t n = seq[i + 1];
+            i += 2;
+            epd_set_target(p, op == EPD_SEQ_CMD_M ? EPD_TARGET_PRIMARY :
+                              op == EPD_SEQ_CMD_S ? EPD_TARGET_SECONDARY : EPD_TARGET_ALL);
+            epd_send_command(p, cmd);
+            if (n > 0) {
+                p->transport->ops->data(p->transport, &seq[i], n);
+            }
+            i += n;
+            break;
+        }
+        case EPD_SEQ_WAIT:
+            epd_wait_busy(p);
+            break;
+        case EPD_SEQ_DELAY:
+            epd_delay_ms(seq[i++]);
+            break;
+        default:
+            ESP_LOGE(TAG, "Bad command sequence entry 0x%02X at %u", op, (unsigned)(i - 1));
+            i = len;
+            break;
+        }
     }
-    ESP_LOGI(TAG, "Display ready");
+    epd_set_target(p, EPD_TARGET_ALL);
+}
+
+// Power on and issue DISPLAY_REFRESH without waiting for it to finish
+static void epd_start_refresh(epd_7in3e_panel_t *p) {
+    p->refresh_start_us = esp_timer_get_time();
+    p->refresh_sleep_start_us = p->transport->stats.light_sleep_us;
+
+    epd_run_sequence(p, epd_panel_desc.refresh, epd_panel_desc.refresh_len);
+    p->refresh_pending = true;
+}
+
+// Wait for DISPLAY_REFRESH to complete and power off
+static esp_err_t epd_finish_refresh(epd_7in3e_panel_t *p, uint32_t timeout_ms) {
+    if (!p->refresh_pending) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = epd_wait_busy_timeout(p, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;  // Still refreshing; caller may wait again
+    }
+    p->refresh_pending = false;
+
+    epd_send_command(p, EPD_CMD_POWER_OFF);
+    epd_send_data(p, 0x00);
+    epd_wait_busy(p);
+
+    ESP_LOGI(TAG, "Refresh took %lld ms, %lld ms in light sleep",
+             (long long)((esp_timer_get_time() - p->refresh_start_us) / 1000),
+             (long long)((p->transport->stats.light_sleep_us - p->refresh_sleep_start_us) / 1000));
+    return ESP_OK;
 }
 
 // Turn on display (refresh)
-static void epd_turn_on_display(void) {
-    epd_send_command(0x04);  // POWER_ON
-    epd_wait_busy();
+static void epd_turn_on_display(epd_7in3e_panel_t *p) {
+    epd_start_refresh(p);
+    epd_finish_refresh(p, EPD_BUSY_TIMEOUT_MS);
+}
 
-    // Second setting
-    epd_send_command(0x06);
-    epd_send_data(0x6F);
-    epd_send_data(0x1F);
-    epd_send_data(0x17);
-    epd_send_data(0x49);
+// Fill the whole frame with one byte value and refresh; with two
+// controllers both receive the same data in parallel
+static void epd_fill_and_refresh(epd_7in3e_panel_t *p, uint8_t data) {
+    epd_finish_refresh(p, EPD_BUSY_TIMEOUT_MS);
 
-    epd_send_command(0x12);  // DISPLAY_REFRESH
-    epd_send_data(0x00);
-    epd_wait_busy();
+    epd_send_command(p, EPD_CMD_DATA_START);
+    p->transport->ops->data_begin(p->transport);
+    p->transport->ops->data_fill(p->transport, data, EPD_PANEL_BUFFER_SIZE / EPD_PANEL_CONTROLLERS);
+    p->transport->ops->data_end(p->transport);
 
-    epd_send_command(0x02);  // POWER_OFF
-    epd_send_data(0x00);
-    epd_wait_busy();
+    epd_turn_on_display(p);
 }
 
-esp_err_t epd_7in3e_init_hw(void) {
-    ESP_LOGI(TAG, "Initializing e-Paper hardware...");
+static void epd_controller_init(epd_7in3e_panel_t *p) {
+    ESP_LOGI(TAG, "Initializing %s controller...", EPD_PANEL_NAME);
 
-    // Check if already initialized
-    if (spi_handle != NULL) {
-        ESP_LOGI(TAG, "e-Paper hardware already initialized");
-        return ESP_OK;
+    p->refresh_pending = false;  // Reset aborts any refresh in progress
+
+    epd_reset(p);
+    epd_wait_busy(p);
+    epd_run_sequence(p, epd_panel_desc.init, epd_panel_desc.init_len);
+
+    ESP_LOGI(TAG, "e-Paper display controller initialized");
+}
+
+/* ---------------------------------------------------------------------------
+ * Panel instances
+ * ------------------------------------------------------------------------- */
+
+esp_err_t epd_7in3e_panel_create(const epd_transport_pins_t *pins, epd_7in3e_panel_t **out) {
+    if (pins == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    // Configure GPIO pins
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << EPD_PIN_DC) | (1ULL << EPD_PIN_RST) | (1ULL << EPD_PIN_CS),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&io_conf);
-
-    // Configure BUSY pin as input
-    io_conf.pin_bit_mask = (1ULL << EPD_PIN_BUSY);
-    io_conf.mode = GPIO_MODE_INPUT;
-    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-    gpio_config(&io_conf);
-
-    // Set initial states
-    gpio_set_level(EPD_PIN_CS, 1);
-    gpio_set_level(EPD_PIN_DC, 0);
-    gpio_set_level(EPD_PIN_RST, 1);
-
-    // Configure SPI bus
-    spi_bus_config_t buscfg = {
-        .mosi_io_num = EPD_PIN_MOSI,
-        .miso_io_num = -1,  // Not used
-        .sclk_io_num = EPD_PIN_CLK,
-        .quadwp_io_num = -1,
-        .quadhd_io_num = -1,
-        .max_transfer_sz = 4096,
-    };
+    epd_7in3e_panel_t *p = calloc(1, sizeof(epd_7in3e_panel_t));
+    if (p == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
 
-    esp_err_t ret = spi_bus_initialize(EPD_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO);
+    esp_err_t ret = epd_transport_spi_create(pins, &p->transport);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
+        free(p);
         return ret;
     }
+    p->transport_owned = true;
 
-    // Configure SPI device
-    spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = EPD_SPI_SPEED_HZ,
-        .mode = 0,  // SPI mode 0 (CPOL=0, CPHA=0)
-        .spics_io_num = -1,  // We control CS manually
-        .queue_size = 1,
-    };
+    ret = p->transport->ops->init(p->transport);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize panel transport: %s", esp_err_to_name(ret));
+        epd_7in3e_panel_destroy(p);
+        return ret;
+    }
+
+    *out = p;
+    return ESP_OK;
+}
+
+void epd_7in3e_panel_destroy(epd_7in3e_panel_t *p) {
+    if (p == NULL) {
+        return;
+    }
+    if (p->transport != NULL && p->transport_owned) {
+        epd_transport_destroy(p->transport);
+    }
+    free(p);
+}
+
+void epd_7in3e_panel_init(epd_7in3e_panel_t *p) {
+    epd_controller_init(p);
+}
 
-    ret = spi_bus_add_device(EPD_SPI_HOST, &devcfg, &spi_handle);
+esp_err_t epd_7in3e_panel_stream_begin(epd_7in3e_panel_t *p) {
+    esp_err_t ret = epd_finish_refresh(p, EPD_BUSY_TIMEOUT_MS);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Previous refresh did not finish, frame not sent");
         return ret;
     }
 
-    ESP_LOGI(TAG, "e-Paper hardware initialized");
+    epd_send_command(p, EPD_CMD_DATA_START);
+    p->transport->ops->data_begin(p->transport);
+    p->stream_active = true;
+    p->stream_col = 0;
     return ESP_OK;
 }
 
-void epd_7in3e_init(void) {
-    ESP_LOGI(TAG, "Initializing e-Paper display controller...");
-
-    epd_reset();
-    epd_wait_busy();
-    epd_delay_ms(30);
-
-    epd_send_command(0xAA);  // CMDH
-    epd_send_data(0x49);
-    epd_send_data(0x55);
-    epd_send_data(0x20);
-    epd_send_data(0x08);
-    epd_send_data(0x09);
-    epd_send_data(0x18);
-
-    epd_send_command(0x01);
-    epd_send_data(0x3F);
-
-    epd_send_command(0x00);
-    epd_send_data(0x5F);
-    epd_send_data(0x69);
-
-    epd_send_command(0x03);
-    epd_send_data(0x00);
-    epd_send_data(0x54);
-    epd_send_data(0x00);
-    epd_send_data(0x44);
-
-    epd_send_command(0x05);
-    epd_send_data(0x40);
-    epd_send_data(0x1F);
-    epd_send_data(0x1F);
-    epd_send_data(0x2C);
-
-    epd_send_command(0x06);
-    epd_send_data(0x6F);
-    epd_send_data(0x1F);
-    epd_send_data(0x17);
-    epd_send_data(0x49);
-
-    epd_send_command(0x08);
-    epd_send_data(0x6F);
-    epd_send_data(0x1F);
-    epd_send_data(0x1F);
-    epd_send_data(0x22);
-
-    epd_send_command(0x30);
-    epd_send_data(0x03);
-
-    epd_send_command(0x50);
-    epd_send_data(0x3F);
-
-    epd_send_command(0x60);
-    epd_send_data(0x02);
-    epd_send_data(0x00);
-
-    epd_send_command(0x61);  // Resolution setting
-    epd_send_data(0x03);     // 800 = 0x320
-    epd_send_data(0x20);
-    epd_send_data(0x01);     // 480 = 0x1E0
-    epd_send_data(0xE0);
-
-    epd_send_command(0x84);
-    epd_send_data(0x01);
-
-    epd_send_command(0xE3);
-    epd_send_data(0x2F);
-
-    epd_send_command(0x04);  // Power on
-    epd_wait_busy();
+void epd_7in3e_panel_stream_write(epd_7in3e_panel_t *p, const uint8_t *data, size_t len) {
+    if (!p->stream_active || data == NULL) {
+        return;
+    }
+#if EPD_PANEL_CONTROLLERS > 1
+    // Each controller drives its own columns: split every row between them
+    while (len > 0) {
+        bool primary = p->stream_col < EPD_PANEL_CTRL_ROW_BYTES;
+        size_t end = primary ? EPD_PANEL_CTRL_ROW_BYTES : EPD_PANEL_ROW_BYTES;
+        size_t n = end - p->stream_col;
+        if (n > len) {
+            n = len;
+        }
+        epd_set_target(p, primary ? EPD_TARGET_PRIMARY : EPD_TARGET_SECONDARY);
+        p->transport->ops->data_write(p->transport, data, n);
+        p->stream_col = (p->stream_col + n) % EPD_PANEL_ROW_BYTES;
+        data += n;
+        len -= n;
+    }
+#else
+    p->transport->ops->data_write(p->transport, data, len);
+#endif
+}
 
-    ESP_LOGI(TAG, "e-Paper display controller initialized");
+esp_err_t epd_7in3e_panel_stream_end(epd_7in3e_panel_t *p) {
+    if (!p->stream_active) {
+        ESP_LOGE(TAG, "No frame stream in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->transport->ops->data_end(p->transport);
+    p->stream_active = false;
+    epd_set_target(p, EPD_TARGET_ALL);
+
+    epd_start_refresh(p);
+    ESP_LOGI(TAG, "Refresh started");
+    return ESP_OK;
 }
 
-void epd_7in3e_clear(uint8_t color) {
-    ESP_LOGI(TAG, "Clearing display with color 0x%X...", color);
+bool epd_7in3e_panel_is_busy(epd_7in3e_panel_t *p) {
+    return p->refresh_pending;
+}
 
-    uint16_t width = EPD_7IN3E_WIDTH / 2;  // 2 pixels per byte
-    uint16_t height = EPD_7IN3E_HEIGHT;
-    uint8_t data = (color << 4) | color;
+esp_err_t epd_7in3e_panel_wait_idle(epd_7in3e_panel_t *p, uint32_t timeout_ms) {
+    return epd_finish_refresh(p, timeout_ms);
+}
+
+esp_err_t epd_7in3e_panel_wait_idle_all(epd_7in3e_panel_t *const *panels, size_t count,
+                                        uint32_t timeout_ms) {
+    // The refreshes run concurrently in the panels, so waiting on each in turn
+    // against one shared deadline costs about one refresh in total
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    esp_err_t result = ESP_OK;
+
+    for (size_t i = 0; i < count; i++) {
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        uint32_t left_ms = (left_us > 0) ? (uint32_t)(left_us / 1000) : 0;
+
+        esp_err_t ret = epd_finish_refresh(panels[i], left_ms);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Panel %u did not finish refreshing", (unsigned)i);
+            result = ret;
+        }
+    }
+    return result;
+}
+
+void epd_7in3e_panel_set_light_sleep(epd_7in3e_panel_t *p, bool enable) {
+    p->transport->ops->set_light_sleep(p->transport, enable);
+}
+
+void epd_7in3e_panel_sleep(epd_7in3e_panel_t *p) {
+    ESP_LOGI(TAG, "Putting display to sleep...");
+    epd_finish_refresh(p, EPD_BUSY_TIMEOUT_MS);
+
+    epd_send_command(p, EPD_CMD_POWER_OFF);
+    epd_send_data(p, 0x00);
+    epd_wait_busy(p);
+
+    epd_send_command(p, EPD_CMD_DEEP_SLEEP);
+    epd_send_data(p, 0xA5);
+
+    ESP_LOGI(TAG, "Display in sleep mode");
+}
+
+/* ---------------------------------------------------------------------------
+ * Default panel
+ * ------------------------------------------------------------------------- */
+
+esp_err_t epd_7in3e_init_hw(void) {
+    ESP_LOGI(TAG, "Initializing e-Paper hardware...");
+    epd_7in3e_panel_t *p = &default_panel;
+
+    if (p->transport == NULL) {
+        const epd_transport_pins_t pins = {
+            .cs = EPD_PIN_CS,
+            .dc = EPD_PIN_DC,
+            .rst = EPD_PIN_RST,
+            .busy = EPD_PIN_BUSY,
+            .cs_secondary = EPD_PIN_CS_S,
+        };
+        esp_err_t ret = epd_transport_spi_create(&pins, &p->transport);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create SPI transport: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        p->transport_owned = true;
+    }
+
+    esp_err_t ret = p->transport->ops->init(p->transport);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize transport: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "e-Paper hardware initialized");
+    return ESP_OK;
+}
+
+epd_7in3e_panel_t *epd_7in3e_default_panel(void) {
+    return &default_panel;
+}
+
+void epd_7in3e_set_transport(epd_transport_t *t) {
+    epd_7in3e_panel_t *p = &default_panel;
+    if (p->transport != NULL && p->transport_owned) {
+        epd_transport_destroy(p->transport);
+    }
+    p->transport = t;
+    p->transport_owned = false;
+}
+
+epd_transport_t *epd_7in3e_get_transport(void) {
+    return default_panel.transport;
+}
 
-    epd_send_command(0x10);  // Data start
-    for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
-        epd_send_data(data);
-        epd_yield_if_needed(i);
+void epd_7in3e_set_light_sleep(bool enable) {
+    if (default_panel.transport != NULL) {
+        epd_7in3e_panel_set_light_sleep(&default_panel, enable);
     }
+    ESP_LOGI(TAG, "Light sleep during BUSY wait: %s", enable ? "enabled" : "disabled");
+}
+
+void epd_7in3e_init(void) {
+    epd_controller_init(&default_panel);
+}
 
-    epd_turn_on_display();
+void epd_7in3e_clear(uint8_t color) {
+    ESP_LOGI(TAG, "Clearing display with color 0x%X...", color);
+    epd_fill_and_refresh(&default_panel, (color << 4) | color);
     ESP_LOGI(TAG, "Display cleared");
 }
 
 void epd_7in3e_display(const uint8_t *image) {
+    if (epd_7in3e_display_async(image) != ESP_OK) {
+        return;
+    }
+    epd_finish_refresh(&default_panel, EPD_BUSY_TIMEOUT_MS);
+    ESP_LOGI(TAG, "Image displayed");
+}
+
+esp_err_t epd_7in3e_display_async(const uint8_t *image) {
     if (image == NULL) {
         ESP_LOGE(TAG, "Image buffer is NULL");
-        return;
+        return ESP_ERR_INVALID_ARG;
     }
 
     ESP_LOGI(TAG, "Displaying image...");
+    esp_err_t ret = epd_7in3e_panel_stream_begin(&default_panel);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    epd_7in3e_panel_stream_write(&default_panel, image, EPD_7IN3E_BUFFER_SIZE);
+    return epd_7in3e_panel_stream_end(&default_panel);
+}
 
-    uint16_t width = EPD_7IN3E_WIDTH / 2;
-    uint16_t height = EPD_7IN3E_HEIGHT;
+esp_err_t epd_7in3e_stream_begin(void) {
+    return epd_7in3e_panel_stream_begin(&default_panel);
+}
 
-    epd_send_command(0x10);
-    for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
-        epd_send_data(image[i]);
-        epd_yield_if_needed(i);
-    }
+void epd_7in3e_stream_write(const uint8_t *data, size_t len) {
+    epd_7in3e_panel_stream_write(&default_panel, data, len);
+}
 
-    epd_turn_on_display();
-    ESP_LOGI(TAG, "Image displayed");
+esp_err_t epd_7in3e_stream_end(void) {
+    return epd_7in3e_panel_stream_end(&default_panel);
+}
+
+bool epd_7in3e_is_busy(void) {
+    return epd_7in3e_panel_is_busy(&default_panel);
+}
+
+esp_err_t epd_7in3e_wait_idle(uint32_t timeout_ms) {
+    return epd_finish_refresh(&default_panel, timeout_ms);
 }
 
 void epd_7in3e_show_color_blocks(void) {
     ESP_LOGI(TAG, "Showing color test blocks...");
+    epd_7in3e_panel_t *p = &default_panel;
+    epd_finish_refresh(p, EPD_BUSY_TIMEOUT_MS);
 
     const uint8_t colors[6] = {
         EPD_7IN3E_BLACK, EPD_7IN3E_WHITE, EPD_7IN3E_YELLOW,
         EPD_7IN3E_RED, EPD_7IN3E_BLUE, EPD_7IN3E_GREEN
     };
 
-    epd_send_command(0x10);
+    epd_send_command(p, EPD_CMD_DATA_START);
+    p->transport->ops->data_begin(p->transport);
 
-    // Each color block: 800/2 * 480/6 = 400 * 80 = 32000 bytes
-    uint32_t counter = 0;
+    // Six horizontal bands; two controllers receive the same bands in parallel
     for (int c = 0; c < 6; c++) {
         uint8_t data = (colors[c] << 4) | colors[c];
-        for (uint32_t i = 0; i < 32000; i++) {
-            epd_send_data(data);
-            epd_yield_if_needed(counter++);
-        }
+        p->transport->ops->data_fill(p->transport, data,
+                                     EPD_PANEL_BUFFER_SIZE / EPD_PANEL_CONTROLLERS / 6);
     }
 
-    epd_turn_on_display();
+    p->transport->ops->data_end(p->transport);
+
+    epd_turn_on_display(p);
     ESP_LOGI(TAG, "Color blocks displayed");
 }
 
 void epd_7in3e_sleep(void) {
-    ESP_LOGI(TAG, "Putting display to sleep...");
-
-    epd_send_command(0x02);  // Power off
-    epd_send_data(0x00);
-    epd_wait_busy();
-
-    epd_send_command(0x07);  // Deep sleep
-    epd_send_data(0xA5);
-
-    ESP_LOGI(TAG, "Display in sleep mode");
+    epd_7in3e_panel_sleep(&default_panel);
 }
 
 void epd_7in3e_deinit_hw(void) {
-    if (spi_handle != NULL) {
-        spi_bus_remove_device(spi_handle);
-        spi_handle = NULL;
+    epd_7in3e_panel_t *p = &default_panel;
+    if (p->transport != NULL) {
+        if (p->transport_owned) {
+            epd_transport_destroy(p->transport);
+            p->transport = NULL;
+        } else {
+            p->transport->ops->deinit(p->transport);
+        }
     }
-    spi_bus_free(EPD_SPI_HOST);
+    p->refresh_pending = false;
+    p->stream_active = false;
     ESP_LOGI(TAG, "e-Paper hardware deinitialized");
 }
-
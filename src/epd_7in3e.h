@@ -4,25 +4,33 @@
  * 
  * Based on Waveshare demo code, ported to ESP-IDF
  * Display: 800x480 pixels, 6 colors (Black, White, Yellow, Red, Blue, Green)
+ *
+ * Other Spectra 6 panels are selected at build time through EPD_PANEL
+ * (see epd_panel.h); the EPD_7IN3E_* geometry follows the selected panel.
  */
 
 #ifndef EPD_7IN3E_H
 #define EPD_7IN3E_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
+#include "epd_transport.h"
+#include "epd_panel.h"
 
 // Display resolution
-#define EPD_7IN3E_WIDTH       800
-#define EPD_7IN3E_HEIGHT      480
+#define EPD_7IN3E_WIDTH       EPD_PANEL_WIDTH
+#define EPD_7IN3E_HEIGHT      EPD_PANEL_HEIGHT
+#define EPD_7IN3E_BUFFER_SIZE EPD_PANEL_BUFFER_SIZE
 
 // Color definitions (4 bits per pixel, 2 pixels per byte)
-#define EPD_7IN3E_BLACK   0x0
-#define EPD_7IN3E_WHITE   0x1
-#define EPD_7IN3E_YELLOW  0x2
-#define EPD_7IN3E_RED     0x3
-#define EPD_7IN3E_BLUE    0x5
-#define EPD_7IN3E_GREEN   0x6
+#define EPD_7IN3E_BLACK   EPD_PANEL_BLACK
+#define EPD_7IN3E_WHITE   EPD_PANEL_WHITE
+#define EPD_7IN3E_YELLOW  EPD_PANEL_YELLOW
+#define EPD_7IN3E_RED     EPD_PANEL_RED
+#define EPD_7IN3E_BLUE    EPD_PANEL_BLUE
+#define EPD_7IN3E_GREEN   EPD_PANEL_GREEN
 
 // Pin configuration - adjust these to match your wiring
 #define EPD_PIN_MOSI      11
@@ -31,17 +39,150 @@
 #define EPD_PIN_DC        9
 #define EPD_PIN_RST       8
 #define EPD_PIN_BUSY      7
+#if EPD_PANEL_CONTROLLERS > 1
+#define EPD_PIN_CS_S      13   // CS of the second controller
+#else
+#define EPD_PIN_CS_S      -1
+#endif
 
 // SPI configuration
 #define EPD_SPI_HOST      SPI2_HOST
 #define EPD_SPI_SPEED_HZ  4000000  // 4 MHz
 
+// Frame data is sent in DMA chunks from internal-RAM bounce buffers
+#define EPD_DMA_CHUNK_SIZE   4096   // Bytes per transaction (= max_transfer_sz)
+#define EPD_DMA_CHUNK_COUNT  2      // Bounce buffers / queued transactions
+
+// Maximum time to wait for BUSY in any single phase (refresh takes ~20-30 s)
+#ifndef EPD_BUSY_TIMEOUT_MS
+#define EPD_BUSY_TIMEOUT_MS  60000
+#endif
+
+// Maximum number of panels driven from one MCU
+#define EPD_MAX_PANELS    4
+
+/**
+ * @brief One panel on the shared SPI bus
+ */
+typedef struct epd_7in3e_panel epd_7in3e_panel_t;
+
+/**
+ * @brief Create and initialize the hardware of an additional panel
+ * @param pins CS/DC/RST/BUSY pins of the panel (MOSI/CLK are shared); for
+ *             two-controller panels cs_secondary must be set, otherwise -1
+ * @param out Receives the panel handle
+ * @return ESP_OK on success
+ */
+esp_err_t epd_7in3e_panel_create(const epd_transport_pins_t *pins, epd_7in3e_panel_t **out);
+
+/**
+ * @brief Release a panel created by epd_7in3e_panel_create()
+ * @param p Panel (may be NULL)
+ */
+void epd_7in3e_panel_destroy(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Reset and initialize the panel controller
+ * @param p Panel
+ */
+void epd_7in3e_panel_init(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Start sending a frame to a panel (see epd_7in3e_stream_begin())
+ * @param p Panel
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the previous refresh is still running
+ */
+esp_err_t epd_7in3e_panel_stream_begin(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Append packed pixel data to the frame being streamed to a panel
+ * @param p Panel
+ * @param data Packed pixels (2 per byte), copied before the call returns
+ * @param len Number of bytes
+ */
+void epd_7in3e_panel_stream_write(epd_7in3e_panel_t *p, const uint8_t *data, size_t len);
+
+/**
+ * @brief Finish the frame stream and start the panel's refresh asynchronously
+ * @param p Panel
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no stream was started
+ */
+esp_err_t epd_7in3e_panel_stream_end(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Check whether a panel's asynchronous refresh is still outstanding
+ * @param p Panel
+ * @return true while refreshing
+ */
+bool epd_7in3e_panel_is_busy(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Wait for a panel's refresh to finish and power it off
+ * @param p Panel
+ * @param timeout_ms Maximum time to wait for BUSY
+ * @return ESP_OK when idle, ESP_ERR_TIMEOUT if still refreshing
+ */
+esp_err_t epd_7in3e_panel_wait_idle(epd_7in3e_panel_t *p, uint32_t timeout_ms);
+
+/**
+ * @brief Wait for several panels refreshing in parallel
+ * @param panels Panels to wait for
+ * @param count Number of panels
+ * @param timeout_ms Overall time limit shared by all panels
+ * @return ESP_OK if all finished, otherwise the last error
+ */
+esp_err_t epd_7in3e_panel_wait_idle_all(epd_7in3e_panel_t *const *panels, size_t count,
+                                        uint32_t timeout_ms);
+
+/**
+ * @brief Let the panel's BUSY waits use light sleep (see epd_7in3e_set_light_sleep())
+ * @param p Panel
+ * @param enable true to sleep while busy
+ */
+void epd_7in3e_panel_set_light_sleep(epd_7in3e_panel_t *p, bool enable);
+
+/**
+ * @brief Put a panel into deep sleep mode
+ * @param p Panel
+ */
+void epd_7in3e_panel_sleep(epd_7in3e_panel_t *p);
+
+/**
+ * @brief Get the default panel (EPD_PIN_* pins) used by the functions below
+ * @return Default panel; initialize it with epd_7in3e_init_hw() first
+ */
+epd_7in3e_panel_t *epd_7in3e_default_panel(void);
+
 /**
  * @brief Initialize the e-Paper display hardware (SPI and GPIO)
  * @return ESP_OK on success
  */
 esp_err_t epd_7in3e_init_hw(void);
 
+/**
+ * @brief Use a different transport for all following panel calls
+ *
+ * Must be called before epd_7in3e_init_hw(). The caller keeps ownership;
+ * epd_7in3e_deinit_hw() only deinitializes it.
+ * @param t Transport to use, or NULL to go back to the default SPI transport
+ */
+void epd_7in3e_set_transport(epd_transport_t *t);
+
+/**
+ * @brief Get the active transport (e.g. to read its statistics)
+ * @return Transport, or NULL before epd_7in3e_init_hw()
+ */
+epd_transport_t *epd_7in3e_get_transport(void);
+
+/**
+ * @brief Let BUSY waits put the CPU into light sleep
+ *
+ * Light sleep suspends every task, so only enable this once WiFi and the
+ * web server are no longer needed for the current wake cycle.
+ * @param enable true to sleep while the panel is busy, false to block on the BUSY interrupt
+ */
+void epd_7in3e_set_light_sleep(bool enable);
+
 /**
  * @brief Initialize the e-Paper display controller
  */
@@ -55,11 +196,60 @@ void epd_7in3e_clear(uint8_t color);
 
 /**
  * @brief Display image from buffer
- * @param image Pointer to image buffer (800x480/2 = 192000 bytes)
+ * @param image Pointer to image buffer (EPD_7IN3E_BUFFER_SIZE bytes)
  *              Each byte contains 2 pixels (4 bits each)
  */
 void epd_7in3e_display(const uint8_t *image);
 
+/**
+ * @brief Send an image and start the refresh without waiting for it
+ *
+ * Returns once the frame data is transferred and DISPLAY_REFRESH is issued;
+ * the image buffer may be freed immediately. Finish with epd_7in3e_wait_idle().
+ * Any other panel call waits for the pending refresh first.
+ * @param image Pointer to image buffer (EPD_7IN3E_BUFFER_SIZE bytes)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if image is NULL, ESP_ERR_TIMEOUT
+ *         if the previous refresh is still running
+ */
+esp_err_t epd_7in3e_display_async(const uint8_t *image);
+
+/**
+ * @brief Start sending a frame piecewise (DATA_START_TRANSMISSION)
+ *
+ * Follow with epd_7in3e_stream_write() calls totalling EPD_7IN3E_BUFFER_SIZE
+ * bytes in raster order, then epd_7in3e_stream_end(). Waits for a pending
+ * refresh first; if it does not finish in EPD_BUSY_TIMEOUT_MS nothing is
+ * sent, the writes are dropped and epd_7in3e_stream_end() fails.
+ * @return ESP_OK on success, ESP_ERR_TIMEOUT if the previous refresh is still running
+ */
+esp_err_t epd_7in3e_stream_begin(void);
+
+/**
+ * @brief Append packed pixel data to the frame being streamed
+ * @param data Packed pixels (2 per byte), copied before the call returns
+ * @param len Number of bytes
+ */
+void epd_7in3e_stream_write(const uint8_t *data, size_t len);
+
+/**
+ * @brief Finish the frame stream and start the refresh asynchronously
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if no stream was started
+ */
+esp_err_t epd_7in3e_stream_end(void);
+
+/**
+ * @brief Check whether an asynchronous refresh is still outstanding
+ * @return true between epd_7in3e_display_async() and a successful epd_7in3e_wait_idle()
+ */
+bool epd_7in3e_is_busy(void);
+
+/**
+ * @brief Wait for an asynchronous refresh to finish and power the panel off
+ * @param timeout_ms Maximum time to wait for BUSY
+ * @return ESP_OK when idle (or nothing pending), ESP_ERR_TIMEOUT if still refreshing
+ */
+esp_err_t epd_7in3e_wait_idle(uint32_t timeout_ms);
+
 /**
  * @brief Display a test pattern showing all 6 colors
  */
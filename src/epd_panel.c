@@ -0,0 +1,102 @@
+/**
+ * @file epd_panel.c
+ * @brief Controller command sequences for the panel selected by EPD_PANEL
+ *
+ * Sequences follow the Waveshare demo code for each panel.
+ */
+
+#include "epd_panel.h"
+
+#if EPD_PANEL == EPD_PANEL_7IN3E
+
+static const uint8_t init_seq[] = {
+    EPD_SEQ_DELAY, 30,
+    EPD_SEQ_CMD, 0xAA, 6, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18,  // CMDH
+    EPD_SEQ_CMD, 0x01, 1, 0x3F,
+    EPD_SEQ_CMD, 0x00, 2, 0x5F, 0x69,
+    EPD_SEQ_CMD, 0x03, 4, 0x00, 0x54, 0x00, 0x44,
+    EPD_SEQ_CMD, 0x05, 4, 0x40, 0x1F, 0x1F, 0x2C,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x08, 4, 0x6F, 0x1F, 0x1F, 0x22,
+    EPD_SEQ_CMD, 0x30, 1, 0x03,
+    EPD_SEQ_CMD, 0x50, 1, 0x3F,
+    EPD_SEQ_CMD, 0x60, 2, 0x02, 0x00,
+    EPD_SEQ_CMD, 0x61, 4, 0x03, 0x20, 0x01, 0xE0,              // Resolution 800x480
+    EPD_SEQ_CMD, 0x84, 1, 0x01,
+    EPD_SEQ_CMD, 0xE3, 1, 0x2F,
+    EPD_SEQ_CMD, 0x04, 0,                                      // Power on
+    EPD_SEQ_WAIT,
+};
+
+static const uint8_t refresh_seq[] = {
+    EPD_SEQ_CMD, 0x04, 0,                                      // Power on
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,              // Second setting
+    EPD_SEQ_CMD, 0x12, 1, 0x00,                                // Display refresh
+};
+
+#elif EPD_PANEL == EPD_PANEL_4IN0E
+
+static const uint8_t init_seq[] = {
+    EPD_SEQ_DELAY, 30,
+    EPD_SEQ_CMD, 0xAA, 6, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18,  // CMDH
+    EPD_SEQ_CMD, 0x01, 1, 0x3F,
+    EPD_SEQ_CMD, 0x00, 2, 0x5F, 0x69,
+    EPD_SEQ_CMD, 0x05, 4, 0x40, 0x1F, 0x1F, 0x2C,
+    EPD_SEQ_CMD, 0x08, 4, 0x6F, 0x1F, 0x1F, 0x22,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x17,
+    EPD_SEQ_CMD, 0x03, 4, 0x00, 0x54, 0x00, 0x44,
+    EPD_SEQ_CMD, 0x60, 2, 0x02, 0x00,
+    EPD_SEQ_CMD, 0x30, 1, 0x08,
+    EPD_SEQ_CMD, 0x50, 1, 0x3F,
+    EPD_SEQ_CMD, 0x61, 4, 0x01, 0x90, 0x02, 0x58,              // Resolution 400x600
+    EPD_SEQ_CMD, 0xE3, 1, 0x2F,
+    EPD_SEQ_CMD, 0x84, 1, 0x01,
+    EPD_SEQ_CMD, 0x04, 0,                                      // Power on
+    EPD_SEQ_WAIT,
+};
+
+static const uint8_t refresh_seq[] = {
+    EPD_SEQ_CMD, 0x04, 0,                                      // Power on
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,              // Second setting
+    EPD_SEQ_CMD, 0x12, 1, 0x00,                                // Display refresh
+};
+
+#elif EPD_PANEL == EPD_PANEL_13IN3E
+
+// No power on here, as in the demo code: the refresh sequence powers on
+static const uint8_t init_seq[] = {
+    EPD_SEQ_CMD_M, 0x74, 9, 0xC0, 0x1C, 0x1C, 0xCC, 0xCC, 0xCC, 0x15, 0x15, 0x55,  // AN_TM
+    EPD_SEQ_CMD, 0xF0, 6, 0x49, 0x55, 0x13, 0x5D, 0x05, 0x10,  // CMD66
+    EPD_SEQ_CMD, 0x00, 2, 0xDF, 0x69,                          // PSR
+    EPD_SEQ_CMD, 0x50, 1, 0xF7,                                // CDI
+    EPD_SEQ_CMD, 0x60, 2, 0x03, 0x03,                          // TCON
+    EPD_SEQ_CMD, 0x86, 1, 0x10,                                // AGID
+    EPD_SEQ_CMD, 0xE3, 1, 0x22,                                // PWS
+    EPD_SEQ_CMD, 0xE0, 1, 0x01,                                // CCSET
+    EPD_SEQ_CMD, 0x61, 4, 0x04, 0xB0, 0x03, 0x20,              // TRES
+    EPD_SEQ_CMD_M, 0x01, 6, 0x0F, 0x00, 0x28, 0x2C, 0x28, 0x38,  // PWR
+    EPD_SEQ_CMD_M, 0xB6, 1, 0x07,                              // EN_BUF
+    EPD_SEQ_CMD_M, 0x06, 2, 0xD8, 0x18,                        // BTST_P
+    EPD_SEQ_CMD_M, 0xB7, 1, 0x01,                              // BOOST_VDDP_EN
+    EPD_SEQ_CMD_M, 0x05, 2, 0xD8, 0x18,                        // BTST_N
+    EPD_SEQ_CMD_M, 0xB0, 1, 0x01,                              // BUCK_BOOST_VDDN
+    EPD_SEQ_CMD_M, 0xB1, 1, 0x02,                              // TFT_VCOM_POWER
+};
+
+static const uint8_t refresh_seq[] = {
+    EPD_SEQ_CMD, 0x04, 0,                                      // Power on
+    EPD_SEQ_WAIT,
+    EPD_SEQ_DELAY, 50,
+    EPD_SEQ_CMD, 0x12, 1, 0x00,                                // Display refresh
+};
+
+#endif
+
+const epd_panel_desc_t epd_panel_desc = {
+    .init = init_seq,
+    .init_len = sizeof(init_seq),
+    .refresh = refresh_seq,
+    .refresh_len = sizeof(refresh_seq),
+};
@@ -0,0 +1,108 @@
+/**
+ * @file epd_panel.h
+ * @brief Build-time panel descriptor for Waveshare Spectra 6 e-Paper panels
+ *
+ * The panel is selected with -DEPD_PANEL=EPD_PANEL_<model> (platformio.ini
+ * build_flags). Geometry and color codes are plain macros so the dither,
+ * pack and transfer loops are compiled for one fixed resolution; the
+ * controller command sequences are tables interpreted by the driver.
+ */
+
+#ifndef EPD_PANEL_H
+#define EPD_PANEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Supported panels
+#define EPD_PANEL_7IN3E   1   // 7.3"  800x480
+#define EPD_PANEL_4IN0E   2   // 4.0"  400x600
+#define EPD_PANEL_13IN3E  3   // 13.3" 1200x1600, two controllers
+
+#ifndef EPD_PANEL
+#define EPD_PANEL EPD_PANEL_7IN3E
+#endif
+
+#if EPD_PANEL == EPD_PANEL_7IN3E
+#define EPD_PANEL_NAME         "7.3inch e-Paper (E)"
+#define EPD_PANEL_WIDTH        800
+#define EPD_PANEL_HEIGHT       480
+#define EPD_PANEL_SIZE_STR     "800x480"
+#define EPD_PANEL_CONTROLLERS  1
+#elif EPD_PANEL == EPD_PANEL_4IN0E
+#define EPD_PANEL_NAME         "4inch e-Paper (E)"
+#define EPD_PANEL_WIDTH        400
+#define EPD_PANEL_HEIGHT       600
+#define EPD_PANEL_SIZE_STR     "400x600"
+#define EPD_PANEL_CONTROLLERS  1
+#elif EPD_PANEL == EPD_PANEL_13IN3E
+#define EPD_PANEL_NAME         "13.3inch e-Paper (E)"
+#define EPD_PANEL_WIDTH        1200
+#define EPD_PANEL_HEIGHT       1600
+#define EPD_PANEL_SIZE_STR     "1200x1600"
+#define EPD_PANEL_CONTROLLERS  2   // Left and right half, one CS each
+#else
+#error "Unknown EPD_PANEL"
+#endif
+
+// Frame layout (4 bits per pixel, 2 pixels per byte, raster order)
+#define EPD_PANEL_BPP          4
+#define EPD_PANEL_ROW_BYTES    (EPD_PANEL_WIDTH * EPD_PANEL_BPP / 8)
+#define EPD_PANEL_BUFFER_SIZE  (EPD_PANEL_ROW_BYTES * EPD_PANEL_HEIGHT)
+
+// Bytes of each row driven by one controller
+#define EPD_PANEL_CTRL_ROW_BYTES (EPD_PANEL_ROW_BYTES / EPD_PANEL_CONTROLLERS)
+
+// Color codes (shared by all Spectra 6 controllers)
+#define EPD_PANEL_BLACK   0x0
+#define EPD_PANEL_WHITE   0x1
+#define EPD_PANEL_YELLOW  0x2
+#define EPD_PANEL_RED     0x3
+#define EPD_PANEL_BLUE    0x5
+#define EPD_PANEL_GREEN   0x6
+
+// Dither palette: { R, G, B, color code }
+// Orange (code 4) is kept from the original 7-color palette
+#define EPD_PANEL_PALETTE_SIZE 7
+#define EPD_PANEL_PALETTE {                     \
+    {   0,   0,   0, EPD_PANEL_BLACK  },        \
+    { 255, 255, 255, EPD_PANEL_WHITE  },        \
+    { 255, 255,   0, EPD_PANEL_YELLOW },        \
+    { 255,   0,   0, EPD_PANEL_RED    },        \
+    { 255, 128,   0, 0x4              },        \
+    {   0,   0, 255, EPD_PANEL_BLUE   },        \
+    {   0, 255,   0, EPD_PANEL_GREEN  },        \
+}
+
+// Commands common to all panels
+#define EPD_CMD_POWER_OFF    0x02
+#define EPD_CMD_DEEP_SLEEP   0x07
+#define EPD_CMD_DATA_START   0x10
+
+/*
+ * Command sequence encoding, one entry after the other:
+ *   EPD_SEQ_CMD,   cmd, n, data[n]   command to all controllers
+ *   EPD_SEQ_CMD_M, cmd, n, data[n]   command to the first controller only
+ *   EPD_SEQ_CMD_S, cmd, n, data[n]   command to the second controller only
+ *   EPD_SEQ_WAIT                     wait for BUSY
+ *   EPD_SEQ_DELAY, ms                delay
+ */
+#define EPD_SEQ_CMD    0x01
+#define EPD_SEQ_CMD_M  0x02
+#define EPD_SEQ_CMD_S  0x03
+#define EPD_SEQ_WAIT   0x04
+#define EPD_SEQ_DELAY  0x05
+
+/**
+ * @brief Controller command sequences of the selected panel
+ */
+typedef struct {
+    const uint8_t *init;        // After hardware reset; may leave the panel powered on
+    size_t init_len;
+    const uint8_t *refresh;     // After the frame data; powers on, ends with DISPLAY_REFRESH issued
+    size_t refresh_len;
+} epd_panel_desc_t;
+
+extern const epd_panel_desc_t epd_panel_desc;
+
+#endif // EPD_PANEL_H
@@ -0,0 +1,101 @@
+/**
+ * @file epd_transport.h
+ * @brief Hardware abstraction for e-Paper controller I/O
+ *
+ * The panel driver only talks to the controller through this interface:
+ * command bytes, short parameter writes, a bulk data phase, hardware reset
+ * and the BUSY wait. The ESP-IDF SPI implementation lives in
+ * epd_transport_spi.c; other backends (e.g. a recorder or emulator) only
+ * need to provide an epd_transport_ops_t table.
+ */
+
+#ifndef EPD_TRANSPORT_H
+#define EPD_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef struct epd_transport epd_transport_t;
+
+/**
+ * @brief Counters maintained by every transport implementation
+ */
+typedef struct {
+    uint32_t commands;        // Command bytes sent
+    uint32_t data_bytes;      // Parameter and bulk data bytes sent
+    int64_t transfer_us;      // Time spent in bulk data phases
+    int64_t busy_us;          // Time spent waiting for BUSY
+    int64_t light_sleep_us;   // Part of busy_us spent in light sleep
+} epd_transport_stats_t;
+
+/**
+ * @brief Controllers addressed by the following transfers
+ *
+ * Panels with two controllers (EPD_PANEL_CONTROLLERS == 2) have one CS line
+ * per controller; commands and data go to the selected ones.
+ */
+typedef enum {
+    EPD_TARGET_ALL = 0,
+    EPD_TARGET_PRIMARY,
+    EPD_TARGET_SECONDARY,
+} epd_target_t;
+
+/**
+ * @brief Transport operations
+ */
+typedef struct {
+    esp_err_t (*init)(epd_transport_t *t);
+    void (*deinit)(epd_transport_t *t);
+    void (*reset)(epd_transport_t *t);
+    void (*command)(epd_transport_t *t, uint8_t cmd);
+    void (*data)(epd_transport_t *t, const uint8_t *data, size_t len);
+    void (*data_begin)(epd_transport_t *t);
+    void (*data_write)(epd_transport_t *t, const uint8_t *data, size_t len);
+    void (*data_fill)(epd_transport_t *t, uint8_t value, size_t len);
+    void (*data_end)(epd_transport_t *t);
+    esp_err_t (*wait_busy)(epd_transport_t *t, uint32_t timeout_ms);
+    void (*set_light_sleep)(epd_transport_t *t, bool enable);
+    void (*set_target)(epd_transport_t *t, epd_target_t target);  // Optional, may switch inside a data phase
+} epd_transport_ops_t;
+
+/**
+ * @brief Transport instance
+ */
+struct epd_transport {
+    const epd_transport_ops_t *ops;
+    void *ctx;                      // Implementation state
+    epd_transport_stats_t stats;
+};
+
+/**
+ * @brief Control pins of one panel on the shared SPI bus
+ */
+typedef struct {
+    int cs;
+    int dc;
+    int rst;
+    int busy;
+    int cs_secondary;   // CS of the second controller, -1 if the panel has one
+} epd_transport_pins_t;
+
+/**
+ * @brief Create an SPI transport for one panel
+ *
+ * The SPI bus (EPD_PIN_MOSI / EPD_PIN_CLK) is initialized by the first
+ * instance and shared with later ones; each instance holds the bus for the
+ * whole time its CS is asserted.
+ * @param pins Control pins of the panel
+ * @param out Receives the new transport (call ops->init before use)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if allocation fails
+ */
+esp_err_t epd_transport_spi_create(const epd_transport_pins_t *pins, epd_transport_t **out);
+
+/**
+ * @brief Deinitialize and free a transport created by a *_create function
+ * @param t Transport (may be NULL)
+ */
+void epd_transport_destroy(epd_transport_t *t);
+
+#endif // EPD_TRANSPORT_H
@@ -0,0 +1,504 @@
+/**
+ * @file epd_transport_emu.c
+ * @brief Emulated e-Paper controller for host builds
+ *
+ * Each controller has its own RAM of EPD_PANEL_CTRL_ROW_BYTES per row and
+ * a write position that DATA_START resets; frame data goes to the
+ * controllers selected with set_target. DISPLAY_REFRESH interleaves the
+ * rows of both RAMs into the shown frame. Like the SPI transport, the
+ * buffers are allocated by init and released by deinit.
+ */
+
+#include "epd_transport_emu.h"
+#include "epd_panel.h"
+#include "png_stream.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "EPD_EMU";
+
+#define EMU_CTRL_RAM_SIZE (EPD_PANEL_CTRL_ROW_BYTES * EPD_PANEL_HEIGHT)
+#define EMU_CMD_POWER_ON  0x04
+#define EMU_CMD_REFRESH   0x12
+
+typedef struct {
+    epd_emu_config_t cfg;
+    epd_emu_stats_t stats;
+    struct timespec wall_start;
+
+    // Controller state
+    epd_target_t target;
+    uint8_t *ram[EPD_PANEL_CONTROLLERS];
+    size_t ram_pos[EPD_PANEL_CONTROLLERS];
+    uint8_t *shown;                 // Latched by DISPLAY_REFRESH
+    bool have_frame;
+    bool powered;
+    bool asleep;                    // DEEP_SLEEP until the next reset
+    int64_t busy_until_us;
+    int last_cmd;                   // -1 before the first command
+    bool in_data;
+    int64_t data_start_us;
+    uint64_t wire_ns;               // Transfer time not yet spent
+
+    // Command trace
+    uint8_t *trace;
+    size_t trace_len;
+    size_t trace_cap;
+    size_t trace_n;                 // Index of the parameter count of the last command
+} emu_t;
+
+static void emu_error(emu_t *e, const char *fmt, ...) {
+    e->stats.errors++;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(e->stats.last_error, sizeof(e->stats.last_error), fmt, ap);
+    va_end(ap);
+    ESP_LOGE(TAG, "%s", e->stats.last_error);
+}
+
+static void trace_add(emu_t *e, const uint8_t *data, size_t len) {
+    if (e->trace_len + len > e->trace_cap) {
+        size_t cap = e->trace_cap ? e->trace_cap * 2 : 256;
+        while (cap < e->trace_len + len) {
+            cap *= 2;
+        }
+        uint8_t *trace = realloc(e->trace, cap);
+        if (trace == NULL) {
+            emu_error(e, "trace out of memory");
+            return;
+        }
+        e->trace = trace;
+        e->trace_cap = cap;
+    }
+    memcpy(e->trace + e->trace_len, data, len);
+    e->trace_len += len;
+}
+
+// Controllers addressed by the current target (bit per controller)
+static unsigned emu_targets(emu_t *e) {
+    switch (e->target) {
+    case EPD_TARGET_PRIMARY:
+        return 1;
+    case EPD_TARGET_SECONDARY:
+        return EPD_PANEL_CONTROLLERS > 1 ? 2 : 0;
+    default:
+        return (1u << EPD_PANEL_CONTROLLERS) - 1;
+    }
+}
+
+static bool emu_busy(emu_t *e) {
+    return esp_timer_get_time() < e->busy_until_us;
+}
+
+static void emu_busy_for(emu_t *e, uint32_t ms) {
+    e->busy_until_us = esp_timer_get_time() + (int64_t)ms * 1000;
+}
+
+// Let the bus time of len bytes pass
+static void emu_wire(emu_t *e, size_t len) {
+    if (e->cfg.spi_hz == 0) {
+        return;
+    }
+    e->wire_ns += (uint64_t)len * 8 * 1000000000ULL / e->cfg.spi_hz;
+    if (e->wire_ns >= 1000000) {
+        vTaskDelay(pdMS_TO_TICKS(e->wire_ns / 1000000));
+        e->wire_ns %= 1000000;
+    }
+}
+
+// DISPLAY_REFRESH: show what the controllers hold
+static void emu_refresh(emu_t *e) {
+    if (e->shown == NULL) {
+        emu_error(e, "DISPLAY_REFRESH before init");
+        return;
+    }
+    if (!e->powered) {
+        emu_error(e, "DISPLAY_REFRESH while powered off");
+        return;
+    }
+    for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+        if (e->ram_pos[c] != EMU_CTRL_RAM_SIZE) {
+            emu_error(e, "controller %d refreshed with %u of %u frame bytes", c,
+                      (unsigned)e->ram_pos[c], (unsigned)EMU_CTRL_RAM_SIZE);
+        }
+    }
+    for (int row = 0; row < EPD_PANEL_HEIGHT; row++) {
+        for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+            memcpy(e->shown + (size_t)row * EPD_PANEL_ROW_BYTES + c * EPD_PANEL_CTRL_ROW_BYTES,
+                   e->ram[c] + (size_t)row * EPD_PANEL_CTRL_ROW_BYTES, EPD_PANEL_CTRL_ROW_BYTES);
+        }
+    }
+    e->have_frame = true;
+    e->stats.refreshes++;
+    emu_busy_for(e, e->cfg.refresh_ms);
+}
+
+// Store frame data (or len copies of fill if data is NULL) in the addressed RAMs
+static void emu_frame_data(emu_t *e, const uint8_t *data, uint8_t fill, size_t len) {
+    unsigned targets = emu_targets(e);
+    if (e->shown == NULL) {
+        emu_error(e, "frame data before init");
+        return;
+    }
+    if (targets == 0) {
+        emu_error(e, "frame data to a missing controller");
+        return;
+    }
+    for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+        if ((targets & (1u << c)) == 0) {
+            continue;
+        }
+        size_t n = EMU_CTRL_RAM_SIZE - e->ram_pos[c];
+        if (n > len) {
+            n = len;
+        }
+        if (data != NULL) {
+            memcpy(e->ram[c] + e->ram_pos[c], data, n);
+        } else {
+            memset(e->ram[c] + e->ram_pos[c], fill, n);
+        }
+        e->ram_pos[c] += n;
+        if (n < len) {
+            emu_error(e, "controller %d: %u frame bytes beyond its RAM", c, (unsigned)(len - n));
+        }
+    }
+    e->stats.frame_bytes += len;
+    emu_wire(e, len);
+}
+
+// Controller RAM and the shown frame; called again after emu_deinit
+static esp_err_t emu_init(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+
+    for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+        if (e->ram[c] == NULL) {
+            e->ram[c] = calloc(1, EMU_CTRL_RAM_SIZE);
+            if (e->ram[c] == NULL) {
+                t->ops->deinit(t);
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+    if (e->shown == NULL) {
+        e->shown = calloc(1, EPD_PANEL_BUFFER_SIZE);
+        if (e->shown == NULL) {
+            t->ops->deinit(t);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static void emu_deinit(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+
+    for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+        free(e->ram[c]);
+        e->ram[c] = NULL;
+        e->ram_pos[c] = 0;
+    }
+    free(e->shown);
+    e->shown = NULL;
+    e->have_frame = false;
+    free(e->trace);
+    e->trace = NULL;
+    e->trace_len = 0;
+    e->trace_cap = 0;
+}
+
+static void emu_reset(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+
+    vTaskDelay(pdMS_TO_TICKS(42));  // Same pulse as the SPI transport
+    e->stats.resets++;
+    e->powered = false;
+    e->asleep = false;
+    e->in_data = false;
+    e->last_cmd = -1;
+    emu_busy_for(e, e->cfg.reset_busy_ms);
+}
+
+static void emu_command(epd_transport_t *t, uint8_t cmd) {
+    emu_t *e = t->ctx;
+
+    if (e->asleep) {
+        emu_error(e, "command 0x%02X in deep sleep", cmd);
+        return;
+    }
+    if (emu_busy(e)) {
+        emu_error(e, "command 0x%02X while BUSY", cmd);
+    }
+    if (e->in_data) {
+        emu_error(e, "command 0x%02X inside a data phase", cmd);
+    }
+
+    uint8_t entry[3] = {
+        e->target == EPD_TARGET_PRIMARY ? EPD_SEQ_CMD_M :
+        e->target == EPD_TARGET_SECONDARY ? EPD_SEQ_CMD_S : EPD_SEQ_CMD,
+        cmd, 0,
+    };
+    trace_add(e, entry, sizeof(entry));
+    e->trace_n = e->trace_len - 1;
+
+    e->last_cmd = cmd;
+    e->stats.commands++;
+    e->stats.cmd_count[cmd]++;
+    t->stats.commands++;
+    emu_wire(e, 1);
+
+    switch (cmd) {
+    case EMU_CMD_POWER_ON:
+        e->powered = true;
+        emu_busy_for(e, e->cfg.power_on_ms);
+        break;
+    case EPD_CMD_POWER_OFF:
+        e->powered = false;
+        emu_busy_for(e, e->cfg.power_off_ms);
+        break;
+    case EMU_CMD_REFRESH:
+        emu_refresh(e);
+        break;
+    case EPD_CMD_DATA_START: {
+        unsigned targets = emu_targets(e);
+        for (int c = 0; c < EPD_PANEL_CONTROLLERS; c++) {
+            if (targets & (1u << c)) {
+                e->ram_pos[c] = 0;
+            }
+        }
+        break;
+    }
+    }
+}
+
+static void emu_data(epd_transport_t *t, const uint8_t *data, size_t len) {
+    emu_t *e = t->ctx;
+
+    t->stats.data_bytes += len;
+    if (e->asleep) {
+        return;
+    }
+    if (e->last_cmd < 0) {
+        emu_error(e, "%u data bytes without a command", (unsigned)len);
+        return;
+    }
+    if (e->last_cmd == EPD_CMD_DATA_START) {
+        emu_frame_data(e, data, 0, len);
+        return;
+    }
+
+    trace_add(e, data, len);
+    e->trace[e->trace_n] += (uint8_t)len;
+    e->stats.param_bytes += len;
+    emu_wire(e, len);
+    if (e->last_cmd == EPD_CMD_DEEP_SLEEP && len > 0 && data[0] == 0xA5) {
+        e->asleep = true;
+    }
+}
+
+static void emu_data_begin(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+
+    if (e->asleep) {
+        return;
+    }
+    if (e->last_cmd != EPD_CMD_DATA_START) {
+        emu_error(e, "data phase without DATA_START");
+    }
+    e->in_data = true;
+    e->data_start_us = esp_timer_get_time();
+}
+
+static void emu_data_write(epd_transport_t *t, const uint8_t *data, size_t len) {
+    emu_t *e = t->ctx;
+
+    if (e->asleep) {
+        return;
+    }
+    if (!e->in_data) {
+        emu_error(e, "data_write outside a data phase");
+        return;
+    }
+    t->stats.data_bytes += len;
+    emu_frame_data(e, data, 0, len);
+}
+
+static void emu_data_fill(epd_transport_t *t, uint8_t value, size_t len) {
+    emu_t *e = t->ctx;
+
+    if (e->asleep) {
+        return;
+    }
+    if (!e->in_data) {
+        emu_error(e, "data_fill outside a data phase");
+        return;
+    }
+    t->stats.data_bytes += len;
+    emu_frame_data(e, NULL, value, len);
+}
+
+static void emu_data_end(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+
+    if (e->asleep) {
+        return;
+    }
+    if (!e->in_data) {
+        emu_error(e, "data_end outside a data phase");
+        return;
+    }
+    e->in_data = false;
+    t->stats.transfer_us += esp_timer_get_time() - e->data_start_us;
+}
+
+static esp_err_t emu_wait_busy(epd_transport_t *t, uint32_t timeout_ms) {
+    emu_t *e = t->ctx;
+
+    const uint8_t wait = EPD_SEQ_WAIT;
+    trace_add(e, &wait, 1);
+    e->stats.busy_waits++;
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t left_us = e->busy_until_us - start_us;
+    esp_err_t ret = ESP_OK;
+    if (left_us > (int64_t)timeout_ms * 1000) {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+        e->stats.busy_timeouts++;
+        ret = ESP_ERR_TIMEOUT;
+    } else if (left_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS((left_us + 999) / 1000));
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    e->stats.busy_wait_us += elapsed_us;
+    t->stats.busy_us += elapsed_us;
+    return ret;
+}
+
+static void emu_set_light_sleep(epd_transport_t *t, bool enable) {
+}
+
+static void emu_set_target(epd_transport_t *t, epd_target_t target) {
+    emu_t *e = t->ctx;
+    e->target = target;
+}
+
+static const epd_transport_ops_t emu_ops = {
+    .init = emu_init,
+    .deinit = emu_deinit,
+    .reset = emu_reset,
+    .command = emu_command,
+    .data = emu_data,
+    .data_begin = emu_data_begin,
+    .data_write = emu_data_write,
+    .data_fill = emu_data_fill,
+    .data_end = emu_data_end,
+    .wait_busy = emu_wait_busy,
+    .set_light_sleep = emu_set_light_sleep,
+    .set_target = emu_set_target,
+};
+
+esp_err_t epd_transport_emu_create(const epd_emu_config_t *cfg, epd_transport_t **out) {
+    static const epd_emu_config_t defaults = EPD_EMU_CONFIG_DEFAULT;
+
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    epd_transport_t *t = calloc(1, sizeof(epd_transport_t));
+    emu_t *e = calloc(1, sizeof(emu_t));
+    if (t == NULL || e == NULL) {
+        free(t);
+        free(e);
+        return ESP_ERR_NO_MEM;
+    }
+
+    e->cfg = cfg != NULL ? *cfg : defaults;
+    e->last_cmd = -1;
+    clock_gettime(CLOCK_MONOTONIC, &e->wall_start);
+    t->ops = &emu_ops;
+    t->ctx = e;
+    *out = t;
+    return ESP_OK;
+}
+
+const uint8_t *epd_transport_emu_frame(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+    return e->have_frame ? e->shown : NULL;
+}
+
+static bool png_write_file(const uint8_t *data, size_t len, void *ctx) {
+    return fwrite(data, 1, len, ctx) == len;
+}
+
+esp_err_t epd_transport_emu_write_png(epd_transport_t *t, const char *path) {
+    static const uint8_t colors[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+    emu_t *e = t->ctx;
+
+    if (!e->have_frame) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t palette[16][3];
+    for (int i = 0; i < 16; i++) {
+        palette[i][0] = 255;
+        palette[i][1] = 0;
+        palette[i][2] = 255;
+    }
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        memcpy(palette[colors[i][3]], colors[i], 3);
+    }
+
+    FILE *f = fopen(path, "wb");
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    bool ok = f != NULL && comp != NULL && ps != NULL &&
+              png_stream_begin(ps, comp, EPD_PANEL_WIDTH, EPD_PANEL_HEIGHT, EPD_PANEL_BPP,
+                               (const uint8_t (*)[3])palette, 16, png_write_file, f);
+    for (int row = 0; ok && row < EPD_PANEL_HEIGHT; row++) {
+        ok = png_stream_row(ps, e->shown + (size_t)row * EPD_PANEL_ROW_BYTES);
+    }
+    ok = ok && png_stream_end(ps);
+    free(ps);
+    free(comp);
+    if (f != NULL && fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write %s", path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+const uint8_t *epd_transport_emu_trace(epd_transport_t *t, size_t *len) {
+    emu_t *e = t->ctx;
+    *len = e->trace_len;
+    return e->trace;
+}
+
+void epd_transport_emu_clear_trace(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+    e->trace_len = 0;
+}
+
+const epd_emu_stats_t *epd_transport_emu_stats(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    e->stats.wall_us = (int64_t)(now.tv_sec - e->wall_start.tv_sec) * 1000000 +
+                       (now.tv_nsec - e->wall_start.tv_nsec) / 1000;
+    return &e->stats;
+}
+
+void epd_transport_emu_reset_stats(epd_transport_t *t) {
+    emu_t *e = t->ctx;
+    memset(&e->stats, 0, sizeof(e->stats));
+    clock_gettime(CLOCK_MONOTONIC, &e->wall_start);
+}
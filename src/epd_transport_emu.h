@@ -0,0 +1,122 @@
+/**
+ * @file epd_transport_emu.h
+ * @brief Emulated e-Paper controller for host builds
+ *
+ * A transport that behaves like the panel instead of driving pins: frame
+ * data after DATA_START (0x10) lands in the controller RAM (one per
+ * controller, each receiving its half of every row), DISPLAY_REFRESH (0x12)
+ * latches it as the visible frame, and BUSY stays low for the configured
+ * time after reset, POWER_ON, DISPLAY_REFRESH and POWER_OFF. BUSY waits
+ * pass on the FreeRTOS clock, so on the host (where it is virtual) a full
+ * refresh takes no real time.
+ *
+ * The commands are recorded in the epd_panel.h sequence encoding, so a
+ * trace can be compared with the panel descriptor; frame data is not
+ * recorded. Protocol errors (a command while BUSY, a refresh without power,
+ * frame data overflowing the controller RAM, ...) are counted.
+ *
+ * Not part of the firmware build (see tests/CMakeLists.txt).
+ */
+
+#ifndef EPD_TRANSPORT_EMU_H
+#define EPD_TRANSPORT_EMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "epd_transport.h"
+
+/**
+ * @brief BUSY timing and bus speed of the emulated panel
+ */
+typedef struct {
+    uint32_t reset_busy_ms;     // BUSY low after a hardware reset
+    uint32_t power_on_ms;       // ... after POWER_ON (0x04)
+    uint32_t refresh_ms;        // ... after DISPLAY_REFRESH (0x12)
+    uint32_t power_off_ms;      // ... after POWER_OFF (0x02)
+    uint32_t spi_hz;            // Bus clock for the transfer time, 0 = instant
+} epd_emu_config_t;
+
+// Timing close to the 7.3" panel
+#define EPD_EMU_CONFIG_DEFAULT { \
+    .reset_busy_ms = 10,         \
+    .power_on_ms = 60,           \
+    .refresh_ms = 19000,         \
+    .power_off_ms = 30,          \
+    .spi_hz = 4000000,           \
+}
+
+/**
+ * @brief What the emulated panel received
+ */
+typedef struct {
+    uint32_t resets;
+    uint32_t commands;          // Command bytes (a command to both controllers counts once)
+    uint32_t cmd_count[256];    // Per command byte
+    uint32_t param_bytes;       // Parameter bytes after commands other than DATA_START
+    uint32_t frame_bytes;       // Frame data bytes sent (a byte to both controllers counts once)
+    uint32_t refreshes;         // DISPLAY_REFRESH commands
+    uint32_t busy_waits;        // wait_busy calls
+    uint32_t busy_timeouts;     // ... that ran out of time
+    int64_t busy_wait_us;       // Time spent in wait_busy (FreeRTOS clock)
+    int64_t wall_us;            // Real time since creation or the last stats reset
+    uint32_t errors;            // Protocol errors, see last_error
+    char last_error[96];
+} epd_emu_stats_t;
+
+/**
+ * @brief Create an emulator transport
+ * @param cfg Timing (NULL for EPD_EMU_CONFIG_DEFAULT)
+ * @param out Receives the transport (call ops->init before use, free with
+ *            epd_transport_destroy())
+ * @return ESP_OK, or ESP_ERR_NO_MEM
+ */
+esp_err_t epd_transport_emu_create(const epd_emu_config_t *cfg, epd_transport_t **out);
+
+/**
+ * @brief Frame shown by the last DISPLAY_REFRESH
+ * @param t Emulator transport
+ * @return Packed frame (EPD_PANEL_BUFFER_SIZE bytes), NULL before the first refresh
+ */
+const uint8_t *epd_transport_emu_frame(epd_transport_t *t);
+
+/**
+ * @brief Write the shown frame as a PNG in the panel colors
+ *
+ * Pixel codes without a palette color come out magenta.
+ * @param t Emulator transport
+ * @param path Output file
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before the first refresh,
+ *         ESP_FAIL if the file cannot be written
+ */
+esp_err_t epd_transport_emu_write_png(epd_transport_t *t, const char *path);
+
+/**
+ * @brief Commands received so far, in the epd_panel.h sequence encoding
+ *
+ * EPD_SEQ_CMD / _CMD_M / _CMD_S entries (by the controllers addressed)
+ * with their parameters, DATA_START without its data, and an EPD_SEQ_WAIT
+ * for every BUSY wait.
+ * @param t Emulator transport
+ * @param len Receives the length
+ * @return Trace, valid until the next transport call
+ */
+const uint8_t *epd_transport_emu_trace(epd_transport_t *t, size_t *len);
+
+/**
+ * @brief Empty the trace
+ */
+void epd_transport_emu_clear_trace(epd_transport_t *t);
+
+/**
+ * @brief Counters of the emulated panel
+ */
+const epd_emu_stats_t *epd_transport_emu_stats(epd_transport_t *t);
+
+/**
+ * @brief Zero the counters (the panel keeps its state)
+ */
+void epd_transport_emu_reset_stats(epd_transport_t *t);
+
+#endif // EPD_TRANSPORT_EMU_H
@@ -0,0 +1,520 @@
+/**
+ * @file epd_transport_spi.c
+ * @brief ESP-IDF SPI/GPIO implementation of the e-Paper transport
+ */
+
+#include "epd_transport.h"
+#include "epd_7in3e.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "EPD_SPI";
+
+// Number of transports using the shared SPI bus
+static int bus_users = 0;
+
+typedef struct {
+    epd_transport_pins_t pins;
+    spi_device_handle_t spi;
+    bool bus_claimed;       // Counted in bus_users
+
+    // Bulk data phase state: frame data is copied into internal-RAM bounce
+    // buffers and sent as queued DMA transactions while the next chunk is
+    // being filled. CS stays asserted for the whole stream.
+    uint8_t *dma_buf[EPD_DMA_CHUNK_COUNT];
+    spi_transaction_t dma_trans[EPD_DMA_CHUNK_COUNT];
+    size_t dma_fill;        // Bytes in the buffer being filled
+    int dma_index;          // Buffer currently being filled
+    int dma_inflight;       // Transactions queued but not yet completed
+    uint32_t dma_total;     // Bytes sent in the current stream
+    int64_t dma_start_us;
+    bool in_data;           // Between spi_data_begin and spi_data_end
+
+    epd_target_t target;    // Controllers selected by spi_select
+
+    // BUSY handling: a rising edge on BUSY (panel idle) gives busy_sem.
+    // With light sleep enabled the CPU sleeps until BUSY goes high instead.
+    SemaphoreHandle_t busy_sem;
+    bool light_sleep;
+} spi_transport_t;
+
+// Delay helper
+static void spi_delay_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+// Drive the CS lines of the selected controllers
+static void spi_set_cs(spi_transport_t *st, int level) {
+    if (st->pins.cs_secondary < 0) {
+        gpio_set_level(st->pins.cs, level);
+        return;
+    }
+    if (st->target != EPD_TARGET_SECONDARY) {
+        gpio_set_level(st->pins.cs, level);
+    }
+    if (st->target != EPD_TARGET_PRIMARY) {
+        gpio_set_level(st->pins.cs_secondary, level);
+    }
+}
+
+// Assert CS; the bus is held so other panels cannot clock data meanwhile
+static void spi_select(spi_transport_t *st) {
+    spi_device_acquire_bus(st->spi, portMAX_DELAY);
+    spi_set_cs(st, 0);
+}
+
+// Release CS and the bus
+static void spi_deselect(spi_transport_t *st) {
+    spi_set_cs(st, 1);
+    spi_device_release_bus(st->spi);
+}
+
+// SPI write byte (commands and short parameter lists)
+static void spi_write_byte(spi_transport_t *st, uint8_t data) {
+    spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_TXDATA,
+        .length = 8,
+        .tx_data = { data },
+    };
+    spi_device_polling_transmit(st->spi, &t);
+}
+
+// BUSY rising edge: panel finished the current operation
+static void IRAM_ATTR spi_busy_isr(void *arg) {
+    spi_transport_t *st = arg;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(st->busy_sem, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t spi_init(epd_transport_t *t) {
+    spi_transport_t *st = t->ctx;
+
+    // Check if already initialized
+    if (st->spi != NULL) {
+        return ESP_OK;
+    }
+
+    // Configure GPIO pins
+    uint64_t out_mask = (1ULL << st->pins.dc) | (1ULL << st->pins.rst) | (1ULL << st->pins.cs);
+    if (st->pins.cs_secondary >= 0) {
+        out_mask |= 1ULL << st->pins.cs_secondary;
+    }
+    gpio_config_t io_conf = {
+        .pin_bit_mask = out_mask,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io_conf);
+
+    // Configure BUSY pin as input; its interrupt is armed only while waiting
+    io_conf.pin_bit_mask = (1ULL << st->pins.busy);
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    gpio_config(&io_conf);
+
+    st->busy_sem = xSemaphoreCreateBinary();
+    esp_err_t isr_ret = gpio_install_isr_service(0);
+    if (isr_ret == ESP_OK || isr_ret == ESP_ERR_INVALID_STATE) {  // Already installed is fine
+        isr_ret = gpio_isr_handler_add(st->pins.busy, spi_busy_isr, st);
+    }
+    if (st->busy_sem == NULL || isr_ret != ESP_OK) {
+        ESP_LOGW(TAG, "BUSY interrupt unavailable, falling back to polling");
+        if (st->busy_sem != NULL) {
+            vSemaphoreDelete(st->busy_sem);
+            st->busy_sem = NULL;
+        }
+    }
+    gpio_intr_disable(st->pins.busy);
+
+    // Set initial states
+    gpio_set_level(st->pins.cs, 1);
+    if (st->pins.cs_secondary >= 0) {
+        gpio_set_level(st->pins.cs_secondary, 1);
+    }
+    gpio_set_level(st->pins.dc, 0);
+    gpio_set_level(st->pins.rst, 1);
+
+    // Configure SPI bus (shared by all panels)
+    if (bus_users == 0) {
+        spi_bus_config_t buscfg = {
+            .mosi_io_num = EPD_PIN_MOSI,
+            .miso_io_num = -1,  // Not used
+            .sclk_io_num = EPD_PIN_CLK,
+            .quadwp_io_num = -1,
+            .quadhd_io_num = -1,
+            .max_transfer_sz = EPD_DMA_CHUNK_SIZE,
+        };
+
+        esp_err_t ret = spi_bus_initialize(EPD_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
+            t->ops->deinit(t);
+            return ret;
+        }
+    }
+    bus_users++;
+    st->bus_claimed = true;
+
+    // Configure SPI device
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = EPD_SPI_SPEED_HZ,
+        .mode = 0,  // SPI mode 0 (CPOL=0, CPHA=0)
+        .spics_io_num = -1,  // We control CS manually
+        .queue_size = EPD_DMA_CHUNK_COUNT,
+    };
+
+    esp_err_t ret = spi_bus_add_device(EPD_SPI_HOST, &devcfg, &st->spi);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+        st->spi = NULL;
+        t->ops->deinit(t);
+        return ret;
+    }
+
+    // DMA bounce buffers must live in internal RAM
+    for (int i = 0; i < EPD_DMA_CHUNK_COUNT; i++) {
+        st->dma_buf[i] = heap_caps_malloc(EPD_DMA_CHUNK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (st->dma_buf[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate DMA buffer %d", i);
+            t->ops->deinit(t);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(TAG, "SPI transport ready (CS=%d CS2=%d DC=%d RST=%d BUSY=%d)",
+             st->pins.cs, st->pins.cs_secondary, st->pins.dc, st->pins.rst, st->pins.busy);
+    return ESP_OK;
+}
+
+// Release everything spi_init acquired; safe on a partially initialized transport
+static void spi_deinit(epd_transport_t *t) {
+    spi_transport_t *st = t->ctx;
+
+    if (st->busy_sem != NULL) {
+        gpio_isr_handler_remove(st->pins.busy);
+        vSemaphoreDelete(st->busy_sem);
+        st->busy_sem = NULL;
+    }
+    if (st->spi != NULL) {
+        spi_bus_remove_device(st->spi);
+        st->spi = NULL;
+    }
+    for (int i = 0; i < EPD_DMA_CHUNK_COUNT; i++) {
+        if (st->dma_buf[i] != NULL) {
+            heap_caps_free(st->dma_buf[i]);
+            st->dma_buf[i] = NULL;
+        }
+    }
+    if (st->bus_claimed) {
+        st->bus_claimed = false;
+        if (--bus_users == 0) {
+            spi_bus_free(EPD_SPI_HOST);
+        }
+    }
+}
+
+// Hardware reset
+static void spi_reset(epd_transport_t *t) {
+    spi_transport_t *st = t->ctx;
+
+    gpio_set_level(st->pins.rst, 1);
+    spi_delay_ms(20);
+    gpio_set_level(st->pins.rst, 0);
+    spi_delay_ms(2);
+    gpio_set_level(st->pins.rst, 1);
+    spi_delay_ms(20);
+}
+
+// Send command
+static void spi_command(epd_transport_t *t, uint8_t cmd) {
+    spi_transport_t *st = t->ctx;
+
+    gpio_set_level(st->pins.dc, 0);
+    spi_select(st);
+    spi_write_byte(st, cmd);
+    spi_deselect(st);
+    t->stats.commands++;
+}
+
+// Send parameter bytes, one CS cycle per byte as the controller expects
+static void spi_data(epd_transport_t *t, const uint8_t *data, size_t len) {
+    spi_transport_t *st = t->ctx;
+
+    gpio_set_level(st->pins.dc, 1);
+    for (size_t i = 0; i < len; i++) {
+        spi_select(st);
+        spi_write_byte(st, data[i]);
+        spi_deselect(st);
+    }
+    t->stats.data_bytes += len;
+}
+
+// Start a bulk data phase (DC high, CS held low until spi_data_end)
+static void spi_data_begin(epd_transport_t *t) {
+    spi_transport_t *st = t->ctx;
+
+    st->dma_fill = 0;
+    st->dma_index = 0;
+    st->dma_inflight = 0;
+    st->dma_total = 0;
+    st->dma_start_us = esp_timer_get_time();
+    st->in_data = true;
+
+    gpio_set_level(st->pins.dc, 1);
+    spi_select(st);
+}
+
+// Wait for the oldest queued transaction to complete
+static void spi_data_wait_one(spi_transport_t *st) {
+    spi_transaction_t *done = NULL;
+    esp_err_t ret = spi_device_get_trans_result(st->spi, &done, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "SPI transfer failed: %s", esp_err_to_name(ret));
+    }
+    st->dma_inflight--;
+}
+
+// Queue the buffer being filled and make sure the next one is free
+static void spi_data_flush(spi_transport_t *st) {
+    if (st->dma_fill == 0) {
+        return;
+    }
+
+    spi_transaction_t *tr = &st->dma_trans[st->dma_index];
+    memset(tr, 0, sizeof(*tr));
+    tr->length = st->dma_fill * 8;
+    tr->tx_buffer = st->dma_buf[st->dma_index];
+
+    esp_err_t ret = spi_device_queue_trans(st->spi, tr, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to queue SPI transfer: %s", esp_err_to_name(ret));
+        st->dma_fill = 0;
+        return;
+    }
+
+    st->dma_total += st->dma_fill;
+    st->dma_inflight++;
+    st->dma_fill = 0;
+    st->dma_index = (st->dma_index + 1) % EPD_DMA_CHUNK_COUNT;
+
+    // Transactions complete in order, so the oldest one owns dma_buf[dma_index]
+    if (st->dma_inflight == EPD_DMA_CHUNK_COUNT) {
+        spi_data_wait_one(st);
+    }
+}
+
+// Append bytes to the data stream
+static void spi_data_write(epd_transport_t *t, const uint8_t *data, size_t len) {
+    spi_transport_t *st = t->ctx;
+
+    while (len > 0) {
+        size_t n = EPD_DMA_CHUNK_SIZE - st->dma_fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(st->dma_buf[st->dma_index] + st->dma_fill, data, n);
+        st->dma_fill += n;
+        data += n;
+        len -= n;
+
+        if (st->dma_fill == EPD_DMA_CHUNK_SIZE) {
+            spi_data_flush(st);
+        }
+    }
+}
+
+// Append len copies of one byte to the data stream
+static void spi_data_fill(epd_transport_t *t, uint8_t value, size_t len) {
+    spi_transport_t *st = t->ctx;
+
+    while (len > 0) {
+        size_t n = EPD_DMA_CHUNK_SIZE - st->dma_fill;
+        if (n > len) {
+            n = len;
+        }
+        memset(st->dma_buf[st->dma_index] + st->dma_fill, value, n);
+        st->dma_fill += n;
+        len -= n;
+
+        if (st->dma_fill == EPD_DMA_CHUNK_SIZE) {
+            spi_data_flush(st);
+        }
+    }
+}
+
+// Finish the data phase: send the tail, drain the queue and release CS
+static void spi_data_end(epd_transport_t *t) {
+    spi_transport_t *st = t->ctx;
+
+    spi_data_flush(st);
+    while (st->dma_inflight > 0) {
+        spi_data_wait_one(st);
+    }
+    spi_deselect(st);
+    st->in_data = false;
+
+    int64_t elapsed_us = esp_timer_get_time() - st->dma_start_us;
+    t->stats.data_bytes += st->dma_total;
+    t->stats.transfer_us += elapsed_us;
+    ESP_LOGI(TAG, "Data transfer: %lu bytes in %lld ms",
+             (unsigned long)st->dma_total, (long long)(elapsed_us / 1000));
+}
+
+// Light sleep until BUSY goes high or the deadline passes
+static void spi_light_sleep_until_idle(epd_transport_t *t, int64_t deadline_us) {
+    spi_transport_t *st = t->ctx;
+
+    gpio_wakeup_enable(st->pins.busy, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    int64_t now = esp_timer_get_time();
+    while (gpio_get_level(st->pins.busy) == 0 && now < deadline_us) {
+        esp_sleep_enable_timer_wakeup(deadline_us - now);
+        esp_light_sleep_start();
+        int64_t woke = esp_timer_get_time();
+        t->stats.light_sleep_us += woke - now;
+        now = woke;
+    }
+
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+    gpio_wakeup_disable(st->pins.busy);
+}
+
+// Block on the BUSY interrupt until the pin goes high or the deadline passes
+static void spi_isr_wait_until_idle(spi_transport_t *st, int64_t deadline_us) {
+    xSemaphoreTake(st->busy_sem, 0);  // Drop a stale edge
+    gpio_set_intr_type(st->pins.busy, GPIO_INTR_POSEDGE);
+    gpio_intr_enable(st->pins.busy);
+
+    // The edge may have happened before the interrupt was armed
+    int64_t now = esp_timer_get_time();
+    while (gpio_get_level(st->pins.busy) == 0 && now < deadline_us) {
+        TickType_t ticks = pdMS_TO_TICKS((deadline_us - now) / 1000) + 1;
+        xSemaphoreTake(st->busy_sem, ticks);
+        now = esp_timer_get_time();
+    }
+
+    gpio_intr_disable(st->pins.busy);
+}
+
+// Wait up to timeout_ms for busy pin to go HIGH (idle)
+static esp_err_t spi_wait_busy(epd_transport_t *t, uint32_t timeout_ms) {
+    spi_transport_t *st = t->ctx;
+
+    if (gpio_get_level(st->pins.busy) != 0) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Waiting for display...");
+    int64_t start_us = esp_timer_get_time();
+    int64_t deadline_us = start_us + (int64_t)timeout_ms * 1000;
+    int64_t slept_before = t->stats.light_sleep_us;
+
+    if (st->light_sleep) {
+        spi_light_sleep_until_idle(t, deadline_us);
+    } else if (st->busy_sem != NULL) {
+        spi_isr_wait_until_idle(st, deadline_us);
+    } else {
+        while (gpio_get_level(st->pins.busy) == 0 && esp_timer_get_time() < deadline_us) {
+            spi_delay_ms(10);
+        }
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    int64_t slept_ms = (t->stats.light_sleep_us - slept_before) / 1000;
+    t->stats.busy_us += elapsed_us;
+
+    if (gpio_get_level(st->pins.busy) == 0) {
+        ESP_LOGE(TAG, "Display busy timeout after %lld ms", (long long)(elapsed_us / 1000));
+        return ESP_ERR_TIMEOUT;
+    }
+
+    ESP_LOGI(TAG, "Display ready after %lld ms (light sleep: %lld ms)",
+             (long long)(elapsed_us / 1000), (long long)slept_ms);
+    return ESP_OK;
+}
+
+static void spi_set_light_sleep(epd_transport_t *t, bool enable) {
+    spi_transport_t *st = t->ctx;
+    st->light_sleep = enable;
+}
+
+// Select controllers; inside a data phase the queued data is sent to the
+// previous selection first and the bus stays held
+static void spi_set_target(epd_transport_t *t, epd_target_t target) {
+    spi_transport_t *st = t->ctx;
+
+    if (target == st->target) {
+        return;
+    }
+    if (st->in_data) {
+        spi_data_flush(st);
+        while (st->dma_inflight > 0) {
+            spi_data_wait_one(st);
+        }
+        spi_set_cs(st, 1);
+        st->target = target;
+        spi_set_cs(st, 0);
+    } else {
+        st->target = target;
+    }
+}
+
+static const epd_transport_ops_t spi_ops = {
+    .init = spi_init,
+    .deinit = spi_deinit,
+    .reset = spi_reset,
+    .command = spi_command,
+    .data = spi_data,
+    .data_begin = spi_data_begin,
+    .data_write = spi_data_write,
+    .data_fill = spi_data_fill,
+    .data_end = spi_data_end,
+    .wait_busy = spi_wait_busy,
+    .set_light_sleep = spi_set_light_sleep,
+    .set_target = spi_set_target,
+};
+
+esp_err_t epd_transport_spi_create(const epd_transport_pins_t *pins, epd_transport_t **out) {
+    if (pins == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    epd_transport_t *t = calloc(1, sizeof(epd_transport_t));
+    spi_transport_t *st = calloc(1, sizeof(spi_transport_t));
+    if (t == NULL || st == NULL) {
+        free(t);
+        free(st);
+        return ESP_ERR_NO_MEM;
+    }
+
+    st->pins = *pins;
+    t->ops = &spi_ops;
+    t->ctx = st;
+    *out = t;
+    return ESP_OK;
+}
+
+void epd_transport_destroy(epd_transport_t *t) {
+    if (t == NULL) {
+        return;
+    }
+    t->ops->deinit(t);
+    free(t->ctx);
+    free(t);
+}
@@ -0,0 +1,236 @@
+/**
+ * @file framecache.c
+ * @brief Last displayed frame kept in a flash partition
+ */
+
+#include "framecache.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "FRAMECACHE";
+
+#define FRAMECACHE_LABEL  "framecache"
+#define FRAMECACHE_MAGIC  0x46524331  // "FRC1"
+#define META_SECTOR_SIZE  4096        // Metadata sector at the start of each slot
+#define SLOT_ALIGN        0x10000     // Slots start on 64 KB blocks (block erase)
+
+// Later stores of an unchanged frame append their time to the erased rest
+// of the metadata sector instead of erasing it; the last valid record wins
+typedef struct {
+    uint32_t time;
+    uint32_t check;     // ~time: a record cut short by a reset is ignored
+} touch_t;
+
+#define TOUCH_OFFSET  ((sizeof(framecache_meta_t) + sizeof(touch_t) - 1) / sizeof(touch_t) * sizeof(touch_t))
+#define TOUCH_COUNT   ((int)((META_SECTOR_SIZE - TOUCH_OFFSET) / sizeof(touch_t)))
+
+_Static_assert(TOUCH_OFFSET + 16 * sizeof(touch_t) <= META_SECTOR_SIZE, "No room for time records after the frame metadata");
+
+static const esp_partition_t *partition = NULL;
+static size_t slot_size = 0;
+static size_t cache_frame_size = 0;
+static int slot_count = 0;
+static int current_slot = -1;
+static int current_touches = 0;     // Time records used in the current slot
+static framecache_meta_t current;   // Copy of the current slot's metadata
+static framecache_meta_t scratch;   // Too large for the task stacks
+
+static RTC_DATA_ATTR framecache_stats_t stats;
+
+static uint32_t meta_crc(const framecache_meta_t *m) {
+    return esp_rom_crc32_le(0, (const uint8_t *)m, offsetof(framecache_meta_t, meta_crc));
+}
+
+static bool meta_valid(const framecache_meta_t *m) {
+    return m->magic == FRAMECACHE_MAGIC && m->frame_size == cache_frame_size &&
+           m->url[MAX_URL_LEN - 1] == '\0' && m->etag[FRAMECACHE_ETAG_LEN - 1] == '\0' &&
+           m->meta_crc == meta_crc(m);
+}
+
+// Apply the time records of the current slot to its timestamp
+static void read_touches(void) {
+    touch_t rec[16];
+    size_t base = (size_t)current_slot * slot_size + TOUCH_OFFSET;
+    current_touches = 0;
+    for (int i = 0; i < TOUCH_COUNT; i += 16) {
+        int n = TOUCH_COUNT - i < 16 ? TOUCH_COUNT - i : 16;
+        if (esp_partition_read(partition, base + i * sizeof(touch_t), rec, n * sizeof(touch_t)) != ESP_OK) {
+            return;
+        }
+        for (int k = 0; k < n; k++) {
+            if (rec[k].time == UINT32_MAX && rec[k].check == UINT32_MAX) {
+                return;     // Erased: end of the records
+            }
+            current_touches = i + k + 1;
+            if (rec[k].check == ~rec[k].time) {
+                current.timestamp = rec[k].time;
+            }
+        }
+    }
+}
+
+// Record a new timestamp for the unchanged current frame. Once the records
+// are used up, the metadata sector is erased and rewritten with the time:
+// a reset in between loses this slot and leaves the previous frame current.
+static void touch_current(int64_t timestamp) {
+    size_t base = (size_t)current_slot * slot_size;
+    esp_err_t ret;
+    if (current_touches < TOUCH_COUNT) {
+        touch_t rec = { (uint32_t)timestamp, ~(uint32_t)timestamp };
+        ret = esp_partition_write(partition, base + TOUCH_OFFSET + current_touches * sizeof(touch_t),
+                                  &rec, sizeof(rec));
+        current_touches++;
+    } else {
+        scratch = current;
+        scratch.timestamp = timestamp;
+        scratch.meta_crc = meta_crc(&scratch);
+        ret = esp_partition_erase_range(partition, base, META_SECTOR_SIZE);
+        if (ret == ESP_OK) {
+            ret = esp_partition_write(partition, base, &scratch, sizeof(scratch));
+        }
+        current_touches = 0;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to update slot %d time: %s", current_slot, esp_err_to_name(ret));
+        return;
+    }
+    current.timestamp = timestamp;
+}
+
+esp_err_t framecache_init(size_t frame_size) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         FRAMECACHE_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No %s partition", FRAMECACHE_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    cache_frame_size = frame_size;
+    slot_size = (META_SECTOR_SIZE + frame_size + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    slot_count = (int)(partition->size / slot_size);
+    stats.slots = (uint8_t)slot_count;
+    if (slot_count < 2) {
+        ESP_LOGE(TAG, "Partition too small for two %u byte frames", (unsigned)frame_size);
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Current frame = valid slot with the highest sequence number
+    current_slot = -1;
+    for (int i = 0; i < slot_count; i++) {
+        if (esp_partition_read(partition, (size_t)i * slot_size, &scratch, sizeof(scratch)) != ESP_OK ||
+            !meta_valid(&scratch)) {
+            continue;
+        }
+        if (current_slot < 0 || (int32_t)(scratch.seq - current.seq) > 0) {
+            current_slot = i;
+            current = scratch;
+        }
+    }
+
+    if (current_slot >= 0) {
+        read_touches();
+        ESP_LOGI(TAG, "%d slots, current frame in slot %d (seq %lu)", slot_count, current_slot,
+                 (unsigned long)current.seq);
+    } else {
+        ESP_LOGI(TAG, "%d slots, no frame cached", slot_count);
+    }
+    return ESP_OK;
+}
+
+const framecache_meta_t *framecache_current(void) {
+    return (partition != NULL && current_slot >= 0) ? &current : NULL;
+}
+
+esp_err_t framecache_store(const uint8_t *frame, const char *url, const char *etag, int64_t timestamp) {
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, frame, cache_frame_size);
+    if (current_slot >= 0 && current.frame_crc == crc && strcmp(current.url, url) == 0) {
+        stats.skipped++;
+        ESP_LOGI(TAG, "Frame unchanged, not rewritten");
+        // Still current as of now: the stale-data banner shows this time
+        if (timestamp > current.timestamp && timestamp <= UINT32_MAX) {
+            touch_current(timestamp);
+        }
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    int slot = (current_slot + 1) % slot_count;
+    size_t base = (size_t)slot * slot_size;
+
+    // Data first, metadata last: the slot only becomes valid once complete
+    esp_err_t ret = esp_partition_erase_range(partition, base, slot_size);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(partition, base + META_SECTOR_SIZE, frame, cache_frame_size);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write slot %d: %s", slot, esp_err_to_name(ret));
+        return ret;
+    }
+
+    memset(&scratch, 0, sizeof(scratch));
+    scratch.magic = FRAMECACHE_MAGIC;
+    scratch.seq = (current_slot >= 0) ? current.seq + 1 : 1;
+    scratch.frame_size = cache_frame_size;
+    scratch.frame_crc = crc;
+    scratch.timestamp = timestamp;
+    strncpy(scratch.etag, etag ? etag : "", FRAMECACHE_ETAG_LEN - 1);
+    strncpy(scratch.url, url, MAX_URL_LEN - 1);
+    scratch.meta_crc = meta_crc(&scratch);
+
+    ret = esp_partition_write(partition, base, &scratch, sizeof(scratch));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write slot %d metadata: %s", slot, esp_err_to_name(ret));
+        return ret;
+    }
+
+    current_slot = slot;
+    current = scratch;
+    current_touches = 0;
+    stats.writes++;
+    stats.write_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Frame stored in slot %d (seq %lu) in %lu us", slot, (unsigned long)current.seq,
+             (unsigned long)stats.write_us);
+    return ESP_OK;
+}
+
+esp_err_t framecache_map(const uint8_t **frame, esp_partition_mmap_handle_t *handle) {
+    if (framecache_current() == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    const void *ptr;
+    esp_err_t ret = esp_partition_mmap(partition, (size_t)current_slot * slot_size + META_SECTOR_SIZE,
+                                       cache_frame_size, ESP_PARTITION_MMAP_DATA, &ptr, handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map slot %d: %s", current_slot, esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (esp_rom_crc32_le(0, ptr, cache_frame_size) != current.frame_crc) {
+        ESP_LOGE(TAG, "Frame in slot %d is corrupted", current_slot);
+        esp_partition_munmap(*handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *frame = ptr;
+    stats.read_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Frame mapped and verified in %lu us", (unsigned long)stats.read_us);
+    return ESP_OK;
+}
+
+void framecache_unmap(esp_partition_mmap_handle_t handle) {
+    esp_partition_munmap(handle);
+}
+
+void framecache_get_stats(framecache_stats_t *out) {
+    *out = stats;
+}
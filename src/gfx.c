@@ -0,0 +1,366 @@
+/**
+ * @file gfx.c
+ * @brief Drawing primitives for packed 4bpp e-Paper frames
+ */
+
+#include "gfx.h"
+#include <string.h>
+
+#define DISPLAY_WIDTH  EPD_PANEL_WIDTH
+#define DISPLAY_HEIGHT EPD_PANEL_HEIGHT
+
+// 8x16 bitmap font for ASCII 32-126 (95 characters)
+// Each character is 16 bytes (8 pixels wide x 16 pixels tall, 1 bit per pixel)
+// Font data is stored MSB first (bit 7 = leftmost pixel)
+static const uint8_t font_8x16[][16] = {
+    // Space (32)
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // ! (33)
+    {0x00,0x00,0x18,0x3C,0x3C,0x3C,0x18,0x18,0x18,0x00,0x18,0x18,0x00,0x00,0x00,0x00},
+    // " (34)
+    {0x00,0x66,0x66,0x66,0x24,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // # (35)
+    {0x00,0x00,0x00,0x6C,0x6C,0xFE,0x6C,0x6C,0x6C,0xFE,0x6C,0x6C,0x00,0x00,0x00,0x00},
+    // $ (36)
+    {0x18,0x18,0x7C,0xC6,0xC2,0xC0,0x7C,0x06,0x06,0x86,0xC6,0x7C,0x18,0x18,0x00,0x00},
+    // % (37)
+    {0x00,0x00,0x00,0x00,0xC2,0xC6,0x0C,0x18,0x30,0x60,0xC6,0x86,0x00,0x00,0x00,0x00},
+    // & (38)
+    {0x00,0x00,0x38,0x6C,0x6C,0x38,0x76,0xDC,0xCC,0xCC,0xCC,0x76,0x00,0x00,0x00,0x00},
+    // ' (39)
+    {0x00,0x30,0x30,0x30,0x60,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // ( (40)
+    {0x00,0x00,0x0C,0x18,0x30,0x30,0x30,0x30,0x30,0x30,0x18,0x0C,0x00,0x00,0x00,0x00},
+    // ) (41)
+    {0x00,0x00,0x30,0x18,0x0C,0x0C,0x0C,0x0C,0x0C,0x0C,0x18,0x30,0x00,0x00,0x00,0x00},
+    // * (42)
+    {0x00,0x00,0x00,0x00,0x00,0x66,0x3C,0xFF,0x3C,0x66,0x00,0x00,0x00,0x00,0x00,0x00},
+    // + (43)
+    {0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x7E,0x18,0x18,0x00,0x00,0x00,0x00,0x00,0x00},
+    // , (44)
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x18,0x30,0x00,0x00,0x00},
+    // - (45)
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFE,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // . (46)
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00},
+    // / (47)
+    {0x00,0x00,0x00,0x00,0x02,0x06,0x0C,0x18,0x30,0x60,0xC0,0x80,0x00,0x00,0x00,0x00},
+    // 0 (48)
+    {0x00,0x00,0x38,0x6C,0xC6,0xC6,0xD6,0xD6,0xC6,0xC6,0x6C,0x38,0x00,0x00,0x00,0x00},
+    // 1 (49)
+    {0x00,0x00,0x18,0x38,0x78,0x18,0x18,0x18,0x18,0x18,0x18,0x7E,0x00,0x00,0x00,0x00},
+    // 2 (50)
+    {0x00,0x00,0x7C,0xC6,0x06,0x0C,0x18,0x30,0x60,0xC0,0xC6,0xFE,0x00,0x00,0x00,0x00},
+    // 3 (51)
+    {0x00,0x00,0x7C,0xC6,0x06,0x06,0x3C,0x06,0x06,0x06,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // 4 (52)
+    {0x00,0x00,0x0C,0x1C,0x3C,0x6C,0xCC,0xFE,0x0C,0x0C,0x0C,0x1E,0x00,0x00,0x00,0x00},
+    // 5 (53)
+    {0x00,0x00,0xFE,0xC0,0xC0,0xC0,0xFC,0x06,0x06,0x06,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // 6 (54)
+    {0x00,0x00,0x38,0x60,0xC0,0xC0,0xFC,0xC6,0xC6,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // 7 (55)
+    {0x00,0x00,0xFE,0xC6,0x06,0x06,0x0C,0x18,0x30,0x30,0x30,0x30,0x00,0x00,0x00,0x00},
+    // 8 (56)
+    {0x00,0x00,0x7C,0xC6,0xC6,0xC6,0x7C,0xC6,0xC6,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // 9 (57)
+    {0x00,0x00,0x7C,0xC6,0xC6,0xC6,0x7E,0x06,0x06,0x06,0x0C,0x78,0x00,0x00,0x00,0x00},
+    // : (58)
+    {0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x00,0x00},
+    // ; (59)
+    {0x00,0x00,0x00,0x00,0x18,0x18,0x00,0x00,0x00,0x18,0x18,0x30,0x00,0x00,0x00,0x00},
+    // < (60)
+    {0x00,0x00,0x00,0x06,0x0C,0x18,0x30,0x60,0x30,0x18,0x0C,0x06,0x00,0x00,0x00,0x00},
+    // = (61)
+    {0x00,0x00,0x00,0x00,0x00,0x7E,0x00,0x00,0x7E,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // > (62)
+    {0x00,0x00,0x00,0x60,0x30,0x18,0x0C,0x06,0x0C,0x18,0x30,0x60,0x00,0x00,0x00,0x00},
+    // ? (63)
+    {0x00,0x00,0x7C,0xC6,0xC6,0x0C,0x18,0x18,0x18,0x00,0x18,0x18,0x00,0x00,0x00,0x00},
+    // @ (64)
+    {0x00,0x00,0x00,0x7C,0xC6,0xC6,0xDE,0xDE,0xDE,0xDC,0xC0,0x7C,0x00,0x00,0x00,0x00},
+    // A (65)
+    {0x00,0x00,0x10,0x38,0x6C,0xC6,0xC6,0xFE,0xC6,0xC6,0xC6,0xC6,0x00,0x00,0x00,0x00},
+    // B (66)
+    {0x00,0x00,0xFC,0x66,0x66,0x66,0x7C,0x66,0x66,0x66,0x66,0xFC,0x00,0x00,0x00,0x00},
+    // C (67)
+    {0x00,0x00,0x3C,0x66,0xC2,0xC0,0xC0,0xC0,0xC0,0xC2,0x66,0x3C,0x00,0x00,0x00,0x00},
+    // D (68)
+    {0x00,0x00,0xF8,0x6C,0x66,0x66,0x66,0x66,0x66,0x66,0x6C,0xF8,0x00,0x00,0x00,0x00},
+    // E (69)
+    {0x00,0x00,0xFE,0x66,0x62,0x68,0x78,0x68,0x60,0x62,0x66,0xFE,0x00,0x00,0x00,0x00},
+    // F (70)
+    {0x00,0x00,0xFE,0x66,0x62,0x68,0x78,0x68,0x60,0x60,0x60,0xF0,0x00,0x00,0x00,0x00},
+    // G (71)
+    {0x00,0x00,0x3C,0x66,0xC2,0xC0,0xC0,0xDE,0xC6,0xC6,0x66,0x3A,0x00,0x00,0x00,0x00},
+    // H (72)
+    {0x00,0x00,0xC6,0xC6,0xC6,0xC6,0xFE,0xC6,0xC6,0xC6,0xC6,0xC6,0x00,0x00,0x00,0x00},
+    // I (73)
+    {0x00,0x00,0x3C,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x3C,0x00,0x00,0x00,0x00},
+    // J (74)
+    {0x00,0x00,0x1E,0x0C,0x0C,0x0C,0x0C,0x0C,0xCC,0xCC,0xCC,0x78,0x00,0x00,0x00,0x00},
+    // K (75)
+    {0x00,0x00,0xE6,0x66,0x66,0x6C,0x78,0x78,0x6C,0x66,0x66,0xE6,0x00,0x00,0x00,0x00},
+    // L (76)
+    {0x00,0x00,0xF0,0x60,0x60,0x60,0x60,0x60,0x60,0x62,0x66,0xFE,0x00,0x00,0x00,0x00},
+    // M (77)
+    {0x00,0x00,0xC6,0xEE,0xFE,0xFE,0xD6,0xC6,0xC6,0xC6,0xC6,0xC6,0x00,0x00,0x00,0x00},
+    // N (78)
+    {0x00,0x00,0xC6,0xE6,0xF6,0xFE,0xDE,0xCE,0xC6,0xC6,0xC6,0xC6,0x00,0x00,0x00,0x00},
+    // O (79)
+    {0x00,0x00,0x7C,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // P (80)
+    {0x00,0x00,0xFC,0x66,0x66,0x66,0x7C,0x60,0x60,0x60,0x60,0xF0,0x00,0x00,0x00,0x00},
+    // Q (81)
+    {0x00,0x00,0x7C,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xD6,0xDE,0x7C,0x0C,0x0E,0x00,0x00},
+    // R (82)
+    {0x00,0x00,0xFC,0x66,0x66,0x66,0x7C,0x6C,0x66,0x66,0x66,0xE6,0x00,0x00,0x00,0x00},
+    // S (83)
+    {0x00,0x00,0x7C,0xC6,0xC6,0x60,0x38,0x0C,0x06,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // T (84)
+    {0x00,0x00,0x7E,0x7E,0x5A,0x18,0x18,0x18,0x18,0x18,0x18,0x3C,0x00,0x00,0x00,0x00},
+    // U (85)
+    {0x00,0x00,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // V (86)
+    {0x00,0x00,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0x6C,0x38,0x10,0x00,0x00,0x00,0x00},
+    // W (87)
+    {0x00,0x00,0xC6,0xC6,0xC6,0xC6,0xD6,0xD6,0xD6,0xFE,0xEE,0x6C,0x00,0x00,0x00,0x00},
+    // X (88)
+    {0x00,0x00,0xC6,0xC6,0x6C,0x7C,0x38,0x38,0x7C,0x6C,0xC6,0xC6,0x00,0x00,0x00,0x00},
+    // Y (89)
+    {0x00,0x00,0x66,0x66,0x66,0x66,0x3C,0x18,0x18,0x18,0x18,0x3C,0x00,0x00,0x00,0x00},
+    // Z (90)
+    {0x00,0x00,0xFE,0xC6,0x86,0x0C,0x18,0x30,0x60,0xC2,0xC6,0xFE,0x00,0x00,0x00,0x00},
+    // [ (91)
+    {0x00,0x00,0x3C,0x30,0x30,0x30,0x30,0x30,0x30,0x30,0x30,0x3C,0x00,0x00,0x00,0x00},
+    // \ (92)
+    {0x00,0x00,0x00,0x80,0xC0,0xE0,0x70,0x38,0x1C,0x0E,0x06,0x02,0x00,0x00,0x00,0x00},
+    // ] (93)
+    {0x00,0x00,0x3C,0x0C,0x0C,0x0C,0x0C,0x0C,0x0C,0x0C,0x0C,0x3C,0x00,0x00,0x00,0x00},
+    // ^ (94)
+    {0x10,0x38,0x6C,0xC6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // _ (95)
+    {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x00,0x00},
+    // ` (96)
+    {0x30,0x30,0x18,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+    // a (97)
+    {0x00,0x00,0x00,0x00,0x00,0x78,0x0C,0x7C,0xCC,0xCC,0xCC,0x76,0x00,0x00,0x00,0x00},
+    // b (98)
+    {0x00,0x00,0xE0,0x60,0x60,0x78,0x6C,0x66,0x66,0x66,0x66,0x7C,0x00,0x00,0x00,0x00},
+    // c (99)
+    {0x00,0x00,0x00,0x00,0x00,0x7C,0xC6,0xC0,0xC0,0xC0,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // d (100)
+    {0x00,0x00,0x1C,0x0C,0x0C,0x3C,0x6C,0xCC,0xCC,0xCC,0xCC,0x76,0x00,0x00,0x00,0x00},
+    // e (101)
+    {0x00,0x00,0x00,0x00,0x00,0x7C,0xC6,0xFE,0xC0,0xC0,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // f (102)
+    {0x00,0x00,0x38,0x6C,0x64,0x60,0xF0,0x60,0x60,0x60,0x60,0xF0,0x00,0x00,0x00,0x00},
+    // g (103)
+    {0x00,0x00,0x00,0x00,0x00,0x76,0xCC,0xCC,0xCC,0xCC,0xCC,0x7C,0x0C,0xCC,0x78,0x00},
+    // h (104)
+    {0x00,0x00,0xE0,0x60,0x60,0x6C,0x76,0x66,0x66,0x66,0x66,0xE6,0x00,0x00,0x00,0x00},
+    // i (105)
+    {0x00,0x00,0x18,0x18,0x00,0x38,0x18,0x18,0x18,0x18,0x18,0x3C,0x00,0x00,0x00,0x00},
+    // j (106)
+    {0x00,0x00,0x06,0x06,0x00,0x0E,0x06,0x06,0x06,0x06,0x06,0x06,0x66,0x66,0x3C,0x00},
+    // k (107)
+    {0x00,0x00,0xE0,0x60,0x60,0x66,0x6C,0x78,0x78,0x6C,0x66,0xE6,0x00,0x00,0x00,0x00},
+    // l (108)
+    {0x00,0x00,0x38,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x18,0x3C,0x00,0x00,0x00,0x00},
+    // m (109)
+    {0x00,0x00,0x00,0x00,0x00,0xEC,0xFE,0xD6,0xD6,0xD6,0xD6,0xC6,0x00,0x00,0x00,0x00},
+    // n (110)
+    {0x00,0x00,0x00,0x00,0x00,0xDC,0x66,0x66,0x66,0x66,0x66,0x66,0x00,0x00,0x00,0x00},
+    // o (111)
+    {0x00,0x00,0x00,0x00,0x00,0x7C,0xC6,0xC6,0xC6,0xC6,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // p (112)
+    {0x00,0x00,0x00,0x00,0x00,0xDC,0x66,0x66,0x66,0x66,0x66,0x7C,0x60,0x60,0xF0,0x00},
+    // q (113)
+    {0x00,0x00,0x00,0x00,0x00,0x76,0xCC,0xCC,0xCC,0xCC,0xCC,0x7C,0x0C,0x0C,0x1E,0x00},
+    // r (114)
+    {0x00,0x00,0x00,0x00,0x00,0xDC,0x76,0x66,0x60,0x60,0x60,0xF0,0x00,0x00,0x00,0x00},
+    // s (115)
+    {0x00,0x00,0x00,0x00,0x00,0x7C,0xC6,0x60,0x38,0x0C,0xC6,0x7C,0x00,0x00,0x00,0x00},
+    // t (116)
+    {0x00,0x00,0x10,0x30,0x30,0xFC,0x30,0x30,0x30,0x30,0x36,0x1C,0x00,0x00,0x00,0x00},
+    // u (117)
+    {0x00,0x00,0x00,0x00,0x00,0xCC,0xCC,0xCC,0xCC,0xCC,0xCC,0x76,0x00,0x00,0x00,0x00},
+    // v (118)
+    {0x00,0x00,0x00,0x00,0x00,0x66,0x66,0x66,0x66,0x66,0x3C,0x18,0x00,0x00,0x00,0x00},
+    // w (119)
+    {0x00,0x00,0x00,0x00,0x00,0xC6,0xC6,0xD6,0xD6,0xD6,0xFE,0x6C,0x00,0x00,0x00,0x00},
+    // x (120)
+    {0x00,0x00,0x00,0x00,0x00,0xC6,0x6C,0x38,0x38,0x38,0x6C,0xC6,0x00,0x00,0x00,0x00},
+    // y (121)
+    {0x00,0x00,0x00,0x00,0x00,0xC6,0xC6,0xC6,0xC6,0xC6,0xC6,0x7E,0x06,0x0C,0xF8,0x00},
+    // z (122)
+    {0x00,0x00,0x00,0x00,0x00,0xFE,0xCC,0x18,0x30,0x60,0xC6,0xFE,0x00,0x00,0x00,0x00},
+    // { (123)
+    {0x00,0x00,0x0E,0x18,0x18,0x18,0x70,0x18,0x18,0x18,0x18,0x0E,0x00,0x00,0x00,0x00},
+    // | (124)
+    {0x00,0x00,0x18,0x18,0x18,0x18,0x00,0x18,0x18,0x18,0x18,0x18,0x00,0x00,0x00,0x00},
+    // } (125)
+    {0x00,0x00,0x70,0x18,0x18,0x18,0x0E,0x18,0x18,0x18,0x18,0x70,0x00,0x00,0x00,0x00},
+    // ~ (126)
+    {0x00,0x00,0x76,0xDC,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+};
+
+// 16x16 icons, one uint16_t per row, bit 15 = leftmost pixel
+static const struct {
+    const char *name;
+    uint16_t rows[GFX_ICON_SIZE];
+} icons[] = {
+    { "sun", {0x0100,0x0100,0x2108,0x1010,0x07C0,0x0FE0,0x0FE0,0xEFEE,
+              0x0FE0,0x0FE0,0x07C0,0x1010,0x2108,0x0100,0x0100,0x0000} },
+    { "cloud", {0x0000,0x0000,0x0000,0x03C0,0x0C30,0x1008,0x2006,0x6001,
+              0x8001,0x8001,0x8001,0x7FFE,0x0000,0x0000,0x0000,0x0000} },
+    { "rain", {0x03C0,0x0C30,0x1008,0x2006,0x6001,0x8001,0x8001,0x7FFE,
+              0x0000,0x2220,0x4440,0x0000,0x0888,0x1110,0x0000,0x0000} },
+    { "snow", {0x03C0,0x0C30,0x1008,0x2006,0x6001,0x8001,0x8001,0x7FFE,
+              0x0000,0x2080,0x71C0,0x2082,0x0407,0x0E02,0x0400,0x0000} },
+    { "storm", {0x03C0,0x0C30,0x1008,0x2006,0x6001,0x8001,0x8001,0x7C7E,
+              0x0300,0x0600,0x0FC0,0x0180,0x0300,0x0400,0x0000,0x0000} },
+    { "fog", {0x0000,0x0000,0x0000,0x7FFE,0x0000,0x1FFC,0x0000,0x7FFE,
+              0x0000,0x1FFC,0x0000,0x7FFE,0x0000,0x0000,0x0000,0x0000} },
+    { "bus", {0x3FFC,0x4002,0x5E7A,0x524A,0x5E7A,0x4002,0x4002,0x7FFE,
+              0x4002,0x581A,0x581A,0x4002,0x7FFE,0x300C,0x300C,0x0000} },
+    { "calendar", {0x1020,0x3870,0xFFFF,0x8001,0xFFFF,0x8001,0xB6D9,0xB6D9,
+              0x8001,0xB6D9,0xB6D9,0x8001,0xB601,0xB601,0x8001,0xFFFF} },
+    { "home", {0x0180,0x03C0,0x0660,0x0C30,0x1818,0x300C,0x6006,0xF00F,
+              0x2004,0x2004,0x21C4,0x2144,0x2144,0x2144,0x3FFC,0x0000} },
+    { "warning", {0x0180,0x03C0,0x0240,0x0660,0x05A0,0x0DB0,0x0990,0x1998,
+              0x1188,0x318C,0x2004,0x6186,0x4182,0xC003,0xFFFF,0x0000} },
+};
+
+void gfx_set_pixel(uint8_t *fb, int x, int y, uint8_t color) {
+    if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT) return;
+
+    // Each byte contains 2 pixels (4 bits each)
+    // High nibble = even pixel, low nibble = odd pixel
+    int byte_idx = (y * DISPLAY_WIDTH + x) / 2;
+    if (x % 2 == 0) {
+        fb[byte_idx] = (fb[byte_idx] & 0x0F) | (color << 4);
+    } else {
+        fb[byte_idx] = (fb[byte_idx] & 0xF0) | (color & 0x0F);
+    }
+}
+
+void gfx_fill_rect(uint8_t *fb, int x, int y, int w, int h, uint8_t color) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > DISPLAY_WIDTH ? DISPLAY_WIDTH : x + w;
+    int y1 = y + h > DISPLAY_HEIGHT ? DISPLAY_HEIGHT : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    uint8_t both = (uint8_t)((color << 4) | (color & 0x0F));
+    for (int py = y0; py < y1; py++) {
+        int px = x0;
+        // Odd left edge, then whole bytes, then an even right edge
+        if (px & 1) {
+            gfx_set_pixel(fb, px++, py, color);
+        }
+        int n = (x1 - px) / 2;
+        memset(&fb[(py * DISPLAY_WIDTH + px) / 2], both, n);
+        px += n * 2;
+        if (px < x1) {
+            gfx_set_pixel(fb, px, py, color);
+        }
+    }
+}
+
+void gfx_draw_rect(uint8_t *fb, int x, int y, int w, int h, uint8_t color, int thickness) {
+    // Top
+    gfx_fill_rect(fb, x, y, w, thickness, color);
+    // Bottom
+    gfx_fill_rect(fb, x, y + h - thickness, w, thickness, color);
+    // Left
+    gfx_fill_rect(fb, x, y, thickness, h, color);
+    // Right
+    gfx_fill_rect(fb, x + w - thickness, y, thickness, h, color);
+}
+
+void gfx_draw_line(uint8_t *fb, int x0, int y0, int x1, int y1, uint8_t color, int thickness) {
+    if (thickness < 1) thickness = 1;
+    int off = (thickness - 1) / 2;
+
+    // Bresenham, stamping a thickness x thickness square at every step
+    int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int e = dx + dy;
+    for (;;) {
+        gfx_fill_rect(fb, x0 - off, y0 - off, thickness, thickness, color);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * e;
+        if (e2 >= dy) {
+            e += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            e += dx;
+            y0 += sy;
+        }
+    }
+}
+
+uint8_t gfx_font_row(char c, int row) {
+    if (c < 32 || c > 126) c = '?';  // Replace unsupported chars
+    return font_8x16[c - 32][row];
+}
+
+void gfx_draw_char(uint8_t *fb, int x, int y, char c, uint8_t color, int scale) {
+    for (int row = 0; row < GFX_FONT_HEIGHT; row++) {
+        uint8_t row_data = gfx_font_row(c, row);
+        for (int col = 0; col < GFX_FONT_WIDTH; col++) {
+            if (row_data & (0x80 >> col)) {
+                gfx_fill_rect(fb, x + col * scale, y + row * scale, scale, scale, color);
+            }
+        }
+    }
+}
+
+int gfx_draw_text(uint8_t *fb, int x, int y, const char *str, uint8_t color, int scale, int max_x) {
+    int cursor_x = x;
+    int char_width = GFX_FONT_WIDTH * scale;
+    int line_height = GFX_FONT_HEIGHT * scale + GFX_LINE_GAP;
+
+    while (*str) {
+        if (*str == '\n') {
+            cursor_x = x;
+            y += line_height;
+        } else {
+            // Check if character fits on line
+            if (cursor_x + char_width > max_x && cursor_x > x) {
+                cursor_x = x;
+                y += line_height;
+            }
+            gfx_draw_char(fb, cursor_x, y, *str, color, scale);
+            cursor_x += char_width;
+        }
+        str++;
+    }
+    return y + line_height;
+}
+
+int gfx_text_width(const char *str, int scale) {
+    return (int)strcspn(str, "\n") * GFX_FONT_WIDTH * scale;
+}
+
+bool gfx_draw_icon(uint8_t *fb, int x, int y, const char *name, uint8_t color, int scale) {
+    for (size_t i = 0; i < sizeof(icons) / sizeof(icons[0]); i++) {
+        if (strcmp(icons[i].name, name) != 0) {
+            continue;
+        }
+        for (int row = 0; row < GFX_ICON_SIZE; row++) {
+            uint16_t bits = icons[i].rows[row];
+            for (int col = 0; col < GFX_ICON_SIZE; col++) {
+                if (bits & (0x8000 >> col)) {
+                    gfx_fill_rect(fb, x + col * scale, y + row * scale, scale, scale, color);
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file http_cache.c
+ * @brief Next-wake hints from HTTP cache headers
+ */
+
+#include "http_cache.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *const month_names[12] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date (no timegm() in newlib)
+static int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static int month_index(const char *name) {
+    for (int i = 0; i < 12; i++) {
+        if (strncasecmp(name, month_names[i], 3) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Non-negative decimal number, saturating; false if s has no digits
+static bool parse_seconds(const char *s, uint32_t *out) {
+    uint64_t v = 0;
+    if (*s == '"') {
+        s++;
+    }
+    if (!isdigit((unsigned char)*s)) {
+        return false;
+    }
+    while (isdigit((unsigned char)*s)) {
+        v = v * 10 + (uint64_t)(*s++ - '0');
+        if (v > UINT32_MAX) {
+            v = UINT32_MAX;
+        }
+    }
+    *out = (uint32_t)v;
+    return true;
+}
+
+bool http_cache_parse_date(const char *s, int64_t *out) {
+    char mon[4] = {0};
+    int day, year, hh, mm, ss;
+
+    // Skip the day name; formats differ after it
+    const char *p = s;
+    while (*p == ' ') {
+        p++;
+    }
+    while (isalpha((unsigned char)*p)) {
+        p++;
+    }
+
+    if (sscanf(p, ", %2d %3s %4d %2d:%2d:%2d", &day, mon, &year, &hh, &mm, &ss) == 6) {
+        // IMF-fixdate: Sun, 06 Nov 1994 08:49:37 GMT
+    } else if (sscanf(p, ", %2d-%3s-%4d %2d:%2d:%2d", &day, mon, &year, &hh, &mm, &ss) == 6) {
+        // RFC 850: Sunday, 06-Nov-94 08:49:37 GMT
+        if (year < 100) {
+            year += (year < 70) ? 2000 : 1900;
+        }
+    } else if (sscanf(p, " %3s %2d %2d:%2d:%2d %4d", mon, &day, &hh, &mm, &ss, &year) == 6) {
+        // asctime: Sun Nov  6 08:49:37 1994
+    } else {
+        return false;
+    }
+
+    int m = month_index(mon);
+    if (m < 0 || day < 1 || day > 31 || hh > 23 || mm > 59 || ss > 60) {
+        return false;
+    }
+    *out = days_from_civil(year, m + 1, day) * 86400 + hh * 3600 + mm * 60 + ss;
+    return true;
+}
+
+// Cache-Control: comma-separated directives, only the freshness ones matter
+static void parse_cache_control(http_cache_hints_t *h, const char *value) {
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        const char *end = p;
+        while (*end && *end != ',') {
+            end++;
+        }
+        size_t len = (size_t)(end - p);
+
+        if (len > 8 && strncasecmp(p, "max-age=", 8) == 0) {
+            if (parse_seconds(p + 8, &h->max_age_s)) {
+                h->flags |= HTTP_CACHE_HAS_MAX_AGE;
+            }
+        } else if ((len >= 8 && strncasecmp(p, "no-cache", 8) == 0) ||
+                   (len >= 8 && strncasecmp(p, "no-store", 8) == 0)) {
+            h->flags |= HTTP_CACHE_NO_CACHE;
+        }
+        p = end;
+    }
+}
+
+void http_cache_hints_reset(http_cache_hints_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void http_cache_parse_header(http_cache_hints_t *h, const char *name, const char *value) {
+    if (name == NULL || value == NULL) {
+        return;
+    }
+    while (*value == ' ') {
+        value++;
+    }
+
+    if (strcasecmp(name, "Cache-Control") == 0) {
+        parse_cache_control(h, value);
+    } else if (strcasecmp(name, "Age") == 0) {
+        if (parse_seconds(value, &h->age_s)) {
+            h->flags |= HTTP_CACHE_HAS_AGE;
+        }
+    } else if (strcasecmp(name, "Date") == 0) {
+        if (http_cache_parse_date(value, &h->date)) {
+            h->flags |= HTTP_CACHE_HAS_DATE;
+        }
+    } else if (strcasecmp(name, "Expires") == 0) {
+        // Invalid values (e.g. "0") mean already expired
+        if (!http_cache_parse_date(value, &h->expires)) {
+            h->expires = 0;
+        }
+        h->flags |= HTTP_CACHE_HAS_EXPIRES;
+    } else if (strcasecmp(name, "ETag") == 0) {
+        if (strlen(value) < HTTP_CACHE_ETAG_LEN) {
+            strcpy(h->etag, value);
+        }
+    } else if (strcasecmp(name, "Retry-After") == 0) {
+        if (parse_seconds(value, &h->retry_s)) {
+            h->flags |= HTTP_CACHE_HAS_RETRY_DELTA;
+        } else if (http_cache_parse_date(value, &h->retry_at)) {
+            h->flags |= HTTP_CACHE_HAS_RETRY_DATE;
+        }
+    }
+}
+
+// Seconds from the response (or now) until an absolute time
+static bool until(const http_cache_hints_t *h, int64_t when, int64_t now, uint32_t *out_s) {
+    int64_t ref = (h->flags & HTTP_CACHE_HAS_DATE) ? h->date : now;
+    if (ref <= 0) {
+        return false;  // Neither Date nor a set clock
+    }
+    int64_t delta = when - ref;
+    *out_s = (delta <= 0) ? 0 : (delta > UINT32_MAX) ? UINT32_MAX : (uint32_t)delta;
+    return true;
+}
+
+bool http_cache_next_change_s(const http_cache_hints_t *h, int status, int64_t now,
+                              uint32_t *out_s) {
+    if (status == 429 || status == 503) {
+        if (h->flags & HTTP_CACHE_HAS_RETRY_DELTA) {
+            *out_s = h->retry_s;
+            return true;
+        }
+        if (h->flags & HTTP_CACHE_HAS_RETRY_DATE) {
+            return until(h, h->retry_at, now, out_s);
+        }
+        return false;
+    }
+
+    // A 304 refreshes the stored response's freshness (RFC 9111 4.3.4)
+    if ((status != 200 && status != 304) || (h->flags & HTTP_CACHE_NO_CACHE)) {
+        return false;
+    }
+    if (h->flags & HTTP_CACHE_HAS_MAX_AGE) {
+        uint32_t age = (h->flags & HTTP_CACHE_HAS_AGE) ? h->age_s : 0;
+        *out_s = (h->max_age_s > age) ? h->max_age_s - age : 0;
+        return true;
+    }
+    if (h->flags & HTTP_CACHE_HAS_EXPIRES) {
+        if (h->expires == 0) {
+            *out_s = 0;
+            return true;
+        }
+        return until(h, h->expires, now, out_s);
+    }
+    return false;
+}
+
+uint32_t http_cache_policy_s(uint32_t hint_s, uint32_t min_s, uint32_t max_s, uint32_t limit_s) {
+    uint32_t sleep_s = hint_s;
+    if (sleep_s < min_s) {
+        sleep_s = min_s;
+    }
+    if (sleep_s > max_s) {
+        sleep_s = max_s;
+    }
+    return (sleep_s > limit_s) ? limit_s : sleep_s;
+}
@@ -8,18 +8,26 @@
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "http_cache.h"
 #include "pngle.h"
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 static const char *TAG = "IMG_PROC";
 
 // Error message buffer
 static char error_msg[128] = {0};
 
-// RGB pixel buffer for the display (800x480, allocated in PSRAM)
-static int16_t *rgb_buffer = NULL;  // Using int16 for dithering error accumulation
+// RGB pixel buffer for the display (IMAGE_WIDTH x IMAGE_HEIGHT, allocated in PSRAM)
+#define RGB_BUFFER_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT * 3)
+static uint8_t *rgb_buffer = NULL;
+
+// Floyd-Steinberg error of the current and next row, with one pixel of
+// padding on each side so edge pixels need no bounds checks
+static int16_t dither_err[2][(IMAGE_WIDTH + 2) * 3];
 
 // Source image buffer for scaling (allocated dynamically based on source size)
 static uint8_t *src_buffer = NULL;
@@ -37,26 +45,39 @@ static bool cfg_mirror_h = false;      // Mirror horizontally
 static bool cfg_mirror_v = false;      // Mirror vertically
 static bool cfg_rotate_first = true;   // Rotate before mirroring
 
+// Region settings: the display shows the window at (x, y) of a larger canvas
+static uint32_t cfg_canvas_width = IMAGE_WIDTH;   // Whole image area across all panels
+static uint32_t cfg_canvas_height = IMAGE_HEIGHT;
+static uint32_t cfg_region_x = 0;                 // Top-left of this display in the canvas
+static uint32_t cfg_region_y = 0;
+
 // SSL settings
 static bool cfg_skip_ssl = false;      // Skip SSL certificate verification
 
-// E-paper 6-color palette (RGB values)
-// Black, White, Yellow, Red, Orange, Blue, Green
-static const uint8_t palette[7][3] = {
-    {0, 0, 0},       // 0: Black
-    {255, 255, 255}, // 1: White
-    {255, 255, 0},   // 2: Yellow
-    {255, 0, 0},     // 3: Red
-    {255, 128, 0},   // 4: Orange
-    {0, 0, 255},     // 5: Blue
-    {0, 255, 0}      // 6: Green
-};
+// With keep-alive on, one HTTP client (and its connection) serves all fetches
+static bool cfg_keep_alive = false;
+static esp_http_client_handle_t keep_client = NULL;
+
+// E-paper palette of the selected panel: R, G, B, color code
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
 
 // HTTP response buffer
 static uint8_t *http_buffer = NULL;
 static size_t http_buffer_size = 0;
 static size_t http_buffer_pos = 0;
 
+// Decoder of a PNG pushed in pieces (image_processor_png_begin()), the
+// bytes it could not consume yet, and whether IEND was reached
+static pngle_t *push_pngle = NULL;
+static uint8_t push_carry[64];
+static size_t push_carry_len = 0;
+static bool push_done = false;
+
+// Cache headers of the current request, and the earliest time (esp_timer us)
+// any download of this wake expects new content (-1 = no hint)
+static http_cache_hints_t cache_hints;
+static int64_t next_change_us = -1;
+
 /**
  * @brief Calculate color distance squared (for finding closest palette color)
  */
@@ -80,7 +101,7 @@ static uint8_t find_closest_color(int16_t r, int16_t g, int16_t b) {
     uint8_t best_idx = 0;
     int32_t best_dist = INT32_MAX;
 
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
         int32_t dist = color_distance_sq(r, g, b, palette[i][0], palette[i][1], palette[i][2]);
         if (dist < best_dist) {
             best_dist = dist;
@@ -97,7 +118,7 @@ static uint8_t find_closest_color(int16_t r, int16_t g, int16_t b) {
 static void png_init_callback(pngle_t *pngle, uint32_t w, uint32_t h) {
     ESP_LOGI(TAG, "PNG header: %lux%lu", (unsigned long)w, (unsigned long)h);
 
-    if (cfg_scale_to_fit && (w != IMAGE_WIDTH || h != IMAGE_HEIGHT)) {
+    if (cfg_scale_to_fit && (w != cfg_canvas_width || h != cfg_canvas_height)) {
         // Allocate source buffer for scaling
         src_buffer_width = w;
         src_buffer_height = h;
@@ -130,7 +151,10 @@ static void png_draw_callback(pngle_t *pngle, uint32_t x, uint32_t y,
             src_buffer[idx + 2] = rgba[2];
         }
     } else {
-        // Direct mode: store in rgb_buffer (crop if larger)
+        // Direct mode: store this display's region in rgb_buffer (crop if larger)
+        if (x < cfg_region_x || y < cfg_region_y) return;
+        x -= cfg_region_x;
+        y -= cfg_region_y;
         if (x >= IMAGE_WIDTH || y >= IMAGE_HEIGHT) return;
         if (rgb_buffer == NULL) return;
 
@@ -148,18 +172,24 @@ static void scale_image_to_display(void) {
     if (src_buffer == NULL || rgb_buffer == NULL) return;
     if (src_buffer_width == 0 || src_buffer_height == 0) return;
 
-    ESP_LOGI(TAG, "Scaling image from %lux%lu to %dx%d",
+    ESP_LOGI(TAG, "Scaling image from %lux%lu to %lux%lu",
              (unsigned long)src_buffer_width, (unsigned long)src_buffer_height,
-             IMAGE_WIDTH, IMAGE_HEIGHT);
+             (unsigned long)cfg_canvas_width, (unsigned long)cfg_canvas_height);
+
+    float x_ratio = (float)src_buffer_width / cfg_canvas_width;
+    float y_ratio = (float)src_buffer_height / cfg_canvas_height;
 
-    float x_ratio = (float)src_buffer_width / IMAGE_WIDTH;
-    float y_ratio = (float)src_buffer_height / IMAGE_HEIGHT;
+    // Part of the canvas on this display (a tile's canvas is smaller than it)
+    uint32_t out_w = cfg_canvas_width - cfg_region_x;
+    uint32_t out_h = cfg_canvas_height - cfg_region_y;
+    if (out_w > IMAGE_WIDTH) out_w = IMAGE_WIDTH;
+    if (out_h > IMAGE_HEIGHT) out_h = IMAGE_HEIGHT;
 
-    for (uint32_t dst_y = 0; dst_y < IMAGE_HEIGHT; dst_y++) {
-        for (uint32_t dst_x = 0; dst_x < IMAGE_WIDTH; dst_x++) {
-            // Calculate source position
-            float src_x = dst_x * x_ratio;
-            float src_y = dst_y * y_ratio;
+    for (uint32_t dst_y = 0; dst_y < out_h; dst_y++) {
+        for (uint32_t dst_x = 0; dst_x < out_w; dst_x++) {
+            // Calculate source position (of this display's region in the canvas)
+            float src_x = (dst_x + cfg_region_x) * x_ratio;
+            float src_y = (dst_y + cfg_region_y) * y_ratio;
 
             // Get integer and fractional parts
             uint32_t x0 = (uint32_t)src_x;
@@ -182,7 +212,7 @@ static void scale_image_to_display(void) {
                 float val = top * (1 - y_frac) + bot * y_frac;
 
                 uint32_t dst_idx = (dst_y * IMAGE_WIDTH + dst_x) * 3;
-                rgb_buffer[dst_idx + c] = (int16_t)(val + 0.5f);
+                rgb_buffer[dst_idx + c] = (uint8_t)(val + 0.5f);
             }
         }
     }
@@ -258,76 +288,129 @@ static void transform_coords(uint32_t x, uint32_t y, uint32_t *out_x, uint32_t *
     *out_y = ty;
 }
 
+bool image_processor_can_stream(void) {
+    if (cfg_rotation == 90 || cfg_rotation == 270) {
+        return false;
+    }
+    // Source row 0 must land on output row 0 (no net vertical flip)
+    uint32_t out_x, out_y;
+    transform_coords(0, 0, &out_x, &out_y);
+    return out_y == 0;
+}
+
+/**
+ * @brief Quantize one pixel and diffuse its error (Floyd-Steinberg)
+ * @param rgb Source pixel
+ * @param err_cur Error of the current row (padded by one pixel each side)
+ * @param err_next Error of the next row
+ * @param e Offset of the pixel in the error rows (x * 3)
+ * @return Palette index
+ */
+static inline uint8_t dither_pixel(const uint8_t *rgb, int16_t *err_cur, int16_t *err_next, int32_t e) {
+    // Get current pixel color (with accumulated error)
+    int16_t old_r = rgb[0] + err_cur[e + 0];
+    int16_t old_g = rgb[1] + err_cur[e + 1];
+    int16_t old_b = rgb[2] + err_cur[e + 2];
+
+    // Find closest palette color
+    uint8_t color_idx = find_closest_color(old_r, old_g, old_b);
+
+    // Calculate quantization error
+    int16_t err_r = old_r - palette[color_idx][0];
+    int16_t err_g = old_g - palette[color_idx][1];
+    int16_t err_b = old_b - palette[color_idx][2];
+
+    // Distribute error to neighboring pixels (Floyd-Steinberg coefficients);
+    // contributions past the edges land in the padding and are dropped
+    // Right pixel: 7/16
+    err_cur[e + 3] += (err_r * 7) / 16;
+    err_cur[e + 4] += (err_g * 7) / 16;
+    err_cur[e + 5] += (err_b * 7) / 16;
+    // Bottom-left pixel: 3/16
+    err_next[e - 3] += (err_r * 3) / 16;
+    err_next[e - 2] += (err_g * 3) / 16;
+    err_next[e - 1] += (err_b * 3) / 16;
+    // Bottom pixel: 5/16
+    err_next[e + 0] += (err_r * 5) / 16;
+    err_next[e + 1] += (err_g * 5) / 16;
+    err_next[e + 2] += (err_b * 5) / 16;
+    // Bottom-right pixel: 1/16
+    err_next[e + 3] += (err_r * 1) / 16;
+    err_next[e + 4] += (err_g * 1) / 16;
+    err_next[e + 5] += (err_b * 1) / 16;
+
+    return color_idx;
+}
+
+// Store a color code in the nibble for column x
+static inline void pack_pixel(uint8_t *dst, uint32_t x, uint8_t code) {
+    if ((x & 1) == 0) {
+        *dst = (*dst & 0x0F) | (code << 4);
+    } else {
+        *dst = (*dst & 0xF0) | code;
+    }
+}
+
 /**
  * @brief Apply Floyd-Steinberg dithering and convert to e-paper format
+ *
+ * When a row sink is given and the transform keeps raster order, each packed
+ * row is handed to the sink as soon as it is complete. Otherwise the frame is
+ * packed into output_buffer first and passed to the sink row by row afterwards.
+ * output_buffer may be NULL only in the streaming case.
  */
-static void apply_dithering(uint8_t *output_buffer) {
-    ESP_LOGI(TAG, "Applying Floyd-Steinberg dithering (rotation=%d, mirror_h=%d, mirror_v=%d)...",
-             cfg_rotation, cfg_mirror_h, cfg_mirror_v);
+static void apply_dithering(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx) {
+    bool stream = (sink != NULL) && image_processor_can_stream();
+    static uint8_t row_buf[IMAGE_ROW_BYTES];
+
+    ESP_LOGI(TAG, "Applying Floyd-Steinberg dithering (rotation=%d, mirror_h=%d, mirror_v=%d, %s)...",
+             cfg_rotation, cfg_mirror_h, cfg_mirror_v, stream ? "streaming" : "buffered");
 
     // Clear output buffer
-    memset(output_buffer, 0, IMAGE_BUFFER_SIZE);
+    if (output_buffer != NULL) {
+        memset(output_buffer, 0, IMAGE_BUFFER_SIZE);
+    }
+
+    int16_t *err_cur = dither_err[0] + 3;
+    int16_t *err_next = dither_err[1] + 3;
+    memset(dither_err, 0, sizeof(dither_err));
 
     for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+        if (stream) {
+            memset(row_buf, 0, sizeof(row_buf));
+        }
+
         for (uint32_t x = 0; x < IMAGE_WIDTH; x++) {
-            uint32_t idx = (y * IMAGE_WIDTH + x) * 3;
-
-            // Get current pixel color (with accumulated error)
-            int16_t old_r = rgb_buffer[idx + 0];
-            int16_t old_g = rgb_buffer[idx + 1];
-            int16_t old_b = rgb_buffer[idx + 2];
-
-            // Find closest palette color
-            uint8_t color_idx = find_closest_color(old_r, old_g, old_b);
-
-            // Calculate quantization error
-            int16_t err_r = old_r - palette[color_idx][0];
-            int16_t err_g = old_g - palette[color_idx][1];
-            int16_t err_b = old_b - palette[color_idx][2];
-
-            // Distribute error to neighboring pixels (Floyd-Steinberg coefficients)
-            // Right pixel: 7/16
-            if (x + 1 < IMAGE_WIDTH) {
-                uint32_t nidx = idx + 3;
-                rgb_buffer[nidx + 0] += (err_r * 7) / 16;
-                rgb_buffer[nidx + 1] += (err_g * 7) / 16;
-                rgb_buffer[nidx + 2] += (err_b * 7) / 16;
-            }
-            // Bottom-left pixel: 3/16
-            if (y + 1 < IMAGE_HEIGHT && x > 0) {
-                uint32_t nidx = ((y + 1) * IMAGE_WIDTH + (x - 1)) * 3;
-                rgb_buffer[nidx + 0] += (err_r * 3) / 16;
-                rgb_buffer[nidx + 1] += (err_g * 3) / 16;
-                rgb_buffer[nidx + 2] += (err_b * 3) / 16;
-            }
-            // Bottom pixel: 5/16
-            if (y + 1 < IMAGE_HEIGHT) {
-                uint32_t nidx = ((y + 1) * IMAGE_WIDTH + x) * 3;
-                rgb_buffer[nidx + 0] += (err_r * 5) / 16;
-                rgb_buffer[nidx + 1] += (err_g * 5) / 16;
-                rgb_buffer[nidx + 2] += (err_b * 5) / 16;
-            }
-            // Bottom-right pixel: 1/16
-            if (y + 1 < IMAGE_HEIGHT && x + 1 < IMAGE_WIDTH) {
-                uint32_t nidx = ((y + 1) * IMAGE_WIDTH + (x + 1)) * 3;
-                rgb_buffer[nidx + 0] += (err_r * 1) / 16;
-                rgb_buffer[nidx + 1] += (err_g * 1) / 16;
-                rgb_buffer[nidx + 2] += (err_b * 1) / 16;
-            }
+            uint8_t color_idx = dither_pixel(&rgb_buffer[(y * IMAGE_WIDTH + x) * 3],
+                                             err_cur, err_next, x * 3);
 
-            // Apply transformation and pack into output buffer
+            // Apply transformation and pack into output buffer (or the current row)
             uint32_t out_x, out_y;
             transform_coords(x, y, &out_x, &out_y);
 
-            // For 90/270 rotation, output dimensions are swapped
-            uint32_t out_width = (cfg_rotation == 90 || cfg_rotation == 270) ? IMAGE_HEIGHT : IMAGE_WIDTH;
-            uint32_t out_idx = (out_y * out_width + out_x) / 2;
-
-            if ((out_x & 1) == 0) {
-                output_buffer[out_idx] = (output_buffer[out_idx] & 0x0F) | (color_idx << 4);
+            uint8_t *dst;
+            if (stream) {
+                dst = &row_buf[out_x / 2];
             } else {
-                output_buffer[out_idx] = (output_buffer[out_idx] & 0xF0) | color_idx;
+                // For 90/270 rotation, output dimensions are swapped
+                uint32_t out_width = (cfg_rotation == 90 || cfg_rotation == 270) ? IMAGE_HEIGHT : IMAGE_WIDTH;
+                dst = &output_buffer[(out_y * out_width + out_x) / 2];
+            }
+
+            pack_pixel(dst, out_x, palette[color_idx][3]);
+        }
+
+        // The next row's error becomes current; start a fresh next row
+        int16_t *tmp = err_cur;
+        err_cur = err_next;
+        err_next = tmp;
+        memset(err_next - 3, 0, sizeof(dither_err[0]));
+
+        if (stream) {
+            if (output_buffer != NULL) {
+                memcpy(output_buffer + y * IMAGE_ROW_BYTES, row_buf, IMAGE_ROW_BYTES);
             }
+            sink(y, row_buf, IMAGE_ROW_BYTES, sink_ctx);
         }
 
         // Yield periodically to prevent watchdog timeout
@@ -336,14 +419,57 @@ static void apply_dithering(uint8_t *output_buffer) {
         }
     }
 
+    // Transform does not follow raster order: hand over the finished frame
+    if (sink != NULL && !stream) {
+        for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+            sink(y, output_buffer + y * IMAGE_ROW_BYTES, IMAGE_ROW_BYTES, sink_ctx);
+        }
+    }
+
     ESP_LOGI(TAG, "Dithering complete");
 }
 
+/**
+ * @brief Dither a tile from the top-left of rgb_buffer into a packed frame
+ *
+ * The error diffusion stops at the tile edges, so a tile dithers the same
+ * whatever its neighbours show and can be redrawn on its own. Pixels go
+ * through the transform like a full image at (x0, y0).
+ */
+static void dither_tile(uint8_t *frame, uint32_t x0, uint32_t y0, uint32_t w, uint32_t h) {
+    uint32_t out_width = (cfg_rotation == 90 || cfg_rotation == 270) ? IMAGE_HEIGHT : IMAGE_WIDTH;
+    int16_t *err_cur = dither_err[0] + 3;
+    int16_t *err_next = dither_err[1] + 3;
+    memset(dither_err, 0, sizeof(dither_err));
+
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            uint8_t color_idx = dither_pixel(&rgb_buffer[(y * IMAGE_WIDTH + x) * 3],
+                                             err_cur, err_next, x * 3);
+            uint32_t out_x, out_y;
+            transform_coords(x0 + x, y0 + y, &out_x, &out_y);
+            pack_pixel(&frame[(out_y * out_width + out_x) / 2], out_x, palette[color_idx][3]);
+        }
+
+        int16_t *tmp = err_cur;
+        err_cur = err_next;
+        err_next = tmp;
+        memset(err_next - 3, 0, sizeof(dither_err[0]));
+
+        if ((y % 50) == 0) {
+            taskYIELD();
+        }
+    }
+}
+
 /**
  * @brief HTTP event handler for downloading image data
  */
 static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     switch (evt->event_id) {
+        case HTTP_EVENT_ON_HEADER:
+            http_cache_parse_header(&cache_hints, evt->header_key, evt->header_value);
+            break;
         case HTTP_EVENT_ON_DATA:
             if (http_buffer && http_buffer_pos + evt->data_len <= http_buffer_size) {
                 memcpy(http_buffer + http_buffer_pos, evt->data, evt->data_len);
@@ -356,12 +482,27 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
+// Fold the cache headers of a finished request into next_change_us
+static void note_cache_hints(int status_code) {
+    time_t now = time(NULL);
+    uint32_t delay_s;
+
+    // Before 2020 the clock has not been set
+    if (!http_cache_next_change_s(&cache_hints, status_code, now > 1577836800 ? now : 0, &delay_s)) {
+        return;
+    }
+    int64_t at_us = esp_timer_get_time() + (int64_t)delay_s * 1000000;
+    if (next_change_us < 0 || at_us < next_change_us) {
+        next_change_us = at_us;
+    }
+    ESP_LOGI(TAG, "Server expects new content in %lu s (HTTP %d)", (unsigned long)delay_s, status_code);
+}
+
 esp_err_t image_processor_init(void) {
     ESP_LOGI(TAG, "Initializing image processor");
 
-    // Allocate RGB buffer in PSRAM (800x480x3 = 1,152,000 bytes as int16 = 2,304,000 bytes)
-    rgb_buffer = heap_caps_malloc(IMAGE_WIDTH * IMAGE_HEIGHT * 3 * sizeof(int16_t),
-                                   MALLOC_CAP_SPIRAM);
+    // Allocate RGB buffer in PSRAM (3 bytes per pixel, 1,152,000 bytes for 800x480)
+    rgb_buffer = heap_caps_malloc(RGB_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
     if (rgb_buffer == NULL) {
         snprintf(error_msg, sizeof(error_msg), "Failed to allocate RGB buffer in PSRAM");
         ESP_LOGE(TAG, "%s", error_msg);
@@ -369,7 +510,7 @@ esp_err_t image_processor_init(void) {
     }
 
     ESP_LOGI(TAG, "Image processor initialized (RGB buffer: %d bytes in PSRAM)",
-             IMAGE_WIDTH * IMAGE_HEIGHT * 3 * (int)sizeof(int16_t));
+             RGB_BUFFER_SIZE);
     return ESP_OK;
 }
 
@@ -391,16 +532,53 @@ void image_processor_set_transform(uint16_t rotation, bool mirror_h, bool mirror
              cfg_rotation, mirror_h ? "yes" : "no", mirror_v ? "yes" : "no", rotate_first ? "yes" : "no");
 }
 
+void image_processor_set_region(uint16_t canvas_width, uint16_t canvas_height,
+                                uint16_t x, uint16_t y) {
+    cfg_canvas_width = canvas_width ? canvas_width : IMAGE_WIDTH;
+    cfg_canvas_height = canvas_height ? canvas_height : IMAGE_HEIGHT;
+    cfg_region_x = x;
+    cfg_region_y = y;
+    ESP_LOGI(TAG, "Region config: canvas=%dx%d, offset=%d,%d",
+             (int)cfg_canvas_width, (int)cfg_canvas_height, x, y);
+}
+
 void image_processor_set_ssl_skip(bool skip) {
     cfg_skip_ssl = skip;
     ESP_LOGI(TAG, "SSL verification: %s", skip ? "SKIP (allow self-signed)" : "ENFORCE");
 }
 
+void image_processor_set_keep_alive(bool keep) {
+    cfg_keep_alive = keep;
+    if (!keep && keep_client != NULL) {
+        esp_http_client_cleanup(keep_client);
+        keep_client = NULL;
+    }
+}
+
 esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
+    if (output_buffer == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    return image_download_and_stream(url, output_buffer, NULL, NULL);
+}
+
+esp_err_t image_download_and_stream(const char *url, uint8_t *output_buffer,
+                                    image_row_sink_t sink, void *sink_ctx) {
+    esp_err_t ret = image_processor_fetch(url);
+    if (ret == ESP_OK) {
+        ret = image_processor_render(output_buffer, sink, sink_ctx);
+    }
+    image_processor_release();
+    return ret;
+}
+
+// Download url into http_buffer. With an ETag the request is conditional;
+// a 304 reply leaves the buffer empty and clears *changed.
+static esp_err_t fetch(const char *url, const char *etag, bool *changed) {
     esp_err_t ret = ESP_OK;
-    pngle_t *pngle = NULL;
 
-    if (url == NULL || output_buffer == NULL) {
+    if (url == NULL) {
         snprintf(error_msg, sizeof(error_msg), "Invalid parameters");
         return ESP_ERR_INVALID_ARG;
     }
@@ -412,17 +590,15 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
 
     ESP_LOGI(TAG, "Downloading image from: %s", url);
 
-    // Clear RGB buffer
-    memset(rgb_buffer, 0, IMAGE_WIDTH * IMAGE_HEIGHT * 3 * sizeof(int16_t));
-    memset(output_buffer, 0, IMAGE_BUFFER_SIZE);
-
-    // Allocate HTTP buffer (max 2MB for PNG)
-    http_buffer_size = 2 * 1024 * 1024;
-    http_buffer = heap_caps_malloc(http_buffer_size, MALLOC_CAP_SPIRAM);
+    // Allocate HTTP buffer (max 2MB for PNG), reused by consecutive fetches
     if (http_buffer == NULL) {
-        snprintf(error_msg, sizeof(error_msg), "Failed to allocate HTTP buffer");
-        ESP_LOGE(TAG, "%s", error_msg);
-        return ESP_ERR_NO_MEM;
+        http_buffer_size = 2 * 1024 * 1024;
+        http_buffer = heap_caps_malloc(http_buffer_size, MALLOC_CAP_SPIRAM);
+        if (http_buffer == NULL) {
+            snprintf(error_msg, sizeof(error_msg), "Failed to allocate HTTP buffer");
+            ESP_LOGE(TAG, "%s", error_msg);
+            return ESP_ERR_NO_MEM;
+        }
     }
     http_buffer_pos = 0;
 
@@ -443,15 +619,31 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
         config.crt_bundle_attach = esp_crt_bundle_attach;
     }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        snprintf(error_msg, sizeof(error_msg), "Failed to initialize HTTP client");
-        ESP_LOGE(TAG, "%s", error_msg);
-        ret = ESP_FAIL;
-        goto cleanup;
+    // A kept client reconnects by itself if the host changed or the server
+    // closed the connection
+    esp_http_client_handle_t client = keep_client;
+    if (client != NULL) {
+        esp_http_client_set_url(client, url);
+    } else {
+        client = esp_http_client_init(&config);
+        if (client == NULL) {
+            snprintf(error_msg, sizeof(error_msg), "Failed to initialize HTTP client");
+            ESP_LOGE(TAG, "%s", error_msg);
+            return ESP_FAIL;
+        }
+        if (cfg_keep_alive) {
+            keep_client = client;
+        }
+    }
+
+    if (etag != NULL && etag[0] != '\0') {
+        esp_http_client_set_header(client, "If-None-Match", etag);
+    } else {
+        esp_http_client_delete_header(client, "If-None-Match");
     }
 
     // Perform HTTP request
+    http_cache_hints_reset(&cache_hints);
     ret = esp_http_client_perform(client);
     if (ret != ESP_OK) {
         snprintf(error_msg, sizeof(error_msg), "HTTP request failed: %s", esp_err_to_name(ret));
@@ -460,6 +652,14 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
     }
 
     int status_code = esp_http_client_get_status_code(client);
+    note_cache_hints(status_code);
+    if (status_code == 304 && changed != NULL && etag != NULL) {
+        ESP_LOGI(TAG, "Not modified (ETag %s)", etag);
+        strncpy(cache_hints.etag, etag, HTTP_CACHE_ETAG_LEN - 1);  // 304 need not repeat it
+        http_buffer_pos = 0;
+        *changed = false;
+        goto cleanup;
+    }
     if (status_code != 200) {
         snprintf(error_msg, sizeof(error_msg), "HTTP error: %d", status_code);
         ESP_LOGE(TAG, "%s", error_msg);
@@ -467,8 +667,41 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
         goto cleanup;
     }
 
-    ESP_LOGI(TAG, "Downloaded %d bytes, decoding PNG...", (int)http_buffer_pos);
+    ESP_LOGI(TAG, "Downloaded %d bytes", (int)http_buffer_pos);
+    if (changed != NULL) {
+        *changed = true;
+    }
 
+cleanup:
+    // A failed request may leave the kept connection in any state
+    if (client != keep_client || ret != ESP_OK) {
+        esp_http_client_cleanup(client);
+        if (client == keep_client) {
+            keep_client = NULL;
+        }
+    }
+    if (ret != ESP_OK) {
+        http_buffer_pos = 0;
+    }
+    return ret;
+}
+
+esp_err_t image_processor_fetch(const char *url) {
+    return fetch(url, NULL, NULL);
+}
+
+esp_err_t image_processor_fetch_if_changed(const char *url, const char *etag, bool *changed) {
+    *changed = true;
+    return fetch(url, etag, changed);
+}
+
+const uint8_t *image_processor_get_data(size_t *len) {
+    *len = http_buffer_pos;
+    return http_buffer;
+}
+
+// Start decoding a PNG into rgb_buffer (see decode_png())
+static pngle_t *decode_start(void) {
     // Reset source buffer state
     if (src_buffer) {
         heap_caps_free(src_buffer);
@@ -478,23 +711,22 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
     src_buffer_height = 0;
 
     // Initialize PNG decoder
-    pngle = pngle_new();
+    pngle_t *pngle = pngle_new();
     if (pngle == NULL) {
         snprintf(error_msg, sizeof(error_msg), "Failed to create PNG decoder");
         ESP_LOGE(TAG, "%s", error_msg);
-        ret = ESP_ERR_NO_MEM;
-        goto cleanup;
+        return NULL;
     }
 
     pngle_set_init_callback(pngle, png_init_callback);
     pngle_set_draw_callback(pngle, png_draw_callback);
+    return pngle;
+}
 
-    // Feed PNG data to decoder
-    int fed = pngle_feed(pngle, http_buffer, http_buffer_pos);
-    if (fed < 0) {
-        snprintf(error_msg, sizeof(error_msg), "PNG decode error: %s", pngle_error(pngle));
-        ESP_LOGE(TAG, "%s", error_msg);
-        ret = ESP_FAIL;
+// Finish a decode started by decode_start(): scale if enabled and free the
+// decoder. ret is the result of feeding the data
+static esp_err_t decode_finish(pngle_t *pngle, esp_err_t ret) {
+    if (ret != ESP_OK) {
         goto cleanup;
     }
 
@@ -506,31 +738,253 @@ esp_err_t image_download_and_process(const char *url, uint8_t *output_buffer) {
     // If scaling was used, scale to display size now
     if (cfg_scale_to_fit && src_buffer != NULL) {
         scale_image_to_display();
-    } else if (png_width != IMAGE_WIDTH || png_height != IMAGE_HEIGHT) {
-        ESP_LOGW(TAG, "Image size mismatch (expected %dx%d), image was cropped/padded",
-                 IMAGE_WIDTH, IMAGE_HEIGHT);
+    } else if (png_width != cfg_canvas_width || png_height != cfg_canvas_height) {
+        ESP_LOGW(TAG, "Image size mismatch (expected %lux%lu), image was cropped/padded",
+                 (unsigned long)cfg_canvas_width, (unsigned long)cfg_canvas_height);
+    }
+
+cleanup:
+    pngle_destroy(pngle);
+    if (src_buffer) {
+        heap_caps_free(src_buffer);
+        src_buffer = NULL;
+        src_buffer_width = 0;
+        src_buffer_height = 0;
+    }
+    return ret;
+}
+
+// Decode a PNG into rgb_buffer: this display's region of the canvas, scaled
+// to the canvas if enabled
+static esp_err_t decode_png(const uint8_t *data, size_t len) {
+    pngle_t *pngle = decode_start();
+    if (pngle == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Feed PNG data to decoder
+    esp_err_t ret = ESP_OK;
+    if (pngle_feed(pngle, data, len) < 0) {
+        snprintf(error_msg, sizeof(error_msg), "PNG decode error: %s", pngle_error(pngle));
+        ESP_LOGE(TAG, "%s", error_msg);
+        ret = ESP_FAIL;
+    }
+    return decode_finish(pngle, ret);
+}
+
+// Dither rgb_buffer into the output buffer and/or the sink
+static esp_err_t dither_frame(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx) {
+    uint8_t *frame_buffer = output_buffer;
+
+    // Buffered fallback for non-streamable transforms needs a whole frame
+    if (frame_buffer == NULL && !image_processor_can_stream()) {
+        frame_buffer = heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+        if (frame_buffer == NULL) {
+            snprintf(error_msg, sizeof(error_msg), "Failed to allocate frame buffer");
+            ESP_LOGE(TAG, "%s", error_msg);
+            return ESP_ERR_NO_MEM;
+        }
     }
 
     // Apply dithering and convert to e-paper format
-    apply_dithering(output_buffer);
+    apply_dithering(frame_buffer, sink, sink_ctx);
 
     ESP_LOGI(TAG, "Image processing complete");
 
-cleanup:
-    if (pngle) pngle_destroy(pngle);
-    if (client) esp_http_client_cleanup(client);
+    if (frame_buffer != output_buffer) {
+        heap_caps_free(frame_buffer);
+    }
+    return ESP_OK;
+}
+
+esp_err_t image_processor_render(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx) {
+    esp_err_t ret = ESP_OK;
+
+    if (output_buffer == NULL && sink == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (rgb_buffer == NULL || http_buffer == NULL || http_buffer_pos == 0) {
+        snprintf(error_msg, sizeof(error_msg), "No image data downloaded");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Decoding PNG (region %lu,%lu of %lux%lu)...",
+             (unsigned long)cfg_region_x, (unsigned long)cfg_region_y,
+             (unsigned long)cfg_canvas_width, (unsigned long)cfg_canvas_height);
+
+    // Clear RGB buffer
+    memset(rgb_buffer, 0, RGB_BUFFER_SIZE);
+
+    ret = decode_png(http_buffer, http_buffer_pos);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return dither_frame(output_buffer, sink, sink_ctx);
+}
+
+// pngle done callback for pushed PNGs
+static void png_push_done(pngle_t *pngle) {
+    push_done = true;
+}
+
+esp_err_t image_processor_png_begin(void) {
+    if (rgb_buffer == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Image processor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (push_pngle != NULL) {
+        decode_finish(push_pngle, ESP_FAIL);
+    }
+
+    memset(rgb_buffer, 0, RGB_BUFFER_SIZE);
+    push_carry_len = 0;
+    push_done = false;
+    push_pngle = decode_start();
+    if (push_pngle == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pngle_set_done_callback(push_pngle, png_push_done);
+    return ESP_OK;
+}
+
+// Stop a pushed decode after an error
+static esp_err_t png_push_fail(void) {
+    ESP_LOGE(TAG, "%s", error_msg);
+    decode_finish(push_pngle, ESP_FAIL);
+    push_pngle = NULL;
+    return ESP_FAIL;
+}
+
+esp_err_t image_processor_png_feed(const uint8_t *data, size_t len) {
+    if (push_pngle == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "No PNG decode started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // pngle leaves bytes it cannot use yet (a partial chunk header) for the
+    // next call; they are kept in push_carry and completed from the new data
+    while (push_carry_len > 0 && len > 0) {
+        size_t n = sizeof(push_carry) - push_carry_len;
+        if (n > len) n = len;
+        memcpy(push_carry + push_carry_len, data, n);
+        push_carry_len += n;
+        data += n;
+        len -= n;
+
+        int fed = pngle_feed(push_pngle, push_carry, push_carry_len);
+        if (fed < 0) {
+            snprintf(error_msg, sizeof(error_msg), "PNG decode error: %s", pngle_error(push_pngle));
+            return png_push_fail();
+        }
+        if (fed == 0 && push_carry_len == sizeof(push_carry)) {
+            snprintf(error_msg, sizeof(error_msg), "PNG decode stalled");
+            return png_push_fail();
+        }
+        memmove(push_carry, push_carry + fed, push_carry_len - fed);
+        push_carry_len -= fed;
+    }
+    if (len == 0) {
+        return ESP_OK;
+    }
+
+    int fed = pngle_feed(push_pngle, data, len);
+    if (fed < 0) {
+        snprintf(error_msg, sizeof(error_msg), "PNG decode error: %s", pngle_error(push_pngle));
+        return png_push_fail();
+    }
+    if (len - fed > sizeof(push_carry)) {
+        snprintf(error_msg, sizeof(error_msg), "PNG decode stalled");
+        return png_push_fail();
+    }
+    memcpy(push_carry, data + fed, len - fed);
+    push_carry_len = len - fed;
+    return ESP_OK;
+}
+
+esp_err_t image_processor_png_end(uint8_t *output_buffer, image_row_sink_t sink, void *sink_ctx) {
+    if (push_pngle == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "No PNG decode started");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (output_buffer == NULL && sink == NULL) {
+        decode_finish(push_pngle, ESP_FAIL);
+        push_pngle = NULL;
+        snprintf(error_msg, sizeof(error_msg), "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (!push_done) {
+        snprintf(error_msg, sizeof(error_msg), "PNG data incomplete");
+        ESP_LOGE(TAG, "%s", error_msg);
+        ret = ESP_FAIL;
+    }
+    ret = decode_finish(push_pngle, ret);
+    push_pngle = NULL;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return dither_frame(output_buffer, sink, sink_ctx);
+}
+
+esp_err_t image_processor_render_tile(const uint8_t *png, size_t len, uint8_t *frame,
+                                      uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    if (png == NULL || len == 0 || frame == NULL || w == 0 || h == 0 ||
+        x + w > IMAGE_WIDTH || y + h > IMAGE_HEIGHT) {
+        snprintf(error_msg, sizeof(error_msg), "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rgb_buffer == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Image processor not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Decoding tile %ux%u at %u,%u...", w, h, x, y);
+
+    // The tile is the canvas; it is padded with white if the image is smaller
+    uint32_t canvas_w = cfg_canvas_width, canvas_h = cfg_canvas_height;
+    uint32_t region_x = cfg_region_x, region_y = cfg_region_y;
+    cfg_canvas_width = w;
+    cfg_canvas_height = h;
+    cfg_region_x = 0;
+    cfg_region_y = 0;
+    memset(rgb_buffer, 255, (size_t)h * IMAGE_WIDTH * 3);
+
+    esp_err_t ret = decode_png(png, len);
+
+    cfg_canvas_width = canvas_w;
+    cfg_canvas_height = canvas_h;
+    cfg_region_x = region_x;
+    cfg_region_y = region_y;
+
+    if (ret == ESP_OK) {
+        dither_tile(frame, x, y, w, h);
+    }
+    return ret;
+}
+
+void image_processor_release(void) {
     if (http_buffer) {
         heap_caps_free(http_buffer);
         http_buffer = NULL;
     }
-    if (src_buffer) {
-        heap_caps_free(src_buffer);
-        src_buffer = NULL;
-        src_buffer_width = 0;
-        src_buffer_height = 0;
+    http_buffer_size = 0;
+    http_buffer_pos = 0;
+}
+
+bool image_processor_get_next_change(uint32_t *seconds) {
+    if (next_change_us < 0) {
+        return false;
     }
+    int64_t remaining_us = next_change_us - esp_timer_get_time();
+    *seconds = (remaining_us > 0) ? (uint32_t)((remaining_us + 999999) / 1000000) : 0;
+    return true;
+}
 
-    return ret;
+const char *image_processor_get_etag(void) {
+    return cache_hints.etag;
 }
 
 const char* image_processor_get_error(void) {
@@ -538,6 +992,12 @@ const char* image_processor_get_error(void) {
 }
 
 void image_processor_deinit(void) {
+    image_processor_set_keep_alive(false);
+    image_processor_release();
+    if (push_pngle != NULL) {
+        decode_finish(push_pngle, ESP_FAIL);
+        push_pngle = NULL;
+    }
     if (rgb_buffer) {
         heap_caps_free(rgb_buffer);
         rgb_buffer = NULL;
@@ -0,0 +1,334 @@
+/**
+ * @file jobs.c
+ * @brief Background queue for display actions started from the web UI
+ *
+ * The queue carries job IDs; the jobs themselves live in a small ring of
+ * records (slot = ID % JOBS_HISTORY) that status queries read under a lock.
+ * Since at most JOBS_QUEUE_LEN + 1 jobs are active and IDs are handed out
+ * in order, a new ID only ever reuses the slot of a finished job.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "jobs.h"
+
+static const char *TAG = "JOBS";
+
+#define JOBS_TASK_STACK 8192    // Runner downloads and decodes images
+
+// One job
+typedef struct {
+    uint32_t id;                // 0 = free slot
+    char action[JOBS_ACTION_LEN];
+    job_state_t state;
+    job_stage_t stage;
+    uint32_t stages_entered;    // Bit per job_stage_t
+    uint32_t stage_ms[JOB_STAGE_COUNT];
+    int64_t stage_start_us;
+    int64_t submit_us;
+    uint32_t total_ms;
+    char error[JOBS_ERROR_LEN];
+} job_t;
+
+// Module state
+static job_t s_jobs[JOBS_HISTORY];
+static uint32_t s_next_id = 1;
+static job_t *s_current = NULL;         // Running job
+static jobs_runner_t s_runner = NULL;
+static QueueHandle_t s_queue = NULL;    // IDs of queued jobs
+static SemaphoreHandle_t s_lock = NULL; // Protects s_jobs, s_next_id, s_current
+static SemaphoreHandle_t s_run = NULL;  // Held while a job runs or by jobs_hold()
+
+static const char *const state_names[] = {
+    [JOB_QUEUED]  = "queued",
+    [JOB_RUNNING] = "running",
+    [JOB_DONE]    = "done",
+    [JOB_FAILED]  = "failed",
+};
+
+static const char *const stage_names[JOB_STAGE_COUNT] = {
+    [JOB_STAGE_WAITING]      = "waiting",
+    [JOB_STAGE_DOWNLOADING]  = "downloading",
+    [JOB_STAGE_DECODING]     = "decoding",
+    [JOB_STAGE_DITHERING]    = "dithering",
+    [JOB_STAGE_TRANSFERRING] = "transferring",
+    [JOB_STAGE_REFRESHING]   = "refreshing",
+};
+
+// Add the time since the last stage change to the current stage (lock held)
+static void account_stage(job_t *job, int64_t now_us) {
+    job->stage_ms[job->stage] += (uint32_t)((now_us - job->stage_start_us) / 1000);
+    job->stage_start_us = now_us;
+}
+
+// Find a kept job by ID (lock held)
+static job_t *find_job(uint32_t id) {
+    job_t *job = &s_jobs[id % JOBS_HISTORY];
+    return (id != 0 && job->id == id) ? job : NULL;
+}
+
+// Worker task: runs queued jobs one at a time
+static void jobs_task(void *arg) {
+    uint32_t id;
+    char action[JOBS_ACTION_LEN];
+
+    while (1) {
+        if (xQueueReceive(s_queue, &id, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        xSemaphoreTake(s_run, portMAX_DELAY);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        job_t *job = find_job(id);
+        if (job != NULL) {
+            job->state = JOB_RUNNING;
+            strcpy(action, job->action);
+            s_current = job;
+        }
+        xSemaphoreGive(s_lock);
+        if (job == NULL) {
+            xSemaphoreGive(s_run);
+            continue;
+        }
+
+        ESP_LOGI(TAG, "Job %lu (%s) started", (unsigned long)id, action);
+        const char *err = s_runner(action);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int64_t now_us = esp_timer_get_time();
+        account_stage(job, now_us);
+        job->total_ms = (uint32_t)((now_us - job->submit_us) / 1000);
+        uint32_t total_ms = job->total_ms;
+        job->state = err ? JOB_FAILED : JOB_DONE;
+        if (err) {
+            strncpy(job->error, err, JOBS_ERROR_LEN - 1);
+            job->error[JOBS_ERROR_LEN - 1] = '\0';
+        }
+        s_current = NULL;
+        xSemaphoreGive(s_lock);
+        xSemaphoreGive(s_run);
+
+        if (err) {
+            ESP_LOGW(TAG, "Job %lu (%s) failed after %lu ms: %s", (unsigned long)id, action,
+                     (unsigned long)total_ms, err);
+        } else {
+            ESP_LOGI(TAG, "Job %lu (%s) done in %lu ms", (unsigned long)id, action,
+                     (unsigned long)total_ms);
+        }
+    }
+}
+
+esp_err_t jobs_start(jobs_runner_t runner) {
+    if (s_queue != NULL) {
+        return ESP_OK;
+    }
+    s_runner = runner;
+    s_lock = xSemaphoreCreateMutex();
+    s_run = xSemaphoreCreateMutex();
+    s_queue = xQueueCreate(JOBS_QUEUE_LEN, sizeof(uint32_t));
+    if (s_lock == NULL || s_run == NULL || s_queue == NULL ||
+        xTaskCreate(jobs_task, "jobs", JOBS_TASK_STACK, NULL, 5, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start job worker");
+        if (s_queue) vQueueDelete(s_queue);
+        if (s_run) vSemaphoreDelete(s_run);
+        if (s_lock) vSemaphoreDelete(s_lock);
+        s_queue = NULL;
+        s_run = NULL;
+        s_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+uint32_t jobs_submit(const char *action) {
+    if (s_queue == NULL || strlen(action) >= JOBS_ACTION_LEN) {
+        return 0;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    // Coalesce with the same action still waiting to run
+    for (int i = 0; i < JOBS_HISTORY; i++) {
+        if (s_jobs[i].id != 0 && s_jobs[i].state == JOB_QUEUED &&
+            strcmp(s_jobs[i].action, action) == 0) {
+            uint32_t id = s_jobs[i].id;
+            xSemaphoreGive(s_lock);
+            ESP_LOGI(TAG, "Job %lu (%s) already queued", (unsigned long)id, action);
+            return id;
+        }
+    }
+
+    uint32_t id = s_next_id;
+    job_t *job = &s_jobs[id % JOBS_HISTORY];
+    if (job->id != 0 && (job->state == JOB_QUEUED || job->state == JOB_RUNNING)) {
+        xSemaphoreGive(s_lock);
+        return 0;
+    }
+
+    memset(job, 0, sizeof(*job));
+    job->id = id;
+    strcpy(job->action, action);
+    job->state = JOB_QUEUED;
+    job->stage = JOB_STAGE_WAITING;
+    job->stages_entered = 1u << JOB_STAGE_WAITING;
+    job->submit_us = esp_timer_get_time();
+    job->stage_start_us = job->submit_us;
+
+    if (xQueueSend(s_queue, &id, 0) != pdTRUE) {
+        job->id = 0;
+        xSemaphoreGive(s_lock);
+        ESP_LOGW(TAG, "Queue full, %s not queued", action);
+        return 0;
+    }
+    s_next_id++;
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Job %lu (%s) queued", (unsigned long)id, action);
+    return id;
+}
+
+void jobs_stage(job_stage_t stage) {
+    if (s_lock == NULL || stage >= JOB_STAGE_COUNT) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_current != NULL) {
+        account_stage(s_current, esp_timer_get_time());
+        s_current->stage = stage;
+        s_current->stages_entered |= 1u << stage;
+    }
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "Stage: %s", stage_names[stage]);
+}
+
+bool jobs_busy(void) {
+    if (s_lock == NULL) {
+        return false;
+    }
+    bool busy = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < JOBS_HISTORY; i++) {
+        if (s_jobs[i].id != 0 &&
+            (s_jobs[i].state == JOB_QUEUED || s_jobs[i].state == JOB_RUNNING)) {
+            busy = true;
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return busy;
+}
+
+bool jobs_hold(uint32_t timeout_ms) {
+    if (s_run == NULL) {
+        return true;
+    }
+    return xSemaphoreTake(s_run, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void jobs_release(void) {
+    if (s_run != NULL) {
+        xSemaphoreGive(s_run);
+    }
+}
+
+bool jobs_wait_idle(uint32_t timeout_ms) {
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (jobs_busy()) {
+        if (esp_timer_get_time() >= deadline_us) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    return true;
+}
+
+// Build the JSON object for one job (a copy, so no lock is needed)
+static cJSON *job_to_json(job_t *job, int64_t now_us) {
+    if (job->state == JOB_QUEUED || job->state == JOB_RUNNING) {
+        // Include the time spent so far
+        account_stage(job, now_us);
+        job->total_ms = (uint32_t)((now_us - job->submit_us) / 1000);
+    }
+
+    cJSON *obj = cJSON_CreateObject();
+    if (obj == NULL) {
+        return NULL;
+    }
+    cJSON_AddNumberToObject(obj, "id", job->id);
+    cJSON_AddStringToObject(obj, "action", job->action);
+    cJSON_AddStringToObject(obj, "state", state_names[job->state]);
+    cJSON_AddStringToObject(obj, "stage", stage_names[job->stage]);
+    if (job->state == JOB_FAILED) {
+        cJSON_AddStringToObject(obj, "error", job->error);
+    }
+    cJSON *ms = cJSON_CreateObject();
+    if (ms != NULL) {
+        for (int s = 0; s < JOB_STAGE_COUNT; s++) {
+            if (job->stages_entered & (1u << s)) {
+                cJSON_AddNumberToObject(ms, stage_names[s], job->stage_ms[s]);
+            }
+        }
+        cJSON_AddNumberToObject(ms, "total", job->total_ms);
+        cJSON_AddItemToObject(obj, "ms", ms);
+    }
+    return obj;
+}
+
+size_t jobs_format_json(uint32_t id, char *buf, size_t len) {
+    if (s_lock == NULL || len == 0) {
+        return 0;
+    }
+
+    // Copy the jobs out, oldest first, to keep the lock short (static:
+    // too large for the httpd task stack, and requests are serialized)
+    static job_t copies[JOBS_HISTORY];
+    int count = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (id != 0) {
+        job_t *job = find_job(id);
+        if (job != NULL) {
+            copies[count++] = *job;
+        }
+    } else {
+        for (uint32_t n = s_next_id > JOBS_HISTORY ? s_next_id - JOBS_HISTORY : 1;
+             n < s_next_id; n++) {
+            job_t *job = find_job(n);
+            if (job != NULL) {
+                copies[count++] = *job;
+            }
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (id != 0 && count == 0) {
+        return 0;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    cJSON *root = id != 0 ? job_to_json(&copies[0], now_us) : cJSON_CreateArray();
+    if (root == NULL) {
+        return 0;
+    }
+    if (id == 0) {
+        for (int i = 0; i < count; i++) {
+            cJSON *obj = job_to_json(&copies[i], now_us);
+            if (obj != NULL) {
+                cJSON_AddItemToArray(root, obj);
+            }
+        }
+    }
+
+    size_t written = 0;
+    if (cJSON_PrintPreallocated(root, buf, (int)len, false)) {
+        written = strlen(buf);
+    }
+    cJSON_Delete(root);
+    return written;
+}
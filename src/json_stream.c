@@ -0,0 +1,483 @@
+/**
+ * @file json_stream.c
+ * @brief Incremental JSON tokenizer for request bodies
+ *
+ * A byte-at-a-time state machine: `lex` tracks the token being scanned
+ * (string, number, literal) and `expect` what the grammar allows next.
+ * Numbers have no closing character, so the byte after a number ends it and
+ * is then looked at again as a structural character.
+ */
+
+#include "json_stream.h"
+#include <string.h>
+
+enum {
+    LEX_NONE,
+    LEX_STRING,
+    LEX_ESCAPE,
+    LEX_UNICODE,
+    LEX_NUMBER,
+    LEX_LITERAL,
+};
+
+enum {
+    EXPECT_VALUE,           // Top level, after ':' and after ',' in an array
+    EXPECT_VALUE_OR_END,    // After '['
+    EXPECT_KEY_OR_END,      // After '{'
+    EXPECT_KEY,             // After ',' in an object
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_END,    // After a value in an object or array
+    EXPECT_DONE,            // After the top-level value
+};
+
+// Result of one step
+enum {
+    STEP_OK,
+    STEP_AGAIN,     // Byte ended a number, look at it again
+    STEP_ERROR,
+};
+
+// Record an error; returns STEP_ERROR
+static int fail(json_stream_t *js, const char *msg) {
+    if (js->error == NULL) {
+        js->error = msg;
+    }
+    return STEP_ERROR;
+}
+
+// Report an event unless it is part of a captured value
+static bool emit(json_stream_t *js, json_stream_event_t ev, const char *str, size_t len) {
+    if (js->capturing) {
+        return true;
+    }
+    if (!js->cb(js, ev, str, len, js->ctx)) {
+        if (js->error == NULL) {
+            js->error = "stopped";
+        }
+        return false;
+    }
+    return true;
+}
+
+// Append bytes to the token buffer. While capturing only numbers are kept
+// (to check them); strings are in the raw text already
+static bool tok_append(json_stream_t *js, const char *s, size_t n) {
+    if (js->capturing && js->lex != LEX_NUMBER) {
+        return true;
+    }
+    if (js->tok_len + n >= js->tok_size) {
+        js->error = js->lex == LEX_NUMBER ? "number too long" : "string too long";
+        return false;
+    }
+    memcpy(js->tok + js->tok_len, s, n);
+    js->tok_len += n;
+    return true;
+}
+
+// Append a byte to the capture buffer
+static bool cap_append(json_stream_t *js, char c) {
+    if (js->cap_len + 1 >= js->cap_size) {
+        js->error = "value too long";
+        return false;
+    }
+    js->cap[js->cap_len++] = c;
+    return true;
+}
+
+// Append a code point as UTF-8
+static bool tok_append_utf8(json_stream_t *js, uint32_t cp) {
+    char u[4];
+    size_t n;
+    if (cp < 0x80) {
+        u[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        u[0] = (char)(0xC0 | (cp >> 6));
+        u[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        u[0] = (char)(0xE0 | (cp >> 12));
+        u[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        u[0] = (char)(0xF0 | (cp >> 18));
+        u[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        u[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    return tok_append(js, u, n);
+}
+
+// Check the JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool number_valid(const char *s, size_t len) {
+    size_t i = 0;
+    if (i < len && s[i] == '-') i++;
+    if (i >= len) return false;
+    if (s[i] == '0') {
+        i++;
+    } else if (s[i] >= '1' && s[i] <= '9') {
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    } else {
+        return false;
+    }
+    if (i < len && s[i] == '.') {
+        i++;
+        if (i >= len || s[i] < '0' || s[i] > '9') return false;
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    }
+    if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < len && (s[i] == '+' || s[i] == '-')) i++;
+        if (i >= len || s[i] < '0' || s[i] > '9') return false;
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    }
+    return i == len;
+}
+
+// A value has been completed at the current depth
+static int value_done(json_stream_t *js) {
+    js->expect = js->depth == 0 ? EXPECT_DONE : EXPECT_COMMA_OR_END;
+    return STEP_OK;
+}
+
+// Finish a scalar token and report it
+static int scalar_done(json_stream_t *js, json_stream_event_t ev) {
+    js->lex = LEX_NONE;
+    if (!js->capturing) {
+        js->tok[js->tok_len] = '\0';
+    }
+    if (!emit(js, ev, js->tok, js->tok_len)) {
+        return STEP_ERROR;
+    }
+    return value_done(js);
+}
+
+// End of a number (the byte after it, or the end of the document)
+static int number_done(json_stream_t *js) {
+    if (!number_valid(js->tok, js->tok_len)) {
+        return fail(js, "invalid number");
+    }
+    return scalar_done(js, JSON_STREAM_NUMBER);
+}
+
+// Start of a value
+static int value_start(json_stream_t *js, char c) {
+    bool capture = js->cap_pending;
+    js->cap_pending = false;
+
+    if (c == '{' || c == '[') {
+        if (js->depth >= JSON_STREAM_MAX_DEPTH) {
+            return fail(js, "nested too deep");
+        }
+        if (capture && !js->capturing) {
+            js->capturing = true;
+            js->cap_depth = js->depth;
+            js->cap_len = 0;
+        }
+        if (!emit(js, c == '{' ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START, NULL, 0)) {
+            return STEP_ERROR;
+        }
+        js->stack[js->depth++] = (uint8_t)c;
+        js->expect = c == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+        return STEP_OK;
+    }
+
+    js->tok_len = 0;
+    if (c == '"') {
+        js->lex = LEX_STRING;
+        js->is_key = false;
+        return STEP_OK;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        js->lex = LEX_NUMBER;
+        return tok_append(js, &c, 1) ? STEP_OK : STEP_ERROR;
+    }
+    if (c == 't' || c == 'f' || c == 'n') {
+        js->literal = c == 't' ? "true" : c == 'f' ? "false" : "null";
+        js->literal_pos = 1;
+        js->lex = LEX_LITERAL;
+        return STEP_OK;
+    }
+    return fail(js, "expected a value");
+}
+
+// End of an object or array
+static int container_end(json_stream_t *js, char c) {
+    char open = c == '}' ? '{' : '[';
+    if (js->depth == 0 || js->stack[js->depth - 1] != open) {
+        return fail(js, "mismatched bracket");
+    }
+    js->depth--;
+
+    if (js->capturing && js->depth == js->cap_depth) {
+        if (!cap_append(js, c)) {
+            return STEP_ERROR;
+        }
+        js->cap[js->cap_len] = '\0';
+        js->capturing = false;
+        if (!emit(js, JSON_STREAM_RAW, js->cap, js->cap_len)) {
+            return STEP_ERROR;
+        }
+        return value_done(js);
+    }
+
+    if (!emit(js, c == '}' ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END, NULL, 0)) {
+        return STEP_ERROR;
+    }
+    return value_done(js);
+}
+
+// Structural byte (outside strings, numbers and literals)
+static int step_structure(json_stream_t *js, char c) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        return STEP_OK;
+    }
+
+    switch (js->expect) {
+    case EXPECT_VALUE:
+        return value_start(js, c);
+    case EXPECT_VALUE_OR_END:
+        if (c == ']') {
+            return container_end(js, c);
+        }
+        return value_start(js, c);
+    case EXPECT_KEY_OR_END:
+        if (c == '}') {
+            return container_end(js, c);
+        }
+        // Fall through
+    case EXPECT_KEY:
+        if (c != '"') {
+            return fail(js, "expected a key");
+        }
+        js->lex = LEX_STRING;
+        js->is_key = true;
+        js->tok_len = 0;
+        return STEP_OK;
+    case EXPECT_COLON:
+        if (c != ':') {
+            return fail(js, "expected ':'");
+        }
+        js->expect = EXPECT_VALUE;
+        return STEP_OK;
+    case EXPECT_COMMA_OR_END:
+        if (c == ',') {
+            js->expect = js->stack[js->depth - 1] == '{' ? EXPECT_KEY : EXPECT_VALUE;
+            return STEP_OK;
+        }
+        if (c == '}' || c == ']') {
+            return container_end(js, c);
+        }
+        return fail(js, "expected ',' or end");
+    default:
+        return fail(js, "data after the end");
+    }
+}
+
+// Byte inside a string
+static int step_string(json_stream_t *js, char c) {
+    if (js->high_surrogate && c != '\\') {
+        return fail(js, "unpaired surrogate");
+    }
+    if (c == '"') {
+        js->lex = LEX_NONE;
+        if (js->is_key) {
+            if (!js->capturing) {
+                js->tok[js->tok_len] = '\0';
+            }
+            if (!emit(js, JSON_STREAM_KEY, js->tok, js->tok_len)) {
+                return STEP_ERROR;
+            }
+            js->expect = EXPECT_COLON;
+            return STEP_OK;
+        }
+        return scalar_done(js, JSON_STREAM_STRING);
+    }
+    if (c == '\\') {
+        js->lex = LEX_ESCAPE;
+        return STEP_OK;
+    }
+    if ((unsigned char)c < 0x20) {
+        return fail(js, "control character in string");
+    }
+    return tok_append(js, &c, 1) ? STEP_OK : STEP_ERROR;
+}
+
+// Byte after a backslash
+static int step_escape(json_stream_t *js, char c) {
+    if (c == 'u') {
+        js->lex = LEX_UNICODE;
+        js->hex_digits = 0;
+        js->code = 0;
+        return STEP_OK;
+    }
+    if (js->high_surrogate) {
+        return fail(js, "unpaired surrogate");
+    }
+
+    char out;
+    switch (c) {
+    case '"':  out = '"';  break;
+    case '\\': out = '\\'; break;
+    case '/':  out = '/';  break;
+    case 'b':  out = '\b'; break;
+    case 'f':  out = '\f'; break;
+    case 'n':  out = '\n'; break;
+    case 'r':  out = '\r'; break;
+    case 't':  out = '\t'; break;
+    default:
+        return fail(js, "invalid escape");
+    }
+    js->lex = LEX_STRING;
+    return tok_append(js, &out, 1) ? STEP_OK : STEP_ERROR;
+}
+
+// Hex digit of a \u escape
+static int step_unicode(json_stream_t *js, char c) {
+    uint32_t v;
+    if (c >= '0' && c <= '9') v = c - '0';
+    else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+    else return fail(js, "invalid \\u escape");
+
+    js->code = (js->code << 4) | v;
+    if (++js->hex_digits < 4) {
+        return STEP_OK;
+    }
+
+    js->lex = LEX_STRING;
+    uint32_t cp = js->code;
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        if (js->high_surrogate) {
+            return fail(js, "unpaired surrogate");
+        }
+        js->high_surrogate = cp;
+        return STEP_OK;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (!js->high_surrogate) {
+            return fail(js, "unpaired surrogate");
+        }
+        cp = 0x10000 + ((js->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+        js->high_surrogate = 0;
+    } else if (js->high_surrogate) {
+        return fail(js, "unpaired surrogate");
+    }
+    if (cp == 0) {
+        return fail(js, "\\u0000 in string");
+    }
+    return tok_append_utf8(js, cp) ? STEP_OK : STEP_ERROR;
+}
+
+// Byte of a number; anything else ends it
+static int step_number(json_stream_t *js, char c) {
+    if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+        return tok_append(js, &c, 1) ? STEP_OK : STEP_ERROR;
+    }
+    if (number_done(js) == STEP_ERROR) {
+        return STEP_ERROR;
+    }
+    return STEP_AGAIN;
+}
+
+// Byte of true, false or null
+static int step_literal(json_stream_t *js, char c) {
+    if (c != js->literal[js->literal_pos]) {
+        return fail(js, "invalid literal");
+    }
+    if (js->literal[++js->literal_pos] != '\0') {
+        return STEP_OK;
+    }
+    js->tok_len = 0;
+    if (!js->capturing) {
+        strcpy(js->tok, js->literal);   // tok_size >= 6 is checked in init
+        js->tok_len = strlen(js->literal);
+    }
+    return scalar_done(js, js->literal[0] == 'n' ? JSON_STREAM_NULL : JSON_STREAM_BOOL);
+}
+
+void json_stream_init(json_stream_t *js, char *tok, size_t tok_size,
+                      json_stream_cb_t cb, void *ctx) {
+    memset(js, 0, sizeof(*js));
+    js->cb = cb;
+    js->ctx = ctx;
+    js->tok = tok;
+    js->tok_size = tok_size;
+    js->expect = EXPECT_VALUE;
+    if (tok_size < sizeof("false")) {
+        js->error = "token buffer too small";
+    }
+}
+
+bool json_stream_feed(json_stream_t *js, const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (js->error) {
+            return false;
+        }
+        char c = data[i];
+        int r;
+        switch (js->lex) {
+        case LEX_STRING:  r = step_string(js, c);    break;
+        case LEX_ESCAPE:  r = step_escape(js, c);    break;
+        case LEX_UNICODE: r = step_unicode(js, c);   break;
+        case LEX_NUMBER:  r = step_number(js, c);    break;
+        case LEX_LITERAL: r = step_literal(js, c);   break;
+        default:          r = step_structure(js, c); break;
+        }
+        if (r == STEP_ERROR) {
+            return false;
+        }
+        if (r == STEP_AGAIN) {
+            continue;
+        }
+        // The closing bracket of a captured value is stored by container_end()
+        if (js->capturing && !cap_append(js, c)) {
+            return false;
+        }
+        js->offset++;
+        i++;
+    }
+    return js->error == NULL;
+}
+
+bool json_stream_finish(json_stream_t *js) {
+    if (js->error) {
+        return false;
+    }
+    if (js->lex == LEX_NUMBER && number_done(js) == STEP_ERROR) {
+        return false;
+    }
+    if (js->lex != LEX_NONE || js->expect != EXPECT_DONE) {
+        js->error = "unexpected end";
+        return false;
+    }
+    return true;
+}
+
+void json_stream_capture(json_stream_t *js, char *buf, size_t size) {
+    js->cap = buf;
+    js->cap_size = size;
+    js->cap_pending = buf != NULL && size > 0;
+}
+
+bool json_stream_fail(json_stream_t *js, const char *msg) {
+    if (js->error == NULL) {
+        js->error = msg;
+    }
+    return false;
+}
+
+int json_stream_depth(const json_stream_t *js) {
+    return js->depth;
+}
+
+const char *json_stream_error(const json_stream_t *js) {
+    return js->error;
+}
+
+size_t json_stream_offset(const json_stream_t *js) {
+    return js->offset;
+}
@@ -1,17 +1,21 @@
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <time.h>
 #include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_sleep.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_ota_ops.h"
 #include "esp_app_format.h"
 #include "esp_sntp.h"
@@ -27,6 +31,25 @@
 #include "image_processor.h"
 #include "error_display.h"
 #include "syslog_remote.h"
+#include "panel_layout.h"
+#include "wifi_cache.h"
+#include "time_drift.h"
+#include "config_store.h"
+#include "schedule.h"
+#include "http_cache.h"
+#include "framecache.h"
+#include "slides.h"
+#include "playlist.h"
+#include "tiles.h"
+#include "widgets.h"
+#include "esp_rom_crc.h"
+#include "cJSON.h"
+#include "json_stream.h"
+#include "tile_layout.h"
+#include "jobs.h"
+#include "png_stream.h"
+#include "multipart.h"
+#include "ota_writer.h"
 
 // Firmware version for OTA
 #define FIRMWARE_VERSION "1.0.0"
@@ -40,6 +63,7 @@ static const char *TAG = "ESP32-S3-Display";
 
 // Global variables
 static EventGroupHandle_t s_wifi_event_group;
+static EventGroupHandle_t s_cycle_event_group;  // CYCLE_*_BIT, see start_display_prep()
 static int s_retry_num = 0;
 static bool wifi_connected = false;
 static bool webserver_mode = false;
@@ -51,6 +75,7 @@ static led_strip_handle_t led_strip = NULL;
 static volatile uint32_t last_client_activity = 0;  // Timestamp of last client activity
 static esp_netif_t *sta_netif = NULL;
 static esp_netif_t *ap_netif = NULL;
+static bool lease_reused = false;  // STA address is a cached DHCP lease (see wifi_cache.h)
 
 // Storage for WiFi credentials
 static char stored_ssid[MAX_SSID_LEN] = {0};
@@ -70,11 +95,12 @@ static char stored_dns_search[MAX_DOMAIN_LEN] = {0};
 // Storage for time configuration
 static char stored_ntp_server[MAX_NTP_SERVER_LEN] = {0};
 static char stored_timezone[MAX_TIMEZONE_LEN] = {0};
+static uint16_t stored_ntp_max_err = DEFAULT_NTP_MAX_ERR_S;  // Allowed clock error before NTP (0 = every wake)
 // Storage for display settings
 static char stored_image_url[MAX_URL_LEN] = {0};
 static uint32_t stored_refresh_interval = 60;  // Default 60 minutes
-static uint16_t stored_img_width = 800;   // Default display width
-static uint16_t stored_img_height = 480;  // Default display height
+static uint16_t stored_img_width = IMAGE_WIDTH;    // Default display width
+static uint16_t stored_img_height = IMAGE_HEIGHT;  // Default display height
 static bool stored_img_scale = false;     // Scale image to fit display
 static uint16_t stored_img_rotation = 0;  // Image rotation (0, 90, 180, 270)
 static bool stored_img_mirror_h = false;  // Mirror horizontally
@@ -82,10 +108,20 @@ static bool stored_img_mirror_v = false;  // Mirror vertically
 static bool stored_img_rot_first = true;  // Rotate before mirroring
 static bool stored_led_disabled = false;  // Disable status LED
 static bool stored_ssl_skip = false;     // Skip SSL certificate verification
+static bool stored_refresh_align = false;  // Wake on wall-clock multiples of the interval
+static char stored_panel_layout[MAX_PANEL_LAYOUT_LEN] = {0};  // Multi-panel layout (empty = single panel)
+static bool stored_playlist = false;     // Image URL is a playlist manifest (offline slideshow)
+static uint32_t stored_playlist_check = DEFAULT_PLAYLIST_CHECK_MIN;  // Minutes between manifest checks
+static char stored_tile_layout[MAX_TILE_LAYOUT_LEN] = {0};  // Composite dashboard tiles (empty = one image)
+static bool stored_widgets = false;      // Image URL returns JSON drawn with the widget template
 
 // Storage for schedule plans
 static char stored_schedule_json[MAX_SCHEDULE_JSON] = {0};
 static bool stored_schedule_enabled = false;
+static schedule_table_t stored_schedule_table = {0};  // Compiled from stored_schedule_json
+static bool stored_cache_hints = false;   // Sleep until the server's cache headers say content changes
+static uint32_t stored_cache_min = DEFAULT_CACHE_MIN_MIN;  // Bounds for those sleeps (minutes)
+static uint32_t stored_cache_max = DEFAULT_CACHE_MAX_MIN;
 
 // Storage for syslog configuration
 static char stored_syslog_host[MAX_SYSLOG_HOST_LEN] = {0};
@@ -102,20 +138,25 @@ static const char* default_schedule_json =
 // NTP synchronization status
 static bool ntp_synced = false;
 static time_t last_ntp_sync = 0;
+static bool sntp_started = false;  // SNTP runs this wake (see start_time_sync)
+static RTC_DATA_ATTR time_drift_t time_drift;  // RTC clock rate, kept across deep sleep
 
 // Function prototypes
 static void init_nvs(void);
-static void load_config_from_nvs(void);
+static void load_config(bool use_rtc);
 static void save_display_config_to_nvs(const char *url, uint32_t refresh_min,
                                         uint16_t img_width, uint16_t img_height,
                                         bool img_scale, uint16_t img_rotation,
                                         bool img_mirror_h, bool img_mirror_v, bool img_rot_first,
-                                        bool led_disabled, bool ssl_skip);
+                                        bool led_disabled, bool ssl_skip, bool refresh_align,
+                                        bool playlist, uint32_t playlist_check,
+                                        const char *panel_layout, const char *tile_layout);
 static void save_network_config_to_nvs(const char *ssid, const char *password,
                                         const char *hostname, const char *domain,
                                         bool use_dhcp, const char *static_ip, const char *static_mask,
                                         const char *static_gw, const char *dns_primary, const char *dns_secondary,
-                                        const char *dns_search, const char *ntp_server, const char *timezone);
+                                        const char *dns_search, const char *ntp_server, const char *timezone,
+                                        uint16_t ntp_max_err);
 static void init_led(void);
 static void set_led_color(uint8_t r, uint8_t g, uint8_t b);
 static void led_task(void *pvParameters);
@@ -130,7 +171,55 @@ static esp_err_t ota_post_handler(httpd_req_t *req);
 static httpd_handle_t start_webserver(void);
 static void stop_webserver(httpd_handle_t server);
 static void init_boot_button(void);
-static void enter_deep_sleep(uint32_t sleep_minutes);
+static void enter_deep_sleep(void);
+
+// Wake cycle stages, timestamped by log_stage()
+typedef enum {
+    STAGE_BUFFERS_READY,
+    STAGE_PANEL_READY,
+    STAGE_FIRST_PACKET,
+    STAGE_WIFI_CONNECTED,
+    STAGE_TIME_SYNCED,
+    STAGE_DOWNLOAD_STARTED,
+    STAGE_DOWNLOAD_FINISHED,
+    STAGE_REFRESH_STARTED,
+    STAGE_NETWORK_DOWN,
+    STAGE_REFRESH_FINISHED,
+    STAGE_COUNT
+} cycle_stage_t;
+
+static void log_stage(cycle_stage_t stage);
+static void log_cycle_summary(void);
+static int64_t stage_ms[STAGE_COUNT];  // Time since boot, 0 = not reached this wake
+
+// Boot latency of the previous wake, reported by /api/status
+static RTC_DATA_ATTR uint32_t last_first_packet_ms = 0;
+static RTC_DATA_ATTR uint32_t last_awake_ms = 0;
+// Smoothed time from a timer wake to the image request, the lead for aligned wakes
+static RTC_DATA_ATTR uint32_t fetch_latency_ms = 0;
+
+// What the panel shows, for keeping the last good frame on failed downloads
+static RTC_DATA_ATTR uint32_t panel_frame_seq = 0;     // Cached frame on the panel, 0 = other content
+static RTC_DATA_ATTR bool panel_stale_banner = false;  // Redrawn with the stale-data banner
+static RTC_DATA_ATTR uint32_t fetch_failures = 0;      // Failed downloads in a row
+static bool framecache_ready = false;
+static bool slides_ready = false;
+
+// Energy of unattended (timer) wakes, for the per-frame estimate in /api/status
+static RTC_DATA_ATTR uint32_t energy_wakes = 0;
+static RTC_DATA_ATTR uint32_t energy_frames = 0;     // Wakes that put a new frame on the panel
+static RTC_DATA_ATTR uint64_t energy_awake_ms = 0;
+static RTC_DATA_ATTR uint64_t energy_radio_ms = 0;   // Part of it with WiFi up
+static bool frame_displayed = false;                 // This wake put a new frame on the panel
+
+// Cost of the last frame made from a PNG and from widget data, for /api/status
+typedef struct {
+    uint32_t bytes;      // Downloaded
+    uint32_t fetch_ms;   // Download
+    uint32_t render_ms;  // Decode and dither (PNG, incl. the overlapping panel transfer) or drawing
+} render_cost_t;
+static RTC_DATA_ATTR render_cost_t png_cost;
+static RTC_DATA_ATTR render_cost_t widget_cost;
 
 // Initialize NVS
 static void init_nvs(void) {
@@ -152,39 +241,96 @@ static void init_nvs(void) {
     } \
 } while(0)
 
-// Load all configuration from NVS
-static void load_config_from_nvs(void) {
+// Settings stored in the config blob (see config_store.h). The layout only
+// grows: append new fields at the end and keep CONFIG_VERSION, so blobs
+// from older builds still load with the new fields at their defaults.
+// Fields are stored at their full size, so changing a MAX_* length (or a
+// field's type) moves every field after it: bump CONFIG_VERSION and add a
+// migration that reads the old layout, or stored settings are misread.
+#define CONFIG_FIELDS(X) \
+    X(stored_ssid) X(stored_password) X(stored_hostname) X(stored_domain) \
+    X(stored_use_dhcp) X(stored_static_ip) X(stored_static_mask) X(stored_static_gw) \
+    X(stored_dns_primary) X(stored_dns_secondary) X(stored_dns_search) \
+    X(stored_ntp_server) X(stored_timezone) X(stored_ntp_max_err) \
+    X(stored_image_url) X(stored_refresh_interval) X(stored_img_width) X(stored_img_height) \
+    X(stored_img_scale) X(stored_img_rotation) X(stored_img_mirror_h) X(stored_img_mirror_v) \
+    X(stored_img_rot_first) X(stored_led_disabled) X(stored_ssl_skip) X(stored_panel_layout) \
+    X(stored_schedule_json) X(stored_schedule_enabled) \
+    X(stored_syslog_host) X(stored_syslog_port) X(stored_syslog_enabled) \
+    X(stored_syslog_format) X(stored_syslog_transport) \
+    X(stored_schedule_table) X(stored_refresh_align) \
+    X(stored_cache_hints) X(stored_cache_min) X(stored_cache_max) \
+    X(stored_playlist) X(stored_playlist_check) X(stored_tile_layout) \
+    X(stored_widgets)
+
+#define CONFIG_VERSION 1
+
+#define CONFIG_MEMBER(name) __typeof__(name) name;
+typedef struct __attribute__((packed)) {
+    CONFIG_FIELDS(CONFIG_MEMBER)
+} app_config_t;
+#undef CONFIG_MEMBER
+
+// RTC mirror of the stored blob, sized by the settings struct
+static RTC_DATA_ATTR CONFIG_STORE_MIRROR(app_config_t) config_mirror;
+_Static_assert(offsetof(__typeof__(config_mirror), data) == sizeof(config_store_header_t),
+               "Settings must follow the blob header without padding");
+
+// Everything kept across deep sleep shares the 8 KB of RTC slow memory.
+// Modules keep their private RTC state under RTC_MODULE_STATE_MAX each.
+_Static_assert(sizeof(config_mirror) + sizeof(time_drift) +
+               sizeof(last_first_packet_ms) + sizeof(last_awake_ms) + sizeof(fetch_latency_ms) +
+               sizeof(panel_frame_seq) + sizeof(panel_stale_banner) + sizeof(fetch_failures) +
+               sizeof(energy_wakes) + sizeof(energy_frames) + sizeof(energy_awake_ms) +
+               sizeof(energy_radio_ms) + sizeof(png_cost) + sizeof(widget_cost) +
+               sizeof(framecache_stats_t) + sizeof(tiles_stats_t) + sizeof(slides_stats_t) +
+               sizeof(wifi_cache_stats_t) + 2 * RTC_MODULE_STATE_MAX <= RTC_SLOW_MEM_SIZE,
+               "State kept across deep sleep exceeds RTC slow memory");
+
+// Keys used before all settings moved into the config blob
+static const char *const legacy_config_keys[] = {
+    NVS_IMAGE_URL, NVS_IMG_WIDTH, NVS_IMG_HEIGHT, NVS_IMG_SCALE, NVS_IMG_ROTATION,
+    NVS_IMG_MIRROR_H, NVS_IMG_MIRROR_V, NVS_IMG_ROT_FIRST, NVS_REFRESH_MIN,
+    NVS_LED_DISABLED, NVS_SSL_SKIP, NVS_PANEL_LAYOUT,
+    NVS_WIFI_SSID, NVS_WIFI_PASS, NVS_HOSTNAME, NVS_DOMAIN,
+    NVS_USE_DHCP, NVS_STATIC_IP, NVS_STATIC_MASK, NVS_STATIC_GW,
+    NVS_DNS_PRIMARY, NVS_DNS_SECONDARY, NVS_DNS_SEARCH,
+    NVS_NTP_SERVER, NVS_TIMEZONE, NVS_NTP_MAX_ERR,
+    NVS_SCHEDULE_JSON, NVS_SCHEDULE_ENABLE,
+    NVS_SYSLOG_HOST, NVS_SYSLOG_PORT, NVS_SYSLOG_ENABLED, NVS_SYSLOG_FORMAT, NVS_SYSLOG_TRANSPORT,
+};
+
+// Packing buffer for load and save, too large for the task stacks
+static app_config_t config_buf;
+
+// Copy the stored_* globals into a config blob
+static void pack_config(app_config_t *cfg) {
+#define CONFIG_PACK(name) memcpy(&cfg->name, &name, sizeof(name));
+    CONFIG_FIELDS(CONFIG_PACK)
+#undef CONFIG_PACK
+}
+
+// Copy a config blob into the stored_* globals
+static void unpack_config(const app_config_t *cfg) {
+#define CONFIG_UNPACK(name) memcpy(&name, &cfg->name, sizeof(name));
+    CONFIG_FIELDS(CONFIG_UNPACK)
+#undef CONFIG_UNPACK
+}
+
+// Write the stored_* globals to NVS (only if anything changed)
+static esp_err_t commit_config(void) {
+    pack_config(&config_buf);
+    return config_store_save(&config_mirror.header, &config_buf, sizeof(config_buf), CONFIG_VERSION);
+}
+
+// Read settings stored under individual keys by older firmware
+static bool load_legacy_config(void) {
     nvs_handle_t nvs_handle;
     esp_err_t err;
 
-    // Set defaults first (empty SSID/password means AP mode will be used)
-    stored_ssid[0] = '\0';
-    stored_password[0] = '\0';
-    strncpy(stored_hostname, DEFAULT_HOSTNAME, MAX_HOSTNAME_LEN - 1);
-    stored_domain[0] = '\0';
-    stored_use_dhcp = true;
-    stored_static_ip[0] = '\0';
-    stored_static_mask[0] = '\0';
-    stored_static_gw[0] = '\0';
-    stored_dns_primary[0] = '\0';
-    stored_dns_secondary[0] = '\0';
-    stored_dns_search[0] = '\0';
-    strncpy(stored_ntp_server, DEFAULT_NTP_SERVER, MAX_NTP_SERVER_LEN - 1);
-    strncpy(stored_timezone, DEFAULT_TIMEZONE, MAX_TIMEZONE_LEN - 1);
-    stored_image_url[0] = '\0';
-    stored_refresh_interval = 60;
-    stored_img_width = 800;
-    stored_img_height = 480;
-    stored_img_scale = false;
-    stored_img_rotation = 0;
-    stored_img_mirror_h = false;
-    stored_img_mirror_v = false;
-    stored_img_rot_first = true;
-
     err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
     if (err != ESP_OK) {
-        ESP_LOGI(TAG, "NVS not found, using defaults");
-        return;
+        return false;
     }
 
     // Load WiFi settings (empty string as default means AP mode)
@@ -208,6 +354,7 @@ static void load_config_from_nvs(void) {
     // Load time settings
     NVS_LOAD_STR(nvs_handle, NVS_NTP_SERVER, stored_ntp_server, MAX_NTP_SERVER_LEN, DEFAULT_NTP_SERVER);
     NVS_LOAD_STR(nvs_handle, NVS_TIMEZONE, stored_timezone, MAX_TIMEZONE_LEN, DEFAULT_TIMEZONE);
+    nvs_get_u16(nvs_handle, NVS_NTP_MAX_ERR, &stored_ntp_max_err);
     // Load display settings
     size_t url_len = MAX_URL_LEN;
     nvs_get_str(nvs_handle, NVS_IMAGE_URL, stored_image_url, &url_len);
@@ -223,6 +370,7 @@ static void load_config_from_nvs(void) {
     if (nvs_get_u8(nvs_handle, NVS_IMG_ROT_FIRST, &tmp_u8) == ESP_OK) stored_img_rot_first = (tmp_u8 != 0);
     if (nvs_get_u8(nvs_handle, NVS_LED_DISABLED, &tmp_u8) == ESP_OK) stored_led_disabled = (tmp_u8 != 0);
     if (nvs_get_u8(nvs_handle, NVS_SSL_SKIP, &tmp_u8) == ESP_OK) stored_ssl_skip = (tmp_u8 != 0);
+    NVS_LOAD_STR(nvs_handle, NVS_PANEL_LAYOUT, stored_panel_layout, MAX_PANEL_LAYOUT_LEN, "");
 
     // Load schedule settings
     size_t sched_len = MAX_SCHEDULE_JSON;
@@ -245,6 +393,72 @@ static void load_config_from_nvs(void) {
     if (nvs_get_u8(nvs_handle, NVS_SYSLOG_TRANSPORT, &tmp_u8) == ESP_OK) stored_syslog_transport = tmp_u8;
 
     nvs_close(nvs_handle);
+    return true;
+}
+
+// Load all configuration: from the RTC mirror on timer wakes, otherwise from
+// the NVS config blob. Settings under the old individual keys are moved into
+// the blob on the first boot of this firmware.
+static void load_config(bool use_rtc) {
+    // Set defaults first (empty SSID/password means AP mode will be used)
+    stored_ssid[0] = '\0';
+    stored_password[0] = '\0';
+    strncpy(stored_hostname, DEFAULT_HOSTNAME, MAX_HOSTNAME_LEN - 1);
+    stored_domain[0] = '\0';
+    stored_use_dhcp = true;
+    stored_static_ip[0] = '\0';
+    stored_static_mask[0] = '\0';
+    stored_static_gw[0] = '\0';
+    stored_dns_primary[0] = '\0';
+    stored_dns_secondary[0] = '\0';
+    stored_dns_search[0] = '\0';
+    strncpy(stored_ntp_server, DEFAULT_NTP_SERVER, MAX_NTP_SERVER_LEN - 1);
+    strncpy(stored_timezone, DEFAULT_TIMEZONE, MAX_TIMEZONE_LEN - 1);
+    stored_ntp_max_err = DEFAULT_NTP_MAX_ERR_S;
+    stored_image_url[0] = '\0';
+    stored_refresh_interval = 60;
+    stored_img_width = IMAGE_WIDTH;
+    stored_img_height = IMAGE_HEIGHT;
+    stored_img_scale = false;
+    stored_img_rotation = 0;
+    stored_img_mirror_h = false;
+    stored_img_mirror_v = false;
+    stored_img_rot_first = true;
+    stored_cache_hints = false;
+    stored_cache_min = DEFAULT_CACHE_MIN_MIN;
+    stored_cache_max = DEFAULT_CACHE_MAX_MIN;
+    stored_playlist = false;
+    stored_playlist_check = DEFAULT_PLAYLIST_CHECK_MIN;
+    stored_tile_layout[0] = '\0';
+    stored_widgets = false;
+
+    pack_config(&config_buf);
+    if (config_store_load(&config_mirror.header, &config_buf, sizeof(config_buf), CONFIG_VERSION,
+                          use_rtc) == ESP_OK) {
+        unpack_config(&config_buf);
+    } else {
+        int64_t start_us = esp_timer_get_time();
+        if (load_legacy_config()) {
+            config_store_note_legacy((uint32_t)(esp_timer_get_time() - start_us));
+            if (commit_config() == ESP_OK) {
+                config_store_erase_keys(legacy_config_keys,
+                                        sizeof(legacy_config_keys) / sizeof(legacy_config_keys[0]));
+                ESP_LOGI(TAG, "Settings migrated to the config blob");
+            }
+        } else {
+            ESP_LOGI(TAG, "NVS not found, using defaults");
+        }
+    }
+
+    // Blobs from before the compiled schedule carry the JSON only
+    if (!stored_schedule_table.valid) {
+        char err[64];
+        if (!schedule_compile(stored_schedule_json, &stored_schedule_table, err, sizeof(err))) {
+            ESP_LOGW(TAG, "Stored schedule invalid (%s), using default interval", err);
+            schedule_compile("", &stored_schedule_table, NULL, 0);
+        }
+        commit_config();
+    }
 
     ESP_LOGI(TAG, "Loaded config - SSID: %s, Hostname: %s, DHCP: %s",
              stored_ssid[0] ? stored_ssid : "(empty)",
@@ -267,43 +481,34 @@ static void save_display_config_to_nvs(const char *url, uint32_t refresh_min,
                                         uint16_t img_width, uint16_t img_height,
                                         bool img_scale, uint16_t img_rotation,
                                         bool img_mirror_h, bool img_mirror_v, bool img_rot_first,
-                                        bool led_disabled, bool ssl_skip) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_IMAGE_URL, url);
-        nvs_set_u32(nvs_handle, NVS_REFRESH_MIN, refresh_min);
-        nvs_set_u16(nvs_handle, NVS_IMG_WIDTH, img_width);
-        nvs_set_u16(nvs_handle, NVS_IMG_HEIGHT, img_height);
-        nvs_set_u8(nvs_handle, NVS_IMG_SCALE, img_scale ? 1 : 0);
-        nvs_set_u16(nvs_handle, NVS_IMG_ROTATION, img_rotation);
-        nvs_set_u8(nvs_handle, NVS_IMG_MIRROR_H, img_mirror_h ? 1 : 0);
-        nvs_set_u8(nvs_handle, NVS_IMG_MIRROR_V, img_mirror_v ? 1 : 0);
-        nvs_set_u8(nvs_handle, NVS_IMG_ROT_FIRST, img_rot_first ? 1 : 0);
-        nvs_set_u8(nvs_handle, NVS_LED_DISABLED, led_disabled ? 1 : 0);
-        nvs_set_u8(nvs_handle, NVS_SSL_SKIP, ssl_skip ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-
-        // Update stored values
-        strncpy(stored_image_url, url, MAX_URL_LEN - 1);
-        stored_refresh_interval = refresh_min;
-        stored_img_width = img_width;
-        stored_img_height = img_height;
-        stored_img_scale = img_scale;
-        stored_img_rotation = img_rotation;
-        stored_img_mirror_h = img_mirror_h;
-        stored_img_mirror_v = img_mirror_v;
-        stored_img_rot_first = img_rot_first;
-        stored_led_disabled = led_disabled;
-        stored_ssl_skip = ssl_skip;
-
-        ESP_LOGI(TAG, "Display config saved - URL: %s, Refresh: %lu min, Rot: %d, LED disabled: %s, SSL skip: %s",
-                 url, (unsigned long)refresh_min, img_rotation, led_disabled ? "yes" : "no", ssl_skip ? "yes" : "no");
+                                        bool led_disabled, bool ssl_skip, bool refresh_align,
+                                        bool playlist, uint32_t playlist_check,
+                                        const char *panel_layout, const char *tile_layout) {
+    // Update stored values
+    strncpy(stored_image_url, url, MAX_URL_LEN - 1);
+    stored_refresh_interval = refresh_min;
+    stored_img_width = img_width;
+    stored_img_height = img_height;
+    stored_img_scale = img_scale;
+    stored_img_rotation = img_rotation;
+    stored_img_mirror_h = img_mirror_h;
+    stored_img_mirror_v = img_mirror_v;
+    stored_img_rot_first = img_rot_first;
+    stored_led_disabled = led_disabled;
+    stored_ssl_skip = ssl_skip;
+    stored_refresh_align = refresh_align;
+    stored_playlist = playlist;
+    stored_playlist_check = playlist_check;
+    strncpy(stored_panel_layout, panel_layout, MAX_PANEL_LAYOUT_LEN - 1);
+    strncpy(stored_tile_layout, tile_layout, MAX_TILE_LAYOUT_LEN - 1);
+
+    if (commit_config() == ESP_OK) {
+        ESP_LOGI(TAG, "Display config saved - URL: %s%s, Refresh: %lu min%s, Rot: %d, LED disabled: %s, SSL skip: %s",
+                 url, playlist ? " (playlist)" : "", (unsigned long)refresh_min,
+                 refresh_align ? " (aligned)" : "", img_rotation,
+                 led_disabled ? "yes" : "no", ssl_skip ? "yes" : "no");
     } else {
-        ESP_LOGE(TAG, "Failed to open NVS for writing");
+        ESP_LOGE(TAG, "Failed to write display config to NVS");
     }
 }
 
@@ -312,103 +517,114 @@ static void save_network_config_to_nvs(const char *ssid, const char *password,
                                         const char *hostname, const char *domain,
                                         bool use_dhcp, const char *static_ip, const char *static_mask,
                                         const char *static_gw, const char *dns_primary, const char *dns_secondary,
-                                        const char *dns_search, const char *ntp_server, const char *timezone) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_WIFI_SSID, ssid);
-        nvs_set_str(nvs_handle, NVS_WIFI_PASS, password);
-        nvs_set_str(nvs_handle, NVS_HOSTNAME, hostname);
-        nvs_set_str(nvs_handle, NVS_DOMAIN, domain);
-        nvs_set_u8(nvs_handle, NVS_USE_DHCP, use_dhcp ? 1 : 0);
-        nvs_set_str(nvs_handle, NVS_STATIC_IP, static_ip);
-        nvs_set_str(nvs_handle, NVS_STATIC_MASK, static_mask);
-        nvs_set_str(nvs_handle, NVS_STATIC_GW, static_gw);
-        nvs_set_str(nvs_handle, NVS_DNS_PRIMARY, dns_primary);
-        nvs_set_str(nvs_handle, NVS_DNS_SECONDARY, dns_secondary);
-        nvs_set_str(nvs_handle, NVS_DNS_SEARCH, dns_search);
-        nvs_set_str(nvs_handle, NVS_NTP_SERVER, ntp_server);
-        nvs_set_str(nvs_handle, NVS_TIMEZONE, timezone);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-
-        // Update stored values
-        strncpy(stored_ssid, ssid, MAX_SSID_LEN - 1);
-        strncpy(stored_password, password, MAX_PASSWORD_LEN - 1);
-        strncpy(stored_hostname, hostname, MAX_HOSTNAME_LEN - 1);
-        strncpy(stored_domain, domain, MAX_DOMAIN_LEN - 1);
-        stored_use_dhcp = use_dhcp;
-        strncpy(stored_static_ip, static_ip, MAX_IP_LEN - 1);
-        strncpy(stored_static_mask, static_mask, MAX_IP_LEN - 1);
-        strncpy(stored_static_gw, static_gw, MAX_IP_LEN - 1);
-        strncpy(stored_dns_primary, dns_primary, MAX_IP_LEN - 1);
-        strncpy(stored_dns_secondary, dns_secondary, MAX_IP_LEN - 1);
-        strncpy(stored_dns_search, dns_search, MAX_DOMAIN_LEN - 1);
-        strncpy(stored_ntp_server, ntp_server, MAX_NTP_SERVER_LEN - 1);
-        strncpy(stored_timezone, timezone, MAX_TIMEZONE_LEN - 1);
-
+                                        const char *dns_search, const char *ntp_server, const char *timezone,
+                                        uint16_t ntp_max_err) {
+    // Update stored values
+    strncpy(stored_ssid, ssid, MAX_SSID_LEN - 1);
+    strncpy(stored_password, password, MAX_PASSWORD_LEN - 1);
+    strncpy(stored_hostname, hostname, MAX_HOSTNAME_LEN - 1);
+    strncpy(stored_domain, domain, MAX_DOMAIN_LEN - 1);
+    stored_use_dhcp = use_dhcp;
+    strncpy(stored_static_ip, static_ip, MAX_IP_LEN - 1);
+    strncpy(stored_static_mask, static_mask, MAX_IP_LEN - 1);
+    strncpy(stored_static_gw, static_gw, MAX_IP_LEN - 1);
+    strncpy(stored_dns_primary, dns_primary, MAX_IP_LEN - 1);
+    strncpy(stored_dns_secondary, dns_secondary, MAX_IP_LEN - 1);
+    strncpy(stored_dns_search, dns_search, MAX_DOMAIN_LEN - 1);
+    strncpy(stored_ntp_server, ntp_server, MAX_NTP_SERVER_LEN - 1);
+    strncpy(stored_timezone, timezone, MAX_TIMEZONE_LEN - 1);
+    stored_ntp_max_err = ntp_max_err;
+
+    if (commit_config() == ESP_OK) {
         ESP_LOGI(TAG, "Network config saved - SSID: %s, Hostname: %s, DHCP: %s",
                  ssid, hostname, use_dhcp ? "yes" : "no");
     } else {
-        ESP_LOGE(TAG, "Failed to open NVS for writing");
+        ESP_LOGE(TAG, "Failed to write network config to NVS");
+    }
+}
+
+// Save schedule configuration to NVS (schedule_json already compiled into table)
+static void save_schedule_config_to_nvs(const char *schedule_json, const schedule_table_t *table,
+                                        bool schedule_enabled, bool cache_hints,
+                                        uint32_t cache_min, uint32_t cache_max) {
+    // Update stored values
+    strncpy(stored_schedule_json, schedule_json, MAX_SCHEDULE_JSON - 1);
+    stored_schedule_json[MAX_SCHEDULE_JSON - 1] = '\0';
+    stored_schedule_table = *table;
+    stored_schedule_enabled = schedule_enabled;
+    stored_cache_hints = cache_hints;
+    stored_cache_min = cache_min;
+    stored_cache_max = cache_max;
+
+    if (commit_config() == ESP_OK) {
+        ESP_LOGI(TAG, "Schedule config saved - Enabled: %s, JSON len: %d, Cache hints: %s (%lu-%lu min)",
+                 schedule_enabled ? "yes" : "no", strlen(schedule_json), cache_hints ? "yes" : "no",
+                 (unsigned long)cache_min, (unsigned long)cache_max);
+    } else {
+        ESP_LOGE(TAG, "Failed to write schedule config to NVS");
     }
 }
 
-// Save schedule configuration to NVS
-static void save_schedule_config_to_nvs(const char *schedule_json, bool schedule_enabled) {
+// The widget template is kept under its own NVS key: it is only read when
+// drawing or editing widgets, so it does not grow the config blob
+static bool load_widget_template(char *buf, size_t len) {
     nvs_handle_t nvs_handle;
-    esp_err_t err;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return false;
+    }
+    esp_err_t err = nvs_get_str(nvs_handle, NVS_WIDGET_TEMPLATE, buf, &len);
+    nvs_close(nvs_handle);
+    return err == ESP_OK;
+}
 
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+// Write the widget template to its NVS key
+static esp_err_t save_widget_template(const char *tmpl) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_SCHEDULE_JSON, schedule_json);
-        nvs_set_u8(nvs_handle, NVS_SCHEDULE_ENABLE, schedule_enabled ? 1 : 0);
-        nvs_commit(nvs_handle);
+        err = nvs_set_str(nvs_handle, NVS_WIDGET_TEMPLATE, tmpl);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
         nvs_close(nvs_handle);
+    }
+    return err;
+}
 
-        // Update stored values
-        strncpy(stored_schedule_json, schedule_json, MAX_SCHEDULE_JSON - 1);
-        stored_schedule_json[MAX_SCHEDULE_JSON - 1] = '\0';
-        stored_schedule_enabled = schedule_enabled;
+// Save widget mode and template to NVS (template already checked)
+static void save_widget_config_to_nvs(bool enabled, const char *tmpl) {
+    esp_err_t err = save_widget_template(tmpl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write widget template to NVS: %s", esp_err_to_name(err));
+        return;
+    }
 
-        ESP_LOGI(TAG, "Schedule config saved - Enabled: %s, JSON len: %d",
-                 schedule_enabled ? "yes" : "no", strlen(schedule_json));
+    stored_widgets = enabled;
+    if (commit_config() == ESP_OK) {
+        ESP_LOGI(TAG, "Widget config saved - Enabled: %s, Template len: %d",
+                 enabled ? "yes" : "no", strlen(tmpl));
     } else {
-        ESP_LOGE(TAG, "Failed to open NVS for writing schedule config");
+        ESP_LOGE(TAG, "Failed to write widget config to NVS");
     }
 }
 
 // Save syslog configuration to NVS
 static void save_syslog_config_to_nvs(const char *host, uint16_t port,
                                        bool enabled, uint8_t format, uint8_t transport) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err;
-
-    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err == ESP_OK) {
-        nvs_set_str(nvs_handle, NVS_SYSLOG_HOST, host);
-        nvs_set_u16(nvs_handle, NVS_SYSLOG_PORT, port);
-        nvs_set_u8(nvs_handle, NVS_SYSLOG_ENABLED, enabled ? 1 : 0);
-        nvs_set_u8(nvs_handle, NVS_SYSLOG_FORMAT, format);
-        nvs_set_u8(nvs_handle, NVS_SYSLOG_TRANSPORT, transport);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
-
-        strncpy(stored_syslog_host, host, MAX_SYSLOG_HOST_LEN - 1);
-        stored_syslog_host[MAX_SYSLOG_HOST_LEN - 1] = '\0';
-        stored_syslog_port = port;
-        stored_syslog_enabled = enabled;
-        stored_syslog_format = format;
-        stored_syslog_transport = transport;
-
+    strncpy(stored_syslog_host, host, MAX_SYSLOG_HOST_LEN - 1);
+    stored_syslog_host[MAX_SYSLOG_HOST_LEN - 1] = '\0';
+    stored_syslog_port = port;
+    stored_syslog_enabled = enabled;
+    stored_syslog_format = format;
+    stored_syslog_transport = transport;
+
+    if (commit_config() == ESP_OK) {
         ESP_LOGI(TAG, "Syslog config saved - Host: %s, Port: %u, Enabled: %s, Format: %s, Transport: %s",
                  host, port, enabled ? "yes" : "no",
                  format == 1 ? "RFC5424" : "RFC3164",
                  transport == 1 ? "TCP" : "UDP");
     } else {
-        ESP_LOGE(TAG, "Failed to open NVS for syslog config");
+        ESP_LOGE(TAG, "Failed to write syslog config to NVS");
     }
 }
 
@@ -419,6 +635,24 @@ static void time_sync_notification_cb(struct timeval *tv) {
     time(&last_ntp_sync);
 }
 
+// Replaces the weak ESP-IDF implementation: the clock is read just before it
+// is set, so the offset NTP corrected feeds the drift estimate
+void sntp_sync_time(struct timeval *tv) {
+    struct timeval before;
+    gettimeofday(&before, NULL);
+    settimeofday(tv, NULL);
+    sntp_set_sync_status(SNTP_SYNC_STATUS_COMPLETED);
+
+    int64_t clock_us = (int64_t)before.tv_sec * 1000000 + before.tv_usec;
+    int64_t ntp_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    time_drift_on_sync(&time_drift, clock_us, ntp_us);
+    ESP_LOGI(TAG, "Clock was off by %lld ms, drift estimate %ld ppb (%u samples)",
+             (long long)((clock_us - ntp_us) / 1000), (long)time_drift.drift_ppb,
+             time_drift.samples);
+
+    time_sync_notification_cb(tv);
+}
+
 // Convert common timezone names to POSIX TZ format
 // ESP-IDF newlib doesn't have full tzdata, so we need POSIX format
 static const char* get_posix_timezone(const char *tz_name) {
@@ -531,15 +765,13 @@ static bool wait_for_ntp_sync(uint32_t timeout_seconds) {
             return false;
         }
 
-        // Check if time is synced (year > 2024 means NTP worked)
+        // Synced once the notification callback ran and the time is plausible
         time_t now;
         struct tm timeinfo;
         time(&now);
         localtime_r(&now, &timeinfo);
 
-        if (timeinfo.tm_year + 1900 > 2024) {
-            ntp_synced = true;
-            time(&last_ntp_sync);
+        if (ntp_synced && timeinfo.tm_year + 1900 > 2024) {
             char time_str[32];
             strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &timeinfo);
             ESP_LOGI(TAG, "NTP synced! Current time: %s", time_str);
@@ -562,142 +794,163 @@ static bool trigger_ntp_sync(void) {
     // Re-configure with current settings
     apply_timezone();
 
+    ntp_synced = false;
     esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
     esp_sntp_setservername(0, stored_ntp_server);
+    esp_sntp_set_time_sync_notification_cb(time_sync_notification_cb);
     esp_sntp_init();
+    sntp_started = true;
 
     // Wait for sync with timeout (5 seconds for manual trigger)
     return wait_for_ntp_sync(5);
 }
 
-// Get current refresh interval based on schedule (returns 0 if schedule disabled or error)
-// This is a simple JSON parser for our specific schedule format
-static uint32_t get_scheduled_interval(void) {
-    if (!stored_schedule_enabled || stored_schedule_json[0] == '\0') {
-        return 0;  // Schedule not enabled, use default interval
+// Current RTC clock in microseconds since the epoch
+static int64_t clock_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Clock holds a real date (kept through deep sleep, lost on power-up)
+static bool clock_is_set(void) {
+    time_t now = time(NULL);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+    return timeinfo.tm_year + 1900 > 2024;
+}
+
+// Start time synchronization for this wake. Without a valid clock, blocks
+// until NTP answers (as before). With a valid clock, NTP only runs if the
+// predicted drift exceeds the configured bound (or force is set) and then
+// completes in the background; otherwise the drift correction is applied
+// to the clock and NTP is skipped entirely.
+static void start_time_sync(bool force) {
+    apply_timezone();
+    if (stored_ntp_server[0] == '\0') {
+        return;
+    }
+
+    if (!clock_is_set()) {
+        ESP_LOGI(TAG, "Clock not set, waiting for time synchronization...");
+        init_sntp();
+        sntp_started = true;
+        if (!wait_for_ntp_sync(60)) {
+            ESP_LOGW(TAG, "Time sync failed or timed out, continuing anyway");
+        }
+        log_stage(STAGE_TIME_SYNCED);
+        return;
+    }
+
+    int64_t now_us = clock_now_us();
+    if (force || time_drift_sync_needed(&time_drift, now_us, stored_ntp_max_err * 1000U,
+                                        TIME_DRIFT_MAX_AGE_S)) {
+        ntp_synced = false;
+        init_sntp();
+        sntp_started = true;
+        return;
+    }
+
+    int64_t correction_us = time_drift_compensate(&time_drift, now_us);
+    if (correction_us != 0) {
+        int64_t corrected_us = clock_now_us() - correction_us;
+        struct timeval tv = {
+            .tv_sec = corrected_us / 1000000,
+            .tv_usec = corrected_us % 1000000,
+        };
+        settimeofday(&tv, NULL);
+    }
+    ntp_synced = true;
+    ESP_LOGI(TAG, "Skipping NTP: drift correction %lld ms, predicted error %lu ms",
+             (long long)(correction_us / 1000),
+             (unsigned long)time_drift_predicted_error_ms(&time_drift, clock_now_us()));
+}
+
+// Give a background NTP request a few seconds to finish before the network
+// goes down, then stop SNTP
+static void finish_time_sync(void) {
+    if (!sntp_started) {
+        return;
+    }
+    if (!ntp_synced && !wait_for_ntp_sync(5)) {
+        ESP_LOGW(TAG, "NTP did not answer, drift estimate unchanged");
+    }
+    esp_sntp_stop();
+    sntp_started = false;
+    log_stage(STAGE_TIME_SYNCED);
+}
+
+// Planned seconds until the next refresh: the default interval, or the
+// schedule's interval cut short at the next period boundary so it takes
+// effect on time. In aligned mode the wake lands on the wall-clock grid of
+// the interval, early by the usual wake-to-download time. limit_s receives
+// the time to the period boundary (UINT32_MAX if none comes first).
+static uint32_t get_planned_sleep_seconds(uint32_t *limit_s) {
+    uint32_t default_s = stored_refresh_interval * 60;
+    *limit_s = UINT32_MAX;
+    bool use_schedule = stored_schedule_enabled && stored_schedule_table.valid;
+
+    if (!use_schedule && !stored_refresh_align) {
+        ESP_LOGI(TAG, "Using default interval: %lu min", (unsigned long)stored_refresh_interval);
+        return default_s;
+    }
+    if (!clock_is_set()) {
+        ESP_LOGW(TAG, "Clock not set, using default interval: %lu min",
+                 (unsigned long)stored_refresh_interval);
+        return default_s;
     }
 
-    // Get current time
     time_t now;
     struct tm timeinfo;
     time(&now);
     localtime_r(&now, &timeinfo);
 
-    // Day names in order (0=Mon, 6=Sun) - our schedule uses Mon-Sun
-    const char* day_names[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
-    // tm_wday is 0=Sunday, so convert: Sun(0)->6, Mon(1)->0, etc.
-    int day_idx = (timeinfo.tm_wday == 0) ? 6 : timeinfo.tm_wday - 1;
-    const char* today = day_names[day_idx];
-
-    int current_minutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-
-    ESP_LOGI(TAG, "Schedule check: %s %02d:%02d (%d min)", today, timeinfo.tm_hour, timeinfo.tm_min, current_minutes);
-
-    const char* json = stored_schedule_json[0] ? stored_schedule_json : default_schedule_json;
-
-    // Find which plan is assigned to today
-    // Look for "days":{"Mon":"PlanName",...}
-    char search_key[16];
-    snprintf(search_key, sizeof(search_key), "\"%s\":\"", today);
-    const char* day_ptr = strstr(json, search_key);
-    if (!day_ptr) {
-        ESP_LOGW(TAG, "Schedule: Day %s not found in assignments", today);
-        return 0;
-    }
-
-    // Extract plan name
-    day_ptr += strlen(search_key);
-    const char* plan_end = strchr(day_ptr, '"');
-    if (!plan_end) return 0;
-
-    char plan_name[32];
-    size_t plan_len = plan_end - day_ptr;
-    if (plan_len >= sizeof(plan_name)) plan_len = sizeof(plan_name) - 1;
-    strncpy(plan_name, day_ptr, plan_len);
-    plan_name[plan_len] = '\0';
-
-    ESP_LOGI(TAG, "Schedule: Today's plan is '%s'", plan_name);
-
-    // Find the plan in the plans array
-    // Look for "name":"PlanName" within plans array
-    char plan_search[48];
-    snprintf(plan_search, sizeof(plan_search), "\"name\":\"%s\"", plan_name);
-    const char* plan_ptr = strstr(json, plan_search);
-    if (!plan_ptr) {
-        ESP_LOGW(TAG, "Schedule: Plan '%s' not found", plan_name);
-        return 0;
-    }
-
-    // Find the periods array for this plan
-    const char* periods_ptr = strstr(plan_ptr, "\"periods\":[");
-    if (!periods_ptr) return 0;
-    periods_ptr += 11;  // Skip "periods":[
-
-    // Parse each period: {"start":"HH:MM","end":"HH:MM","interval":N}
-    const char* p = periods_ptr;
-    while (*p && *p != ']') {
-        // Find start time
-        const char* start_ptr = strstr(p, "\"start\":\"");
-        if (!start_ptr || start_ptr > strchr(p, '}')) break;
-        start_ptr += 9;
-        int start_h = 0, start_m = 0;
-        sscanf(start_ptr, "%d:%d", &start_h, &start_m);
-        int start_min = start_h * 60 + start_m;
-
-        // Find end time
-        const char* end_ptr = strstr(p, "\"end\":\"");
-        if (!end_ptr) break;
-        end_ptr += 7;
-        int end_h = 0, end_m = 0;
-        sscanf(end_ptr, "%d:%d", &end_h, &end_m);
-        int end_min = end_h * 60 + end_m;
-
-        // Find interval
-        const char* int_ptr = strstr(p, "\"interval\":");
-        if (!int_ptr) break;
-        int_ptr += 11;
-        int interval = atoi(int_ptr);
-
-        ESP_LOGD(TAG, "Period: %02d:%02d-%02d:%02d = %d min", start_h, start_m, end_h, end_m, interval);
-
-        // Check if current time falls in this period
-        bool in_period = false;
-        if (start_min == end_min) {
-            // All day period (00:00-00:00 means 24h)
-            in_period = true;
-        } else if (start_min < end_min) {
-            // Normal period (e.g., 06:00-22:00)
-            in_period = (current_minutes >= start_min && current_minutes < end_min);
-        } else {
-            // Overnight period (e.g., 22:00-06:00)
-            in_period = (current_minutes >= start_min || current_minutes < end_min);
-        }
+    // tm_wday is 0=Sunday, the schedule starts on Monday
+    int day = (timeinfo.tm_wday + 6) % 7;
+    uint32_t second = timeinfo.tm_hour * 3600 + timeinfo.tm_min * 60 + timeinfo.tm_sec;
+    uint32_t interval = stored_refresh_interval;
+    uint32_t sleep_s = default_s;
 
-        if (in_period) {
-            ESP_LOGI(TAG, "Schedule: Using interval %d min (period %02d:%02d-%02d:%02d)",
-                     interval, start_h, start_m, end_h, end_m);
-            return (uint32_t)interval;
+    if (use_schedule) {
+        uint32_t scheduled = schedule_interval_at(&stored_schedule_table, day, second / 60);
+        if (scheduled > 0) {
+            interval = scheduled;
+        }
+        sleep_s = schedule_next_wake_s(&stored_schedule_table, day, second,
+                                       stored_refresh_interval);
+        if (sleep_s < interval * 60) {
+            *limit_s = sleep_s;  // Period boundary comes first
         }
-
-        // Move to next period
-        p = strchr(p, '}');
-        if (!p) break;
-        p++;
     }
 
-    ESP_LOGW(TAG, "Schedule: No matching period found for current time");
-    return 0;
+    if (stored_refresh_align) {
+        uint32_t lead_s = (fetch_latency_ms + 500) / 1000;
+        sleep_s = schedule_align_s(second, interval, lead_s, *limit_s);
+        ESP_LOGI(TAG, "Aligned wake: %02d:%02d:%02d, grid %lu min, lead %lu s, next wake in %lu s",
+                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, (unsigned long)interval,
+                 (unsigned long)lead_s, (unsigned long)sleep_s);
+    } else {
+        ESP_LOGI(TAG, "Schedule: %02d:%02d:%02d, interval %lu min, next wake in %lu s",
+                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                 (unsigned long)interval, (unsigned long)sleep_s);
+    }
+    return sleep_s;
 }
 
-// Get effective refresh interval (schedule or default)
-static uint32_t get_effective_refresh_interval(void) {
-    uint32_t scheduled = get_scheduled_interval();
-    if (scheduled > 0) {
-        ESP_LOGI(TAG, "Using scheduled interval: %lu min", (unsigned long)scheduled);
-        return scheduled;
+// Seconds until the next refresh: the planned sleep, or with cache hints
+// enabled the server's expected change time within the configured bounds
+static uint32_t get_sleep_seconds(void) {
+    uint32_t limit_s;
+    uint32_t sleep_s = get_planned_sleep_seconds(&limit_s);
+    uint32_t hint_s;
+
+    if (stored_cache_hints &&
+        (image_processor_get_next_change(&hint_s) || tiles_get_next_change(&hint_s))) {
+        sleep_s = http_cache_policy_s(hint_s, stored_cache_min * 60, stored_cache_max * 60, limit_s);
+        ESP_LOGI(TAG, "Cache hint: new content in %lu s, next wake in %lu s",
+                 (unsigned long)hint_s, (unsigned long)sleep_s);
     }
-    ESP_LOGI(TAG, "Using default interval: %lu min", (unsigned long)stored_refresh_interval);
-    return stored_refresh_interval;
+    return sleep_s;
 }
 
 // Initialize WS2812 LED on GPIO 48 using led_strip component
@@ -903,6 +1156,9 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         esp_wifi_connect();
+        if (stage_ms[STAGE_FIRST_PACKET] == 0) {
+            log_stage(STAGE_FIRST_PACKET);  // Probe/auth frames go out from here
+        }
         ESP_LOGI(TAG, "WiFi STA started, connecting...");
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         wifi_event_sta_disconnected_t* disconnected = (wifi_event_sta_disconnected_t*) event_data;
@@ -940,10 +1196,9 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "Got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        wifi_cache_store(sta_netif, stored_ssid, stored_password, !lease_reused);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         wifi_connected = true;
-        // Initialize SNTP for time synchronization
-        init_sntp();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
         ESP_LOGI(TAG, "WiFi AP started");
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
@@ -960,9 +1215,8 @@ static void wifi_init_netif(void) {
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    // Create both STA and AP network interfaces
+    // The AP interface (and its DHCP server) is created on first use in wifi_init_ap()
     sta_netif = esp_netif_create_default_wifi_sta();
-    ap_netif = esp_netif_create_default_wifi_ap();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
@@ -981,15 +1235,37 @@ static void wifi_init_netif(void) {
     ESP_LOGI(TAG, "WiFi network interfaces initialized");
 }
 
+// Start STA with the given config and wait for an IP address
+static bool wifi_sta_attempt(wifi_config_t *wifi_config, uint32_t timeout_ms) {
+    // Reset state
+    s_retry_num = 0;
+    wifi_connected = false;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    // Wait for connection with timeout
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
+            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+            pdFALSE,
+            pdFALSE,
+            pdMS_TO_TICKS(timeout_ms));
+
+    if (bits & WIFI_CONNECTED_BIT) {
+        return true;
+    }
+    esp_wifi_stop();
+    return false;
+}
+
 // Initialize WiFi in station mode with timeout
 static bool wifi_init_sta_with_timeout(uint32_t timeout_ms) {
     ESP_LOGI(TAG, "Starting WiFi STA mode, timeout: %lu ms", (unsigned long)timeout_ms);
 
-    // Reset state
-    s_retry_num = 0;
-    wifi_connected = false;
     ap_mode = false;
-    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    lease_reused = false;
 
     // Configure STA
     wifi_config_t wifi_config = {
@@ -1005,24 +1281,36 @@ static bool wifi_init_sta_with_timeout(uint32_t timeout_ms) {
     strncpy((char *)wifi_config.sta.password, stored_password, sizeof(wifi_config.sta.password));
 
     ESP_LOGI(TAG, "Connecting to SSID: '%s'", stored_ssid);
+    int64_t start_us = esp_timer_get_time();
+
+    // Fast path: AP and lease from the previous wake (RTC memory)
+    wifi_config_t fast_config = wifi_config;
+    wifi_path_t path = wifi_cache_begin(stored_ssid, stored_password, stored_use_dhcp, sta_netif,
+                                        &fast_config.sta);
+    if (path != WIFI_PATH_FULL) {
+        lease_reused = path == WIFI_PATH_FAST_LEASE;
+        bool ok = wifi_sta_attempt(&fast_config, MIN(timeout_ms, WIFI_FAST_CONNECT_TIMEOUT_MS));
+        wifi_cache_record(path, ok, (uint32_t)((esp_timer_get_time() - start_us) / 1000));
+        if (ok) {
+            ESP_LOGI(TAG, "Connected to AP SSID: %s (%s)", stored_ssid, wifi_cache_path_name(path));
+            return true;
+        }
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+        ESP_LOGW(TAG, "Fast connect failed, falling back to full scan");
+        wifi_cache_fast_failed(sta_netif, path);
+        lease_reused = false;
+    }
 
-    // Wait for connection with timeout
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE,
-            pdFALSE,
-            pdMS_TO_TICKS(timeout_ms));
+    // Full path: scan for the SSID and run DHCP
+    int64_t full_start_us = esp_timer_get_time();
+    bool ok = wifi_sta_attempt(&wifi_config, timeout_ms);
+    wifi_cache_record(WIFI_PATH_FULL, ok, (uint32_t)((esp_timer_get_time() - full_start_us) / 1000));
 
-    if (bits & WIFI_CONNECTED_BIT) {
+    if (ok) {
         ESP_LOGI(TAG, "Connected to AP SSID: %s", stored_ssid);
         return true;
     } else {
         ESP_LOGW(TAG, "Failed to connect to SSID: %s (timeout or auth failure)", stored_ssid);
-        esp_wifi_stop();
         return false;
     }
 }
@@ -1034,6 +1322,10 @@ static void wifi_init_ap(void) {
     ap_mode = true;
     wifi_connected = false;
 
+    if (ap_netif == NULL) {
+        ap_netif = esp_netif_create_default_wifi_ap();
+    }
+
     wifi_config_t wifi_config = {
         .ap = {
             .ssid = AP_SSID,
@@ -1063,443 +1355,16 @@ static void wifi_deinit(void) {
     ESP_LOGI(TAG, "WiFi stopped");
 }
 
-// HTML page CSS styles (shared between tabs)
-static const char* html_styles =
-"<style>"
-"body{font-family:Arial,sans-serif;margin:20px;background:#f0f0f0;}"
-"h1,h2,h3{color:#333;margin-top:0;}"
-".container{background:white;padding:20px;border-radius:10px;max-width:550px;margin:0 auto;box-shadow:0 2px 5px rgba(0,0,0,0.1);}"
-".tabs{display:flex;border-bottom:2px solid #ddd;margin-bottom:15px;}"
-".tab{padding:12px 20px;cursor:pointer;border:none;background:none;font-size:16px;color:#666;border-bottom:3px solid transparent;margin-bottom:-2px;}"
-".tab.active{color:#2196F3;border-bottom-color:#2196F3;font-weight:bold;}"
-".tab:hover{color:#2196F3;}"
-".tab-content{display:none;}"
-".tab-content.active{display:block;}"
-"input[type=text],input[type=password],input[type=number],select{width:100%;padding:10px;margin:8px 0;box-sizing:border-box;border:1px solid #ddd;border-radius:4px;}"
-"input[type=submit],.btn{background:#4CAF50;color:white;padding:12px 20px;border:none;border-radius:4px;cursor:pointer;width:100%;font-size:16px;margin:5px 0;display:block;text-align:center;text-decoration:none;box-sizing:border-box;}"
-"input[type=submit]:hover,.btn:hover{opacity:0.9;}"
-".btn-test{width:auto!important;display:inline-block!important;padding:10px 20px;}"
-".test-buttons{display:flex;flex-wrap:wrap;gap:8px;}"
-".btn-blue{background:#2196F3;}"
-".btn-orange{background:#FF9800;}"
-".btn-red{background:#f44336;}"
-".btn-small{width:auto;display:inline-block;flex-shrink:0;}"
-"label{font-weight:bold;color:#555;display:block;margin-top:10px;}"
-".info{background:#e7f3fe;border-left:4px solid #2196F3;padding:10px;margin:10px 0;word-wrap:break-word;}"
-".info a{color:#1565c0;word-break:break-all;}"
-".row{display:flex;gap:10px;}"
-".row input,.row select{flex:1;}"
-".checkbox-row{display:flex;align-items:center;margin:10px 0;}"
-".checkbox-row input{width:auto;margin-right:10px;}"
-".section{border-top:1px solid #ddd;margin-top:20px;padding-top:15px;}"
-".subsection{background:#f9f9f9;padding:15px;border-radius:8px;margin:15px 0;}"
-".subsection h3{font-size:14px;margin-bottom:10px;}"
-".radio-row{display:flex;align-items:center;margin:5px 0;}"
-".radio-row input{width:auto;margin-right:8px;}"
-".help{font-size:0.85em;color:#888;margin-top:20px;}"
-".help p{margin:5px 0;}"
-".ap-notice{background:#fff3cd;border-left:4px solid #ffc107;padding:10px;margin:10px 0;}"
-".tz-help{font-size:0.85em;color:#666;margin:5px 0 15px 0;}"
-".tz-help a{color:#2196F3;}"
-".time-display{background:#e8f5e9;padding:15px;border-radius:8px;margin-bottom:15px;border:1px solid #c8e6c9;}"
-".time-display.not-synced{background:#fff3e0;border-color:#ffe0b2;}"
-".time-display .current-time{font-size:1.5em;font-weight:bold;color:#333;margin-bottom:5px;}"
-".time-display .time-info{font-size:0.9em;color:#666;margin:3px 0;}"
-".time-display .sync-status{font-size:0.85em;padding:3px 8px;border-radius:12px;display:inline-block;}"
-".time-display .sync-status.synced{background:#c8e6c9;color:#2e7d32;}"
-".time-display .sync-status.not-synced{background:#ffe0b2;color:#e65100;}"
-".sync-btn{background:#2196F3;color:white;border:none;padding:8px 16px;border-radius:4px;cursor:pointer;font-size:14px;margin-top:10px;}"
-".sync-btn:hover{background:#1976D2;}"
-".sync-btn:disabled{background:#ccc;cursor:not-allowed;}"
-".sync-btn .spinner{display:inline-block;width:12px;height:12px;border:2px solid #fff;border-top-color:transparent;border-radius:50%;animation:spin 1s linear infinite;margin-right:6px;vertical-align:middle;}"
-"@keyframes spin{to{transform:rotate(360deg);}}"
-".progress-container{background:#e0e0e0;border-radius:4px;height:24px;margin:15px 0;overflow:hidden;}"
-".progress-bar{background:#4CAF50;height:100%;width:0%;transition:width 0.3s;display:flex;align-items:center;justify-content:center;color:white;font-size:12px;}"
-".ota-status{padding:10px;margin:10px 0;border-radius:4px;display:none;}"
-".ota-success{background:#d4edda;border:1px solid #c3e6cb;color:#155724;}"
-".ota-error{background:#f8d7da;border:1px solid #f5c6cb;color:#721c24;}"
-".file-input{margin:15px 0;}"
-".version-info{background:#e7f3fe;padding:15px;border-radius:8px;margin-bottom:15px;}"
-".version-info p{margin:5px 0;}"
-".plan-tabs{display:flex;gap:4px;border-bottom:2px solid #e0e0e0;margin:12px 0;flex-wrap:wrap;}"
-".plan-tab{padding:6px 12px;cursor:pointer;border-radius:6px 6px 0 0;background:#f0f0f0;font-size:13px;}"
-".plan-tab.active{background:#2196F3;color:white;}"
-".plan-tab-add{background:#e8f5e9;color:#2e7d32;}"
-".plan-content{display:none;padding:12px;border:1px solid #e0e0e0;border-top:none;border-radius:0 0 8px 8px;}"
-".plan-content.active{display:block;}"
-".day-grid{display:flex;flex-wrap:wrap;gap:6px;margin:12px 0;justify-content:center;}"
-".day-card{text-align:center;padding:8px 4px;border:2px solid #e0e0e0;border-radius:6px;background:#fafafa;min-width:70px;flex:1 1 auto;max-width:100px;}"
-".day-card.today{border-color:#4CAF50;background:#e8f5e9;}"
-".day-name{font-weight:600;font-size:12px;margin-bottom:4px;}"
-".day-card select{width:100%;padding:3px;font-size:11px;border-radius:4px;}"
-".period-table{width:100%;border-collapse:collapse;margin:8px 0;}"
-".period-table th{text-align:left;padding:6px;background:#f5f5f5;font-size:12px;}"
-".period-table td{padding:4px;}"
-".period-table input[type=time]{width:80px;padding:4px;font-size:12px;}"
-".period-table input[type=number]{width:60px;padding:4px;font-size:12px;}"
-".period-table .btn-del{padding:2px 8px;font-size:11px;}"
-".preset-btns{display:flex;gap:6px;margin:8px 0;flex-wrap:wrap;}"
-".preset-btn{padding:4px 10px;font-size:11px;background:#e0e0e0;border:none;border-radius:4px;cursor:pointer;}"
-".sched-enable{display:flex;align-items:center;gap:8px;margin:10px 0;padding:10px;background:#e3f2fd;border-radius:6px;}"
-"</style>";
-
-// HTML page JavaScript for tabs and OTA
-static const char* html_script =
-"<script>"
-"function showTab(tabId){"
-"document.querySelectorAll('.tab-content').forEach(c=>c.classList.remove('active'));"
-"document.querySelectorAll('.tab').forEach(t=>t.classList.remove('active'));"
-"document.getElementById(tabId).classList.add('active');"
-"document.querySelector('[onclick*=\"'+tabId+'\"]').classList.add('active');"
-"}"
-"function toggleDhcp(){"
-"var dhcp=document.getElementById('dhcp_on').checked;"
-"document.querySelectorAll('.static-ip').forEach(e=>e.disabled=dhcp);"
-"}"
-"function uploadFirmware(){"
-"var fileInput=document.getElementById('firmware-file');"
-"var file=fileInput.files[0];"
-"if(!file){alert('Please select a firmware file');return;}"
-"if(!file.name.endsWith('.bin')){alert('Please select a .bin file');return;}"
-"var progressBar=document.getElementById('ota-progress');"
-"var progressText=document.getElementById('ota-progress-text');"
-"var statusDiv=document.getElementById('ota-status');"
-"var uploadBtn=document.getElementById('upload-btn');"
-"uploadBtn.disabled=true;"
-"statusDiv.style.display='none';"
-"progressBar.style.width='0%';"
-"progressText.textContent='0%';"
-"document.querySelector('.progress-container').style.display='block';"
-"var xhr=new XMLHttpRequest();"
-"xhr.open('POST','/ota',true);"
-"xhr.upload.onprogress=function(e){"
-"if(e.lengthComputable){"
-"var pct=Math.round((e.loaded/e.total)*100);"
-"progressBar.style.width=pct+'%';"
-"progressText.textContent=pct+'%';"
-"}};"
-"xhr.onload=function(){"
-"uploadBtn.disabled=false;"
-"if(xhr.status==200){"
-"statusDiv.className='ota-status ota-success';"
-"statusDiv.innerHTML='<strong>Success!</strong> '+xhr.responseText;"
-"statusDiv.style.display='block';"
-"}else{"
-"statusDiv.className='ota-status ota-error';"
-"statusDiv.innerHTML='<strong>Error:</strong> '+xhr.responseText;"
-"statusDiv.style.display='block';"
-"}};"
-"xhr.onerror=function(){"
-"uploadBtn.disabled=false;"
-"statusDiv.className='ota-status ota-error';"
-"statusDiv.innerHTML='<strong>Error:</strong> Upload failed';"
-"statusDiv.style.display='block';"
-"};"
-"xhr.send(file);"
-"}"
-"var timeUpdateInterval=null;"
-"function updateTime(){"
-"fetch('/api/time').then(r=>r.json()).then(d=>{"
-"var el=document.getElementById('currentTime');"
-"if(el)el.textContent=d.time;"
-"var tz=document.getElementById('tzDisplay');"
-"if(tz)tz.textContent=d.timezone;"
-"var st=document.getElementById('syncStatus');"
-"var td=document.getElementById('timeDisplay');"
-"if(st&&td){"
-"if(d.synced){st.textContent='Synced';st.className='sync-status synced';td.className='time-display';}"
-"else{st.textContent='Not Synced';st.className='sync-status not-synced';td.className='time-display not-synced';}"
-"}"
-"}).catch(e=>console.log('Time update error:',e));}"
-"function syncNtp(){"
-"var btn=document.getElementById('syncBtn');"
-"btn.disabled=true;btn.innerHTML='<span class=\"spinner\"></span>Syncing...';"
-"fetch('/api/ntp_sync',{method:'POST'}).then(r=>r.json()).then(d=>{"
-"btn.disabled=false;btn.textContent='Sync Now';"
-"if(d.success){updateTime();}else{alert('NTP sync failed. Check NTP server settings.');}"
-"}).catch(e=>{btn.disabled=false;btn.textContent='Sync Now';alert('Sync error: '+e);});}"
-"function startTimeUpdate(){updateTime();timeUpdateInterval=setInterval(updateTime,1000);}"
-"if(document.readyState==='loading'){document.addEventListener('DOMContentLoaded',startTimeUpdate);}else{startTimeUpdate();}"
-"</script>";
-
-// Schedule Plans JavaScript
-static const char* html_schedule_script =
-"<script>"
-"var DAYS=['Mon','Tue','Wed','Thu','Fri','Sat','Sun'];"
-"var schedData=%s;"  // JSON data injected here
-"var activePlan=0;"
-"function initSched(){renderDays();renderPlanTabs();renderPlanContent();}"
-"function renderDays(){"
-"var c=document.getElementById('dayGrid');"
-"var today=new Date().getDay();var ti=today===0?6:today-1;"
-"c.innerHTML=DAYS.map((d,i)=>'<div class=\"day-card'+(i===ti?' today':'')+'\"><div class=\"day-name\">'+d+'</div>'"
-"+'<select onchange=\"setDay(\\''+d+'\\',this.value)\">'+schedData.plans.map(p=>'<option'+(schedData.days[d]===p.name?' selected':'')+'>'+p.name+'</option>').join('')+'</select></div>').join('');"
-"}"
-"function renderPlanTabs(){"
-"var c=document.getElementById('planTabs');"
-"c.innerHTML=schedData.plans.map((p,i)=>'<div class=\"plan-tab'+(i===activePlan?' active':'')+'\" onclick=\"selPlan('+i+')\">'+p.name+'</div>').join('')"
-"+(schedData.plans.length<4?'<div class=\"plan-tab plan-tab-add\" onclick=\"addPlan()\">+ New</div>':'');"
-"}"
-"function renderPlanContent(){"
-"var c=document.getElementById('planContent');"
-"var p=schedData.plans[activePlan];"
-"c.innerHTML='<div class=\"row\"><input type=\"text\" value=\"'+p.name+'\" onchange=\"renamePlan(this.value)\" style=\"flex:1\">'+(schedData.plans.length>1?'<button type=\"button\" class=\"btn btn-red btn-small\" onclick=\"delPlan()\">Delete</button>':'')+'</div>'"
-"+'<table class=\"period-table\"><tr><th>Start</th><th>End</th><th>Interval</th><th></th></tr>'"
-"+p.periods.map((r,i)=>'<tr><td><input type=\"time\" value=\"'+r.start+'\" onchange=\"updPeriod('+i+',\\'start\\',this.value)\"></td>'"
-"+'<td><input type=\"time\" value=\"'+r.end+'\" onchange=\"updPeriod('+i+',\\'end\\',this.value)\"></td>'"
-"+'<td><input type=\"number\" value=\"'+r.interval+'\" min=\"1\" max=\"1440\" onchange=\"updPeriod('+i+',\\'interval\\',this.value)\"> min</td>'"
-"+'<td>'+(p.periods.length>1?'<button type=\"button\" class=\"btn btn-red btn-del\" onclick=\"delPeriod('+i+')\">X</button>':'')+'</td></tr>').join('')"
-"+'</table><div class=\"preset-btns\"><button type=\"button\" class=\"preset-btn\" onclick=\"addPeriod()\">+ Add</button>'"
-"+'<button type=\"button\" class=\"preset-btn\" onclick=\"preset(\\'simple\\')\">Simple</button>'"
-"+'<button type=\"button\" class=\"preset-btn\" onclick=\"preset(\\'daynight\\')\">Day/Night</button></div>';"
-"syncHidden();"
-"}"
-"function selPlan(i){activePlan=i;renderPlanTabs();renderPlanContent();}"
-"function addPlan(){"
-"var n=prompt('Plan name:','Plan '+(schedData.plans.length+1));"
-"if(n&&!schedData.plans.find(p=>p.name===n)){schedData.plans.push({name:n,periods:[{start:'00:00',end:'00:00',interval:60}]});activePlan=schedData.plans.length-1;renderDays();renderPlanTabs();renderPlanContent();}"
-"}"
-"function renamePlan(n){"
-"if(!n.trim())return;var old=schedData.plans[activePlan].name;"
-"if(schedData.plans.find((p,i)=>i!==activePlan&&p.name===n)){alert('Name exists');return;}"
-"schedData.plans[activePlan].name=n;"
-"DAYS.forEach(d=>{if(schedData.days[d]===old)schedData.days[d]=n;});"
-"renderDays();renderPlanTabs();syncHidden();"
-"}"
-"function delPlan(){"
-"if(schedData.plans.length<2)return;"
-"var name=schedData.plans[activePlan].name;"
-"var fb=schedData.plans.find((p,i)=>i!==activePlan).name;"
-"DAYS.forEach(d=>{if(schedData.days[d]===name)schedData.days[d]=fb;});"
-"schedData.plans.splice(activePlan,1);activePlan=0;"
-"renderDays();renderPlanTabs();renderPlanContent();"
-"}"
-"function setDay(d,v){schedData.days[d]=v;syncHidden();}"
-"function addPeriod(){schedData.plans[activePlan].periods.push({start:'00:00',end:'00:00',interval:60});renderPlanContent();}"
-"function delPeriod(i){if(schedData.plans[activePlan].periods.length>1){schedData.plans[activePlan].periods.splice(i,1);renderPlanContent();}}"
-"function updPeriod(i,f,v){schedData.plans[activePlan].periods[i][f]=f==='interval'?parseInt(v):v;syncHidden();}"
-"function preset(t){"
-"var p=schedData.plans[activePlan];"
-"if(t==='simple')p.periods=[{start:'00:00',end:'00:00',interval:60}];"
-"else if(t==='daynight')p.periods=[{start:'06:00',end:'22:00',interval:30},{start:'22:00',end:'06:00',interval:120}];"
-"renderPlanContent();"
-"}"
-"function syncHidden(){document.getElementById('schedJson').value=JSON.stringify(schedData);}"
-"function toggleSchedEnable(){var en=document.getElementById('schedEnable').checked;document.getElementById('schedSection').style.display=en?'block':'none';}"
-"</script>";
-
-// HTML page header
-static const char* html_header =
-"<!DOCTYPE html><html><head>"
-"<meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<title>ESP32-S3 Configuration</title>"
-"%s%s</head><body><div class='container'>"
-"<h1>ESP32-S3 Display</h1>";
-
-// Display tab content
-static const char* html_display_tab =
-"%s"  // AP mode notice if applicable
-"<div class='info'>"
-"<p><strong>SSID:</strong> %s | <strong>Hostname:</strong> %s</p>"
-"<p><strong>Image:</strong> <a href='%s' target='_blank'>%s</a></p>"
-"<p><strong>Refresh:</strong> %lu min | <strong>Size:</strong> %dx%d | <strong>Scale:</strong> %s</p>"
-"</div>"
-"<form action='/save' method='POST'>"
-"<input type='hidden' name='tab' value='display'>"
-"<label>Image URL:</label>"
-"<textarea name='url' maxlength='2047' required style='width:100%%;resize:vertical;min-height:80px;box-sizing:border-box;font-family:inherit;font-size:inherit;'>%s</textarea>"
-"<p style='font-size:0.85em;color:#666;margin-top:2px;'>Maximum 2048 characters. Supports long URLs including signed cloud storage URLs.</p>"
-"<label>SSL Certificate Verification:</label>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='ssl_skip' value='1' %s>"
-"<span>Skip SSL verification (allow self-signed certificates)</span>"
-"</div>"
-"<label>Refresh Interval (minutes):</label>"
-"<input type='number' name='refresh' value='%lu' min='1' max='1440' required>"
-"<p style='font-size:0.85em;color:#666;margin-top:2px;'>Used as fallback when schedule is disabled or no period matches.</p>"
-"<label>Image Dimensions:</label>"
-"<div class='row'>"
-"<input type='number' name='img_width' value='%d' min='100' max='2000' placeholder='Width'>"
-"<input type='number' name='img_height' value='%d' min='100' max='2000' placeholder='Height'>"
-"</div>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='img_scale' value='1' %s>"
-"<label>Scale to fit display (800x480)</label>"
-"</div>"
-"<label>Rotation:</label>"
-"<select name='img_rotation'>"
-"<option value='0' %s>0&deg;</option>"
-"<option value='90' %s>90&deg;</option>"
-"<option value='180' %s>180&deg;</option>"
-"<option value='270' %s>270&deg;</option>"
-"</select>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='img_mirror_h' value='1' %s><label>Mirror H</label>"
-"<input type='checkbox' name='img_mirror_v' value='1' %s style='margin-left:20px;'><label>Mirror V</label>"
-"</div>"
-"<label>Transform Order:</label>"
-"<select name='img_rot_first'>"
-"<option value='1' %s>Rotate then Mirror</option>"
-"<option value='0' %s>Mirror then Rotate</option>"
-"</select>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='led_disabled' value='1' %s>"
-"<label>Disable Status LED</label>"
-"</div>"
-"<p style='font-size:0.85em;color:#666;margin-top:2px;'>Disable the status LED entirely!</p>"
-"<div style='display:flex;gap:10px;margin-top:15px;'>"
-"<input type='submit' value='Save' style='flex:1;'>"
-"<input type='submit' formaction='/apply' value='Apply' style='flex:1;background:#2196F3;'>"
-"</div>"
-"</form>"
-"<div class='section'>"
-"<h3>Display Actions</h3>"
-"<div class='test-buttons'>"
-"<a href='/action/test' class='btn btn-test btn-blue'>Test</a>"
-"<a href='/action/show' class='btn btn-test btn-orange'>Show</a>"
-"<a href='/action/clear' class='btn btn-test btn-red'>Clear</a>"
-"</div>"
-"</div>";
-
-// Network tab content
-static const char* html_network_tab =
-"<form action='/save_network' method='POST'>"
-"<div class='subsection'>"
-"<h3>WiFi Settings</h3>"
-"<label>SSID:</label>"
-"<input type='text' name='ssid' value='%s' maxlength='31' required>"
-"<label>Password:</label>"
-"<input type='password' name='password' value='%s' maxlength='63'>"
-"<label>Hostname:</label>"
-"<input type='text' name='hostname' value='%s' maxlength='31'>"
-"<label>Domain:</label>"
-"<input type='text' name='domain' value='%s' maxlength='63' placeholder='local'>"
-"</div>"
-"<div class='subsection'>"
-"<h3>IP Configuration</h3>"
-"<div class='radio-row'>"
-"<input type='radio' name='use_dhcp' id='dhcp_on' value='1' %s onchange='toggleDhcp()'>"
-"<label for='dhcp_on'>DHCP (Automatic)</label>"
-"</div>"
-"<div class='radio-row'>"
-"<input type='radio' name='use_dhcp' id='dhcp_off' value='0' %s onchange='toggleDhcp()'>"
-"<label for='dhcp_off'>Static IP</label>"
-"</div>"
-"<label>IP Address:</label>"
-"<input type='text' name='static_ip' value='%s' class='static-ip' %s placeholder='192.168.1.100'>"
-"<label>Subnet Mask:</label>"
-"<input type='text' name='static_mask' value='%s' class='static-ip' %s placeholder='255.255.255.0'>"
-"<label>Gateway:</label>"
-"<input type='text' name='static_gw' value='%s' class='static-ip' %s placeholder='192.168.1.1'>"
-"<label>Primary DNS:</label>"
-"<input type='text' name='dns_primary' value='%s' class='static-ip' %s placeholder='8.8.8.8'>"
-"<label>Secondary DNS:</label>"
-"<input type='text' name='dns_secondary' value='%s' class='static-ip' %s placeholder='8.8.4.4'>"
-"</div>"
-"<div class='subsection'>"
-"<h3>Time Settings</h3>"
-"<div id='timeDisplay' class='time-display'>"
-"<div class='current-time' id='currentTime'>--:--:--</div>"
-"<div class='time-info'>Timezone: <span id='tzDisplay'>--</span></div>"
-"<div class='time-info'>Status: <span id='syncStatus' class='sync-status not-synced'>Checking...</span></div>"
-"<button type='button' class='sync-btn' id='syncBtn' onclick='syncNtp()'>Sync Now</button>"
-"</div>"
-"<label>NTP Server:</label>"
-"<input type='text' name='ntp_server' value='%s' maxlength='63'>"
-"<label>Timezone:</label>"
-"<input type='text' name='timezone' value='%s' maxlength='63' placeholder='Europe/Berlin'>"
-"<p class='tz-help'>Enter a TZ database identifier (e.g., America/New_York, Asia/Tokyo, UTC). "
-"<a href='https://en.wikipedia.org/wiki/List_of_tz_database_time_zones' target='_blank'>View full list</a></p>"
-"</div>"
-"<div class='subsection'>"
-"<h3>Remote Syslog</h3>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='syslog_en' value='1' %s>"
-"<label>Enable Remote Syslog</label>"
-"</div>"
-"<label>Syslog Server:</label>"
-"<input type='text' name='syslog_host' value='%s' maxlength='63' placeholder='192.168.1.100'>"
-"<label>Syslog Port:</label>"
-"<input type='number' name='syslog_port' value='%u' min='1' max='65535'>"
-"<label>Format:</label>"
-"<select name='syslog_fmt'>"
-"<option value='0' %s>RFC 3164 (BSD)</option>"
-"<option value='1' %s>RFC 5424 (Structured)</option>"
-"</select>"
-"<label>Transport:</label>"
-"<select name='syslog_tp'>"
-"<option value='0' %s>UDP</option>"
-"<option value='1' %s>TCP</option>"
-"</select>"
-"</div>"
-"<input type='submit' value='Save Network Settings'>"
-"</form>";
-
-// Firmware tab content (OTA update)
-static const char* html_firmware_tab =
-"<h2>Firmware Update</h2>"
-"<div class='version-info'>"
-"<p><strong>Running Partition:</strong> %s</p>"
-"<p><strong>Build Date:</strong> " __DATE__ " " __TIME__ "</p>"
-"</div>"
-"<div class='subsection'>"
-"<h3>Upload New Firmware</h3>"
-"<p>Select a compiled firmware binary (.bin) file to upload.</p>"
-"<div class='file-input'>"
-"<input type='file' id='firmware-file' accept='.bin'>"
-"</div>"
-"<div class='progress-container' style='display:none;'>"
-"<div class='progress-bar' id='ota-progress'><span id='ota-progress-text'>0%%</span></div>"
-"</div>"
-"<div id='ota-status' class='ota-status'></div>"
-"<button type='button' class='btn btn-blue' id='upload-btn' onclick='uploadFirmware()'>Upload &amp; Install</button>"
-"</div>"
-"<div class='subsection'>"
-"<h3>Instructions</h3>"
-"<p>1. Build your firmware using PlatformIO</p>"
-"<p>2. Find the .bin file in .pio/build/freenove_esp32_s3_wroom/</p>"
-"<p>3. Select the firmware.bin file above</p>"
-"<p>4. Click 'Upload &amp; Install' to update</p>"
-"<p>5. Device will reboot automatically after successful update</p>"
-"<p><strong>Note:</strong> If the new firmware fails to start, the device will automatically roll back to the previous version.</p>"
-"</div>";
-
-// Schedule tab content
-static const char* html_schedule_tab =
-"<h2>Schedule Plans</h2>"
-"<form action='/save' method='POST'>"
-"<input type='hidden' name='tab' value='schedule'>"
-"<input type='hidden' name='sched_json' id='schedJson' value=''>"
-"<div class='sched-enable'>"
-"<input type='checkbox' id='schedEnable' name='sched_enable' %s onchange='toggleSchedEnable()'>"
-"<label for='schedEnable' style='margin:0;font-weight:normal;'>Enable schedule-based refresh intervals</label>"
-"</div>"
-"<div id='schedSection' style='display:%s;'>"
-"<div class='subsection'>"
-"<h3>Day Assignments</h3>"
-"<p style='font-size:12px;color:#666;'>Assign a plan to each day of the week</p>"
-"<div id='dayGrid' class='day-grid'></div>"
-"</div>"
-"<div class='subsection'>"
-"<h3>Plans</h3>"
-"<div id='planTabs' class='plan-tabs'></div>"
-"<div id='planContent' class='plan-content active'></div>"
-"</div>"
-"</div>"
-"<input type='submit' value='Save Schedule'>"
-"</form>"
-"<script>initSched();</script>";
-
-// HTML page footer
-static const char* html_footer =
-"<div class='help'>"
-"<p><strong>Save:</strong> Saves config only</p>"
-"<p><strong>Apply:</strong> Saves, shows image, starts sleep cycle</p>"
-"</div>"
-"<div style='text-align:center;margin-top:20px;padding:10px;border-top:1px solid #ddd;font-size:0.85em;color:#666;'>"
-"<a href='https://github.com/bolausson/esp32-ePaper-Display' target='_blank' style='color:#2196F3;text-decoration:none;'>GitHub: bolausson/esp32-ePaper-Display</a>"
-"</div>"
-"</div></body></html>";
+// Config page (web/index.html), gzipped and embedded by src/CMakeLists.txt
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[]   asm("_binary_index_html_gz_end");
+
+// Web UI cost of the last page and config requests, reported in /api/status
+static uint32_t web_page_bytes = 0;
+static uint32_t web_page_us = 0;
+static uint32_t web_page_not_modified = 0;  // Requests answered with 304
+static uint32_t web_config_bytes = 0;
+static uint32_t web_config_us = 0;
 
 // Captive portal redirect handler - returns 302 redirect to config page
 static esp_err_t captive_portal_redirect_handler(httpd_req_t *req) {
@@ -1548,190 +1413,592 @@ static esp_err_t wildcard_captive_handler(httpd_req_t *req) {
     return captive_portal_redirect_handler(req);
 }
 
-// Root GET handler
+// Root GET handler - the config page is static (web/index.html, gzipped at
+// build time) and fills itself in from /api/config
 static esp_err_t root_get_handler(httpd_req_t *req) {
     // Update last client activity timestamp
     last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
-    ESP_LOGI(TAG, "Client connected - serving config page");
+    int64_t start_us = esp_timer_get_time();
+    size_t gz_len = index_html_gz_end - index_html_gz_start;
+
+    // The ETag is the page's CRC, so a firmware update invalidates cached copies
+    static char etag[16];
+    if (etag[0] == '\0') {
+        snprintf(etag, sizeof(etag), "\"%08lx\"",
+                 (unsigned long)esp_rom_crc32_le(0, index_html_gz_start, gz_len));
+    }
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                    sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, etag) != NULL) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        web_page_not_modified++;
+        ESP_LOGI(TAG, "Client connected - config page not modified");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_send(req, (const char *)index_html_gz_start, gz_len);
+    web_page_bytes = gz_len;
+    web_page_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Client connected - config page sent (%u bytes gzipped, %lu us)",
+             (unsigned)gz_len, (unsigned long)web_page_us);
+    return ESP_OK;
+}
 
-    // Use static buffer to avoid stack overflow in httpd task
-    static char response[32768];  // Increased for schedule + syslog
-    char *p = response;
-    int remaining = sizeof(response);
-    int len;
+// API handler for the config page's current values (GET /api/config)
+// Keys are the form field names; radio and select values are sent as the
+// option values
+static esp_err_t api_config_get_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+    int64_t start_us = esp_timer_get_time();
 
-    // Use safe pointers for potentially empty strings
-    const char *display_url = (stored_image_url[0] != '\0') ? stored_image_url : "(not configured)";
-    const char *form_url = (stored_image_url[0] != '\0') ? stored_image_url : "";
-    const char *disabled_str = stored_use_dhcp ? "disabled" : "";
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
 
-    // AP mode notice
-    const char *ap_notice = ap_mode ?
-        "<div class='ap-notice'><strong>AP Mode:</strong> Connect to your WiFi network in the Network tab.</div>" : "";
+    // Display tab
+    cJSON_AddStringToObject(root, "url", stored_image_url);
+    cJSON_AddBoolToObject(root, "ssl_skip", stored_ssl_skip);
+    cJSON_AddBoolToObject(root, "playlist", stored_playlist);
+    cJSON_AddNumberToObject(root, "playlist_check", stored_playlist_check);
+    cJSON_AddNumberToObject(root, "refresh", stored_refresh_interval);
+    cJSON_AddBoolToObject(root, "refresh_align", stored_refresh_align);
+    cJSON_AddNumberToObject(root, "img_width", stored_img_width);
+    cJSON_AddNumberToObject(root, "img_height", stored_img_height);
+    cJSON_AddBoolToObject(root, "img_scale", stored_img_scale);
+    cJSON_AddNumberToObject(root, "img_rotation", stored_img_rotation);
+    cJSON_AddBoolToObject(root, "img_mirror_h", stored_img_mirror_h);
+    cJSON_AddBoolToObject(root, "img_mirror_v", stored_img_mirror_v);
+    cJSON_AddNumberToObject(root, "img_rot_first", stored_img_rot_first ? 1 : 0);
+    cJSON_AddBoolToObject(root, "led_disabled", stored_led_disabled);
+    cJSON_AddStringToObject(root, "panel_layout", stored_panel_layout);
+    cJSON_AddStringToObject(root, "tiles", stored_tile_layout);
+    cJSON_AddBoolToObject(root, "widgets", stored_widgets);
+
+    // The widget template is read from NVS only for this request
+    static char widget_tmpl[MAX_WIDGET_TEMPLATE_LEN];
+    if (!load_widget_template(widget_tmpl, sizeof(widget_tmpl))) {
+        widget_tmpl[0] = '\0';
+    }
+    cJSON_AddStringToObject(root, "widget_tmpl", widget_tmpl);
 
-    // Get current partition info for firmware tab
+    // Schedule tab
+    cJSON_AddBoolToObject(root, "sched_enable", stored_schedule_enabled);
+    cJSON *sched = cJSON_Parse(stored_schedule_json[0] ? stored_schedule_json : default_schedule_json);
+    if (!sched) {
+        sched = cJSON_Parse(default_schedule_json);
+    }
+    cJSON_AddItemToObject(root, "schedule", sched);
+    cJSON_AddBoolToObject(root, "cache_hints", stored_cache_hints);
+    cJSON_AddNumberToObject(root, "cache_min", stored_cache_min);
+    cJSON_AddNumberToObject(root, "cache_max", stored_cache_max);
+
+    // Network tab
+    cJSON_AddStringToObject(root, "ssid", stored_ssid);
+    cJSON_AddStringToObject(root, "password", stored_password);
+    cJSON_AddStringToObject(root, "hostname", stored_hostname);
+    cJSON_AddStringToObject(root, "domain", stored_domain);
+    cJSON_AddNumberToObject(root, "use_dhcp", stored_use_dhcp ? 1 : 0);
+    cJSON_AddStringToObject(root, "static_ip", stored_static_ip);
+    cJSON_AddStringToObject(root, "static_mask", stored_static_mask);
+    cJSON_AddStringToObject(root, "static_gw", stored_static_gw);
+    cJSON_AddStringToObject(root, "dns_primary", stored_dns_primary);
+    cJSON_AddStringToObject(root, "dns_secondary", stored_dns_secondary);
+    cJSON_AddStringToObject(root, "ntp_server", stored_ntp_server);
+    cJSON_AddNumberToObject(root, "ntp_max_err", stored_ntp_max_err);
+    cJSON_AddStringToObject(root, "timezone", stored_timezone);
+    cJSON_AddBoolToObject(root, "syslog_en", stored_syslog_enabled);
+    cJSON_AddStringToObject(root, "syslog_host", stored_syslog_host);
+    cJSON_AddNumberToObject(root, "syslog_port", stored_syslog_port);
+    cJSON_AddNumberToObject(root, "syslog_fmt", stored_syslog_format);
+    cJSON_AddNumberToObject(root, "syslog_tp", stored_syslog_transport);
+
+    // Read-only device info
     const esp_partition_t *running_partition = esp_ota_get_running_partition();
-    const char *partition_label = running_partition ? running_partition->label : "unknown";
-
-    // Build header with styles and script
-    len = snprintf(p, remaining, html_header, html_styles, html_script);
-    p += len; remaining -= len;
-
-    // Add tabs
-    len = snprintf(p, remaining,
-        "<div class='tabs'>"
-        "<button class='tab active' onclick=\"showTab('display')\">Display</button>"
-        "<button class='tab' onclick=\"showTab('schedule')\">Schedule</button>"
-        "<button class='tab' onclick=\"showTab('network')\">Network</button>"
-        "<button class='tab' onclick=\"showTab('firmware')\">Firmware</button>"
-        "</div>");
-    p += len; remaining -= len;
-
-    // Display tab content
-    len = snprintf(p, remaining, "<div id='display' class='tab-content active'>");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, html_display_tab,
-             ap_notice,
-             stored_ssid, stored_hostname,
-             display_url, display_url,
-             (unsigned long)stored_refresh_interval,
-             stored_img_width, stored_img_height,
-             stored_img_scale ? "yes" : "no",
-             form_url,
-             stored_ssl_skip ? "checked" : "",
-             (unsigned long)stored_refresh_interval,
-             stored_img_width, stored_img_height,
-             stored_img_scale ? "checked" : "",
-             (stored_img_rotation == 0) ? "selected" : "",
-             (stored_img_rotation == 90) ? "selected" : "",
-             (stored_img_rotation == 180) ? "selected" : "",
-             (stored_img_rotation == 270) ? "selected" : "",
-             stored_img_mirror_h ? "checked" : "",
-             stored_img_mirror_v ? "checked" : "",
-             stored_img_rot_first ? "selected" : "",
-             stored_img_rot_first ? "" : "selected",
-             stored_led_disabled ? "checked" : "");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, "</div>");
-    p += len; remaining -= len;
-
-    // Schedule tab content - inject schedule script with JSON data
-    static char schedule_script_buf[8192];  // Static to avoid stack overflow
-    const char* sched_json = stored_schedule_json[0] ? stored_schedule_json : default_schedule_json;
-    snprintf(schedule_script_buf, sizeof(schedule_script_buf), html_schedule_script, sched_json);
-
-    len = snprintf(p, remaining, "%s<div id='schedule' class='tab-content'>", schedule_script_buf);
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, html_schedule_tab,
-             stored_schedule_enabled ? "checked" : "",
-             stored_schedule_enabled ? "block" : "none");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, "</div>");
-    p += len; remaining -= len;
-
-    // Network tab content
-    len = snprintf(p, remaining, "<div id='network' class='tab-content'>");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, html_network_tab,
-             stored_ssid, stored_password,
-             stored_hostname, stored_domain,
-             stored_use_dhcp ? "checked" : "",
-             stored_use_dhcp ? "" : "checked",
-             stored_static_ip, disabled_str,
-             stored_static_mask, disabled_str,
-             stored_static_gw, disabled_str,
-             stored_dns_primary, disabled_str,
-             stored_dns_secondary, disabled_str,
-             stored_ntp_server,
-             stored_timezone,
-             stored_syslog_enabled ? "checked" : "",
-             stored_syslog_host,
-             (unsigned)stored_syslog_port,
-             stored_syslog_format == 0 ? "selected" : "",
-             stored_syslog_format == 1 ? "selected" : "",
-             stored_syslog_transport == 0 ? "selected" : "",
-             stored_syslog_transport == 1 ? "selected" : "");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, "</div>");
-    p += len; remaining -= len;
-
-    // Firmware tab content
-    len = snprintf(p, remaining, "<div id='firmware' class='tab-content'>");
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, html_firmware_tab, partition_label);
-    p += len; remaining -= len;
-
-    len = snprintf(p, remaining, "</div>");
-    p += len; remaining -= len;
-
-    // Footer
-    len = snprintf(p, remaining, "%s", html_footer);
-    p += len; remaining -= len;
-
-    ESP_LOGI(TAG, "Response length: %d bytes", (int)(p - response));
+    cJSON_AddBoolToObject(root, "ap_mode", ap_mode);
+    cJSON_AddStringToObject(root, "panel", EPD_PANEL_SIZE_STR);
+    cJSON_AddStringToObject(root, "partition", running_partition ? running_partition->label : "unknown");
+    cJSON_AddStringToObject(root, "build", __DATE__ " " __TIME__);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
 
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    web_config_bytes = strlen(json);
+    cJSON_free(json);
+    web_config_us = (uint32_t)(esp_timer_get_time() - start_us);
     return ESP_OK;
 }
 
-// Helper function to URL decode
-static void url_decode(char *dst, const char *src) {
-    char a, b;
-    while (*src) {
-        if ((*src == '%') &&
-            ((a = src[1]) && (b = src[2])) &&
-            (isxdigit(a) && isxdigit(b))) {
-            if (a >= 'a') a -= 'a'-'A';
-            if (a >= 'A') a -= ('A' - 10);
-            else a -= '0';
-            if (b >= 'a') b -= 'a'-'A';
-            if (b >= 'A') b -= ('A' - 10);
-            else b -= '0';
-            *dst++ = 16*a+b;
-            src+=3;
-        } else if (*src == '+') {
-            *dst++ = ' ';
-            src++;
+// Settings accepted by PUT /api/config, named like the form fields and the
+// keys of GET /api/config. Numbers outside the range are rejected rather
+// than clamped, so a provisioning tool learns about its mistakes.
+typedef enum {
+    CFG_STR,
+    CFG_BOOL,   // true/false, or 1/0 as sent for radio buttons and selects
+    CFG_UINT,
+} config_field_type_t;
+
+typedef struct {
+    const char *key;
+    config_field_type_t type;
+    uint16_t offset;        // Member of app_config_t
+    uint16_t size;
+    uint32_t min, max;      // CFG_UINT range
+} config_field_t;
+
+#define CFG_FIELD(key, type, member, min, max) \
+    { key, type, offsetof(app_config_t, member), sizeof(((app_config_t *)0)->member), min, max }
+
+static const config_field_t config_fields[] = {
+    CFG_FIELD("url",            CFG_STR,  stored_image_url,        0, 0),
+    CFG_FIELD("refresh",        CFG_UINT, stored_refresh_interval, 1, 1440),
+    CFG_FIELD("ssl_skip",       CFG_BOOL, stored_ssl_skip,         0, 0),
+    CFG_FIELD("playlist",       CFG_BOOL, stored_playlist,         0, 0),
+    CFG_FIELD("playlist_check", CFG_UINT, stored_playlist_check,   1, 1440),
+    CFG_FIELD("refresh_align",  CFG_BOOL, stored_refresh_align,    0, 0),
+    CFG_FIELD("img_width",      CFG_UINT, stored_img_width,        100, 2000),
+    CFG_FIELD("img_height",     CFG_UINT, stored_img_height,       100, 2000),
+    CFG_FIELD("img_scale",      CFG_BOOL, stored_img_scale,        0, 0),
+    CFG_FIELD("img_rotation",   CFG_UINT, stored_img_rotation,     0, 270),
+    CFG_FIELD("img_mirror_h",   CFG_BOOL, stored_img_mirror_h,     0, 0),
+    CFG_FIELD("img_mirror_v",   CFG_BOOL, stored_img_mirror_v,     0, 0),
+    CFG_FIELD("img_rot_first",  CFG_BOOL, stored_img_rot_first,    0, 0),
+    CFG_FIELD("led_disabled",   CFG_BOOL, stored_led_disabled,     0, 0),
+    CFG_FIELD("panel_layout",   CFG_STR,  stored_panel_layout,     0, 0),
+    CFG_FIELD("tiles",          CFG_STR,  stored_tile_layout,      0, 0),
+    CFG_FIELD("widgets",        CFG_BOOL, stored_widgets,          0, 0),
+    CFG_FIELD("sched_enable",   CFG_BOOL, stored_schedule_enabled, 0, 0),
+    CFG_FIELD("cache_hints",    CFG_BOOL, stored_cache_hints,      0, 0),
+    CFG_FIELD("cache_min",      CFG_UINT, stored_cache_min,        1, 1440),
+    CFG_FIELD("cache_max",      CFG_UINT, stored_cache_max,        1, 1440),
+    CFG_FIELD("ssid",           CFG_STR,  stored_ssid,             0, 0),
+    CFG_FIELD("password",       CFG_STR,  stored_password,         0, 0),
+    CFG_FIELD("hostname",       CFG_STR,  stored_hostname,         0, 0),
+    CFG_FIELD("domain",         CFG_STR,  stored_domain,           0, 0),
+    CFG_FIELD("use_dhcp",       CFG_BOOL, stored_use_dhcp,         0, 0),
+    CFG_FIELD("static_ip",      CFG_STR,  stored_static_ip,        0, 0),
+    CFG_FIELD("static_mask",    CFG_STR,  stored_static_mask,      0, 0),
+    CFG_FIELD("static_gw",      CFG_STR,  stored_static_gw,        0, 0),
+    CFG_FIELD("dns_primary",    CFG_STR,  stored_dns_primary,      0, 0),
+    CFG_FIELD("dns_secondary",  CFG_STR,  stored_dns_secondary,    0, 0),
+    CFG_FIELD("ntp_server",     CFG_STR,  stored_ntp_server,       0, 0),
+    CFG_FIELD("ntp_max_err",    CFG_UINT, stored_ntp_max_err,      0, 3600),
+    CFG_FIELD("timezone",       CFG_STR,  stored_timezone,         0, 0),
+    CFG_FIELD("syslog_en",      CFG_BOOL, stored_syslog_enabled,   0, 0),
+    CFG_FIELD("syslog_host",    CFG_STR,  stored_syslog_host,      0, 0),
+    CFG_FIELD("syslog_port",    CFG_UINT, stored_syslog_port,      1, 65535),
+    CFG_FIELD("syslog_fmt",     CFG_UINT, stored_syslog_format,    0, 1),
+    CFG_FIELD("syslog_tp",      CFG_UINT, stored_syslog_transport, 0, 1),
+};
+
+#undef CFG_FIELD
+
+// Keys of GET /api/config that describe the device; ignored on PUT so a
+// GET response can be edited and sent back
+static const char *const config_readonly_keys[] = { "ap_mode", "panel", "partition", "build" };
+
+// State of one PUT /api/config request
+typedef struct {
+    app_config_t *cfg;              // Staged settings, current ones plus the update
+    const config_field_t *field;    // Field whose value comes next
+    enum { PUT_FIELD, PUT_SCHEDULE, PUT_WIDGET_TMPL, PUT_IGNORE } next;
+    char *schedule;                 // Schedule JSON, if given
+    char *widget_tmpl;              // Widget template, if given
+    bool have_schedule;
+    bool have_widget_tmpl;
+    uint32_t updated;               // Keys applied
+    char err[96];
+} config_put_t;
+
+// Set a staged field from a JSON value
+static bool config_put_field(json_stream_t *js, config_put_t *put, json_stream_event_t ev,
+                             const char *str, size_t len) {
+    const config_field_t *f = put->field;
+    uint8_t *dst = (uint8_t *)put->cfg + f->offset;
+
+    if (f->type == CFG_STR) {
+        if (ev != JSON_STREAM_STRING) {
+            snprintf(put->err, sizeof(put->err), "%s: expected a string", f->key);
+            return json_stream_fail(js, put->err);
+        }
+        if (len >= f->size) {
+            snprintf(put->err, sizeof(put->err), "%s: longer than %u characters",
+                     f->key, (unsigned)(f->size - 1));
+            return json_stream_fail(js, put->err);
+        }
+        memset(dst, 0, f->size);
+        memcpy(dst, str, len);
+        return true;
+    }
+
+    if (f->type == CFG_BOOL) {
+        bool v;
+        if (ev == JSON_STREAM_BOOL) {
+            v = (str[0] == 't');
+        } else if (ev == JSON_STREAM_NUMBER && (strcmp(str, "0") == 0 || strcmp(str, "1") == 0)) {
+            v = (str[0] == '1');
         } else {
-            *dst++ = *src++;
+            snprintf(put->err, sizeof(put->err), "%s: expected true or false", f->key);
+            return json_stream_fail(js, put->err);
         }
+        memcpy(dst, &v, sizeof(v));
+        return true;
     }
-    *dst++ = '\0';
+
+    // CFG_UINT: plain digits only (no sign, fraction or exponent)
+    char *end = NULL;
+    unsigned long v = 0;
+    if (ev == JSON_STREAM_NUMBER && str[0] >= '0' && str[0] <= '9' && len <= 10) {
+        v = strtoul(str, &end, 10);
+    }
+    if (end == NULL || *end != '\0' || v < f->min || v > f->max) {
+        snprintf(put->err, sizeof(put->err), "%s: expected an integer %lu-%lu",
+                 f->key, (unsigned long)f->min, (unsigned long)f->max);
+        return json_stream_fail(js, put->err);
+    }
+    if (f->size == sizeof(uint8_t)) {
+        uint8_t u = (uint8_t)v;
+        memcpy(dst, &u, sizeof(u));
+    } else if (f->size == sizeof(uint16_t)) {
+        uint16_t u = (uint16_t)v;
+        memcpy(dst, &u, sizeof(u));
+    } else {
+        uint32_t u = (uint32_t)v;
+        memcpy(dst, &u, sizeof(u));
+    }
+    return true;
 }
 
-// Parse POST data
-static void parse_post_data(char *buf, char *ssid, char *password, char *url,
-                             uint32_t *refresh, uint16_t *img_width, uint16_t *img_height,
-                             bool *img_scale, uint16_t *img_rotation, bool *img_mirror_h,
-                             bool *img_mirror_v, bool *img_rot_first, bool *led_disabled,
-                             bool *ssl_skip) {
-    char *token;
-    char *saveptr;
-    char temp_str[16] = {0};
-    *img_scale = false;      // Default to false, will be set true if checkbox is present
-    *img_mirror_h = false;   // Default to false
-    *img_mirror_v = false;   // Default to false
-    *img_rot_first = true;   // Default to rotate first
-    *led_disabled = false;   // Default to false
-    *ssl_skip = false;       // Default to false (verify SSL)
+// Token callback for PUT /api/config: one object of known keys
+static bool config_put_cb(json_stream_t *js, json_stream_event_t ev,
+                          const char *str, size_t len, void *ctx) {
+    config_put_t *put = ctx;
+    int depth = json_stream_depth(js);
 
-    token = strtok_r(buf, "&", &saveptr);
-    while (token != NULL) {
-        char *eq = strchr(token, '=');
-        if (eq) {
-            *eq = '\0';
-            char *key = token;
-            char *value = eq + 1;
+    if (depth == 0) {
+        if (ev == JSON_STREAM_OBJECT_START || ev == JSON_STREAM_OBJECT_END) {
+            return true;
+        }
+        return json_stream_fail(js, "expected an object");
+    }
 
-            if (strcmp(key, "ssid") == 0) {
+    // Members of nested values (only reached for ignored keys)
+    if (depth > 1) {
+        return true;
+    }
+
+    if (ev == JSON_STREAM_KEY) {
+        put->next = PUT_FIELD;
+        put->field = NULL;
+        if (strcmp(str, "schedule") == 0) {
+            put->next = PUT_SCHEDULE;
+            json_stream_capture(js, put->schedule, MAX_SCHEDULE_JSON);
+            return true;
+        }
+        if (strcmp(str, "widget_tmpl") == 0) {
+            put->next = PUT_WIDGET_TMPL;
+            return true;
+        }
+        for (size_t i = 0; i < sizeof(config_readonly_keys) / sizeof(config_readonly_keys[0]); i++) {
+            if (strcmp(str, config_readonly_keys[i]) == 0) {
+                put->next = PUT_IGNORE;
+                return true;
+            }
+        }
+        for (size_t i = 0; i < sizeof(config_fields) / sizeof(config_fields[0]); i++) {
+            if (strcmp(str, config_fields[i].key) == 0) {
+                put->field = &config_fields[i];
+                return true;
+            }
+        }
+        snprintf(put->err, sizeof(put->err), "unknown key \"%.48s\"", str);
+        return json_stream_fail(js, put->err);
+    }
+
+    if (ev == JSON_STREAM_OBJECT_END || ev == JSON_STREAM_ARRAY_END) {
+        return true;
+    }
+
+    switch (put->next) {
+    case PUT_IGNORE:
+        return true;
+    case PUT_SCHEDULE:
+        // A captured object, or the same JSON as a string
+        if (ev == JSON_STREAM_STRING && len < MAX_SCHEDULE_JSON) {
+            memcpy(put->schedule, str, len + 1);
+        } else if (ev != JSON_STREAM_RAW) {
+            return json_stream_fail(js, "schedule: expected an object");
+        }
+        put->have_schedule = true;
+        break;
+    case PUT_WIDGET_TMPL:
+        if (ev != JSON_STREAM_STRING || len >= MAX_WIDGET_TEMPLATE_LEN) {
+            return json_stream_fail(js, "widget_tmpl: expected a string up to 2047 characters");
+        }
+        memcpy(put->widget_tmpl, str, len + 1);
+        put->have_widget_tmpl = true;
+        break;
+    default:
+        if (!config_put_field(js, put, ev, str, len)) {
+            return false;
+        }
+        break;
+    }
+    put->updated++;
+    return true;
+}
+
+// Check a panel layout about to be saved. Layouts are only checked when they
+// change, so a stored layout that predates these checks does not block
+// unrelated updates.
+static bool panel_layout_rejected(const char *layout_str) {
+    static panel_layout_t layout;
+    return strcmp(layout_str, stored_panel_layout) != 0 &&
+           panel_layout_parse(layout_str, &layout) != ESP_OK;
+}
+
+// Check the staged settings as a whole; fills put->err on failure
+static bool config_put_validate(config_put_t *put, schedule_table_t *table) {
+    app_config_t *cfg = put->cfg;
+
+    if (cfg->stored_img_rotation % 90 != 0) {
+        snprintf(put->err, sizeof(put->err), "img_rotation: expected 0, 90, 180 or 270");
+        return false;
+    }
+    if (cfg->stored_cache_max < cfg->stored_cache_min) {
+        snprintf(put->err, sizeof(put->err), "cache_max: less than cache_min");
+        return false;
+    }
+
+    if (panel_layout_rejected(cfg->stored_panel_layout)) {
+        snprintf(put->err, sizeof(put->err), "panel_layout: invalid layout or pins");
+        return false;
+    }
+    if (cfg->stored_tile_layout[0] != '\0' &&
+        strcmp(cfg->stored_tile_layout, stored_tile_layout) != 0) {
+        static tile_layout_t tiles;
+        char err[64];
+        if (!tile_layout_parse(cfg->stored_tile_layout, IMAGE_WIDTH, IMAGE_HEIGHT, &tiles,
+                               err, sizeof(err))) {
+            snprintf(put->err, sizeof(put->err), "tiles: %s", err);
+            return false;
+        }
+    }
+
+    if (put->have_schedule) {
+        char err[80];
+        if (!schedule_compile(put->schedule, table, err, sizeof(err))) {
+            snprintf(put->err, sizeof(put->err), "schedule: %s", err);
+            return false;
+        }
+    }
+
+    if (put->have_widget_tmpl && (cfg->stored_widgets || put->widget_tmpl[0] != '\0')) {
+        char err[80];
+        if (!widgets_check(put->widget_tmpl, err, sizeof(err))) {
+            snprintf(put->err, sizeof(put->err), "widget_tmpl: %s", err);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reply to PUT /api/config with an error
+static esp_err_t config_put_error(httpd_req_t *req, const char *status, const char *msg, size_t offset) {
+    char resp[160] = "{}";  // Sent as is if the object cannot be built
+    cJSON *root = cJSON_CreateObject();
+    if (root) {
+        cJSON_AddStringToObject(root, "error", msg);
+        cJSON_AddNumberToObject(root, "offset", offset);
+        if (!cJSON_PrintPreallocated(root, resp, sizeof(resp), false)) {
+            strcpy(resp, "{}");
+        }
+        cJSON_Delete(root);
+    }
+    ESP_LOGW(TAG, "Config update rejected: %s", msg);
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL;
+}
+
+// API handler for updating settings (PUT /api/config)
+//
+// The body is a JSON object with any subset of the GET /api/config keys. It
+// is tokenized as it arrives, straight from the socket in small chunks, into
+// a staged copy of the settings; only if every key is valid and the result
+// passes the cross-field checks is the copy stored, in one write. The widget
+// template has its own NVS key and is written after the blob; if that fails,
+// the previous blob is written back. The running settings change only once
+// both are stored.
+static esp_err_t api_config_put_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+    int64_t start_us = esp_timer_get_time();
+
+    if (req->content_len == 0 || req->content_len > CONFIG_PUT_MAX_BODY) {
+        return config_put_error(req, "400 Bad Request", "body missing or too large", 0);
+    }
+
+    // Static: too large for the httpd task stack, and requests are serialized
+    static app_config_t staged;
+    static char tok[MAX_URL_LEN];
+    static char schedule[MAX_SCHEDULE_JSON];
+    static char widget_tmpl[MAX_WIDGET_TEMPLATE_LEN];
+    static schedule_table_t table;
+    static config_put_t put;
+
+    pack_config(&staged);
+    memset(&put, 0, sizeof(put));
+    put.cfg = &staged;
+    put.schedule = schedule;
+    put.widget_tmpl = widget_tmpl;
+
+    json_stream_t js;
+    json_stream_init(&js, tok, sizeof(tok), config_put_cb, &put);
+
+    char chunk[512];
+    int remaining = req->content_len;
+    bool ok = true;
+    while (remaining > 0) {
+        int received = httpd_req_recv(req, chunk, MIN(remaining, (int)sizeof(chunk)));
+        if (received <= 0) {
+            if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            return ESP_FAIL;
+        }
+        remaining -= received;
+        // Keep reading after an error so the reply is not cut off by
+        // unread request data
+        if (ok) {
+            ok = json_stream_feed(&js, chunk, received);
+        }
+    }
+    if (ok) {
+        ok = json_stream_finish(&js);
+    }
+    if (!ok) {
+        return config_put_error(req, "400 Bad Request", json_stream_error(&js), json_stream_offset(&js));
+    }
+    if (!config_put_validate(&put, &table)) {
+        return config_put_error(req, "400 Bad Request", put.err, json_stream_offset(&js));
+    }
+
+    if (put.have_schedule) {
+        strncpy(staged.stored_schedule_json, schedule, MAX_SCHEDULE_JSON - 1);
+        staged.stored_schedule_json[MAX_SCHEDULE_JSON - 1] = '\0';
+        staged.stored_schedule_table = table;
+    }
+    bool syslog_changed =
+        strcmp(staged.stored_syslog_host, stored_syslog_host) != 0 ||
+        staged.stored_syslog_port != stored_syslog_port ||
+        staged.stored_syslog_enabled != stored_syslog_enabled ||
+        staged.stored_syslog_format != stored_syslog_format ||
+        staged.stored_syslog_transport != stored_syslog_transport;
+
+    if (config_store_save(&config_mirror.header, &staged, sizeof(staged), CONFIG_VERSION) != ESP_OK) {
+        return config_put_error(req, "500 Internal Server Error", "failed to store settings", 0);
+    }
+    if (put.have_widget_tmpl && save_widget_template(widget_tmpl) != ESP_OK) {
+        commit_config();    // Back to the blob of the unchanged globals
+        return config_put_error(req, "500 Internal Server Error", "failed to store widget_tmpl", 0);
+    }
+    unpack_config(&staged);
+
+    // Same follow-ups as the form handlers
+    if (syslog_changed) {
+        syslog_remote_deinit();
+        if (stored_syslog_enabled && stored_syslog_host[0] != '\0') {
+            syslog_remote_init(stored_syslog_host, stored_syslog_port, stored_hostname,
+                               (syslog_format_t)stored_syslog_format,
+                               (syslog_transport_t)stored_syslog_transport);
+        }
+    }
+    if (ap_mode && stored_ssid[0] != '\0') {
+        config_saved = true;
+    }
+
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    ESP_LOGI(TAG, "Config updated via API - %lu keys, %d bytes, %lu us",
+             (unsigned long)put.updated, req->content_len, (unsigned long)elapsed_us);
+
+    char resp[64];
+    snprintf(resp, sizeof(resp), "{\"updated\":%lu}", (unsigned long)put.updated);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Helper function to URL decode
+static void url_decode(char *dst, const char *src) {
+    char a, b;
+    while (*src) {
+        if ((*src == '%') &&
+            ((a = src[1]) && (b = src[2])) &&
+            (isxdigit(a) && isxdigit(b))) {
+            if (a >= 'a') a -= 'a'-'A';
+            if (a >= 'A') a -= ('A' - 10);
+            else a -= '0';
+            if (b >= 'a') b -= 'a'-'A';
+            if (b >= 'A') b -= ('A' - 10);
+            else b -= '0';
+            *dst++ = 16*a+b;
+            src+=3;
+        } else if (*src == '+') {
+            *dst++ = ' ';
+            src++;
+        } else {
+            *dst++ = *src++;
+        }
+    }
+    *dst++ = '\0';
+}
+
+// Parse POST data
+static void parse_post_data(char *buf, char *ssid, char *password, char *url,
+                             uint32_t *refresh, uint16_t *img_width, uint16_t *img_height,
+                             bool *img_scale, uint16_t *img_rotation, bool *img_mirror_h,
+                             bool *img_mirror_v, bool *img_rot_first, bool *led_disabled,
+                             bool *ssl_skip, bool *refresh_align, bool *playlist,
+                             uint32_t *playlist_check, char *panel_layout, char *tile_layout) {
+    char *token;
+    char *saveptr;
+    char temp_str[16] = {0};
+    *img_scale = false;      // Default to false, will be set true if checkbox is present
+    *img_mirror_h = false;   // Default to false
+    *img_mirror_v = false;   // Default to false
+    *img_rot_first = true;   // Default to rotate first
+    *led_disabled = false;   // Default to false
+    *ssl_skip = false;       // Default to false (verify SSL)
+    *refresh_align = false;  // Default to sleeping the plain interval
+    *playlist = false;       // Default to a plain image URL
+    panel_layout[0] = '\0';  // Default to single panel
+    tile_layout[0] = '\0';   // Default to one image
+
+    token = strtok_r(buf, "&", &saveptr);
+    while (token != NULL) {
+        char *eq = strchr(token, '=');
+        if (eq) {
+            *eq = '\0';
+            char *key = token;
+            char *value = eq + 1;
+
+            if (strcmp(key, "ssid") == 0) {
                 url_decode(ssid, value);
             } else if (strcmp(key, "password") == 0) {
                 url_decode(password, value);
@@ -1774,12 +2041,44 @@ static void parse_post_data(char *buf, char *ssid, char *password, char *url,
                 *led_disabled = true;  // Checkbox is present = checked
             } else if (strcmp(key, "ssl_skip") == 0) {
                 *ssl_skip = true;  // Checkbox is present = checked
+            } else if (strcmp(key, "refresh_align") == 0) {
+                *refresh_align = true;  // Checkbox is present = checked
+            } else if (strcmp(key, "playlist") == 0) {
+                *playlist = true;  // Checkbox is present = checked
+            } else if (strcmp(key, "playlist_check") == 0) {
+                url_decode(temp_str, value);
+                int m = atoi(temp_str);
+                if (m < 1) m = 1;
+                if (m > 1440) m = 1440;
+                *playlist_check = (uint32_t)m;
+            } else if (strcmp(key, "panel_layout") == 0) {
+                // Encoded form is never shorter than the decoded one
+                if (strlen(value) < MAX_PANEL_LAYOUT_LEN) {
+                    url_decode(panel_layout, value);
+                }
+            } else if (strcmp(key, "tiles") == 0) {
+                url_decode(value, value);  // In place, the decoded form is never longer
+                if (strlen(value) < MAX_TILE_LAYOUT_LEN) {
+                    strcpy(tile_layout, value);
+                }
             }
         }
         token = strtok_r(NULL, "&", &saveptr);
     }
 }
 
+// Minutes field (1-1440) of a form body, default if missing
+static uint32_t form_minutes(const char *buf, const char *key, uint32_t def) {
+    const char *p = strstr(buf, key);
+    if (p == NULL) {
+        return def;
+    }
+    int v = atoi(p + strlen(key));
+    if (v < 1) v = 1;
+    if (v > 1440) v = 1440;
+    return (uint32_t)v;
+}
+
 // Save POST handler
 static esp_err_t save_post_handler(httpd_req_t *req) {
     // Update last client activity timestamp
@@ -1831,6 +2130,12 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
     if (strcmp(tab_type, "schedule") == 0) {
         // Parse schedule-specific fields
         bool sched_enable = (strstr(buf, "sched_enable=on") != NULL);
+        bool cache_hints = (strstr(buf, "cache_hints=on") != NULL);
+        uint32_t cache_min = form_minutes(buf, "cache_min=", DEFAULT_CACHE_MIN_MIN);
+        uint32_t cache_max = form_minutes(buf, "cache_max=", DEFAULT_CACHE_MAX_MIN);
+        if (cache_max < cache_min) {
+            cache_max = cache_min;
+        }
 
         // Extract sched_json value (URL-encoded JSON)
         char *json_ptr = strstr(buf, "sched_json=");
@@ -1852,7 +2157,18 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
 
                 ESP_LOGI(TAG, "Schedule JSON length (decoded): %d", strlen(decoded_json));
 
-                save_schedule_config_to_nvs(decoded_json, sched_enable);
+                // Reject a schedule that does not compile instead of
+                // finding out at the next wake
+                static schedule_table_t table;
+                char err[96];
+                if (!schedule_compile(decoded_json, &table, err, sizeof(err))) {
+                    ESP_LOGW(TAG, "Schedule rejected: %s", err);
+                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+                    return ESP_FAIL;
+                }
+
+                save_schedule_config_to_nvs(decoded_json, &table, sched_enable,
+                                            cache_hints, cache_min, cache_max);
                 ESP_LOGI(TAG, "Schedule saved - Enabled: %s", sched_enable ? "yes" : "no");
             } else {
                 ESP_LOGE(TAG, "Schedule JSON too long: %d", json_len);
@@ -1860,12 +2176,42 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
         } else {
             ESP_LOGW(TAG, "No sched_json field found in request");
         }
+    } else if (strcmp(tab_type, "widgets") == 0) {
+        bool enabled = (strstr(buf, "widgets=on") != NULL);
+
+        // Extract and decode widget_tmpl in place (decoding only shrinks it)
+        static char tmpl[MAX_WIDGET_TEMPLATE_LEN];
+        tmpl[0] = '\0';
+        char *tmpl_ptr = strstr(buf, "widget_tmpl=");
+        if (tmpl_ptr) {
+            tmpl_ptr += 12;  // Skip "widget_tmpl="
+            char *tmpl_end = strchr(tmpl_ptr, '&');
+            if (tmpl_end) {
+                *tmpl_end = '\0';
+            }
+            url_decode(tmpl_ptr, tmpl_ptr);
+            if (strlen(tmpl_ptr) >= sizeof(tmpl)) {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Widget template too long");
+                return ESP_FAIL;
+            }
+            strcpy(tmpl, tmpl_ptr);
+        }
+
+        // Reject a template that does not parse instead of finding out at
+        // the next wake
+        char err[96];
+        if ((enabled || tmpl[0] != '\0') && !widgets_check(tmpl, err, sizeof(err))) {
+            ESP_LOGW(TAG, "Widget template rejected: %s", err);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err);
+            return ESP_FAIL;
+        }
+        save_widget_config_to_nvs(enabled, tmpl);
     } else {
         // Handle display tab save - only save display settings, NOT network settings
         char new_url[MAX_URL_LEN] = {0};
         uint32_t new_refresh = 60;
-        uint16_t new_img_width = 800;
-        uint16_t new_img_height = 480;
+        uint16_t new_img_width = IMAGE_WIDTH;
+        uint16_t new_img_height = IMAGE_HEIGHT;
         bool new_img_scale = false;
         uint16_t new_img_rotation = 0;
         bool new_img_mirror_h = false;
@@ -1873,6 +2219,11 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
         bool new_img_rot_first = true;
         bool new_led_disabled = false;
         bool new_ssl_skip = false;
+        bool new_refresh_align = false;
+        bool new_playlist = false;
+        uint32_t new_playlist_check = DEFAULT_PLAYLIST_CHECK_MIN;
+        char new_panel_layout[MAX_PANEL_LAYOUT_LEN] = {0};
+        char new_tile_layout[MAX_TILE_LAYOUT_LEN] = {0};
 
         // Make a copy since parse_post_data modifies the buffer
         char buf_copy[3072];
@@ -1886,7 +2237,13 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
         parse_post_data(buf_copy, dummy_ssid, dummy_password, new_url, &new_refresh,
                         &new_img_width, &new_img_height, &new_img_scale,
                         &new_img_rotation, &new_img_mirror_h, &new_img_mirror_v, &new_img_rot_first,
-                        &new_led_disabled, &new_ssl_skip);
+                        &new_led_disabled, &new_ssl_skip, &new_refresh_align, &new_playlist,
+                        &new_playlist_check, new_panel_layout, new_tile_layout);
+
+        if (panel_layout_rejected(new_panel_layout)) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid panel layout or pins");
+            return ESP_FAIL;
+        }
 
         ESP_LOGI(TAG, "Received display config - URL: %s, Refresh: %lu min, Rot: %d, MirH: %s, MirV: %s, LED disabled: %s, SSL skip: %s",
                  new_url, (unsigned long)new_refresh,
@@ -1897,7 +2254,8 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
         save_display_config_to_nvs(new_url, new_refresh, new_img_width, new_img_height,
                                     new_img_scale, new_img_rotation, new_img_mirror_h,
                                     new_img_mirror_v, new_img_rot_first, new_led_disabled,
-                                    new_ssl_skip);
+                                    new_ssl_skip, new_refresh_align, new_playlist,
+                                    new_playlist_check, new_panel_layout, new_tile_layout);
     }
 
     // Send success response with redirect back to main page
@@ -1917,13 +2275,148 @@ static esp_err_t save_post_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
-// OTA firmware update POST handler
+// Firmware upload in progress (see ota_post_handler())
+typedef struct {
+    httpd_req_t *req;               // Async copy of the request
+    const esp_partition_t *partition;
+    bool multipart;
+    multipart_t mp;
+    bool in_file;                   // Inside the firmware part
+    bool file_seen;
+    bool write_failed;
+} ota_upload_t;
+
+static volatile bool ota_upload_active = false;
+static volatile uint32_t ota_total = 0;     // Request body size
+static volatile uint32_t ota_received = 0;  // Body bytes received so far
+
+// Multipart callback: the first part with a file name is the firmware,
+// other form fields are skipped
+static bool ota_multipart_cb(multipart_event_t ev, const uint8_t *data, size_t len, void *ctx) {
+    ota_upload_t *up = (ota_upload_t *)ctx;
+    switch (ev) {
+    case MULTIPART_PART_BEGIN:
+        up->in_file = !up->file_seen && strstr((const char *)data, "filename=") != NULL;
+        up->file_seen |= up->in_file;
+        break;
+    case MULTIPART_DATA:
+        if (up->in_file && ota_writer_write(data, len) != ESP_OK) {
+            up->write_failed = true;
+            return false;
+        }
+        break;
+    case MULTIPART_PART_END:
+        up->in_file = false;
+        break;
+    }
+    return true;
+}
+
+// Receive task for POST /ota: receives the body while the OTA writer task
+// erases and writes flash, then answers and reboots into the new firmware
+static void ota_receive_task(void *arg) {
+    ota_upload_t *up = (ota_upload_t *)arg;
+    httpd_req_t *req = up->req;
+    const char *error = NULL;
+    httpd_err_code_t error_code = HTTPD_500_INTERNAL_SERVER_ERROR;
+
+    char *buf = malloc(OTA_RECV_CHUNK);
+    if (buf == NULL) {
+        error = "Memory allocation failed";
+    }
+
+    size_t remaining = req->content_len;
+    while (error == NULL && !up->write_failed && remaining > 0) {
+        int received = httpd_req_recv(req, buf, MIN(remaining, OTA_RECV_CHUNK));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;  // Retry on timeout
+        }
+        if (received <= 0) {
+            error = "Firmware upload failed";
+            break;
+        }
+        remaining -= received;
+        ota_received += received;
+        last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+
+        if (!up->multipart) {
+            up->write_failed = ota_writer_write(buf, received) != ESP_OK;
+        } else if (!multipart_feed(&up->mp, (const uint8_t *)buf, received) && !up->write_failed) {
+            error = multipart_error(&up->mp);
+            error_code = HTTPD_400_BAD_REQUEST;
+        }
+    }
+    free(buf);
+
+    if (error == NULL && up->multipart && !up->write_failed) {
+        if (!multipart_finish(&up->mp)) {
+            error = multipart_error(&up->mp);
+            error_code = HTTPD_400_BAD_REQUEST;
+        } else if (!up->file_seen) {
+            error = "No firmware file in form";
+            error_code = HTTPD_400_BAD_REQUEST;
+        }
+    }
+
+    esp_err_t err = ESP_FAIL;
+    ota_writer_status_t st;
+    if (error != NULL) {
+        ESP_LOGE(TAG, "OTA: %s", error);
+        ota_writer_abort(error);
+    } else {
+        // A failed write also ends here; the writer reports it
+        ESP_LOGI(TAG, "OTA: Received complete, validating firmware...");
+        err = ota_writer_end();
+        if (err == ESP_OK) {
+            err = esp_ota_set_boot_partition(up->partition);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "OTA: esp_ota_set_boot_partition failed (%s)", esp_err_to_name(err));
+                error = "Failed to set boot partition";
+            }
+        } else if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+            error = "Firmware validation failed - file may be corrupted";
+            error_code = HTTPD_400_BAD_REQUEST;
+        } else {
+            ota_writer_get_status(&st);
+            error = st.error;
+        }
+    }
+
+    if (error != NULL) {
+        httpd_resp_send_err(req, error_code, error);
+        httpd_req_async_handler_complete(req);
+        free(up);
+        ota_upload_active = false;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    ESP_LOGI(TAG, "OTA: Update successful! Rebooting in 2 seconds...");
+
+    // Send success response
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_sendstr(req, "Firmware update successful! Device will reboot now...");
+
+    // Give time for response to be sent
+    vTaskDelay(pdMS_TO_TICKS(2000));
+
+    // Reboot to new firmware
+    esp_restart();
+}
+
+// OTA firmware update POST handler. The body is either the raw image (as
+// sent by the web UI) or a multipart form with the image as a file field.
+// It is received by a separate task so the server keeps answering
+// /api/ota/progress during the upload.
 static esp_err_t ota_post_handler(httpd_req_t *req) {
     last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
     ESP_LOGI(TAG, "OTA update request received");
 
-    // Maximum firmware size (based on partition size minus some margin)
-    const size_t MAX_FIRMWARE_SIZE = 1900000;  // ~1.8MB
+    if (ota_upload_active) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "Another firmware update is in progress");
+        return ESP_OK;
+    }
 
     // Validate content length
     if (req->content_len == 0) {
@@ -1932,14 +2425,6 @@ static esp_err_t ota_post_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    if (req->content_len > MAX_FIRMWARE_SIZE) {
-        ESP_LOGE(TAG, "OTA: Firmware too large (%d bytes, max %d)", req->content_len, MAX_FIRMWARE_SIZE);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware file too large");
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "OTA: Receiving firmware (%d bytes)", req->content_len);
-
     // Get the next OTA partition to write to
     const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
     if (update_partition == NULL) {
@@ -1948,124 +2433,110 @@ static esp_err_t ota_post_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "OTA: Writing to partition '%s' at offset 0x%lx",
-             update_partition->label, update_partition->address);
+    char content_type[160] = "";
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+    if (err == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content-Type too long");
+        return ESP_FAIL;
+    }
+    bool multipart = strncasecmp(content_type, "multipart/", 10) == 0;
 
-    // Begin OTA update
-    esp_ota_handle_t ota_handle;
-    esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "OTA: esp_ota_begin failed (%s)", esp_err_to_name(err));
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA update");
+    size_t max_size = update_partition->size + (multipart ? OTA_FORM_OVERHEAD : 0);
+    if (req->content_len > max_size) {
+        ESP_LOGE(TAG, "OTA: Firmware too large (%d bytes, max %d)", req->content_len, (int)max_size);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware file too large");
         return ESP_FAIL;
     }
 
-    // Buffer for receiving firmware chunks
-    char *buf = malloc(4096);
-    if (buf == NULL) {
-        ESP_LOGE(TAG, "OTA: Failed to allocate receive buffer");
-        esp_ota_abort(ota_handle);
+    ota_upload_t *up = calloc(1, sizeof(ota_upload_t));
+    if (up == NULL) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
         return ESP_FAIL;
     }
-
-    int received;
-    int remaining = req->content_len;
-    int total_written = 0;
-    bool header_skipped = false;
-
-    while (remaining > 0) {
-        // Receive a chunk
-        received = httpd_req_recv(req, buf, MIN(remaining, 4096));
-        if (received <= 0) {
-            if (received == HTTPD_SOCK_ERR_TIMEOUT) {
-                // Retry on timeout
-                continue;
-            }
-            ESP_LOGE(TAG, "OTA: Receive error");
-            free(buf);
-            esp_ota_abort(ota_handle);
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware upload failed");
-            return ESP_FAIL;
-        }
-
-        // For first chunk, check if we need to skip multipart headers
-        char *data = buf;
-        int data_len = received;
-
-        if (!header_skipped) {
-            // Look for the end of headers (double CRLF)
-            char *header_end = strstr(buf, "\r\n\r\n");
-            if (header_end != NULL) {
-                header_end += 4;  // Skip past \r\n\r\n
-                data_len = received - (header_end - buf);
-                data = header_end;
-                header_skipped = true;
-                ESP_LOGI(TAG, "OTA: Skipped %d bytes of headers", (int)(header_end - buf));
-            }
-        }
-
-        // Write chunk to flash
-        if (data_len > 0) {
-            err = esp_ota_write(ota_handle, data, data_len);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "OTA: esp_ota_write failed (%s)", esp_err_to_name(err));
-                free(buf);
-                esp_ota_abort(ota_handle);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write firmware");
-                return ESP_FAIL;
-            }
-            total_written += data_len;
-        }
-
-        remaining -= received;
-
-        // Log progress periodically
-        if (total_written % 102400 < 4096) {
-            ESP_LOGI(TAG, "OTA: Progress %d/%d bytes (%.1f%%)",
-                     total_written, req->content_len,
-                     (float)total_written / req->content_len * 100);
-        }
+    up->partition = update_partition;
+    up->multipart = multipart;
+    if (multipart && !multipart_init(&up->mp, content_type, ota_multipart_cb, up)) {
+        ESP_LOGE(TAG, "OTA: %s", multipart_error(&up->mp));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, multipart_error(&up->mp));
+        free(up);
+        return ESP_FAIL;
     }
 
-    free(buf);
-
-    ESP_LOGI(TAG, "OTA: Received complete, validating firmware...");
+    ESP_LOGI(TAG, "OTA: Receiving firmware (%d bytes%s)", req->content_len,
+             multipart ? ", multipart" : "");
 
-    // End OTA update (this validates the firmware)
-    err = esp_ota_end(ota_handle);
+    // The body bounds the image, so only that much flash is erased
+    err = ota_writer_begin(update_partition, MIN(req->content_len, update_partition->size));
     if (err != ESP_OK) {
-        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
-            ESP_LOGE(TAG, "OTA: Firmware validation failed - image is corrupted");
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware validation failed - file may be corrupted");
-        } else {
-            ESP_LOGE(TAG, "OTA: esp_ota_end failed (%s)", esp_err_to_name(err));
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "OTA finalization failed");
-        }
+        ESP_LOGE(TAG, "OTA: Failed to start writer (%s)", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA update");
+        free(up);
         return ESP_FAIL;
     }
 
-    // Set the new partition as boot partition
-    err = esp_ota_set_boot_partition(update_partition);
+    err = httpd_req_async_handler_begin(req, &up->req);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "OTA: esp_ota_set_boot_partition failed (%s)", esp_err_to_name(err));
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set boot partition");
+        ota_writer_abort("Failed to start receive task");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA update");
+        free(up);
         return ESP_FAIL;
     }
 
-    ESP_LOGI(TAG, "OTA: Update successful! Rebooting in 2 seconds...");
+    ota_total = req->content_len;
+    ota_received = 0;
+    ota_upload_active = true;
+    if (xTaskCreate(ota_receive_task, "ota_rx", 6144, up, 5, NULL) != pdPASS) {
+        ota_writer_abort("Failed to start receive task");
+        httpd_resp_send_err(up->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA update");
+        httpd_req_async_handler_complete(up->req);
+        free(up);
+        ota_upload_active = false;
+        return ESP_OK;
+    }
+    return ESP_OK;
+}
 
-    // Send success response
-    httpd_resp_set_type(req, "text/plain");
-    httpd_resp_sendstr(req, "Firmware update successful! Device will reboot now...");
+// GET /api/ota/progress - state and throughput of the current or last firmware
+// upload. Rates are in kB/s (1000 bytes): receive over the time since the
+// upload started, write over the time spent writing flash.
+static esp_err_t api_ota_progress_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
 
-    // Give time for response to be sent
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    ota_writer_status_t st;
+    ota_writer_get_status(&st);
 
-    // Reboot to new firmware
-    esp_restart();
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    cJSON_AddStringToObject(root, "state", ota_writer_state_name(st.state));
+    cJSON_AddNumberToObject(root, "total", ota_total);
+    cJSON_AddNumberToObject(root, "received", ota_received);
+    cJSON_AddNumberToObject(root, "written", st.written);
+    cJSON_AddNumberToObject(root, "elapsed_ms", st.elapsed_ms);
+    cJSON_AddNumberToObject(root, "erase_ms", st.erase_ms);
+    cJSON_AddNumberToObject(root, "write_ms", st.write_ms);
+    cJSON_AddNumberToObject(root, "stall_ms", st.stall_ms);
+    cJSON_AddNumberToObject(root, "receive_kBps",
+                            st.elapsed_ms ? (double)ota_received / st.elapsed_ms : 0);
+    cJSON_AddNumberToObject(root, "write_kBps",
+                            st.write_ms ? (double)st.written / st.write_ms : 0);
+    if (st.state == OTA_WRITER_FAILED) {
+        cJSON_AddStringToObject(root, "error", st.error);
+    }
 
-    return ESP_OK;  // Never reached
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    cJSON_free(json);
+    return ESP_OK;
 }
 
 // Apply POST handler - saves display config and triggers image display + sleep
@@ -2073,11 +2544,11 @@ static esp_err_t apply_post_handler(httpd_req_t *req) {
     last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
     ESP_LOGI(TAG, "Apply request received");
 
-    char buf[768];
+    char buf[2048];  // Tile layout lines grow when URL-encoded
     char new_url[MAX_URL_LEN] = {0};
     uint32_t new_refresh = 60;
-    uint16_t new_img_width = 800;
-    uint16_t new_img_height = 480;
+    uint16_t new_img_width = IMAGE_WIDTH;
+    uint16_t new_img_height = IMAGE_HEIGHT;
     bool new_img_scale = false;
     uint16_t new_img_rotation = 0;
     bool new_img_mirror_h = false;
@@ -2085,6 +2556,11 @@ static esp_err_t apply_post_handler(httpd_req_t *req) {
     bool new_img_rot_first = true;
     bool new_led_disabled = false;
     bool new_ssl_skip = false;
+    bool new_refresh_align = false;
+    bool new_playlist = false;
+    uint32_t new_playlist_check = DEFAULT_PLAYLIST_CHECK_MIN;
+    char new_panel_layout[MAX_PANEL_LAYOUT_LEN] = {0};
+    char new_tile_layout[MAX_TILE_LAYOUT_LEN] = {0};
     int ret, remaining = req->content_len;
 
     if (remaining > sizeof(buf) - 1) {
@@ -2109,7 +2585,13 @@ static esp_err_t apply_post_handler(httpd_req_t *req) {
     parse_post_data(buf, dummy_ssid, dummy_password, new_url, &new_refresh,
                     &new_img_width, &new_img_height, &new_img_scale,
                     &new_img_rotation, &new_img_mirror_h, &new_img_mirror_v, &new_img_rot_first,
-                    &new_led_disabled, &new_ssl_skip);
+                    &new_led_disabled, &new_ssl_skip, &new_refresh_align, &new_playlist,
+                    &new_playlist_check, new_panel_layout, new_tile_layout);
+
+    if (panel_layout_rejected(new_panel_layout)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid panel layout or pins");
+        return ESP_FAIL;
+    }
 
     ESP_LOGI(TAG, "Applying display config - URL: %s, LED disabled: %s, SSL skip: %s",
              new_url, new_led_disabled ? "yes" : "no", new_ssl_skip ? "yes" : "no");
@@ -2118,7 +2600,8 @@ static esp_err_t apply_post_handler(httpd_req_t *req) {
     save_display_config_to_nvs(new_url, new_refresh, new_img_width, new_img_height,
                                 new_img_scale, new_img_rotation, new_img_mirror_h,
                                 new_img_mirror_v, new_img_rot_first, new_led_disabled,
-                                new_ssl_skip);
+                                new_ssl_skip, new_refresh_align, new_playlist,
+                                new_playlist_check, new_panel_layout, new_tile_layout);
 
     // Send response indicating we're applying
     const char* resp_str =
@@ -2142,7 +2625,7 @@ static esp_err_t apply_post_handler(httpd_req_t *req) {
 static void parse_network_post_data(char *buf, char *ssid, char *password, char *hostname, char *domain,
                                      bool *use_dhcp, char *static_ip, char *static_mask, char *static_gw,
                                      char *dns_primary, char *dns_secondary, char *ntp_server, char *timezone,
-                                     char *syslog_host, uint16_t *syslog_port, bool *syslog_en,
+                                     uint16_t *ntp_max_err, char *syslog_host, uint16_t *syslog_port, bool *syslog_en,
                                      uint8_t *syslog_fmt, uint8_t *syslog_tp) {
     char *token;
     char *saveptr;
@@ -2176,6 +2659,7 @@ static void parse_network_post_data(char *buf, char *ssid, char *password, char
             else if (strcmp(key, "dns_secondary") == 0) strncpy(dns_secondary, decoded, MAX_IP_LEN - 1);
             else if (strcmp(key, "ntp_server") == 0) strncpy(ntp_server, decoded, MAX_NTP_SERVER_LEN - 1);
             else if (strcmp(key, "timezone") == 0) strncpy(timezone, decoded, MAX_TIMEZONE_LEN - 1);
+            else if (strcmp(key, "ntp_max_err") == 0) *ntp_max_err = (uint16_t)atoi(decoded);
             else if (strcmp(key, "syslog_en") == 0) *syslog_en = true;
             else if (strcmp(key, "syslog_host") == 0) strncpy(syslog_host, decoded, MAX_SYSLOG_HOST_LEN - 1);
             else if (strcmp(key, "syslog_port") == 0) *syslog_port = (uint16_t)atoi(decoded);
@@ -2204,6 +2688,7 @@ static esp_err_t save_network_post_handler(httpd_req_t *req) {
     char new_dns_secondary[MAX_IP_LEN] = {0};
     char new_ntp_server[MAX_NTP_SERVER_LEN] = {0};
     char new_timezone[MAX_TIMEZONE_LEN] = {0};
+    uint16_t new_ntp_max_err = stored_ntp_max_err;
     char new_syslog_host[MAX_SYSLOG_HOST_LEN] = {0};
     uint16_t new_syslog_port = DEFAULT_SYSLOG_PORT;
     bool new_syslog_en = false;
@@ -2229,7 +2714,7 @@ static esp_err_t save_network_post_handler(httpd_req_t *req) {
     parse_network_post_data(buf, new_ssid, new_password, new_hostname, new_domain,
                             &new_use_dhcp, new_static_ip, new_static_mask, new_static_gw,
                             new_dns_primary, new_dns_secondary, new_ntp_server, new_timezone,
-                            new_syslog_host, &new_syslog_port, &new_syslog_en,
+                            &new_ntp_max_err, new_syslog_host, &new_syslog_port, &new_syslog_en,
                             &new_syslog_fmt, &new_syslog_tp);
 
     ESP_LOGI(TAG, "Network config - SSID: %s, Hostname: %s, DHCP: %s",
@@ -2239,7 +2724,7 @@ static esp_err_t save_network_post_handler(httpd_req_t *req) {
     save_network_config_to_nvs(new_ssid, new_password, new_hostname, new_domain,
                                 new_use_dhcp, new_static_ip, new_static_mask, new_static_gw,
                                 new_dns_primary, new_dns_secondary, stored_dns_search,
-                                new_ntp_server, new_timezone);
+                                new_ntp_server, new_timezone, new_ntp_max_err);
 
     // Save syslog config to NVS
     save_syslog_config_to_nvs(new_syslog_host, new_syslog_port, new_syslog_en,
@@ -2290,14 +2775,124 @@ static esp_err_t api_time_handler(httpd_req_t *req) {
     // Check if time is likely synced (year > 2023 means NTP worked)
     bool likely_synced = (timeinfo.tm_year + 1900) > 2023;
 
-    char response[256];
+    char response[320];
     snprintf(response, sizeof(response),
-        "{\"time\":\"%s\",\"synced\":%s,\"timezone\":\"%s\",\"epoch\":%ld,\"last_sync\":%ld}",
+        "{\"time\":\"%s\",\"synced\":%s,\"timezone\":\"%s\",\"epoch\":%ld,\"last_sync\":%ld,"
+        "\"drift_ppb\":%ld,\"predicted_error_ms\":%lu}",
         time_str,
         (ntp_synced && likely_synced) ? "true" : "false",
         stored_timezone,
         (long)now,
-        (long)last_ntp_sync);
+        (long)last_ntp_sync,
+        (long)time_drift.drift_ppb,
+        (unsigned long)time_drift_predicted_error_ms(&time_drift, clock_now_us()));
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// API handler for device status (JSON response)
+static esp_err_t api_status_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+
+    wifi_cache_stats_t ws;
+    wifi_cache_get_stats(&ws);
+    config_store_stats_t cs;
+    config_store_get_stats(&cs);
+
+    framecache_stats_t fs;
+    framecache_get_stats(&fs);
+    slides_stats_t ss;
+    slides_get_stats(&ss);
+    tiles_stats_t ts;
+    tiles_get_stats(&ts);
+
+    // Energy per displayed frame over the unattended wakes so far (uJ -> mJ)
+    uint64_t energy_uj = (energy_awake_ms * ENERGY_AWAKE_MA +
+                          energy_radio_ms * (ENERGY_RADIO_MA - ENERGY_AWAKE_MA)) * ENERGY_SUPPLY_MV / 1000;
+    uint32_t mj_per_frame = energy_frames ? (uint32_t)(energy_uj / 1000 / energy_frames) : 0;
+
+    static char response[2048];
+    snprintf(response, sizeof(response),
+        "{\"uptime_ms\":%lld,\"boot\":{\"first_packet_ms\":%lld,\"last_first_packet_ms\":%lu,"
+        "\"last_awake_ms\":%lu,\"fetch_latency_ms\":%lu},\"wifi\":{\"connected\":%s,\"last_path\":\"%s\",\"last_ms\":%lu,"
+        "\"last_fast_ms\":%lu,\"last_full_ms\":%lu,\"fast_ok\":%lu,\"fast_fail\":%lu,\"full_ok\":%lu},"
+        "\"config\":{\"source\":\"%s\",\"load_us\":%lu,\"save_us\":%lu,\"saves\":%lu,\"saves_skipped\":%lu},"
+        "\"framecache\":{\"slots\":%u,\"read_us\":%lu,\"write_us\":%lu,\"writes\":%lu,\"skipped\":%lu,"
+        "\"panel_seq\":%lu,\"fetch_failures\":%lu},"
+        "\"slides\":{\"enabled\":%s,\"frames\":%u,\"stored\":%u,\"stored_bytes\":%lu,\"capacity\":%lu,"
+        "\"checks\":%lu,\"changes\":%lu,\"downloads\":%lu,\"reused\":%lu,\"evictions\":%lu,\"shown\":%lu,"
+        "\"last_sync_ms\":%lu,\"last_show_ms\":%lu},"
+        "\"tiles\":{\"count\":%u,\"fetched\":%u,\"unchanged\":%u,\"failed\":%u,\"bytes\":%lu,"
+        "\"fetch_ms\":%lu,\"render_ms\":%lu},"
+        "\"render\":{\"png\":{\"bytes\":%lu,\"fetch_ms\":%lu,\"render_ms\":%lu},"
+        "\"widgets\":{\"bytes\":%lu,\"fetch_ms\":%lu,\"render_ms\":%lu}},"
+        "\"web\":{\"page_bytes\":%lu,\"page_us\":%lu,\"page_not_modified\":%lu,"
+        "\"config_bytes\":%lu,\"config_us\":%lu},"
+        "\"energy\":{\"wakes\":%lu,\"frames\":%lu,\"awake_ms\":%llu,\"radio_ms\":%llu,"
+        "\"mj_per_frame\":%lu}}",
+        (long long)(esp_timer_get_time() / 1000),
+        (long long)stage_ms[STAGE_FIRST_PACKET],
+        (unsigned long)last_first_packet_ms,
+        (unsigned long)last_awake_ms,
+        (unsigned long)fetch_latency_ms,
+        wifi_connected ? "true" : "false",
+        wifi_cache_path_name(ws.last_path),
+        (unsigned long)ws.last_ms,
+        (unsigned long)ws.last_fast_ms,
+        (unsigned long)ws.last_full_ms,
+        (unsigned long)ws.fast_ok,
+        (unsigned long)ws.fast_fail,
+        (unsigned long)ws.full_ok,
+        config_store_source_name(cs.source),
+        (unsigned long)cs.load_us,
+        (unsigned long)cs.save_us,
+        (unsigned long)cs.saves,
+        (unsigned long)cs.saves_skipped,
+        (unsigned)fs.slots,
+        (unsigned long)fs.read_us,
+        (unsigned long)fs.write_us,
+        (unsigned long)fs.writes,
+        (unsigned long)fs.skipped,
+        (unsigned long)panel_frame_seq,
+        (unsigned long)fetch_failures,
+        stored_playlist ? "true" : "false",
+        (unsigned)ss.frames,
+        (unsigned)ss.stored,
+        (unsigned long)ss.stored_bytes,
+        (unsigned long)ss.capacity,
+        (unsigned long)ss.checks,
+        (unsigned long)ss.changes,
+        (unsigned long)ss.downloads,
+        (unsigned long)ss.reused,
+        (unsigned long)ss.evictions,
+        (unsigned long)ss.shown,
+        (unsigned long)ss.last_sync_ms,
+        (unsigned long)ss.last_show_ms,
+        (unsigned)ts.tiles,
+        (unsigned)ts.fetched,
+        (unsigned)ts.unchanged,
+        (unsigned)ts.failed,
+        (unsigned long)ts.bytes,
+        (unsigned long)ts.fetch_ms,
+        (unsigned long)ts.render_ms,
+        (unsigned long)png_cost.bytes,
+        (unsigned long)png_cost.fetch_ms,
+        (unsigned long)png_cost.render_ms,
+        (unsigned long)widget_cost.bytes,
+        (unsigned long)widget_cost.fetch_ms,
+        (unsigned long)widget_cost.render_ms,
+        (unsigned long)web_page_bytes,
+        (unsigned long)web_page_us,
+        (unsigned long)web_page_not_modified,
+        (unsigned long)web_config_bytes,
+        (unsigned long)web_config_us,
+        (unsigned long)energy_wakes,
+        (unsigned long)energy_frames,
+        (unsigned long long)energy_awake_ms,
+        (unsigned long long)energy_radio_ms,
+        (unsigned long)mj_per_frame);
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
@@ -2332,10 +2927,27 @@ static esp_err_t api_ntp_sync_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// Display settings for a queued "show", taken when it is queued: the job
+// task must not read the stored_* settings that handlers rewrite meanwhile
+typedef struct {
+    char url[MAX_URL_LEN];
+    uint16_t img_width;
+    uint16_t img_height;
+    bool img_scale;
+    uint16_t img_rotation;
+    bool img_mirror_h;
+    bool img_mirror_v;
+    bool img_rot_first;
+    bool ssl_skip;
+} show_settings_t;
+
+static show_settings_t show_request;           // Latest "show" submitted (httpd task)
+static SemaphoreHandle_t show_request_lock = NULL;  // Protects show_request
+
 // Forward declarations for display functions used by action handler
-static void do_show_test_pattern(void);
-static void do_show_image_from_url(void);
-static void do_clear_display(void);
+static const char *do_show_test_pattern(void);
+static const char *do_show_image_from_url(void);
+static const char *do_clear_display(void);
 
 // Action handler - shows loading page with JavaScript to call the actual action
 static esp_err_t action_handler(httpd_req_t *req) {
@@ -2347,23 +2959,30 @@ static esp_err_t action_handler(httpd_req_t *req) {
     const char *resp_title = "Action";
     const char *resp_msg = "Processing...";
     const char *resp_color = "#888";
+    const char *resp_done = "Done!";
 
     if (strcmp(action, "test") == 0) {
         resp_title = "Test Pattern";
         resp_msg = "Displaying test pattern...";
         resp_color = "#2196F3";
+        resp_done = "Test pattern displayed!";
     } else if (strcmp(action, "show") == 0) {
         resp_title = "Show Image";
         resp_msg = "Downloading and displaying image...";
         resp_color = "#FF9800";
+        resp_done = "Image displayed!";
     } else if (strcmp(action, "clear") == 0) {
         resp_title = "Clear Display";
         resp_msg = "Clearing display...";
         resp_color = "#f44336";
+        resp_done = "Display cleared!";
+    } else {
+        action = "";  // Not echoed into the page
     }
 
-    // Send loading page immediately, then JavaScript fetches the actual action
-    static char resp[1024];
+    // Send loading page immediately; JavaScript queues the action and
+    // follows the job until it is done
+    static char resp[2048];
     snprintf(resp, sizeof(resp),
         "<!DOCTYPE html><html><head><meta name='viewport' content='width=device-width, initial-scale=1'>"
         "<style>body{font-family:Arial;text-align:center;margin-top:50px;background-color:#f0f0f0;}"
@@ -2371,36 +2990,495 @@ static esp_err_t action_handler(httpd_req_t *req) {
         "h1{color:%s;}.spinner{border:4px solid #f3f3f3;border-top:4px solid %s;border-radius:50%%;width:40px;height:40px;animation:spin 1s linear infinite;margin:20px auto;}"
         "@keyframes spin{0%%{transform:rotate(0deg);}100%%{transform:rotate(360deg);}}</style></head>"
         "<body><div class='message'><h1>%s</h1><div class='spinner'></div><p id='status'>%s</p></div>"
-        "<script>fetch('/do/%s').then(r=>r.text()).then(t=>{document.getElementById('status').innerHTML=t+'<br><small>Redirecting...</small>';setTimeout(()=>location.href='/',2000);}).catch(e=>{document.getElementById('status').innerHTML='Error: '+e;});</script>"
-        "</body></html>", resp_color, resp_color, resp_title, resp_msg, action);
+        "<script>var s=document.getElementById('status');"
+        "function end(t){s.textContent=t;s.insertAdjacentHTML('beforeend','<br><small>Redirecting...</small>');setTimeout(()=>location.href='/',2000);}"
+        "function poll(id){fetch('/api/jobs/'+id).then(r=>r.json()).then(j=>{"
+        "if(j.state=='done')end('\\u2714 %s');else if(j.state=='failed')end('\\u2718 '+j.error);"
+        "else{s.textContent=j.stage+'... ('+Math.round(j.ms.total/1000)+' s)';setTimeout(()=>poll(id),1000);}"
+        "}).catch(e=>{s.textContent='Error: '+e;});}"
+        "fetch('/do/%s').then(r=>r.json()).then(j=>j.id?poll(j.id):end('Error: '+j.error)).catch(e=>{s.textContent='Error: '+e;});</script>"
+        "</body></html>", resp_color, resp_color, resp_title, resp_msg, resp_done, action);
 
     httpd_resp_set_type(req, "text/html");
     httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
     return ESP_OK;
 }
 
-// Do handler - actually performs the action
+// Do handler - queues the action for the job worker and returns its ID
 static esp_err_t do_handler(httpd_req_t *req) {
     last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
 
     const char *action = req->uri + strlen("/do/");
-    ESP_LOGI(TAG, "Performing action: %s", action);
+    ESP_LOGI(TAG, "Queueing action: %s", action);
+
+    httpd_resp_set_type(req, "application/json");
+    if (strcmp(action, "test") != 0 && strcmp(action, "show") != 0 && strcmp(action, "clear") != 0) {
+        httpd_resp_set_status(req, "404 Not Found");
+        httpd_resp_send(req, "{\"error\":\"Unknown action\"}", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
 
-    const char *result = "Unknown action";
+    if (strcmp(action, "show") == 0) {
+        // A queued "show" is not queued again, so it runs with these
+        xSemaphoreTake(show_request_lock, portMAX_DELAY);
+        strncpy(show_request.url, stored_image_url, sizeof(show_request.url) - 1);
+        show_request.url[sizeof(show_request.url) - 1] = '\0';
+        show_request.img_width = stored_img_width;
+        show_request.img_height = stored_img_height;
+        show_request.img_scale = stored_img_scale;
+        show_request.img_rotation = stored_img_rotation;
+        show_request.img_mirror_h = stored_img_mirror_h;
+        show_request.img_mirror_v = stored_img_mirror_v;
+        show_request.img_rot_first = stored_img_rot_first;
+        show_request.ssl_skip = stored_ssl_skip;
+        xSemaphoreGive(show_request_lock);
+    }
+
+    uint32_t id = jobs_submit(action);
+    if (id == 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "{\"error\":\"Job queue full\"}", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
 
+    char resp[32];
+    snprintf(resp, sizeof(resp), "{\"id\":%lu}", (unsigned long)id);
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Job runner for the /do/* actions (runs in the job worker task)
+static const char *run_display_job(const char *action) {
     if (strcmp(action, "test") == 0) {
-        do_show_test_pattern();
-        result = "&#10004; Test pattern displayed!";
+        return do_show_test_pattern();
     } else if (strcmp(action, "show") == 0) {
-        do_show_image_from_url();
-        result = "&#10004; Image displayed!";
+        return do_show_image_from_url();
     } else if (strcmp(action, "clear") == 0) {
-        do_clear_display();
-        result = "&#10004; Display cleared!";
+        return do_clear_display();
     }
+    return "Unknown action";
+}
 
-    httpd_resp_set_type(req, "text/plain");
-    httpd_resp_send(req, result, HTTPD_RESP_USE_STRLEN);
+// API handler for job status (GET /api/jobs, GET /api/jobs/<id>)
+static esp_err_t api_jobs_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+
+    // Static: requests are serialized
+    static char resp[2048];
+    uint32_t id = 0;
+    const char *arg = req->uri + strlen("/api/jobs");
+    if (*arg == '/') {
+        id = strtoul(arg + 1, NULL, 10);
+        if (id == 0) {
+            httpd_resp_send_404(req);
+            return ESP_OK;
+        }
+    } else if (*arg != '\0' && *arg != '?') {
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    if (jobs_format_json(id, resp, sizeof(resp)) == 0) {
+        httpd_resp_set_status(req, "404 Not Found");
+        httpd_resp_send(req, "{\"error\":\"Unknown job\"}", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Image row sink for POST /api/display (ctx = SPI time in us)
+static void push_row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    int64_t start_us = esp_timer_get_time();
+    if (row == 0) {
+        epd_7in3e_stream_begin();
+    }
+    epd_7in3e_stream_write(data, len);
+    *(int64_t *)ctx += esp_timer_get_time() - start_us;
+}
+
+// Reply to an API request with a JSON error
+static esp_err_t send_json_error(httpd_req_t *req, const char *status, const char *msg) {
+    char resp[160] = "{}";  // Sent as is if the object cannot be built
+    cJSON *root = cJSON_CreateObject();
+    if (root) {
+        cJSON_AddStringToObject(root, "error", msg);
+        if (!cJSON_PrintPreallocated(root, resp, sizeof(resp), false)) {
+            strcpy(resp, "{}");
+        }
+        cJSON_Delete(root);
+    }
+    ESP_LOGW(TAG, "%s failed: %s", req->uri, msg);
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL;
+}
+
+// Receive the next part of a request body, retrying on timeouts
+static int recv_body(httpd_req_t *req, char *buf, size_t len) {
+    int received;
+    do {
+        received = httpd_req_recv(req, buf, len);
+    } while (received == HTTPD_SOCK_ERR_TIMEOUT);
+    return received;
+}
+
+// API handler for showing an uploaded image (POST /api/display)
+//
+// The body is a PNG or a native frame (IMAGE_BUFFER_SIZE bytes of packed
+// pixels in panel order) and is never held whole: PNG data is decoded chunk
+// by chunk as it arrives and then dithered row by row to the panel, native
+// frames go straight to the panel. The stored scaling and transform apply
+// to PNGs. The reply has the time spent in each stage.
+static esp_err_t display_push(httpd_req_t *req) {
+    int64_t start_us = esp_timer_get_time();
+
+    if (req->content_len == 0 || req->content_len > DISPLAY_PUSH_MAX_BODY) {
+        return send_json_error(req, "400 Bad Request", "body missing or too large");
+    }
+
+    char *chunk = malloc(DISPLAY_PUSH_CHUNK);
+    if (chunk == NULL) {
+        return send_json_error(req, "500 Internal Server Error", "out of memory");
+    }
+
+    // The first bytes tell the format
+    size_t remaining = req->content_len;
+    size_t filled = 0;
+    size_t sniff = MIN(remaining, (size_t)8);
+    int64_t recv_us = 0;
+    int64_t t = esp_timer_get_time();
+    while (filled < sniff) {
+        int received = recv_body(req, chunk + filled, MIN(remaining, (size_t)DISPLAY_PUSH_CHUNK) - filled);
+        if (received <= 0) {
+            free(chunk);
+            return ESP_FAIL;
+        }
+        filled += received;
+    }
+    recv_us += esp_timer_get_time() - t;
+    remaining -= filled;
+
+    static const uint8_t png_sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    const uint8_t *head = (const uint8_t *)chunk;
+    bool is_png = filled >= sizeof(png_sig) && memcmp(head, png_sig, sizeof(png_sig)) == 0;
+    if (!is_png) {
+        const char *err = NULL;
+        if (filled >= 3 && head[0] == 0xFF && head[1] == 0xD8 && head[2] == 0xFF) {
+            err = "JPEG is not supported, send PNG or a native frame";
+        } else if (req->content_len != IMAGE_BUFFER_SIZE) {
+            err = "not a PNG or a native frame";
+        }
+        if (err) {
+            free(chunk);
+            return send_json_error(req, "415 Unsupported Media Type", err);
+        }
+    }
+
+    ESP_LOGI(TAG, "Image push: %s, %d bytes", is_png ? "PNG" : "native frame", req->content_len);
+    set_led_color(0, 0, 50);  // Blue while receiving
+
+    if (epd_7in3e_init_hw() != ESP_OK) {
+        free(chunk);
+        set_led_color(50, 0, 0);
+        return send_json_error(req, "500 Internal Server Error", "display init failed");
+    }
+    epd_7in3e_init();
+    panel_frame_seq = 0;  // Panel no longer shows the cached frame
+
+    int64_t decode_us = 0;
+    int64_t dither_us = 0;
+    int64_t spi_us = 0;
+    const char *err = NULL;
+
+    if (is_png) {
+        if (image_processor_init() != ESP_OK) {
+            err = image_processor_get_error();
+        } else {
+            image_processor_set_scaling(stored_img_width, stored_img_height, stored_img_scale);
+            image_processor_set_transform(stored_img_rotation, stored_img_mirror_h, stored_img_mirror_v, stored_img_rot_first);
+            if (image_processor_png_begin() != ESP_OK) {
+                err = image_processor_get_error();
+            }
+        }
+    } else if (epd_7in3e_stream_begin() != ESP_OK) {
+        err = "display busy";
+    }
+
+    // Pass each chunk on as soon as it arrives; after an error the rest of
+    // the body is left for the server to discard
+    while (err == NULL) {
+        t = esp_timer_get_time();
+        if (is_png) {
+            if (image_processor_png_feed((const uint8_t *)chunk, filled) != ESP_OK) {
+                err = image_processor_get_error();
+            }
+            decode_us += esp_timer_get_time() - t;
+        } else {
+            epd_7in3e_stream_write((const uint8_t *)chunk, filled);
+            spi_us += esp_timer_get_time() - t;
+        }
+        if (err || remaining == 0) {
+            break;
+        }
+
+        t = esp_timer_get_time();
+        int received = recv_body(req, chunk, MIN(remaining, (size_t)DISPLAY_PUSH_CHUNK));
+        recv_us += esp_timer_get_time() - t;
+        if (received <= 0) {
+            ESP_LOGE(TAG, "Image push: receive failed after %u bytes",
+                     (unsigned)(req->content_len - remaining));
+            free(chunk);
+            if (is_png) {
+                image_processor_deinit();
+            }
+            epd_7in3e_sleep();
+            set_led_color(50, 0, 0);
+            return ESP_FAIL;
+        }
+        filled = received;
+        remaining -= received;
+    }
+    free(chunk);
+
+    if (err == NULL && is_png) {
+        set_led_color(0, 50, 50);  // Cyan while displaying
+        t = esp_timer_get_time();
+        if (image_processor_png_end(NULL, push_row_sink, &spi_us) != ESP_OK) {
+            err = image_processor_get_error();
+        }
+        dither_us = esp_timer_get_time() - t - spi_us;
+    }
+    if (is_png) {
+        image_processor_deinit();
+    }
+    if (err) {
+        epd_7in3e_sleep();
+        set_led_color(50, 0, 0);
+        return send_json_error(req, is_png ? "400 Bad Request" : "500 Internal Server Error", err);
+    }
+
+    set_led_color(0, 50, 50);
+    t = esp_timer_get_time();
+    esp_err_t ret = epd_7in3e_stream_end();
+    if (ret == ESP_OK) {
+        ret = epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS);
+    }
+    int64_t refresh_us = esp_timer_get_time() - t;
+    epd_7in3e_sleep();
+    if (ret != ESP_OK) {
+        set_led_color(50, 0, 0);
+        return send_json_error(req, "500 Internal Server Error", "display refresh failed");
+    }
+    set_led_color(0, 50, 0);  // Green on success
+
+    uint32_t total_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGI(TAG, "Image push shown - receive %lu ms, decode %lu ms, dither %lu ms, "
+             "transfer %lu ms, refresh %lu ms, total %lu ms",
+             (unsigned long)(recv_us / 1000), (unsigned long)(decode_us / 1000),
+             (unsigned long)(dither_us / 1000), (unsigned long)(spi_us / 1000),
+             (unsigned long)(refresh_us / 1000), (unsigned long)total_ms);
+
+    char resp[224];
+    snprintf(resp, sizeof(resp),
+        "{\"format\":\"%s\",\"bytes\":%d,\"ms\":{\"receive\":%lu,\"decode\":%lu,"
+        "\"dither\":%lu,\"transfer\":%lu,\"refresh\":%lu,\"total\":%lu}}",
+        is_png ? "png" : "native", req->content_len,
+        (unsigned long)(recv_us / 1000), (unsigned long)(decode_us / 1000),
+        (unsigned long)(dither_us / 1000), (unsigned long)(spi_us / 1000),
+        (unsigned long)(refresh_us / 1000), (unsigned long)total_ms);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// API handler for POST /api/display; refused while a display job is
+// queued or running, and queued jobs wait for it
+static esp_err_t api_display_post_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+
+    if (jobs_busy() || !jobs_hold(0)) {
+        return send_json_error(req, "409 Conflict", "display busy with a queued action");
+    }
+    esp_err_t ret = display_push(req);
+    jobs_release();
+    return ret;
+}
+
+// Frame encoded as PNG over chunked HTTP
+typedef struct {
+    png_stream_t ps;
+    tdefl_compressor *comp;
+    httpd_req_t *req;
+    bool started;
+    size_t bytes;
+} png_http_t;
+
+// PNG output callback: send each piece as one HTTP chunk
+static bool png_http_write(const uint8_t *data, size_t len, void *ctx) {
+    png_http_t *out = (png_http_t *)ctx;
+    out->bytes += len;
+    return httpd_resp_send_chunk(out->req, (const char *)data, len) == ESP_OK;
+}
+
+// Start a PNG of a packed frame; the palette maps color codes to RGB
+static bool png_http_begin(png_http_t *out) {
+    static const uint8_t colors[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+    uint8_t palette[1 << EPD_PANEL_BPP][3] = {{0}};
+    size_t count = 0;
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        uint8_t code = colors[i][3];
+        memcpy(palette[code], colors[i], 3);
+        if (code + 1u > count) {
+            count = code + 1u;
+        }
+    }
+    out->started = true;
+    httpd_resp_set_type(out->req, "image/png");
+    httpd_resp_set_hdr(out->req, "Cache-Control", "no-cache");
+    return png_stream_begin(&out->ps, out->comp, IMAGE_WIDTH, IMAGE_HEIGHT, EPD_PANEL_BPP,
+                            (const uint8_t (*)[3])palette, count, png_http_write, out);
+}
+
+// Image row sink for GET /api/preview.png: encode rows as they are dithered
+static void png_row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    png_http_t *out = (png_http_t *)ctx;
+    if (row == 0 && !png_http_begin(out)) {
+        return;
+    }
+    png_stream_row(&out->ps, data);
+}
+
+// Finish a PNG started with png_http_begin()
+static bool png_http_end(png_http_t *out) {
+    if (!png_stream_end(&out->ps)) {
+        return false;
+    }
+    return httpd_resp_send_chunk(out->req, NULL, 0) == ESP_OK;
+}
+
+// API handler for a preview of the configured image (GET /api/preview.png)
+//
+// Runs the download, decode, scale and dither steps with the stored
+// settings, exactly as for the panel, but encodes the dithered rows as an
+// indexed PNG and streams them to the browser instead. The panel is not
+// touched, so settings can be tried without a refresh.
+static esp_err_t api_preview_png_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+    int64_t start_us = esp_timer_get_time();
+
+    if (stored_image_url[0] == '\0') {
+        return send_json_error(req, "404 Not Found", "No image URL configured");
+    }
+    // The image processor is shared with the display actions
+    if (!jobs_hold(0)) {
+        return send_json_error(req, "409 Conflict", "display busy with a queued action");
+    }
+
+    // Static: too large for the httpd task stack, and requests are serialized
+    static png_http_t out;
+    memset(&out, 0, sizeof(out));
+    out.req = req;
+    out.comp = heap_caps_malloc(sizeof(tdefl_compressor), MALLOC_CAP_SPIRAM);
+
+    const char *err = NULL;
+    if (out.comp == NULL) {
+        err = "Failed to allocate PNG encoder";
+    } else if (image_processor_init() != ESP_OK) {
+        err = image_processor_get_error();
+    } else {
+        image_processor_set_scaling(stored_img_width, stored_img_height, stored_img_scale);
+        image_processor_set_transform(stored_img_rotation, stored_img_mirror_h, stored_img_mirror_v, stored_img_rot_first);
+        image_processor_set_ssl_skip(stored_ssl_skip);
+        if (image_download_and_stream(stored_image_url, NULL, png_row_sink, &out) != ESP_OK) {
+            err = image_processor_get_error();
+        }
+    }
+
+    bool ok = err == NULL && out.started && png_http_end(&out);
+    // Error messages live in the image processor, so reply before deinit
+    esp_err_t ret = ESP_OK;
+    if (!out.started) {
+        ret = send_json_error(req, "502 Bad Gateway", err ? err : "No image produced");
+    } else if (!ok) {
+        ESP_LOGW(TAG, "Preview aborted after %u bytes", (unsigned)out.bytes);
+        ret = ESP_FAIL;  // Headers are out; closing the connection marks the error
+    }
+    image_processor_deinit();
+    heap_caps_free(out.comp);
+    jobs_release();
+
+    if (ok) {
+        ESP_LOGI(TAG, "Preview sent - %u bytes PNG, %lu ms", (unsigned)out.bytes,
+                 (unsigned long)((esp_timer_get_time() - start_us) / 1000));
+    }
+    return ret;
+}
+
+// API handler for the last displayed frame (GET /api/framebuffer.png)
+//
+// The frame comes from the frame cache, read in place from flash and
+// encoded row by row; X-On-Panel tells whether the panel still shows it
+// (test patterns and pushed images are not cached).
+static esp_err_t api_framebuffer_png_handler(httpd_req_t *req) {
+    last_client_activity = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+    int64_t start_us = esp_timer_get_time();
+
+    if (!framecache_ready) {
+        framecache_ready = (framecache_init(IMAGE_BUFFER_SIZE) == ESP_OK);
+    }
+    const framecache_meta_t *meta = framecache_ready ? framecache_current() : NULL;
+    if (meta == NULL) {
+        return send_json_error(req, "404 Not Found", "No frame cached");
+    }
+
+    // The frame CRC doubles as ETag
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)meta->frame_crc);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "X-On-Panel", panel_frame_seq == meta->seq ? "1" : "0");
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match,
+                                    sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, etag) != NULL) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    const uint8_t *frame;
+    esp_partition_mmap_handle_t handle;
+    if (framecache_map(&frame, &handle) != ESP_OK) {
+        return send_json_error(req, "500 Internal Server Error", "Cached frame unreadable");
+    }
+
+    static png_http_t out;
+    memset(&out, 0, sizeof(out));
+    out.req = req;
+    out.comp = heap_caps_malloc(sizeof(tdefl_compressor), MALLOC_CAP_SPIRAM);
+    if (out.comp == NULL) {
+        framecache_unmap(handle);
+        return send_json_error(req, "500 Internal Server Error", "Failed to allocate PNG encoder");
+    }
+
+    bool ok = png_http_begin(&out);
+    for (int row = 0; ok && row < IMAGE_HEIGHT; row++) {
+        ok = png_stream_row(&out.ps, frame + (size_t)row * IMAGE_ROW_BYTES);
+    }
+    ok = ok && png_http_end(&out);
+    framecache_unmap(handle);
+    heap_caps_free(out.comp);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Framebuffer PNG aborted after %u bytes", (unsigned)out.bytes);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Framebuffer sent - %u bytes PNG, %lu ms", (unsigned)out.bytes,
+             (unsigned long)((esp_timer_get_time() - start_us) / 1000));
     return ESP_OK;
 }
 
@@ -2411,7 +3489,7 @@ static httpd_handle_t start_webserver(void) {
     config.server_port = WEB_SERVER_PORT;
     config.lru_purge_enable = true;
     config.uri_match_fn = httpd_uri_match_wildcard;  // Enable wildcard matching
-    config.max_uri_handlers = 16;  // Increase from default 8 for captive portal handlers
+    config.max_uri_handlers = 24;  // Increase from default 8 for captive portal and API handlers
     config.stack_size = 16384;  // Increase stack size for schedule JSON handling
 
     ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
@@ -2453,18 +3531,74 @@ static httpd_handle_t start_webserver(void) {
         httpd_uri_t api_time = {
             .uri       = "/api/time",
             .method    = HTTP_GET,
-            .handler   = api_time_handler,
+            .handler   = api_time_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_time);
+
+        httpd_uri_t api_ntp_sync = {
+            .uri       = "/api/ntp_sync",
+            .method    = HTTP_POST,
+            .handler   = api_ntp_sync_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_ntp_sync);
+
+        httpd_uri_t api_status = {
+            .uri       = "/api/status",
+            .method    = HTTP_GET,
+            .handler   = api_status_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_status);
+
+        httpd_uri_t api_config = {
+            .uri       = "/api/config",
+            .method    = HTTP_GET,
+            .handler   = api_config_get_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_config);
+
+        httpd_uri_t api_config_put = {
+            .uri       = "/api/config",
+            .method    = HTTP_PUT,
+            .handler   = api_config_put_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_config_put);
+
+        httpd_uri_t api_display = {
+            .uri       = "/api/display",
+            .method    = HTTP_POST,
+            .handler   = api_display_post_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_display);
+
+        httpd_uri_t api_jobs = {
+            .uri       = "/api/jobs*",
+            .method    = HTTP_GET,
+            .handler   = api_jobs_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_jobs);
+
+        httpd_uri_t api_preview = {
+            .uri       = "/api/preview.png",
+            .method    = HTTP_GET,
+            .handler   = api_preview_png_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &api_time);
+        httpd_register_uri_handler(server, &api_preview);
 
-        httpd_uri_t api_ntp_sync = {
-            .uri       = "/api/ntp_sync",
-            .method    = HTTP_POST,
-            .handler   = api_ntp_sync_handler,
+        httpd_uri_t api_framebuffer = {
+            .uri       = "/api/framebuffer.png",
+            .method    = HTTP_GET,
+            .handler   = api_framebuffer_png_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &api_ntp_sync);
+        httpd_register_uri_handler(server, &api_framebuffer);
 
         httpd_uri_t action = {
             .uri       = "/action/*",
@@ -2491,6 +3625,14 @@ static httpd_handle_t start_webserver(void) {
         };
         httpd_register_uri_handler(server, &ota);
 
+        httpd_uri_t api_ota_progress = {
+            .uri       = "/api/ota/progress",
+            .method    = HTTP_GET,
+            .handler   = api_ota_progress_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(server, &api_ota_progress);
+
         // Register captive portal handlers only in AP mode
         if (ap_mode) {
             ESP_LOGI(TAG, "Registering captive portal handlers");
@@ -2558,7 +3700,7 @@ static void stop_webserver(httpd_handle_t server) {
 }
 
 // Display action: Show test pattern
-static void do_show_test_pattern(void) {
+static const char *do_show_test_pattern(void) {
     ESP_LOGI(TAG, "Showing test pattern...");
     set_led_color(50, 50, 0);  // Yellow while working
 
@@ -2567,26 +3709,36 @@ static void do_show_test_pattern(void) {
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init display hardware");
         set_led_color(50, 0, 0);  // Red on error
-        return;
+        return "Failed to init display hardware";
     }
     epd_7in3e_init();
 
-    // Show color blocks
+    panel_frame_seq = 0;  // Panel no longer shows the cached frame
+
+    // Show color blocks (transfer and refresh in one call)
+    jobs_stage(JOB_STAGE_REFRESHING);
     epd_7in3e_show_color_blocks();
     epd_7in3e_sleep();
 
     set_led_color(0, 50, 0);  // Green on success
     ESP_LOGI(TAG, "Test pattern displayed");
+    return NULL;
 }
 
 // Display action: Show image from URL
-static void do_show_image_from_url(void) {
-    ESP_LOGI(TAG, "Showing image from URL: %s", stored_image_url);
+static const char *do_show_image_from_url(void) {
+    // Static: too large for the job task stack
+    static show_settings_t show;
+    xSemaphoreTake(show_request_lock, portMAX_DELAY);
+    show = show_request;
+    xSemaphoreGive(show_request_lock);
 
-    if (stored_image_url[0] == '\0') {
+    ESP_LOGI(TAG, "Showing image from URL: %s", show.url);
+
+    if (show.url[0] == '\0') {
         ESP_LOGE(TAG, "No image URL configured");
         set_led_color(50, 0, 0);  // Red on error
-        return;
+        return "No image URL configured";
     }
 
     set_led_color(0, 0, 50);  // Blue while downloading
@@ -2596,7 +3748,7 @@ static void do_show_image_from_url(void) {
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init display hardware");
         set_led_color(50, 0, 0);
-        return;
+        return "Failed to init display hardware";
     }
     epd_7in3e_init();
 
@@ -2608,7 +3760,7 @@ static void do_show_image_from_url(void) {
         set_led_color(50, 0, 0);
         error_display_show(error_display_categorize(err_msg), err_msg);
         epd_7in3e_sleep();
-        return;
+        return err_msg;
     }
 
     // Allocate image buffer
@@ -2619,35 +3771,66 @@ static void do_show_image_from_url(void) {
         error_display_show(ERROR_TYPE_INIT, "Failed to allocate image buffer");
         image_processor_deinit();
         epd_7in3e_sleep();
-        return;
+        return "Failed to allocate image buffer";
     }
 
     // Configure scaling, transforms, and SSL
-    image_processor_set_scaling(stored_img_width, stored_img_height, stored_img_scale);
-    image_processor_set_transform(stored_img_rotation, stored_img_mirror_h, stored_img_mirror_v, stored_img_rot_first);
-    image_processor_set_ssl_skip(stored_ssl_skip);
+    image_processor_set_scaling(show.img_width, show.img_height, show.img_scale);
+    image_processor_set_transform(show.img_rotation, show.img_mirror_h, show.img_mirror_v, show.img_rot_first);
+    image_processor_set_ssl_skip(show.ssl_skip);
+
+    panel_frame_seq = 0;  // Panel no longer shows the cached frame
+
+    // Download, then decode and dither as separate steps (through the push
+    // decoder) so each stage is reported on its own
+    jobs_stage(JOB_STAGE_DOWNLOADING);
+    ret = image_processor_fetch(show.url);
+    if (ret == ESP_OK) {
+        size_t len;
+        const uint8_t *png = image_processor_get_data(&len);
+        jobs_stage(JOB_STAGE_DECODING);
+        ret = image_processor_png_begin();
+        if (ret == ESP_OK) {
+            ret = image_processor_png_feed(png, len);
+        }
+        if (ret == ESP_OK) {
+            jobs_stage(JOB_STAGE_DITHERING);
+            ret = image_processor_png_end(image_buffer, NULL, NULL);
+        }
+    }
+    image_processor_release();
 
-    // Download and process image
-    ret = image_download_and_process(stored_image_url, image_buffer);
+    const char *err_msg = NULL;
     if (ret != ESP_OK) {
-        const char *err_msg = image_processor_get_error();
+        err_msg = image_processor_get_error();
         ESP_LOGE(TAG, "Failed to download/process image: %s", err_msg);
         set_led_color(50, 0, 0);
         error_display_show(error_display_categorize(err_msg), err_msg);
     } else {
         set_led_color(0, 50, 50);  // Cyan while displaying
-        epd_7in3e_display(image_buffer);
-        set_led_color(0, 50, 0);  // Green on success
-        ESP_LOGI(TAG, "Image displayed successfully");
+        jobs_stage(JOB_STAGE_TRANSFERRING);
+        esp_err_t disp = epd_7in3e_display_async(image_buffer);
+        jobs_stage(JOB_STAGE_REFRESHING);
+        if (disp == ESP_OK) {
+            disp = epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS);
+        }
+        if (disp == ESP_OK) {
+            set_led_color(0, 50, 0);  // Green on success
+            ESP_LOGI(TAG, "Image displayed successfully");
+        } else {
+            set_led_color(50, 0, 0);
+            err_msg = "Display refresh timed out";
+        }
     }
 
     heap_caps_free(image_buffer);
     image_processor_deinit();
     epd_7in3e_sleep();
+    return err_msg;
 }
 
 // Display action: Clear display
-static void do_clear_display(void) {
+static const char *do_clear_display(void) {
     ESP_LOGI(TAG, "Clearing display...");
     set_led_color(50, 50, 0);  // Yellow while working
 
@@ -2656,16 +3839,20 @@ static void do_clear_display(void) {
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init display hardware");
         set_led_color(50, 0, 0);
-        return;
+        return "Failed to init display hardware";
     }
     epd_7in3e_init();
 
-    // Clear to white
+    panel_frame_seq = 0;  // Panel no longer shows the cached frame
+
+    // Clear to white (transfer and refresh in one call)
+    jobs_stage(JOB_STAGE_REFRESHING);
     epd_7in3e_clear(EPD_7IN3E_WHITE);
     epd_7in3e_sleep();
 
     set_led_color(0, 50, 0);  // Green on success
     ESP_LOGI(TAG, "Display cleared");
+    return NULL;
 }
 
 // Initialize boot button
@@ -2682,36 +3869,44 @@ static void init_boot_button(void) {
     ESP_LOGI(TAG, "Boot button initialized on GPIO %d", BOOT_BUTTON_GPIO);
 }
 
-// Enter deep sleep mode for specified minutes
-static void enter_deep_sleep(uint32_t sleep_minutes) {
-    ESP_LOGI(TAG, "Preparing to enter deep sleep for %lu minutes...", (unsigned long)sleep_minutes);
+// Enter deep sleep until the next refresh (default or scheduled interval)
+static void enter_deep_sleep(void) {
+    log_cycle_summary();
+
+    ESP_LOGI(TAG, "Preparing to enter deep sleep...");
 
     // Shut down remote syslog before sleep
     syslog_remote_deinit();
 
-    // Stop LED task from overriding our LED control
-    preparing_sleep = true;
-    vTaskDelay(pdMS_TO_TICKS(LED_BLINK_INTERVAL + 50));  // Wait for LED task to notice
+    // The LED is not set up when disabled; skip the blink and its delays
+    if (led_strip != NULL) {
+        // Stop LED task from overriding our LED control
+        preparing_sleep = true;
+        vTaskDelay(pdMS_TO_TICKS(LED_BLINK_INTERVAL + 50));  // Wait for LED task to notice
+
+        // Blink blue LED briefly before sleep
+        for (int i = 0; i < 3; i++) {
+            set_led_color(0, 0, 50);  // Blue
+            vTaskDelay(pdMS_TO_TICKS(200));
+            set_led_color(0, 0, 0);   // Off
+            vTaskDelay(pdMS_TO_TICKS(200));
+        }
 
-    // Blink blue LED briefly before sleep
-    for (int i = 0; i < 3; i++) {
-        set_led_color(0, 0, 50);  // Blue
-        vTaskDelay(pdMS_TO_TICKS(200));
-        set_led_color(0, 0, 0);   // Off
-        vTaskDelay(pdMS_TO_TICKS(200));
+        // Turn off LED
+        set_led_color(0, 0, 0);
     }
 
-    // Turn off LED
-    set_led_color(0, 0, 0);
-
-    // Configure timer wake-up
-    uint64_t sleep_time_us = (uint64_t)sleep_minutes * 60 * 1000000ULL;
+    // Configure timer wake-up; computed last so the time spent refreshing
+    // does not push the wake past a schedule boundary
+    uint32_t sleep_s = get_sleep_seconds();
+    // The wake timer runs off the RTC clock, correct for its measured rate
+    uint64_t sleep_time_us = time_drift_clock_duration_us(&time_drift, (uint64_t)sleep_s * 1000000ULL);
     esp_sleep_enable_timer_wakeup(sleep_time_us);
 
     // Also configure boot button wake-up for reconfiguration
     esp_sleep_enable_ext0_wakeup(BOOT_BUTTON_GPIO, 0);  // Wake on LOW (button pressed)
 
-    ESP_LOGI(TAG, "Entering deep sleep. Will wake in %lu minutes or on button press.", (unsigned long)sleep_minutes);
+    ESP_LOGI(TAG, "Entering deep sleep. Will wake in %lu s or on button press.", (unsigned long)sleep_s);
 
     // Small delay to allow serial output to complete
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -2725,6 +3920,14 @@ static void run_webserver_loop(void) {
     webserver_mode = true;
     config_saved = false;
 
+    // Display actions run in their own task, see do_handler()
+    if (show_request_lock == NULL) {
+        show_request_lock = xSemaphoreCreateMutex();
+    }
+    if (show_request_lock == NULL || jobs_start(run_display_job) != ESP_OK) {
+        ESP_LOGW(TAG, "Display actions unavailable");
+    }
+
     server = start_webserver();
     if (server == NULL) {
         ESP_LOGE(TAG, "Failed to start webserver");
@@ -2742,6 +3945,9 @@ static void run_webserver_loop(void) {
         vTaskDelay(pdMS_TO_TICKS(1000));
 
         uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+        if (jobs_busy() || ota_upload_active) {
+            last_client_activity = current_time;  // A display action or upload counts as activity
+        }
         uint32_t idle_time = current_time - last_client_activity;
 
         // Timeout only if no client activity
@@ -2751,6 +3957,11 @@ static void run_webserver_loop(void) {
         }
     }
 
+    // Let a queued display action finish before the panel is left alone
+    if (!jobs_wait_idle(2 * EPD_BUSY_TIMEOUT_MS)) {
+        ESP_LOGW(TAG, "Display action still running, stopping anyway");
+    }
+
     // Small delay to let HTTP response complete
     vTaskDelay(pdMS_TO_TICKS(500));
     stop_webserver(server);
@@ -2758,6 +3969,530 @@ static void run_webserver_loop(void) {
     webserver_mode = false;
 }
 
+static const char *const stage_names[STAGE_COUNT] = {
+    [STAGE_BUFFERS_READY]     = "buffers ready",
+    [STAGE_PANEL_READY]       = "panel ready",
+    [STAGE_FIRST_PACKET]      = "first packet",
+    [STAGE_WIFI_CONNECTED]    = "wifi connected",
+    [STAGE_TIME_SYNCED]       = "time synced",
+    [STAGE_DOWNLOAD_STARTED]  = "download started",
+    [STAGE_DOWNLOAD_FINISHED] = "download finished",
+    [STAGE_REFRESH_STARTED]   = "refresh started",
+    [STAGE_NETWORK_DOWN]      = "network down",
+    [STAGE_REFRESH_FINISHED]  = "refresh finished",
+};
+
+// Log a wake cycle stage with its time since boot
+static void log_stage(cycle_stage_t stage) {
+    stage_ms[stage] = esp_timer_get_time() / 1000;
+    ESP_LOGI(TAG, "Stage: %s at %lld ms", stage_names[stage], (long long)stage_ms[stage]);
+}
+
+// One line with all stage timestamps of this wake, for comparing cycles
+static void log_cycle_summary(void) {
+    char line[256];
+    int len = 0;
+
+    for (int i = 0; i < STAGE_COUNT && len < (int)sizeof(line); i++) {
+        if (stage_ms[i] != 0) {
+            len += snprintf(line + len, sizeof(line) - len, "%s%s=%lld", len ? ", " : "",
+                            stage_names[i], (long long)stage_ms[i]);
+        }
+    }
+    last_first_packet_ms = (uint32_t)stage_ms[STAGE_FIRST_PACKET];
+    last_awake_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    // Only timer wakes follow the path an aligned wake takes
+    if (stage_ms[STAGE_DOWNLOAD_STARTED] != 0 &&
+        esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+        uint32_t sample = (uint32_t)stage_ms[STAGE_DOWNLOAD_STARTED];
+        if (fetch_latency_ms == 0) {
+            fetch_latency_ms = sample;
+        } else {
+            fetch_latency_ms = (3 * fetch_latency_ms + sample) / 4;  // EWMA, alpha 1/4
+        }
+    }
+
+    // Unattended wakes only: button wakes and setup are spent in the web UI
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+        int64_t radio_end = stage_ms[STAGE_NETWORK_DOWN] ? stage_ms[STAGE_NETWORK_DOWN] :
+                            stage_ms[STAGE_WIFI_CONNECTED] ? (int64_t)last_awake_ms : 0;
+        energy_wakes++;
+        energy_frames += frame_displayed ? 1 : 0;
+        energy_awake_ms += last_awake_ms;
+        energy_radio_ms += (uint64_t)radio_end;
+    }
+    ESP_LOGI(TAG, "Cycle stages (ms): %s; awake %lu ms", len ? line : "none",
+             (unsigned long)last_awake_ms);
+}
+
+// Results of display_prep_task(), valid once the matching CYCLE_*_BIT is set
+static esp_err_t prep_img_ret = ESP_OK;
+static bool prep_started = false;
+
+// Allocate the image buffers and bring up the panel. Neither depends on the
+// network, so on timer wakes this runs while WiFi associates.
+static void display_prep(void) {
+    framecache_ready = (framecache_init(IMAGE_BUFFER_SIZE) == ESP_OK);
+
+    ESP_LOGI(TAG, "Initializing image processor...");
+    prep_img_ret = image_processor_init();
+    log_stage(STAGE_BUFFERS_READY);
+    xEventGroupSetBits(s_cycle_event_group, CYCLE_BUFFERS_READY_BIT);
+
+    ESP_LOGI(TAG, "Initializing e-Paper display...");
+    if (epd_7in3e_init_hw() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize e-Paper hardware!");
+        // Continue anyway, display might still work
+    }
+    epd_7in3e_init();  // Reset, BUSY wait, power on
+    log_stage(STAGE_PANEL_READY);
+    xEventGroupSetBits(s_cycle_event_group, CYCLE_PANEL_READY_BIT);
+}
+
+static void display_prep_task(void *pvParameters) {
+    display_prep();
+    vTaskDelete(NULL);
+}
+
+// Start display preparation in the background (once per wake)
+static void start_display_prep(void) {
+    if (prep_started) {
+        return;
+    }
+    prep_started = true;
+    if (xTaskCreate(display_prep_task, "display_prep", 4096, NULL, 5, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "Failed to start display prep task, running inline");
+        display_prep();
+    }
+}
+
+// Block until the given CYCLE_*_BIT stages are done, starting them if needed
+static void wait_display_prep(EventBits_t bits) {
+    start_display_prep();
+    xEventGroupWaitBits(s_cycle_event_group, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+// On a failed download, leave the last good frame on the panel instead of
+// showing the error screen (no refresh). Once the failure persists, or the
+// panel shows other content, the cached frame is redrawn straight from flash
+// with a stale-data banner. Returns false if there is no usable cached frame
+// or the panel could not take it.
+static bool show_cached_frame_fallback(void) {
+    const framecache_meta_t *meta = framecache_ready ? framecache_current() : NULL;
+    if (meta == NULL) {
+        return false;
+    }
+
+    fetch_failures++;
+    if (panel_frame_seq == meta->seq &&
+        (panel_stale_banner || fetch_failures < FRAMECACHE_STALE_FAILURES)) {
+        ESP_LOGI(TAG, "Download failed (%lu in a row), keeping the last good frame",
+                 (unsigned long)fetch_failures);
+        return true;
+    }
+
+    const uint8_t *frame;
+    esp_partition_mmap_handle_t handle;
+    if (framecache_map(&frame, &handle) != ESP_OK) {
+        return false;
+    }
+
+    char text[48] = "Offline - showing last image";
+    if (meta->timestamp > 0) {
+        time_t ts = (time_t)meta->timestamp;
+        struct tm tm_info;
+        localtime_r(&ts, &tm_info);
+        strftime(text, sizeof(text), "Offline - image from %d.%m. %H:%M", &tm_info);
+    }
+
+    // Rows come from the flash mapping; only the banner rows are copied
+    static uint8_t row[IMAGE_ROW_BYTES];
+    if (epd_7in3e_stream_begin() != ESP_OK) {
+        framecache_unmap(handle);
+        return false;
+    }
+    for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+        const uint8_t *src = frame + y * IMAGE_ROW_BYTES;
+        if (y >= IMAGE_HEIGHT - ERROR_OVERLAY_HEIGHT) {
+            memcpy(row, src, IMAGE_ROW_BYTES);
+            error_display_overlay_row(row, y, text);
+            src = row;
+        }
+        epd_7in3e_stream_write(src, IMAGE_ROW_BYTES);
+    }
+    framecache_unmap(handle);
+    epd_7in3e_stream_end();
+
+    ESP_LOGI(TAG, "Redrawing the cached frame with a stale-data banner");
+    if (epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        panel_frame_seq = meta->seq;
+        panel_stale_banner = true;
+    }
+    return true;
+}
+
+// Image row sink: forward dithered rows to the panel as they are produced
+static void epd_row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    if (row == 0) {
+        wait_display_prep(CYCLE_PANEL_READY_BIT);
+        epd_7in3e_stream_begin();
+    }
+    epd_7in3e_stream_write(data, len);
+}
+
+// Image row sink for one panel of a multi-panel layout (ctx = panel)
+static void panel_row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    epd_7in3e_panel_t *panel = (epd_7in3e_panel_t *)ctx;
+    if (row == 0) {
+        epd_7in3e_panel_stream_begin(panel);
+    }
+    epd_7in3e_panel_stream_write(panel, data, len);
+}
+
+// Same pins as the default panel set up by epd_7in3e_init_hw()
+static bool is_default_panel_pins(const epd_transport_pins_t *pins) {
+    return pins->cs == EPD_PIN_CS && pins->dc == EPD_PIN_DC &&
+           pins->rst == EPD_PIN_RST && pins->busy == EPD_PIN_BUSY;
+}
+
+// Wake cycle for several panels: each panel's refresh is started as soon as
+// its frame is sent, so the next panel is rendered while earlier ones refresh.
+// Does not return (enters deep sleep).
+static void run_multi_panel_cycle(const panel_layout_t *layout) {
+    epd_7in3e_panel_t *panels[EPD_MAX_PANELS] = {0};
+    static char panel_url[MAX_URL_LEN];
+    const char *err_msg = NULL;
+    esp_err_t ret = ESP_OK;
+    int ready = 0;
+
+    // The default panel is initialized by display_prep(); create the others
+    // once it is done so they don't share the bus with its init sequence
+    wait_display_prep(CYCLE_PANEL_READY_BIT);
+    for (int i = 0; i < layout->count; i++) {
+        if (is_default_panel_pins(&layout->pins[i])) {
+            panels[i] = epd_7in3e_default_panel();
+            continue;
+        }
+        if (epd_7in3e_panel_create(&layout->pins[i], &panels[i]) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize panel %d", i);
+            err_msg = "Panel initialization failed";
+            break;
+        }
+        epd_7in3e_panel_init(panels[i]);
+    }
+
+    panel_frame_seq = 0;  // The frame cache only covers the single-panel path
+
+    // One URL per panel if it contains {panel}, otherwise one shared image
+    bool per_panel = panel_layout_url(stored_image_url, 0, panel_url, sizeof(panel_url));
+    log_stage(STAGE_DOWNLOAD_STARTED);
+    if (err_msg == NULL && !per_panel) {
+        ESP_LOGI(TAG, "Downloading image from: %s", panel_url);
+        ret = image_processor_fetch(panel_url);
+    }
+
+    for (int i = 0; err_msg == NULL && ret == ESP_OK && i < layout->count; i++) {
+        if (per_panel) {
+            panel_layout_url(stored_image_url, i, panel_url, sizeof(panel_url));
+            ESP_LOGI(TAG, "Downloading panel %d image from: %s", i, panel_url);
+            image_processor_set_region(0, 0, 0, 0);
+            ret = image_processor_fetch(panel_url);
+        } else {
+            uint16_t canvas_w, canvas_h, x, y;
+            panel_layout_region(layout, i, &canvas_w, &canvas_h, &x, &y);
+            image_processor_set_region(canvas_w, canvas_h, x, y);
+        }
+        if (ret == ESP_OK) {
+            ret = image_processor_render(NULL, panel_row_sink, panels[i]);
+        }
+        if (ret == ESP_OK) {
+            epd_7in3e_panel_stream_end(panels[i]);
+            ready++;
+        }
+    }
+    log_stage(STAGE_DOWNLOAD_FINISHED);
+
+    if (err_msg == NULL && ret != ESP_OK) {
+        err_msg = image_processor_get_error();
+        ESP_LOGE(TAG, "Failed to download/process image: %s", err_msg);
+    }
+    if (err_msg != NULL) {
+        set_led_color(50, 0, 0);  // Red on error
+    } else {
+        set_led_color(0, 50, 50);  // Cyan while displaying
+    }
+    ESP_LOGI(TAG, "%d of %d panels refreshing", ready, layout->count);
+    image_processor_deinit();
+
+    finish_time_sync();
+    syslog_remote_deinit();
+    wifi_deinit();
+    for (int i = 0; i < layout->count && panels[i] != NULL; i++) {
+        epd_7in3e_panel_set_light_sleep(panels[i], true);
+    }
+    log_stage(STAGE_NETWORK_DOWN);
+
+    if (ready > 0 &&
+        epd_7in3e_panel_wait_idle_all(panels, ready, EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        ESP_LOGI(TAG, "Image displayed on %d panels", ready);
+        frame_displayed = true;
+    }
+    if (err_msg != NULL) {
+        // The first panel shows the error screen
+        ESP_LOGI(TAG, "Displaying error screen");
+        error_display_show(error_display_categorize(err_msg), err_msg);
+    }
+    log_stage(STAGE_REFRESH_FINISHED);
+
+    for (int i = 0; i < layout->count && panels[i] != NULL; i++) {
+        epd_7in3e_panel_sleep(panels[i]);
+    }
+    enter_deep_sleep();
+}
+
+// Hash of the settings that change dithered frames; stored slides and tiles
+// made with other settings are not reused
+static uint32_t render_key(void) {
+    uint32_t h = PLAYLIST_HASH_INIT;
+    uint32_t buffer_size = IMAGE_BUFFER_SIZE;
+    uint8_t flags[4] = { stored_img_scale, stored_img_mirror_h, stored_img_mirror_v,
+                         stored_img_rot_first };
+
+    h = playlist_hash(&stored_img_width, sizeof(stored_img_width), h);
+    h = playlist_hash(&stored_img_height, sizeof(stored_img_height), h);
+    h = playlist_hash(&stored_img_rotation, sizeof(stored_img_rotation), h);
+    h = playlist_hash(flags, sizeof(flags), h);
+    return playlist_hash(&buffer_size, sizeof(buffer_size), h);
+}
+
+// Show the next stored slide and sleep; returns only if none could be shown
+static void show_slide_and_sleep(void) {
+    set_led_color(0, 50, 50);  // Cyan while displaying
+    esp_err_t ret = slides_show_next(epd_row_sink, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No stored slide shown: %s", slides_get_error());
+        return;
+    }
+    epd_7in3e_stream_end();
+    log_stage(STAGE_REFRESH_STARTED);
+    epd_7in3e_set_light_sleep(true);
+
+    if (epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        ESP_LOGI(TAG, "Slide displayed successfully");
+        frame_displayed = true;
+    }
+    panel_frame_seq = 0;  // The frame cache only covers the single-image path
+    log_stage(STAGE_REFRESH_FINISHED);
+    image_processor_deinit();
+    epd_7in3e_sleep();
+    enter_deep_sleep();
+}
+
+// Wake cycle in playlist mode: check the manifest, fetch new frames over one
+// connection, go offline and show the next slide. Does not return.
+static void run_playlist_cycle(void) {
+    static char err_msg[128];
+
+    err_msg[0] = '\0';
+    if (!slides_ready) {
+        slides_ready = (slides_init(render_key()) == ESP_OK);
+    }
+    log_stage(STAGE_DOWNLOAD_STARTED);
+    if (!slides_ready || slides_sync(stored_image_url) != ESP_OK) {
+        strncpy(err_msg, slides_get_error(), sizeof(err_msg) - 1);
+        ESP_LOGE(TAG, "Playlist sync failed: %s", err_msg);
+    }
+    log_stage(STAGE_DOWNLOAD_FINISHED);
+    image_processor_deinit();
+
+    finish_time_sync();
+    syslog_remote_deinit();
+    wifi_deinit();
+    log_stage(STAGE_NETWORK_DOWN);
+
+    wait_display_prep(CYCLE_PANEL_READY_BIT);
+    if (slides_ready) {
+        show_slide_and_sleep();
+    }
+
+    // Nothing stored to show
+    set_led_color(50, 0, 0);  // Red on error
+    if (err_msg[0] == '\0') {
+        strncpy(err_msg, slides_get_error(), sizeof(err_msg) - 1);
+    }
+    ESP_LOGI(TAG, "Displaying error screen");
+    error_display_show(error_display_categorize(err_msg), err_msg);
+    panel_frame_seq = 0;
+    log_stage(STAGE_REFRESH_FINISHED);
+    epd_7in3e_sleep();
+    enter_deep_sleep();
+}
+
+// Wake cycle for a composite dashboard: fetch the tiles (only changed ones
+// are downloaded and redrawn), then refresh the panel if the frame changed.
+// Does not return (enters deep sleep).
+static void run_tile_cycle(void) {
+    const char *err_msg = NULL;
+    bool changed = true;
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    uint8_t *frame = heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+    tiles_set_ssl_skip(stored_ssl_skip);
+    log_stage(STAGE_DOWNLOAD_STARTED);
+    if (frame != NULL) {
+        ret = tiles_update(stored_tile_layout, stored_image_url, render_key(), frame, &changed);
+    }
+    log_stage(STAGE_DOWNLOAD_FINISHED);
+    image_processor_deinit();
+    wait_display_prep(CYCLE_PANEL_READY_BIT);
+
+    // Nothing changed and the panel still shows the cached frame: no refresh
+    const framecache_meta_t *meta = framecache_ready ? framecache_current() : NULL;
+    bool on_panel = meta != NULL && panel_frame_seq == meta->seq && !panel_stale_banner;
+    bool refresh = (ret == ESP_OK) && (changed || !on_panel);
+
+    if (ret != ESP_OK) {
+        err_msg = (frame != NULL) ? tiles_get_error() : "Failed to allocate frame buffer";
+        ESP_LOGE(TAG, "Failed to compose tiles: %s", err_msg);
+        set_led_color(50, 0, 0);  // Red on error
+    } else if (refresh) {
+        set_led_color(0, 50, 50);  // Cyan while displaying
+        for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+            epd_row_sink(y, frame + y * IMAGE_ROW_BYTES, IMAGE_ROW_BYTES, NULL);
+        }
+        epd_7in3e_stream_end();
+        log_stage(STAGE_REFRESH_STARTED);
+    } else {
+        ESP_LOGI(TAG, "No tile changed, the panel keeps its frame");
+        fetch_failures = 0;
+    }
+
+    finish_time_sync();
+    syslog_remote_deinit();
+    wifi_deinit();
+    epd_7in3e_set_light_sleep(true);
+    log_stage(STAGE_NETWORK_DOWN);
+
+    // The composed frame is the base for the next update's unchanged tiles
+    if (ret == ESP_OK && changed) {
+        uint32_t frame_crc = 0;
+        if (framecache_ready &&
+            framecache_store(frame, stored_image_url, "", clock_is_set() ? (int64_t)time(NULL) : 0) == ESP_OK) {
+            frame_crc = framecache_current()->frame_crc;
+        }
+        tiles_commit(frame_crc);
+    }
+    heap_caps_free(frame);
+
+    if (err_msg != NULL) {
+        if (!show_cached_frame_fallback()) {
+            ESP_LOGI(TAG, "Displaying error screen");
+            error_display_show(error_display_categorize(err_msg), err_msg);
+            panel_frame_seq = 0;
+        }
+    } else if (refresh && epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        ESP_LOGI(TAG, "Dashboard displayed successfully");
+        frame_displayed = true;
+        meta = framecache_ready ? framecache_current() : NULL;
+        panel_frame_seq = meta ? meta->seq : 0;
+        panel_stale_banner = false;
+        fetch_failures = 0;
+    }
+    log_stage(STAGE_REFRESH_FINISHED);
+
+    epd_7in3e_sleep();
+    enter_deep_sleep();
+}
+
+// Wake cycle in widget mode: fetch the JSON data, draw it with the stored
+// template and refresh the panel if the frame changed. Does not return.
+static void run_widget_cycle(void) {
+    static char err_buf[96];
+    const char *err_msg = NULL;
+
+    char *tmpl = heap_caps_malloc(MAX_WIDGET_TEMPLATE_LEN, MALLOC_CAP_SPIRAM);
+    uint8_t *frame = heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+    log_stage(STAGE_DOWNLOAD_STARTED);
+    int64_t fetch_us = esp_timer_get_time();
+    if (tmpl == NULL || frame == NULL) {
+        err_msg = "Failed to allocate frame buffer";
+    } else if (!load_widget_template(tmpl, MAX_WIDGET_TEMPLATE_LEN)) {
+        err_msg = "No widget template stored";
+    } else if (image_processor_fetch(stored_image_url) != ESP_OK) {
+        err_msg = image_processor_get_error();
+    } else {
+        size_t len;
+        const char *data = (const char *)image_processor_get_data(&len);
+        int64_t render_us = esp_timer_get_time();
+        if (widgets_render(tmpl, data, len, frame, err_buf, sizeof(err_buf))) {
+            widget_cost.bytes = len;
+            widget_cost.fetch_ms = (uint32_t)((render_us - fetch_us) / 1000);
+            widget_cost.render_ms = (uint32_t)((esp_timer_get_time() - render_us) / 1000);
+            ESP_LOGI(TAG, "Widgets drawn from %u bytes in %lu ms", (unsigned)len,
+                     (unsigned long)widget_cost.render_ms);
+        } else {
+            err_msg = err_buf;
+        }
+    }
+    log_stage(STAGE_DOWNLOAD_FINISHED);
+    heap_caps_free(tmpl);
+    image_processor_deinit();
+    wait_display_prep(CYCLE_PANEL_READY_BIT);
+
+    // Same frame as the cached one and still on the panel: no refresh
+    uint32_t frame_crc = (err_msg == NULL) ? esp_rom_crc32_le(0, frame, IMAGE_BUFFER_SIZE) : 0;
+    const framecache_meta_t *meta = framecache_ready ? framecache_current() : NULL;
+    bool changed = meta == NULL || meta->frame_crc != frame_crc;
+    bool on_panel = meta != NULL && panel_frame_seq == meta->seq && !panel_stale_banner;
+    bool refresh = (err_msg == NULL) && (changed || !on_panel);
+
+    if (err_msg != NULL) {
+        ESP_LOGE(TAG, "Failed to draw widgets: %s", err_msg);
+        set_led_color(50, 0, 0);  // Red on error
+    } else if (refresh) {
+        set_led_color(0, 50, 50);  // Cyan while displaying
+        for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+            epd_row_sink(y, frame + y * IMAGE_ROW_BYTES, IMAGE_ROW_BYTES, NULL);
+        }
+        epd_7in3e_stream_end();
+        log_stage(STAGE_REFRESH_STARTED);
+    } else {
+        ESP_LOGI(TAG, "Widgets unchanged, the panel keeps its frame");
+        fetch_failures = 0;
+    }
+
+    finish_time_sync();
+    syslog_remote_deinit();
+    wifi_deinit();
+    epd_7in3e_set_light_sleep(true);
+    log_stage(STAGE_NETWORK_DOWN);
+
+    if (err_msg == NULL && changed && framecache_ready) {
+        framecache_store(frame, stored_image_url, "", clock_is_set() ? (int64_t)time(NULL) : 0);
+    }
+    heap_caps_free(frame);
+
+    if (err_msg != NULL) {
+        if (!show_cached_frame_fallback()) {
+            ESP_LOGI(TAG, "Displaying error screen");
+            error_display_show(error_display_categorize(err_msg), err_msg);
+            panel_frame_seq = 0;
+        }
+    } else if (refresh && epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        ESP_LOGI(TAG, "Widgets displayed successfully");
+        frame_displayed = true;
+        meta = framecache_ready ? framecache_current() : NULL;
+        panel_frame_seq = meta ? meta->seq : 0;
+        panel_stale_banner = false;
+        fetch_failures = 0;
+    }
+    log_stage(STAGE_REFRESH_FINISHED);
+
+    epd_7in3e_sleep();
+    enter_deep_sleep();
+}
+
 // Main application
 void app_main(void) {
     ESP_LOGI(TAG, "=== ESP32-S3 Display Starting ===");
@@ -2790,24 +4525,44 @@ void app_main(void) {
     // Initialize NVS
     init_nvs();
 
-    // Load configuration from NVS
-    load_config_from_nvs();
+    // Load configuration (timer wakes reuse the copy kept in RTC memory)
+    load_config(woke_from_timer);
 
-    // Initialize LED
-    init_led();
+    // Initialize LED and its blink task only if the LED is used
+    if (!stored_led_disabled) {
+        init_led();
+        xTaskCreate(led_task, "led_task", 2048, NULL, 5, NULL);
+    }
 
     // Initialize boot button
     init_boot_button();
 
-    // Start LED task
-    xTaskCreate(led_task, "led_task", 2048, NULL, 5, NULL);
-
     // Initialize WiFi network interfaces
     wifi_init_netif();
 
     // Determine if we need webserver mode
     bool need_webserver = woke_from_button || (strlen(stored_image_url) == 0);
 
+    // A normal wake goes on to refresh the display: prepare buffers and panel
+    // while WiFi connects. The download waits for the buffers, the first
+    // output row for the panel (see epd_row_sink).
+    s_cycle_event_group = xEventGroupCreate();
+    if (!need_webserver && has_wifi_credentials()) {
+        start_display_prep();
+
+        // Playlist mode: wakes between manifest checks show the next stored
+        // slide without starting WiFi
+        panel_layout_t early_layout;
+        panel_layout_parse(stored_panel_layout, &early_layout);
+        if (stored_playlist && early_layout.count == 1) {
+            slides_ready = (slides_init(render_key()) == ESP_OK);
+            if (slides_ready && !slides_sync_due(stored_playlist_check)) {
+                ESP_LOGI(TAG, "Playlist: showing the next stored slide offline");
+                show_slide_and_sleep();  // Returns only on failure: go online
+            }
+        }
+    }
+
     // WiFi connection strategy:
     // 1. If we have credentials, try STA mode with timeout
     // 2. If STA fails or no credentials, switch to AP mode
@@ -2887,6 +4642,7 @@ void app_main(void) {
     }
 
     ESP_LOGI(TAG, "WiFi connected!");
+    log_stage(STAGE_WIFI_CONNECTED);
 
     // Initialize remote syslog if configured
     if (stored_syslog_enabled && stored_syslog_host[0] != '\0') {
@@ -2895,14 +4651,9 @@ void app_main(void) {
                            (syslog_transport_t)stored_syslog_transport);
     }
 
-    // Wait for NTP sync if NTP server is configured (60 second timeout)
-    // This ensures time is accurate before downloading images
-    if (strlen(stored_ntp_server) > 0) {
-        ESP_LOGI(TAG, "Waiting for time synchronization...");
-        if (!wait_for_ntp_sync(60)) {
-            ESP_LOGW(TAG, "Time sync failed or timed out, continuing anyway");
-        }
-    }
+    // Sync the clock if it is unset or has drifted too far; the webserver
+    // always syncs so the time shown in the UI is fresh
+    start_time_sync(need_webserver);
 
     // If woke from button or need webserver, run it in STA mode
     if (need_webserver && !config_saved) {
@@ -2928,71 +4679,123 @@ void app_main(void) {
     ESP_LOGI(TAG, "  Image URL: %s", stored_image_url);
     ESP_LOGI(TAG, "  Refresh interval: %lu minutes", (unsigned long)stored_refresh_interval);
 
-    // Initialize e-Paper display hardware
-    ESP_LOGI(TAG, "Initializing e-Paper display...");
-    esp_err_t epd_ret = epd_7in3e_init_hw();
-    if (epd_ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize e-Paper hardware!");
-        // Continue anyway, display might still work
-    }
-
-    // Initialize e-Paper controller
-    epd_7in3e_init();
-
-    // Initialize image processor
-    ESP_LOGI(TAG, "Initializing image processor...");
-    esp_err_t img_ret = image_processor_init();
+    // Image processor buffers (usually allocated while WiFi connected)
+    wait_display_prep(CYCLE_BUFFERS_READY_BIT);
+    esp_err_t img_ret = prep_img_ret;
     if (img_ret != ESP_OK) {
         const char *err_msg = image_processor_get_error();
         ESP_LOGE(TAG, "Failed to initialize image processor: %s", err_msg);
-        ESP_LOGI(TAG, "Displaying error screen");
-        error_display_show(error_display_categorize(err_msg), err_msg);
-        epd_7in3e_sleep();
-        enter_deep_sleep(get_effective_refresh_interval());
-    }
-
-    // Allocate buffer for processed image in PSRAM
-    uint8_t *image_buffer = heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
-    if (image_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate image buffer in PSRAM");
-        ESP_LOGI(TAG, "Displaying error screen");
-        error_display_show(ERROR_TYPE_INIT, "Failed to allocate image buffer in PSRAM");
-        image_processor_deinit();
+        wait_display_prep(CYCLE_PANEL_READY_BIT);
+        if (!show_cached_frame_fallback()) {
+            ESP_LOGI(TAG, "Displaying error screen");
+            error_display_show(error_display_categorize(err_msg), err_msg);
+            panel_frame_seq = 0;
+        }
         epd_7in3e_sleep();
-        enter_deep_sleep(get_effective_refresh_interval());
+        finish_time_sync();
+        enter_deep_sleep();
     }
 
     // Configure scaling, transforms, SSL, and download image
     image_processor_set_scaling(stored_img_width, stored_img_height, stored_img_scale);
     image_processor_set_transform(stored_img_rotation, stored_img_mirror_h, stored_img_mirror_v, stored_img_rot_first);
     image_processor_set_ssl_skip(stored_ssl_skip);
+
+    panel_layout_t layout;
+    panel_layout_parse(stored_panel_layout, &layout);  // Falls back to one panel
+    if (layout.count > 1) {
+        set_led_color(0, 0, 50);  // Blue while downloading
+        run_multi_panel_cycle(&layout);
+    }
+    if (stored_playlist) {
+        set_led_color(0, 0, 50);  // Blue while downloading
+        run_playlist_cycle();
+    }
+    if (stored_tile_layout[0] != '\0') {
+        set_led_color(0, 0, 50);  // Blue while downloading
+        run_tile_cycle();
+    }
+    if (stored_widgets) {
+        set_led_color(0, 0, 50);  // Blue while downloading
+        run_widget_cycle();
+    }
+
     ESP_LOGI(TAG, "Downloading image from: %s", stored_image_url);
     set_led_color(0, 0, 50);  // Blue while downloading
 
-    img_ret = image_download_and_process(stored_image_url, image_buffer);
+    // Dithered rows go straight to the panel; no frame buffer is needed
+    // unless the transform breaks raster order (handled internally). A copy
+    // is kept for the frame cache, written while the panel refreshes.
+    uint8_t *frame_copy = framecache_ready ? heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM) : NULL;
+    log_stage(STAGE_DOWNLOAD_STARTED);
+    int64_t fetch_us = esp_timer_get_time();
+    img_ret = image_processor_fetch(stored_image_url);
+    if (img_ret == ESP_OK) {
+        size_t png_len;
+        int64_t render_us = esp_timer_get_time();
+        image_processor_get_data(&png_len);
+        img_ret = image_processor_render(frame_copy, epd_row_sink, NULL);
+        if (img_ret == ESP_OK) {
+            png_cost.bytes = png_len;
+            png_cost.fetch_ms = (uint32_t)((render_us - fetch_us) / 1000);
+            png_cost.render_ms = (uint32_t)((esp_timer_get_time() - render_us) / 1000);
+        }
+    }
+    image_processor_release();
+    log_stage(STAGE_DOWNLOAD_FINISHED);
+    wait_display_prep(CYCLE_PANEL_READY_BIT);  // Error screen and sleep need the panel too
+
+    const char *err_msg = NULL;
     if (img_ret != ESP_OK) {
-        const char *err_msg = image_processor_get_error();
+        err_msg = image_processor_get_error();
         ESP_LOGE(TAG, "Failed to download/process image: %s", err_msg);
-        ESP_LOGI(TAG, "Displaying error screen");
         set_led_color(50, 0, 0);  // Red on error
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        error_display_show(error_display_categorize(err_msg), err_msg);
     } else {
         ESP_LOGI(TAG, "Image processed successfully, displaying...");
         set_led_color(0, 50, 50);  // Cyan while displaying
 
-        // Display the processed image
-        epd_7in3e_display(image_buffer);
-        ESP_LOGI(TAG, "Image displayed successfully");
+        // Start the refresh; the panel takes ~20-30 s on its own,
+        // so tear everything else down in the meantime
+        epd_7in3e_stream_end();
+        log_stage(STAGE_REFRESH_STARTED);
     }
 
-    // Clean up
-    heap_caps_free(image_buffer);
+    // The frame has been transferred, the processor buffers are no longer needed
     image_processor_deinit();
 
+    // Network work for this cycle is done: stop WiFi so the panel refresh
+    // can be spent in light sleep instead of polling BUSY with the radio on
+    finish_time_sync();
+    syslog_remote_deinit();
+    wifi_deinit();
+    epd_7in3e_set_light_sleep(true);
+    log_stage(STAGE_NETWORK_DOWN);
+
+    bool frame_cached = false;
+    if (err_msg == NULL && frame_copy != NULL) {
+        frame_cached = framecache_store(frame_copy, stored_image_url, image_processor_get_etag(),
+                                        clock_is_set() ? (int64_t)time(NULL) : 0) == ESP_OK;
+    }
+    heap_caps_free(frame_copy);
+
+    if (err_msg != NULL) {
+        if (!show_cached_frame_fallback()) {
+            ESP_LOGI(TAG, "Displaying error screen");
+            error_display_show(error_display_categorize(err_msg), err_msg);
+            panel_frame_seq = 0;
+        }
+    } else if (epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS) == ESP_OK) {
+        ESP_LOGI(TAG, "Image displayed successfully");
+        frame_displayed = true;
+        panel_frame_seq = frame_cached ? framecache_current()->seq : 0;
+        panel_stale_banner = false;
+        fetch_failures = 0;
+    }
+    log_stage(STAGE_REFRESH_FINISHED);
+
     // Put display to sleep before MCU deep sleep
     epd_7in3e_sleep();
 
-    // Enter deep sleep for the configured/scheduled interval
-    enter_deep_sleep(get_effective_refresh_interval());
+    // Enter deep sleep until the next configured/scheduled refresh
+    enter_deep_sleep();
 }
\ No newline at end of file
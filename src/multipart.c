@@ -0,0 +1,305 @@
+/**
+ * @file multipart.c
+ * @brief Streaming multipart/form-data parser for request bodies
+ *
+ * The body is scanned for the delimiter "\r\n--boundary"; the start of the
+ * body counts as a preceding CRLF, so the first boundary needs none. Since
+ * a boundary has no CR, '\r' only occurs at the start of the delimiter: on
+ * a mismatch the held-back bytes are plain data and the mismatching byte
+ * can only start a new match if it is '\r'. Runs without '\r' are passed
+ * on in one piece.
+ */
+
+#include "multipart.h"
+#include <string.h>
+#include <strings.h>
+
+enum {
+    ST_PREAMBLE,    // Before the first boundary, discarded
+    ST_HEADERS,
+    ST_BODY,
+    ST_EPILOGUE,    // After the closing boundary, discarded
+};
+
+// Progress after a full delimiter
+enum {
+    TAIL_NONE,
+    TAIL_START,     // Right after the boundary
+    TAIL_DASH,      // One '-' of the closing "--"
+    TAIL_SPACE,     // Transport padding (spaces, tabs)
+    TAIL_CR,
+};
+
+// Record an error; returns false
+static bool fail(multipart_t *mp, const char *msg) {
+    if (mp->error == NULL) {
+        mp->error = msg;
+    }
+    return false;
+}
+
+// Pass on part data (dropped outside a part body)
+static bool emit(multipart_t *mp, const uint8_t *data, size_t len) {
+    if (mp->state != ST_BODY || len == 0) {
+        return true;
+    }
+    if (!mp->cb(MULTIPART_DATA, data, len, mp->ctx)) {
+        return fail(mp, "stopped");
+    }
+    return true;
+}
+
+bool multipart_init(multipart_t *mp, const char *content_type, multipart_cb_t cb, void *ctx) {
+    memset(mp, 0, sizeof(*mp));
+    mp->cb = cb;
+    mp->ctx = ctx;
+
+    if (content_type == NULL || strncasecmp(content_type, "multipart/", 10) != 0) {
+        return fail(mp, "not multipart");
+    }
+
+    // Find the boundary parameter (quoted or not)
+    const char *p = content_type;
+    const char *boundary = NULL;
+    while ((p = strchr(p, ';')) != NULL) {
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncasecmp(p, "boundary=", 9) == 0) {
+            boundary = p + 9;
+            break;
+        }
+    }
+    if (boundary == NULL) {
+        return fail(mp, "no boundary");
+    }
+
+    size_t len;
+    if (*boundary == '"') {
+        boundary++;
+        const char *end = strchr(boundary, '"');
+        if (end == NULL) {
+            return fail(mp, "invalid boundary");
+        }
+        len = end - boundary;
+    } else {
+        len = strcspn(boundary, "; \t");
+    }
+    if (len == 0 || len > MULTIPART_BOUNDARY_MAX) {
+        return fail(mp, "invalid boundary");
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (boundary[i] == '\r' || boundary[i] == '\n') {
+            return fail(mp, "invalid boundary");
+        }
+    }
+
+    memcpy(mp->delim, "\r\n--", 4);
+    memcpy(mp->delim + 4, boundary, len);
+    mp->delim_len = 4 + len;
+    mp->delim[mp->delim_len] = '\0';
+    mp->state = ST_PREAMBLE;
+    mp->match = 2;  // The start of the body counts as CRLF
+    return true;
+}
+
+// The delimiter and what followed it turned out to be data after all
+static bool tail_mismatch(multipart_t *mp) {
+    mp->tail = TAIL_NONE;
+    if (!emit(mp, (const uint8_t *)mp->delim, mp->delim_len)) {
+        return false;
+    }
+    return emit(mp, mp->tail_buf, mp->tail_len);
+}
+
+// A delimiter line is complete: end the current part
+static bool end_part(multipart_t *mp) {
+    mp->tail = TAIL_NONE;
+    if (mp->state == ST_BODY) {
+        if (!mp->cb(MULTIPART_PART_END, NULL, 0, mp->ctx)) {
+            return fail(mp, "stopped");
+        }
+    }
+    return true;
+}
+
+// Look at one byte after a full delimiter. Returns false on error; *used is
+// false if the byte must be looked at again as data
+static bool tail_byte(multipart_t *mp, uint8_t c, bool *used) {
+    *used = true;
+    switch (mp->tail) {
+    case TAIL_START:
+        if (c == '-') {
+            mp->tail = TAIL_DASH;
+        } else if (c == ' ' || c == '\t') {
+            mp->tail = TAIL_SPACE;
+        } else if (c == '\r') {
+            mp->tail = TAIL_CR;
+        } else {
+            *used = false;
+            return tail_mismatch(mp);
+        }
+        break;
+    case TAIL_DASH:
+        if (c != '-') {
+            *used = false;
+            return tail_mismatch(mp);
+        }
+        if (!end_part(mp)) {
+            return false;
+        }
+        mp->state = ST_EPILOGUE;
+        return true;
+    case TAIL_SPACE:
+        if (c == '\r') {
+            mp->tail = TAIL_CR;
+        } else if (c != ' ' && c != '\t') {
+            *used = false;
+            return tail_mismatch(mp);
+        }
+        break;
+    case TAIL_CR:
+        if (c != '\n') {
+            *used = false;
+            return tail_mismatch(mp);
+        }
+        if (!end_part(mp)) {
+            return false;
+        }
+        mp->state = ST_HEADERS;
+        mp->line_len = 0;
+        mp->header_bytes = 0;
+        mp->disposition[0] = '\0';
+        return true;
+    }
+    if (mp->tail_len == sizeof(mp->tail_buf)) {
+        *used = false;  // Too much padding for a delimiter line
+        return tail_mismatch(mp);
+    }
+    mp->tail_buf[mp->tail_len++] = c;
+    return true;
+}
+
+// Handle one complete header line (without CRLF)
+static bool header_line(multipart_t *mp) {
+    if (mp->line_len == 0) {
+        mp->state = ST_BODY;
+        mp->match = 0;
+        mp->parts++;
+        if (!mp->cb(MULTIPART_PART_BEGIN, (const uint8_t *)mp->disposition,
+                    strlen(mp->disposition), mp->ctx)) {
+            return fail(mp, "stopped");
+        }
+        return true;
+    }
+    mp->line[mp->line_len] = '\0';
+    if (strncasecmp(mp->line, "Content-Disposition:", 20) == 0) {
+        const char *v = mp->line + 20;
+        while (*v == ' ' || *v == '\t') v++;
+        strncpy(mp->disposition, v, sizeof(mp->disposition) - 1);
+        mp->disposition[sizeof(mp->disposition) - 1] = '\0';
+    }
+    mp->line_len = 0;
+    return true;
+}
+
+bool multipart_feed(multipart_t *mp, const uint8_t *data, size_t len) {
+    if (mp->error) {
+        return false;
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        uint8_t c = data[i];
+
+        if (mp->state == ST_EPILOGUE) {
+            i = len;
+            break;
+        }
+
+        if (mp->state == ST_HEADERS) {
+            if (++mp->header_bytes > MULTIPART_HEADERS_MAX) {
+                mp->offset += i;
+                return fail(mp, "part headers too long");
+            }
+            i++;
+            if (c == '\n') {
+                if (mp->line_len > 0 && mp->line[mp->line_len - 1] == '\r') {
+                    mp->line_len--;
+                }
+                if (!header_line(mp)) {
+                    mp->offset += i;
+                    return false;
+                }
+            } else if (mp->line_len < sizeof(mp->line) - 1) {
+                mp->line[mp->line_len++] = c;
+            }
+            continue;
+        }
+
+        // Preamble or body: look for the delimiter
+        if (mp->tail != TAIL_NONE) {
+            bool used;
+            if (!tail_byte(mp, c, &used)) {
+                mp->offset += i;
+                return false;
+            }
+            if (used) {
+                i++;
+            }
+        } else if (mp->match == 0) {
+            const uint8_t *cr = memchr(data + i, '\r', len - i);
+            size_t run = cr ? (size_t)(cr - (data + i)) : len - i;
+            if (run > 0) {
+                if (!emit(mp, data + i, run)) {
+                    mp->offset += i;
+                    return false;
+                }
+                i += run;
+            } else {
+                mp->match = 1;
+                i++;
+            }
+        } else if (c == (uint8_t)mp->delim[mp->match]) {
+            i++;
+            if (++mp->match == mp->delim_len) {
+                mp->match = 0;
+                mp->tail = TAIL_START;
+                mp->tail_len = 0;
+            }
+        } else {
+            // Held-back bytes were data; look at this byte again
+            size_t held = mp->match;
+            mp->match = 0;
+            if (!emit(mp, (const uint8_t *)mp->delim, held)) {
+                mp->offset += i;
+                return false;
+            }
+        }
+    }
+    mp->offset += len;
+    return true;
+}
+
+bool multipart_finish(multipart_t *mp) {
+    if (mp->error) {
+        return false;
+    }
+    if (mp->state != ST_EPILOGUE) {
+        // Pass on what was held back, so the truncated part is complete
+        if (mp->tail != TAIL_NONE) {
+            tail_mismatch(mp);
+        } else {
+            emit(mp, (const uint8_t *)mp->delim, mp->match);
+        }
+        return fail(mp, mp->parts == 0 ? "no parts" : "body incomplete");
+    }
+    return true;
+}
+
+const char *multipart_error(const multipart_t *mp) {
+    return mp->error;
+}
+
+size_t multipart_offset(const multipart_t *mp) {
+    return mp->offset;
+}
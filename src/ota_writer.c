@@ -0,0 +1,308 @@
+/**
+ * @file ota_writer.c
+ * @brief Pipelined flash writer for firmware uploads
+ *
+ * Two queues carry buffer indices: free buffers go to the receiver, filled
+ * ones (with their length) to the writer task. A length of 0 tells the
+ * writer to stop; it then signals s_done and exits.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_ota_ops.h"
+#include "ota_writer.h"
+
+static const char *TAG = "OTA_WRITER";
+
+#define OTA_WRITER_TASK_STACK 4096
+
+// A filled buffer
+typedef struct {
+    int index;
+    size_t len;     // 0 = stop
+} ota_item_t;
+
+// Module state
+static uint8_t *s_buffers[OTA_WRITER_BUFFERS];
+static QueueHandle_t s_free = NULL;     // Indices of empty buffers
+static QueueHandle_t s_full = NULL;     // Filled buffers, in order
+static SemaphoreHandle_t s_done = NULL; // Given by the writer task when it exits
+static SemaphoreHandle_t s_lock = NULL; // Protects s_status
+static const esp_partition_t *s_partition = NULL;
+static esp_ota_handle_t s_handle;
+static bool s_began = false;            // esp_ota_begin() succeeded
+static volatile bool s_failed = false;  // Writer hit an error, receiver should stop
+static esp_err_t s_write_err = ESP_OK;  // Read after s_done
+static int s_fill = -1;                 // Buffer being filled by the receiver
+static size_t s_fill_len = 0;
+static int64_t s_start_us = 0;
+static ota_writer_status_t s_status;
+
+static const char *const state_names[] = {
+    [OTA_WRITER_IDLE]      = "idle",
+    [OTA_WRITER_RECEIVING] = "receiving",
+    [OTA_WRITER_VERIFYING] = "verifying",
+    [OTA_WRITER_DONE]      = "done",
+    [OTA_WRITER_FAILED]    = "failed",
+};
+
+// Add to a status counter
+static void status_add(uint32_t *field, uint32_t value) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *field += value;
+    xSemaphoreGive(s_lock);
+}
+
+// Set the final state and error message
+static void status_finish(ota_writer_state_t state, const char *error) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_status.state = state;
+    s_status.elapsed_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+    if (error != NULL) {
+        strncpy(s_status.error, error, OTA_WRITER_ERROR_LEN - 1);
+        s_status.error[OTA_WRITER_ERROR_LEN - 1] = '\0';
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// Writer task: erase the image range, then write buffers as they arrive
+static void writer_task(void *arg) {
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = esp_ota_begin(s_partition, s_status.image_size, &s_handle);
+    status_add(&s_status.erase_ms, (uint32_t)((esp_timer_get_time() - t0) / 1000));
+    if (err == ESP_OK) {
+        s_began = true;
+        ESP_LOGI(TAG, "Erased %lu bytes in %lu ms", (unsigned long)s_status.image_size,
+                 (unsigned long)s_status.erase_ms);
+    } else {
+        ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(err));
+        s_failed = true;
+    }
+
+    ota_item_t item;
+    while (1) {
+        xQueueReceive(s_full, &item, portMAX_DELAY);
+        if (item.len == 0) {
+            break;
+        }
+        // After an error keep taking buffers so the receiver never blocks
+        if (err == ESP_OK) {
+            t0 = esp_timer_get_time();
+            err = esp_ota_write(s_handle, s_buffers[item.index], item.len);
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            s_status.write_ms += ms;
+            if (err == ESP_OK) {
+                s_status.written += item.len;
+            }
+            xSemaphoreGive(s_lock);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "esp_ota_write failed (%s)", esp_err_to_name(err));
+                s_failed = true;
+            }
+        }
+        xQueueSend(s_free, &item.index, portMAX_DELAY);
+    }
+
+    s_write_err = err;
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+// Free the ring and queues
+static void cleanup(void) {
+    for (int i = 0; i < OTA_WRITER_BUFFERS; i++) {
+        free(s_buffers[i]);
+        s_buffers[i] = NULL;
+    }
+    if (s_free) vQueueDelete(s_free);
+    if (s_full) vQueueDelete(s_full);
+    if (s_done) vSemaphoreDelete(s_done);
+    s_free = NULL;
+    s_full = NULL;
+    s_done = NULL;
+    s_partition = NULL;
+}
+
+esp_err_t ota_writer_begin(const esp_partition_t *partition, size_t image_size) {
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_partition != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (partition == NULL || image_size == 0 || image_size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Internal RAM: the flash driver would copy PSRAM data through a bounce buffer
+    for (int i = 0; i < OTA_WRITER_BUFFERS; i++) {
+        s_buffers[i] = heap_caps_malloc(OTA_WRITER_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    s_free = xQueueCreate(OTA_WRITER_BUFFERS, sizeof(int));
+    s_full = xQueueCreate(OTA_WRITER_BUFFERS + 1, sizeof(ota_item_t));  // + stop item
+    s_done = xSemaphoreCreateBinary();
+    bool ok = s_free != NULL && s_full != NULL && s_done != NULL;
+    for (int i = 0; i < OTA_WRITER_BUFFERS; i++) {
+        ok = ok && s_buffers[i] != NULL;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to allocate %d x %d bytes", OTA_WRITER_BUFFERS, OTA_WRITER_BUFFER_SIZE);
+        cleanup();
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < OTA_WRITER_BUFFERS; i++) {
+        xQueueSend(s_free, &i, 0);
+    }
+
+    s_partition = partition;
+    s_began = false;
+    s_failed = false;
+    s_write_err = ESP_OK;
+    s_fill = -1;
+    s_fill_len = 0;
+    s_start_us = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.state = OTA_WRITER_RECEIVING;
+    s_status.image_size = (uint32_t)image_size;
+    xSemaphoreGive(s_lock);
+
+    if (xTaskCreate(writer_task, "ota_writer", OTA_WRITER_TASK_STACK, NULL, 5, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start writer task");
+        cleanup();
+        status_finish(OTA_WRITER_FAILED, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Writing up to %u bytes to '%s' at 0x%lx", (unsigned)image_size,
+             partition->label, (unsigned long)partition->address);
+    return ESP_OK;
+}
+
+// Hand the buffer being filled to the writer
+static void submit_fill(void) {
+    ota_item_t item = { .index = s_fill, .len = s_fill_len };
+    xQueueSend(s_full, &item, portMAX_DELAY);
+    s_fill = -1;
+    s_fill_len = 0;
+}
+
+esp_err_t ota_writer_write(const void *data, size_t len) {
+    if (s_partition == NULL || s_failed) {
+        return ESP_FAIL;
+    }
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len > 0) {
+        if (s_fill < 0) {
+            int64_t t0 = esp_timer_get_time();
+            xQueueReceive(s_free, &s_fill, portMAX_DELAY);
+            status_add(&s_status.stall_ms, (uint32_t)((esp_timer_get_time() - t0) / 1000));
+        }
+        size_t n = OTA_WRITER_BUFFER_SIZE - s_fill_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s_buffers[s_fill] + s_fill_len, p, n);
+        s_fill_len += n;
+        p += n;
+        len -= n;
+        status_add(&s_status.queued, (uint32_t)n);
+        if (s_fill_len == OTA_WRITER_BUFFER_SIZE) {
+            submit_fill();
+        }
+    }
+    return ESP_OK;
+}
+
+// Flush the partial buffer, stop the writer task and wait for it
+static esp_err_t stop_writer(bool flush) {
+    if (s_fill >= 0) {
+        if (flush && s_fill_len > 0) {
+            submit_fill();
+        } else {
+            xQueueSend(s_free, &s_fill, 0);
+            s_fill = -1;
+        }
+    }
+    ota_item_t stop = { .index = -1, .len = 0 };
+    xQueueSend(s_full, &stop, portMAX_DELAY);
+    xSemaphoreTake(s_done, portMAX_DELAY);
+    return s_write_err;
+}
+
+esp_err_t ota_writer_end(void) {
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = stop_writer(true);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_status.state = OTA_WRITER_VERIFYING;
+    xSemaphoreGive(s_lock);
+
+    const char *error = NULL;
+    if (!s_began) {
+        error = "Failed to erase OTA partition";
+        err = ESP_FAIL;
+    } else if (err != ESP_OK) {
+        esp_ota_abort(s_handle);
+        error = "Failed to write firmware";
+    } else {
+        err = esp_ota_end(s_handle);
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+            error = "Firmware validation failed";
+        } else if (err != ESP_OK) {
+            error = "OTA finalization failed";
+        }
+    }
+    cleanup();
+
+    status_finish(err == ESP_OK ? OTA_WRITER_DONE : OTA_WRITER_FAILED, error);
+    ota_writer_status_t st;
+    ota_writer_get_status(&st);
+    ESP_LOGI(TAG, "%s: %lu bytes in %lu ms (erase %lu ms, write %lu ms, receiver stalled %lu ms)",
+             error ? error : "Done", (unsigned long)st.written, (unsigned long)st.elapsed_ms,
+             (unsigned long)st.erase_ms, (unsigned long)st.write_ms, (unsigned long)st.stall_ms);
+    return err;
+}
+
+void ota_writer_abort(const char *reason) {
+    if (s_partition == NULL) {
+        return;
+    }
+    stop_writer(false);
+    if (s_began) {
+        esp_ota_abort(s_handle);
+    }
+    cleanup();
+    status_finish(OTA_WRITER_FAILED, reason);
+    ESP_LOGW(TAG, "Aborted: %s", reason);
+}
+
+void ota_writer_get_status(ota_writer_status_t *status) {
+    if (s_lock == NULL) {
+        memset(status, 0, sizeof(*status));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *status = s_status;
+    xSemaphoreGive(s_lock);
+    if (status->state == OTA_WRITER_RECEIVING || status->state == OTA_WRITER_VERIFYING) {
+        status->elapsed_ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+    }
+}
+
+const char *ota_writer_state_name(ota_writer_state_t state) {
+    return state <= OTA_WRITER_FAILED ? state_names[state] : "unknown";
+}
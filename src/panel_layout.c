@@ -0,0 +1,151 @@
+/**
+ * @file panel_layout.c
+ * @brief Multi-panel layout description and parser
+ */
+
+#include "panel_layout.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "PANEL_LAYOUT";
+
+#define URL_PLACEHOLDER "{panel}"
+
+// Fill in the single default panel
+static void layout_default(panel_layout_t *layout) {
+    memset(layout, 0, sizeof(*layout));
+    layout->cols = 1;
+    layout->rows = 1;
+    layout->count = 1;
+    layout->pins[0].cs = EPD_PIN_CS;
+    layout->pins[0].dc = EPD_PIN_DC;
+    layout->pins[0].rst = EPD_PIN_RST;
+    layout->pins[0].busy = EPD_PIN_BUSY;
+    layout->pins[0].cs_secondary = EPD_PIN_CS_S;
+}
+
+// Take a pin for a panel: it must exist (and be able to drive an output
+// unless it is BUSY) and not be used by another panel or the SPI bus
+static bool layout_claim_pin(uint64_t *used, int pin, bool output) {
+    // The GPIO_IS_VALID_* macros shift by the pin number, check the range first
+    if (pin < 0 || pin >= GPIO_NUM_MAX) {
+        return false;
+    }
+    if (output ? !GPIO_IS_VALID_OUTPUT_GPIO(pin) : !GPIO_IS_VALID_GPIO(pin)) {
+        return false;
+    }
+    if (*used & (1ULL << pin)) {
+        return false;
+    }
+    *used |= 1ULL << pin;
+    return true;
+}
+
+// Check the pins of all panels
+static bool layout_pins_valid(const panel_layout_t *layout) {
+    uint64_t used = (1ULL << EPD_PIN_MOSI) | (1ULL << EPD_PIN_CLK);
+    for (int i = 0; i < layout->count; i++) {
+        const epd_transport_pins_t *pins = &layout->pins[i];
+        const struct {
+            const char *name;
+            int pin;
+            bool output;
+            bool optional;  // -1 = not connected
+        } checks[] = {
+            { "cs", pins->cs, true, false },
+            { "dc", pins->dc, true, false },
+            { "rst", pins->rst, true, false },
+            { "busy", pins->busy, false, false },
+            { "cs2", pins->cs_secondary, true, EPD_PANEL_CONTROLLERS == 1 },
+        };
+        for (size_t k = 0; k < sizeof(checks) / sizeof(checks[0]); k++) {
+            if (checks[k].optional && checks[k].pin < 0) {
+                continue;
+            }
+            if (!layout_claim_pin(&used, checks[k].pin, checks[k].output)) {
+                ESP_LOGE(TAG, "Panel %d: %s pin %d is invalid or already in use",
+                         i, checks[k].name, checks[k].pin);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+esp_err_t panel_layout_parse(const char *str, panel_layout_t *layout) {
+    layout_default(layout);
+    if (str == NULL || str[0] == '\0') {
+        return ESP_OK;
+    }
+
+    int cols = 0, rows = 0, consumed = 0;
+    if (sscanf(str, "%dx%d%n", &cols, &rows, &consumed) != 2 ||
+        cols < 1 || rows < 1 || cols * rows > EPD_MAX_PANELS) {
+        ESP_LOGE(TAG, "Invalid layout size in '%s'", str);
+        layout_default(layout);
+        return ESP_ERR_INVALID_ARG;
+    }
+    layout->cols = cols;
+    layout->rows = rows;
+    layout->count = cols * rows;
+
+    const char *p = str + consumed;
+    int n = 0;
+    while (*p == ';' && n < EPD_MAX_PANELS) {
+        epd_transport_pins_t *pins = &layout->pins[n];
+        if (sscanf(p, ";%d,%d,%d,%d%n", &pins->cs, &pins->dc, &pins->rst, &pins->busy,
+                   &consumed) != 4) {
+            break;
+        }
+        p += consumed;
+
+        // Two-controller panels need a fifth value: CS of the second controller
+        pins->cs_secondary = -1;
+        if (EPD_PANEL_CONTROLLERS > 1 &&
+            sscanf(p, ",%d%n", &pins->cs_secondary, &consumed) == 1) {
+            p += consumed;
+        }
+        if (EPD_PANEL_CONTROLLERS > 1 && pins->cs_secondary < 0) {
+            break;
+        }
+        n++;
+    }
+
+    // A 1x1 layout may omit the pins and keep the defaults
+    bool pins_ok = (n == layout->count) || (layout->count == 1 && n == 0);
+    if (*p != '\0' || !pins_ok) {
+        ESP_LOGE(TAG, "Layout '%s' needs %d pin groups (cs,dc,rst,busy), got %d",
+                 str, layout->count, n);
+        layout_default(layout);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!layout_pins_valid(layout)) {
+        layout_default(layout);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Panel layout: %dx%d (%d panels)", layout->cols, layout->rows, layout->count);
+    return ESP_OK;
+}
+
+void panel_layout_region(const panel_layout_t *layout, int index,
+                         uint16_t *canvas_width, uint16_t *canvas_height, uint16_t *x, uint16_t *y) {
+    *canvas_width = layout->cols * EPD_PANEL_WIDTH;
+    *canvas_height = layout->rows * EPD_PANEL_HEIGHT;
+    *x = (index % layout->cols) * EPD_PANEL_WIDTH;
+    *y = (index / layout->cols) * EPD_PANEL_HEIGHT;
+}
+
+bool panel_layout_url(const char *tmpl, int index, char *out, size_t out_len) {
+    const char *ph = strstr(tmpl, URL_PLACEHOLDER);
+    if (ph == NULL) {
+        snprintf(out, out_len, "%s", tmpl);
+        return false;
+    }
+
+    snprintf(out, out_len, "%.*s%d%s", (int)(ph - tmpl), tmpl, index, ph + strlen(URL_PLACEHOLDER));
+    return true;
+}
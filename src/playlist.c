@@ -0,0 +1,312 @@
+/**
+ * @file playlist.c
+ * @brief Offline slideshow: playlist manifest and index of the stored frames
+ */
+
+#include "playlist.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void set_error(char *err, size_t err_len, const char *msg) {
+    if (err != NULL && err_len > 0) {
+        snprintf(err, err_len, "%s", msg);
+    }
+}
+
+uint32_t playlist_hash(const void *data, size_t len, uint32_t h) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t playlist_frame_key(const char *url, const char *rev) {
+    uint32_t h = playlist_hash(url, strlen(url), PLAYLIST_HASH_INIT);
+    if (rev != NULL) {
+        h = playlist_hash("\n", 1, h);  // Separator
+        h = playlist_hash(rev, strlen(rev), h);
+    }
+    return h;
+}
+
+// Copy n bytes of a and then b into out
+static bool join(const char *a, size_t n, const char *b, char *out, size_t len) {
+    size_t blen = strlen(b);
+    if (n + blen + 1 > len) {
+        return false;
+    }
+    memmove(out, a, n);
+    memcpy(out + n, b, blen + 1);
+    return true;
+}
+
+bool playlist_resolve_url(const char *base, const char *ref, char *out, size_t len) {
+    const char *scheme_end = strstr(base, "://");
+
+    if (strstr(ref, "://") != NULL || scheme_end == NULL) {
+        return join("", 0, ref, out, len);
+    }
+    if (ref[0] == '/' && ref[1] == '/') {
+        return join(base, (size_t)(scheme_end + 1 - base), ref, out, len);  // Keep "scheme:"
+    }
+
+    const char *authority = scheme_end + 3;
+    size_t authority_len = strcspn(authority, "/?#");
+    if (ref[0] == '/') {
+        return join(base, (size_t)(authority + authority_len - base), ref, out, len);
+    }
+
+    // Relative to the manifest's directory (path up to its last '/')
+    const char *path = authority + authority_len;
+    size_t path_len = strcspn(path, "?#");
+    size_t dir_len = 0;
+    for (size_t i = 0; i < path_len; i++) {
+        if (path[i] == '/') {
+            dir_len = i + 1;
+        }
+    }
+    if (dir_len == 0) {
+        size_t n = (size_t)(path - base);
+        if (n + 1 + strlen(ref) + 1 > len) {
+            return false;
+        }
+        memmove(out, base, n);
+        out[n] = '/';
+        strcpy(out + n + 1, ref);
+        return true;
+    }
+    return join(base, (size_t)(path + dir_len - base), ref, out, len);
+}
+
+bool playlist_parse(const char *json, size_t len, const char *base_url,
+                    playlist_manifest_t *out, char *err, size_t err_len) {
+    memset(out, 0, sizeof(*out));
+
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    if (root == NULL) {
+        set_error(err, err_len, "Manifest is not valid JSON");
+        return false;
+    }
+
+    const cJSON *frames = cJSON_GetObjectItem(root, "frames");
+    int n = cJSON_IsArray(frames) ? cJSON_GetArraySize(frames) : 0;
+    if (n == 0) {
+        set_error(err, err_len, "Manifest has no frames");
+        cJSON_Delete(root);
+        return false;
+    }
+    if (n > PLAYLIST_MAX_FRAMES) {
+        n = PLAYLIST_MAX_FRAMES;  // Rest is ignored
+    }
+
+    size_t url_max = strlen(base_url) + 1;
+    bool ok = true;
+    for (int i = 0; i < n && ok; i++) {
+        const cJSON *item = cJSON_GetArrayItem(frames, i);
+        const char *ref = NULL;
+        const char *rev = NULL;
+
+        if (cJSON_IsString(item)) {
+            ref = item->valuestring;
+        } else if (cJSON_IsObject(item)) {
+            const cJSON *u = cJSON_GetObjectItem(item, "url");
+            const cJSON *r = cJSON_GetObjectItem(item, "rev");
+            ref = cJSON_IsString(u) ? u->valuestring : NULL;
+            rev = cJSON_IsString(r) ? r->valuestring : NULL;
+        }
+        if (ref == NULL || ref[0] == '\0') {
+            set_error(err, err_len, "Frame without URL");
+            ok = false;
+            break;
+        }
+
+        size_t cap = url_max + strlen(ref);
+        char *url = malloc(cap);
+        if (url == NULL || !playlist_resolve_url(base_url, ref, url, cap)) {
+            free(url);
+            set_error(err, err_len, "Frame URL too long");
+            ok = false;
+            break;
+        }
+        out->url[i] = url;
+        out->key[i] = playlist_frame_key(url, rev);
+        out->has_rev[i] = (rev != NULL);
+        out->count = i + 1;
+    }
+
+    cJSON_Delete(root);
+    if (!ok) {
+        playlist_manifest_free(out);
+    }
+    return ok;
+}
+
+void playlist_manifest_free(playlist_manifest_t *m) {
+    for (int i = 0; i < m->count; i++) {
+        free(m->url[i]);
+        m->url[i] = NULL;
+    }
+    m->count = 0;
+}
+
+void playlist_index_reset(playlist_index_t *idx, uint32_t data_size, uint32_t sector_size,
+                          uint32_t render_key) {
+    memset(idx, 0, sizeof(*idx));
+    idx->data_size = data_size;
+    idx->sector_size = sector_size;
+    idx->render_key = render_key;
+}
+
+void playlist_index_unlist(playlist_index_t *idx) {
+    for (int i = 0; i < idx->count; i++) {
+        idx->entry[i].position = PLAYLIST_UNLISTED;
+    }
+    idx->frames = 0;
+}
+
+int playlist_index_find(const playlist_index_t *idx, uint32_t key) {
+    for (int i = 0; i < idx->count; i++) {
+        if (idx->entry[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t align_up(const playlist_index_t *idx, uint32_t n) {
+    return (n + idx->sector_size - 1) / idx->sector_size * idx->sector_size;
+}
+
+static void remove_entry(playlist_index_t *idx, int i) {
+    memmove(&idx->entry[i], &idx->entry[i + 1], (idx->count - i - 1) * sizeof(idx->entry[0]));
+    idx->count--;
+}
+
+// Entries overlapping [start, end): how many are listed, and the newest of
+// them (entries are in write order; -1 if none)
+static void count_overlap(const playlist_index_t *idx, uint32_t start, uint32_t end,
+                          int *listed, int *newest) {
+    *listed = 0;
+    *newest = -1;
+    for (int i = 0; i < idx->count; i++) {
+        const playlist_entry_t *e = &idx->entry[i];
+        if (e->offset < end && align_up(idx, e->offset + e->size) > start) {
+            *newest = i;
+            if (e->position != PLAYLIST_UNLISTED) {
+                (*listed)++;
+            }
+        }
+    }
+}
+
+int playlist_index_place(playlist_index_t *idx, uint32_t size, uint32_t *offset,
+                         uint32_t *erase_len) {
+    uint32_t len = align_up(idx, size);
+    if (size == 0 || len > idx->data_size) {
+        return -1;
+    }
+
+    // Candidates: the ring head, the start and the end of every entry. Best
+    // is the one evicting the fewest listed frames, then the one whose
+    // newest victim is oldest (free space beats any victim); ties keep the
+    // ring order (head), so writes rotate over the area.
+    uint32_t best = 0;
+    int best_listed = -1, best_newest = 0;
+    for (int c = -2; c < idx->count; c++) {
+        uint32_t start = (c == -2) ? idx->head :
+                         (c == -1) ? 0 : align_up(idx, idx->entry[c].offset + idx->entry[c].size);
+        if (start + len > idx->data_size) {
+            continue;
+        }
+        int listed, newest;
+        count_overlap(idx, start, start + len, &listed, &newest);
+        if (best_listed < 0 || listed < best_listed ||
+            (listed == best_listed && newest < best_newest)) {
+            best = start;
+            best_listed = listed;
+            best_newest = newest;
+        }
+    }
+
+    int removed = 0;
+    for (int i = idx->count - 1; i >= 0; i--) {
+        const playlist_entry_t *e = &idx->entry[i];
+        if (e->offset < best + len && align_up(idx, e->offset + e->size) > best) {
+            remove_entry(idx, i);
+            removed++;
+        }
+    }
+
+    // Room in the index: drop the oldest unlisted entry, else the oldest one
+    if (idx->count == PLAYLIST_MAX_ENTRIES) {
+        int victim = 0;
+        for (int i = 0; i < idx->count; i++) {
+            if (idx->entry[i].position == PLAYLIST_UNLISTED) {
+                victim = i;
+                break;
+            }
+        }
+        remove_entry(idx, victim);
+        removed++;
+    }
+
+    *offset = best;
+    *erase_len = len;
+    return removed;
+}
+
+void playlist_index_add(playlist_index_t *idx, uint32_t offset, uint32_t size, uint32_t crc,
+                        uint32_t key, const char *etag, uint8_t position) {
+    int old = playlist_index_find(idx, key);
+    if (old >= 0) {
+        remove_entry(idx, old);
+    }
+    if (idx->count == PLAYLIST_MAX_ENTRIES) {
+        remove_entry(idx, 0);  // Not reached after playlist_index_place()
+    }
+
+    playlist_entry_t *e = &idx->entry[idx->count++];
+    memset(e, 0, sizeof(*e));
+    e->offset = offset;
+    e->size = size;
+    e->crc = crc;
+    e->key = key;
+    e->position = position;
+    strncpy(e->etag, etag ? etag : "", PLAYLIST_ETAG_LEN - 1);
+
+    idx->head = align_up(idx, offset + size);
+    if (idx->head >= idx->data_size) {
+        idx->head = 0;
+    }
+}
+
+int playlist_index_next(const playlist_index_t *idx, uint8_t *cursor) {
+    for (int n = 0; n < idx->frames; n++) {
+        uint8_t pos = (uint8_t)((*cursor + n) % idx->frames);
+        for (int i = 0; i < idx->count; i++) {
+            if (idx->entry[i].position == pos) {
+                *cursor = (uint8_t)((pos + 1) % idx->frames);
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+int playlist_index_listed(const playlist_index_t *idx, uint32_t *bytes) {
+    int n = 0;
+    uint32_t total = 0;
+    for (int i = 0; i < idx->count; i++) {
+        if (idx->entry[i].position != PLAYLIST_UNLISTED) {
+            n++;
+            total += idx->entry[i].size;
+        }
+    }
+    if (bytes != NULL) {
+        *bytes = total;
+    }
+    return n;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file png_stream.c
+ * @brief Row-by-row indexed PNG encoder
+ */
+
+#include <string.h>
+#include "png_stream.h"
+
+// About zlib level 3, as for the stored slides: speed matters more than
+// the last few percent
+#define DEFLATE_FLAGS (32 | TDEFL_GREEDY_PARSING_FLAG | TDEFL_WRITE_ZLIB_HEADER)
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Complete a chunk in buf (8 bytes header space, len data bytes, 4 bytes
+// CRC space) and pass it on
+static bool write_chunk(png_stream_t *ps, uint8_t *buf, const char *type, size_t len) {
+    put_u32(buf, (uint32_t)len);
+    memcpy(buf + 4, type, 4);
+    put_u32(buf + 8 + len, (uint32_t)mz_crc32(MZ_CRC32_INIT, buf + 4, len + 4));
+    if (!ps->write(buf, 8 + len + 4, ps->ctx)) {
+        ps->failed = true;
+    }
+    return !ps->failed;
+}
+
+// Send the IDAT chunk being filled
+static bool flush_idat(png_stream_t *ps) {
+    if (ps->chunk_len == 0) {
+        return !ps->failed;
+    }
+    size_t len = ps->chunk_len;
+    ps->chunk_len = 0;
+    return write_chunk(ps, ps->chunk, "IDAT", len);
+}
+
+// tdefl output callback: collect compressed data into IDAT chunks
+static mz_bool deflate_put(const void *buf, int len, void *user) {
+    png_stream_t *ps = (png_stream_t *)user;
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        size_t n = PNG_STREAM_IDAT_SIZE - ps->chunk_len;
+        if (n > (size_t)len) {
+            n = len;
+        }
+        memcpy(ps->chunk + 8 + ps->chunk_len, p, n);
+        ps->chunk_len += n;
+        p += n;
+        len -= (int)n;
+        if (ps->chunk_len == PNG_STREAM_IDAT_SIZE && !flush_idat(ps)) {
+            return MZ_FALSE;
+        }
+    }
+    return MZ_TRUE;
+}
+
+bool png_stream_begin(png_stream_t *ps, tdefl_compressor *comp,
+                      uint32_t width, uint32_t height, uint8_t bit_depth,
+                      const uint8_t (*palette)[3], size_t colors,
+                      png_stream_write_t write, void *ctx) {
+    memset(ps, 0, offsetof(png_stream_t, chunk));
+    ps->failed = true;
+    if (comp == NULL || write == NULL || width == 0 || height == 0 ||
+        (bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8) ||
+        colors == 0 || colors > (1u << bit_depth)) {
+        return false;
+    }
+    ps->comp = comp;
+    ps->write = write;
+    ps->ctx = ctx;
+    ps->height = height;
+    ps->row_bytes = ((size_t)width * bit_depth + 7) / 8;
+    ps->failed = false;
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (!write(signature, sizeof(signature), ctx)) {
+        ps->failed = true;
+        return false;
+    }
+
+    // The chunk buffer is free until the first IDAT
+    uint8_t *ihdr = ps->chunk + 8;
+    put_u32(ihdr, width);
+    put_u32(ihdr + 4, height);
+    ihdr[8] = bit_depth;
+    ihdr[9] = 3;    // Color type: palette
+    ihdr[10] = 0;   // Deflate
+    ihdr[11] = 0;   // Adaptive filtering
+    ihdr[12] = 0;   // No interlace
+    if (!write_chunk(ps, ps->chunk, "IHDR", 13)) {
+        return false;
+    }
+
+    memcpy(ps->chunk + 8, palette, colors * 3);
+    if (!write_chunk(ps, ps->chunk, "PLTE", colors * 3)) {
+        return false;
+    }
+
+    if (tdefl_init(comp, deflate_put, ps, DEFLATE_FLAGS) != TDEFL_STATUS_OKAY) {
+        ps->failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool png_stream_row(png_stream_t *ps, const uint8_t *row) {
+    if (ps->failed || ps->rows >= ps->height) {
+        ps->failed = true;
+        return false;
+    }
+    static const uint8_t filter_none = 0;
+    if (tdefl_compress_buffer(ps->comp, &filter_none, 1, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY ||
+        tdefl_compress_buffer(ps->comp, row, ps->row_bytes, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY) {
+        ps->failed = true;
+        return false;
+    }
+    ps->rows++;
+    return true;
+}
+
+bool png_stream_end(png_stream_t *ps) {
+    if (ps->failed || ps->rows != ps->height) {
+        ps->failed = true;
+        return false;
+    }
+    if (tdefl_compress_buffer(ps->comp, NULL, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE ||
+        !flush_idat(ps)) {
+        ps->failed = true;
+        return false;
+    }
+    return write_chunk(ps, ps->chunk, "IEND", 0);
+}
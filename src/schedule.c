@@ -0,0 +1,305 @@
+/**
+ * @file schedule.c
+ * @brief Refresh schedule compiled from the schedule JSON into a binary table
+ */
+
+#include "schedule.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MINUTES_PER_DAY 1440
+
+static const char *const day_names[SCHEDULE_DAYS] = {
+    "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"
+};
+
+typedef struct {
+    uint16_t start;
+    uint16_t end;       // Up to 1440 ("24:00")
+    uint16_t interval;
+} period_t;
+
+static void set_error(char *err, size_t err_len, const char *msg, const char *detail) {
+    if (err != NULL && err_len > 0) {
+        snprintf(err, err_len, "%s%s%s", msg, detail ? ": " : "", detail ? detail : "");
+    }
+}
+
+// Parse "HH:MM" into minutes; "24:00" only if allow_2400
+static bool parse_time(const cJSON *item, bool allow_2400, uint16_t *out) {
+    const char *s = cJSON_IsString(item) ? item->valuestring : NULL;
+    if (s == NULL || strlen(s) != 5 || s[2] != ':') {
+        return false;
+    }
+    for (int i = 0; i < 5; i++) {
+        if (i != 2 && (s[i] < '0' || s[i] > '9')) {
+            return false;
+        }
+    }
+    int h = (s[0] - '0') * 10 + (s[1] - '0');
+    int m = (s[3] - '0') * 10 + (s[4] - '0');
+    if (m > 59 || h > 24 || (h == 24 && (m != 0 || !allow_2400))) {
+        return false;
+    }
+    *out = (uint16_t)(h * 60 + m);
+    return true;
+}
+
+// Same matching rule as the original JSON evaluator
+static bool period_contains(const period_t *p, uint16_t minute) {
+    if (p->start == p->end) {
+        return true;                                        // All day
+    } else if (p->start < p->end) {
+        return minute >= p->start && minute < p->end;       // e.g. 06:00-22:00
+    } else {
+        return minute >= p->start || minute < p->end;       // e.g. 22:00-06:00
+    }
+}
+
+// Turn a plan's periods into segments starting at each boundary
+static void compile_plan(const period_t *periods, int count, schedule_table_t *t, int *seg_count) {
+    uint16_t bounds[2 * MAX_PERIODS_PER_PLAN + 1];
+    int nb = 0;
+
+    bounds[nb++] = 0;
+    for (int i = 0; i < count; i++) {
+        bounds[nb++] = periods[i].start;
+        if (periods[i].end < MINUTES_PER_DAY) {
+            bounds[nb++] = periods[i].end;
+        }
+    }
+
+    // Insertion sort, duplicates removed below
+    for (int i = 1; i < nb; i++) {
+        uint16_t v = bounds[i];
+        int j = i - 1;
+        while (j >= 0 && bounds[j] > v) {
+            bounds[j + 1] = bounds[j];
+            j--;
+        }
+        bounds[j + 1] = v;
+    }
+
+    int first = *seg_count;
+    for (int b = 0; b < nb; b++) {
+        if (b > 0 && bounds[b] == bounds[b - 1]) {
+            continue;
+        }
+        uint16_t interval = 0;
+        for (int i = 0; i < count; i++) {
+            if (period_contains(&periods[i], bounds[b])) {
+                interval = periods[i].interval;
+                break;
+            }
+        }
+        // Merge with the previous segment if the interval is the same
+        if (*seg_count > first && t->seg[*seg_count - 1].interval == interval) {
+            continue;
+        }
+        t->seg[*seg_count].start = bounds[b];
+        t->seg[*seg_count].interval = interval;
+        (*seg_count)++;
+    }
+}
+
+bool schedule_compile(const char *json, schedule_table_t *out, char *err, size_t err_len) {
+    static schedule_table_t t;  // Compiled here, copied to out on success
+    static const char *plan_names[MAX_SCHEDULE_PLANS];
+    period_t periods[MAX_PERIODS_PER_PLAN];
+    bool ok = false;
+    int seg_count = 0;
+
+    memset(&t, 0, sizeof(t));
+    memset(t.day_plan, SCHEDULE_NO_PLAN, sizeof(t.day_plan));
+    t.valid = 1;
+
+    if (json == NULL || json[0] == '\0') {
+        *out = t;
+        return true;
+    }
+
+    cJSON *root = cJSON_Parse(json);
+    if (!cJSON_IsObject(root)) {
+        set_error(err, err_len, "Schedule is not a valid JSON object", NULL);
+        goto cleanup;
+    }
+
+    const cJSON *plans = cJSON_GetObjectItemCaseSensitive(root, "plans");
+    const cJSON *days = cJSON_GetObjectItemCaseSensitive(root, "days");
+    if (!cJSON_IsArray(plans) || (days != NULL && !cJSON_IsObject(days))) {
+        set_error(err, err_len, "Schedule needs a \"plans\" array and a \"days\" object", NULL);
+        goto cleanup;
+    }
+    if (cJSON_GetArraySize(plans) > MAX_SCHEDULE_PLANS) {
+        set_error(err, err_len, "Too many plans", NULL);
+        goto cleanup;
+    }
+
+    const cJSON *plan;
+    cJSON_ArrayForEach(plan, plans) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(plan, "name");
+        const cJSON *list = cJSON_GetObjectItemCaseSensitive(plan, "periods");
+        if (!cJSON_IsString(name) || name->valuestring[0] == '\0' || !cJSON_IsArray(list)) {
+            set_error(err, err_len, "Plan needs a name and a \"periods\" array", NULL);
+            goto cleanup;
+        }
+        for (int p = 0; p < t.plan_count; p++) {
+            if (strcmp(plan_names[p], name->valuestring) == 0) {
+                set_error(err, err_len, "Duplicate plan name", name->valuestring);
+                goto cleanup;
+            }
+        }
+        if (cJSON_GetArraySize(list) > MAX_PERIODS_PER_PLAN) {
+            set_error(err, err_len, "Too many periods in plan", name->valuestring);
+            goto cleanup;
+        }
+
+        int count = 0;
+        const cJSON *period;
+        cJSON_ArrayForEach(period, list) {
+            const cJSON *interval = cJSON_GetObjectItemCaseSensitive(period, "interval");
+            period_t *pp = &periods[count];
+            if (!parse_time(cJSON_GetObjectItemCaseSensitive(period, "start"), false, &pp->start) ||
+                !parse_time(cJSON_GetObjectItemCaseSensitive(period, "end"), true, &pp->end)) {
+                set_error(err, err_len, "Period times must be HH:MM", name->valuestring);
+                goto cleanup;
+            }
+            if (!cJSON_IsNumber(interval) || interval->valuedouble < 1 ||
+                interval->valuedouble > SCHEDULE_MAX_INTERVAL ||
+                interval->valuedouble != (double)interval->valueint) {
+                set_error(err, err_len, "Period interval must be 1-1440 minutes", name->valuestring);
+                goto cleanup;
+            }
+            pp->interval = (uint16_t)interval->valueint;
+            count++;
+        }
+
+        plan_names[t.plan_count] = name->valuestring;
+        t.plan_first[t.plan_count] = (uint8_t)seg_count;
+        compile_plan(periods, count, &t, &seg_count);
+        t.plan_count++;
+    }
+    t.plan_first[t.plan_count] = (uint8_t)seg_count;
+
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        const cJSON *assigned = cJSON_GetObjectItemCaseSensitive(days, day_names[d]);
+        if (assigned == NULL) {
+            continue;  // Default interval all day
+        }
+        if (!cJSON_IsString(assigned)) {
+            set_error(err, err_len, "Day must name a plan", day_names[d]);
+            goto cleanup;
+        }
+        for (int p = 0; p < t.plan_count; p++) {
+            if (strcmp(plan_names[p], assigned->valuestring) == 0) {
+                t.day_plan[d] = (uint8_t)p;
+                break;
+            }
+        }
+        if (t.day_plan[d] == SCHEDULE_NO_PLAN) {
+            set_error(err, err_len, "Unknown plan", assigned->valuestring);
+            goto cleanup;
+        }
+    }
+
+    *out = t;
+    ok = true;
+
+cleanup:
+    cJSON_Delete(root);
+    return ok;
+}
+
+// Segment of a day's plan containing the minute, NULL if the day has no plan
+static const schedule_segment_t *find_segment(const schedule_table_t *t, int day, uint32_t minute,
+                                              uint32_t *next_start) {
+    uint8_t plan = t->day_plan[day];
+    if (!t->valid || plan == SCHEDULE_NO_PLAN || plan >= t->plan_count) {
+        *next_start = MINUTES_PER_DAY;
+        return NULL;
+    }
+
+    const schedule_segment_t *seg = NULL;
+    *next_start = MINUTES_PER_DAY;
+    for (int i = t->plan_first[plan]; i < t->plan_first[plan + 1]; i++) {
+        if (t->seg[i].start > minute) {
+            *next_start = t->seg[i].start;
+            break;
+        }
+        seg = &t->seg[i];
+    }
+    return seg;
+}
+
+uint32_t schedule_interval_at(const schedule_table_t *t, int day, uint32_t minute) {
+    uint32_t next_start;
+    const schedule_segment_t *seg = find_segment(t, day, minute, &next_start);
+    return seg ? seg->interval : 0;
+}
+
+// Interval in effect at a point in the week, with the default filled in
+static uint32_t effective_interval(const schedule_table_t *t, int day, uint32_t minute,
+                                   uint32_t default_min, uint32_t *next_start) {
+    const schedule_segment_t *seg = find_segment(t, day, minute, next_start);
+    return (seg && seg->interval) ? seg->interval : default_min;
+}
+
+uint32_t schedule_next_wake_s(const schedule_table_t *t, int day, uint32_t second,
+                              uint32_t default_min) {
+    uint32_t next_start;
+    uint32_t current = effective_interval(t, day, second / 60, default_min, &next_start);
+    uint32_t sleep_s = current * 60;
+
+    // Walk forward over segment boundaries (crossing midnight) until the
+    // interval changes or the regular sleep ends first
+    uint32_t elapsed = 0;
+    while (1) {
+        elapsed += next_start * 60 - second;
+        if (elapsed >= sleep_s) {
+            return sleep_s;
+        }
+
+        if (next_start >= MINUTES_PER_DAY) {
+            day = (day + 1) % SCHEDULE_DAYS;
+            next_start = 0;
+        }
+        second = next_start * 60;
+
+        uint32_t following;
+        uint32_t interval = effective_interval(t, day, next_start, default_min, &following);
+        if (interval != current) {
+            if (elapsed < SCHEDULE_MIN_SLEEP_S) {
+                // Too close to bother: sleep into the new period instead
+                return elapsed + schedule_next_wake_s(t, day, second, default_min);
+            }
+            return elapsed;
+        }
+        next_start = following;
+    }
+}
+
+uint32_t schedule_align_s(uint32_t second, uint32_t interval_min, uint32_t lead_s,
+                          uint32_t limit_s) {
+    const uint32_t day_s = MINUTES_PER_DAY * 60;
+    uint32_t interval_s = (interval_min > 0 ? interval_min : 1) * 60;
+
+    // First grid point that still leaves a minimum sleep after the lead
+    uint32_t earliest = second + lead_s + SCHEDULE_MIN_SLEEP_S;
+    uint32_t base = 0;
+    while (earliest > day_s) {
+        base += day_s;
+        earliest -= day_s;
+    }
+    uint32_t target = (earliest + interval_s - 1) / interval_s * interval_s;
+    if (target > day_s) {
+        target = day_s;  // Midnight is on every grid
+    }
+    target += base;
+
+    if (target - second > limit_s) {
+        // The limit comes first; wake ahead of it by the lead if there is room
+        return (limit_s >= lead_s + SCHEDULE_MIN_SLEEP_S) ? limit_s - lead_s : limit_s;
+    }
+    return target - second - lead_s;
+}
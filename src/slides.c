@@ -0,0 +1,385 @@
+/**
+ * @file slides.c
+ * @brief Offline slideshow frames stored compressed in a flash partition
+ */
+
+#include "slides.h"
+#include "playlist.h"
+#include "config.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "miniz.h"
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "SLIDES";
+
+#define SLIDES_LABEL   "slides"
+#define SLIDES_MAGIC   0x534C4431  // "SLD1"
+#define SECTOR_SIZE    4096
+#define INDEX_SECTORS  2           // Index copies, written alternately
+#define DATA_BASE      (INDEX_SECTORS * SECTOR_SIZE)
+
+// About zlib level 3: the radio stays on while frames are compressed
+#define DEFLATE_FLAGS  (32 | TDEFL_GREEDY_PARSING_FLAG)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    playlist_index_t index;
+    uint32_t crc;
+} index_record_t;
+
+_Static_assert(sizeof(index_record_t) <= SECTOR_SIZE, "Slide index exceeds its sector");
+
+// Compressed output of the frame being stored
+typedef struct {
+    tdefl_compressor *comp;
+    uint8_t *out;
+    size_t len;
+    size_t cap;
+} deflate_ctx_t;
+
+static const esp_partition_t *partition = NULL;
+static index_record_t record;       // Current index (too large for the task stacks)
+static index_record_t scratch;
+static int record_sector = -1;      // Sector holding the current index, -1 if none
+static char error_msg[128] = {0};
+
+static RTC_DATA_ATTR uint8_t cursor = 0;      // Next playlist position
+static RTC_DATA_ATTR time_t last_check = 0;   // Last manifest check, 0 = not since power-on
+static RTC_DATA_ATTR slides_stats_t stats;
+_Static_assert(sizeof(cursor) + sizeof(last_check) <= RTC_MODULE_STATE_MAX,
+               "Playlist state exceeds its share of RTC memory");
+
+static uint32_t record_crc(const index_record_t *r) {
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(index_record_t, crc));
+}
+
+// Write the index to the older of the two index sectors
+static esp_err_t commit_index(void) {
+    int sector = (record_sector + 1) % INDEX_SECTORS;
+    record.magic = SLIDES_MAGIC;
+    record.seq++;
+    record.crc = record_crc(&record);
+
+    esp_err_t ret = esp_partition_erase_range(partition, (size_t)sector * SECTOR_SIZE, SECTOR_SIZE);
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(partition, (size_t)sector * SECTOR_SIZE, &record, sizeof(record));
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write index: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    record_sector = sector;
+    return ESP_OK;
+}
+
+esp_err_t slides_init(uint32_t render_key) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         SLIDES_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No %s partition", SLIDES_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t data_size = (partition->size - DATA_BASE) / SECTOR_SIZE * SECTOR_SIZE;
+
+    // Newest valid index copy
+    record_sector = -1;
+    for (int i = 0; i < INDEX_SECTORS; i++) {
+        if (esp_partition_read(partition, (size_t)i * SECTOR_SIZE, &scratch, sizeof(scratch)) != ESP_OK ||
+            scratch.magic != SLIDES_MAGIC || scratch.crc != record_crc(&scratch)) {
+            continue;
+        }
+        if (record_sector < 0 || (int32_t)(scratch.seq - record.seq) > 0) {
+            record_sector = i;
+            record = scratch;
+        }
+    }
+
+    if (record_sector < 0 || record.index.data_size != data_size ||
+        record.index.sector_size != SECTOR_SIZE) {
+        uint32_t seq = (record_sector >= 0) ? record.seq : 0;
+        playlist_index_reset(&record.index, data_size, SECTOR_SIZE, render_key);
+        record.seq = seq;
+        last_check = 0;
+    } else if (record.index.render_key != render_key) {
+        ESP_LOGI(TAG, "Display settings changed, stored frames dropped");
+        playlist_index_reset(&record.index, data_size, SECTOR_SIZE, render_key);
+        last_check = 0;
+    }
+    if (cursor >= record.index.frames) {
+        cursor = 0;
+    }
+
+    ESP_LOGI(TAG, "%d of %d playlist frames stored, %lu KB data area",
+             playlist_index_listed(&record.index, NULL), record.index.frames,
+             (unsigned long)(data_size / 1024));
+    return ESP_OK;
+}
+
+bool slides_sync_due(uint32_t check_min) {
+    if (partition == NULL || last_check == 0 || playlist_index_listed(&record.index, NULL) == 0) {
+        return true;
+    }
+    time_t now = time(NULL);
+    return now < last_check || now - last_check >= (time_t)check_min * 60;
+}
+
+static mz_bool deflate_put(const void *buf, int len, void *user) {
+    deflate_ctx_t *ctx = (deflate_ctx_t *)user;
+    if (ctx->len + (size_t)len > ctx->cap) {
+        return MZ_FALSE;  // Does not compress; fails the frame
+    }
+    memcpy(ctx->out + ctx->len, buf, len);
+    ctx->len += len;
+    return MZ_TRUE;
+}
+
+// Image row sink: deflate the dithered rows as they are produced
+static void deflate_row_sink(uint32_t row, const uint8_t *data, size_t len, void *user) {
+    deflate_ctx_t *ctx = (deflate_ctx_t *)user;
+    tdefl_compress_buffer(ctx->comp, data, len, TDEFL_NO_FLUSH);
+}
+
+// Dither the downloaded frame, compress it and write it to the data area
+static esp_err_t store_frame(deflate_ctx_t *ctx, uint32_t key, const char *etag, uint8_t position) {
+    tdefl_init(ctx->comp, deflate_put, ctx, DEFLATE_FLAGS);
+    ctx->len = 0;
+    esp_err_t ret = image_processor_render(NULL, deflate_row_sink, ctx);
+    if (ret != ESP_OK) {
+        snprintf(error_msg, sizeof(error_msg), "%s", image_processor_get_error());
+        return ret;
+    }
+    if (tdefl_compress_buffer(ctx->comp, NULL, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE) {
+        snprintf(error_msg, sizeof(error_msg), "Frame does not compress");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t offset, erase_len;
+    int evicted = playlist_index_place(&record.index, ctx->len, &offset, &erase_len);
+    if (evicted < 0) {
+        snprintf(error_msg, sizeof(error_msg), "Frame larger than the slide store");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (evicted > 0) {
+        stats.evictions += evicted;
+        ESP_LOGW(TAG, "Evicted %d stored frames", evicted);
+        ret = commit_index();  // Before their sectors are erased
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_erase_range(partition, DATA_BASE + offset, erase_len);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(partition, DATA_BASE + offset, ctx->out, ctx->len);
+    }
+    if (ret != ESP_OK) {
+        snprintf(error_msg, sizeof(error_msg), "Flash write failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    playlist_index_add(&record.index, offset, ctx->len, esp_rom_crc32_le(0, ctx->out, ctx->len),
+                       key, etag, position);
+    ESP_LOGI(TAG, "Frame %u stored at %lu: %u bytes (%u%%)", position, (unsigned long)offset,
+             (unsigned)ctx->len, (unsigned)(ctx->len * 100 / IMAGE_BUFFER_SIZE));
+    return ESP_OK;
+}
+
+esp_err_t slides_sync(const char *manifest_url) {
+    int64_t start_us = esp_timer_get_time();
+    bool changed;
+
+    if (partition == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "No slides partition");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Manifest and frames share one connection
+    image_processor_set_keep_alive(true);
+    esp_err_t ret = image_processor_fetch_if_changed(manifest_url, record.index.etag, &changed);
+    if (ret != ESP_OK) {
+        snprintf(error_msg, sizeof(error_msg), "%s", image_processor_get_error());
+        image_processor_set_keep_alive(false);
+        return ret;
+    }
+    stats.checks++;
+    last_check = time(NULL);
+    if (!changed) {
+        ESP_LOGI(TAG, "Playlist unchanged");
+        image_processor_set_keep_alive(false);
+        return ESP_OK;
+    }
+
+    static playlist_manifest_t manifest;
+    char manifest_etag[PLAYLIST_ETAG_LEN];
+    size_t len;
+    const char *json = (const char *)image_processor_get_data(&len);
+    strncpy(manifest_etag, image_processor_get_etag(), sizeof(manifest_etag) - 1);
+    manifest_etag[sizeof(manifest_etag) - 1] = '\0';
+    if (!playlist_parse(json, len, manifest_url, &manifest, error_msg, sizeof(error_msg))) {
+        ESP_LOGE(TAG, "%s", error_msg);
+        image_processor_set_keep_alive(false);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    stats.changes++;
+    ESP_LOGI(TAG, "Playlist changed: %d frames", manifest.count);
+
+    deflate_ctx_t ctx = {
+        .comp = heap_caps_malloc(sizeof(tdefl_compressor), MALLOC_CAP_SPIRAM),
+        .out = heap_caps_malloc(IMAGE_BUFFER_SIZE, MALLOC_CAP_SPIRAM),
+        .cap = IMAGE_BUFFER_SIZE,
+    };
+    if (ctx.comp == NULL || ctx.out == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Failed to allocate compression buffers");
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+
+    playlist_index_unlist(&record.index);
+    int failed = 0;
+    for (int i = 0; i < manifest.count; i++) {
+        int e = playlist_index_find(&record.index, manifest.key[i]);
+
+        // A versioned frame is unchanged as long as URL and rev are
+        if (e >= 0 && manifest.has_rev[i]) {
+            record.index.entry[e].position = (uint8_t)i;
+            stats.reused++;
+            continue;
+        }
+
+        bool frame_changed;
+        ESP_LOGI(TAG, "Frame %d: %s", i, manifest.url[i]);
+        ret = image_processor_fetch_if_changed(manifest.url[i],
+                                               e >= 0 ? record.index.entry[e].etag : NULL,
+                                               &frame_changed);
+        if (ret == ESP_OK && !frame_changed) {
+            record.index.entry[e].position = (uint8_t)i;
+            stats.reused++;
+            continue;
+        }
+        if (ret == ESP_OK) {
+            ret = store_frame(&ctx, manifest.key[i], image_processor_get_etag(), (uint8_t)i);
+        } else {
+            snprintf(error_msg, sizeof(error_msg), "%s", image_processor_get_error());
+        }
+        if (ret == ESP_OK) {
+            stats.downloads++;
+        } else {
+            ESP_LOGW(TAG, "Frame %d failed: %s", i, error_msg);
+            failed++;
+        }
+    }
+
+    // With frames missing the manifest is fetched again at the next check
+    record.index.frames = (uint8_t)manifest.count;
+    strncpy(record.index.etag, failed ? "" : manifest_etag, PLAYLIST_ETAG_LEN - 1);
+    cursor = 0;
+    ret = commit_index();
+    if (ret == ESP_OK && failed == manifest.count) {
+        ret = ESP_FAIL;  // error_msg holds the last frame's error
+    }
+
+    stats.last_sync_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGI(TAG, "Sync done in %lu ms: %d of %d frames stored",
+             (unsigned long)stats.last_sync_ms, playlist_index_listed(&record.index, NULL),
+             manifest.count);
+
+cleanup:
+    heap_caps_free(ctx.comp);
+    heap_caps_free(ctx.out);
+    playlist_manifest_free(&manifest);
+    image_processor_set_keep_alive(false);
+    return ret;
+}
+
+esp_err_t slides_show_next(image_row_sink_t sink, void *sink_ctx) {
+    int64_t start_us = esp_timer_get_time();
+    int e = (partition != NULL) ? playlist_index_next(&record.index, &cursor) : -1;
+    if (e < 0) {
+        snprintf(error_msg, sizeof(error_msg), "No stored slides");
+        return ESP_ERR_NOT_FOUND;
+    }
+    const playlist_entry_t *entry = &record.index.entry[e];
+
+    const uint8_t *src;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(partition, DATA_BASE + entry->offset, entry->size,
+                                       ESP_PARTITION_MMAP_DATA, (const void **)&src, &handle);
+    if (ret != ESP_OK) {
+        snprintf(error_msg, sizeof(error_msg), "Failed to map slide: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (esp_rom_crc32_le(0, src, entry->size) != entry->crc) {
+        snprintf(error_msg, sizeof(error_msg), "Stored slide is corrupted");
+        esp_partition_munmap(handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // Inflate through a 32 KB window, handing out complete rows
+    tinfl_decompressor *inflator = heap_caps_malloc(sizeof(tinfl_decompressor), MALLOC_CAP_DEFAULT);
+    uint8_t *window = heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_DEFAULT);
+    static uint8_t row[IMAGE_ROW_BYTES];
+    if (inflator == NULL || window == NULL) {
+        snprintf(error_msg, sizeof(error_msg), "Failed to allocate inflate buffers");
+        ret = ESP_ERR_NO_MEM;
+        goto cleanup;
+    }
+
+    tinfl_init(inflator);
+    size_t in_pos = 0, win_pos = 0, row_fill = 0;
+    uint32_t y = 0;
+    tinfl_status status;
+    do {
+        size_t in_len = entry->size - in_pos;
+        size_t out_len = TINFL_LZ_DICT_SIZE - win_pos;
+        status = tinfl_decompress(inflator, src + in_pos, &in_len, window, window + win_pos,
+                                  &out_len, 0);
+        in_pos += in_len;
+        for (size_t i = 0; i < out_len && y < IMAGE_HEIGHT; ) {
+            size_t n = out_len - i;
+            if (n > IMAGE_ROW_BYTES - row_fill) {
+                n = IMAGE_ROW_BYTES - row_fill;
+            }
+            memcpy(row + row_fill, window + win_pos + i, n);
+            row_fill += n;
+            i += n;
+            if (row_fill == IMAGE_ROW_BYTES) {
+                sink(y++, row, IMAGE_ROW_BYTES, sink_ctx);
+                row_fill = 0;
+            }
+        }
+        win_pos = (win_pos + out_len) & (TINFL_LZ_DICT_SIZE - 1);
+    } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+    if (status != TINFL_STATUS_DONE || y != IMAGE_HEIGHT) {
+        snprintf(error_msg, sizeof(error_msg), "Stored slide does not inflate (%d)", (int)status);
+        ret = ESP_ERR_INVALID_SIZE;
+        goto cleanup;
+    }
+
+    stats.shown++;
+    stats.last_show_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGI(TAG, "Slide %u of %u shown (%lu ms)", entry->position + 1, record.index.frames,
+             (unsigned long)stats.last_show_ms);
+
+cleanup:
+    heap_caps_free(inflator);
+    heap_caps_free(window);
+    esp_partition_munmap(handle);
+    return ret;
+}
+
+const char *slides_get_error(void) {
+    return error_msg;
+}
+
+void slides_get_stats(slides_stats_t *out) {
+    *out = stats;
+    out->frames = record.index.frames;
+    out->stored = (uint8_t)playlist_index_listed(&record.index, &out->stored_bytes);
+    out->capacity = record.index.data_size;
+}
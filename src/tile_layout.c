@@ -0,0 +1,120 @@
+/**
+ * @file tile_layout.c
+ * @brief Composite dashboard layout: image URLs mapped to frame regions
+ */
+
+#include "tile_layout.h"
+#include <stdio.h>
+#include <string.h>
+
+// Parse "x,y,w,h," at the start of a line; returns the characters consumed
+static int parse_rect(const char *p, const char *end, uint32_t v[4]) {
+    const char *s = p;
+    for (int i = 0; i < 4; i++) {
+        while (p < end && *p == ' ') p++;
+        if (p >= end || *p < '0' || *p > '9') {
+            return -1;
+        }
+        v[i] = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v[i] = v[i] * 10 + (uint32_t)(*p++ - '0');
+            if (v[i] > 0xFFFF) {
+                return -1;
+            }
+        }
+        while (p < end && *p == ' ') p++;
+        if (p >= end || *p != ',') {
+            return -1;
+        }
+        p++;
+    }
+    while (p < end && *p == ' ') p++;
+    return (int)(p - s);
+}
+
+bool tile_layout_parse(const char *str, uint16_t width, uint16_t height,
+                       tile_layout_t *out, char *err, size_t err_len) {
+    memset(out, 0, sizeof(*out));
+    if (str == NULL) {
+        str = "";
+    }
+
+    int line = 0;
+    const char *p = str;
+    while (*p != '\0') {
+        const char *end = p + strcspn(p, "\n");
+        const char *next = (*end == '\n') ? end + 1 : end;
+        line++;
+
+        // Trim the line; skip blank ones
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+        if (p == end) {
+            p = next;
+            continue;
+        }
+
+        uint32_t v[4];
+        int n = parse_rect(p, end, v);
+        if (n < 0 || p + n == end) {
+            if (err) snprintf(err, err_len, "Tile line %d: expected x,y,w,h,url", line);
+            return false;
+        }
+        if (v[2] == 0 || v[3] == 0 || v[0] + v[2] > width || v[1] + v[3] > height) {
+            if (err) snprintf(err, err_len, "Tile line %d: region outside the %ux%u image",
+                              line, width, height);
+            return false;
+        }
+        if (out->count == TILE_MAX) {
+            if (err) snprintf(err, err_len, "More than %d tiles", TILE_MAX);
+            return false;
+        }
+
+        tile_t *t = &out->tile[out->count++];
+        t->x = (uint16_t)v[0];
+        t->y = (uint16_t)v[1];
+        t->w = (uint16_t)v[2];
+        t->h = (uint16_t)v[3];
+        t->url = p + n;
+        t->url_len = (uint16_t)(end - (p + n));
+        p = next;
+    }
+
+    if (out->count == 0) {
+        if (err) snprintf(err, err_len, "Tile layout is empty");
+        return false;
+    }
+    return true;
+}
+
+bool tile_state_begin(const tile_state_t *stored, uint32_t key, const uint32_t *cached_crc,
+                      tile_state_t *out) {
+    bool have_base = stored->magic == TILE_STATE_MAGIC && stored->key == key &&
+                     cached_crc != NULL && stored->frame_crc == *cached_crc;
+    if (have_base) {
+        *out = *stored;
+    } else {
+        memset(out, 0, sizeof(*out));
+    }
+    out->magic = TILE_STATE_MAGIC;
+    out->key = key;
+    return have_base;
+}
+
+tile_action_t tile_state_action(bool ok, int status, bool have_base) {
+    if (!ok) {
+        return TILE_FAILED;
+    }
+    if (status == 304) {
+        // Only a conditional request can be answered 304
+        return have_base ? TILE_KEEP : TILE_FAILED;
+    }
+    return (status == 200) ? TILE_DRAW : TILE_FAILED;
+}
+
+void tile_state_drawn(tile_state_t *s, int index, const char *etag) {
+    if (etag == NULL || strlen(etag) >= TILE_ETAG_LEN) {
+        etag = "";
+    }
+    strcpy(s->etag[index], etag);
+}
@@ -0,0 +1,384 @@
+/**
+ * @file tiles.c
+ * @brief Composite dashboard: tiles fetched concurrently, redrawn only when changed
+ */
+
+#include "tiles.h"
+#include "tile_layout.h"
+#include "playlist.h"
+#include "framecache.h"
+#include "http_cache.h"
+#include "image_processor.h"
+#include "config.h"
+#include "esp_attr.h"
+#include "esp_crt_bundle.h"
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "TILES";
+
+#define FETCH_TASKS        2           // Concurrent connections
+#define FETCH_STACK        8192        // TLS handshake runs on the worker stack
+#define TILE_BUF_INITIAL   (64 * 1024)
+#define TILE_BUF_MAX       (1024 * 1024)
+#define TILE_DONE_BIT(i)   (1u << (i))
+#define WORKER_EXIT_BIT(w) (1u << (TILE_MAX + (w)))
+
+// One tile download, filled by a worker
+typedef struct {
+    char *url;                      // Absolute URL (heap)
+    const char *etag;               // Sent as If-None-Match, NULL for a plain request
+    uint8_t *data;                  // PNG (PSRAM)
+    size_t len;
+    size_t cap;
+    bool overflow;
+    int status;
+    esp_err_t ret;
+    http_cache_hints_t hints;
+} tile_slot_t;
+
+static tile_slot_t slots[TILE_MAX];
+static int slot_count = 0;
+static int next_slot = 0;               // Next tile for a worker (atomic)
+static EventGroupHandle_t done_bits = NULL;
+
+static tile_state_t loaded;             // State read from NVS
+static tile_state_t pending;            // State of the frame composed last
+static bool cfg_skip_ssl = false;
+static int64_t next_change_us = -1;
+static char error_msg[128] = {0};
+
+static RTC_DATA_ATTR tiles_stats_t stats;
+
+static esp_err_t tile_http_event(esp_http_client_event_t *evt) {
+    tile_slot_t *slot = (tile_slot_t *)evt->user_data;
+
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_HEADER:
+            http_cache_parse_header(&slot->hints, evt->header_key, evt->header_value);
+            break;
+        case HTTP_EVENT_ON_DATA:
+            if (slot->overflow) {
+                break;
+            }
+            if (slot->len + evt->data_len > slot->cap) {
+                size_t cap = slot->cap ? slot->cap : TILE_BUF_INITIAL;
+                while (cap < slot->len + evt->data_len) {
+                    cap *= 2;
+                }
+                uint8_t *p = (cap <= TILE_BUF_MAX) ?
+                             heap_caps_realloc(slot->data, cap, MALLOC_CAP_SPIRAM) : NULL;
+                if (p == NULL) {
+                    slot->overflow = true;
+                    break;
+                }
+                slot->data = p;
+                slot->cap = cap;
+            }
+            memcpy(slot->data + slot->len, evt->data, evt->data_len);
+            slot->len += evt->data_len;
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+// Download one tile on the worker's connection (created on first use and
+// dropped after a failure)
+static void fetch_slot(esp_http_client_handle_t *client, tile_slot_t *slot) {
+    http_cache_hints_reset(&slot->hints);
+    slot->ret = ESP_FAIL;
+
+    if (*client == NULL) {
+        esp_http_client_config_t config = {
+            .url = slot->url,
+            .event_handler = tile_http_event,
+            .user_data = slot,
+            .timeout_ms = 30000,
+            .buffer_size = 4096,
+            .buffer_size_tx = 1024,
+        };
+        if (cfg_skip_ssl) {
+            config.skip_cert_common_name_check = true;
+        } else {
+            config.crt_bundle_attach = esp_crt_bundle_attach;
+        }
+        *client = esp_http_client_init(&config);
+        if (*client == NULL) {
+            return;
+        }
+    } else {
+        esp_http_client_set_url(*client, slot->url);
+        esp_http_client_set_user_data(*client, slot);
+    }
+
+    if (slot->etag != NULL && slot->etag[0] != '\0') {
+        esp_http_client_set_header(*client, "If-None-Match", slot->etag);
+    } else {
+        esp_http_client_delete_header(*client, "If-None-Match");
+    }
+
+    slot->ret = esp_http_client_perform(*client);
+    if (slot->ret == ESP_OK) {
+        slot->status = esp_http_client_get_status_code(*client);
+        if (slot->overflow) {
+            slot->ret = ESP_ERR_NO_MEM;
+        }
+    } else {
+        esp_http_client_cleanup(*client);
+        *client = NULL;
+    }
+}
+
+// Worker: take tiles in layout order until none are left
+static void fetch_task(void *arg) {
+    int worker = (int)(intptr_t)arg;
+    esp_http_client_handle_t client = NULL;
+    int i;
+
+    while ((i = __atomic_fetch_add(&next_slot, 1, __ATOMIC_SEQ_CST)) < slot_count) {
+        fetch_slot(&client, &slots[i]);
+        xEventGroupSetBits(done_bits, TILE_DONE_BIT(i));
+    }
+    if (client != NULL) {
+        esp_http_client_cleanup(client);
+    }
+    xEventGroupSetBits(done_bits, WORKER_EXIT_BIT(worker));
+    vTaskDelete(NULL);
+}
+
+static void free_slots(void) {
+    for (int i = 0; i < slot_count; i++) {
+        free(slots[i].url);
+        heap_caps_free(slots[i].data);
+    }
+    memset(slots, 0, sizeof(slots));
+    slot_count = 0;
+}
+
+static void load_state(void) {
+    nvs_handle_t nvs_handle;
+    size_t len = sizeof(loaded);
+
+    memset(&loaded, 0, sizeof(loaded));
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_blob(nvs_handle, NVS_TILES_BLOB, &loaded, &len) != ESP_OK ||
+        len != sizeof(loaded) || loaded.magic != TILE_STATE_MAGIC) {
+        memset(&loaded, 0, sizeof(loaded));
+    }
+    nvs_close(nvs_handle);
+}
+
+// Fold a tile's cache headers into next_change_us
+static void note_cache_hints(const tile_slot_t *slot) {
+    time_t now = time(NULL);
+    uint32_t delay_s;
+
+    // Before 2020 the clock has not been set
+    if (!http_cache_next_change_s(&slot->hints, slot->status, now > 1577836800 ? now : 0, &delay_s)) {
+        return;
+    }
+    int64_t at_us = esp_timer_get_time() + (int64_t)delay_s * 1000000;
+    if (next_change_us < 0 || at_us < next_change_us) {
+        next_change_us = at_us;
+    }
+}
+
+void tiles_set_ssl_skip(bool skip) {
+    cfg_skip_ssl = skip;
+}
+
+esp_err_t tiles_update(const char *layout_str, const char *base_url, uint32_t render_key,
+                       uint8_t *frame, bool *changed) {
+    tile_layout_t layout;
+    esp_err_t ret = ESP_OK;
+    int64_t start_us = esp_timer_get_time();
+    int64_t render_us = 0;
+
+    *changed = true;
+    memset(&stats, 0, sizeof(stats));
+    if (!tile_layout_parse(layout_str, IMAGE_WIDTH, IMAGE_HEIGHT, &layout,
+                           error_msg, sizeof(error_msg))) {
+        ESP_LOGE(TAG, "%s", error_msg);
+        return ESP_ERR_INVALID_ARG;
+    }
+    stats.tiles = layout.count;
+
+    uint32_t key = playlist_hash(layout_str, strlen(layout_str), render_key);
+    key = playlist_hash(base_url, strlen(base_url), key);
+
+    // Unchanged tiles are taken from the cached frame, if it is the one the
+    // stored ETags belong to
+    load_state();
+    const framecache_meta_t *meta = framecache_current();
+    bool have_base = tile_state_begin(&loaded, key, meta ? &meta->frame_crc : NULL, &pending);
+    if (have_base) {
+        const uint8_t *cached;
+        esp_partition_mmap_handle_t handle;
+        if (framecache_map(&cached, &handle) == ESP_OK) {
+            memcpy(frame, cached, IMAGE_BUFFER_SIZE);
+            framecache_unmap(handle);
+        } else {
+            have_base = tile_state_begin(&loaded, key, NULL, &pending);
+        }
+    }
+    if (!have_base) {
+        memset(frame, (EPD_PANEL_WHITE << 4) | EPD_PANEL_WHITE, IMAGE_BUFFER_SIZE);
+    }
+
+    for (int i = 0; i < layout.count; i++) {
+        const tile_t *t = &layout.tile[i];
+        size_t cap = strlen(base_url) + t->url_len + 2;
+        static char ref[MAX_TILE_LAYOUT_LEN];
+
+        memcpy(ref, t->url, t->url_len);  // Shorter than the layout string
+        ref[t->url_len] = '\0';
+        slots[i].url = malloc(cap);
+        if (slots[i].url == NULL || !playlist_resolve_url(base_url, ref, slots[i].url, cap)) {
+            snprintf(error_msg, sizeof(error_msg), "Tile %d: URL too long", i);
+            slot_count = i + 1;
+            free_slots();
+            return ESP_ERR_INVALID_ARG;
+        }
+        slots[i].etag = have_base ? loaded.etag[i] : NULL;
+    }
+    slot_count = layout.count;
+    next_slot = 0;
+
+    if (done_bits == NULL) {
+        done_bits = xEventGroupCreate();
+    }
+    xEventGroupClearBits(done_bits, 0xFFFFFF);
+
+    int workers = 0;
+    for (int w = 0; w < FETCH_TASKS && w < slot_count; w++) {
+        if (xTaskCreate(fetch_task, "tile_fetch", FETCH_STACK, (void *)(intptr_t)w, 5, NULL) == pdPASS) {
+            workers++;
+        }
+    }
+    if (workers == 0) {
+        snprintf(error_msg, sizeof(error_msg), "Failed to start tile downloads");
+        free_slots();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Fetching %d tiles on %d connections%s", slot_count, workers,
+             have_base ? " (conditional)" : "");
+
+    // Render in layout order as the tiles arrive; later tiles keep downloading
+    bool any_changed = !have_base;
+    for (int i = 0; i < slot_count; i++) {
+        tile_slot_t *slot = &slots[i];
+        const tile_t *t = &layout.tile[i];
+
+        xEventGroupWaitBits(done_bits, TILE_DONE_BIT(i), pdFALSE, pdTRUE, portMAX_DELAY);
+        note_cache_hints(slot);
+
+        esp_err_t r = slot->ret;
+        tile_action_t action = tile_state_action(r == ESP_OK, slot->status, have_base);
+        if (action == TILE_KEEP) {
+            ESP_LOGI(TAG, "Tile %d unchanged", i);
+            stats.unchanged++;
+            continue;
+        }
+        if (r == ESP_OK && action == TILE_FAILED) {
+            r = ESP_FAIL;
+            snprintf(error_msg, sizeof(error_msg), "Tile %d: HTTP error %d", i, slot->status);
+        } else if (r == ESP_OK) {
+            int64_t t0 = esp_timer_get_time();
+            stats.bytes += slot->len;
+            r = image_processor_render_tile(slot->data, slot->len, frame, t->x, t->y, t->w, t->h);
+            render_us += esp_timer_get_time() - t0;
+            if (r != ESP_OK) {
+                snprintf(error_msg, sizeof(error_msg), "Tile %d: %s", i, image_processor_get_error());
+            }
+        } else {
+            snprintf(error_msg, sizeof(error_msg), "Tile %d: %s", i,
+                     slot->ret == ESP_ERR_NO_MEM ? "image too large" : esp_err_to_name(slot->ret));
+        }
+
+        // Free the download now, the other tiles may still need the memory
+        heap_caps_free(slot->data);
+        slot->data = NULL;
+
+        if (r != ESP_OK) {
+            ESP_LOGE(TAG, "%s", error_msg);
+            stats.failed++;
+            if (!have_base) {
+                ret = ESP_FAIL;  // Nothing to fill the gap with
+            }
+            continue;
+        }
+        tile_state_drawn(&pending, i, slot->hints.etag);
+        stats.fetched++;
+        any_changed = true;
+    }
+
+    EventBits_t exit_bits = 0;
+    for (int w = 0; w < workers; w++) {
+        exit_bits |= WORKER_EXIT_BIT(w);
+    }
+    xEventGroupWaitBits(done_bits, exit_bits, pdFALSE, pdTRUE, portMAX_DELAY);
+    free_slots();
+
+    stats.fetch_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    stats.render_ms = (uint32_t)(render_us / 1000);
+    ESP_LOGI(TAG, "%u tiles redrawn, %u unchanged, %u failed (%lu ms, render %lu ms)",
+             stats.fetched, stats.unchanged, stats.failed,
+             (unsigned long)stats.fetch_ms, (unsigned long)stats.render_ms);
+
+    *changed = any_changed;
+    return ret;
+}
+
+esp_err_t tiles_commit(uint32_t frame_crc) {
+    pending.frame_crc = frame_crc;
+    if (memcmp(&pending, &loaded, sizeof(pending)) == 0) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs_handle, NVS_TILES_BLOB, &pending, sizeof(pending));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save tile state: %s", esp_err_to_name(err));
+        return err;
+    }
+    loaded = pending;
+    return ESP_OK;
+}
+
+bool tiles_get_next_change(uint32_t *seconds) {
+    if (next_change_us < 0) {
+        return false;
+    }
+    int64_t remaining_us = next_change_us - esp_timer_get_time();
+    *seconds = (remaining_us > 0) ? (uint32_t)((remaining_us + 999999) / 1000000) : 0;
+    return true;
+}
+
+const char *tiles_get_error(void) {
+    return error_msg;
+}
+
+void tiles_get_stats(tiles_stats_t *out) {
+    *out = stats;
+}
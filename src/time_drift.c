@@ -0,0 +1,84 @@
+/**
+ * @file time_drift.c
+ * @brief RTC clock drift estimation and NTP scheduling
+ */
+
+#include "time_drift.h"
+
+#define TIME_DRIFT_MAGIC 0x54445231  // "TDR1"
+
+// Drift state holds a sync baseline
+static bool drift_valid(const time_drift_t *d) {
+    return d->magic == TIME_DRIFT_MAGIC && d->last_sync_us > 0;
+}
+
+void time_drift_on_sync(time_drift_t *d, int64_t clock_us, int64_t ntp_us) {
+    if (drift_valid(d)) {
+        int64_t elapsed_us = ntp_us - d->last_sync_us;
+
+        if (elapsed_us >= (int64_t)TIME_DRIFT_MIN_INTERVAL_S * 1000000) {
+            // Error the clock would have had without our corrections
+            int64_t raw_offset_us = (clock_us - ntp_us) + d->applied_us;
+            int64_t ppb = raw_offset_us * 1000 / (elapsed_us / 1000000);
+
+            if (ppb > -TIME_DRIFT_MAX_PPB && ppb < TIME_DRIFT_MAX_PPB) {
+                // Exponential average, new samples weigh 1/4
+                d->drift_ppb = (d->samples == 0) ? (int32_t)ppb
+                                                 : (int32_t)((3 * (int64_t)d->drift_ppb + ppb) / 4);
+                if (d->samples < UINT8_MAX) {
+                    d->samples++;
+                }
+            }
+        } else if (elapsed_us >= 0) {
+            return;  // Keep the older baseline for a longer measurement next time
+        }
+    } else {
+        d->drift_ppb = 0;
+        d->samples = 0;
+    }
+
+    d->magic = TIME_DRIFT_MAGIC;
+    d->last_sync_us = ntp_us;
+    d->applied_us = 0;
+}
+
+uint32_t time_drift_predicted_error_ms(const time_drift_t *d, int64_t clock_us) {
+    if (!drift_valid(d) || clock_us < d->last_sync_us) {
+        return UINT32_MAX;
+    }
+
+    int64_t ppb = (d->samples > 0) ? TIME_DRIFT_RESIDUAL_PPB : TIME_DRIFT_UNKNOWN_PPB;
+    int64_t error_ms = (clock_us - d->last_sync_us) / 1000 * ppb / 1000000000;
+    return (error_ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)error_ms;
+}
+
+bool time_drift_sync_needed(const time_drift_t *d, int64_t clock_us,
+                            uint32_t max_error_ms, uint32_t max_age_s) {
+    if (max_error_ms == 0 || !drift_valid(d) || clock_us < d->last_sync_us) {
+        return true;
+    }
+    if (clock_us - d->last_sync_us >= (int64_t)max_age_s * 1000000) {
+        return true;
+    }
+    return time_drift_predicted_error_ms(d, clock_us) > max_error_ms;
+}
+
+int64_t time_drift_compensate(time_drift_t *d, int64_t clock_us) {
+    if (!drift_valid(d) || d->samples == 0 || clock_us < d->last_sync_us) {
+        return 0;
+    }
+
+    // Total drift since the sync, minus what was already taken off the clock
+    int64_t total_us = (clock_us - d->last_sync_us) / 1000 * d->drift_ppb / 1000000;
+    int64_t correction_us = total_us - d->applied_us;
+    d->applied_us = total_us;
+    return correction_us;
+}
+
+uint64_t time_drift_clock_duration_us(const time_drift_t *d, uint64_t duration_us) {
+    if (!drift_valid(d) || d->samples == 0) {
+        return duration_us;
+    }
+    // A fast clock counts more than the true duration
+    return duration_us + (int64_t)duration_us / 1000 * d->drift_ppb / 1000000;
+}
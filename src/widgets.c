@@ -0,0 +1,461 @@
+/**
+ * @file widgets.c
+ * @brief On-device dashboard rendering from a JSON data feed
+ */
+
+#include "widgets.h"
+#include "gfx.h"
+#include "cJSON.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DISPLAY_WIDTH  EPD_PANEL_WIDTH
+
+#define MAX_SCALE      8    // Largest text/icon magnification
+#define MAX_PATH_KEY   64   // Longest object key in a data path
+#define MAX_FORMAT     16   // Longest printf format in a placeholder
+
+static const struct {
+    const char *name;
+    uint8_t code;
+} colors[] = {
+    { "black",  EPD_PANEL_BLACK  },
+    { "white",  EPD_PANEL_WHITE  },
+    { "yellow", EPD_PANEL_YELLOW },
+    { "red",    EPD_PANEL_RED    },
+    { "orange", 0x4              },
+    { "blue",   EPD_PANEL_BLUE   },
+    { "green",  EPD_PANEL_GREEN  },
+};
+
+static void set_error(char *err, size_t err_len, const char *msg, int item) {
+    if (err != NULL && err_len > 0) {
+        if (item >= 0) {
+            snprintf(err, err_len, "Item %d: %s", item + 1, msg);
+        } else {
+            snprintf(err, err_len, "%s", msg);
+        }
+    }
+}
+
+// Color of an object's "color" (or other) field; false if the name is unknown
+static bool get_color(const cJSON *obj, const char *field, uint8_t def, uint8_t *out) {
+    const cJSON *c = cJSON_GetObjectItem(obj, field);
+    *out = def;
+    if (c == NULL) {
+        return true;
+    }
+    if (!cJSON_IsString(c)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+        if (strcmp(colors[i].name, c->valuestring) == 0) {
+            *out = colors[i].code;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Truncate to an int; false for NaN, infinities and values out of range,
+// for which the conversion is undefined
+static bool to_int(double d, int *out) {
+    if (!(d > (double)INT_MIN - 1 && d < (double)INT_MAX + 1)) {
+        return false;
+    }
+    *out = (int)d;
+    return true;
+}
+
+static int get_int(const cJSON *obj, const char *field, int def) {
+    const cJSON *v = cJSON_GetObjectItem(obj, field);
+    int i;
+    return cJSON_IsNumber(v) && to_int(v->valuedouble, &i) ? i : def;
+}
+
+static const char *get_string(const cJSON *obj, const char *field) {
+    const cJSON *v = cJSON_GetObjectItem(obj, field);
+    return cJSON_IsString(v) ? v->valuestring : NULL;
+}
+
+static int clamp_scale(int scale) {
+    return scale < 1 ? 1 : (scale > MAX_SCALE ? MAX_SCALE : scale);
+}
+
+// Follow a dot-separated path of object keys and array indexes
+static const cJSON *lookup(const cJSON *node, const char *path, size_t len) {
+    const char *end = path + len;
+    while (node != NULL && path < end) {
+        const char *dot = memchr(path, '.', (size_t)(end - path));
+        size_t n = (size_t)((dot ? dot : end) - path);
+        char key[MAX_PATH_KEY];
+        if (n == 0 || n >= sizeof(key)) {
+            return NULL;
+        }
+        memcpy(key, path, n);
+        key[n] = '\0';
+
+        if (cJSON_IsArray(node)) {
+            if (strspn(key, "0123456789") != n) {
+                return NULL;
+            }
+            node = cJSON_GetArrayItem(node, atoi(key));
+        } else {
+            node = cJSON_GetObjectItem(node, key);
+        }
+        path += n + (dot ? 1 : 0);
+    }
+    return node;
+}
+
+// Accept "%[flags][width][.precision](d|f|g|e|E)" only, as it is passed to snprintf
+static char number_format(const char *fmt) {
+    const char *p = fmt;
+    if (*p++ != '%') {
+        return 0;
+    }
+    p += strspn(p, "-+ 0#");
+    p += strspn(p, "0123456789");
+    if (*p == '.') {
+        p++;
+        p += strspn(p, "0123456789");
+    }
+    if (strchr("dfgeE", *p) == NULL || *p == '\0' || p[1] != '\0') {
+        return 0;
+    }
+    return *p;
+}
+
+// Format a number for a placeholder; integers that do not fit an int are
+// shown with %g, like fractions
+static void format_number(double d, const char *fmt, char *out, size_t out_len) {
+    int i;
+    bool is_int = to_int(d, &i);
+    if (fmt != NULL) {
+        char conv = number_format(fmt);
+        if (conv == 'd' && is_int) {
+            snprintf(out, out_len, fmt, i);
+        } else if (conv == 'd') {
+            snprintf(out, out_len, "%g", d);
+        } else if (conv != 0) {
+            snprintf(out, out_len, fmt, d);
+        } else {
+            snprintf(out, out_len, "?");
+        }
+    } else if (is_int && (double)i == d) {
+        snprintf(out, out_len, "%d", i);
+    } else {
+        snprintf(out, out_len, "%g", d);
+    }
+}
+
+// Format one value for a {path} or {path:fmt} placeholder
+static void format_value(const cJSON *v, const char *fmt, char *out, size_t out_len) {
+    if (cJSON_IsString(v)) {
+        snprintf(out, out_len, "%s", v->valuestring);
+    } else if (cJSON_IsBool(v)) {
+        snprintf(out, out_len, "%s", cJSON_IsTrue(v) ? "true" : "false");
+    } else if (!cJSON_IsNumber(v)) {
+        snprintf(out, out_len, "--");
+    } else {
+        format_number(v->valuedouble, fmt, out, out_len);
+    }
+}
+
+// Replace the placeholders in a text item
+static void expand_text(const char *text, const cJSON *data, char *out, size_t out_len) {
+    size_t o = 0;
+    while (*text && o + 1 < out_len) {
+        const char *close = (*text == '{') ? strchr(text, '}') : NULL;
+        if (close == NULL) {
+            out[o++] = *text++;
+            continue;
+        }
+
+        const char *path = text + 1;
+        size_t path_len = (size_t)(close - path);
+        const char *colon = memchr(path, ':', path_len);
+        char fmt[MAX_FORMAT];
+        const char *fmt_p = NULL;
+        if (colon != NULL) {
+            size_t fmt_len = (size_t)(close - colon - 1);
+            if (fmt_len < sizeof(fmt)) {
+                memcpy(fmt, colon + 1, fmt_len);
+                fmt[fmt_len] = '\0';
+                fmt_p = fmt;
+            } else {
+                fmt[0] = '\0';
+                fmt_p = fmt;  // Rejected by number_format()
+            }
+            path_len = (size_t)(colon - path);
+        }
+
+        format_value(lookup(data, path, path_len), fmt_p, out + o, out_len - o);
+        o += strlen(out + o);
+        text = close + 1;
+    }
+    out[o] = '\0';
+}
+
+// Value range of a numeric array; false if it holds no numbers
+static bool array_range(const cJSON *arr, double *lo, double *hi) {
+    bool any = false;
+    const cJSON *v;
+    cJSON_ArrayForEach(v, arr) {
+        if (!cJSON_IsNumber(v)) {
+            continue;
+        }
+        if (!any || v->valuedouble < *lo) *lo = v->valuedouble;
+        if (!any || v->valuedouble > *hi) *hi = v->valuedouble;
+        any = true;
+    }
+    return any;
+}
+
+// Axis range for a bar or line chart
+static bool chart_range(const cJSON *item, const cJSON *arr, bool bars, double *lo, double *hi) {
+    if (!array_range(arr, lo, hi)) {
+        return false;
+    }
+    if (bars) {
+        if (*lo > 0) *lo = 0;
+        if (*hi < 0) *hi = 0;
+    }
+    const cJSON *mn = cJSON_GetObjectItem(item, "min");
+    const cJSON *mx = cJSON_GetObjectItem(item, "max");
+    if (cJSON_IsNumber(mn)) *lo = mn->valuedouble;
+    if (cJSON_IsNumber(mx)) *hi = mx->valuedouble;
+    if (*hi <= *lo) {
+        *hi = *lo + 1;
+    }
+    return true;
+}
+
+// Pixel offset of a value from the top of a chart of height h
+static int chart_y(double v, double lo, double hi, int h) {
+    if (v < lo) v = lo;
+    if (v > hi) v = hi;
+    double off = (hi - v) * (h - 1) / (hi - lo);
+    if (!(off > 0)) {
+        return 0;       // Also NaN, from infinite values
+    }
+    return off < h - 1 ? (int)(off + 0.5) : h - 1;
+}
+
+static void draw_bars(uint8_t *fb, const cJSON *item, const cJSON *arr,
+                      int x, int y, int w, int h, uint8_t color) {
+    double lo, hi;
+    int n = cJSON_GetArraySize(arr);
+    if (n == 0 || !chart_range(item, arr, true, &lo, &hi)) {
+        return;
+    }
+    int gap = get_int(item, "gap", 2);
+    int bar_w = (w - gap * (n - 1)) / n;
+    if (bar_w < 1) {
+        bar_w = 1;
+    }
+    int base = chart_y(0, lo, hi, h);
+
+    int i = 0;
+    const cJSON *v;
+    cJSON_ArrayForEach(v, arr) {
+        if (!cJSON_IsNumber(v)) {
+            i++;
+            continue;
+        }
+        int top = chart_y(v->valuedouble, lo, hi, h);
+        int y0 = top < base ? top : base;
+        int y1 = top < base ? base : top;
+        gfx_fill_rect(fb, x + i * (bar_w + gap), y + y0, bar_w, y1 - y0 + 1, color);
+        i++;
+    }
+}
+
+static void draw_chart(uint8_t *fb, const cJSON *item, const cJSON *arr,
+                       int x, int y, int w, int h, uint8_t color) {
+    double lo, hi;
+    int n = cJSON_GetArraySize(arr);
+    if (n == 0 || !chart_range(item, arr, false, &lo, &hi)) {
+        return;
+    }
+    int thickness = get_int(item, "thickness", 2);
+    bool have_prev = false;
+    int px = 0, py = 0;
+
+    int i = 0;
+    const cJSON *v;
+    cJSON_ArrayForEach(v, arr) {
+        if (!cJSON_IsNumber(v)) {
+            have_prev = false;  // Gap in the data breaks the line
+            i++;
+            continue;
+        }
+        int cx = x + (n > 1 ? i * (w - 1) / (n - 1) : 0);
+        int cy = y + chart_y(v->valuedouble, lo, hi, h);
+        gfx_draw_line(fb, have_prev ? px : cx, have_prev ? py : cy, cx, cy, color, thickness);
+        px = cx;
+        py = cy;
+        have_prev = true;
+        i++;
+    }
+}
+
+// Check one item and, with a frame, draw it
+static bool draw_item(uint8_t *fb, const cJSON *item, const cJSON *data,
+                      int index, char *err, size_t err_len) {
+    const char *type = get_string(item, "type");
+    uint8_t color;
+    if (!cJSON_IsObject(item) || type == NULL) {
+        set_error(err, err_len, "missing \"type\"", index);
+        return false;
+    }
+    if (!get_color(item, "color", EPD_PANEL_BLACK, &color)) {
+        set_error(err, err_len, "unknown color", index);
+        return false;
+    }
+
+    int x = get_int(item, "x", 0);
+    int y = get_int(item, "y", 0);
+    int w = get_int(item, "w", 0);
+    int h = get_int(item, "h", 0);
+
+    if (strcmp(type, "text") == 0) {
+        const char *text = get_string(item, "text");
+        if (text == NULL) {
+            set_error(err, err_len, "text without \"text\"", index);
+            return false;
+        }
+        if (fb != NULL) {
+            char buf[WIDGETS_TEXT_LEN];
+            int scale = clamp_scale(get_int(item, "size", 1));
+            const char *align = get_string(item, "align");
+            int right = w > 0 ? x + w : DISPLAY_WIDTH;
+            expand_text(text, data, buf, sizeof(buf));
+            if (w > 0 && align != NULL) {
+                int slack = w - gfx_text_width(buf, scale);
+                if (slack > 0 && strcmp(align, "center") == 0) {
+                    x += slack / 2;
+                } else if (slack > 0 && strcmp(align, "right") == 0) {
+                    x += slack;
+                }
+            }
+            gfx_draw_text(fb, x, y, buf, color, scale, right);
+        }
+    } else if (strcmp(type, "rect") == 0) {
+        if (fb != NULL) {
+            const cJSON *fill = cJSON_GetObjectItem(item, "fill");
+            if (cJSON_IsTrue(fill)) {
+                gfx_fill_rect(fb, x, y, w, h, color);
+            } else {
+                gfx_draw_rect(fb, x, y, w, h, color, get_int(item, "thickness", 1));
+            }
+        }
+    } else if (strcmp(type, "line") == 0) {
+        if (fb != NULL) {
+            gfx_draw_line(fb, x, y, get_int(item, "x2", x), get_int(item, "y2", y), color,
+                          get_int(item, "thickness", 1));
+        }
+    } else if (strcmp(type, "bars") == 0 || strcmp(type, "chart") == 0) {
+        const char *key = get_string(item, "key");
+        if (key == NULL || w <= 0 || h <= 0) {
+            set_error(err, err_len, "chart needs \"key\", \"w\" and \"h\"", index);
+            return false;
+        }
+        const cJSON *arr = lookup(data, key, strlen(key));
+        if (fb != NULL && cJSON_IsArray(arr)) {
+            if (type[0] == 'b') {
+                draw_bars(fb, item, arr, x, y, w, h, color);
+            } else {
+                draw_chart(fb, item, arr, x, y, w, h, color);
+            }
+        }
+    } else if (strcmp(type, "icon") == 0) {
+        const char *name = get_string(item, "name");
+        const char *key = get_string(item, "key");
+        if (name == NULL && key == NULL) {
+            set_error(err, err_len, "icon needs \"name\" or \"key\"", index);
+            return false;
+        }
+        if (fb != NULL) {
+            int scale = clamp_scale(get_int(item, "size", 1));
+            if (name == NULL) {
+                const cJSON *v = lookup(data, key, strlen(key));
+                name = cJSON_IsString(v) ? v->valuestring : "";
+            }
+            if (!gfx_draw_icon(fb, x, y, name, color, scale)) {
+                gfx_draw_char(fb, x + 4 * scale, y, '?', color, scale);  // Unknown icon
+            }
+        }
+    } else {
+        set_error(err, err_len, "unknown type", index);
+        return false;
+    }
+    return true;
+}
+
+// Check a parsed template and, with a frame, render it
+static bool run(const cJSON *tmpl, const cJSON *data, uint8_t *fb, char *err, size_t err_len) {
+    uint8_t bg;
+    if (!cJSON_IsObject(tmpl)) {
+        set_error(err, err_len, "Template is not a JSON object", -1);
+        return false;
+    }
+    if (!get_color(tmpl, "bg", EPD_PANEL_WHITE, &bg)) {
+        set_error(err, err_len, "Unknown background color", -1);
+        return false;
+    }
+    const cJSON *items = cJSON_GetObjectItem(tmpl, "items");
+    int n = cJSON_IsArray(items) ? cJSON_GetArraySize(items) : 0;
+    if (n == 0) {
+        set_error(err, err_len, "Template has no items", -1);
+        return false;
+    }
+    if (n > WIDGETS_MAX_ITEMS) {
+        set_error(err, err_len, "Template has too many items", -1);
+        return false;
+    }
+
+    if (fb != NULL) {
+        memset(fb, (bg << 4) | bg, EPD_PANEL_BUFFER_SIZE);
+    }
+    int i = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, items) {
+        if (!draw_item(fb, item, data, i++, err, err_len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool widgets_check(const char *tmpl, char *err, size_t err_len) {
+    cJSON *root = cJSON_Parse(tmpl);
+    if (root == NULL) {
+        set_error(err, err_len, "Template is not valid JSON", -1);
+        return false;
+    }
+    bool ok = run(root, NULL, NULL, err, err_len);
+    cJSON_Delete(root);
+    return ok;
+}
+
+bool widgets_render(const char *tmpl, const char *data, size_t data_len,
+                    uint8_t *frame, char *err, size_t err_len) {
+    cJSON *root = cJSON_Parse(tmpl);
+    if (root == NULL) {
+        set_error(err, err_len, "Template is not valid JSON", -1);
+        return false;
+    }
+    cJSON *doc = cJSON_ParseWithLength(data, data_len);
+    if (doc == NULL) {
+        set_error(err, err_len, "Data is not valid JSON", -1);
+        cJSON_Delete(root);
+        return false;
+    }
+    bool ok = run(root, doc, frame, err, err_len);
+    cJSON_Delete(doc);
+    cJSON_Delete(root);
+    return ok;
+}
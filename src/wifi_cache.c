@@ -0,0 +1,211 @@
+/**
+ * @file wifi_cache.c
+ * @brief Fast WiFi reconnect using AP and DHCP lease data kept in RTC memory
+ */
+
+#include "wifi_cache.h"
+#include "config.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "lwip/dhcp.h"
+#include "lwip/init.h"
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "WIFI_CACHE";
+
+#define WIFI_CACHE_MAGIC 0x57434331  // "WCC1"
+
+// Contents survive deep sleep (not a power cycle)
+typedef struct {
+    uint32_t magic;
+    uint32_t cred_hash;         // SSID + password the entry belongs to
+    uint8_t bssid[6];
+    uint8_t channel;
+    bool lease_valid;
+    esp_netif_ip_info_t ip;
+    esp_netif_dns_info_t dns[2];
+    time_t lease_start;         // RTC time the lease was obtained
+    uint32_t lease_s;           // Lease time from the DHCP server
+} wifi_cache_entry_t;
+
+static RTC_DATA_ATTR wifi_cache_entry_t cache;
+static RTC_DATA_ATTR wifi_cache_stats_t stats;
+_Static_assert(sizeof(cache) <= RTC_MODULE_STATE_MAX, "WiFi cache exceeds its share of RTC memory");
+
+// FNV-1a over SSID and password, so changed credentials invalidate the cache
+static uint32_t cred_hash(const char *ssid, const char *password) {
+    uint32_t h = 2166136261u;
+    for (const char *s = ssid; *s; s++) {
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    }
+    h = (h ^ 0xFF) * 16777619u;  // Separator
+    for (const char *s = password; *s; s++) {
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    }
+    return h;
+}
+
+// Lease time of the DHCP client's current lease, 0 if unknown. esp_netif has
+// no getter for it, so it is read from lwIP's client state: struct dhcp is
+// internal to lwIP, and offered_t0_lease is checked for lwIP 2.0 to 2.2
+// only. With any other version no lease is cached and every connect runs
+// DHCP (the cached AP is still used).
+static uint32_t dhcp_lease_s(esp_netif_t *netif) {
+#if LWIP_VERSION_MAJOR == 2 && LWIP_VERSION_MINOR <= 2
+    struct dhcp *dhcp = netif_dhcp_data((struct netif *)esp_netif_get_netif_impl(netif));
+    return (dhcp != NULL) ? dhcp->offered_t0_lease : 0;
+#else
+    return 0;
+#endif
+}
+
+uint32_t wifi_cache_lease_left_s(time_t lease_start, uint32_t lease_s, time_t now) {
+    // Only reuse the lease while the client would still be in BOUND state
+    time_t t1 = (time_t)(lease_s / 2);
+    if (now < lease_start || now - lease_start >= t1) {
+        return 0;
+    }
+    return (uint32_t)(t1 - (now - lease_start));
+}
+
+// Cached entry matches the configured credentials
+static bool cache_matches(const char *ssid, const char *password) {
+    return cache.magic == WIFI_CACHE_MAGIC && cache.cred_hash == cred_hash(ssid, password);
+}
+
+// Undo apply_lease(): clear the address and restart the DHCP client
+static void restore_dhcp(esp_netif_t *netif) {
+    esp_netif_ip_info_t zero = {0};
+    esp_netif_set_ip_info(netif, &zero);
+    esp_netif_dhcpc_start(netif);
+}
+
+// Fill in the cached BSSID and channel if they belong to these credentials
+static bool prepare_ap(const char *ssid, const char *password, wifi_sta_config_t *sta) {
+    if (!cache_matches(ssid, password) || cache.channel == 0) {
+        return false;
+    }
+
+    memcpy(sta->bssid, cache.bssid, sizeof(sta->bssid));
+    sta->bssid_set = true;
+    sta->channel = cache.channel;
+    sta->scan_method = WIFI_FAST_SCAN;
+
+    ESP_LOGI(TAG, "Using cached AP %02x:%02x:%02x:%02x:%02x:%02x on channel %d",
+             cache.bssid[0], cache.bssid[1], cache.bssid[2],
+             cache.bssid[3], cache.bssid[4], cache.bssid[5], cache.channel);
+    return true;
+}
+
+// Apply the cached lease as a temporary static configuration (DHCP client
+// stopped), if it is still before its T1 renewal time
+static bool apply_lease(esp_netif_t *netif) {
+    if (cache.magic != WIFI_CACHE_MAGIC || !cache.lease_valid) {
+        return false;
+    }
+
+    uint32_t left_s = wifi_cache_lease_left_s(cache.lease_start, cache.lease_s, time(NULL));
+    if (left_s == 0) {
+        ESP_LOGI(TAG, "Cached lease past T1, using DHCP");
+        return false;
+    }
+
+    if (esp_netif_dhcpc_stop(netif) != ESP_OK ||
+        esp_netif_set_ip_info(netif, &cache.ip) != ESP_OK) {
+        restore_dhcp(netif);
+        return false;
+    }
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &cache.dns[0]);
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &cache.dns[1]);
+
+    ESP_LOGI(TAG, "Reusing DHCP lease " IPSTR " (%lu s left until T1)", IP2STR(&cache.ip.ip),
+             (unsigned long)left_s);
+    return true;
+}
+
+wifi_path_t wifi_cache_begin(const char *ssid, const char *password, bool use_dhcp,
+                             esp_netif_t *netif, wifi_sta_config_t *sta) {
+    if (!prepare_ap(ssid, password, sta)) {
+        return WIFI_PATH_FULL;
+    }
+    return (use_dhcp && apply_lease(netif)) ? WIFI_PATH_FAST_LEASE : WIFI_PATH_FAST;
+}
+
+void wifi_cache_fast_failed(esp_netif_t *netif, wifi_path_t path) {
+    if (path == WIFI_PATH_FAST_LEASE) {
+        restore_dhcp(netif);
+    }
+    wifi_cache_invalidate();
+}
+
+void wifi_cache_store(esp_netif_t *netif, const char *ssid, const char *password, bool from_dhcp) {
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+
+    uint32_t hash = cred_hash(ssid, password);
+    bool same_ap = cache.magic == WIFI_CACHE_MAGIC && cache.cred_hash == hash &&
+                   memcmp(cache.bssid, ap.bssid, sizeof(ap.bssid)) == 0;
+
+    cache.magic = WIFI_CACHE_MAGIC;
+    cache.cred_hash = hash;
+    memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+    cache.channel = ap.primary;
+
+    if (from_dhcp) {
+        uint32_t lease_s = dhcp_lease_s(netif);
+
+        cache.lease_valid = lease_s > 0 &&
+                            esp_netif_get_ip_info(netif, &cache.ip) == ESP_OK;
+        esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &cache.dns[0]);
+        esp_netif_get_dns_info(netif, ESP_NETIF_DNS_BACKUP, &cache.dns[1]);
+        cache.lease_start = time(NULL);
+        cache.lease_s = lease_s;
+    } else if (!same_ap) {
+        cache.lease_valid = false;
+    }
+
+    ESP_LOGI(TAG, "Cached AP channel %d, lease %s (%lu s)", cache.channel,
+             cache.lease_valid ? "valid" : "none", (unsigned long)cache.lease_s);
+}
+
+void wifi_cache_invalidate(void) {
+    memset(&cache, 0, sizeof(cache));
+}
+
+void wifi_cache_record(wifi_path_t path, bool ok, uint32_t elapsed_ms) {
+    stats.last_path = path;
+    if (!ok) {
+        if (path != WIFI_PATH_FULL) {
+            stats.fast_fail++;
+        }
+        ESP_LOGW(TAG, "%s connect failed after %lu ms", wifi_cache_path_name(path),
+                 (unsigned long)elapsed_ms);
+        return;
+    }
+
+    stats.last_ms = elapsed_ms;
+    if (path == WIFI_PATH_FULL) {
+        stats.full_ok++;
+        stats.last_full_ms = elapsed_ms;
+    } else {
+        stats.fast_ok++;
+        stats.last_fast_ms = elapsed_ms;
+    }
+    ESP_LOGI(TAG, "%s connect took %lu ms", wifi_cache_path_name(path), (unsigned long)elapsed_ms);
+}
+
+void wifi_cache_get_stats(wifi_cache_stats_t *out) {
+    *out = stats;
+}
+
+const char *wifi_cache_path_name(wifi_path_t path) {
+    switch (path) {
+        case WIFI_PATH_FULL:       return "full";
+        case WIFI_PATH_FAST:       return "fast";
+        case WIFI_PATH_FAST_LEASE: return "fast+lease";
+        default:                   return "none";
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file bench_json_stream.c
+ * @brief Speed of the request body tokenizer on a full PUT /api/config body
+ *
+ * A body with every settings key, a schedule (captured as raw text, as the
+ * handler does) and a widget template is fed in the 512-byte chunks the
+ * handler receives, with the handler's buffer sizes. Prints the time per
+ * body and the throughput; the tokenizer state is fixed size, so memory
+ * does not depend on the body. Every run must give the same events.
+ */
+
+#include "json_stream.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK_SIZE  512     // Receive buffer of api_config_put_handler()
+#define TOK_SIZE    2048    // MAX_URL_LEN
+#define CAP_SIZE    2048    // MAX_SCHEDULE_JSON
+#define RUNS        20000
+
+static const char body[] =
+    "{\"url\":\"https://dashboard.example.com/render/kitchen.png?w=800&h=480&theme=light\","
+    "\"refresh\":15,\"ssl_skip\":false,\"playlist\":false,\"playlist_check\":60,"
+    "\"refresh_align\":true,\"img_width\":800,\"img_height\":480,\"img_scale\":true,"
+    "\"img_rotation\":0,\"img_mirror_h\":false,\"img_mirror_v\":false,\"img_rot_first\":true,"
+    "\"led_disabled\":false,\"panel_layout\":\"\","
+    "\"tiles\":\"0,0,400,240,https://dash.example.com/weather.png\\n"
+    "400,0,400,480,https://dash.example.com/calendar.png\\n"
+    "0,240,400,240,https://dash.example.com/transit.png\","
+    "\"widgets\":false,\"sched_enable\":true,\"cache_hints\":true,\"cache_min\":5,"
+    "\"cache_max\":1440,\"ssid\":\"HomeNetwork-5G\",\"password\":\"correct horse battery\","
+    "\"hostname\":\"epaper-kitchen\",\"domain\":\"home.arpa\",\"use_dhcp\":false,"
+    "\"static_ip\":\"192.168.1.50\",\"static_mask\":\"255.255.255.0\","
+    "\"static_gw\":\"192.168.1.1\",\"dns_primary\":\"192.168.1.1\","
+    "\"dns_secondary\":\"9.9.9.9\",\"ntp_server\":\"pool.ntp.org\",\"ntp_max_err\":30,"
+    "\"timezone\":\"CET-1CEST,M3.5.0,M10.5.0/3\",\"syslog_en\":true,"
+    "\"syslog_host\":\"logs.home.arpa\",\"syslog_port\":514,\"syslog_fmt\":1,\"syslog_tp\":0,"
+    "\"schedule\":{\"plans\":[{\"name\":\"Workday\",\"periods\":["
+    "{\"start\":\"06:00\",\"end\":\"09:00\",\"interval\":10},"
+    "{\"start\":\"09:00\",\"end\":\"17:00\",\"interval\":60},"
+    "{\"start\":\"17:00\",\"end\":\"23:00\",\"interval\":15}]},"
+    "{\"name\":\"Weekend\",\"periods\":[{\"start\":\"08:00\",\"end\":\"22:00\",\"interval\":30}]}],"
+    "\"days\":{\"Mon\":\"Workday\",\"Tue\":\"Workday\",\"Wed\":\"Workday\",\"Thu\":\"Workday\","
+    "\"Fri\":\"Workday\",\"Sat\":\"Weekend\",\"Sun\":\"Weekend\"}},"
+    "\"widget_tmpl\":\"{\\\"items\\\":[{\\\"type\\\":\\\"text\\\",\\\"x\\\":20,\\\"y\\\":20,"
+    "\\\"text\\\":\\\"{temp} \\u00b0C\\\",\\\"size\\\":3}]}\","
+    "\"ap_mode\":false,\"panel\":\"7in3e\",\"partition\":\"ota_0\",\"build\":\"1.0\"}";
+
+typedef struct {
+    char *cap;
+    uint32_t events;
+} bench_ctx_t;
+
+static bool bench_cb(json_stream_t *js, json_stream_event_t ev,
+                     const char *str, size_t len, void *ctx) {
+    bench_ctx_t *b = ctx;
+    b->events++;
+    if (ev == JSON_STREAM_KEY && strcmp(str, "schedule") == 0) {
+        json_stream_capture(js, b->cap, CAP_SIZE);
+    }
+    return true;
+}
+
+static bool run(bench_ctx_t *b, char *tok) {
+    json_stream_t js;
+    json_stream_init(&js, tok, TOK_SIZE, bench_cb, b);
+    size_t n = sizeof(body) - 1;
+    bool ok = true;
+    for (size_t pos = 0; pos < n && ok; pos += CHUNK_SIZE) {
+        ok = json_stream_feed(&js, body + pos, n - pos < CHUNK_SIZE ? n - pos : CHUNK_SIZE);
+    }
+    return ok && json_stream_finish(&js);
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(void) {
+    static char tok[TOK_SIZE];
+    static char cap[CAP_SIZE];
+    bench_ctx_t b = { cap, 0 };
+
+    CHECK(run(&b, tok));
+    uint32_t events = b.events;
+    CHECK(events > 80);
+    CHECK(strncmp(cap, "{\"plans\":", 9) == 0);
+
+    int failed = 0;
+    double start = now_us();
+    for (int i = 0; i < RUNS; i++) {
+        b.events = 0;
+        failed += !run(&b, tok) || b.events != events;
+    }
+    double us = (now_us() - start) / RUNS;
+    CHECK_EQ(failed, 0);
+
+    printf("%zu byte body in %d-byte chunks: %lu events, %.2f us per body, %.1f MB/s\n",
+           sizeof(body) - 1, CHUNK_SIZE, (unsigned long)events, us, (sizeof(body) - 1) / us);
+    printf("tokenizer state %zu bytes, token buffer %d, capture buffer %d\n",
+           sizeof(json_stream_t), TOK_SIZE, CAP_SIZE);
+    return TEST_RESULT();
+}
@@ -0,0 +1,15 @@
+/**
+ * @file esp_attr.h
+ * @brief Host build: placement attributes have no meaning on the host
+ */
+
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_BSS_ATTR
+
+#endif // HOST_ESP_ATTR_H
@@ -0,0 +1,13 @@
+/**
+ * @file esp_crt_bundle.h
+ * @brief Host build: certificate bundle hook (never called, no network)
+ */
+
+#ifndef HOST_ESP_CRT_BUNDLE_H
+#define HOST_ESP_CRT_BUNDLE_H
+
+#include "esp_err.h"
+
+esp_err_t esp_crt_bundle_attach(void *conf);
+
+#endif // HOST_ESP_CRT_BUNDLE_H
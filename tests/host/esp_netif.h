@@ -0,0 +1,53 @@
+/**
+ * @file esp_netif.h
+ * @brief Host build: STA interface with an IP configuration and DHCP client (mock_netif.c)
+ */
+
+#ifndef HOST_ESP_NETIF_H
+#define HOST_ESP_NETIF_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    struct {
+        esp_ip4_addr_t ip4;
+        uint8_t type;
+    } ip;
+} esp_netif_dns_info_t;
+
+typedef enum {
+    ESP_NETIF_DNS_MAIN = 0,
+    ESP_NETIF_DNS_BACKUP,
+    ESP_NETIF_DNS_FALLBACK,
+    ESP_NETIF_DNS_MAX,
+} esp_netif_dns_type_t;
+
+#define esp_ip4_addr1(a) ((uint8_t)((a)->addr & 0xFF))
+#define esp_ip4_addr2(a) ((uint8_t)(((a)->addr >> 8) & 0xFF))
+#define esp_ip4_addr3(a) ((uint8_t)(((a)->addr >> 16) & 0xFF))
+#define esp_ip4_addr4(a) ((uint8_t)(((a)->addr >> 24) & 0xFF))
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(a) esp_ip4_addr1(a), esp_ip4_addr2(a), esp_ip4_addr3(a), esp_ip4_addr4(a)
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif);
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_get_dns_info(esp_netif_t *netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns);
+esp_err_t esp_netif_set_dns_info(esp_netif_t *netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns);
+void *esp_netif_get_netif_impl(esp_netif_t *netif);
+
+#endif // HOST_ESP_NETIF_H
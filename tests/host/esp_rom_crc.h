@@ -0,0 +1,13 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief Host build: ROM CRC routines
+ */
+
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#endif // HOST_ESP_ROM_CRC_H
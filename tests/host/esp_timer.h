@@ -0,0 +1,13 @@
+/**
+ * @file esp_timer.h
+ * @brief Host build: esp_timer_get_time() reads the virtual clock (host_idf.h)
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // HOST_ESP_TIMER_H
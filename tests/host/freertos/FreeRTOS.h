@@ -0,0 +1,28 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host build: FreeRTOS types; one tick is one millisecond of virtual time
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_attr.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE   1
+#define pdFALSE  0
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS   1
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define portYIELD_FROM_ISR() ((void)0)
+
+#endif // HOST_FREERTOS_H
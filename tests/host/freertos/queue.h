@@ -0,0 +1,13 @@
+/**
+ * @file queue.h
+ * @brief Host build: queue handle type
+ */
+
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+#endif // HOST_FREERTOS_QUEUE_H
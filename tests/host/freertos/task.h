@@ -0,0 +1,17 @@
+/**
+ * @file task.h
+ * @brief Host build: vTaskDelay() advances the virtual clock
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+// Single-threaded: nothing to yield to
+#define taskYIELD() ((void)0)
+
+#endif // HOST_FREERTOS_TASK_H
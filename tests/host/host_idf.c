@@ -0,0 +1,244 @@
+/**
+ * @file host_idf.c
+ * @brief Host build: virtual clock, logging, heap and semaphores
+ */
+
+#include "host_idf.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Longest a blocking call may wait for an event before the test is stuck
+#define HOST_DEADLOCK_US (24LL * 3600 * 1000000)
+
+static int64_t s_now_us = 0;
+static host_idf_tick_hook_t s_tick_hook = NULL;
+
+struct host_sem {
+    int count;
+    int max;
+};
+
+void host_idf_advance_us(int64_t us) {
+    s_now_us += us;
+    if (s_tick_hook != NULL) {
+        s_tick_hook();
+    }
+}
+
+void host_idf_set_tick_hook(host_idf_tick_hook_t hook) {
+    s_tick_hook = hook;
+}
+
+int64_t esp_timer_get_time(void) {
+    return s_now_us;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    for (TickType_t i = 0; i < ticks; i++) {
+        host_idf_advance_us(portTICK_PERIOD_MS * 1000);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(s_now_us / (portTICK_PERIOD_MS * 1000));
+}
+
+/* ---------------------------------------------------------------------------
+ * Logging
+ * ------------------------------------------------------------------------- */
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static int max_level = -1;
+    if (max_level < 0) {
+        const char *env = getenv("HOST_LOG");
+        max_level = env != NULL ? atoi(env) + ESP_LOG_ERROR : ESP_LOG_ERROR;
+    }
+    if ((int)level > max_level) {
+        return;
+    }
+    static const char letters[] = "-EWIDV";
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(s_now_us / 1000), tag);
+    va_list ap;
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:                   return "ESP_OK";
+    case ESP_FAIL:                 return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:           return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:    return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:     return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:    return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:          return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:      return "ESP_ERR_INVALID_CRC";
+    default:                       return "UNKNOWN ERROR";
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Heap and ROM
+ * ------------------------------------------------------------------------- */
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return 8 * 1024 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void)caps;
+    return 4 * 1024 * 1024;
+}
+
+// Same convention as the ROM: the CRC is inverted on entry and exit
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* ---------------------------------------------------------------------------
+ * Semaphores
+ * ------------------------------------------------------------------------- */
+
+static SemaphoreHandle_t sem_create(int count, int max) {
+    SemaphoreHandle_t sem = calloc(1, sizeof(*sem));
+    if (sem != NULL) {
+        sem->count = count;
+        sem->max = max;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return sem_create(0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return sem_create(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    int64_t waited_us = 0;
+    for (TickType_t i = 0; sem->count == 0 && i < ticks; i++) {
+        host_idf_advance_us(portTICK_PERIOD_MS * 1000);
+        waited_us += portTICK_PERIOD_MS * 1000;
+        if (waited_us > HOST_DEADLOCK_US) {
+            fprintf(stderr, "xSemaphoreTake: nothing can give the semaphore\n");
+            abort();
+        }
+    }
+    if (sem->count == 0) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->count == sem->max) {
+        return pdFALSE;
+    }
+    sem->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) {
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    free(sem);
+}
+
+/* ---------------------------------------------------------------------------
+ * Network (none on the host)
+ * ------------------------------------------------------------------------- */
+
+esp_err_t esp_crt_bundle_attach(void *conf) {
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    (void)config;
+    return NULL;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    (void)client;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    (void)client;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    (void)client;
+    return 0;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url) {
+    (void)client;
+    (void)url;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+    (void)client;
+    (void)key;
+    (void)value;
+    return ESP_FAIL;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key) {
+    (void)client;
+    (void)key;
+    return ESP_FAIL;
+}
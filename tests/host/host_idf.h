@@ -0,0 +1,32 @@
+/**
+ * @file host_idf.h
+ * @brief Host build: control of the simulated ESP-IDF environment
+ *
+ * Time is virtual: esp_timer_get_time() starts at 0 and only moves when the
+ * code under test waits (vTaskDelay, a blocking semaphore take, light sleep)
+ * or a test advances it, so timing assertions are exact and a 20 s refresh
+ * takes no real time.
+ */
+
+#ifndef HOST_IDF_H
+#define HOST_IDF_H
+
+#include <stdint.h>
+
+/**
+ * @brief Called after every step of virtual time (e.g. to raise interrupts)
+ */
+typedef void (*host_idf_tick_hook_t)(void);
+
+/**
+ * @brief Advance the virtual clock and run the tick hook once
+ * @param us Microseconds (>= 0)
+ */
+void host_idf_advance_us(int64_t us);
+
+/**
+ * @brief Install the tick hook (NULL to remove)
+ */
+void host_idf_set_tick_hook(host_idf_tick_hook_t hook);
+
+#endif // HOST_IDF_H
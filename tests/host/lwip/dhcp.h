@@ -0,0 +1,22 @@
+/**
+ * @file dhcp.h
+ * @brief Host build: the DHCP client state read by wifi_cache.c (mock_netif.c)
+ */
+
+#ifndef HOST_LWIP_DHCP_H
+#define HOST_LWIP_DHCP_H
+
+#include <stdint.h>
+
+struct netif;
+
+struct dhcp {
+    uint8_t state;
+    uint32_t offered_t0_lease;      // Lease time of the offer (s)
+    uint32_t offered_t1_renew;
+    uint32_t offered_t2_rebind;
+};
+
+struct dhcp *netif_dhcp_data(struct netif *netif);
+
+#endif // HOST_LWIP_DHCP_H
@@ -0,0 +1,13 @@
+/**
+ * @file init.h
+ * @brief Host build: lwIP version (as shipped with ESP-IDF 5)
+ */
+
+#ifndef HOST_LWIP_INIT_H
+#define HOST_LWIP_INIT_H
+
+#define LWIP_VERSION_MAJOR 2
+#define LWIP_VERSION_MINOR 1
+#define LWIP_VERSION_REVISION 3
+
+#endif // HOST_LWIP_INIT_H
@@ -0,0 +1,493 @@
+/**
+ * @file mock_driver.c
+ * @brief Host build: recording GPIO/SPI/sleep drivers and a simulated panel
+ */
+
+#include "mock_driver.h"
+#include "host_idf.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_QUEUE_MAX 8
+
+struct spi_device_t {
+    int queue_size;
+    spi_transaction_t *queue[MOCK_QUEUE_MAX];
+    int queued;
+};
+
+static mock_panel_config_t s_cfg;
+static mock_state_t s_state;
+static size_t s_capacity = 0;
+
+// GPIO
+static int s_level[GPIO_NUM_MAX];
+static gpio_mode_t s_mode[GPIO_NUM_MAX];
+static bool s_isr_installed = false;
+static gpio_isr_t s_isr[GPIO_NUM_MAX];
+static void *s_isr_arg[GPIO_NUM_MAX];
+static gpio_int_type_t s_intr_type[GPIO_NUM_MAX];
+static bool s_intr_enabled[GPIO_NUM_MAX];
+static gpio_int_type_t s_wakeup_type[GPIO_NUM_MAX];   // GPIO_INTR_DISABLE = not a wakeup source
+
+// Sleep
+static bool s_timer_wakeup = false;
+static uint64_t s_timer_wakeup_us = 0;
+static bool s_gpio_wakeup = false;
+
+// SPI
+static bool s_bus_initialized = false;
+static int s_max_transfer_sz = 0;
+static spi_device_handle_t s_bus_holder = NULL;
+
+// Panel
+static int64_t s_busy_until_us = 0;
+static int s_busy_prev = 1;
+
+static void mock_error(const char *fmt, ...) {
+    s_state.errors++;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(s_state.last_error, sizeof(s_state.last_error), fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "mock_driver: %s\n", s_state.last_error);
+}
+
+static bool pin_ok(int pin) {
+    return pin >= 0 && pin < GPIO_NUM_MAX && GPIO_IS_VALID_GPIO(pin);
+}
+
+static int busy_level(void) {
+    return esp_timer_get_time() < s_busy_until_us ? 0 : 1;
+}
+
+static void panel_busy_for(uint32_t ms) {
+    int64_t until = esp_timer_get_time() + (int64_t)ms * 1000;
+    if (until > s_busy_until_us) {
+        s_busy_until_us = until;
+    }
+    s_busy_prev = busy_level();
+}
+
+// Deliver the BUSY interrupt on a rising edge
+static void mock_tick(void) {
+    int level = busy_level();
+    int pin = s_cfg.busy;
+    if (level && !s_busy_prev && pin_ok(pin) && s_intr_enabled[pin] &&
+        (s_intr_type[pin] == GPIO_INTR_POSEDGE || s_intr_type[pin] == GPIO_INTR_ANYEDGE) &&
+        s_isr[pin] != NULL) {
+        s_state.isr_calls++;
+        s_isr[pin](s_isr_arg[pin]);
+    }
+    s_busy_prev = level;
+}
+
+static uint8_t cs_bits(void) {
+    uint8_t cs = 0;
+    if (pin_ok(s_cfg.cs) && s_level[s_cfg.cs] == 0) {
+        cs |= MOCK_CS_PRIMARY;
+    }
+    if (pin_ok(s_cfg.cs_secondary) && s_level[s_cfg.cs_secondary] == 0) {
+        cs |= MOCK_CS_SECONDARY;
+    }
+    return cs;
+}
+
+// Clock out bytes with the current DC/CS levels
+static void record(const uint8_t *data, size_t len, bool queued) {
+    uint8_t cs = cs_bits();
+    uint8_t dc = (uint8_t)s_level[s_cfg.dc];
+    if (cs == 0) {
+        mock_error("%u bytes clocked with CS high", (unsigned)len);
+    }
+    if (s_state.count + len > s_capacity) {
+        size_t cap = s_capacity ? s_capacity : 4096;
+        while (cap < s_state.count + len) {
+            cap *= 2;
+        }
+        s_state.bytes = realloc(s_state.bytes, cap * sizeof(mock_spi_byte_t));
+        s_capacity = cap;
+    }
+    for (size_t i = 0; i < len; i++) {
+        s_state.bytes[s_state.count++] = (mock_spi_byte_t){
+            .byte = data[i], .dc = dc, .cs = cs, .queued = queued,
+        };
+    }
+    if (len > s_state.max_trans_bytes) {
+        s_state.max_trans_bytes = len;
+    }
+
+    // The panel acts on command bytes
+    if (cs != 0 && dc == 0 && len == 1) {
+        switch (data[0]) {
+        case 0x04: panel_busy_for(s_cfg.power_on_ms); break;
+        case 0x12: panel_busy_for(s_cfg.refresh_ms); break;
+        case 0x02: panel_busy_for(s_cfg.power_off_ms); break;
+        }
+    }
+}
+
+void mock_driver_reset(const mock_panel_config_t *cfg) {
+    mock_driver_free();
+    s_cfg = *cfg;
+    memset(s_level, 0, sizeof(s_level));
+    memset(s_mode, 0, sizeof(s_mode));
+    memset(s_isr, 0, sizeof(s_isr));
+    memset(s_intr_type, 0, sizeof(s_intr_type));
+    memset(s_intr_enabled, 0, sizeof(s_intr_enabled));
+    memset(s_wakeup_type, 0, sizeof(s_wakeup_type));
+    s_isr_installed = false;
+    s_timer_wakeup = false;
+    s_gpio_wakeup = false;
+    s_bus_initialized = false;
+    s_bus_holder = NULL;
+    s_busy_until_us = 0;
+    s_busy_prev = 1;
+    host_idf_set_tick_hook(mock_tick);
+}
+
+mock_state_t *mock_driver_state(void) {
+    return &s_state;
+}
+
+void mock_driver_clear(void) {
+    mock_spi_byte_t *bytes = s_state.bytes;
+    memset(&s_state, 0, sizeof(s_state));
+    s_state.bytes = bytes;
+}
+
+void mock_panel_release_busy(void) {
+    s_busy_until_us = esp_timer_get_time();
+    mock_tick();
+}
+
+void mock_driver_free(void) {
+    free(s_state.bytes);
+    memset(&s_state, 0, sizeof(s_state));
+    s_capacity = 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * GPIO
+ * ------------------------------------------------------------------------- */
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    for (int pin = 0; pin < 64; pin++) {
+        if ((config->pin_bit_mask >> pin) & 1) {
+            if (!pin_ok(pin)) {
+                mock_error("gpio_config: GPIO%d does not exist", pin);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    for (int pin = 0; pin < GPIO_NUM_MAX; pin++) {
+        if ((config->pin_bit_mask >> pin) & 1) {
+            s_mode[pin] = config->mode;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!pin_ok(gpio_num) || s_mode[gpio_num] != GPIO_MODE_OUTPUT) {
+        mock_error("gpio_set_level: GPIO%d is not an output", gpio_num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    int old = s_level[gpio_num];
+    s_level[gpio_num] = level ? 1 : 0;
+    if (old && !level && (gpio_num == s_cfg.cs || gpio_num == s_cfg.cs_secondary)) {
+        s_state.cs_cycles++;
+    }
+    if (!old && level && gpio_num == s_cfg.rst) {
+        s_state.resets++;
+        s_busy_until_us = 0;  // Reset ends whatever the panel was doing
+        panel_busy_for(s_cfg.reset_busy_ms);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) {
+        mock_error("gpio_get_level: GPIO%d does not exist", gpio_num);
+        return 0;
+    }
+    if (gpio_num == s_cfg.busy) {
+        return busy_level();
+    }
+    return s_level[gpio_num];
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (s_cfg.isr_install_err != ESP_OK) {
+        return s_cfg.isr_install_err;
+    }
+    if (s_isr_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_isr_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args) {
+    if (!s_isr_installed) {
+        mock_error("gpio_isr_handler_add: ISR service not installed");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_isr[gpio_num] = isr_handler;
+    s_isr_arg[gpio_num] = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_isr[gpio_num] = NULL;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_intr_type[gpio_num] = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_intr_enabled[gpio_num] = true;
+    s_busy_prev = busy_level();
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_intr_enabled[gpio_num] = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!pin_ok(gpio_num) ||
+        (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL)) {
+        mock_error("gpio_wakeup_enable: GPIO%d needs a level trigger", gpio_num);
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_wakeup_type[gpio_num] = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_wakeup_type[gpio_num] = GPIO_INTR_DISABLE;
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * Sleep
+ * ------------------------------------------------------------------------- */
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    s_timer_wakeup = true;
+    s_timer_wakeup_us = time_in_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+    s_gpio_wakeup = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source) {
+    if (source == ESP_SLEEP_WAKEUP_TIMER) {
+        s_timer_wakeup = false;
+    } else if (source == ESP_SLEEP_WAKEUP_GPIO) {
+        s_gpio_wakeup = false;
+    }
+    return ESP_OK;
+}
+
+// Sleep until the timer runs out or BUSY reaches its wakeup level
+esp_err_t esp_light_sleep_start(void) {
+    int64_t now = esp_timer_get_time();
+    int64_t wake = INT64_MAX;
+    if (s_timer_wakeup) {
+        wake = now + (int64_t)s_timer_wakeup_us;
+    }
+    if (s_gpio_wakeup && pin_ok(s_cfg.busy)) {
+        gpio_int_type_t type = s_wakeup_type[s_cfg.busy];
+        if (type == GPIO_INTR_HIGH_LEVEL) {
+            int64_t idle = busy_level() ? now : s_busy_until_us;
+            if (idle < wake) {
+                wake = idle;
+            }
+        } else if (type == GPIO_INTR_LOW_LEVEL && !busy_level()) {
+            wake = now;
+        }
+    }
+    if (wake == INT64_MAX) {
+        mock_error("esp_light_sleep_start: no wakeup source");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_state.light_sleeps++;
+    host_idf_advance_us(wake - now);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * SPI
+ * ------------------------------------------------------------------------- */
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma_chan) {
+    (void)host;
+    (void)dma_chan;
+    if (s_bus_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_bus_initialized = true;
+    s_max_transfer_sz = config->max_transfer_sz;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host) {
+    (void)host;
+    if (!s_bus_initialized) {
+        mock_error("spi_bus_free: bus not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_bus_initialized = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle) {
+    (void)host;
+    if (!s_bus_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config->queue_size < 1 || config->queue_size > MOCK_QUEUE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    spi_device_handle_t dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->queue_size = config->queue_size;
+    *handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    if (handle->queued > 0) {
+        mock_error("spi_bus_remove_device: %d transactions pending", handle->queued);
+    }
+    if (s_bus_holder == handle) {
+        s_bus_holder = NULL;
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_acquire_bus(spi_device_handle_t handle, TickType_t wait) {
+    (void)wait;
+    if (s_bus_holder != NULL) {
+        mock_error("spi_device_acquire_bus: bus already held");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_bus_holder = handle;
+    return ESP_OK;
+}
+
+void spi_device_release_bus(spi_device_handle_t handle) {
+    if (s_bus_holder != handle) {
+        mock_error("spi_device_release_bus: bus not held by this device");
+    }
+    s_bus_holder = NULL;
+}
+
+static bool bus_usable(spi_device_handle_t handle, const char *what) {
+    if (s_bus_holder != NULL && s_bus_holder != handle) {
+        mock_error("%s: bus held by another device", what);
+        return false;
+    }
+    return true;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    if (!bus_usable(handle, "spi_device_polling_transmit")) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (handle->queued > 0) {
+        mock_error("spi_device_polling_transmit: queued transactions pending");
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t len = trans->length / 8;
+    if (trans->flags & SPI_TRANS_USE_TXDATA) {
+        if (len > sizeof(trans->tx_data)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        record(trans->tx_data, len, false);
+    } else {
+        record(trans->tx_buffer, len, false);
+    }
+    s_state.polling_trans++;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks) {
+    (void)ticks;
+    if (!bus_usable(handle, "spi_device_queue_trans")) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (handle->queued == handle->queue_size) {
+        mock_error("spi_device_queue_trans: queue full (would block forever)");
+        return ESP_ERR_TIMEOUT;
+    }
+    if ((trans->flags & SPI_TRANS_USE_TXDATA) == 0 &&
+        (int)(trans->length / 8) > s_max_transfer_sz) {
+        mock_error("spi_device_queue_trans: %u bytes exceed max_transfer_sz",
+                   (unsigned)(trans->length / 8));
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->queue[handle->queued++] = trans;
+    s_state.queued_trans++;
+    if ((uint32_t)handle->queued > s_state.max_inflight) {
+        s_state.max_inflight = handle->queued;
+    }
+    return ESP_OK;
+}
+
+// The oldest transaction goes out on the wire now
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t ticks) {
+    (void)ticks;
+    if (handle->queued == 0) {
+        mock_error("spi_device_get_trans_result: nothing queued (would block forever)");
+        return ESP_ERR_TIMEOUT;
+    }
+    spi_transaction_t *t = handle->queue[0];
+    memmove(handle->queue, handle->queue + 1, (handle->queued - 1) * sizeof(handle->queue[0]));
+    handle->queued--;
+    if (t->flags & SPI_TRANS_USE_TXDATA) {
+        record(t->tx_data, t->length / 8, true);
+    } else {
+        record(t->tx_buffer, t->length / 8, true);
+    }
+    *trans = t;
+    return ESP_OK;
+}
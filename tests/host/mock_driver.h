@@ -0,0 +1,87 @@
+/**
+ * @file mock_driver.h
+ * @brief Host build: recording GPIO/SPI/sleep drivers and a simulated panel
+ *
+ * Every byte clocked out on the SPI bus is recorded together with the DC
+ * and CS levels at that moment; queued (DMA) transactions are recorded when
+ * their result is collected, so a buffer reused too early shows up as
+ * wrong data. The simulated panel holds BUSY low for a set time after a
+ * hardware reset and after POWER_ON, DISPLAY_REFRESH and POWER_OFF, and
+ * raises the BUSY interrupt on the rising edge.
+ *
+ * Misuse of the drivers (data with CS high, invalid pins, a full
+ * transaction queue, ...) is counted in mock_state_t.errors.
+ */
+
+#ifndef MOCK_DRIVER_H
+#define MOCK_DRIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define MOCK_CS_PRIMARY    0x01
+#define MOCK_CS_SECONDARY  0x02
+
+/** One byte on the bus */
+typedef struct {
+    uint8_t byte;
+    uint8_t dc;         // DC level
+    uint8_t cs;         // MOCK_CS_* of the asserted (low) CS lines
+    uint8_t queued;     // Sent by a queued (DMA) transaction
+} mock_spi_byte_t;
+
+/** Wiring and timing of the simulated panel */
+typedef struct {
+    int cs, cs_secondary, dc, rst, busy;
+    uint32_t reset_busy_ms;     // BUSY low after a hardware reset
+    uint32_t power_on_ms;       // ... after POWER_ON (0x04)
+    uint32_t refresh_ms;        // ... after DISPLAY_REFRESH (0x12)
+    uint32_t power_off_ms;      // ... after POWER_OFF (0x02)
+    esp_err_t isr_install_err;  // Returned by gpio_install_isr_service()
+} mock_panel_config_t;
+
+/** What the drivers saw */
+typedef struct {
+    mock_spi_byte_t *bytes;     // Bus stream
+    size_t count;
+    uint32_t cs_cycles;         // Falling edges of CS (either line)
+    uint32_t polling_trans;
+    uint32_t queued_trans;
+    uint32_t max_inflight;      // Most queued transactions at once
+    size_t max_trans_bytes;     // Largest transaction
+    uint32_t resets;            // RST pulses
+    uint32_t isr_calls;         // BUSY interrupts delivered
+    uint32_t light_sleeps;
+    uint32_t errors;
+    char last_error[96];
+} mock_state_t;
+
+/**
+ * @brief Forget everything and wire up a new panel
+ * @param cfg Panel wiring and timing
+ */
+void mock_driver_reset(const mock_panel_config_t *cfg);
+
+/**
+ * @brief Recorded state
+ */
+mock_state_t *mock_driver_state(void);
+
+/**
+ * @brief Clear the recorded bus stream and counters (the panel keeps its state)
+ */
+void mock_driver_clear(void);
+
+/**
+ * @brief Let BUSY go high now (e.g. to end a stuck refresh)
+ */
+void mock_panel_release_busy(void);
+
+/**
+ * @brief Release all memory of the mock
+ */
+void mock_driver_free(void);
+
+#endif // MOCK_DRIVER_H
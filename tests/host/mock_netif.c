@@ -0,0 +1,102 @@
+/**
+ * @file mock_netif.c
+ * @brief Host build: STA interface, DHCP client and connected AP
+ */
+
+#include "mock_netif.h"
+#include "lwip/dhcp.h"
+#include <string.h>
+
+struct esp_netif_obj {
+    int unused;
+};
+
+static struct esp_netif_obj s_netif;
+static mock_netif_state_t s_state;
+static struct dhcp s_dhcp;
+
+void mock_netif_reset(void) {
+    memset(&s_state, 0, sizeof(s_state));
+    s_state.dhcpc_running = true;
+}
+
+esp_netif_t *mock_netif(void) {
+    return &s_netif;
+}
+
+mock_netif_state_t *mock_netif_state(void) {
+    return &s_state;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif) {
+    if (netif != &s_netif) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_state.dhcpc_running = true;
+    s_state.dhcpc_starts++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif) {
+    if (netif != &s_netif) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_state.dhcpc_running = false;
+    s_state.dhcpc_stops++;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info) {
+    if (netif != &s_netif) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *ip_info = s_state.ip;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info) {
+    if (netif != &s_netif) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_state.set_ip_err != ESP_OK) {
+        return s_state.set_ip_err;
+    }
+    s_state.ip = *ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_dns_info(esp_netif_t *netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns) {
+    if (netif != &s_netif || type > ESP_NETIF_DNS_BACKUP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *dns = s_state.dns[type];
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_dns_info(esp_netif_t *netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns) {
+    if (netif != &s_netif || type > ESP_NETIF_DNS_BACKUP) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_state.dns[type] = *dns;
+    return ESP_OK;
+}
+
+void *esp_netif_get_netif_impl(esp_netif_t *netif) {
+    return netif == &s_netif ? (void *)&s_dhcp : NULL;
+}
+
+struct dhcp *netif_dhcp_data(struct netif *netif) {
+    if (netif != (struct netif *)&s_dhcp || !s_state.have_dhcp) {
+        return NULL;
+    }
+    s_dhcp.offered_t0_lease = s_state.lease_s;
+    return &s_dhcp;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info) {
+    if (!s_state.connected) {
+        return ESP_FAIL;
+    }
+    *ap_info = s_state.ap;
+    return ESP_OK;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file mock_netif.h
+ * @brief Host build: one STA interface with a DHCP client and a connected AP
+ *
+ * The interface holds an IP configuration and DNS servers. Stopping the
+ * DHCP client keeps its lease data; starting it counts a restart. The
+ * connected AP is returned by esp_wifi_sta_get_ap_info() while set.
+ */
+
+#ifndef MOCK_NETIF_H
+#define MOCK_NETIF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+/** State of the interface and the WiFi driver */
+typedef struct {
+    bool connected;                 // esp_wifi_sta_get_ap_info() succeeds
+    wifi_ap_record_t ap;            // ... and returns this AP
+    bool dhcpc_running;
+    uint32_t dhcpc_starts;
+    uint32_t dhcpc_stops;
+    bool have_dhcp;                 // netif_dhcp_data() returns the client state
+    uint32_t lease_s;               // ... with this lease time
+    esp_netif_ip_info_t ip;
+    esp_netif_dns_info_t dns[2];    // Main and backup
+    esp_err_t set_ip_err;           // Returned by esp_netif_set_ip_info()
+} mock_netif_state_t;
+
+/**
+ * @brief Forget everything: no AP, DHCP client running without a lease
+ */
+void mock_netif_reset(void);
+
+/**
+ * @brief The STA interface
+ */
+esp_netif_t *mock_netif(void);
+
+/**
+ * @brief State of the interface
+ */
+mock_netif_state_t *mock_netif_state(void);
+
+#endif // MOCK_NETIF_H
@@ -0,0 +1,184 @@
+/**
+ * @file test_epd_busy.c
+ * @brief BUSY wait of the SPI transport: interrupt, polling and light sleep
+ *
+ * The simulated panel holds BUSY low after DISPLAY_REFRESH (0x12) for the
+ * configured time; all waits run on the virtual clock.
+ */
+
+#include "epd_7in3e.h"
+#include "epd_transport.h"
+#include "mock_driver.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "test_util.h"
+#include <stdlib.h>
+
+#define REFRESH_MS 500
+
+static mock_panel_config_t panel_cfg = {
+    .cs = EPD_PIN_CS, .cs_secondary = -1, .dc = EPD_PIN_DC, .rst = EPD_PIN_RST, .busy = EPD_PIN_BUSY,
+    .refresh_ms = REFRESH_MS,
+};
+
+static const epd_transport_pins_t pins = {
+    .cs = EPD_PIN_CS, .dc = EPD_PIN_DC, .rst = EPD_PIN_RST, .busy = EPD_PIN_BUSY, .cs_secondary = -1,
+};
+
+static epd_transport_t *open_transport(esp_err_t isr_install_err) {
+    panel_cfg.isr_install_err = isr_install_err;
+    mock_driver_reset(&panel_cfg);
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_spi_create(&pins, &t), ESP_OK);
+    CHECK_EQ(t->ops->init(t), ESP_OK);
+    return t;
+}
+
+// Start a refresh: BUSY goes low for the panel's refresh time
+static void start_refresh(epd_transport_t *t) {
+    t->ops->command(t, 0x12);
+    CHECK_EQ(gpio_get_level(EPD_PIN_BUSY), 0);
+}
+
+// Wait and return the virtual time it took in ms
+static int64_t timed_wait(epd_transport_t *t, uint32_t timeout_ms, esp_err_t expected) {
+    int64_t start_us = esp_timer_get_time();
+    CHECK_EQ(t->ops->wait_busy(t, timeout_ms), expected);
+    return (esp_timer_get_time() - start_us) / 1000;
+}
+
+static void test_already_idle(void) {
+    epd_transport_t *t = open_transport(ESP_OK);
+
+    // BUSY is high: no wait, no interrupt armed, no time counted
+    CHECK_EQ(timed_wait(t, 1000, ESP_OK), 0);
+    CHECK_EQ(t->stats.busy_us, 0);
+    CHECK_EQ(mock_driver_state()->isr_calls, 0);
+
+    // Also with light sleep: no sleep at all
+    t->ops->set_light_sleep(t, true);
+    CHECK_EQ(timed_wait(t, 1000, ESP_OK), 0);
+    CHECK_EQ(mock_driver_state()->light_sleeps, 0);
+
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    epd_transport_destroy(t);
+}
+
+static void test_interrupt(void) {
+    epd_transport_t *t = open_transport(ESP_OK);
+
+    start_refresh(t);
+    int64_t ms = timed_wait(t, 5000, ESP_OK);
+    CHECK(ms >= REFRESH_MS && ms <= REFRESH_MS + 1);
+    CHECK_EQ(mock_driver_state()->isr_calls, 1);
+    CHECK(t->stats.busy_us / 1000 >= REFRESH_MS);
+
+    // A refresh that outlasts the wait
+    mock_driver_state()->isr_calls = 0;
+    start_refresh(t);
+    int64_t waited = timed_wait(t, 200, ESP_ERR_TIMEOUT);
+    CHECK(waited >= 200 && waited <= 201);      // Semaphore timeouts round up a tick
+    CHECK_EQ(mock_driver_state()->isr_calls, 0);
+
+    // Waiting again picks up the same refresh
+    ms = timed_wait(t, 5000, ESP_OK);
+    CHECK(ms >= REFRESH_MS - waited && ms <= REFRESH_MS - waited + 1);
+    CHECK_EQ(mock_driver_state()->isr_calls, 1);
+
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    epd_transport_destroy(t);
+}
+
+// No ISR service: the transport polls BUSY every 10 ms
+static void test_polling_fallback(void) {
+    epd_transport_t *t = open_transport(ESP_FAIL);
+
+    start_refresh(t);
+    int64_t ms = timed_wait(t, 5000, ESP_OK);
+    CHECK(ms >= REFRESH_MS && ms <= REFRESH_MS + 10);
+    CHECK_EQ(mock_driver_state()->isr_calls, 0);
+
+    start_refresh(t);
+    ms = timed_wait(t, 95, ESP_ERR_TIMEOUT);
+    CHECK(ms >= 95 && ms <= 100);
+
+    mock_panel_release_busy();
+    CHECK_EQ(timed_wait(t, 1000, ESP_OK), 0);
+
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    epd_transport_destroy(t);
+}
+
+// Light sleep until BUSY goes high or the timeout expires
+static void test_light_sleep(void) {
+    epd_transport_t *t = open_transport(ESP_OK);
+    t->ops->set_light_sleep(t, true);
+
+    start_refresh(t);
+    int64_t ms = timed_wait(t, 5000, ESP_OK);
+    CHECK_EQ(ms, REFRESH_MS);
+    CHECK_EQ(mock_driver_state()->light_sleeps, 1);
+    CHECK_EQ(t->stats.light_sleep_us / 1000, REFRESH_MS);
+    CHECK_EQ(mock_driver_state()->isr_calls, 0);
+
+    start_refresh(t);
+    CHECK_EQ(timed_wait(t, 300, ESP_ERR_TIMEOUT), 300);
+    CHECK_EQ(t->stats.light_sleep_us / 1000, REFRESH_MS + 300);
+
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    epd_transport_destroy(t);
+}
+
+// Through the driver, polling: a refresh that outlasts the wait stays pending
+static void test_driver_timeout(void) {
+    panel_cfg.refresh_ms = EPD_BUSY_TIMEOUT_MS + 5000;
+    panel_cfg.isr_install_err = ESP_FAIL;
+    mock_driver_reset(&panel_cfg);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    epd_7in3e_init();
+
+    uint8_t *img = calloc(1, EPD_PANEL_BUFFER_SIZE);
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_OK);
+
+    int64_t start_us = esp_timer_get_time();
+    CHECK_EQ(epd_7in3e_wait_idle(10000), ESP_ERR_TIMEOUT);
+    int64_t ms = (esp_timer_get_time() - start_us) / 1000;
+    CHECK(ms >= 10000 && ms <= 10010);
+    CHECK(epd_7in3e_is_busy());
+
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    CHECK(!epd_7in3e_is_busy());
+    CHECK_EQ(mock_driver_state()->isr_calls, 0);
+    CHECK_EQ(mock_driver_state()->errors, 0);
+
+    // The next frame is not sent while the refresh still runs
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_OK);
+    size_t sent = mock_driver_state()->count;
+    CHECK_EQ(epd_7in3e_stream_begin(), ESP_ERR_TIMEOUT);
+    epd_7in3e_stream_write(img, EPD_PANEL_BUFFER_SIZE);
+    CHECK_EQ(epd_7in3e_stream_end(), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(mock_driver_state()->count, sent);
+    CHECK(epd_7in3e_is_busy());
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_OK);
+    sent = mock_driver_state()->count;
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_ERR_TIMEOUT);
+    CHECK_EQ(mock_driver_state()->count, sent);
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    free(img);
+
+    epd_7in3e_deinit_hw();
+    panel_cfg.refresh_ms = REFRESH_MS;
+}
+
+int main(void) {
+    test_already_idle();
+    test_interrupt();
+    test_polling_fallback();
+    test_light_sleep();
+    test_driver_timeout();
+    mock_driver_free();
+    return TEST_RESULT();
+}
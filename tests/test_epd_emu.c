@@ -0,0 +1,295 @@
+/**
+ * @file test_epd_emu.c
+ * @brief 7.3" driver against the emulated controller
+ *
+ * Checks the command stream of init, display, clear, color blocks and
+ * sleep against the Waveshare sequence, the frame the emulator decodes
+ * from the 0x10 data (also as a PNG), the BUSY timing and the timeout
+ * handling of an asynchronous refresh.
+ */
+
+#include "epd_7in3e.h"
+#include "epd_transport_emu.h"
+#include "esp_timer.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if EPD_PANEL != EPD_PANEL_7IN3E
+#error "test_epd_emu is built for the 7.3 inch panel"
+#endif
+
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+
+// Waveshare EPD_7IN3E_Init(): BUSY after reset, then the register setup
+static const uint8_t expected_init[] = {
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0xAA, 6, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18,
+    EPD_SEQ_CMD, 0x01, 1, 0x3F,
+    EPD_SEQ_CMD, 0x00, 2, 0x5F, 0x69,
+    EPD_SEQ_CMD, 0x03, 4, 0x00, 0x54, 0x00, 0x44,
+    EPD_SEQ_CMD, 0x05, 4, 0x40, 0x1F, 0x1F, 0x2C,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x08, 4, 0x6F, 0x1F, 0x1F, 0x22,
+    EPD_SEQ_CMD, 0x30, 1, 0x03,
+    EPD_SEQ_CMD, 0x50, 1, 0x3F,
+    EPD_SEQ_CMD, 0x60, 2, 0x02, 0x00,
+    EPD_SEQ_CMD, 0x61, 4, 0x03, 0x20, 0x01, 0xE0,
+    EPD_SEQ_CMD, 0x84, 1, 0x01,
+    EPD_SEQ_CMD, 0xE3, 1, 0x2F,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+};
+
+// EPD_7IN3E_Display(): data, then TurnOnDisplay
+static const uint8_t expected_display[] = {
+    EPD_SEQ_CMD, 0x10, 0,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x12, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+};
+
+static const uint8_t expected_sleep[] = {
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x07, 1, 0xA5,
+};
+
+// Compare the trace with an expected sequence and start a new one
+static void check_trace(epd_transport_t *t, const uint8_t *expected, size_t len, const char *what) {
+    size_t got_len;
+    const uint8_t *got = epd_transport_emu_trace(t, &got_len);
+    if (got_len != len || memcmp(got, expected, len) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s: command trace differs (%u bytes, expected %u)\n  got:     ",
+                what, (unsigned)got_len, (unsigned)len);
+        for (size_t i = 0; i < got_len; i++) fprintf(stderr, " %02X", got[i]);
+        fprintf(stderr, "\n  expected:");
+        for (size_t i = 0; i < len; i++) fprintf(stderr, " %02X", expected[i]);
+        fprintf(stderr, "\n");
+    }
+    epd_transport_emu_clear_trace(t);
+}
+
+static uint8_t pixel_code(const uint8_t *frame, int x, int y) {
+    uint8_t b = frame[(size_t)y * EPD_PANEL_ROW_BYTES + x / 2];
+    return (x & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+// Diagonal bands through all seven palette codes
+static uint8_t *make_pattern(void) {
+    uint8_t *img = malloc(EPD_PANEL_BUFFER_SIZE);
+    for (int y = 0; y < EPD_PANEL_HEIGHT; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH; x += 2) {
+            uint8_t a = palette[(x / 40 + y / 40) % EPD_PANEL_PALETTE_SIZE][3];
+            uint8_t b = palette[((x + 1) / 40 + y / 40) % EPD_PANEL_PALETTE_SIZE][3];
+            img[(size_t)y * EPD_PANEL_ROW_BYTES + x / 2] = (a << 4) | b;
+        }
+    }
+    return img;
+}
+
+// The PNG written by the emulator shows every pixel in its palette color
+static void check_png(epd_transport_t *t, const uint8_t *frame, const char *path) {
+    CHECK_EQ(epd_transport_emu_write_png(t, path), ESP_OK);
+
+    test_image_t img;
+    if (!test_png_load(path, &img)) {
+        test_failures++;
+        return;
+    }
+    CHECK_EQ(img.width, EPD_PANEL_WIDTH);
+    CHECK_EQ(img.height, EPD_PANEL_HEIGHT);
+
+    int wrong = 0;
+    for (int y = 0; y < EPD_PANEL_HEIGHT && y < (int)img.height; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH && x < (int)img.width; x++) {
+            uint8_t code = pixel_code(frame, x, y);
+            const uint8_t *rgb = img.rgb + ((size_t)y * img.width + x) * 3;
+            const uint8_t *want = NULL;
+            for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+                if (palette[i][3] == code) {
+                    want = palette[i];
+                }
+            }
+            if (want == NULL || memcmp(rgb, want, 3) != 0) {
+                wrong++;
+            }
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    test_image_free(&img);
+}
+
+static void test_init(epd_transport_t *t) {
+    epd_7in3e_init();
+    check_trace(t, expected_init, sizeof(expected_init), "init");
+
+    const epd_emu_stats_t *st = epd_transport_emu_stats(t);
+    CHECK_EQ(st->resets, 1);
+    CHECK_EQ(st->commands, 14);
+    CHECK_EQ(st->param_bytes, 35);
+    CHECK_EQ(st->busy_waits, 2);
+    CHECK_EQ(st->errors, 0);
+}
+
+static void test_display(epd_transport_t *t, const epd_emu_config_t *cfg) {
+    uint8_t *img = make_pattern();
+    epd_transport_emu_reset_stats(t);
+
+    int64_t start_us = esp_timer_get_time();
+    epd_7in3e_display(img);
+    int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+    check_trace(t, expected_display, sizeof(expected_display), "display");
+
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    CHECK(frame != NULL);
+    if (frame != NULL) {
+        CHECK(memcmp(frame, img, EPD_PANEL_BUFFER_SIZE) == 0);
+        check_png(t, frame, "emu_7in3e.png");
+    }
+
+    const epd_emu_stats_t *st = epd_transport_emu_stats(t);
+    CHECK_EQ(st->frame_bytes, EPD_PANEL_BUFFER_SIZE);
+    CHECK_EQ(st->refreshes, 1);
+    CHECK_EQ(st->cmd_count[0x10], 1);
+    CHECK_EQ(st->cmd_count[0x04], 1);
+    CHECK_EQ(st->errors, 0);
+    CHECK(st->wall_us >= 0);
+
+    // Power on, refresh and power off plus 192000 bytes at 4 MHz
+    int64_t wire_ms = (int64_t)EPD_PANEL_BUFFER_SIZE * 8 * 1000 / cfg->spi_hz;
+    int64_t busy_ms = cfg->power_on_ms + cfg->refresh_ms + cfg->power_off_ms;
+    CHECK(elapsed_ms >= busy_ms + wire_ms);
+    CHECK(elapsed_ms <= busy_ms + wire_ms + 5);
+    CHECK(st->busy_wait_us / 1000 >= busy_ms);
+    CHECK(st->busy_wait_us / 1000 <= busy_ms + 3);
+    free(img);
+}
+
+static void test_async_then_clear(epd_transport_t *t) {
+    uint8_t *img = make_pattern();
+    epd_transport_emu_reset_stats(t);
+
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_OK);
+    CHECK(epd_7in3e_is_busy());
+
+    // The next frame must wait for the refresh and power off first
+    epd_7in3e_clear(EPD_7IN3E_WHITE);
+    CHECK(!epd_7in3e_is_busy());
+    const epd_emu_stats_t *st = epd_transport_emu_stats(t);
+    CHECK_EQ(st->errors, 0);
+    CHECK_EQ(st->refreshes, 2);
+
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    size_t wrong = 0;
+    for (size_t i = 0; frame != NULL && i < EPD_PANEL_BUFFER_SIZE; i++) {
+        wrong += frame[i] != 0x11;
+    }
+    CHECK(frame != NULL);
+    CHECK_EQ(wrong, 0);
+    epd_transport_emu_clear_trace(t);
+    free(img);
+}
+
+static void test_color_blocks(epd_transport_t *t) {
+    static const uint8_t bands[6] = {
+        EPD_7IN3E_BLACK, EPD_7IN3E_WHITE, EPD_7IN3E_YELLOW,
+        EPD_7IN3E_RED, EPD_7IN3E_BLUE, EPD_7IN3E_GREEN,
+    };
+
+    epd_7in3e_show_color_blocks();
+    check_trace(t, expected_display, sizeof(expected_display), "color blocks");
+
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    CHECK(frame != NULL);
+    int wrong = 0;
+    for (int y = 0; frame != NULL && y < EPD_PANEL_HEIGHT; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH; x++) {
+            wrong += pixel_code(frame, x, y) != bands[y / (EPD_PANEL_HEIGHT / 6)];
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    if (frame != NULL) {
+        check_png(t, frame, "emu_7in3e_blocks.png");
+    }
+}
+
+// A refresh longer than the wait: the panel stays busy until waited out
+static void test_timeout(void) {
+    epd_emu_config_t cfg = EPD_EMU_CONFIG_DEFAULT;
+    cfg.refresh_ms = 65000;
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_emu_create(&cfg, &t), ESP_OK);
+    epd_7in3e_set_transport(t);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    epd_7in3e_init();
+
+    uint8_t *img = make_pattern();
+    CHECK_EQ(epd_7in3e_display_async(img), ESP_OK);
+    epd_transport_emu_clear_trace(t);
+    epd_transport_emu_reset_stats(t);
+
+    int64_t start_us = esp_timer_get_time();
+    CHECK_EQ(epd_7in3e_wait_idle(10000), ESP_ERR_TIMEOUT);
+    CHECK_EQ((esp_timer_get_time() - start_us) / 1000, 10000);
+    CHECK(epd_7in3e_is_busy());
+    CHECK_EQ(epd_transport_emu_stats(t)->busy_timeouts, 1);
+
+    // Nothing was sent while the refresh was running
+    size_t len;
+    const uint8_t *trace = epd_transport_emu_trace(t, &len);
+    CHECK_EQ(len, 1);
+    CHECK_EQ(trace[0], EPD_SEQ_WAIT);
+
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    CHECK(!epd_7in3e_is_busy());
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+
+    epd_7in3e_deinit_hw();
+    epd_transport_destroy(t);
+    free(img);
+}
+
+static void test_sleep(epd_transport_t *t) {
+    epd_transport_emu_reset_stats(t);
+    epd_7in3e_sleep();
+    check_trace(t, expected_sleep, sizeof(expected_sleep), "sleep");
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+
+    // The controller ignores everything until the next reset
+    epd_7in3e_clear(EPD_7IN3E_WHITE);
+    CHECK(epd_transport_emu_stats(t)->errors > 0);
+
+    epd_transport_emu_reset_stats(t);
+    epd_7in3e_init();
+    epd_7in3e_clear(EPD_7IN3E_BLACK);
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+    epd_transport_emu_clear_trace(t);
+}
+
+int main(void) {
+    const epd_emu_config_t cfg = EPD_EMU_CONFIG_DEFAULT;
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_emu_create(&cfg, &t), ESP_OK);
+    epd_7in3e_set_transport(t);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    CHECK(epd_transport_emu_frame(t) == NULL);
+
+    test_init(t);
+    test_display(t, &cfg);
+    test_async_then_clear(t);
+    test_color_blocks(t);
+    test_sleep(t);
+
+    epd_7in3e_deinit_hw();
+    epd_transport_destroy(t);
+
+    test_timeout();
+    return TEST_RESULT();
+}
@@ -0,0 +1,359 @@
+/**
+ * @file test_epd_panel.c
+ * @brief Panel descriptors against the emulated controller
+ *
+ * Built once per panel (EPD_PANEL). Checks the init, refresh and sleep
+ * command streams against the Waveshare demo code of the panel, and that
+ * frames arrive intact: on the 13.3" panel every row is split between the
+ * two controllers, including when it is streamed in pieces that straddle
+ * the split.
+ */
+
+#include "epd_7in3e.h"
+#include "epd_transport_emu.h"
+#include "esp_timer.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+
+#if EPD_PANEL == EPD_PANEL_7IN3E
+
+#define PANEL_FILE "7in3e"
+#define REFRESH_DELAY_MS 0
+
+// EPD_7IN3E_Init()
+static const uint8_t expected_init[] = {
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0xAA, 6, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18,
+    EPD_SEQ_CMD, 0x01, 1, 0x3F,
+    EPD_SEQ_CMD, 0x00, 2, 0x5F, 0x69,
+    EPD_SEQ_CMD, 0x03, 4, 0x00, 0x54, 0x00, 0x44,
+    EPD_SEQ_CMD, 0x05, 4, 0x40, 0x1F, 0x1F, 0x2C,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x08, 4, 0x6F, 0x1F, 0x1F, 0x22,
+    EPD_SEQ_CMD, 0x30, 1, 0x03,
+    EPD_SEQ_CMD, 0x50, 1, 0x3F,
+    EPD_SEQ_CMD, 0x60, 2, 0x02, 0x00,
+    EPD_SEQ_CMD, 0x61, 4, 0x03, 0x20, 0x01, 0xE0,
+    EPD_SEQ_CMD, 0x84, 1, 0x01,
+    EPD_SEQ_CMD, 0xE3, 1, 0x2F,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+};
+
+// EPD_7IN3E_Display() / TurnOnDisplay()
+static const uint8_t expected_display[] = {
+    EPD_SEQ_CMD, 0x10, 0,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x12, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+};
+
+#elif EPD_PANEL == EPD_PANEL_4IN0E
+
+#define PANEL_FILE "4in0e"
+#define REFRESH_DELAY_MS 0
+
+// EPD_4IN0E_Init()
+static const uint8_t expected_init[] = {
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0xAA, 6, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18,
+    EPD_SEQ_CMD, 0x01, 1, 0x3F,
+    EPD_SEQ_CMD, 0x00, 2, 0x5F, 0x69,
+    EPD_SEQ_CMD, 0x05, 4, 0x40, 0x1F, 0x1F, 0x2C,
+    EPD_SEQ_CMD, 0x08, 4, 0x6F, 0x1F, 0x1F, 0x22,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x17,
+    EPD_SEQ_CMD, 0x03, 4, 0x00, 0x54, 0x00, 0x44,
+    EPD_SEQ_CMD, 0x60, 2, 0x02, 0x00,
+    EPD_SEQ_CMD, 0x30, 1, 0x08,
+    EPD_SEQ_CMD, 0x50, 1, 0x3F,
+    EPD_SEQ_CMD, 0x61, 4, 0x01, 0x90, 0x02, 0x58,
+    EPD_SEQ_CMD, 0xE3, 1, 0x2F,
+    EPD_SEQ_CMD, 0x84, 1, 0x01,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+};
+
+// EPD_4IN0E_Display() / TurnOnDisplay()
+static const uint8_t expected_display[] = {
+    EPD_SEQ_CMD, 0x10, 0,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x06, 4, 0x6F, 0x1F, 0x17, 0x49,
+    EPD_SEQ_CMD, 0x12, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+};
+
+#elif EPD_PANEL == EPD_PANEL_13IN3E
+
+#define PANEL_FILE "13in3e"
+#define REFRESH_DELAY_MS 50
+
+// EPD_13IN3E_Init(): the analog and power setup goes to the master only
+static const uint8_t expected_init[] = {
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD_M, 0x74, 9, 0xC0, 0x1C, 0x1C, 0xCC, 0xCC, 0xCC, 0x15, 0x15, 0x55,
+    EPD_SEQ_CMD, 0xF0, 6, 0x49, 0x55, 0x13, 0x5D, 0x05, 0x10,
+    EPD_SEQ_CMD, 0x00, 2, 0xDF, 0x69,
+    EPD_SEQ_CMD, 0x50, 1, 0xF7,
+    EPD_SEQ_CMD, 0x60, 2, 0x03, 0x03,
+    EPD_SEQ_CMD, 0x86, 1, 0x10,
+    EPD_SEQ_CMD, 0xE3, 1, 0x22,
+    EPD_SEQ_CMD, 0xE0, 1, 0x01,
+    EPD_SEQ_CMD, 0x61, 4, 0x04, 0xB0, 0x03, 0x20,
+    EPD_SEQ_CMD_M, 0x01, 6, 0x0F, 0x00, 0x28, 0x2C, 0x28, 0x38,
+    EPD_SEQ_CMD_M, 0xB6, 1, 0x07,
+    EPD_SEQ_CMD_M, 0x06, 2, 0xD8, 0x18,
+    EPD_SEQ_CMD_M, 0xB7, 1, 0x01,
+    EPD_SEQ_CMD_M, 0x05, 2, 0xD8, 0x18,
+    EPD_SEQ_CMD_M, 0xB0, 1, 0x01,
+    EPD_SEQ_CMD_M, 0xB1, 1, 0x02,
+};
+
+// EPD_13IN3E_Display() / TurnOnDisplay() (the 50 ms delay is not traced)
+static const uint8_t expected_display[] = {
+    EPD_SEQ_CMD, 0x10, 0,
+    EPD_SEQ_CMD, 0x04, 0,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x12, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+};
+
+#endif
+
+static const uint8_t expected_sleep[] = {
+    EPD_SEQ_CMD, 0x02, 1, 0x00,
+    EPD_SEQ_WAIT,
+    EPD_SEQ_CMD, 0x07, 1, 0xA5,
+};
+
+// Compare the trace with an expected sequence and start a new one
+static void check_trace(epd_transport_t *t, const uint8_t *expected, size_t len, const char *what) {
+    size_t got_len;
+    const uint8_t *got = epd_transport_emu_trace(t, &got_len);
+    if (got_len != len || memcmp(got, expected, len) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s %s: command trace differs (%u bytes, expected %u)\n  got:     ",
+                PANEL_FILE, what, (unsigned)got_len, (unsigned)len);
+        for (size_t i = 0; i < got_len; i++) fprintf(stderr, " %02X", got[i]);
+        fprintf(stderr, "\n  expected:");
+        for (size_t i = 0; i < len; i++) fprintf(stderr, " %02X", expected[i]);
+        fprintf(stderr, "\n");
+    }
+    epd_transport_emu_clear_trace(t);
+}
+
+// Commands and parameter bytes of a trace
+static void count_trace(const uint8_t *seq, size_t len, uint32_t *cmds, uint32_t *params) {
+    *cmds = 0;
+    *params = 0;
+    for (size_t i = 0; i < len; ) {
+        if (seq[i] == EPD_SEQ_WAIT) {
+            i++;
+            continue;
+        }
+        (*cmds)++;
+        *params += seq[i + 2];
+        i += 3 + seq[i + 2];
+    }
+}
+
+static uint8_t pixel_code(const uint8_t *frame, int x, int y) {
+    uint8_t b = frame[(size_t)y * EPD_PANEL_ROW_BYTES + x / 2];
+    return (x & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+// Diagonal bands through all seven palette codes; the halves of a row differ
+static uint8_t *make_pattern(void) {
+    uint8_t *img = malloc(EPD_PANEL_BUFFER_SIZE);
+    for (int y = 0; y < EPD_PANEL_HEIGHT; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH; x += 2) {
+            uint8_t a = palette[(x / 40 + y / 40) % EPD_PANEL_PALETTE_SIZE][3];
+            uint8_t b = palette[((x + 1) / 40 + y / 40) % EPD_PANEL_PALETTE_SIZE][3];
+            img[(size_t)y * EPD_PANEL_ROW_BYTES + x / 2] = (a << 4) | b;
+        }
+    }
+    return img;
+}
+
+// The shown frame must equal the image
+static void check_frame(epd_transport_t *t, const uint8_t *img, const char *what) {
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    if (frame == NULL) {
+        test_failures++;
+        fprintf(stderr, "%s %s: nothing shown\n", PANEL_FILE, what);
+        return;
+    }
+    size_t i = 0;
+    while (i < EPD_PANEL_BUFFER_SIZE && frame[i] == img[i]) {
+        i++;
+    }
+    if (i < EPD_PANEL_BUFFER_SIZE) {
+        test_failures++;
+        fprintf(stderr, "%s %s: frame differs at row %u, byte %u\n", PANEL_FILE, what,
+                (unsigned)(i / EPD_PANEL_ROW_BYTES), (unsigned)(i % EPD_PANEL_ROW_BYTES));
+    }
+}
+
+static void test_init(epd_transport_t *t) {
+    epd_7in3e_init();
+    check_trace(t, expected_init, sizeof(expected_init), "init");
+
+    uint32_t cmds, params;
+    count_trace(expected_init, sizeof(expected_init), &cmds, &params);
+    const epd_emu_stats_t *st = epd_transport_emu_stats(t);
+    CHECK_EQ(st->resets, 1);
+    CHECK_EQ(st->commands, cmds);
+    CHECK_EQ(st->param_bytes, params);
+    CHECK_EQ(st->errors, 0);
+}
+
+static void test_display(epd_transport_t *t, const epd_emu_config_t *cfg) {
+    uint8_t *img = make_pattern();
+    epd_transport_emu_reset_stats(t);
+
+    int64_t start_us = esp_timer_get_time();
+    epd_7in3e_display(img);
+    int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+    check_trace(t, expected_display, sizeof(expected_display), "display");
+    check_frame(t, img, "display");
+
+    const epd_emu_stats_t *st = epd_transport_emu_stats(t);
+    CHECK_EQ(st->frame_bytes, EPD_PANEL_BUFFER_SIZE);
+    CHECK_EQ(st->refreshes, 1);
+    CHECK_EQ(st->errors, 0);
+
+    int64_t wire_ms = (int64_t)EPD_PANEL_BUFFER_SIZE * 8 * 1000 / cfg->spi_hz;
+    int64_t busy_ms = cfg->power_on_ms + cfg->refresh_ms + cfg->power_off_ms;
+    CHECK(elapsed_ms >= busy_ms + REFRESH_DELAY_MS + wire_ms);
+    CHECK(elapsed_ms <= busy_ms + REFRESH_DELAY_MS + wire_ms + 5);
+
+    CHECK_EQ(epd_transport_emu_write_png(t, "emu_" PANEL_FILE ".png"), ESP_OK);
+    test_image_t png;
+    if (test_png_load("emu_" PANEL_FILE ".png", &png)) {
+        CHECK_EQ(png.width, EPD_PANEL_WIDTH);
+        CHECK_EQ(png.height, EPD_PANEL_HEIGHT);
+        test_image_free(&png);
+    } else {
+        test_failures++;
+    }
+    free(img);
+}
+
+// Streaming in pieces of every size from 1 byte to several rows; on the
+// 13.3" panel most of them straddle the split between the controllers
+static void test_stream_pieces(epd_transport_t *t) {
+    uint8_t *img = make_pattern();
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        img[i] ^= 0x11 * (i % 3 == 0);      // Not the previous frame
+    }
+
+    epd_7in3e_stream_begin();
+    size_t pos = 0;
+    for (size_t n = 1; pos < EPD_PANEL_BUFFER_SIZE; n = (n * 7 + 3) % (EPD_PANEL_ROW_BYTES * 3) + 1) {
+        if (n > EPD_PANEL_BUFFER_SIZE - pos) {
+            n = EPD_PANEL_BUFFER_SIZE - pos;
+        }
+        epd_7in3e_stream_write(img + pos, n);
+        pos += n;
+    }
+    CHECK_EQ(epd_7in3e_stream_end(), ESP_OK);
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    check_frame(t, img, "stream");
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+
+#if EPD_PANEL_CONTROLLERS > 1
+    // Half rows one at a time: primary, secondary, primary, ...
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        img[i] = (i % EPD_PANEL_ROW_BYTES) < EPD_PANEL_CTRL_ROW_BYTES ? 0x55 : 0x22;
+    }
+    epd_7in3e_stream_begin();
+    for (pos = 0; pos < EPD_PANEL_BUFFER_SIZE; pos += EPD_PANEL_CTRL_ROW_BYTES) {
+        epd_7in3e_stream_write(img + pos, EPD_PANEL_CTRL_ROW_BYTES);
+    }
+    CHECK_EQ(epd_7in3e_stream_end(), ESP_OK);
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    check_frame(t, img, "half rows");
+
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    CHECK(frame != NULL);
+    if (frame != NULL) {
+        CHECK_EQ(pixel_code(frame, EPD_PANEL_WIDTH / 2 - 1, 0), EPD_PANEL_BLUE);
+        CHECK_EQ(pixel_code(frame, EPD_PANEL_WIDTH / 2, 0), EPD_PANEL_YELLOW);
+        CHECK_EQ(pixel_code(frame, EPD_PANEL_WIDTH - 1, EPD_PANEL_HEIGHT - 1), EPD_PANEL_YELLOW);
+    }
+#endif
+    epd_transport_emu_clear_trace(t);
+    free(img);
+}
+
+// Fills go to all controllers at once: each receives its share
+static void test_fills(epd_transport_t *t) {
+    static const uint8_t bands[6] = {
+        EPD_PANEL_BLACK, EPD_PANEL_WHITE, EPD_PANEL_YELLOW,
+        EPD_PANEL_RED, EPD_PANEL_BLUE, EPD_PANEL_GREEN,
+    };
+
+    epd_transport_emu_reset_stats(t);
+    epd_7in3e_clear(EPD_PANEL_GREEN);
+    check_trace(t, expected_display, sizeof(expected_display), "clear");
+    CHECK_EQ(epd_transport_emu_stats(t)->frame_bytes, EPD_PANEL_BUFFER_SIZE / EPD_PANEL_CONTROLLERS);
+    const uint8_t *frame = epd_transport_emu_frame(t);
+    size_t wrong = 0;
+    for (size_t i = 0; frame != NULL && i < EPD_PANEL_BUFFER_SIZE; i++) {
+        wrong += frame[i] != 0x66;
+    }
+    CHECK(frame != NULL);
+    CHECK_EQ(wrong, 0);
+
+    epd_7in3e_show_color_blocks();
+    check_trace(t, expected_display, sizeof(expected_display), "color blocks");
+    frame = epd_transport_emu_frame(t);
+    wrong = 0;
+    for (int y = 0; frame != NULL && y < EPD_PANEL_HEIGHT; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH; x++) {
+            // Bands are cut by byte count in each controller's RAM, so on the
+            // 13.3" panel they end in the middle of a row
+            size_t pos = (size_t)y * EPD_PANEL_CTRL_ROW_BYTES + (x / 2) % EPD_PANEL_CTRL_ROW_BYTES;
+            wrong += pixel_code(frame, x, y) !=
+                     bands[pos / (EPD_PANEL_BUFFER_SIZE / EPD_PANEL_CONTROLLERS / 6)];
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+}
+
+static void test_sleep(epd_transport_t *t) {
+    epd_7in3e_sleep();
+    check_trace(t, expected_sleep, sizeof(expected_sleep), "sleep");
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+}
+
+int main(void) {
+    epd_emu_config_t cfg = EPD_EMU_CONFIG_DEFAULT;
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_emu_create(&cfg, &t), ESP_OK);
+    epd_7in3e_set_transport(t);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+
+    test_init(t);
+    test_display(t, &cfg);
+    test_stream_pieces(t);
+    test_fills(t);
+    test_sleep(t);
+
+    epd_7in3e_deinit_hw();
+    epd_transport_destroy(t);
+    return TEST_RESULT();
+}
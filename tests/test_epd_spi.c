@@ -0,0 +1,244 @@
+/**
+ * @file test_epd_spi.c
+ * @brief SPI transport byte stream against the original driver
+ *
+ * The original driver sent every byte (commands, parameters and frame
+ * data) in its own CS cycle with polling transfers. The bytes and DC
+ * levels on the wire must be unchanged; only the framing differs: frame
+ * data now goes out in queued DMA transactions of at most
+ * EPD_DMA_CHUNK_SIZE bytes under one CS assertion.
+ */
+
+#include "epd_7in3e.h"
+#include "epd_transport.h"
+#include "mock_driver.h"
+#include "esp_timer.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if EPD_PANEL != EPD_PANEL_7IN3E
+#error "test_epd_spi is built for the 7.3 inch panel"
+#endif
+
+#define FRAME_CHUNKS ((EPD_PANEL_BUFFER_SIZE + EPD_DMA_CHUNK_SIZE - 1) / EPD_DMA_CHUNK_SIZE)
+
+static const mock_panel_config_t panel_cfg = {
+    .cs = EPD_PIN_CS, .cs_secondary = -1, .dc = EPD_PIN_DC, .rst = EPD_PIN_RST, .busy = EPD_PIN_BUSY,
+    .reset_busy_ms = 10, .power_on_ms = 60, .refresh_ms = 19000, .power_off_ms = 30,
+};
+
+// Expected bus stream, built the way the original driver sent it
+static mock_spi_byte_t *expected;
+static size_t expected_len;
+static size_t expected_cap;
+
+static void expect_byte(uint8_t byte, uint8_t dc) {
+    if (expected_len == expected_cap) {
+        expected_cap = expected_cap ? expected_cap * 2 : 1024;
+        expected = realloc(expected, expected_cap * sizeof(*expected));
+    }
+    expected[expected_len++] = (mock_spi_byte_t){ .byte = byte, .dc = dc };
+}
+
+static void expect_cmd(uint8_t cmd, size_t n, const uint8_t *params) {
+    expect_byte(cmd, 0);
+    for (size_t i = 0; i < n; i++) {
+        expect_byte(params[i], 1);
+    }
+}
+
+#define EXPECT(cmd, ...) do {                                   \
+    static const uint8_t p_[] = { 0, ##__VA_ARGS__ };           \
+    expect_cmd(cmd, sizeof(p_) - 1, p_ + 1);                    \
+} while (0)
+
+// EPD_7IN3E_Init() of the original driver
+static void expect_init(void) {
+    EXPECT(0xAA, 0x49, 0x55, 0x20, 0x08, 0x09, 0x18);
+    EXPECT(0x01, 0x3F);
+    EXPECT(0x00, 0x5F, 0x69);
+    EXPECT(0x03, 0x00, 0x54, 0x00, 0x44);
+    EXPECT(0x05, 0x40, 0x1F, 0x1F, 0x2C);
+    EXPECT(0x06, 0x6F, 0x1F, 0x17, 0x49);
+    EXPECT(0x08, 0x6F, 0x1F, 0x1F, 0x22);
+    EXPECT(0x30, 0x03);
+    EXPECT(0x50, 0x3F);
+    EXPECT(0x60, 0x02, 0x00);
+    EXPECT(0x61, 0x03, 0x20, 0x01, 0xE0);
+    EXPECT(0x84, 0x01);
+    EXPECT(0xE3, 0x2F);
+    EXPECT(0x04);
+}
+
+// EPD_7IN3E_TurnOnDisplay() of the original driver
+static void expect_turn_on(void) {
+    EXPECT(0x04);
+    EXPECT(0x06, 0x6F, 0x1F, 0x17, 0x49);
+    EXPECT(0x12, 0x00);
+    EXPECT(0x02, 0x00);
+}
+
+// Bytes and DC levels must match the expected stream
+static void check_stream(const char *what) {
+    mock_state_t *st = mock_driver_state();
+    size_t n = st->count < expected_len ? st->count : expected_len;
+    size_t i = 0;
+    while (i < n && st->bytes[i].byte == expected[i].byte && st->bytes[i].dc == expected[i].dc) {
+        i++;
+    }
+    if (i < n || st->count != expected_len) {
+        test_failures++;
+        fprintf(stderr, "%s: %u bytes on the bus, expected %u; first difference at %u",
+                what, (unsigned)st->count, (unsigned)expected_len, (unsigned)i);
+        if (i < n) {
+            fprintf(stderr, " (0x%02X DC=%d, expected 0x%02X DC=%d)", st->bytes[i].byte,
+                    st->bytes[i].dc, expected[i].byte, expected[i].dc);
+        }
+        fprintf(stderr, "\n");
+    }
+    expected_len = 0;
+}
+
+// Command and parameter bytes: one polling transfer and CS cycle each;
+// frame data: queued transfers with CS held low
+static void check_framing(const char *what, size_t frames) {
+    mock_state_t *st = mock_driver_state();
+    size_t polled = 0;
+    size_t queued = 0;
+    size_t bad = 0;
+    for (size_t i = 0; i < st->count; i++) {
+        if (st->bytes[i].queued) {
+            queued++;
+            bad += st->bytes[i].dc != 1;
+        } else {
+            polled++;
+        }
+        bad += st->bytes[i].cs != MOCK_CS_PRIMARY;
+    }
+    CHECK_EQ(bad, 0);
+    CHECK_EQ(polled, st->polling_trans);
+    CHECK_EQ(queued, frames * EPD_PANEL_BUFFER_SIZE);
+    CHECK_EQ(st->cs_cycles, polled + frames);
+    CHECK_EQ(st->queued_trans, frames * FRAME_CHUNKS);
+    if (frames > 0) {
+        CHECK_EQ(st->max_inflight, EPD_DMA_CHUNK_COUNT);
+        CHECK_EQ(st->max_trans_bytes, EPD_DMA_CHUNK_SIZE);
+    }
+    if (st->errors != 0) {
+        test_failures++;
+        fprintf(stderr, "%s: driver misuse: %s\n", what, st->last_error);
+    }
+    mock_driver_clear();
+}
+
+static uint8_t *make_pattern(void) {
+    uint8_t *img = malloc(EPD_PANEL_BUFFER_SIZE);
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        img[i] = (uint8_t)(i * 7 + i / EPD_PANEL_ROW_BYTES);
+    }
+    return img;
+}
+
+static void test_init(void) {
+    int64_t start_us = esp_timer_get_time();
+    epd_7in3e_init();
+    expect_init();
+    check_stream("init");
+    CHECK_EQ(mock_driver_state()->resets, 1);
+    check_framing("init", 0);
+
+    // Reset pulse, BUSY after reset, 30 ms delay, power on
+    int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+    CHECK(elapsed_ms >= 42 + 30 + panel_cfg.power_on_ms);
+    CHECK(elapsed_ms <= 42 + panel_cfg.reset_busy_ms + 30 + panel_cfg.power_on_ms + 2);
+}
+
+static void test_display(void) {
+    uint8_t *img = make_pattern();
+
+    int64_t start_us = esp_timer_get_time();
+    epd_7in3e_display(img);
+    CHECK((esp_timer_get_time() - start_us) / 1000 >= panel_cfg.refresh_ms);
+
+    EXPECT(0x10);
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        expect_byte(img[i], 1);
+    }
+    expect_turn_on();
+    check_stream("display");
+    check_framing("display", 1);
+
+    // Streaming in uneven pieces gives the same stream
+    epd_7in3e_stream_begin();
+    size_t pos = 0;
+    for (size_t n = 1; pos < EPD_PANEL_BUFFER_SIZE; n = n * 3 % 5003 + 1) {
+        if (n > EPD_PANEL_BUFFER_SIZE - pos) {
+            n = EPD_PANEL_BUFFER_SIZE - pos;
+        }
+        epd_7in3e_stream_write(img + pos, n);
+        pos += n;
+    }
+    CHECK_EQ(epd_7in3e_stream_end(), ESP_OK);
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+
+    EXPECT(0x10);
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        expect_byte(img[i], 1);
+    }
+    expect_turn_on();
+    check_stream("stream");
+    check_framing("stream", 1);
+    free(img);
+}
+
+static void test_clear_and_blocks(void) {
+    epd_7in3e_clear(EPD_7IN3E_RED);
+    EXPECT(0x10);
+    for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE; i++) {
+        expect_byte(0x33, 1);
+    }
+    expect_turn_on();
+    check_stream("clear");
+    check_framing("clear", 1);
+
+    static const uint8_t colors[6] = {
+        EPD_7IN3E_BLACK, EPD_7IN3E_WHITE, EPD_7IN3E_YELLOW,
+        EPD_7IN3E_RED, EPD_7IN3E_BLUE, EPD_7IN3E_GREEN,
+    };
+    epd_7in3e_show_color_blocks();
+    EXPECT(0x10);
+    for (int c = 0; c < 6; c++) {
+        for (size_t i = 0; i < EPD_PANEL_BUFFER_SIZE / 6; i++) {
+            expect_byte((colors[c] << 4) | colors[c], 1);
+        }
+    }
+    expect_turn_on();
+    check_stream("color blocks");
+    check_framing("color blocks", 1);
+}
+
+static void test_sleep(void) {
+    epd_7in3e_sleep();
+    EXPECT(0x02, 0x00);
+    EXPECT(0x07, 0xA5);
+    check_stream("sleep");
+    check_framing("sleep", 0);
+}
+
+int main(void) {
+    mock_driver_reset(&panel_cfg);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    mock_driver_clear();
+
+    test_init();
+    test_display();
+    test_clear_and_blocks();
+    test_sleep();
+
+    epd_7in3e_deinit_hw();
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    mock_driver_free();
+    free(expected);
+    return TEST_RESULT();
+}
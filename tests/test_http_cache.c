@@ -0,0 +1,255 @@
+/**
+ * @file test_http_cache.c
+ * @brief HTTP-date parsing, header collection and the next-change delay
+ */
+
+#include "http_cache.h"
+#include "test_util.h"
+#include <string.h>
+
+#define T_1994  784111777LL     // Sun, 06 Nov 1994 08:49:37 GMT
+#define T_2024  1709294400LL    // Fri, 01 Mar 2024 12:00:00 GMT
+
+static int64_t date_of(const char *s) {
+    int64_t t = -12345;
+    return http_cache_parse_date(s, &t) ? t : -12345;
+}
+
+static void test_dates(void) {
+    // The three formats of RFC 9110 for the same instant
+    CHECK_EQ(date_of("Sun, 06 Nov 1994 08:49:37 GMT"), T_1994);
+    CHECK_EQ(date_of("Sunday, 06-Nov-94 08:49:37 GMT"), T_1994);
+    CHECK_EQ(date_of("Sun Nov  6 08:49:37 1994"), T_1994);
+
+    // Leading spaces, month case, single-digit day
+    CHECK_EQ(date_of("  Sun, 6 nov 1994 08:49:37 GMT"), T_1994);
+    CHECK_EQ(date_of("Sun Nov 6 08:49:37 1994"), T_1994);
+
+    // Calendar edges
+    CHECK_EQ(date_of("Tue, 29 Feb 2000 23:59:59 GMT"), 951868799LL);
+    CHECK_EQ(date_of("Fri, 01 Mar 2024 12:00:00 GMT"), T_2024);
+    CHECK_EQ(date_of("Thu, 01 Jan 1970 00:00:00 GMT"), 0);
+    CHECK_EQ(date_of("Sun, 07 Feb 2106 06:28:16 GMT"), 4294967296LL);     // Past 32 bits
+
+    // RFC 850 two-digit years: 70-99 in the 1900s, the rest in the 2000s
+    CHECK_EQ(date_of("Thursday, 01-Jan-37 00:00:00 GMT"), 2114380800LL);
+    CHECK_EQ(date_of("Thursday, 01-Jan-70 00:00:00 GMT"), 0);
+
+    // Not dates
+    CHECK_EQ(date_of("0"), -12345);
+    CHECK_EQ(date_of(""), -12345);
+    CHECK_EQ(date_of("-1"), -12345);
+    CHECK_EQ(date_of("Sun, 06 Foo 1994 08:49:37 GMT"), -12345);
+    CHECK_EQ(date_of("Sun, 32 Nov 1994 08:49:37 GMT"), -12345);
+    CHECK_EQ(date_of("Sun, 00 Nov 1994 08:49:37 GMT"), -12345);
+    CHECK_EQ(date_of("Sun, 06 Nov 1994 24:00:00 GMT"), -12345);
+    CHECK_EQ(date_of("Sun, 06 Nov 1994 08:60:00 GMT"), -12345);
+    CHECK_EQ(date_of("Sun, 06 Nov 1994 08:49 GMT"), -12345);
+}
+
+static void parse(http_cache_hints_t *h, const char *name, const char *value) {
+    http_cache_parse_header(h, name, value);
+}
+
+// Delay for a status, or -1 without a usable hint
+static int64_t next_change(const http_cache_hints_t *h, int status, int64_t now) {
+    uint32_t s = 0xDEADBEEF;
+    if (!http_cache_next_change_s(h, status, now, &s)) {
+        CHECK_EQ(s, 0xDEADBEEF);
+        return -1;
+    }
+    return s;
+}
+
+static void test_headers(void) {
+    http_cache_hints_t h;
+
+    http_cache_hints_reset(&h);
+    parse(&h, "cache-control", "public, max-age=3600, must-revalidate");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_MAX_AGE);
+    CHECK_EQ(h.max_age_s, 3600);
+
+    http_cache_hints_reset(&h);
+    parse(&h, "Cache-Control", "max-age=\"60\"");
+    CHECK_EQ(h.max_age_s, 60);
+    parse(&h, "Cache-Control", "max-age=99999999999");       // Saturates
+    CHECK_EQ(h.max_age_s, UINT32_MAX);
+
+    // Other directives are not max-age
+    http_cache_hints_reset(&h);
+    parse(&h, "Cache-Control", "s-maxage=60, max-age=, private");
+    CHECK_EQ(h.flags, 0);
+
+    http_cache_hints_reset(&h);
+    parse(&h, "AGE", " 120");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_AGE);
+    CHECK_EQ(h.age_s, 120);
+    parse(&h, "Age", "abc");                                  // Ignored, keeps the first
+    CHECK_EQ(h.age_s, 120);
+
+    http_cache_hints_reset(&h);
+    parse(&h, "Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_DATE);
+    CHECK_EQ(h.date, T_1994);
+    parse(&h, "X-Date", "junk");
+    parse(NULL, NULL, NULL);
+    parse(&h, NULL, "1");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_DATE);
+
+    // ETags up to the buffer size, longer ones dropped
+    http_cache_hints_reset(&h);
+    parse(&h, "ETag", "\"abc\"");
+    CHECK_STR(h.etag, "\"abc\"");
+    char long_tag[HTTP_CACHE_ETAG_LEN + 1];
+    memset(long_tag, 'x', sizeof(long_tag) - 1);
+    long_tag[HTTP_CACHE_ETAG_LEN] = '\0';
+    http_cache_hints_reset(&h);
+    parse(&h, "ETag", long_tag);
+    CHECK_STR(h.etag, "");
+    long_tag[HTTP_CACHE_ETAG_LEN - 1] = '\0';
+    parse(&h, "ETag", long_tag);
+    CHECK_EQ(strlen(h.etag), HTTP_CACHE_ETAG_LEN - 1);
+}
+
+static void test_max_age(void) {
+    http_cache_hints_t h;
+
+    http_cache_hints_reset(&h);
+    CHECK_EQ(next_change(&h, 200, T_2024), -1);              // No headers
+
+    parse(&h, "Cache-Control", "max-age=600");
+    CHECK_EQ(next_change(&h, 200, 0), 600);                  // No clock needed
+
+    // Age counts against max-age, down to 0
+    parse(&h, "Age", "100");
+    CHECK_EQ(next_change(&h, 200, 0), 500);
+    parse(&h, "Age", "600");
+    CHECK_EQ(next_change(&h, 200, 0), 0);
+    parse(&h, "Age", "4000000000");
+    CHECK_EQ(next_change(&h, 200, 0), 0);
+
+    // max-age wins over Expires
+    http_cache_hints_reset(&h);
+    parse(&h, "Date", "Fri, 01 Mar 2024 12:00:00 GMT");
+    parse(&h, "Expires", "Fri, 01 Mar 2024 13:00:00 GMT");
+    parse(&h, "Cache-Control", "max-age=60");
+    CHECK_EQ(next_change(&h, 200, T_2024), 60);
+
+    // A 304 carries the new freshness of the unchanged content; errors carry none
+    CHECK_EQ(next_change(&h, 304, T_2024), 60);
+    CHECK_EQ(next_change(&h, 404, T_2024), -1);
+    CHECK_EQ(next_change(&h, 500, T_2024), -1);
+}
+
+static void test_no_cache(void) {
+    static const char *const values[] = {
+        "no-cache", "no-store", "max-age=600, no-cache", "no-store, max-age=600", "No-Cache",
+        "private, no-cache=\"Set-Cookie\"",
+    };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        http_cache_hints_t h;
+        http_cache_hints_reset(&h);
+        parse(&h, "Date", "Fri, 01 Mar 2024 12:00:00 GMT");
+        parse(&h, "Expires", "Fri, 01 Mar 2024 13:00:00 GMT");
+        parse(&h, "Cache-Control", values[i]);
+        CHECK(h.flags & HTTP_CACHE_NO_CACHE);
+        CHECK_EQ(next_change(&h, 200, T_2024), -1);
+        CHECK_EQ(next_change(&h, 304, T_2024), -1);
+    }
+}
+
+static void test_expires(void) {
+    http_cache_hints_t h;
+
+    // Relative to the response's Date, not to the clock
+    http_cache_hints_reset(&h);
+    parse(&h, "Date", "Fri, 01 Mar 2024 12:00:00 GMT");
+    parse(&h, "Expires", "Fri, 01 Mar 2024 12:30:00 GMT");
+    CHECK_EQ(next_change(&h, 200, T_2024 + 600), 1800);
+    CHECK_EQ(next_change(&h, 200, 0), 1800);
+    CHECK_EQ(next_change(&h, 304, T_2024 + 600), 1800);
+
+    // Without Date: the clock, and nothing if it is not set
+    http_cache_hints_reset(&h);
+    parse(&h, "Expires", "Fri, 01 Mar 2024 12:30:00 GMT");
+    CHECK_EQ(next_change(&h, 200, T_2024 + 600), 1200);
+    CHECK_EQ(next_change(&h, 200, 0), -1);
+
+    // In the past: already expired
+    CHECK_EQ(next_change(&h, 200, T_2024 + 7200), 0);
+
+    // "0" and other invalid dates mean already expired, clock or not
+    static const char *const invalid[] = { "0", "-1", "never", "" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        http_cache_hints_reset(&h);
+        parse(&h, "Expires", invalid[i]);
+        CHECK_EQ(h.flags, HTTP_CACHE_HAS_EXPIRES);
+        CHECK_EQ(h.expires, 0);
+        CHECK_EQ(next_change(&h, 200, 0), 0);
+        CHECK_EQ(next_change(&h, 200, T_2024), 0);
+    }
+
+    // Far future saturates
+    http_cache_hints_reset(&h);
+    parse(&h, "Date", "Thu, 01 Jan 1970 00:00:01 GMT");
+    parse(&h, "Expires", "Sun, 07 Feb 2106 06:28:17 GMT");
+    CHECK_EQ(next_change(&h, 200, 0), UINT32_MAX);
+}
+
+static void test_retry_after(void) {
+    http_cache_hints_t h;
+
+    http_cache_hints_reset(&h);
+    parse(&h, "Retry-After", "120");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_RETRY_DELTA);
+    CHECK_EQ(next_change(&h, 429, 0), 120);
+    CHECK_EQ(next_change(&h, 503, 0), 120);
+    CHECK_EQ(next_change(&h, 200, T_2024), -1);              // Only for 429/503
+    CHECK_EQ(next_change(&h, 500, T_2024), -1);
+
+    // As a date, relative to Date or the clock
+    http_cache_hints_reset(&h);
+    parse(&h, "Retry-After", "Fri, 01 Mar 2024 12:05:00 GMT");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_RETRY_DATE);
+    CHECK_EQ(next_change(&h, 503, T_2024), 300);
+    CHECK_EQ(next_change(&h, 429, T_2024 + 400), 0);
+    CHECK_EQ(next_change(&h, 503, 0), -1);
+    parse(&h, "Date", "Fri, 01 Mar 2024 12:04:00 GMT");
+    CHECK_EQ(next_change(&h, 503, 0), 60);
+    CHECK_EQ(next_change(&h, 429, T_2024), 60);
+
+    // Freshness headers do not apply to an error response
+    http_cache_hints_reset(&h);
+    parse(&h, "Cache-Control", "max-age=600");
+    parse(&h, "Retry-After", "junk");
+    CHECK_EQ(h.flags, HTTP_CACHE_HAS_MAX_AGE);
+    CHECK_EQ(next_change(&h, 429, T_2024), -1);
+    CHECK_EQ(next_change(&h, 503, T_2024), -1);
+
+    // Seconds before a date
+    parse(&h, "Retry-After", "30");
+    parse(&h, "Retry-After", "Fri, 01 Mar 2024 13:00:00 GMT");
+    CHECK_EQ(next_change(&h, 503, T_2024), 30);
+}
+
+static void test_policy(void) {
+    CHECK_EQ(http_cache_policy_s(600, 60, 3600, UINT32_MAX), 600);
+    CHECK_EQ(http_cache_policy_s(0, 60, 3600, UINT32_MAX), 60);          // Up to min
+    CHECK_EQ(http_cache_policy_s(7200, 60, 3600, UINT32_MAX), 3600);     // Down to max
+    CHECK_EQ(http_cache_policy_s(UINT32_MAX, 60, 3600, UINT32_MAX), 3600);
+    CHECK_EQ(http_cache_policy_s(600, 60, 3600, 300), 300);              // Limit
+    CHECK_EQ(http_cache_policy_s(7200, 60, 3600, 1800), 1800);
+    CHECK_EQ(http_cache_policy_s(0, 60, 3600, 30), 30);                  // Limit before min
+    CHECK_EQ(http_cache_policy_s(600, 60, 3600, 600), 600);
+}
+
+int main(void) {
+    test_dates();
+    test_headers();
+    test_max_age();
+    test_no_cache();
+    test_expires();
+    test_retry_after();
+    test_policy();
+    return TEST_RESULT();
+}
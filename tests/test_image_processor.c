@@ -0,0 +1,272 @@
+/**
+ * @file test_image_processor.c
+ * @brief Pushed PNG decoding in arbitrary pieces
+ *
+ * A PNG handed to image_processor_png_feed() in pieces of any size must give
+ * the same frame as the whole file in one feed: fixed sizes down to single
+ * bytes, random sizes, and cuts around every chunk boundary, where pngle
+ * leaves a partial chunk header for the next call. The test images have a
+ * text chunk and their data split into several IDAT chunks.
+ */
+
+#include "image_processor.h"
+#include "png_stream.h"
+#include "esp_rom_crc.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void put_be32(test_buf_t *b, uint32_t v) {
+    const uint8_t be[4] = { v >> 24, v >> 16, v >> 8, v };
+    test_buf_write(be, 4, b);
+}
+
+static void put_chunk(test_buf_t *b, const char *type, const uint8_t *data, uint32_t len) {
+    put_be32(b, len);
+    test_buf_write((const uint8_t *)type, 4, b);
+    test_buf_write(data, len, b);
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)type, 4);
+    put_be32(b, esp_rom_crc32_le(crc, data, len));
+}
+
+// Truecolor test pattern: gradients with some texture, and a varying alpha
+static void pattern(uint32_t x, uint32_t y, uint8_t px[4]) {
+    px[0] = (uint8_t)(x * 255 / 799);
+    px[1] = (uint8_t)(y * 255 / 479);
+    px[2] = (uint8_t)(((x / 4 ^ y / 4) & 0x3F) * 4);
+    px[3] = (uint8_t)((x + y) & 0xFF);
+}
+
+// 8-bit RGB (channels 3) or RGBA (4) PNG with IDAT chunks of idat_size bytes
+static void make_png(uint32_t w, uint32_t h, int channels, size_t idat_size, test_buf_t *out) {
+    size_t stride = 1 + (size_t)w * channels;
+    uint8_t *raw = malloc(stride * h);
+    for (uint32_t y = 0; y < h; y++) {
+        uint8_t *row = raw + y * stride;
+        row[0] = 0;     // No filter
+        for (uint32_t x = 0; x < w; x++) {
+            uint8_t px[4];
+            pattern(x, y, px);
+            memcpy(row + 1 + x * channels, px, channels);
+        }
+    }
+    size_t zlen;
+    uint8_t *z = tdefl_compress_mem_to_heap(raw, stride * h, &zlen,
+                                            TDEFL_WRITE_ZLIB_HEADER | TDEFL_DEFAULT_MAX_PROBES);
+    CHECK(z != NULL);
+
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const uint8_t ihdr[13] = { w >> 24, w >> 16, w >> 8, w, h >> 24, h >> 16, h >> 8, h,
+                               8, channels == 4 ? 6 : 2, 0, 0, 0 };
+    static const char text[] = "Comment\0pushed in pieces";
+    memset(out, 0, sizeof(*out));
+    test_buf_write(sig, sizeof(sig), out);
+    put_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+    put_chunk(out, "tEXt", (const uint8_t *)text, sizeof(text) - 1);
+    for (size_t pos = 0; z != NULL && pos < zlen; pos += idat_size) {
+        put_chunk(out, "IDAT", z + pos, zlen - pos < idat_size ? zlen - pos : idat_size);
+    }
+    put_chunk(out, "IEND", NULL, 0);
+    free(z);
+    free(raw);
+}
+
+// 4-bit palette PNG as the firmware writes them (png_stream)
+static void make_palette_png(uint32_t w, uint32_t h, test_buf_t *out) {
+    static const uint8_t pal[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+    uint8_t rgb[EPD_PANEL_PALETTE_SIZE][3];
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        memcpy(rgb[i], pal[i], 3);
+    }
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    uint8_t *row = malloc((w + 1) / 2);
+    memset(out, 0, sizeof(*out));
+    CHECK(png_stream_begin(ps, comp, w, h, 4, (const uint8_t (*)[3])rgb,
+                           EPD_PANEL_PALETTE_SIZE, test_buf_write, out));
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x += 2) {
+            row[x / 2] = (uint8_t)(((x / 8 + y / 8) % 7) << 4 | ((x / 8 + y / 16) % 7));
+        }
+        CHECK(png_stream_row(ps, row));
+    }
+    CHECK(png_stream_end(ps));
+    free(row);
+    free(ps);
+    free(comp);
+}
+
+// Push the PNG in pieces ending at the given offsets (ascending), then the rest
+static esp_err_t push(const test_buf_t *png, const size_t *cuts, int count, uint8_t *frame) {
+    esp_err_t r = image_processor_png_begin();
+    size_t pos = 0;
+    for (int i = 0; i <= count && r == ESP_OK; i++) {
+        size_t end = i < count ? cuts[i] : png->len;
+        r = image_processor_png_feed(png->data + pos, end - pos);
+        pos = end;
+    }
+    if (r != ESP_OK) {
+        return r;
+    }
+    memset(frame, 0xEE, IMAGE_BUFFER_SIZE);
+    return image_processor_png_end(frame, NULL, NULL);
+}
+
+// Push the PNG in pieces of a fixed size
+static esp_err_t push_sized(const test_buf_t *png, size_t size, uint8_t *frame) {
+    esp_err_t r = image_processor_png_begin();
+    for (size_t pos = 0; pos < png->len && r == ESP_OK; pos += size) {
+        r = image_processor_png_feed(png->data + pos, png->len - pos < size ? png->len - pos : size);
+    }
+    if (r != ESP_OK) {
+        return r;
+    }
+    memset(frame, 0xEE, IMAGE_BUFFER_SIZE);
+    return image_processor_png_end(frame, NULL, NULL);
+}
+
+static void check_frame_at(int line, esp_err_t r, const uint8_t *frame, const uint8_t *want,
+                           const char *how, size_t arg) {
+    if (r != ESP_OK || memcmp(frame, want, IMAGE_BUFFER_SIZE) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: %s %zu: %s\n", __FILE__, line, how, arg,
+                r != ESP_OK ? image_processor_get_error() : "frame differs");
+    }
+}
+
+#define CHECK_FRAME(r, frame, want, how, arg) check_frame_at(__LINE__, r, frame, want, how, arg)
+
+static uint32_t rnd_state = 2463534242u;
+
+static uint32_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static void sort_cuts(size_t *cuts, int count) {
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && cuts[j - 1] > cuts[j]; j--) {
+            size_t t = cuts[j];
+            cuts[j] = cuts[j - 1];
+            cuts[j - 1] = t;
+        }
+    }
+}
+
+static void test_pieces(const char *name, const test_buf_t *png) {
+    uint8_t *want = malloc(IMAGE_BUFFER_SIZE);
+    uint8_t *frame = malloc(IMAGE_BUFFER_SIZE);
+
+    // One feed
+    CHECK_EQ(push(png, NULL, 0, want), ESP_OK);
+    printf("%s: %zu bytes\n", name, png->len);
+
+    // Fixed piece sizes, down to single bytes
+    static const size_t sizes[] = { 1, 2, 3, 7, 13, 1000, 65536 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        CHECK_FRAME(push_sized(png, sizes[i], frame), frame, want, "pieces of", sizes[i]);
+    }
+
+    // Random piece sizes
+    size_t cuts[64];
+    for (int run = 0; run < 10; run++) {
+        int count = 1 + (int)(rnd() % 63);
+        for (int i = 0; i < count; i++) {
+            cuts[i] = rnd() % (png->len + 1);
+        }
+        sort_cuts(cuts, count);
+        CHECK_FRAME(push(png, cuts, count, frame), frame, want, "random cuts, run", (size_t)run);
+    }
+
+    // Around every chunk boundary at once: pieces that end k bytes before
+    // (in the CRC) and k bytes after (in the length, type or data)
+    size_t bounds[256], count = 0;
+    for (size_t pos = 8; pos + 12 <= png->len && count < 256; ) {
+        const uint8_t *p = png->data + pos;
+        pos += 12 + ((uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]);
+        bounds[count++] = pos;
+    }
+    size_t *around = malloc(2 * count * sizeof(size_t));
+    for (size_t k = 1; k <= 12; k++) {
+        int n = 0;
+        for (size_t i = 0; i < count; i++) {
+            around[n++] = bounds[i] - k;
+            around[n++] = bounds[i] + k < png->len ? bounds[i] + k : png->len;
+        }
+        sort_cuts(around, n);
+        CHECK_FRAME(push(png, around, n, frame), frame, want, "cuts around the chunks at", k);
+    }
+    free(around);
+
+    // Truncated data never gives a frame
+    for (int i = 1; i <= 8; i++) {
+        size_t cut = png->len * i / 9;
+        esp_err_t r = image_processor_png_begin();
+        if (r == ESP_OK) {
+            r = image_processor_png_feed(png->data, cut);
+        }
+        if (r == ESP_OK) {
+            r = image_processor_png_end(frame, NULL, NULL);
+        }
+        CHECK(r != ESP_OK);
+        CHECK(image_processor_get_error()[0] != '\0');
+    }
+
+    free(frame);
+    free(want);
+}
+
+static void test_state(void) {
+    uint8_t *frame = malloc(IMAGE_BUFFER_SIZE);
+    test_buf_t png;
+    make_png(64, 48, 3, 256, &png);
+
+    // Feed and end without a decode in progress
+    CHECK_EQ(image_processor_png_feed(png.data, png.len), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(image_processor_png_end(frame, NULL, NULL), ESP_ERR_INVALID_STATE);
+
+    // Starting again drops the unfinished decode
+    CHECK_EQ(image_processor_png_begin(), ESP_OK);
+    CHECK_EQ(image_processor_png_feed(png.data, png.len / 2), ESP_OK);
+    CHECK_EQ(push(&png, NULL, 0, frame), ESP_OK);
+
+    // Corrupt data ends the decode
+    png.data[png.len / 2] ^= 0x55;
+    png.data[png.len / 2 + 1] ^= 0xAA;
+    esp_err_t r = push_sized(&png, 7, frame);
+    CHECK(r != ESP_OK);
+    CHECK_EQ(image_processor_png_end(frame, NULL, NULL), ESP_ERR_INVALID_STATE);
+
+    free(png.data);
+    free(frame);
+}
+
+int main(void) {
+    CHECK_EQ(image_processor_init(), ESP_OK);
+    test_buf_t png;
+
+    // Full-size truecolor, shown 1:1 and dithered
+    image_processor_set_scaling(0, 0, false);
+    make_png(IMAGE_WIDTH, IMAGE_HEIGHT, 3, 8192, &png);
+    test_pieces("RGB", &png);
+    free(png.data);
+
+    // Smaller with alpha, padded with white
+    make_png(301, 203, 4, 1021, &png);
+    test_pieces("RGBA", &png);
+    free(png.data);
+
+    // Palette PNG from png_stream, scaled to fit
+    image_processor_set_scaling(0, 0, true);
+    make_palette_png(400, 240, &png);
+    test_pieces("palette", &png);
+    free(png.data);
+
+    image_processor_set_scaling(0, 0, false);
+    test_state();
+    image_processor_deinit();
+    return TEST_RESULT();
+}
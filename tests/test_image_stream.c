@@ -0,0 +1,197 @@
+/**
+ * @file test_image_stream.c
+ * @brief Streamed and buffered frames give the same bytes on the bus
+ *
+ * The same image is rendered for every rotation, mirror and order setting
+ * twice: streamed, with each dithered row going to the panel as it is
+ * produced (as epd_row_sink() does), and buffered, dithered into a frame
+ * that is then sent with epd_7in3e_display(). The recorded SPI streams,
+ * frame data after DATA_START (0x10) included, must be identical. Transforms
+ * that break raster order must report that they cannot stream, and still
+ * give the same stream through the buffered fallback.
+ */
+
+#include "image_processor.h"
+#include "epd_7in3e.h"
+#include "png_stream.h"
+#include "mock_driver.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const mock_panel_config_t panel_cfg = {
+    .cs = EPD_PIN_CS, .cs_secondary = EPD_PIN_CS_S, .dc = EPD_PIN_DC, .rst = EPD_PIN_RST,
+    .busy = EPD_PIN_BUSY, .reset_busy_ms = 10, .power_on_ms = 60, .refresh_ms = 1000,
+    .power_off_ms = 30,
+};
+
+// 8-bit palette PNG of a full frame: 256 colors in diagonal bands with a
+// marker in the top left corner, so no transform maps it onto itself
+static void make_png(test_buf_t *out) {
+    uint8_t pal[256][3];
+    for (int i = 0; i < 256; i++) {
+        pal[i][0] = (uint8_t)i;
+        pal[i][1] = (uint8_t)(i * 7);
+        pal[i][2] = (uint8_t)(255 - i * 3);
+    }
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    uint8_t row[IMAGE_WIDTH];
+    memset(out, 0, sizeof(*out));
+    CHECK(png_stream_begin(ps, comp, IMAGE_WIDTH, IMAGE_HEIGHT, 8, (const uint8_t (*)[3])pal,
+                           256, test_buf_write, out));
+    for (uint32_t y = 0; y < IMAGE_HEIGHT; y++) {
+        for (uint32_t x = 0; x < IMAGE_WIDTH; x++) {
+            row[x] = (x < 64 && y < 32) ? 0 : (uint8_t)((x + 2 * y) / 5);
+        }
+        CHECK(png_stream_row(ps, row));
+    }
+    CHECK(png_stream_end(ps));
+    free(ps);
+    free(comp);
+}
+
+// Image row sink: forward the rows to the panel, as epd_row_sink() does
+typedef struct {
+    uint32_t rows;
+    uint32_t bad;       // Rows out of order or of the wrong length
+} sink_ctx_t;
+
+static void row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    sink_ctx_t *s = ctx;
+    s->bad += row != s->rows || len != IMAGE_ROW_BYTES;
+    s->rows++;
+    if (row == 0) {
+        epd_7in3e_stream_begin();
+    }
+    epd_7in3e_stream_write(data, len);
+}
+
+static esp_err_t decode(const test_buf_t *png) {
+    esp_err_t r = image_processor_png_begin();
+    if (r == ESP_OK) {
+        r = image_processor_png_feed(png->data, png->len);
+    }
+    return r;
+}
+
+// Take the recorded bus stream and start a new recording
+static mock_spi_byte_t *take_stream(size_t *count) {
+    mock_state_t *st = mock_driver_state();
+    mock_spi_byte_t *copy = malloc(st->count * sizeof(*copy) + 1);
+    memcpy(copy, st->bytes, st->count * sizeof(*copy));
+    *count = st->count;
+    mock_driver_clear();
+    return copy;
+}
+
+// Offset of the first frame data byte (after DATA_START), or count
+static size_t frame_start(const mock_spi_byte_t *s, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (s[i].dc == 0 && s[i].byte == EPD_CMD_DATA_START) {
+            return i + 1;
+        }
+    }
+    return count;
+}
+
+static void test_transform(const test_buf_t *png, uint16_t rotation, bool mirror_h, bool mirror_v,
+                           bool rotate_first, mock_spi_byte_t **first, size_t *first_count) {
+    image_processor_set_transform(rotation, mirror_h, mirror_v, rotate_first);
+
+    // Raster order survives 0 and 180 degrees without a net vertical flip
+    bool raster = (rotation == 0 && !mirror_v) || (rotation == 180 && mirror_v);
+    CHECK_EQ(image_processor_can_stream(), raster);
+
+    // Streamed
+    sink_ctx_t sink = { 0 };
+    CHECK_EQ(decode(png), ESP_OK);
+    CHECK_EQ(image_processor_png_end(NULL, row_sink, &sink), ESP_OK);
+    CHECK_EQ(epd_7in3e_stream_end(), ESP_OK);
+    CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+    CHECK_EQ(sink.rows, IMAGE_HEIGHT);
+    CHECK_EQ(sink.bad, 0);
+    size_t streamed_count;
+    mock_spi_byte_t *streamed = take_stream(&streamed_count);
+
+    // Buffered
+    uint8_t *frame = malloc(IMAGE_BUFFER_SIZE);
+    CHECK_EQ(decode(png), ESP_OK);
+    CHECK_EQ(image_processor_png_end(frame, NULL, NULL), ESP_OK);
+    epd_7in3e_display(frame);
+    size_t buffered_count;
+    mock_spi_byte_t *buffered = take_stream(&buffered_count);
+    size_t data = frame_start(buffered, buffered_count);
+    size_t same_data = 0;
+    while (same_data < IMAGE_BUFFER_SIZE && data + same_data < buffered_count &&
+           buffered[data + same_data].byte == frame[same_data]) {
+        same_data++;
+    }
+    CHECK_EQ(same_data, IMAGE_BUFFER_SIZE);
+    free(frame);
+
+    size_t n = streamed_count < buffered_count ? streamed_count : buffered_count;
+    size_t i = 0;
+    while (i < n && streamed[i].byte == buffered[i].byte && streamed[i].dc == buffered[i].dc) {
+        i++;
+    }
+    if (i < n || streamed_count != buffered_count) {
+        test_failures++;
+        fprintf(stderr, "rotation %u, mirror %d/%d, rotate first %d: streamed %zu bytes, "
+                "buffered %zu; first difference at %zu (frame byte %ld)\n",
+                rotation, mirror_h, mirror_v, rotate_first, streamed_count, buffered_count, i,
+                (long)i - (long)data);
+    }
+
+    // Transforms other than the identity (180 degrees with both mirrors is one
+    // too) change the frame: the test image is not symmetric
+    bool identity = (rotation == 0 && !mirror_h && !mirror_v) ||
+                    (rotation == 180 && mirror_h && mirror_v);
+    if (*first == NULL) {
+        *first = buffered;
+        *first_count = buffered_count;
+        buffered = NULL;
+    } else if (!identity) {
+        size_t m = *first_count < buffered_count ? *first_count : buffered_count;
+        size_t k = data;
+        while (k < m && (*first)[k].byte == buffered[k].byte) {
+            k++;
+        }
+        CHECK(k < m);
+    }
+    free(streamed);
+    free(buffered);
+}
+
+int main(void) {
+    mock_driver_reset(&panel_cfg);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    epd_7in3e_init();
+    CHECK_EQ(image_processor_init(), ESP_OK);
+    image_processor_set_scaling(0, 0, false);
+    mock_driver_clear();
+
+    test_buf_t png;
+    make_png(&png);
+
+    mock_spi_byte_t *first = NULL;
+    size_t first_count = 0;
+    int streamable = 0;
+    for (uint16_t rotation = 0; rotation < 360; rotation += 90) {
+        for (int m = 0; m < 8; m++) {
+            bool mirror_h = m & 1, mirror_v = m & 2, rotate_first = m & 4;
+            test_transform(&png, rotation, mirror_h, mirror_v, rotate_first, &first, &first_count);
+            streamable += image_processor_can_stream();
+        }
+    }
+    CHECK_EQ(streamable, 8);    // 0 without and 180 with vertical mirror, either order
+
+    free(first);
+    free(png.data);
+    image_processor_deinit();
+    epd_7in3e_deinit_hw();
+    CHECK_EQ(mock_driver_state()->errors, 0);
+    mock_driver_free();
+    return TEST_RESULT();
+}
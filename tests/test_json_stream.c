@@ -0,0 +1,642 @@
+/**
+ * @file test_json_stream.c
+ * @brief Incremental JSON tokenizer against a reference parser
+ *
+ * The reference is a recursive-descent parser over the whole document with
+ * the tokenizer's rules (token and capture limits, nesting depth, no
+ * \u0000). Both report into the same event log, which must be identical:
+ * the events, their depths and texts, and whether the document is accepted.
+ * The tokenizer is also fed in every split into two chunks and byte by
+ * byte. Seed documents come from the file given as the first argument and
+ * are then mutated for the given number of iterations (second argument).
+ */
+
+#include "json_stream.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DOC_MAX     4096
+#define TOK_DEFAULT 256
+#define CAP_DEFAULT 256
+
+/* ---------------------------------------------------------------------------
+ * Event log
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} log_t;
+
+static void log_append(log_t *l, const void *s, size_t n) {
+    if (l->len + n > l->cap) {
+        l->cap = (l->len + n) * 2;
+        l->data = realloc(l->data, l->cap);
+    }
+    memcpy(l->data + l->len, s, n);
+    l->len += n;
+}
+
+// Options of one run
+typedef struct {
+    size_t tok_size;
+    size_t cap_size;
+    bool capture;       // Capture the values of keys starting with 'c'
+} opts_t;
+
+// Record an event; returns true if the next value is to be captured
+static bool record(log_t *l, const opts_t *o, json_stream_event_t ev, int depth,
+                   const char *str, size_t len) {
+    char head[48];
+    int n = snprintf(head, sizeof(head), "%d@%d:%zu:", (int)ev, depth, str ? len : 0);
+    log_append(l, head, (size_t)n);
+    if (str != NULL) {
+        log_append(l, str, len);
+    }
+    log_append(l, "\n", 1);
+    return o->capture && ev == JSON_STREAM_KEY && len > 0 && str[0] == 'c';
+}
+
+/* ---------------------------------------------------------------------------
+ * Tokenizer
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    log_t *log;
+    const opts_t *opts;
+    char *cap;
+} stream_ctx_t;
+
+static bool stream_cb(json_stream_t *js, json_stream_event_t ev,
+                      const char *str, size_t len, void *ctx) {
+    stream_ctx_t *c = ctx;
+    if (str != NULL && strlen(str) != len) {
+        return json_stream_fail(js, "length mismatch");
+    }
+    if (record(c->log, c->opts, ev, json_stream_depth(js), str, len)) {
+        json_stream_capture(js, c->cap, c->opts->cap_size);
+    }
+    return true;
+}
+
+// Feed the document in chunks ending at the given positions (ascending)
+static bool stream_run(const char *doc, size_t n, const size_t *splits, int count,
+                       const opts_t *o, log_t *log) {
+    char *tok = malloc(o->tok_size);
+    char *cap = malloc(o->cap_size);
+    stream_ctx_t c = { log, o, cap };
+    json_stream_t js;
+    json_stream_init(&js, tok, o->tok_size, stream_cb, &c);
+
+    size_t pos = 0;
+    bool ok = true;
+    for (int i = 0; i <= count && ok; i++) {
+        size_t end = i < count ? splits[i] : n;
+        ok = json_stream_feed(&js, doc + pos, end - pos);
+        pos = end;
+    }
+    ok = ok && json_stream_finish(&js);
+    if (!ok && json_stream_error(&js) == NULL) {
+        test_failures++;
+        fprintf(stderr, "failed without an error message\n");
+    }
+    free(cap);
+    free(tok);
+    return ok;
+}
+
+/* ---------------------------------------------------------------------------
+ * Reference parser
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    const char *s;
+    size_t n;
+    size_t pos;
+    const opts_t *opts;
+    log_t *log;
+    int depth;
+    bool silent;            // Inside a captured value: check only
+    char str[DOC_MAX * 2];
+    size_t str_len;
+} ref_t;
+
+static bool ref_value(ref_t *r, bool capture);
+
+static void ref_ws(ref_t *r) {
+    while (r->pos < r->n && r->s[r->pos] != '\0' && strchr(" \t\n\r", r->s[r->pos]) != NULL) {
+        r->pos++;
+    }
+}
+
+static bool ref_peek(ref_t *r, char c) {
+    return r->pos < r->n && r->s[r->pos] == c;
+}
+
+static bool ref_put(ref_t *r, const char *s, size_t n) {
+    // Only strings outside captures go through the token buffer
+    if (!r->silent && r->str_len + n > r->opts->tok_size - 1) {
+        return false;
+    }
+    memcpy(r->str + r->str_len, s, n);
+    r->str_len += n;
+    return true;
+}
+
+static bool ref_hex4(ref_t *r, uint32_t *out) {
+    *out = 0;
+    for (int i = 0; i < 4; i++) {
+        if (r->pos >= r->n) return false;
+        char c = r->s[r->pos++];
+        uint32_t v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return false;
+        *out = (*out << 4) | v;
+    }
+    return true;
+}
+
+static bool ref_utf8(ref_t *r, uint32_t cp) {
+    char u[4];
+    if (cp < 0x80) {
+        u[0] = (char)cp;
+        return ref_put(r, u, 1);
+    }
+    if (cp < 0x800) {
+        u[0] = (char)(0xC0 | (cp >> 6));
+        u[1] = (char)(0x80 | (cp & 0x3F));
+        return ref_put(r, u, 2);
+    }
+    if (cp < 0x10000) {
+        u[0] = (char)(0xE0 | (cp >> 12));
+        u[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[2] = (char)(0x80 | (cp & 0x3F));
+        return ref_put(r, u, 3);
+    }
+    u[0] = (char)(0xF0 | (cp >> 18));
+    u[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    u[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    u[3] = (char)(0x80 | (cp & 0x3F));
+    return ref_put(r, u, 4);
+}
+
+// String at the current '"', unescaped into r->str
+static bool ref_string(ref_t *r) {
+    r->pos++;
+    r->str_len = 0;
+    for (;;) {
+        if (r->pos >= r->n) return false;
+        char c = r->s[r->pos++];
+        if (c == '"') return true;
+        if ((unsigned char)c < 0x20) return false;
+        if (c != '\\') {
+            if (!ref_put(r, &c, 1)) return false;
+            continue;
+        }
+        if (r->pos >= r->n) return false;
+        c = r->s[r->pos++];
+        if (c != 'u') {
+            switch (c) {
+            case '"': case '\\': case '/': break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            default: return false;
+            }
+            if (!ref_put(r, &c, 1)) return false;
+            continue;
+        }
+        uint32_t cp, low;
+        if (!ref_hex4(r, &cp)) return false;
+        if (cp >= 0xDC00 && cp <= 0xDFFF) return false;
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (r->pos + 2 > r->n || r->s[r->pos] != '\\' || r->s[r->pos + 1] != 'u') return false;
+            r->pos += 2;
+            if (!ref_hex4(r, &low) || low < 0xDC00 || low > 0xDFFF) return false;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        if (cp == 0 || !ref_utf8(r, cp)) return false;
+    }
+}
+
+static bool ref_number(ref_t *r) {
+    size_t start = r->pos;
+    while (r->pos < r->n && r->s[r->pos] != '\0' && strchr("0123456789+-.eE", r->s[r->pos])) {
+        r->pos++;
+    }
+    const char *s = r->s + start;
+    size_t len = r->pos - start, i = 0;
+    if (len > r->opts->tok_size - 1) return false;
+
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    if (i < len && s[i] == '-') i++;
+    if (i < len && s[i] == '0') {
+        i++;
+    } else if (i < len && s[i] >= '1' && s[i] <= '9') {
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    } else {
+        return false;
+    }
+    if (i < len && s[i] == '.') {
+        if (++i >= len || s[i] < '0' || s[i] > '9') return false;
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    }
+    if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < len && (s[i] == '+' || s[i] == '-')) i++;
+        if (i >= len || s[i] < '0' || s[i] > '9') return false;
+        while (i < len && s[i] >= '0' && s[i] <= '9') i++;
+    }
+    if (i != len) return false;
+    if (!r->silent) {
+        record(r->log, r->opts, JSON_STREAM_NUMBER, r->depth, s, len);
+    }
+    return true;
+}
+
+static bool ref_literal(ref_t *r) {
+    static const char *const lits[] = { "true", "false", "null" };
+    for (int i = 0; i < 3; i++) {
+        size_t len = strlen(lits[i]);
+        if (r->s[r->pos] != lits[i][0]) continue;
+        if (r->n - r->pos < len || memcmp(r->s + r->pos, lits[i], len) != 0) return false;
+        r->pos += len;
+        if (!r->silent) {
+            record(r->log, r->opts, i == 2 ? JSON_STREAM_NULL : JSON_STREAM_BOOL, r->depth,
+                   lits[i], len);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool ref_container(ref_t *r) {
+    bool object = r->s[r->pos++] == '{';
+    if (!r->silent) {
+        record(r->log, r->opts, object ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START,
+               r->depth, NULL, 0);
+    }
+    r->depth++;
+    ref_ws(r);
+    if (!ref_peek(r, object ? '}' : ']')) {
+        for (;;) {
+            bool capture = false;
+            if (object) {
+                ref_ws(r);
+                if (!ref_peek(r, '"') || !ref_string(r)) return false;
+                if (!r->silent) {
+                    capture = record(r->log, r->opts, JSON_STREAM_KEY, r->depth, r->str, r->str_len);
+                }
+                ref_ws(r);
+                if (!ref_peek(r, ':')) return false;
+                r->pos++;
+            }
+            if (!ref_value(r, capture)) return false;
+            ref_ws(r);
+            if (!ref_peek(r, ',')) break;
+            r->pos++;
+        }
+        if (!ref_peek(r, object ? '}' : ']')) return false;
+    }
+    r->pos++;
+    r->depth--;
+    if (!r->silent) {
+        record(r->log, r->opts, object ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END,
+               r->depth, NULL, 0);
+    }
+    return true;
+}
+
+static bool ref_value(ref_t *r, bool capture) {
+    ref_ws(r);
+    if (r->pos >= r->n) return false;
+    char c = r->s[r->pos];
+    if (c == '{' || c == '[') {
+        if (r->depth >= JSON_STREAM_MAX_DEPTH) return false;
+        if (!capture) {
+            return ref_container(r);
+        }
+        size_t start = r->pos;
+        r->silent = true;
+        bool ok = ref_container(r);
+        r->silent = false;
+        if (!ok || r->pos - start > r->opts->cap_size - 1) return false;
+        record(r->log, r->opts, JSON_STREAM_RAW, r->depth, r->s + start, r->pos - start);
+        return true;
+    }
+    if (c == '"') {
+        if (!ref_string(r)) return false;
+        if (!r->silent) {
+            record(r->log, r->opts, JSON_STREAM_STRING, r->depth, r->str, r->str_len);
+        }
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        return ref_number(r);
+    }
+    return ref_literal(r);
+}
+
+static bool ref_run(const char *doc, size_t n, const opts_t *o, log_t *log) {
+    static ref_t r;
+    memset(&r, 0, sizeof(r));
+    r.s = doc;
+    r.n = n;
+    r.opts = o;
+    r.log = log;
+    if (!ref_value(&r, false)) return false;
+    ref_ws(&r);
+    return r.pos == n;
+}
+
+/* ---------------------------------------------------------------------------
+ * Differential checks
+ * ------------------------------------------------------------------------- */
+
+static void print_doc(const char *doc, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)doc[i];
+        fprintf(stderr, (c < 0x20 || c >= 0x7F || c == '\\') ? "\\x%02x" : "%c", c);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool same(bool ok_a, const log_t *a, bool ok_b, const log_t *b) {
+    return ok_a == ok_b && a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+
+// The tokenizer agrees with the reference, fed whole and in random chunks;
+// with all_splits also in every split into two and byte by byte
+static bool check_doc(const char *doc, size_t n, const opts_t *o, bool all_splits,
+                      uint32_t (*rnd)(void)) {
+    log_t want = { 0 }, got = { 0 };
+    bool ok_want = ref_run(doc, n, o, &want);
+    bool ok_got = stream_run(doc, n, NULL, 0, o, &got);
+    bool good = same(ok_want, &want, ok_got, &got);
+    if (!good) {
+        fprintf(stderr, "differs from the reference (%s / %s):\n",
+                ok_got ? "accepted" : "rejected", ok_want ? "accepted" : "rejected");
+    }
+
+    size_t splits[DOC_MAX];
+    if (good && all_splits) {
+        for (size_t p = 0; p <= n && good; p++) {
+            got.len = 0;
+            good = same(ok_want, &want, stream_run(doc, n, &p, 1, o, &got), &got);
+        }
+        for (size_t i = 0; i < n; i++) {
+            splits[i] = i + 1;
+        }
+        got.len = 0;
+        good = good && same(ok_want, &want, stream_run(doc, n, splits, (int)n, o, &got), &got);
+        if (!good) {
+            fprintf(stderr, "chunking changed the result:\n");
+        }
+    }
+    if (good && rnd != NULL) {
+        int count = (int)(rnd() % 8);
+        for (int i = 0; i < count; i++) {
+            splits[i] = n ? rnd() % (n + 1) : 0;
+        }
+        for (int i = 1; i < count; i++) {
+            for (int j = i; j > 0 && splits[j - 1] > splits[j]; j--) {
+                size_t t = splits[j];
+                splits[j] = splits[j - 1];
+                splits[j - 1] = t;
+            }
+        }
+        got.len = 0;
+        good = same(ok_want, &want, stream_run(doc, n, splits, count, o, &got), &got);
+        if (!good) {
+            fprintf(stderr, "chunking changed the result:\n");
+        }
+    }
+    if (!good) {
+        test_failures++;
+        fprintf(stderr, "  tok_size %zu, cap_size %zu, capture %d: ", o->tok_size, o->cap_size,
+                o->capture);
+        print_doc(doc, n);
+    }
+    free(want.data);
+    free(got.data);
+    return ok_want;
+}
+
+/* ---------------------------------------------------------------------------
+ * Fixed cases
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    char raw[64];
+    char last[64];
+    int events;
+} fixed_ctx_t;
+
+static bool fixed_cb(json_stream_t *js, json_stream_event_t ev,
+                     const char *str, size_t len, void *ctx) {
+    fixed_ctx_t *c = ctx;
+    c->events++;
+    if (str != NULL) {
+        snprintf(c->last, sizeof(c->last), "%s", str);
+    }
+    if (ev == JSON_STREAM_KEY && strcmp(str, "stop") == 0) {
+        return json_stream_fail(js, "stop key");
+    }
+    if (ev == JSON_STREAM_KEY && strcmp(str, "raw") == 0) {
+        json_stream_capture(js, c->raw, sizeof(c->raw));
+    }
+    return true;
+}
+
+// Rejected with the message at the offset
+static void check_error_at(int line, const char *doc, size_t tok_size, const char *msg,
+                           size_t offset) {
+    char tok[256];
+    fixed_ctx_t c = { 0 };
+    json_stream_t js;
+    json_stream_init(&js, tok, tok_size, fixed_cb, &c);
+    bool ok = json_stream_feed(&js, doc, strlen(doc)) && json_stream_finish(&js);
+    const char *err = json_stream_error(&js);
+    if (ok || err == NULL || strcmp(err, msg) != 0 || json_stream_offset(&js) != offset) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: %s at %zu, expected '%s' at %zu\n", __FILE__, line,
+                ok ? "accepted" : err ? err : "no message", json_stream_offset(&js), msg, offset);
+    }
+}
+
+#define CHECK_ERROR(doc, tok_size, msg, offset) check_error_at(__LINE__, doc, tok_size, msg, offset)
+
+static void test_fixed(void) {
+    CHECK_ERROR("", 16, "unexpected end", 0);
+    CHECK_ERROR("{\"a\":1,}", 16, "expected a key", 7);
+    CHECK_ERROR("[1 2]", 16, "expected ',' or end", 3);
+    CHECK_ERROR("{\"a\" 1}", 16, "expected ':'", 5);
+    CHECK_ERROR("[1}", 16, "mismatched bracket", 2);
+    CHECK_ERROR("01", 16, "invalid number", 2);
+    CHECK_ERROR("[1.]", 16, "invalid number", 3);
+    CHECK_ERROR("\"a\\x\"", 16, "invalid escape", 3);
+    CHECK_ERROR("\"\\u12g4\"", 16, "invalid \\u escape", 5);
+    CHECK_ERROR("\"\\uD800\\n\"", 16, "unpaired surrogate", 8);
+    CHECK_ERROR("\"\\uDC00\"", 16, "unpaired surrogate", 6);
+    CHECK_ERROR("\"\\u0000\"", 16, "\\u0000 in string", 6);
+    CHECK_ERROR("\"a\tb\"", 16, "control character in string", 2);
+    CHECK_ERROR("nul", 16, "unexpected end", 3);
+    CHECK_ERROR("[nulL]", 16, "invalid literal", 4);
+    CHECK_ERROR("{} {}", 16, "data after the end", 3);
+    CHECK_ERROR("\"0123456789\"", 10, "string too long", 10);
+    CHECK_ERROR("[-123456789]", 10, "number too long", 10);
+    CHECK_ERROR("{\"stop\":1}", 16, "stop key", 6);
+    CHECK_ERROR("1", 5, "token buffer too small", 0);
+
+    char deep[2 * JSON_STREAM_MAX_DEPTH + 8] = "";
+    for (int i = 0; i <= JSON_STREAM_MAX_DEPTH; i++) {
+        strcat(deep, "[");
+    }
+    CHECK_ERROR(deep, 16, "nested too deep", JSON_STREAM_MAX_DEPTH);
+
+    // Exactly fitting tokens
+    char tok[16];
+    fixed_ctx_t c = { 0 };
+    json_stream_t js;
+    json_stream_init(&js, tok, 10, fixed_cb, &c);
+    CHECK(json_stream_feed(&js, "[\"012345678\",-12345678]", 23) && json_stream_finish(&js));
+    CHECK_STR(c.last, "-12345678");
+    CHECK_EQ(c.events, 4);
+
+    // A captured value keeps its text, whitespace included
+    memset(&c, 0, sizeof(c));
+    json_stream_init(&js, tok, sizeof(tok), fixed_cb, &c);
+    const char *doc = "{\"raw\": { \"a\" : [1, \"\\u00e9\"] }, \"raw\": 7}";
+    CHECK(json_stream_feed(&js, doc, strlen(doc)) && json_stream_finish(&js));
+    CHECK_STR(c.raw, "{ \"a\" : [1, \"\\u00e9\"] }");
+    CHECK_STR(c.last, "7");
+    CHECK_EQ(c.events, 6);
+    CHECK_EQ(json_stream_offset(&js), strlen(doc));
+
+    // Too long for the capture buffer
+    memset(&c, 0, sizeof(c));
+    json_stream_init(&js, tok, sizeof(tok), fixed_cb, &c);
+    char big[128];
+    snprintf(big, sizeof(big), "{\"raw\":[\"%060d\"]}", 0);
+    CHECK(!json_stream_feed(&js, big, strlen(big)));
+    CHECK_STR(json_stream_error(&js), "value too long");
+}
+
+/* ---------------------------------------------------------------------------
+ * Seeds and mutations
+ * ------------------------------------------------------------------------- */
+
+static uint64_t rnd_state = 88172645463325252ULL;
+
+static uint32_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return (uint32_t)rnd_state;
+}
+
+// Fragments that tend to turn one valid document into another, or nearly
+static const char *const dict[] = {
+    "{", "}", "[", "]", ",", ":", "\"", "\\", "\\u", "D800", "\\uDC00", "\\u00e9",
+    "true", "false", "null", "-", "0", "1e5", ".5", "E+", "\\n", " ", "\x01",
+    "\xe2\x82\xac", "1", "00", "\"c\":", "\"c\":{", "[[[[[[[[",
+};
+
+static int load_seeds(const char *path, char **docs, int max) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 0;
+    }
+    char line[DOC_MAX];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') {
+            docs[n++] = strdup(line);
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static void test_seeds(char **docs, int count) {
+    const opts_t opts[] = {
+        { TOK_DEFAULT, CAP_DEFAULT, false },
+        { TOK_DEFAULT, CAP_DEFAULT, true },
+        { 8, 24, true },
+    };
+    int accepted = 0;
+    for (int i = 0; i < count; i++) {
+        for (size_t k = 0; k < sizeof(opts) / sizeof(opts[0]); k++) {
+            bool ok = check_doc(docs[i], strlen(docs[i]), &opts[k], true, NULL);
+            accepted += k == 0 && ok;
+        }
+    }
+    // The seeds cover both outcomes
+    CHECK(accepted >= 10);
+    CHECK(accepted < count);
+}
+
+static void test_mutations(char **docs, int count, long iterations) {
+    static char buf[DOC_MAX];
+    long accepted = 0, it;
+    // Stops at the first difference, which is printed
+    for (it = 0; it < iterations && test_failures == 0; it++) {
+        const char *src = docs[rnd() % count];
+        size_t n = strlen(src);
+        memcpy(buf, src, n);
+
+        int mutations = (int)(rnd() % 4);
+        for (int m = 0; m < mutations; m++) {
+            size_t p = n ? rnd() % (n + 1) : 0;
+            int kind = (int)(rnd() % 4);
+            if (kind == 0 && n > 0) {
+                buf[rnd() % n] = (char)rnd();
+            } else if (kind == 1 && n > 0) {
+                size_t l = rnd() % 4;
+                if (p + l > n) l = n - p;
+                memmove(buf + p, buf + p + l, n - p - l);
+                n -= l;
+            } else {
+                const char *s = dict[rnd() % (sizeof(dict) / sizeof(dict[0]))];
+                size_t l = strlen(s);
+                if (n + l < DOC_MAX / 2) {
+                    memmove(buf + p + l, buf + p, n - p);
+                    memcpy(buf + p, s, l);
+                    n += l;
+                }
+            }
+        }
+        opts_t o = { 6 + rnd() % 64, 1 + rnd() % 128, (rnd() & 1) != 0 };
+        accepted += check_doc(buf, n, &o, false, rnd);
+    }
+    printf("%ld mutated documents, %ld accepted\n", it, accepted);
+    CHECK(accepted > 0);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <seed file> [iterations]\n", argv[0]);
+        return 2;
+    }
+    char *docs[256];
+    int count = load_seeds(argv[1], docs, 256);
+    CHECK(count > 0);
+
+    test_fixed();
+    if (count > 0) {
+        test_seeds(docs, count);
+        test_mutations(docs, count, argc > 2 ? atol(argv[2]) : 20000);
+    }
+    for (int i = 0; i < count; i++) {
+        free(docs[i]);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,702 @@
+/**
+ * @file test_multipart.c
+ * @brief Streaming multipart parser against a reference over the whole body
+ *
+ * The reference finds delimiters the way RFC 2046 defines them: CRLF, "--",
+ * the boundary, then "--" or up to 15 spaces or tabs and CRLF, where the
+ * start of the body counts as CRLF. Everything else, including near-misses,
+ * is part data. Parser and reference report into the same event log, which
+ * must be identical however the body is cut into chunks: parts with their
+ * Content-Disposition, their data, and the result of the body.
+ *
+ * Seed bodies come from the file given as the first argument and are fed in
+ * every split into two chunks and byte by byte; then the given number of
+ * generated bodies (second argument) with near-miss delimiters, padding,
+ * preambles, epilogues and truncation are fed in random chunks.
+ */
+
+#include "multipart.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define BODY_MAX 32768
+
+/* ---------------------------------------------------------------------------
+ * Event log
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} log_t;
+
+static void log_append(log_t *l, const void *s, size_t n) {
+    if (l->len + n + 1 > l->cap) {
+        l->cap = (l->len + n + 1) * 2;
+        l->data = realloc(l->data, l->cap);
+    }
+    memcpy(l->data + l->len, s, n);
+    l->len += n;
+}
+
+static void log_str(log_t *l, const char *s) {
+    log_append(l, s, strlen(s));
+}
+
+static void log_begin(log_t *l, const char *disp, size_t n) {
+    char head[32];
+    snprintf(head, sizeof(head), "B%zu:", n);
+    log_str(l, head);
+    log_append(l, disp, n);
+}
+
+/* ---------------------------------------------------------------------------
+ * Parser under test
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    log_t *log;
+    bool in_part;
+} run_ctx_t;
+
+static bool run_cb(multipart_event_t ev, const uint8_t *data, size_t len, void *ctx) {
+    run_ctx_t *r = ctx;
+    if (ev == MULTIPART_PART_BEGIN) {
+        log_begin(r->log, (const char *)data, len);
+        r->in_part = true;
+    } else if (ev == MULTIPART_DATA) {
+        if (!r->in_part || len == 0) {
+            log_str(r->log, "!");     // Data outside a part, or empty
+        }
+        log_append(r->log, data, len);
+    } else {
+        log_str(r->log, "E");
+        r->in_part = false;
+    }
+    return true;
+}
+
+// Feed the body in pieces ending at the given offsets (ascending), then the rest
+static void stream_run(const char *content_type, const uint8_t *body, size_t n,
+                       const size_t *splits, int count, log_t *log) {
+    multipart_t *mp = malloc(sizeof(multipart_t));
+    run_ctx_t r = { log, false };
+    log->len = 0;
+    if (!multipart_init(mp, content_type, run_cb, &r)) {
+        log_str(log, "INIT:");
+        log_str(log, multipart_error(mp));
+        free(mp);
+        return;
+    }
+    bool ok = true;
+    size_t pos = 0;
+    for (int i = 0; i <= count && ok; i++) {
+        size_t end = i < count ? splits[i] : n;
+        ok = multipart_feed(mp, body + pos, end - pos);
+        pos = end;
+    }
+    ok = ok && multipart_finish(mp);
+    log_str(log, "|");
+    log_str(log, ok ? "OK" : multipart_error(mp));
+    free(mp);
+}
+
+/* ---------------------------------------------------------------------------
+ * Reference
+ * ------------------------------------------------------------------------- */
+
+// Next delimiter line at or after pos: *start is where its CRLF begins,
+// *end is after it, *close tells a closing delimiter
+static bool ref_delim(const uint8_t *d, size_t n, size_t pos, const char *b, size_t blen,
+                      size_t *start, size_t *end, bool *close) {
+    for (size_t s = pos; s + 4 + blen <= n; s++) {
+        if (memcmp(d + s, "\r\n--", 4) != 0 || memcmp(d + s + 4, b, blen) != 0) {
+            continue;
+        }
+        size_t p = s + 4 + blen;
+        if (p + 2 <= n && d[p] == '-' && d[p + 1] == '-') {
+            *start = s;
+            *end = p + 2;
+            *close = true;
+            return true;
+        }
+        size_t pad = 0;
+        while (p + pad < n && pad < 16 && (d[p + pad] == ' ' || d[p + pad] == '\t')) {
+            pad++;
+        }
+        if (pad <= 15 && p + pad + 2 <= n && d[p + pad] == '\r' && d[p + pad + 1] == '\n') {
+            *start = s;
+            *end = p + pad + 2;
+            *close = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ref_run(const char *b, const uint8_t *body, size_t n, log_t *log) {
+    size_t blen = strlen(b);
+    uint8_t *d = malloc(n + 2);
+    memcpy(d, "\r\n", 2);   // The start of the body counts as CRLF
+    memcpy(d + 2, body, n);
+    n += 2;
+    log->len = 0;
+
+    size_t start, pos;
+    bool close;
+    int parts = 0;
+    const char *result = "OK";
+    if (!ref_delim(d, n, 0, b, blen, &start, &pos, &close)) {
+        result = "no parts";
+    }
+    while (result[0] == 'O' && !close) {
+        // Header lines up to an empty one; lines are kept up to 255 bytes
+        char disp[MULTIPART_LINE_MAX] = "";
+        size_t headers = pos;
+        for (;;) {
+            const uint8_t *nl = memchr(d + pos, '\n', n - pos);
+            size_t line_end = nl ? (size_t)(nl - d) : n;
+            if ((nl ? line_end + 1 : n) - headers > MULTIPART_HEADERS_MAX) {
+                result = "part headers too long";
+                break;
+            }
+            if (nl == NULL) {
+                result = parts == 0 ? "no parts" : "body incomplete";
+                break;
+            }
+            char line[MULTIPART_LINE_MAX];
+            size_t len = line_end - pos < MULTIPART_LINE_MAX - 1 ? line_end - pos : MULTIPART_LINE_MAX - 1;
+            memcpy(line, d + pos, len);
+            if (len > 0 && line[len - 1] == '\r') {
+                len--;
+            }
+            line[len] = '\0';
+            pos = line_end + 1;
+            if (len == 0) {
+                break;
+            }
+            if (strncasecmp(line, "content-disposition:", 20) == 0) {
+                const char *v = line + 20 + strspn(line + 20, " \t");
+                strcpy(disp, v);
+            }
+        }
+        if (result[0] != 'O') {
+            break;
+        }
+
+        parts++;
+        log_begin(log, disp, strlen(disp));
+        size_t end;
+        if (!ref_delim(d, n, pos, b, blen, &start, &end, &close)) {
+            log_append(log, d + pos, n - pos);
+            result = "body incomplete";
+            break;
+        }
+        log_append(log, d + pos, start - pos);
+        log_str(log, "E");
+        pos = end;
+    }
+    log_str(log, "|");
+    log_str(log, result);
+    free(d);
+}
+
+/* ---------------------------------------------------------------------------
+ * Comparison
+ * ------------------------------------------------------------------------- */
+
+static void print_bytes(const char *label, const void *data, size_t n) {
+    const uint8_t *p = data;
+    fprintf(stderr, "  %s: ", label);
+    for (size_t i = 0; i < n && i < 600; i++) {
+        fprintf(stderr, (p[i] < 0x20 || p[i] >= 0x7F || p[i] == '\\') ? "\\x%02x" : "%c", p[i]);
+    }
+    fprintf(stderr, n > 600 ? "...\n" : "\n");
+}
+
+static bool same(const log_t *a, const log_t *b) {
+    return a->len == b->len && memcmp(a->data, b->data, a->len) == 0;
+}
+
+// Every content type the boundary can be given in
+static int content_types(const char *b, char types[3][128]) {
+    int n = 0;
+    snprintf(types[n++], sizeof(types[0]), "multipart/form-data; boundary=\"%s\"", b);
+    snprintf(types[n++], sizeof(types[0]), "multipart/form-data; boundary=\"%s\"; x=y", b);
+    if (strpbrk(b, " ;") == NULL) {
+        snprintf(types[n++], sizeof(types[0]), "Multipart/Form-Data; charset=x; BOUNDARY=%s", b);
+    }
+    return n;
+}
+
+typedef struct {
+    int bodies;
+    int ok;         // Bodies the reference accepts
+    int parts;      // Bodies with at least one part
+} stats_t;
+
+// The parser agrees with the reference, fed whole and in random chunks;
+// with all_splits also in every split into two and byte by byte
+static bool check_body(const char *b, const uint8_t *body, size_t n, bool all_splits,
+                       uint32_t (*rnd)(void), stats_t *stats) {
+    log_t want = { 0 }, got = { 0 };
+    ref_run(b, body, n, &want);
+    stats->bodies++;
+    stats->ok += want.len >= 3 && memcmp(want.data + want.len - 3, "|OK", 3) == 0;
+    stats->parts += want.len > 0 && want.data[0] == 'B';
+
+    char types[3][128];
+    int ntypes = content_types(b, types);
+    size_t *splits = malloc((n + 1) * sizeof(size_t));
+    const char *how = NULL;
+    size_t arg = 0;
+    for (int t = 0; t < ntypes && how == NULL; t++) {
+        stream_run(types[t], body, n, NULL, 0, &got);
+        if (!same(&want, &got)) {
+            how = types[t];
+            break;
+        }
+        if (all_splits && t == 0) {
+            for (size_t p = 0; p <= n && how == NULL; p++) {
+                stream_run(types[t], body, n, &p, 1, &got);
+                if (!same(&want, &got)) {
+                    how = "split at";
+                    arg = p;
+                }
+            }
+            for (size_t i = 0; i < n && how == NULL; i++) {
+                splits[i] = i + 1;
+            }
+            stream_run(types[t], body, n, splits, (int)n, &got);
+            if (how == NULL && !same(&want, &got)) {
+                how = "byte by byte";
+            }
+        }
+        if (rnd != NULL && how == NULL) {
+            // Single bytes, small pieces or large ones
+            static const size_t sizes[] = { 1, 7, 5000 };
+            size_t max = sizes[rnd() % 3];
+            int count = 0;
+            for (size_t pos = 1 + rnd() % max; pos < n; pos += 1 + rnd() % max) {
+                splits[count++] = pos;
+            }
+            stream_run(types[t], body, n, splits, count, &got);
+            if (!same(&want, &got)) {
+                how = "pieces of at most";
+                arg = max;
+            }
+        }
+    }
+    free(splits);
+
+    bool good = how == NULL;
+    if (!good) {
+        test_failures++;
+        fprintf(stderr, "differs from the reference (%s %zu), boundary '%s':\n", how, arg, b);
+        print_bytes("body", body, n);
+        print_bytes("want", want.data, want.len);
+        print_bytes("got ", got.data, got.len);
+    }
+    free(want.data);
+    free(got.data);
+    return good;
+}
+
+/* ---------------------------------------------------------------------------
+ * Fixed cases
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    int data_events;
+    int stop_at;    // Event number that returns false (0 = none)
+    int events;
+} fixed_ctx_t;
+
+static bool fixed_cb(multipart_event_t ev, const uint8_t *data, size_t len, void *ctx) {
+    fixed_ctx_t *f = ctx;
+    f->data_events += ev == MULTIPART_DATA;
+    return ++f->events != f->stop_at;
+}
+
+static void check_init_at(int line, const char *content_type, const char *msg) {
+    multipart_t mp;
+    fixed_ctx_t f = { 0 };
+    bool ok = multipart_init(&mp, content_type, fixed_cb, &f);
+    const char *err = multipart_error(&mp);
+    if (ok != (msg == NULL) || (msg != NULL && (err == NULL || strcmp(err, msg) != 0))) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: init of '%s' gives '%s', expected '%s'\n", __FILE__, line,
+                content_type ? content_type : "(null)", ok ? "ok" : err, msg ? msg : "ok");
+    }
+}
+
+#define CHECK_INIT(type, msg) check_init_at(__LINE__, type, msg)
+
+static void test_fixed(void) {
+    CHECK_INIT(NULL, "not multipart");
+    CHECK_INIT("text/plain; boundary=x", "not multipart");
+    CHECK_INIT("multipart/form-data", "no boundary");
+    CHECK_INIT("multipart/form-data; charset=x", "no boundary");
+    CHECK_INIT("multipart/form-data; boundary=", "invalid boundary");
+    CHECK_INIT("multipart/form-data; boundary=\"\"", "invalid boundary");
+    CHECK_INIT("multipart/form-data; boundary=\"abc", "invalid boundary");
+    CHECK_INIT("multipart/form-data; boundary=\"a\rb\"", "invalid boundary");
+    CHECK_INIT("multipart/form-data; boundary=\"a\nb\"", "invalid boundary");
+    CHECK_INIT("multipart/form-data; boundary="
+               "0123456789012345678901234567890123456789012345678901234567890123456789", NULL);
+    CHECK_INIT("multipart/form-data; boundary="
+               "01234567890123456789012345678901234567890123456789012345678901234567890",
+               "invalid boundary");
+    CHECK_INIT("multipart/mixed;boundary=x", NULL);
+
+    // Data without CR goes on in one piece
+    static uint8_t body[4096];
+    size_t n = 0;
+    n += sprintf((char *)body, "--xyz\r\nContent-Type: text/plain\r\n\r\n");
+    memset(body + n, 'a', 3000);
+    n += 3000;
+    n += sprintf((char *)body + n, "\r\n--xyz--\r\n");
+    multipart_t mp;
+    fixed_ctx_t f = { 0 };
+    CHECK(multipart_init(&mp, "multipart/form-data; boundary=xyz", fixed_cb, &f));
+    CHECK(multipart_feed(&mp, body, n));
+    CHECK(multipart_finish(&mp));
+    CHECK_EQ(f.data_events, 1);
+    CHECK_EQ(multipart_offset(&mp), n);
+
+    // A callback that stops fails the feed, and the parser stays failed
+    for (int stop_at = 1; stop_at <= 3; stop_at++) {
+        f = (fixed_ctx_t){ .stop_at = stop_at };
+        CHECK(multipart_init(&mp, "multipart/form-data; boundary=xyz", fixed_cb, &f));
+        CHECK(!multipart_feed(&mp, body, n));
+        CHECK_STR(multipart_error(&mp), "stopped");
+        CHECK(!multipart_feed(&mp, body, n));
+        CHECK(!multipart_finish(&mp));
+        CHECK_EQ(f.events, stop_at);
+    }
+
+    // Headers beyond the limit, and where that is noticed
+    static uint8_t big[MULTIPART_HEADERS_MAX + 64];
+    n = sprintf((char *)big, "--b\r\n");
+    memset(big + n, 'h', sizeof(big) - n);
+    f = (fixed_ctx_t){ 0 };
+    CHECK(multipart_init(&mp, "multipart/form-data; boundary=b", fixed_cb, &f));
+    CHECK(!multipart_feed(&mp, big, sizeof(big)));
+    CHECK_STR(multipart_error(&mp), "part headers too long");
+    CHECK_EQ(multipart_offset(&mp), n + MULTIPART_HEADERS_MAX);
+
+    // The end of the body decides
+    static const char *const ends[][2] = {
+        { "", "no parts" },
+        { "preamble only\r\n", "no parts" },
+        { "--b\r\nX: y\r\n", "no parts" },
+        { "--b\r\n\r\npart", "body incomplete" },
+        { "--b\r\n\r\npart\r\n--b", "body incomplete" },
+        { "--b\r\n\r\npart\r\n--b-", "body incomplete" },
+        { "--b\r\n\r\npart\r\n--b--", NULL },
+        { "--b--", NULL },
+    };
+    for (size_t i = 0; i < sizeof(ends) / sizeof(ends[0]); i++) {
+        f = (fixed_ctx_t){ 0 };
+        CHECK(multipart_init(&mp, "multipart/form-data; boundary=b", fixed_cb, &f));
+        CHECK(multipart_feed(&mp, (const uint8_t *)ends[i][0], strlen(ends[i][0])));
+        CHECK_EQ(multipart_finish(&mp), ends[i][1] == NULL);
+        if (ends[i][1] != NULL) {
+            CHECK_STR(multipart_error(&mp), ends[i][1]);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Seeds
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    char boundary[MULTIPART_BOUNDARY_MAX + 1];
+    uint8_t *body;
+    size_t len;
+} seed_t;
+
+static int hex(char c) {
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+           c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+// Body with C escapes (\r \n \t \\ \xHH) into bytes
+static size_t unescape(const char *s, uint8_t *out) {
+    size_t n = 0;
+    while (*s) {
+        if (s[0] != '\\' || s[1] == '\0') {
+            out[n++] = (uint8_t)*s++;
+        } else if (s[1] == 'x' && hex(s[2]) >= 0 && hex(s[3]) >= 0) {
+            out[n++] = (uint8_t)(hex(s[2]) << 4 | hex(s[3]));
+            s += 4;
+        } else {
+            out[n++] = s[1] == 'r' ? '\r' : s[1] == 'n' ? '\n' : s[1] == 't' ? '\t' : (uint8_t)s[1];
+            s += 2;
+        }
+    }
+    return n;
+}
+
+static int load_seeds(const char *path, seed_t *seeds, int max) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return 0;
+    }
+    static char line[BODY_MAX];
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), f) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *tab = strchr(line, '\t');
+        if (line[0] == '\0' || line[0] == '#' || tab == NULL ||
+            tab - line > MULTIPART_BOUNDARY_MAX) {
+            continue;
+        }
+        *tab = '\0';
+        strcpy(seeds[n].boundary, line);
+        seeds[n].body = malloc(strlen(tab + 1) + 1);
+        seeds[n].len = unescape(tab + 1, seeds[n].body);
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static void test_seeds(const seed_t *seeds, int count) {
+    stats_t stats = { 0 };
+    for (int i = 0; i < count; i++) {
+        check_body(seeds[i].boundary, seeds[i].body, seeds[i].len, true, NULL, &stats);
+    }
+    // The seeds cover both outcomes
+    CHECK(stats.ok >= 5);
+    CHECK(stats.ok < count);
+}
+
+/* ---------------------------------------------------------------------------
+ * Generated bodies
+ * ------------------------------------------------------------------------- */
+
+static uint32_t rnd_state = 2463534242u;
+
+static uint32_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static bool chance(int percent) {
+    return (int)(rnd() % 100) < percent;
+}
+
+typedef struct {
+    uint8_t data[BODY_MAX];
+    size_t len;
+} body_t;
+
+static void put(body_t *b, const void *s, size_t n) {
+    if (b->len + n <= sizeof(b->data)) {
+        memcpy(b->data + b->len, s, n);
+        b->len += n;
+    }
+}
+
+static void put_str(body_t *b, const char *s) {
+    put(b, s, strlen(s));
+}
+
+static void put_byte(body_t *b, uint8_t c) {
+    put(b, &c, 1);
+}
+
+// Pieces that nearly make a delimiter line, and random bytes
+static void noise(body_t *b, const char *d, int count) {
+    size_t dlen = strlen(d);
+    for (int i = 0; i < count; i++) {
+        switch (rnd() % 12) {
+        case 0:     // Partial delimiter
+            put(b, d, 1 + rnd() % dlen);
+            break;
+        case 1:     // Delimiter followed by something else
+            put_str(b, d);
+            put_byte(b, "xA0\0"[rnd() % 4]);
+            break;
+        case 2:     // Half of the closing "--"
+            put_str(b, d);
+            put_str(b, "-x");
+            break;
+        case 3:     // Just enough or too much padding
+            put_str(b, d);
+            for (uint32_t k = 14 + rnd() % 6; k > 0; k--) {
+                put_byte(b, chance(50) ? ' ' : '\t');
+            }
+            put_str(b, "\r\n");
+            break;
+        case 4:
+            put_str(b, d);
+            put_str(b, "\rx");
+            break;
+        case 5:
+            put_str(b, "\r\r\n-");
+            put_str(b, d + 4);
+            break;
+        case 6:     // No CRLF before
+            put_str(b, d + 2);
+            put_str(b, "\r\n");
+            break;
+        case 7:
+            for (uint32_t k = 1 + rnd() % 7; k > 0; k--) {
+                put_byte(b, "\r\n-"[rnd() % 3]);
+            }
+            break;
+        case 8:     // Last boundary character off by one
+            put(b, d, dlen - 1);
+            put_byte(b, (uint8_t)(d[dlen - 1] + 1));
+            put_str(b, "\r\n");
+            break;
+        default:
+            for (uint32_t k = rnd() % 40; k > 0; k--) {
+                put_byte(b, (uint8_t)rnd());
+            }
+            break;
+        }
+    }
+}
+
+// Replace every delimiter line in b->data[from..] with "Z"
+static void drop_delims(body_t *b, size_t from, const char *boundary) {
+    size_t blen = strlen(boundary), start, end;
+    bool close;
+    while (ref_delim(b->data, b->len, from, boundary, blen, &start, &end, &close)) {
+        b->data[start] = 'Z';
+        memmove(b->data + start + 1, b->data + end, b->len - end);
+        b->len -= end - start - 1;
+        from = start;
+    }
+}
+
+static void gen_body(char *boundary, body_t *b) {
+    static const char chars[] =
+        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ'()+_,-./:=? ";
+    size_t blen = 1 + rnd() % MULTIPART_BOUNDARY_MAX;
+    for (size_t i = 0; i < blen; i++) {
+        boundary[i] = chars[rnd() % (sizeof(chars) - 1)];
+    }
+    while (blen > 0 && boundary[blen - 1] == ' ') {
+        blen--;     // No trailing space (RFC 2046)
+    }
+    if (blen == 0) {
+        boundary[blen++] = 'x';
+    }
+    if (chance(20)) {
+        blen = 1 + rnd() % 5;
+        memset(boundary, '-', blen);
+    } else if (chance(10)) {
+        boundary[0] = 'a';
+        blen = 1;
+    }
+    boundary[blen] = '\0';
+
+    char d[4 + MULTIPART_BOUNDARY_MAX + 1];
+    snprintf(d, sizeof(d), "\r\n--%s", boundary);
+    b->len = 0;
+
+    // Preamble, possibly with near-misses
+    if (chance(50)) {
+        noise(b, d, rnd() % 4);
+        drop_delims(b, 0, boundary);
+    }
+
+    int parts = rnd() % 4;
+    for (int i = 0; i < parts; i++) {
+        put_str(b, i == 0 && chance(70) ? d + 2 : d);
+        for (uint32_t k = rnd() % 3; k > 0; k--) {
+            put_byte(b, ' ');
+        }
+        put_str(b, "\r\n");
+
+        char h[512];
+        int nh = 0;
+        for (int k = 0; k < 4; k++) {
+            h[0] = '\0';
+            if (k == 0 && chance(80)) {
+                snprintf(h, sizeof(h),
+                         "Content-Disposition: form-data; name=\"f%d\"; filename=\"a%d.bin\"", i, i);
+            } else if (k == 1 && chance(50)) {
+                strcpy(h, "Content-Type: application/octet-stream");
+            } else if (k == 2 && chance(10)) {
+                size_t n = 240 + rnd() % 160;
+                strcpy(h, "X-Long: ");
+                memset(h + 8, 'y', n);
+                h[8 + n] = '\0';
+            } else if (k == 3 && chance(10)) {
+                strcpy(h, "content-disposition:form-data; name=\"late\"");
+            }
+            if (h[0] != '\0') {
+                put_str(b, h);
+                put_str(b, chance(90) ? "\r\n" : "\n");
+                nh++;
+            }
+        }
+        if (chance(1)) {
+            // Header section over the limit
+            for (int k = 0; k < MULTIPART_HEADERS_MAX / 100 + 1; k++) {
+                put_str(b, "X-Pad: 0123456789012345678901234567890123456789"
+                           "01234567890123456789012345678901234567890123\r\n");
+            }
+        }
+        put_str(b, "\r\n");
+
+        size_t content = b->len;
+        noise(b, d, rnd() % 12);
+        drop_delims(b, content, boundary);
+    }
+    put_str(b, d);
+    put_str(b, "--");
+    if (chance(50)) {
+        put_str(b, "\r\nepilogue ");
+        put_str(b, d);
+        put_str(b, "\r\n");
+    }
+    if (chance(15)) {
+        b->len = rnd() % (b->len + 1);
+    }
+}
+
+static void test_generated(long iterations) {
+    static body_t body;
+    char boundary[MULTIPART_BOUNDARY_MAX + 1];
+    stats_t stats = { 0 };
+    long it;
+    // Stops at the first difference, which is printed
+    for (it = 0; it < iterations && test_failures == 0; it++) {
+        gen_body(boundary, &body);
+        check_body(boundary, body.data, body.len, false, rnd, &stats);
+    }
+    printf("%ld generated bodies, %d with parts, %d accepted\n", it, stats.parts, stats.ok);
+    CHECK(stats.ok > it / 2);
+    CHECK(stats.ok < it);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <seed file> [bodies]\n", argv[0]);
+        return 2;
+    }
+    static seed_t seeds[256];
+    int count = load_seeds(argv[1], seeds, 256);
+    CHECK(count > 0);
+
+    test_fixed();
+    test_seeds(seeds, count);
+    test_generated(argc > 2 ? atol(argv[2]) : 5000);
+    for (int i = 0; i < count; i++) {
+        free(seeds[i].body);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,236 @@
+/**
+ * @file test_panel_layout.c
+ * @brief Layout parser and the split of one image across several panels
+ *
+ * The parser must reject malformed layouts and pins the panels cannot be
+ * driven with (out of range, input-only, used twice or by the SPI bus).
+ * The split renders a canvas PNG once per panel with the region from
+ * panel_layout_region() and checks the frame the emulated panel shows
+ * against the matching cell of the canvas.
+ */
+
+#include "panel_layout.h"
+#include "epd_transport_emu.h"
+#include "image_processor.h"
+#include "png_stream.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+
+static void check_default(const panel_layout_t *l) {
+    CHECK_EQ(l->count, 1);
+    CHECK_EQ(l->cols, 1);
+    CHECK_EQ(l->rows, 1);
+    CHECK_EQ(l->pins[0].cs, EPD_PIN_CS);
+    CHECK_EQ(l->pins[0].dc, EPD_PIN_DC);
+    CHECK_EQ(l->pins[0].rst, EPD_PIN_RST);
+    CHECK_EQ(l->pins[0].busy, EPD_PIN_BUSY);
+    CHECK_EQ(l->pins[0].cs_secondary, EPD_PIN_CS_S);
+}
+
+// A rejected layout leaves the default single panel
+static void check_rejected_at(int line, const char *str) {
+    panel_layout_t l;
+    if (panel_layout_parse(str, &l) != ESP_ERR_INVALID_ARG) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: layout '%s' was accepted\n", __FILE__, line, str);
+    }
+    check_default(&l);
+}
+
+#define CHECK_REJECTED(str) check_rejected_at(__LINE__, str)
+
+static void test_parse(void) {
+    panel_layout_t l;
+
+    CHECK_EQ(panel_layout_parse(NULL, &l), ESP_OK);
+    check_default(&l);
+    CHECK_EQ(panel_layout_parse("", &l), ESP_OK);
+    check_default(&l);
+    CHECK_EQ(panel_layout_parse("1x1", &l), ESP_OK);
+    check_default(&l);
+
+#if EPD_PANEL_CONTROLLERS == 1
+    CHECK_EQ(panel_layout_parse("2x1;10,9,8,7;4,5,6,15", &l), ESP_OK);
+    CHECK_EQ(l.cols, 2);
+    CHECK_EQ(l.rows, 1);
+    CHECK_EQ(l.count, 2);
+    CHECK_EQ(l.pins[1].cs, 4);
+    CHECK_EQ(l.pins[1].dc, 5);
+    CHECK_EQ(l.pins[1].rst, 6);
+    CHECK_EQ(l.pins[1].busy, 15);
+    CHECK_EQ(l.pins[1].cs_secondary, -1);
+
+    CHECK_EQ(panel_layout_parse("2x2;0,1,2,3;4,5,6,7;8,9,10,13;14,15,16,48", &l), ESP_OK);
+    CHECK_EQ(l.count, 4);
+    CHECK_EQ(l.pins[3].busy, 48);
+
+    // Malformed
+    CHECK_REJECTED("0x1");
+    CHECK_REJECTED("3x2;1,2,3,4;5,6,7,8;9,10,13,14;15,16,17,18;19,20,21,26;27,28,29,30");
+    CHECK_REJECTED("2x1;10,9,8,7");
+    CHECK_REJECTED("1x1;10,9,8,7;");
+    CHECK_REJECTED("1x1;10,9,8,7,13");     // No second controller
+    CHECK_REJECTED("1x1;10,9,8");
+    CHECK_REJECTED("1x1;10,9,8,7x");
+    CHECK_REJECTED("x1;10,9,8,7");
+
+    // Pins out of range (must not reach the 1ULL << pin in the driver)
+    CHECK_REJECTED("1x1;-1,70,3,4");
+    CHECK_REJECTED("1x1;1,2,3,70");
+    CHECK_REJECTED("1x1;1,2,3,49");
+    CHECK_REJECTED("1x1;1,2,3,-1");
+    CHECK_REJECTED("1x1;1,2,1000000,4");
+    CHECK_REJECTED("1x1;1,2,3,64");
+
+    // Pins the ESP32-S3 does not have
+    CHECK_REJECTED("1x1;22,2,3,4");
+    CHECK_REJECTED("1x1;1,2,3,25");
+
+    // Pins used twice, or taken by the SPI bus
+    CHECK_REJECTED("1x1;1,1,3,4");
+    CHECK_REJECTED("1x1;1,2,3,1");
+    CHECK_REJECTED("2x1;1,2,3,4;5,6,7,4");
+    CHECK_REJECTED("2x1;1,2,3,4;1,6,7,8");
+    CHECK_REJECTED("1x1;11,2,3,4");
+    CHECK_REJECTED("1x1;1,2,12,4");
+#else
+    CHECK_EQ(panel_layout_parse("2x1;10,9,8,7,13;4,5,6,15,16", &l), ESP_OK);
+    CHECK_EQ(l.count, 2);
+    CHECK_EQ(l.pins[0].cs_secondary, 13);
+    CHECK_EQ(l.pins[1].cs_secondary, 16);
+
+    CHECK_REJECTED("1x1;10,9,8,7");         // Missing the second CS
+    CHECK_REJECTED("1x1;10,9,8,7,-1");
+    CHECK_REJECTED("1x1;10,9,8,7,10");      // cs == cs_secondary
+    CHECK_REJECTED("2x1;10,9,8,7,13;4,5,6,15,13");
+    CHECK_REJECTED("1x1;10,9,8,7,70");
+    CHECK_REJECTED("1x1;10,9,8,7,24");
+    CHECK_REJECTED("1x1;10,9,8,7,11");
+#endif
+}
+
+static void test_url(void) {
+    char url[64];
+    CHECK(panel_layout_url("http://h/p{panel}.png", 3, url, sizeof(url)));
+    CHECK_STR(url, "http://h/p3.png");
+    CHECK(!panel_layout_url("http://h/p.png", 3, url, sizeof(url)));
+    CHECK_STR(url, "http://h/p.png");
+}
+
+// Color of a canvas pixel: one of the six panel colors, per 40x32 block,
+// without a period that a panel offset could hide
+static uint8_t canvas_color(uint32_t x, uint32_t y) {
+    static const uint8_t idx[6] = { 0, 1, 2, 3, 5, 6 };     // Skip orange
+    uint32_t h = (x / 40) * 73856093u ^ (y / 32) * 19349663u;
+    return idx[(h >> 4) % 6];
+}
+
+// Encode the canvas as an indexed PNG in the dither palette
+static void make_canvas_png(uint32_t width, uint32_t height, test_buf_t *out) {
+    uint8_t pal[EPD_PANEL_PALETTE_SIZE][3];
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        memcpy(pal[i], palette[i], 3);
+    }
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    uint8_t *row = malloc(width / 2);
+    CHECK(png_stream_begin(ps, comp, width, height, 4, (const uint8_t (*)[3])pal,
+                           EPD_PANEL_PALETTE_SIZE, test_buf_write, out));
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x += 2) {
+            row[x / 2] = (canvas_color(x, y) << 4) | canvas_color(x + 1, y);
+        }
+        CHECK(png_stream_row(ps, row));
+    }
+    CHECK(png_stream_end(ps));
+    free(row);
+    free(ps);
+    free(comp);
+}
+
+static void row_sink(uint32_t row, const uint8_t *data, size_t len, void *ctx) {
+    if (row == 0) {
+        epd_7in3e_stream_begin();
+    }
+    epd_7in3e_stream_write(data, len);
+}
+
+static void test_split(const char *str) {
+    panel_layout_t layout;
+    CHECK_EQ(panel_layout_parse(str, &layout), ESP_OK);
+
+    uint16_t canvas_w, canvas_h, x, y;
+    panel_layout_region(&layout, 0, &canvas_w, &canvas_h, &x, &y);
+    CHECK_EQ(canvas_w, layout.cols * EPD_PANEL_WIDTH);
+    CHECK_EQ(canvas_h, layout.rows * EPD_PANEL_HEIGHT);
+
+    test_buf_t png = { 0 };
+    make_canvas_png(canvas_w, canvas_h, &png);
+
+    epd_transport_t *t = epd_7in3e_get_transport();
+    for (int i = 0; i < layout.count; i++) {
+        panel_layout_region(&layout, i, &canvas_w, &canvas_h, &x, &y);
+        CHECK_EQ(x, (i % layout.cols) * EPD_PANEL_WIDTH);
+        CHECK_EQ(y, (i / layout.cols) * EPD_PANEL_HEIGHT);
+
+        image_processor_set_region(canvas_w, canvas_h, x, y);
+        CHECK_EQ(image_processor_png_begin(), ESP_OK);
+        for (size_t pos = 0; pos < png.len; pos += 4096) {
+            size_t n = png.len - pos < 4096 ? png.len - pos : 4096;
+            CHECK_EQ(image_processor_png_feed(png.data + pos, n), ESP_OK);
+        }
+        CHECK_EQ(image_processor_png_end(NULL, row_sink, NULL), ESP_OK);
+        CHECK_EQ(epd_7in3e_stream_end(), ESP_OK);
+        CHECK_EQ(epd_7in3e_wait_idle(EPD_BUSY_TIMEOUT_MS), ESP_OK);
+
+        const uint8_t *frame = epd_transport_emu_frame(t);
+        CHECK(frame != NULL);
+        size_t bad = 0;
+        for (uint32_t py = 0; frame != NULL && py < EPD_PANEL_HEIGHT; py++) {
+            for (uint32_t px = 0; px < EPD_PANEL_WIDTH; px++) {
+                uint8_t b = frame[py * EPD_PANEL_ROW_BYTES + px / 2];
+                uint8_t code = (px & 1) ? (b & 0x0F) : (b >> 4);
+                bad += code != palette[canvas_color(x + px, y + py)][3];
+            }
+        }
+        if (bad != 0) {
+            test_failures++;
+            fprintf(stderr, "%s panel %d: %u pixels differ from the canvas\n",
+                    str, i, (unsigned)bad);
+        }
+    }
+    CHECK_EQ(epd_transport_emu_stats(t)->errors, 0);
+    free(png.data);
+}
+
+int main(void) {
+    test_parse();
+    test_url();
+
+    epd_emu_config_t cfg = EPD_EMU_CONFIG_DEFAULT;
+    cfg.spi_hz = 0;
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_emu_create(&cfg, &t), ESP_OK);
+    epd_7in3e_set_transport(t);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    epd_7in3e_init();
+    CHECK_EQ(image_processor_init(), ESP_OK);
+    image_processor_set_scaling(0, 0, false);
+
+#if EPD_PANEL_CONTROLLERS == 1
+    test_split("2x1;10,9,8,7;4,5,6,15");
+    test_split("1x2;10,9,8,7;4,5,6,15");
+    test_split("2x2;0,1,2,3;4,5,6,7;8,9,10,13;14,15,16,48");
+#else
+    test_split("2x1;10,9,8,7,13;4,5,6,15,16");
+#endif
+
+    image_processor_deinit();
+    epd_7in3e_deinit_hw();
+    epd_transport_destroy(t);
+    return TEST_RESULT();
+}
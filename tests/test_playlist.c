@@ -0,0 +1,378 @@
+/**
+ * @file test_playlist.c
+ * @brief Index of the stored slideshow frames over a simulated data area
+ *
+ * Frames are stored the way slides.c does it: playlist_index_place(), erase
+ * and write the returned range, then playlist_index_add(). Every frame
+ * holds a pattern of its key, so a frame whose sectors were erased while it
+ * is still in the index fails the check of the stored data.
+ */
+
+#include "playlist.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SECTOR      4096
+#define SECTORS(n)  ((uint32_t)(n) * SECTOR)
+
+static uint8_t *area;
+static uint32_t area_size;
+
+static void area_reset(playlist_index_t *idx, uint32_t sectors) {
+    free(area);
+    area_size = SECTORS(sectors);
+    area = malloc(area_size);
+    memset(area, 0xFF, area_size);
+    playlist_index_reset(idx, area_size, SECTOR, 0x1234);
+}
+
+static uint8_t pattern(uint32_t key, uint32_t i) {
+    return (uint8_t)(key * 7 + i * 31 + (i >> 8));
+}
+
+// Index consistent with the data area: frames in bounds, aligned, apart,
+// unique and with their data intact
+static void check_index_at(int line, const playlist_index_t *idx) {
+    int bad = 0;
+    if (idx->count > PLAYLIST_MAX_ENTRIES || idx->head % SECTOR != 0 || idx->head >= area_size) {
+        bad++;
+    }
+    for (int i = 0; i < idx->count && i < PLAYLIST_MAX_ENTRIES; i++) {
+        const playlist_entry_t *e = &idx->entry[i];
+        if (e->offset % SECTOR != 0 || e->size == 0 || e->offset + e->size > area_size) {
+            bad++;
+            continue;
+        }
+        if (playlist_hash(area + e->offset, e->size, PLAYLIST_HASH_INIT) != e->crc) {
+            bad++;
+        }
+        for (int j = 0; j < i; j++) {
+            const playlist_entry_t *o = &idx->entry[j];
+            if (o->key == e->key || (o->offset < e->offset + e->size && e->offset < o->offset + o->size)) {
+                bad++;
+            }
+        }
+    }
+    if (bad != 0) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: index inconsistent with the data area (%d problems)\n",
+                __FILE__, line, bad);
+    }
+}
+
+#define CHECK_INDEX(idx) check_index_at(__LINE__, idx)
+
+// Store a frame as slides.c does; returns the evicted count (-1 if too large)
+static int store(playlist_index_t *idx, uint32_t key, uint32_t size, uint8_t position,
+                 uint32_t *offset_out) {
+    uint32_t offset = 0xFFFFFFFF, erase_len = 0;
+    int before = idx->count;
+    int evicted = playlist_index_place(idx, size, &offset, &erase_len);
+    if (evicted < 0) {
+        CHECK_EQ(idx->count, before);
+        return evicted;
+    }
+    CHECK_EQ(idx->count, before - evicted);
+    CHECK(idx->count < PLAYLIST_MAX_ENTRIES);
+    CHECK_EQ(erase_len, (size + SECTOR - 1) / SECTOR * SECTOR);
+    CHECK_EQ(offset % SECTOR, 0);
+    CHECK(offset + erase_len <= area_size);
+    // The evicted frames are gone before their sectors are erased
+    for (int i = 0; i < idx->count; i++) {
+        CHECK(idx->entry[i].offset >= offset + erase_len ||
+              idx->entry[i].offset + idx->entry[i].size <= offset);
+    }
+    if (offset + erase_len > area_size) {
+        return evicted;
+    }
+
+    memset(area + offset, 0xFF, erase_len);
+    for (uint32_t i = 0; i < size; i++) {
+        area[offset + i] = pattern(key, i);
+    }
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%u\"", (unsigned)key);
+    playlist_index_add(idx, offset, size, playlist_hash(area + offset, size, PLAYLIST_HASH_INIT),
+                       key, etag, position);
+    if (offset_out != NULL) {
+        *offset_out = offset;
+    }
+    return evicted;
+}
+
+static bool stored(const playlist_index_t *idx, uint32_t key) {
+    return playlist_index_find(idx, key) >= 0;
+}
+
+static void relist(playlist_index_t *idx, uint32_t key, uint8_t position) {
+    int e = playlist_index_find(idx, key);
+    CHECK(e >= 0);
+    if (e >= 0) {
+        idx->entry[e].position = position;
+    }
+}
+
+// Fill the ring, then wrap: the head continues where the last frame ended
+// and the oldest frame goes first
+static void test_ring(void) {
+    playlist_index_t idx;
+    uint32_t offset;
+    area_reset(&idx, 16);
+    idx.frames = 8;
+
+    for (uint32_t k = 1; k <= 5; k++) {
+        CHECK_EQ(store(&idx, k, SECTORS(3) - 100, k - 1, &offset), 0);
+        CHECK_EQ(offset, SECTORS(3 * (k - 1)));
+    }
+    CHECK_EQ(idx.head, SECTORS(15));
+    CHECK_EQ(playlist_index_listed(&idx, NULL), 5);
+    CHECK_INDEX(&idx);
+
+    // No room at the head: back to the start, over the oldest frame
+    CHECK_EQ(store(&idx, 6, SECTORS(3), 5, &offset), 1);
+    CHECK_EQ(offset, 0);
+    CHECK(!stored(&idx, 1));
+    CHECK_EQ(idx.head, SECTORS(3));
+
+    // ... and on around the ring
+    CHECK_EQ(store(&idx, 7, SECTORS(3), 6, &offset), 1);
+    CHECK_EQ(offset, SECTORS(3));
+    CHECK(!stored(&idx, 2));
+    CHECK_EQ(idx.count, 5);
+    CHECK_INDEX(&idx);
+
+    // A frame ending at the end of the area wraps the head to 0
+    area_reset(&idx, 8);
+    CHECK_EQ(store(&idx, 1, SECTORS(5), 0, &offset), 0);
+    CHECK_EQ(store(&idx, 2, SECTORS(3) - 1, 1, &offset), 0);
+    CHECK_EQ(offset, SECTORS(5));
+    CHECK_EQ(idx.head, 0);
+    CHECK_INDEX(&idx);
+}
+
+// Fewest listed victims first, then free space, then the oldest victim
+static void test_scoring(void) {
+    playlist_index_t idx;
+    uint32_t offset;
+    area_reset(&idx, 12);
+    idx.frames = 8;
+
+    CHECK_EQ(store(&idx, 1, SECTORS(4), 0, NULL), 0);       // A: 0-4
+    CHECK_EQ(store(&idx, 2, SECTORS(4), 1, NULL), 0);       // B: 4-8
+    CHECK_EQ(store(&idx, 3, SECTORS(2), 2, NULL), 0);       // C: 8-10, 10-12 free
+    CHECK_EQ(idx.head, SECTORS(10));
+
+    // B left the manifest: it goes before the older A
+    playlist_index_unlist(&idx);
+    CHECK_EQ(idx.frames, 0);
+    CHECK_EQ(playlist_index_listed(&idx, NULL), 0);
+    idx.frames = 8;
+    relist(&idx, 1, 0);
+    relist(&idx, 3, 1);
+    CHECK_EQ(store(&idx, 4, SECTORS(4), 2, &offset), 1);    // D: 4-8
+    CHECK_EQ(offset, SECTORS(4));
+    CHECK(stored(&idx, 1) && !stored(&idx, 2));
+    CHECK_INDEX(&idx);
+
+    // Free space beats the head, which is over C
+    CHECK_EQ(idx.head, SECTORS(8));
+    CHECK_EQ(store(&idx, 5, SECTORS(2), 3, &offset), 0);    // E: 10-12
+    CHECK_EQ(offset, SECTORS(10));
+    CHECK_EQ(idx.head, 0);
+
+    // Everything listed: one victim rather than two (C and E at 8-12),
+    // the oldest one (A) of those
+    CHECK_EQ(store(&idx, 6, SECTORS(4), 4, &offset), 1);
+    CHECK_EQ(offset, 0);
+    CHECK(!stored(&idx, 1));
+    CHECK(stored(&idx, 3) && stored(&idx, 4) && stored(&idx, 5));
+    CHECK_INDEX(&idx);
+
+    // Fewest listed victims even over the oldest: 0-5 would take A and B
+    area_reset(&idx, 16);
+    idx.frames = 8;
+    CHECK_EQ(store(&idx, 1, SECTORS(4), 0, NULL), 0);
+    CHECK_EQ(store(&idx, 2, SECTORS(4), 1, NULL), 0);
+    CHECK_EQ(store(&idx, 3, SECTORS(4), 2, NULL), 0);
+    CHECK_EQ(store(&idx, 4, SECTORS(5), 3, &offset), 1);
+    CHECK_EQ(offset, SECTORS(8));
+    CHECK(!stored(&idx, 3));
+    CHECK_EQ(idx.head, SECTORS(13));
+    CHECK_EQ(store(&idx, 5, SECTORS(3), 4, &offset), 0);    // The rest of the area
+    CHECK_EQ(offset, SECTORS(13));
+    CHECK_EQ(idx.head, 0);
+    CHECK_INDEX(&idx);
+}
+
+static void test_sizes(void) {
+    playlist_index_t idx;
+    uint32_t offset, erase_len;
+    area_reset(&idx, 8);
+    idx.frames = 8;
+
+    CHECK_EQ(playlist_index_place(&idx, 0, &offset, &erase_len), -1);
+    CHECK_EQ(playlist_index_place(&idx, SECTORS(8) + 1, &offset, &erase_len), -1);
+
+    for (uint32_t k = 1; k <= 4; k++) {
+        CHECK_EQ(store(&idx, k, SECTORS(2), k - 1, NULL), 0);
+    }
+    CHECK_EQ(playlist_index_place(&idx, SECTORS(8) + 1, &offset, &erase_len), -1);
+    CHECK_EQ(idx.count, 4);                                 // Nothing evicted
+
+    // A frame as large as the area replaces all of them
+    CHECK_EQ(store(&idx, 5, SECTORS(8), 0, &offset), 4);
+    CHECK_EQ(offset, 0);
+    CHECK_EQ(idx.count, 1);
+    CHECK_EQ(idx.head, 0);
+
+    // The same key again replaces the stored frame
+    CHECK_EQ(store(&idx, 6, 10, 1, NULL), 1);
+    CHECK_EQ(store(&idx, 6, 20, 1, &offset), 0);
+    CHECK_EQ(idx.count, 1);
+    CHECK_EQ(idx.entry[0].size, 20);
+    CHECK_EQ(offset, SECTORS(1));
+    CHECK_STR(idx.entry[0].etag, "\"6\"");
+    uint32_t bytes;
+    CHECK_EQ(playlist_index_listed(&idx, &bytes), 1);
+    CHECK_EQ(bytes, 20);
+    CHECK_INDEX(&idx);
+}
+
+// More frames than index entries: one is dropped although there is room
+static void test_full_index(void) {
+    playlist_index_t idx;
+    uint32_t offset;
+    area_reset(&idx, 64);
+    idx.frames = PLAYLIST_MAX_ENTRIES;
+
+    for (uint32_t k = 0; k < PLAYLIST_MAX_ENTRIES; k++) {
+        CHECK_EQ(store(&idx, 100 + k, 1000, (uint8_t)k, NULL), 0);
+    }
+    CHECK_EQ(idx.count, PLAYLIST_MAX_ENTRIES);
+
+    // All listed: the oldest
+    CHECK_EQ(store(&idx, 200, 1000, 0, &offset), 1);
+    CHECK_EQ(offset, SECTORS(PLAYLIST_MAX_ENTRIES));
+    CHECK(!stored(&idx, 100));
+    CHECK_EQ(idx.count, PLAYLIST_MAX_ENTRIES);
+
+    // The oldest unlisted one before any listed one
+    relist(&idx, 105, PLAYLIST_UNLISTED);
+    relist(&idx, 110, PLAYLIST_UNLISTED);
+    CHECK_EQ(store(&idx, 201, 1000, 5, NULL), 1);
+    CHECK(!stored(&idx, 105) && stored(&idx, 101) && stored(&idx, 110));
+    CHECK_EQ(store(&idx, 202, 1000, 10, NULL), 1);
+    CHECK(!stored(&idx, 110) && stored(&idx, 101));
+    CHECK_EQ(idx.count, PLAYLIST_MAX_ENTRIES);
+    CHECK_INDEX(&idx);
+}
+
+static void test_next(void) {
+    playlist_index_t idx;
+    uint8_t cursor = 0;
+    area_reset(&idx, 16);
+
+    CHECK_EQ(playlist_index_next(&idx, &cursor), -1);       // Empty
+
+    // Positions 1 and 4 of 5 are missing (e.g. failed downloads)
+    idx.frames = 5;
+    store(&idx, 10, 100, 3, NULL);
+    store(&idx, 11, 100, 0, NULL);
+    store(&idx, 12, 100, 2, NULL);
+    store(&idx, 13, 100, PLAYLIST_UNLISTED, NULL);
+
+    static const uint8_t order[] = { 0, 2, 3, 0, 2 };
+    for (size_t n = 0; n < sizeof(order); n++) {
+        int e = playlist_index_next(&idx, &cursor);
+        CHECK(e >= 0);
+        if (e >= 0) {
+            CHECK_EQ(idx.entry[e].position, order[n]);
+            CHECK_EQ(cursor, (order[n] + 1) % 5);
+        }
+    }
+
+    // A cursor from a longer playlist wraps
+    cursor = 7;
+    int e = playlist_index_next(&idx, &cursor);
+    CHECK(e >= 0 && idx.entry[e].position == 2);
+    CHECK_EQ(cursor, 3);
+
+    // After the last position, the first
+    cursor = 4;
+    e = playlist_index_next(&idx, &cursor);
+    CHECK(e >= 0 && idx.entry[e].position == 0);
+    CHECK_EQ(cursor, 1);
+
+    // Showing the last position wraps the cursor
+    idx.frames = 4;
+    cursor = 3;
+    e = playlist_index_next(&idx, &cursor);
+    CHECK(e >= 0 && idx.entry[e].position == 3);
+    CHECK_EQ(cursor, 0);
+    idx.frames = 5;
+
+    uint32_t bytes;
+    CHECK_EQ(playlist_index_listed(&idx, &bytes), 3);
+    CHECK_EQ(bytes, 300);
+
+    // Unlisted: nothing to show, the frames stay stored
+    playlist_index_unlist(&idx);
+    cursor = 2;
+    CHECK_EQ(playlist_index_next(&idx, &cursor), -1);
+    CHECK_EQ(cursor, 2);
+    CHECK_EQ(idx.count, 4);
+    CHECK_EQ(playlist_index_listed(&idx, &bytes), 0);
+    CHECK_EQ(bytes, 0);
+    idx.frames = 5;
+    CHECK_EQ(playlist_index_next(&idx, &cursor), -1);
+    CHECK_INDEX(&idx);
+}
+
+static uint32_t rnd_state = 7;
+
+static uint32_t rnd(uint32_t n) {
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return (rnd_state >> 8) % n;
+}
+
+// Manifest changes and downloads of random sizes: the index must stay
+// consistent with the area through wraps, replacements and evictions
+static void test_random(void) {
+    playlist_index_t idx;
+    area_reset(&idx, 24);
+
+    for (int sync = 0; sync < 400; sync++) {
+        playlist_index_unlist(&idx);
+        uint8_t frames = (uint8_t)(1 + rnd(12));
+        for (uint8_t pos = 0; pos < frames; pos++) {
+            uint32_t key = 1 + rnd(60);
+            int e = playlist_index_find(&idx, key);
+            if (e >= 0 && idx.entry[e].position != PLAYLIST_UNLISTED) {
+                continue;                                   // Listed twice
+            }
+            if (e >= 0 && rnd(3) != 0) {
+                idx.entry[e].position = pos;                // Unchanged
+                continue;
+            }
+            CHECK(store(&idx, key, 1 + rnd(SECTORS(5)), pos, NULL) >= 0);
+        }
+        idx.frames = frames;
+        CHECK_INDEX(&idx);
+        if (test_failures != 0) {
+            fprintf(stderr, "random sync %d\n", sync);
+            return;
+        }
+    }
+}
+
+int main(void) {
+    test_ring();
+    test_scoring();
+    test_sizes();
+    test_full_index();
+    test_next();
+    test_random();
+    free(area);
+    return TEST_RESULT();
+}
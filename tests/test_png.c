@@ -0,0 +1,97 @@
+/**
+ * @file test_png.c
+ * @brief PNG decoding (pngle) and a PNG output buffer for the host tests
+ */
+
+#include "test_png.h"
+#include "pngle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void on_init(pngle_t *pngle, uint32_t w, uint32_t h) {
+    test_image_t *img = pngle_get_user_data(pngle);
+    img->width = w;
+    img->height = h;
+    img->rgb = calloc((size_t)w * h, 3);
+}
+
+static void on_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                    const uint8_t rgba[4]) {
+    test_image_t *img = pngle_get_user_data(pngle);
+    if (img->rgb == NULL) {
+        return;
+    }
+    for (uint32_t j = y; j < y + h && j < img->height; j++) {
+        for (uint32_t i = x; i < x + w && i < img->width; i++) {
+            memcpy(img->rgb + ((size_t)j * img->width + i) * 3, rgba, 3);
+        }
+    }
+}
+
+bool test_png_decode(const uint8_t *png, size_t len, test_image_t *out) {
+    memset(out, 0, sizeof(*out));
+    pngle_t *pngle = pngle_new();
+    pngle_set_user_data(pngle, out);
+    pngle_set_init_callback(pngle, on_init);
+    pngle_set_draw_callback(pngle, on_draw);
+
+    int fed = pngle_feed(pngle, png, len);
+    bool ok = fed == (int)len && out->rgb != NULL;
+    if (!ok) {
+        fprintf(stderr, "PNG decode failed: %s\n", fed < 0 ? pngle_error(pngle) : "truncated");
+        test_image_free(out);
+    }
+    pngle_destroy(pngle);
+    return ok;
+}
+
+uint8_t *test_read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(size > 0 ? (size_t)size : 1);
+    if (data != NULL && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return data;
+}
+
+bool test_png_load(const char *path, test_image_t *out) {
+    size_t len;
+    uint8_t *png = test_read_file(path, &len);
+    if (png == NULL) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    bool ok = test_png_decode(png, len, out);
+    free(png);
+    return ok;
+}
+
+void test_image_free(test_image_t *img) {
+    free(img->rgb);
+    img->rgb = NULL;
+}
+
+bool test_buf_write(const uint8_t *data, size_t len, void *ctx) {
+    test_buf_t *b = ctx;
+    if (++b->writes == b->fail_at) {
+        return false;
+    }
+    if (b->len + len > b->cap) {
+        b->cap = (b->len + len) * 2;
+        b->data = realloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return true;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file test_png.h
+ * @brief PNG decoding (pngle) and a PNG output buffer for the host tests
+ */
+
+#ifndef TEST_PNG_H
+#define TEST_PNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/** Decoded image, 3 bytes (RGB) per pixel */
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint8_t *rgb;
+} test_image_t;
+
+/**
+ * @brief Decode a PNG held in memory
+ * @return false if pngle rejects it (message on stderr)
+ */
+bool test_png_decode(const uint8_t *png, size_t len, test_image_t *out);
+
+/**
+ * @brief Decode a PNG file
+ */
+bool test_png_load(const char *path, test_image_t *out);
+
+/**
+ * @brief Read a whole file
+ * @param len Receives the length
+ * @return malloc'd data, NULL if the file cannot be read
+ */
+uint8_t *test_read_file(const char *path, size_t *len);
+
+void test_image_free(test_image_t *img);
+
+/** Growing byte buffer, e.g. for an encoded PNG */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int writes;     /**< Calls of test_buf_write() */
+    int fail_at;    /**< Write number that fails (0 = none) */
+} test_buf_t;
+
+/**
+ * @brief Append to a test_buf_t (ctx); png_stream_write_t for the encoder
+ * @return false for write number fail_at (nothing appended)
+ */
+bool test_buf_write(const uint8_t *data, size_t len, void *ctx);
+
+#endif // TEST_PNG_H
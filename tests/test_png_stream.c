@@ -0,0 +1,233 @@
+/**
+ * @file test_png_stream.c
+ * @brief Row-by-row PNG encoder: chunk structure, CRCs and an inflate round trip
+ *
+ * A full 800x480 4-bit frame is encoded and the output taken apart without
+ * a PNG decoder: every chunk CRC is recomputed, the chunk order and sizes
+ * are checked, and the concatenated IDAT data is inflated back to the
+ * unfiltered rows, which must be the frame. Each write is one whole chunk.
+ * Parameter checks, row counting and a failing write callback follow.
+ */
+
+#include "png_stream.h"
+#include "epd_panel.h"
+#include "esp_rom_crc.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_WIDTH  800
+#define FRAME_HEIGHT 480
+#define FRAME_ROW    (FRAME_WIDTH / 2)
+
+static uint32_t get_be32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t rnd_state = 2463534242u;
+
+static uint32_t rnd(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+// Panel colors as PNG palette entries
+static void panel_palette(uint8_t rgb[EPD_PANEL_PALETTE_SIZE][3]) {
+    static const uint8_t pal[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        memcpy(rgb[i], pal[i], 3);
+    }
+}
+
+// Packed frame: color bars on top, dither-like noise below, so that the
+// data spans many IDAT chunks
+static uint8_t *make_frame(void) {
+    uint8_t *frame = malloc((size_t)FRAME_ROW * FRAME_HEIGHT);
+    for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
+        uint8_t *row = frame + (size_t)y * FRAME_ROW;
+        for (uint32_t x = 0; x < FRAME_WIDTH; x += 2) {
+            uint8_t hi, lo;
+            if (y < FRAME_HEIGHT / 3) {
+                hi = lo = (uint8_t)(x * EPD_PANEL_PALETTE_SIZE / FRAME_WIDTH);
+            } else {
+                hi = (uint8_t)(rnd() % EPD_PANEL_PALETTE_SIZE);
+                lo = (uint8_t)(rnd() % EPD_PANEL_PALETTE_SIZE);
+            }
+            row[x / 2] = (uint8_t)(hi << 4 | lo);
+        }
+    }
+    return frame;
+}
+
+static bool encode(const uint8_t *frame, test_buf_t *out) {
+    uint8_t rgb[EPD_PANEL_PALETTE_SIZE][3];
+    panel_palette(rgb);
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    bool ok = png_stream_begin(ps, comp, FRAME_WIDTH, FRAME_HEIGHT, 4,
+                               (const uint8_t (*)[3])rgb, EPD_PANEL_PALETTE_SIZE, test_buf_write, out);
+    for (uint32_t y = 0; ok && y < FRAME_HEIGHT; y++) {
+        ok = png_stream_row(ps, frame + (size_t)y * FRAME_ROW);
+    }
+    ok = ok && png_stream_end(ps);
+    free(ps);
+    free(comp);
+    return ok;
+}
+
+static void test_round_trip(void) {
+    uint8_t *frame = make_frame();
+    test_buf_t png = {0};
+    CHECK(encode(frame, &png));
+
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    CHECK(png.len > sizeof(sig) && memcmp(png.data, sig, sizeof(sig)) == 0);
+
+    // Take the chunks apart, collecting the IDAT data
+    uint8_t *z = malloc(png.len);
+    size_t zlen = 0;
+    int chunks = 0, idats = 0;
+    size_t last_idat = 0;
+    bool iend = false;
+    size_t pos = sizeof(sig);
+    while (pos + 12 <= png.len && !iend) {
+        const uint8_t *p = png.data + pos;
+        uint32_t len = get_be32(p);
+        if (len > png.len - pos - 12) {
+            fprintf(stderr, "chunk %d at %zu: length %u past the end\n", chunks, pos, len);
+            test_failures++;
+            break;
+        }
+        uint32_t crc = esp_rom_crc32_le(0, p + 4, len + 4);
+        if (crc != get_be32(p + 8 + len)) {
+            fprintf(stderr, "chunk %d (%.4s) at %zu: CRC mismatch\n", chunks, (const char *)p + 4, pos);
+            test_failures++;
+        }
+
+        if (chunks == 0) {
+            CHECK(memcmp(p + 4, "IHDR", 4) == 0);
+            CHECK_EQ(len, 13);
+            CHECK_EQ(get_be32(p + 8), FRAME_WIDTH);
+            CHECK_EQ(get_be32(p + 12), FRAME_HEIGHT);
+            static const uint8_t fmt[5] = { 4, 3, 0, 0, 0 };  // 4-bit palette, no interlace
+            CHECK(memcmp(p + 16, fmt, 5) == 0);
+        } else if (chunks == 1) {
+            uint8_t rgb[EPD_PANEL_PALETTE_SIZE][3];
+            panel_palette(rgb);
+            CHECK(memcmp(p + 4, "PLTE", 4) == 0);
+            CHECK_EQ(len, sizeof(rgb));
+            CHECK(memcmp(p + 8, rgb, sizeof(rgb)) == 0);
+        } else if (memcmp(p + 4, "IDAT", 4) == 0) {
+            // Full chunks except for the last one
+            CHECK(idats == 0 || last_idat == PNG_STREAM_IDAT_SIZE);
+            CHECK(len > 0 && len <= PNG_STREAM_IDAT_SIZE);
+            memcpy(z + zlen, p + 8, len);
+            zlen += len;
+            last_idat = len;
+            idats++;
+        } else {
+            CHECK(memcmp(p + 4, "IEND", 4) == 0);
+            CHECK_EQ(len, 0);
+            CHECK(idats > 0);
+            iend = true;
+        }
+        pos += 12 + len;
+        chunks++;
+    }
+    CHECK(iend);
+    CHECK_EQ(pos, png.len);
+    CHECK_EQ(png.writes, 1 + chunks);   // Signature, then one write per chunk
+    CHECK(idats > 10);
+    printf("%zu bytes, %d IDAT chunks\n", png.len, idats);
+
+    // Inflate: each row is a filter byte (none) and the packed pixels
+    size_t raw_len;
+    uint8_t *raw = tinfl_decompress_mem_to_heap(z, zlen, &raw_len, TINFL_FLAG_PARSE_ZLIB_HEADER);
+    CHECK(raw != NULL);
+    CHECK_EQ(raw_len, (size_t)FRAME_HEIGHT * (1 + FRAME_ROW));
+    if (raw != NULL && raw_len == (size_t)FRAME_HEIGHT * (1 + FRAME_ROW)) {
+        int bad_rows = 0;
+        for (uint32_t y = 0; y < FRAME_HEIGHT; y++) {
+            const uint8_t *row = raw + (size_t)y * (1 + FRAME_ROW);
+            if (row[0] != 0 || memcmp(row + 1, frame + (size_t)y * FRAME_ROW, FRAME_ROW) != 0) {
+                if (bad_rows++ == 0) {
+                    fprintf(stderr, "row %u differs after inflating\n", y);
+                }
+            }
+        }
+        CHECK_EQ(bad_rows, 0);
+    }
+
+    // The zlib trailer holds the Adler-32 of the rows
+    if (raw != NULL && zlen >= 6) {
+        CHECK_EQ(get_be32(z + zlen - 4), (uint32_t)mz_adler32(MZ_ADLER32_INIT, raw, raw_len));
+    }
+    mz_free(raw);
+
+    free(z);
+    free(png.data);
+    free(frame);
+}
+
+static void test_params(void) {
+    uint8_t rgb[EPD_PANEL_PALETTE_SIZE][3];
+    panel_palette(rgb);
+    const uint8_t (*pal)[3] = (const uint8_t (*)[3])rgb;
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    test_buf_t out = {0};
+
+    CHECK(!png_stream_begin(ps, NULL, 8, 8, 4, pal, 7, test_buf_write, &out));
+    CHECK(!png_stream_begin(ps, comp, 8, 8, 4, pal, 7, NULL, &out));
+    CHECK(!png_stream_begin(ps, comp, 0, 8, 4, pal, 7, test_buf_write, &out));
+    CHECK(!png_stream_begin(ps, comp, 8, 0, 4, pal, 7, test_buf_write, &out));
+    CHECK(!png_stream_begin(ps, comp, 8, 8, 3, pal, 7, test_buf_write, &out));
+    CHECK(!png_stream_begin(ps, comp, 8, 8, 4, pal, 0, test_buf_write, &out));
+    CHECK(!png_stream_begin(ps, comp, 8, 8, 2, pal, 5, test_buf_write, &out));
+    CHECK_EQ(out.writes, 0);
+    CHECK(!png_stream_row(ps, rgb[0]));
+    CHECK(!png_stream_end(ps));
+
+    // Too many rows, too few rows
+    static const uint8_t row[4] = {0};
+    CHECK(png_stream_begin(ps, comp, 8, 2, 4, pal, 7, test_buf_write, &out));
+    CHECK(png_stream_row(ps, row));
+    CHECK(png_stream_row(ps, row));
+    CHECK(!png_stream_row(ps, row));
+    CHECK(!png_stream_end(ps));
+
+    CHECK(png_stream_begin(ps, comp, 8, 2, 4, pal, 7, test_buf_write, &out));
+    CHECK(png_stream_row(ps, row));
+    CHECK(!png_stream_end(ps));
+
+    // A failing write aborts the encode wherever it happens
+    uint8_t *frame = make_frame();
+    for (int fail_at = 1; ; fail_at++) {
+        test_buf_t b = { .fail_at = fail_at };
+        bool ok = encode(frame, &b);
+        free(b.data);
+        if (b.writes < fail_at) {
+            CHECK(ok);      // Past the last write
+            break;
+        }
+        if (ok) {
+            fprintf(stderr, "write %d failed but the encode succeeded\n", fail_at);
+            test_failures++;
+        }
+        CHECK_EQ(b.writes, fail_at);    // Nothing written after the failure
+    }
+    free(frame);
+
+    free(out.data);
+    free(ps);
+    free(comp);
+}
+
+int main(void) {
+    test_round_trip();
+    test_params();
+    return TEST_RESULT();
+}
@@ -0,0 +1,474 @@
+/**
+ * @file test_schedule.c
+ * @brief Compiled schedule against the period rules it replaces
+ *
+ * Each schedule is kept as a list of periods and compiled from the JSON
+ * generated for it. A reference evaluator applies the period rules directly
+ * (first match wins, start == end is all day, start > end wraps midnight)
+ * and is compared with the compiled table at every minute of the week, for
+ * a hand-written schedule and for random ones. The next wake is checked the
+ * same way against a minute-by-minute walk, and the wake aligned to the
+ * interval grid against a walk over the grid points.
+ */
+
+#include "schedule.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DAY_MIN     1440
+#define NO_PLAN     -1
+
+typedef struct {
+    uint16_t start;
+    uint16_t end;       // 1440 = "24:00"
+    uint16_t interval;
+} ref_period_t;
+
+typedef struct {
+    int count;
+    ref_period_t p[MAX_PERIODS_PER_PLAN];
+} ref_plan_t;
+
+typedef struct {
+    int plan_count;
+    ref_plan_t plans[MAX_SCHEDULE_PLANS];
+    int day_plan[SCHEDULE_DAYS];        // NO_PLAN = default interval
+} ref_schedule_t;
+
+static const char *const day_names[SCHEDULE_DAYS] = {
+    "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"
+};
+
+#define HM(h, m) ((h) * 60 + (m))
+
+// Mon, Sat: overlapping periods and a wrap; Tue: all day shadows the
+// rest; Wed, Sun: periods around midnight and a single minute; Thu: a
+// wrap overlapping a later period, and gaps; Fri: no plan
+static const ref_schedule_t sample = {
+    .plan_count = 4,
+    .plans = {
+        { 4, { { HM(7, 0), HM(9, 0), 5 }, { HM(9, 0), HM(17, 0), 30 },
+               { HM(6, 0), HM(22, 0), 15 }, { HM(22, 0), HM(6, 0), 120 } } },
+        { 2, { { HM(12, 0), HM(12, 0), 10 }, { HM(8, 0), HM(9, 0), 1 } } },
+        { 3, { { HM(23, 30), HM(24, 0), 2 }, { HM(0, 0), HM(0, 30), 3 },
+               { HM(10, 0), HM(10, 1), 1440 } } },
+        { 3, { { HM(20, 0), HM(4, 0), 45 }, { HM(3, 0), HM(5, 0), 60 },
+               { HM(12, 15), HM(12, 45), 20 } } },
+    },
+    .day_plan = { 0, 1, 2, 3, NO_PLAN, 0, 2 },
+};
+
+static bool ref_contains(const ref_period_t *p, uint32_t minute) {
+    if (p->start == p->end) {
+        return true;
+    }
+    if (p->start < p->end) {
+        return minute >= p->start && minute < p->end;
+    }
+    return minute >= p->start || minute < p->end;
+}
+
+static uint32_t ref_interval_at(const ref_schedule_t *s, int day, uint32_t minute) {
+    if (s->day_plan[day] == NO_PLAN) {
+        return 0;
+    }
+    const ref_plan_t *plan = &s->plans[s->day_plan[day]];
+    for (int i = 0; i < plan->count; i++) {
+        if (ref_contains(&plan->p[i], minute)) {
+            return plan->p[i].interval;
+        }
+    }
+    return 0;
+}
+
+static uint32_t ref_effective(const ref_schedule_t *s, int day, uint32_t minute, uint32_t default_min) {
+    uint32_t interval = ref_interval_at(s, day, minute);
+    return interval ? interval : default_min;
+}
+
+// Step minute by minute until the interval changes or the sleep is over
+static uint32_t ref_next_wake_s(const ref_schedule_t *s, int day, uint32_t second, uint32_t default_min) {
+    uint32_t current = ref_effective(s, day, second / 60, default_min);
+    uint32_t sleep_s = current * 60;
+    uint32_t minute = second / 60;
+
+    for (uint32_t elapsed = 60 - second % 60; elapsed < sleep_s; elapsed += 60) {
+        if (++minute == DAY_MIN) {
+            minute = 0;
+            day = (day + 1) % SCHEDULE_DAYS;
+        }
+        if (ref_effective(s, day, minute, default_min) != current) {
+            if (elapsed < SCHEDULE_MIN_SLEEP_S) {
+                return elapsed + ref_next_wake_s(s, day, minute * 60, default_min);
+            }
+            return elapsed;
+        }
+    }
+    return sleep_s;
+}
+
+static void put_time(char *out, size_t len, uint16_t minute) {
+    snprintf(out, len, "%02u:%02u", minute / 60, minute % 60);
+}
+
+// Schedule JSON as the web UI saves it
+static void to_json(const ref_schedule_t *s, char *out, size_t len) {
+    size_t n = snprintf(out, len, "{\"plans\":[");
+    for (int p = 0; p < s->plan_count; p++) {
+        n += snprintf(out + n, len - n, "%s{\"name\":\"plan%d\",\"periods\":[", p ? "," : "", p);
+        for (int i = 0; i < s->plans[p].count; i++) {
+            const ref_period_t *rp = &s->plans[p].p[i];
+            char start[8], end[8];
+            put_time(start, sizeof(start), rp->start);
+            put_time(end, sizeof(end), rp->end);
+            n += snprintf(out + n, len - n, "%s{\"start\":\"%s\",\"end\":\"%s\",\"interval\":%u}",
+                          i ? "," : "", start, end, rp->interval);
+        }
+        n += snprintf(out + n, len - n, "]}");
+    }
+    n += snprintf(out + n, len - n, "],\"days\":{");
+    bool first = true;
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        if (s->day_plan[d] != NO_PLAN) {
+            n += snprintf(out + n, len - n, "%s\"%s\":\"plan%d\"", first ? "" : ",",
+                          day_names[d], s->day_plan[d]);
+            first = false;
+        }
+    }
+    snprintf(out + n, len - n, "}}");
+}
+
+static bool compile(const ref_schedule_t *s, schedule_table_t *t) {
+    char json[4096];
+    char err[96] = "";
+    to_json(s, json, sizeof(json));
+    if (!schedule_compile(json, t, err, sizeof(err))) {
+        test_failures++;
+        fprintf(stderr, "schedule rejected (%s): %s\n", err, json);
+        return false;
+    }
+    return true;
+}
+
+// Every minute of the week; returns the number of mismatches
+static int compare_week(const ref_schedule_t *s, const schedule_table_t *t) {
+    int bad = 0;
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        for (uint32_t m = 0; m < DAY_MIN; m++) {
+            uint32_t want = ref_interval_at(s, d, m);
+            uint32_t got = schedule_interval_at(t, d, m);
+            if (got != want && bad++ < 5) {
+                fprintf(stderr, "%s %02u:%02u: interval %u, expected %u\n",
+                        day_names[d], m / 60, m % 60, got, want);
+            }
+        }
+    }
+    return bad;
+}
+
+static int compare_wake(const ref_schedule_t *s, const schedule_table_t *t, int day,
+                        uint32_t second, uint32_t default_min) {
+    uint32_t want = ref_next_wake_s(s, day, second, default_min);
+    uint32_t got = schedule_next_wake_s(t, day, second, default_min);
+    if (got != want) {
+        fprintf(stderr, "%s %05u s (default %u): wake after %u s, expected %u\n",
+                day_names[day], second, default_min, got, want);
+        return 1;
+    }
+    return 0;
+}
+
+static void test_sample(void) {
+    schedule_table_t t;
+    if (!compile(&sample, &t)) {
+        return;
+    }
+    CHECK_EQ(compare_week(&sample, &t), 0);
+
+    // Spot checks of the rules themselves
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(6, 59)), 15);
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(7, 0)), 5);      // First match wins
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(9, 0)), 30);
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(17, 0)), 15);
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(22, 0)), 120);
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(0, 0)), 120);    // Wrap
+    CHECK_EQ(schedule_interval_at(&t, 0, HM(5, 59)), 120);
+    CHECK_EQ(schedule_interval_at(&t, 1, HM(8, 30)), 10);    // All day first
+    CHECK_EQ(schedule_interval_at(&t, 2, HM(23, 29)), 0);
+    CHECK_EQ(schedule_interval_at(&t, 2, HM(23, 59)), 2);    // Up to 24:00
+    CHECK_EQ(schedule_interval_at(&t, 2, HM(0, 29)), 3);
+    CHECK_EQ(schedule_interval_at(&t, 2, HM(10, 0)), 1440);
+    CHECK_EQ(schedule_interval_at(&t, 2, HM(10, 1)), 0);
+    CHECK_EQ(schedule_interval_at(&t, 3, HM(3, 30)), 45);    // Wrap before the later period
+    CHECK_EQ(schedule_interval_at(&t, 3, HM(4, 0)), 60);
+    CHECK_EQ(schedule_interval_at(&t, 3, HM(5, 0)), 0);
+    CHECK_EQ(schedule_interval_at(&t, 4, HM(12, 0)), 0);     // No plan
+
+    // Each wake of the week, at whole minutes and just before the next
+    int bad = 0;
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        for (uint32_t m = 0; m < DAY_MIN; m++) {
+            bad += compare_wake(&sample, &t, d, m * 60, 60);
+            bad += compare_wake(&sample, &t, d, m * 60 + 30, 60);
+            bad += compare_wake(&sample, &t, d, m * 60 + 59, 15);
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static void test_next_wake(void) {
+    schedule_table_t t;
+    if (!compile(&sample, &t)) {
+        return;
+    }
+
+    // Within a period: the interval
+    CHECK_EQ(schedule_next_wake_s(&t, 2, HM(23, 50) * 60, 60), 120);
+    CHECK_EQ(schedule_next_wake_s(&t, 0, HM(12, 0) * 60, 60), 30 * 60);
+
+    // Up to the next period, across midnight into the next day's plan
+    CHECK_EQ(schedule_next_wake_s(&t, 2, HM(23, 59) * 60, 60), 60);          // Wed 2 -> Thu 45
+    CHECK_EQ(schedule_next_wake_s(&t, 4, HM(23, 30) * 60, 60), 1800);        // Fri default -> Sat 120
+    CHECK_EQ(schedule_next_wake_s(&t, 6, HM(23, 0) * 60, 60), 1800);         // Sun default -> 2
+    CHECK_EQ(schedule_next_wake_s(&t, 6, HM(23, 59) * 60, 60), 60);          // Sun 2 -> Mon 120
+    CHECK_EQ(schedule_next_wake_s(&t, 2, HM(10, 0) * 60, 60), 60);           // 1440 for a minute
+
+    // A boundary under a minute away is folded into the next sleep
+    CHECK_EQ(schedule_next_wake_s(&t, 0, HM(6, 59) * 60 + 30, 60), 30 + 300);
+    CHECK_EQ(schedule_next_wake_s(&t, 2, HM(23, 59) * 60 + 30, 60), 30 + 2700);
+    CHECK_EQ(schedule_next_wake_s(&t, 2, HM(10, 0) * 60 + 10, 60), 50 + 3600);
+
+    // A period with the default interval is no boundary
+    CHECK_EQ(schedule_next_wake_s(&t, 3, HM(4, 30) * 60, 60), 3600);
+    CHECK_EQ(schedule_next_wake_s(&t, 3, HM(4, 30) * 60, 30), 1800);
+
+    // No plans: the default interval all week
+    CHECK(schedule_compile("", &t, NULL, 0));
+    CHECK_EQ(t.valid, 1);
+    CHECK_EQ(schedule_interval_at(&t, 3, 600), 0);
+    CHECK_EQ(schedule_next_wake_s(&t, 6, HM(23, 50) * 60, 60), 3600);
+
+    // A table that was never compiled
+    memset(&t, 0, sizeof(t));
+    CHECK_EQ(schedule_interval_at(&t, 0, 0), 0);
+    CHECK_EQ(schedule_next_wake_s(&t, 0, 0, 20), 1200);
+}
+
+// Aligned wake by walking the grid points from midnight of the current day
+static uint32_t ref_align(uint32_t second, uint32_t interval_min, uint32_t lead_s,
+                          uint32_t limit_s) {
+    uint32_t interval_s = (interval_min > 0 ? interval_min : 1) * 60;
+    uint32_t g = 0;
+    while (g < second + lead_s + SCHEDULE_MIN_SLEEP_S) {
+        uint32_t next = g + interval_s;
+        uint32_t midnight = (g / 86400 + 1) * 86400;
+        g = next < midnight ? next : midnight;
+    }
+    if (g - second > limit_s) {
+        return limit_s >= lead_s + SCHEDULE_MIN_SLEEP_S ? limit_s - lead_s : limit_s;
+    }
+    return g - second - lead_s;
+}
+
+static void test_align(void) {
+    const uint32_t none = UINT32_MAX;
+
+    // Next grid point; one under a minute away is folded into the next slot
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 0, none), 480);
+    CHECK_EQ(schedule_align_s(HM(10, 13) * 60 + 59, 15, 0, none), 61);
+    CHECK_EQ(schedule_align_s(HM(10, 14) * 60, 15, 0, none), 60);
+    CHECK_EQ(schedule_align_s(HM(10, 14) * 60 + 1, 15, 0, none), 959);
+    CHECK_EQ(schedule_align_s(HM(10, 15) * 60, 15, 0, none), 900);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60 + 30, 1, 0, none), 90);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60 + 30, 0, 0, none), 90);   // 0 is every minute
+
+    // The lead is taken off the sleep and counts towards the minimum
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 20, none), 460);
+    CHECK_EQ(schedule_align_s(HM(10, 13) * 60 + 40, 15, 20, none), 60);
+    CHECK_EQ(schedule_align_s(HM(10, 13) * 60 + 50, 15, 20, none), 950);
+    CHECK_EQ(schedule_align_s(HM(10, 0) * 60, 15, 900, none), 900);
+
+    // The grid restarts at midnight, cutting the last slot of the day short
+    CHECK_EQ(schedule_align_s(HM(23, 50) * 60, 25, 0, none), 600);       // 23:45, then 24:00
+    CHECK_EQ(schedule_align_s(HM(23, 59) * 60 + 30, 25, 0, none), 1530); // Folded into 00:25
+    CHECK_EQ(schedule_align_s(HM(23, 59) * 60 + 30, 25, 20, none), 1510);
+    CHECK_EQ(schedule_align_s(HM(23, 59) * 60 + 30, 1440, 0, none), 86430);
+    CHECK_EQ(schedule_align_s(HM(12, 0) * 60, 1440, 0, none), 43200);
+    CHECK_EQ(schedule_align_s(HM(23, 0) * 60, 60, 90000, none), 3600);     // 01:00 two days on
+
+    // A limit before the grid point: wake the lead ahead of it if there is
+    // room for the minimum sleep, else at the limit
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 0, 300), 300);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 20, 300), 280);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 20, 79), 79);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 20, 80), 60);
+    CHECK_EQ(schedule_align_s(HM(10, 7) * 60, 15, 20, 480), 460);      // Grid point at the limit
+
+    // Over the end of the week: Sun 23:59 is a minute from Mon's 120 min
+    // period, which limits the 2 min grid of Sun's period
+    schedule_table_t t;
+    if (compile(&sample, &t)) {
+        uint32_t second = HM(23, 59) * 60;
+        uint32_t limit = schedule_next_wake_s(&t, 6, second, 60);
+        CHECK_EQ(limit, 60);
+        CHECK_EQ(schedule_align_s(second, schedule_interval_at(&t, 6, HM(23, 59)), 0, limit), 60);
+        CHECK_EQ(schedule_align_s(second, schedule_interval_at(&t, 6, HM(23, 59)), 10, limit), 60);
+        CHECK_EQ(schedule_align_s(HM(23, 58) * 60, schedule_interval_at(&t, 6, HM(23, 58)), 10,
+                                  schedule_next_wake_s(&t, 6, HM(23, 58) * 60, 60)), 110);
+    }
+
+    // Everything else against the grid walk
+    int bad = 0;
+    for (uint32_t n = 0; n < 20000 && bad < 5; n++) {
+        static const uint32_t intervals[] = { 0, 1, 7, 15, 25, 60, 61, 720, 1439, 1440 };
+        uint32_t second = (n * 7919u) % 86400;
+        uint32_t interval = intervals[n % (sizeof(intervals) / sizeof(intervals[0]))];
+        uint32_t lead = (n / 10) % 4 == 0 ? 0 : (n * 31u) % 300;
+        uint32_t limit = n % 3 == 0 ? none : (n * 104729u) % 90000;
+        uint32_t got = schedule_align_s(second, interval, lead, limit);
+        uint32_t want = ref_align(second, interval, lead, limit);
+        if (got != want) {
+            bad++;
+            fprintf(stderr, "align(%u, %u, %u, %u) = %u, want %u\n",
+                    second, interval, lead, limit, got, want);
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static uint32_t rnd_state = 12345;
+
+static uint32_t rnd(uint32_t n) {
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return (rnd_state >> 8) % n;
+}
+
+// Few distinct times so that periods share boundaries and overlap
+static uint16_t rnd_time(void) {
+    static const uint16_t common[] = { 0, HM(0, 1), HM(6, 0), HM(12, 0), HM(12, 1), HM(22, 0), HM(23, 59) };
+    return rnd(3) ? common[rnd(sizeof(common) / sizeof(common[0]))] : (uint16_t)rnd(DAY_MIN);
+}
+
+static void random_schedule(ref_schedule_t *s) {
+    static const uint16_t intervals[] = { 1, 2, 5, 15, 30, 59, 60, 61, 120, 720, 1440 };
+    memset(s, 0, sizeof(*s));
+    s->plan_count = 1 + rnd(MAX_SCHEDULE_PLANS);
+    for (int p = 0; p < s->plan_count; p++) {
+        ref_plan_t *plan = &s->plans[p];
+        plan->count = rnd(MAX_PERIODS_PER_PLAN + 1);
+        for (int i = 0; i < plan->count; i++) {
+            ref_period_t *rp = &plan->p[i];
+            rp->start = rnd_time();
+            switch (rnd(5)) {
+            case 0:  rp->end = rp->start; break;
+            case 1:  rp->end = DAY_MIN; break;
+            default: rp->end = rnd_time(); break;
+            }
+            rp->interval = intervals[rnd(sizeof(intervals) / sizeof(intervals[0]))];
+        }
+    }
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        s->day_plan[d] = rnd(4) ? (int)rnd(s->plan_count) : NO_PLAN;
+    }
+}
+
+static void test_random(void) {
+    for (int n = 0; n < 300; n++) {
+        ref_schedule_t s;
+        schedule_table_t t;
+        random_schedule(&s);
+        if (!compile(&s, &t)) {
+            continue;
+        }
+        int bad = compare_week(&s, &t);
+        for (int i = 0; i < 300 && bad == 0; i++) {
+            uint32_t second = rnd(86400);
+            if (rnd(2)) {
+                second = second / 60 * 60 + 59;     // Just before a boundary
+            }
+            bad += compare_wake(&s, &t, rnd(SCHEDULE_DAYS), second, rnd(2) ? 60 : 1 + rnd(1440));
+        }
+        if (bad != 0) {
+            char json[4096];
+            to_json(&s, json, sizeof(json));
+            test_failures++;
+            fprintf(stderr, "random schedule %d differs: %s\n", n, json);
+            return;
+        }
+    }
+}
+
+// A rejected schedule leaves the table as it was
+static void check_invalid_at(int line, const char *json) {
+    schedule_table_t t, before;
+    memset(&t, 0x5A, sizeof(t));
+    before = t;
+    char err[96] = "";
+    if (schedule_compile(json, &t, err, sizeof(err))) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: schedule accepted: %s\n", __FILE__, line, json);
+        return;
+    }
+    if (err[0] == '\0' || memcmp(&t, &before, sizeof(t)) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: no message or table changed: %s\n", __FILE__, line, json);
+    }
+}
+
+#define CHECK_INVALID(json) check_invalid_at(__LINE__, json)
+
+#define PLAN(periods) "{\"plans\":[{\"name\":\"p\",\"periods\":[" periods "]}],\"days\":{\"Mon\":\"p\"}}"
+
+static void test_invalid(void) {
+    CHECK_INVALID("not json");
+    CHECK_INVALID("[]");
+    CHECK_INVALID("{\"days\":{}}");
+    CHECK_INVALID("{\"plans\":{},\"days\":{}}");
+    CHECK_INVALID("{\"plans\":[],\"days\":[]}");
+    CHECK_INVALID("{\"plans\":[{\"periods\":[]}]}");
+    CHECK_INVALID("{\"plans\":[{\"name\":\"\",\"periods\":[]}]}");
+    CHECK_INVALID("{\"plans\":[{\"name\":\"a\",\"periods\":[]},{\"name\":\"a\",\"periods\":[]}]}");
+    CHECK_INVALID("{\"plans\":[{\"name\":\"a\",\"periods\":[]},{\"name\":\"b\",\"periods\":[]},"
+                  "{\"name\":\"c\",\"periods\":[]},{\"name\":\"d\",\"periods\":[]},"
+                  "{\"name\":\"e\",\"periods\":[]}]}");
+    CHECK_INVALID("{\"plans\":[],\"days\":{\"Mon\":\"p\"}}");
+    CHECK_INVALID("{\"plans\":[{\"name\":\"p\",\"periods\":[]}],\"days\":{\"Tue\":1}}");
+
+#define P(s, e, i) "{\"start\":\"" s "\",\"end\":\"" e "\",\"interval\":" i "}"
+    CHECK_INVALID(PLAN(P("7:00", "08:00", "5")));
+    CHECK_INVALID(PLAN(P("07:00", "08:0", "5")));
+    CHECK_INVALID(PLAN(P("07:60", "08:00", "5")));
+    CHECK_INVALID(PLAN(P("24:00", "08:00", "5")));      // 24:00 only as the end
+    CHECK_INVALID(PLAN(P("07:00", "24:01", "5")));
+    CHECK_INVALID(PLAN(P("07:00", "25:00", "5")));
+    CHECK_INVALID(PLAN(P("07:00", "08:00", "0")));
+    CHECK_INVALID(PLAN(P("07:00", "08:00", "1441")));
+    CHECK_INVALID(PLAN(P("07:00", "08:00", "1.5")));
+    CHECK_INVALID(PLAN(P("07:00", "08:00", "\"5\"")));
+    CHECK_INVALID(PLAN("{\"start\":\"07:00\",\"interval\":5}"));
+    CHECK_INVALID(PLAN(P("00:00", "01:00", "1") "," P("01:00", "02:00", "1") ","
+                       P("02:00", "03:00", "1") "," P("03:00", "04:00", "1") ","
+                       P("04:00", "05:00", "1") "," P("05:00", "06:00", "1") ","
+                       P("06:00", "07:00", "1") "," P("07:00", "08:00", "1") ","
+                       P("08:00", "09:00", "1")));
+
+    // The limits themselves are accepted
+    schedule_table_t t;
+    CHECK(schedule_compile(PLAN(P("00:00", "24:00", "1440")), &t, NULL, 0));
+    CHECK_EQ(schedule_interval_at(&t, 0, 1439), 1440);
+    CHECK(schedule_compile(PLAN(P("23:59", "00:00", "1")), &t, NULL, 0));
+    CHECK_EQ(schedule_interval_at(&t, 0, 1439), 1);
+    CHECK_EQ(schedule_interval_at(&t, 0, 0), 0);
+    CHECK(schedule_compile("{\"plans\":[]}", &t, NULL, 0));   // No days: default
+#undef P
+}
+
+int main(void) {
+    test_sample();
+    test_next_wake();
+    test_align();
+    test_random();
+    test_invalid();
+    return TEST_RESULT();
+}
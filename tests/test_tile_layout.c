@@ -0,0 +1,372 @@
+/**
+ * @file test_tile_layout.c
+ * @brief Tile layout parser and the tile ETag bookkeeping
+ *
+ * The bookkeeping is run through updates the way tiles_update() composes a
+ * frame: the cached frame is the base only while it is the one the stored
+ * ETags belong to, 304 tiles keep its pixels and redrawn tiles record their
+ * new ETag. Tiles are real PNGs rendered with image_processor_render_tile().
+ */
+
+#include "tile_layout.h"
+#include "image_processor.h"
+#include "png_stream.h"
+#include "esp_rom_crc.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void check_url_at(int line, const tile_t *t, const char *url) {
+    if (t->url_len != strlen(url) || strncmp(t->url, url, t->url_len) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: url is '%.*s', expected '%s'\n", __FILE__, line,
+                (int)t->url_len, t->url, url);
+    }
+}
+
+#define CHECK_URL(t, url) check_url_at(__LINE__, t, url)
+
+static void check_tile_at(int line, const tile_t *t, int x, int y, int w, int h) {
+    if (t->x != x || t->y != y || t->w != w || t->h != h) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: tile is %u,%u,%u,%u, expected %d,%d,%d,%d\n", __FILE__, line,
+                t->x, t->y, t->w, t->h, x, y, w, h);
+    }
+}
+
+#define CHECK_TILE(t, x, y, w, h) check_tile_at(__LINE__, t, x, y, w, h)
+
+// Rejected with a message that contains the expected part
+static void check_rejected_at(int line, const char *str, const char *msg) {
+    tile_layout_t l;
+    char err[96] = "";
+    if (tile_layout_parse(str, 800, 480, &l, err, sizeof(err))) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: layout accepted\n", __FILE__, line);
+    } else if (strstr(err, msg) == NULL) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: error '%s', expected '%s'\n", __FILE__, line, err, msg);
+    }
+}
+
+#define CHECK_REJECTED(str, msg) check_rejected_at(__LINE__, str, msg)
+
+static void test_parse(void) {
+    tile_layout_t l;
+
+    CHECK(tile_layout_parse("0,0,400,240,weather.png\n400,0,400,480,https://cal.example/today.png",
+                            800, 480, &l, NULL, 0));
+    CHECK_EQ(l.count, 2);
+    CHECK_TILE(&l.tile[0], 0, 0, 400, 240);
+    CHECK_URL(&l.tile[0], "weather.png");
+    CHECK_TILE(&l.tile[1], 400, 0, 400, 480);
+    CHECK_URL(&l.tile[1], "https://cal.example/today.png");
+
+    // CRLF, blank lines, indentation and spaces around the numbers
+    CHECK(tile_layout_parse("\r\n  0, 0 ,10,20, a.png \r\n\r\n \t \n\t5,6,7,8,b,c.png\r\n\n",
+                            800, 480, &l, NULL, 0));
+    CHECK_EQ(l.count, 2);
+    CHECK_TILE(&l.tile[0], 0, 0, 10, 20);
+    CHECK_URL(&l.tile[0], "a.png");
+    CHECK_TILE(&l.tile[1], 5, 6, 7, 8);
+    CHECK_URL(&l.tile[1], "b,c.png");
+
+    // Exactly the image
+    CHECK(tile_layout_parse("0,0,800,480,full.png", 800, 480, &l, NULL, 0));
+    CHECK_TILE(&l.tile[0], 0, 0, 800, 480);
+    CHECK(tile_layout_parse("799,479,1,1,px.png", 800, 480, &l, NULL, 0));
+
+    // Bounds
+    CHECK_REJECTED("0,0,801,480,a.png", "outside");
+    CHECK_REJECTED("1,0,800,480,a.png", "outside");
+    CHECK_REJECTED("0,1,800,480,a.png", "outside");
+    CHECK_REJECTED("0,0,0,480,a.png", "outside");
+    CHECK_REJECTED("0,0,10,0,a.png", "outside");
+    CHECK_REJECTED("65535,0,10,10,a.png", "outside");
+    CHECK_REJECTED("0,0,65536,10,a.png", "expected");
+
+    // Malformed lines, numbered with the blank ones
+    CHECK_REJECTED("0,0,10,10", "line 1: expected");
+    CHECK_REJECTED("0,0,10,10,", "line 1: expected");
+    CHECK_REJECTED("0,0,10,10,  \r\n", "line 1: expected");
+    CHECK_REJECTED("0,0,10,10,a\n\r\n0,0,10,a", "line 3: expected");
+    CHECK_REJECTED("-1,0,10,10,a", "expected");
+    CHECK_REJECTED("0;0;10;10;a", "expected");
+    CHECK_REJECTED("0,0,1 0,10,a", "expected");
+
+    // Nothing but blank lines
+    CHECK_REJECTED("", "empty");
+    CHECK_REJECTED("\n\r\n  \n", "empty");
+    CHECK(!tile_layout_parse(NULL, 800, 480, &l, NULL, 0));
+    CHECK_EQ(l.count, 0);
+
+    // TILE_MAX tiles, blank lines between them not counted
+    char str[512] = "";
+    for (int i = 0; i < TILE_MAX; i++) {
+        char line[48];
+        snprintf(line, sizeof(line), "%d,0,10,10,t%d.png\n\n", i * 10, i);
+        strcat(str, line);
+    }
+    CHECK(tile_layout_parse(str, 800, 480, &l, NULL, 0));
+    CHECK_EQ(l.count, TILE_MAX);
+    CHECK_URL(&l.tile[TILE_MAX - 1], "t7.png");
+    strcat(str, "0,100,10,10,one-more.png");
+    CHECK_REJECTED(str, "More than");
+}
+
+static void test_state(void) {
+    tile_state_t stored, s;
+    uint32_t crc = 0xC0FFEE;
+
+    // Nothing stored: no base, no ETags
+    memset(&stored, 0, sizeof(stored));
+    memset(&s, 0x5A, sizeof(s));
+    CHECK(!tile_state_begin(&stored, 42, &crc, &s));
+    CHECK_EQ(s.magic, TILE_STATE_MAGIC);
+    CHECK_EQ(s.key, 42);
+    CHECK_EQ(s.frame_crc, 0);
+    for (int i = 0; i < TILE_MAX; i++) {
+        CHECK_STR(s.etag[i], "");
+    }
+
+    stored = s;
+    stored.frame_crc = crc;
+    tile_state_drawn(&stored, 0, "\"a\"");
+    tile_state_drawn(&stored, TILE_MAX - 1, "W/\"z\"");
+
+    // Same layout and the frame still in the cache: ETags carried over
+    CHECK(tile_state_begin(&stored, 42, &crc, &s));
+    CHECK_EQ(memcmp(&s, &stored, sizeof(s)), 0);
+
+    // Another layout, another cached frame, none, or no valid state
+    CHECK(!tile_state_begin(&stored, 43, &crc, &s));
+    CHECK_STR(s.etag[0], "");
+    CHECK_EQ(s.key, 43);
+    uint32_t other = crc + 1;
+    CHECK(!tile_state_begin(&stored, 42, &other, &s));
+    CHECK_STR(s.etag[0], "");
+    CHECK(!tile_state_begin(&stored, 42, NULL, &s));
+    CHECK_STR(s.etag[TILE_MAX - 1], "");
+    tile_state_t bad = stored;
+    bad.magic = 0;
+    CHECK(!tile_state_begin(&bad, 42, &crc, &s));
+    CHECK_EQ(s.magic, TILE_STATE_MAGIC);
+
+    // Responses
+    CHECK_EQ(tile_state_action(true, 200, true), TILE_DRAW);
+    CHECK_EQ(tile_state_action(true, 200, false), TILE_DRAW);
+    CHECK_EQ(tile_state_action(true, 304, true), TILE_KEEP);
+    CHECK_EQ(tile_state_action(true, 304, false), TILE_FAILED);    // Nothing to keep
+    CHECK_EQ(tile_state_action(true, 404, true), TILE_FAILED);
+    CHECK_EQ(tile_state_action(true, 206, true), TILE_FAILED);
+    CHECK_EQ(tile_state_action(false, 200, true), TILE_FAILED);
+    CHECK_EQ(tile_state_action(false, 304, true), TILE_FAILED);
+
+    // ETags that cannot be kept are recorded as none
+    tile_state_drawn(&s, 1, "\"x\"");
+    tile_state_drawn(&s, 1, NULL);
+    CHECK_STR(s.etag[1], "");
+    char long_tag[TILE_ETAG_LEN + 1];
+    memset(long_tag, 'x', TILE_ETAG_LEN);
+    long_tag[TILE_ETAG_LEN] = '\0';
+    tile_state_drawn(&s, 2, long_tag);
+    CHECK_STR(s.etag[2], "");
+    long_tag[TILE_ETAG_LEN - 1] = '\0';
+    tile_state_drawn(&s, 2, long_tag);
+    CHECK_EQ(strlen(s.etag[2]), TILE_ETAG_LEN - 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * Updates against a simulated frame cache
+ * ------------------------------------------------------------------------- */
+
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+
+// PNG of one panel color
+static void solid_png(uint32_t w, uint32_t h, uint8_t code, test_buf_t *out) {
+    uint8_t pal[EPD_PANEL_PALETTE_SIZE][3];
+    for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+        memcpy(pal[i], palette[i], 3);
+    }
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    png_stream_t *ps = malloc(sizeof(png_stream_t));
+    uint8_t *row = malloc((w + 1) / 2);
+    memset(row, (code << 4) | code, (w + 1) / 2);
+    memset(out, 0, sizeof(*out));
+    CHECK(png_stream_begin(ps, comp, w, h, 4, (const uint8_t (*)[3])pal,
+                           EPD_PANEL_PALETTE_SIZE, test_buf_write, out));
+    for (uint32_t y = 0; y < h; y++) {
+        CHECK(png_stream_row(ps, row));
+    }
+    CHECK(png_stream_end(ps));
+    free(row);
+    free(ps);
+    free(comp);
+}
+
+// A tile's response: transport success, status, ETag and content
+typedef struct {
+    bool ok;
+    int status;
+    const char *etag;
+    uint8_t color;
+} response_t;
+
+static struct {
+    uint8_t *frame;
+    uint32_t crc;
+    bool valid;
+} cache;
+
+// One update as tiles_update() composes it; sent receives the ETag each
+// tile was requested with (NULL for a plain request)
+static bool update(const tile_layout_t *l, uint32_t key, const tile_state_t *stored,
+                   const response_t *resp, uint8_t *frame, tile_state_t *out,
+                   const char *sent[TILE_MAX]) {
+    bool have_base = tile_state_begin(stored, key, cache.valid ? &cache.crc : NULL, out);
+    if (have_base) {
+        memcpy(frame, cache.frame, IMAGE_BUFFER_SIZE);
+    } else {
+        memset(frame, (EPD_PANEL_WHITE << 4) | EPD_PANEL_WHITE, IMAGE_BUFFER_SIZE);
+    }
+    for (int i = 0; i < l->count; i++) {
+        sent[i] = have_base ? stored->etag[i] : NULL;
+    }
+
+    for (int i = 0; i < l->count; i++) {
+        const tile_t *t = &l->tile[i];
+        if (tile_state_action(resp[i].ok, resp[i].status, have_base) != TILE_DRAW) {
+            continue;
+        }
+        test_buf_t png;
+        solid_png(t->w, t->h, resp[i].color, &png);
+        esp_err_t r = image_processor_render_tile(png.data, png.len, frame, t->x, t->y, t->w, t->h);
+        free(png.data);
+        CHECK_EQ(r, ESP_OK);
+        if (r == ESP_OK) {
+            tile_state_drawn(out, i, resp[i].etag);
+        }
+    }
+    return have_base;
+}
+
+// Store the composed frame in the cache and commit the state
+static void commit(const uint8_t *frame, tile_state_t *state, tile_state_t *stored) {
+    memcpy(cache.frame, frame, IMAGE_BUFFER_SIZE);
+    cache.crc = esp_rom_crc32_le(0, frame, IMAGE_BUFFER_SIZE);
+    cache.valid = true;
+    state->frame_crc = cache.crc;
+    *stored = *state;
+}
+
+// Pixels of a rectangle that are not the color
+static size_t count_other(const uint8_t *frame, const tile_t *t, uint8_t code) {
+    size_t n = 0;
+    for (uint32_t y = t->y; y < (uint32_t)t->y + t->h; y++) {
+        for (uint32_t x = t->x; x < (uint32_t)t->x + t->w; x++) {
+            uint8_t b = frame[(y * IMAGE_WIDTH + x) / 2];
+            n += ((x & 1) ? (b & 0x0F) : (b >> 4)) != code;
+        }
+    }
+    return n;
+}
+
+static void test_updates(void) {
+    const char *str = "0,0,100,60,a.png\r\n\r\n100,0,50,120,b.png\n0,60,100,60,c.png\n";
+    tile_layout_t l;
+    CHECK(tile_layout_parse(str, IMAGE_WIDTH, IMAGE_HEIGHT, &l, NULL, 0));
+    const tile_t *a = &l.tile[0], *b = &l.tile[1], *c = &l.tile[2];
+    const tile_t rest = { 150, 0, IMAGE_WIDTH - 150, IMAGE_HEIGHT };
+
+    cache.frame = malloc(IMAGE_BUFFER_SIZE);
+    uint8_t *frame = malloc(IMAGE_BUFFER_SIZE);
+    tile_state_t stored, state;
+    const char *sent[TILE_MAX];
+    memset(&stored, 0, sizeof(stored));
+
+    // First update: everything downloaded in full onto white
+    const response_t first[] = {
+        { true, 200, "\"a1\"", EPD_PANEL_RED },
+        { true, 200, "\"b1\"", EPD_PANEL_GREEN },
+        { true, 200, "\"c1\"", EPD_PANEL_BLUE },
+    };
+    CHECK(!update(&l, 7, &stored, first, frame, &state, sent));
+    CHECK(sent[0] == NULL && sent[1] == NULL && sent[2] == NULL);
+    CHECK_EQ(count_other(frame, a, EPD_PANEL_RED), 0);
+    CHECK_EQ(count_other(frame, b, EPD_PANEL_GREEN), 0);
+    CHECK_EQ(count_other(frame, c, EPD_PANEL_BLUE), 0);
+    CHECK_EQ(count_other(frame, &rest, EPD_PANEL_WHITE), 0);
+    CHECK_STR(state.etag[0], "\"a1\"");
+    CHECK_STR(state.etag[2], "\"c1\"");
+    commit(frame, &state, &stored);
+
+    // Conditional: a unchanged (from the cache), b redrawn, c failed (the
+    // cached copy stays, with its ETag)
+    const response_t second[] = {
+        { true, 304, NULL, 0 },
+        { true, 200, "\"b2\"", EPD_PANEL_YELLOW },
+        { false, 0, NULL, 0 },
+    };
+    memset(frame, 0, IMAGE_BUFFER_SIZE);
+    CHECK(update(&l, 7, &stored, second, frame, &state, sent));
+    CHECK_STR(sent[0], "\"a1\"");
+    CHECK_STR(sent[1], "\"b1\"");
+    CHECK_STR(sent[2], "\"c1\"");
+    CHECK_EQ(count_other(frame, a, EPD_PANEL_RED), 0);
+    CHECK_EQ(count_other(frame, b, EPD_PANEL_YELLOW), 0);
+    CHECK_EQ(count_other(frame, c, EPD_PANEL_BLUE), 0);
+    CHECK_EQ(count_other(frame, &rest, EPD_PANEL_WHITE), 0);
+    CHECK_STR(state.etag[0], "\"a1\"");
+    CHECK_STR(state.etag[1], "\"b2\"");
+    CHECK_STR(state.etag[2], "\"c1\"");
+    commit(frame, &state, &stored);
+
+    // All unchanged: the cached frame as it is
+    const response_t same[] = { { true, 304, NULL, 0 }, { true, 304, NULL, 0 }, { true, 304, NULL, 0 } };
+    CHECK(update(&l, 7, &stored, same, frame, &state, sent));
+    CHECK_EQ(memcmp(frame, cache.frame, IMAGE_BUFFER_SIZE), 0);
+    CHECK_EQ(memcmp(state.etag, stored.etag, sizeof(state.etag)), 0);
+
+    // The cache now holds another frame: the ETags are not sent, a 304
+    // anyway leaves the tile white
+    cache.frame[0] ^= 0xFF;
+    cache.crc = esp_rom_crc32_le(0, cache.frame, IMAGE_BUFFER_SIZE);
+    const response_t third[] = {
+        { true, 304, NULL, 0 },
+        { true, 200, "\"b3\"", EPD_PANEL_BLACK },
+        { true, 200, NULL, EPD_PANEL_GREEN },
+    };
+    CHECK(!update(&l, 7, &stored, third, frame, &state, sent));
+    CHECK(sent[0] == NULL && sent[1] == NULL && sent[2] == NULL);
+    CHECK_EQ(count_other(frame, a, EPD_PANEL_WHITE), 0);
+    CHECK_EQ(count_other(frame, b, EPD_PANEL_BLACK), 0);
+    CHECK_EQ(count_other(frame, c, EPD_PANEL_GREEN), 0);
+    CHECK_STR(state.etag[0], "");
+    CHECK_STR(state.etag[1], "\"b3\"");
+    CHECK_STR(state.etag[2], "");
+    commit(frame, &state, &stored);
+
+    // Another layout or settings: the cached frame is not the base
+    CHECK(!update(&l, 8, &stored, same, frame, &state, sent));
+    CHECK_EQ(count_other(frame, b, EPD_PANEL_WHITE), 0);
+
+    // No cached frame (e.g. the cache was erased)
+    cache.valid = false;
+    CHECK(!update(&l, 7, &stored, same, frame, &state, sent));
+    CHECK(sent[1] == NULL);
+
+    free(frame);
+    free(cache.frame);
+}
+
+int main(void) {
+    test_parse();
+    test_state();
+
+    CHECK_EQ(image_processor_init(), ESP_OK);
+    image_processor_set_scaling(0, 0, false);
+    test_updates();
+    image_processor_deinit();
+    return TEST_RESULT();
+}
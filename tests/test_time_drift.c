@@ -0,0 +1,253 @@
+/**
+ * @file test_time_drift.c
+ * @brief Drift estimation, compensation and NTP scheduling
+ *
+ * A simulated RTC runs at a chosen rate error; syncs and corrections are
+ * applied to it the way main.c does (the clock is set to the NTP time, or
+ * moved back by the returned correction).
+ */
+
+#include "time_drift.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define S(x)    ((int64_t)(x) * 1000000)
+#define T0      S(1700000000)
+
+// Simulated RTC: true time plus its accumulated error
+typedef struct {
+    int64_t true_us;
+    int64_t offset_us;
+    int32_t rate_ppb;
+} rtc_t;
+
+static int64_t rtc_now(const rtc_t *r) {
+    return r->true_us + r->offset_us;
+}
+
+static void rtc_run(rtc_t *r, int64_t us) {
+    r->true_us += us;
+    r->offset_us += us / 1000 * r->rate_ppb / 1000000;
+}
+
+// NTP sync: record it, then set the clock
+static void rtc_sync(rtc_t *r, time_drift_t *d) {
+    time_drift_on_sync(d, rtc_now(r), r->true_us);
+    r->offset_us = 0;
+}
+
+static void test_first_sync(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+
+    CHECK(time_drift_sync_needed(&d, T0, 1000, TIME_DRIFT_MAX_AGE_S));
+    CHECK_EQ(time_drift_predicted_error_ms(&d, T0), UINT32_MAX);
+    CHECK_EQ(time_drift_compensate(&d, T0), 0);
+    CHECK_EQ(time_drift_clock_duration_us(&d, S(3600)), S(3600));
+
+    // Garbage from uninitialized RTC memory is not a baseline
+    memset(&d, 0x5A, sizeof(d));
+    time_drift_on_sync(&d, T0 + S(5), T0);
+    CHECK_EQ(d.last_sync_us, T0);
+    CHECK_EQ(d.samples, 0);
+    CHECK_EQ(d.drift_ppb, 0);
+    CHECK_EQ(d.applied_us, 0);
+
+    // No rate known yet: the assumed 200 ppm error, no correction
+    CHECK_EQ(time_drift_predicted_error_ms(&d, T0 + S(1000)), 200);
+    CHECK_EQ(time_drift_compensate(&d, T0 + S(1000)), 0);
+    CHECK_EQ(time_drift_clock_duration_us(&d, S(1000)), S(1000));
+}
+
+static void test_averaging(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+    rtc_t r = { .true_us = T0, .rate_ppb = 50000 };
+    rtc_sync(&r, &d);
+
+    // A sync sooner than TIME_DRIFT_MIN_INTERVAL_S keeps the baseline
+    rtc_run(&r, S(TIME_DRIFT_MIN_INTERVAL_S - 1));
+    int64_t clock_before = rtc_now(&r);
+    time_drift_on_sync(&d, clock_before, r.true_us);
+    CHECK_EQ(d.last_sync_us, T0);
+    CHECK_EQ(d.samples, 0);
+
+    // ... and the clock error keeps growing until a real measurement
+    rtc_run(&r, S(3600 - TIME_DRIFT_MIN_INTERVAL_S + 1));
+    CHECK_EQ(r.offset_us, 180000);
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.last_sync_us, T0 + S(3600));
+    CHECK_EQ(d.samples, 1);
+    CHECK_EQ(d.drift_ppb, 50000);       // First sample taken as is
+
+    // Later samples weigh 1/4
+    r.rate_ppb = 70000;
+    rtc_run(&r, S(7200));
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.samples, 2);
+    CHECK_EQ(d.drift_ppb, (3 * 50000 + 70000) / 4);
+
+    r.rate_ppb = -10000;
+    rtc_run(&r, S(7200));
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.samples, 3);
+    CHECK_EQ(d.drift_ppb, (3 * 55000 - 10000) / 4);
+}
+
+// Corrections are incremental and the next sync accounts for them
+static void test_compensate(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+    rtc_t r = { .true_us = T0, .rate_ppb = 50000 };
+    rtc_sync(&r, &d);
+    rtc_run(&r, S(3600));
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.drift_ppb, 50000);
+
+    // Corrections are computed from the drifting clock, so they carry
+    // 50 ppm of themselves: a few microseconds per half hour
+    int64_t total = 0;
+    for (int i = 0; i < 4; i++) {
+        rtc_run(&r, S(1800));
+        int64_t now = rtc_now(&r);
+        int64_t c = time_drift_compensate(&d, now);
+        CHECK(c >= 90000 && c <= 90000 + 10);   // 50 ppm of 30 min
+        CHECK_EQ(time_drift_compensate(&d, now), 0);   // Not due twice
+        r.offset_us -= c;
+        total += c;
+        CHECK_EQ(d.applied_us, total);
+        CHECK(llabs(r.offset_us) <= 10 * (i + 1));
+    }
+
+    // A clock before the sync (e.g. reset) gets no correction
+    CHECK_EQ(time_drift_compensate(&d, d.last_sync_us - S(1)), 0);
+    CHECK_EQ(d.applied_us, total);
+
+    // The measurement adds the corrections back: still 50 ppm, not 0
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.samples, 2);
+    CHECK(d.drift_ppb >= 49990 && d.drift_ppb <= 50010);
+    CHECK_EQ(d.applied_us, 0);
+    int32_t before = d.drift_ppb;
+
+    // Partly compensated: the remaining offset plus applied is the raw drift
+    r.rate_ppb = 60000;
+    rtc_run(&r, S(1800));
+    r.offset_us -= time_drift_compensate(&d, rtc_now(&r));
+    rtc_run(&r, S(1800));
+    rtc_sync(&r, &d);
+    int32_t want = (3 * before + 60000) / 4;
+    CHECK(d.drift_ppb >= want - 10 && d.drift_ppb <= want + 10);
+}
+
+// Offsets beyond TIME_DRIFT_MAX_PPB are clock jumps: no sample, new baseline
+static void test_rejection(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+    rtc_t r = { .true_us = T0, .rate_ppb = 40000 };
+    rtc_sync(&r, &d);
+    rtc_run(&r, S(3600));
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.drift_ppb, 40000);
+
+    // 3 s in 1000 s = 3000 ppm
+    rtc_run(&r, S(1000));
+    r.offset_us += S(3);
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.samples, 1);
+    CHECK_EQ(d.drift_ppb, 40000);
+    CHECK_EQ(d.last_sync_us, r.true_us);
+
+    rtc_run(&r, S(1000));
+    r.offset_us -= S(3);
+    rtc_sync(&r, &d);
+    CHECK_EQ(d.samples, 1);
+    CHECK_EQ(d.drift_ppb, 40000);
+
+    // Just inside the band: 1999 ppm
+    time_drift_t e = d;
+    time_drift_on_sync(&e, d.last_sync_us + S(1000) + 1999000, d.last_sync_us + S(1000));
+    CHECK_EQ(e.samples, 2);
+    CHECK_EQ(e.drift_ppb, (3 * 40000 + 1999000) / 4);
+
+    // Exactly at the limit is rejected
+    e = d;
+    time_drift_on_sync(&e, d.last_sync_us + S(1000) + 2000000, d.last_sync_us + S(1000));
+    CHECK_EQ(e.samples, 1);
+    e = d;
+    time_drift_on_sync(&e, d.last_sync_us + S(1000) - 2000000, d.last_sync_us + S(1000));
+    CHECK_EQ(e.samples, 1);
+
+    // NTP time before the baseline: start over from it without a sample
+    e = d;
+    time_drift_on_sync(&e, d.last_sync_us - S(50), d.last_sync_us - S(60));
+    CHECK_EQ(e.samples, 1);
+    CHECK_EQ(e.drift_ppb, 40000);
+    CHECK_EQ(e.last_sync_us, d.last_sync_us - S(60));
+}
+
+static void test_sync_needed(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+    time_drift_on_sync(&d, T0, T0);
+    const uint32_t age = TIME_DRIFT_MAX_AGE_S;
+
+    // No rate yet: 200 ppm, so 100 ms after 500 s
+    CHECK(!time_drift_sync_needed(&d, T0 + S(500), 100, age));
+    CHECK(time_drift_sync_needed(&d, T0 + S(505), 100, age));
+    CHECK(time_drift_sync_needed(&d, T0 + S(1), 0, age));      // 0 = always
+
+    // Measured rate: 20 ppm residual, so 100 ms after 5000 s
+    time_drift_on_sync(&d, T0 + S(3600) + 72000, T0 + S(3600));
+    CHECK_EQ(d.samples, 1);
+    int64_t base = d.last_sync_us;
+    CHECK_EQ(time_drift_predicted_error_ms(&d, base + S(5000)), 100);
+    CHECK(!time_drift_sync_needed(&d, base + S(5000), 100, age));
+    CHECK(time_drift_sync_needed(&d, base + S(5050), 100, age));
+
+    // The age limit applies even when the error is small
+    CHECK(!time_drift_sync_needed(&d, base + S(age) - 1, 1000000, age));
+    CHECK(time_drift_sync_needed(&d, base + S(age), 1000000, age));
+    CHECK(time_drift_sync_needed(&d, base + S(61), 1000000, 60));
+
+    // A clock behind the last sync cannot be trusted
+    CHECK(time_drift_sync_needed(&d, base - 1, 1000000, age));
+    CHECK_EQ(time_drift_predicted_error_ms(&d, base - 1), UINT32_MAX);
+}
+
+// A fast clock counts more than the true duration, a slow one less
+static void test_clock_duration(void) {
+    time_drift_t d;
+    memset(&d, 0, sizeof(d));
+    time_drift_on_sync(&d, T0, T0);
+    time_drift_on_sync(&d, T0 + S(1000) + 50000, T0 + S(1000));    // 50 ppm fast
+    CHECK_EQ(d.drift_ppb, 50000);
+    CHECK_EQ(time_drift_clock_duration_us(&d, S(1000)), S(1000) + 50000);
+    CHECK_EQ(time_drift_clock_duration_us(&d, 0), 0);
+
+    memset(&d, 0, sizeof(d));
+    time_drift_on_sync(&d, T0, T0);
+    time_drift_on_sync(&d, T0 + S(1000) - 80000, T0 + S(1000));    // 80 ppm slow
+    CHECK_EQ(d.drift_ppb, -80000);
+    CHECK_EQ(time_drift_clock_duration_us(&d, S(1000)), S(1000) - 80000);
+
+    // Sleeping the converted duration on the slow clock ends on time
+    rtc_t r = { .true_us = T0, .rate_ppb = -80000 };
+    uint64_t ticks = time_drift_clock_duration_us(&d, S(3600));
+    int64_t clock_start = rtc_now(&r);
+    while (rtc_now(&r) - clock_start < (int64_t)ticks) {
+        rtc_run(&r, S(1));
+    }
+    CHECK(r.true_us - T0 >= S(3600) - S(1) && r.true_us - T0 <= S(3600) + S(1));
+}
+
+int main(void) {
+    test_first_sync();
+    test_averaging();
+    test_compensate();
+    test_rejection();
+    test_sync_needed();
+    test_clock_duration();
+    return TEST_RESULT();
+}
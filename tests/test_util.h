@@ -0,0 +1,44 @@
+/**
+ * @file test_util.h
+ * @brief Minimal check macros for the host tests
+ *
+ * A failed check is reported with its location and the test continues;
+ * main() returns TEST_RESULT() so ctest sees the failure.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+    if (!(cond)) {                                                          \
+        test_failures++;                                                    \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    }                                                                       \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do {                                     \
+    long long a_ = (long long)(actual), e_ = (long long)(expected);         \
+    if (a_ != e_) {                                                         \
+        test_failures++;                                                    \
+        fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n",              \
+                __FILE__, __LINE__, #actual, a_, e_);                       \
+    }                                                                       \
+} while (0)
+
+#define CHECK_STR(actual, expected) do {                                    \
+    const char *a_ = (actual), *e_ = (expected);                            \
+    if (a_ == NULL || strcmp(a_, e_) != 0) {                                \
+        test_failures++;                                                    \
+        fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n",          \
+                __FILE__, __LINE__, #actual, a_ ? a_ : "(null)", e_);       \
+    }                                                                       \
+} while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 :                             \
+    (fprintf(stderr, "%d check(s) failed\n", test_failures), 1))
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,301 @@
+/**
+ * @file test_widgets.c
+ * @brief Widget templates rendered into frames and a PNG snapshot
+ *
+ * Each item type is drawn on its own and checked pixel by pixel. A sample
+ * dashboard is then shown on the emulated panel and written as a PNG
+ * (png_stream), which must match the reference snapshot given as the
+ * argument. After an intended change of the rendering, review the new
+ * widgets_7in3e.png in the build directory and copy it over the reference.
+ */
+
+#include "widgets.h"
+#include "gfx.h"
+#include "epd_7in3e.h"
+#include "epd_transport_emu.h"
+#include "test_png.h"
+#include "test_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if EPD_PANEL != EPD_PANEL_7IN3E
+#error "test_widgets is built for the 7.3 inch panel"
+#endif
+
+#define SNAPSHOT "widgets_7in3e.png"
+
+static const uint8_t palette[EPD_PANEL_PALETTE_SIZE][4] = EPD_PANEL_PALETTE;
+
+static uint8_t pixel_code(const uint8_t *frame, int x, int y) {
+    uint8_t b = frame[(y * EPD_PANEL_WIDTH + x) / 2];
+    return (x & 1) ? (b & 0x0F) : (b >> 4);
+}
+
+// Pixels of a color inside a rectangle
+static int count_color(const uint8_t *frame, int x, int y, int w, int h, uint8_t code) {
+    int n = 0;
+    for (int py = y; py < y + h; py++) {
+        for (int px = x; px < x + w; px++) {
+            n += pixel_code(frame, px, py) == code;
+        }
+    }
+    return n;
+}
+
+static bool render(const char *tmpl, const char *data, uint8_t *frame) {
+    char err[96] = "";
+    bool ok = widgets_render(tmpl, data, strlen(data), frame, err, sizeof(err));
+    if (!ok) {
+        fprintf(stderr, "render failed: %s\n", err);
+    }
+    return ok;
+}
+
+// Both templates render to the same frame
+static void check_same_at(int line, const char *a, const char *b, const char *data) {
+    uint8_t *fa = malloc(EPD_PANEL_BUFFER_SIZE);
+    uint8_t *fb = malloc(EPD_PANEL_BUFFER_SIZE);
+    if (!render(a, data, fa) || !render(b, data, fb) ||
+        memcmp(fa, fb, EPD_PANEL_BUFFER_SIZE) != 0) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: frames differ\n", __FILE__, line);
+    }
+    free(fa);
+    free(fb);
+}
+
+#define CHECK_SAME(a, b, data) check_same_at(__LINE__, a, b, data)
+
+// Rejected by widgets_check() with a message that contains the expected part
+static void check_invalid_at(int line, const char *tmpl, const char *msg) {
+    char err[96] = "";
+    if (widgets_check(tmpl, err, sizeof(err))) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: template accepted\n", __FILE__, line);
+    } else if (strstr(err, msg) == NULL) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: error '%s', expected '%s'\n", __FILE__, line, err, msg);
+    }
+}
+
+#define CHECK_INVALID(tmpl, msg) check_invalid_at(__LINE__, tmpl, msg)
+
+static void test_check(void) {
+    CHECK(widgets_check("{\"items\": [{\"type\": \"line\", \"x2\": 10}]}", NULL, 0));
+    CHECK_INVALID("{\"items\": [", "not valid JSON");
+    CHECK_INVALID("[]", "not a JSON object");
+    CHECK_INVALID("{\"items\": []}", "no items");
+    CHECK_INVALID("{\"bg\": \"pink\", \"items\": [{\"type\": \"line\"}]}", "background");
+    CHECK_INVALID("{\"items\": [{\"type\": \"line\"}, {\"type\": \"line\", \"color\": \"pink\"}]}",
+                  "Item 2: unknown color");
+    CHECK_INVALID("{\"items\": [{\"x\": 1}]}", "Item 1: missing \"type\"");
+    CHECK_INVALID("{\"items\": [{\"type\": \"circle\"}]}", "unknown type");
+    CHECK_INVALID("{\"items\": [{\"type\": \"text\"}]}", "text without");
+    CHECK_INVALID("{\"items\": [{\"type\": \"bars\", \"w\": 10, \"h\": 10}]}", "chart needs");
+    CHECK_INVALID("{\"items\": [{\"type\": \"chart\", \"key\": \"a\", \"w\": 10}]}", "chart needs");
+    CHECK_INVALID("{\"items\": [{\"type\": \"icon\"}]}", "icon needs");
+
+    char tmpl[64 * 20 + 32];
+    strcpy(tmpl, "{\"items\": [");
+    for (int i = 0; i <= WIDGETS_MAX_ITEMS; i++) {
+        strcat(tmpl, i ? ",{\"type\":\"line\"}" : "{\"type\":\"line\"}");
+    }
+    strcat(tmpl, "]}");
+    CHECK_INVALID(tmpl, "too many");
+
+    uint8_t *frame = malloc(EPD_PANEL_BUFFER_SIZE);
+    char err[96] = "";
+    CHECK(!widgets_render("{\"items\": [{\"type\": \"line\"}]}", "{\"a\":", 5, frame, err, sizeof(err)));
+    CHECK(strstr(err, "Data is not valid JSON") != NULL);
+    free(frame);
+}
+
+static void test_items(void) {
+    uint8_t *frame = malloc(EPD_PANEL_BUFFER_SIZE);
+
+    // Background and a filled rectangle
+    CHECK(render("{\"bg\": \"yellow\", \"items\": [{\"type\": \"rect\", \"x\": 10, \"y\": 20,"
+                 " \"w\": 30, \"h\": 5, \"fill\": true, \"color\": \"red\"}]}", "{}", frame));
+    CHECK_EQ(count_color(frame, 10, 20, 30, 5, EPD_PANEL_RED), 150);
+    CHECK_EQ(count_color(frame, 0, 0, EPD_PANEL_WIDTH, EPD_PANEL_HEIGHT, EPD_PANEL_RED), 150);
+    CHECK_EQ(pixel_code(frame, EPD_PANEL_WIDTH - 1, EPD_PANEL_HEIGHT - 1), EPD_PANEL_YELLOW);
+
+    // Outline, clipped at the panel edge
+    CHECK(render("{\"items\": [{\"type\": \"rect\", \"x\": 790, \"y\": 0, \"w\": 20, \"h\": 10,"
+                 " \"thickness\": 2}]}", "{}", frame));
+    CHECK_EQ(count_color(frame, 790, 0, 10, 2, EPD_PANEL_BLACK), 20);
+    CHECK_EQ(count_color(frame, 790, 2, 2, 6, EPD_PANEL_BLACK), 12);
+    CHECK_EQ(count_color(frame, 792, 2, 8, 6, EPD_PANEL_BLACK), 0);
+
+    // Bars from 0: a 2 fills the chart, a 1 its lower half
+    CHECK(render("{\"items\": [{\"type\": \"bars\", \"x\": 100, \"y\": 100, \"w\": 10, \"h\": 10,"
+                 " \"gap\": 0, \"key\": \"v\", \"color\": \"blue\"}]}", "{\"v\": [1, 2]}", frame));
+    CHECK_EQ(count_color(frame, 100, 100, 5, 10, EPD_PANEL_BLUE), 25);
+    CHECK_EQ(count_color(frame, 100, 105, 5, 5, EPD_PANEL_BLUE), 25);
+    CHECK_EQ(count_color(frame, 105, 100, 5, 10, EPD_PANEL_BLUE), 50);
+    CHECK_EQ(count_color(frame, 0, 0, EPD_PANEL_WIDTH, EPD_PANEL_HEIGHT, EPD_PANEL_BLUE), 75);
+
+    // A rising line from the bottom left to the top right corner
+    CHECK(render("{\"items\": [{\"type\": \"chart\", \"x\": 0, \"y\": 0, \"w\": 50, \"h\": 50,"
+                 " \"thickness\": 1, \"key\": \"v\"}]}", "{\"v\": [0, 1]}", frame));
+    CHECK_EQ(pixel_code(frame, 0, 49), EPD_PANEL_BLACK);
+    CHECK_EQ(pixel_code(frame, 49, 0), EPD_PANEL_BLACK);
+    CHECK_EQ(pixel_code(frame, 0, 0), EPD_PANEL_WHITE);
+
+    // Missing or non-numeric chart data draws nothing
+    CHECK(render("{\"items\": [{\"type\": \"bars\", \"w\": 50, \"h\": 50, \"key\": \"v\"},"
+                 " {\"type\": \"chart\", \"w\": 50, \"h\": 50, \"key\": \"x\"}]}",
+                 "{\"v\": [\"a\", null]}", frame));
+    CHECK_EQ(count_color(frame, 0, 0, 50, 50, EPD_PANEL_WHITE), 2500);
+
+    // Right aligned text ends at the edge of its box
+    CHECK(render("{\"items\": [{\"type\": \"text\", \"x\": 0, \"y\": 0, \"w\": 100,"
+                 " \"align\": \"right\", \"text\": \"AB\"}]}", "{}", frame));
+    CHECK(count_color(frame, 84, 0, 16, GFX_FONT_HEIGHT, EPD_PANEL_BLACK) > 0);
+    CHECK_EQ(count_color(frame, 0, 0, 84, GFX_FONT_HEIGHT, EPD_PANEL_BLACK), 0);
+
+    // Placeholders: paths, formats, missing values
+    const char *data = "{\"t\": 21.46, \"n\": 3, \"s\": \"Bern\", \"b\": true,"
+                       " \"a\": [0, {\"c\": \"deep\"}]}";
+#define TEXT(s) "{\"items\": [{\"type\": \"text\", \"x\": 8, \"y\": 8, \"size\": 2, \"text\": \"" s "\"}]}"
+    CHECK_SAME(TEXT("{t:%.1f} C"), TEXT("21.5 C"), data);
+    CHECK_SAME(TEXT("{t}|{n}|{n:%03d}"), TEXT("21.46|3|003"), data);
+    CHECK_SAME(TEXT("{s} {b} {a.1.c}"), TEXT("Bern true deep"), data);
+    CHECK_SAME(TEXT("{x} {a.5} {a.x} {s.0}"), TEXT("-- -- -- --"), data);
+    CHECK_SAME(TEXT("{t:%s} {t:%.1f%%}"), TEXT("? ?"), data);
+
+    // Numbers beyond an int are shown with %g, also for %d
+    const char *big = "{\"max\": 2147483647, \"over\": 2147483648, \"neg\": -3e9, \"inf\": 1e400}";
+    CHECK_SAME(TEXT("{max}|{max:%d}|{over}|{over:%d}"), TEXT("2147483647|2147483647|2.14748e+09|2.14748e+09"), big);
+    CHECK_SAME(TEXT("{neg:%d}|{inf}|{inf:%d}"), TEXT("-3e+09|inf|inf"), big);
+#undef TEXT
+
+    // Geometry beyond an int falls back to the defaults; infinite chart
+    // values draw within the chart
+    CHECK_SAME("{\"items\": [{\"type\": \"rect\", \"x\": 1e300, \"y\": -1e12, \"w\": 20, \"h\": 20}]}",
+               "{\"items\": [{\"type\": \"rect\", \"w\": 20, \"h\": 20}]}", "{}");
+    CHECK(render("{\"items\": [{\"type\": \"chart\", \"x\": 0, \"y\": 0, \"w\": 50, \"h\": 50,"
+                 " \"key\": \"v\"}, {\"type\": \"bars\", \"x\": 100, \"y\": 0, \"w\": 50,"
+                 " \"h\": 50, \"key\": \"v\"}]}", "{\"v\": [1e400, 1, -1e400]}", frame));
+    CHECK_EQ(count_color(frame, 52, 0, 46, EPD_PANEL_HEIGHT, EPD_PANEL_BLACK), 0);
+    CHECK_EQ(count_color(frame, 0, 52, EPD_PANEL_WIDTH, EPD_PANEL_HEIGHT - 52, EPD_PANEL_BLACK), 0);
+
+    // Icons by name or from the data; unknown ones as '?'
+#define ICON(f) "{\"items\": [{\"type\": \"icon\", \"x\": 40, \"y\": 40, \"size\": 2, " f "}]}"
+    CHECK_SAME(ICON("\"key\": \"i\""), ICON("\"name\": \"sun\""), "{\"i\": \"sun\"}");
+    CHECK_SAME(ICON("\"key\": \"x\""),
+               "{\"items\": [{\"type\": \"text\", \"x\": 48, \"y\": 40, \"size\": 2, \"text\": \"?\"}]}",
+               "{}");
+    CHECK(render(ICON("\"name\": \"home\", \"color\": \"green\""), "{}", frame));
+    CHECK(count_color(frame, 40, 40, 32, 32, EPD_PANEL_GREEN) > 0);
+    CHECK_EQ(count_color(frame, 0, 0, EPD_PANEL_WIDTH, EPD_PANEL_HEIGHT, EPD_PANEL_GREEN),
+             count_color(frame, 40, 40, 32, 32, EPD_PANEL_GREEN));
+#undef ICON
+
+    free(frame);
+}
+
+static const char sample_template[] =
+    "{\"bg\": \"white\", \"items\": ["
+    " {\"type\": \"rect\", \"x\": 10, \"y\": 10, \"w\": 780, \"h\": 460, \"thickness\": 2},"
+    " {\"type\": \"text\", \"x\": 30, \"y\": 30, \"size\": 3, \"text\": \"{city} {temp:%.1f} C\"},"
+    " {\"type\": \"text\", \"x\": 30, \"y\": 90, \"size\": 2, \"color\": \"red\","
+    "  \"text\": \"Next: {next.title} at {next.time}\"},"
+    " {\"type\": \"icon\", \"x\": 660, \"y\": 24, \"size\": 6, \"key\": \"now.icon\", \"color\": \"orange\"},"
+    " {\"type\": \"chart\", \"x\": 30, \"y\": 140, \"w\": 740, \"h\": 140, \"key\": \"hourly.0.temps\","
+    "  \"color\": \"red\"},"
+    " {\"type\": \"line\", \"x\": 30, \"y\": 295, \"x2\": 770, \"y2\": 295},"
+    " {\"type\": \"bars\", \"x\": 30, \"y\": 310, \"w\": 740, \"h\": 100, \"key\": \"rain\","
+    "  \"color\": \"blue\"},"
+    " {\"type\": \"icon\", \"x\": 30, \"y\": 424, \"size\": 2, \"name\": \"bus\", \"color\": \"green\"},"
+    " {\"type\": \"text\", \"x\": 80, \"y\": 432, \"text\": \"{bus.0} / {bus.1} / {bus.2} min\"},"
+    " {\"type\": \"rect\", \"x\": 620, \"y\": 424, \"w\": 150, \"h\": 32, \"fill\": true, \"color\": \"yellow\"},"
+    " {\"type\": \"text\", \"x\": 620, \"y\": 432, \"w\": 150, \"align\": \"center\", \"text\": \"{updated}\"}"
+    "]}";
+
+static const char sample_data[] =
+    "{\"city\": \"Zurich\", \"temp\": 21.46, \"now\": {\"icon\": \"sun\"},"
+    " \"next\": {\"title\": \"Standup\", \"time\": \"09:30\"},"
+    " \"hourly\": [{\"temps\": [14, 15, 17, 19, 21, 22, 21.5, 20, 18, 16, 15, 14]}],"
+    " \"rain\": [0, 0, 0.2, 1.5, 3.1, 2.4, 0.8, 0.1, 0, 0, 0.4, 0],"
+    " \"bus\": [3, 11, 24], \"updated\": \"12:04\"}";
+
+// The sample dashboard through the emulated panel and into a PNG snapshot
+static void test_snapshot(const char *reference) {
+    uint8_t *frame = malloc(EPD_PANEL_BUFFER_SIZE);
+    CHECK(widgets_check(sample_template, NULL, 0));
+    CHECK(render(sample_template, sample_data, frame));
+
+    const epd_emu_config_t cfg = EPD_EMU_CONFIG_DEFAULT;
+    epd_transport_t *t;
+    CHECK_EQ(epd_transport_emu_create(&cfg, &t), ESP_OK);
+    epd_7in3e_set_transport(t);
+    CHECK_EQ(epd_7in3e_init_hw(), ESP_OK);
+    epd_7in3e_init();
+    epd_7in3e_display(frame);
+    CHECK(memcmp(epd_transport_emu_frame(t), frame, EPD_PANEL_BUFFER_SIZE) == 0);
+    CHECK_EQ(epd_transport_emu_write_png(t, SNAPSHOT), ESP_OK);
+    epd_7in3e_deinit_hw();
+    epd_transport_destroy(t);
+
+    // The snapshot shows the frame ...
+    test_image_t img, ref;
+    if (!test_png_load(SNAPSHOT, &img)) {
+        test_failures++;
+        free(frame);
+        return;
+    }
+    CHECK_EQ(img.width, EPD_PANEL_WIDTH);
+    CHECK_EQ(img.height, EPD_PANEL_HEIGHT);
+    int wrong = 0;
+    for (int y = 0; y < EPD_PANEL_HEIGHT; y++) {
+        for (int x = 0; x < EPD_PANEL_WIDTH; x++) {
+            uint8_t code = pixel_code(frame, x, y);
+            const uint8_t *rgb = img.rgb + ((size_t)y * img.width + x) * 3;
+            const uint8_t *want = NULL;
+            for (int i = 0; i < EPD_PANEL_PALETTE_SIZE; i++) {
+                if (palette[i][3] == code) {
+                    want = palette[i];
+                }
+            }
+            wrong += want == NULL || memcmp(rgb, want, 3) != 0;
+        }
+    }
+    CHECK_EQ(wrong, 0);
+
+    // ... and matches the reference
+    if (!test_png_load(reference, &ref)) {
+        test_failures++;
+    } else {
+        CHECK_EQ(ref.width, img.width);
+        CHECK_EQ(ref.height, img.height);
+        if (ref.width == img.width && ref.height == img.height) {
+            size_t differ = 0;
+            for (size_t i = 0; i < (size_t)img.width * img.height; i++) {
+                differ += memcmp(img.rgb + i * 3, ref.rgb + i * 3, 3) != 0;
+            }
+            if (differ != 0) {
+                test_failures++;
+                fprintf(stderr, "%s differs from %s in %zu pixels\n", SNAPSHOT, reference, differ);
+            }
+        }
+        test_image_free(&ref);
+    }
+    test_image_free(&img);
+
+    size_t png_len = 0;
+    free(test_read_file(SNAPSHOT, &png_len));
+    printf("Sample dashboard: %zu bytes of data, %zu bytes as PNG\n", strlen(sample_data), png_len);
+    free(frame);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <reference snapshot>\n", argv[0]);
+        return 2;
+    }
+    test_check();
+    test_items();
+    test_snapshot(argv[1]);
+    return TEST_RESULT();
+}
@@ -0,0 +1,209 @@
+/**
+ * @file test_wifi_cache.c
+ * @brief Fast reconnect: when the cached AP and lease are used, and the fallback
+ *
+ * Runs the connect sequence of the firmware against a simulated STA
+ * interface: after a DHCP connect the AP and lease are cached, and the next
+ * connect takes the fast path with the lease while it is before T1, with the
+ * AP only when the lease is unknown or expired or the address is static, and
+ * the full path for other credentials. A failed fast connect restarts DHCP
+ * and forgets the cache.
+ */
+
+#include "wifi_cache.h"
+#include "mock_netif.h"
+#include "test_util.h"
+#include <string.h>
+
+static const uint8_t bssid_a[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static const uint8_t bssid_b[6] = { 0x02, 0x66, 0x77, 0x88, 0x99, 0xAA };
+
+#define IP4(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+
+// Connected to an AP with an address from DHCP (lease_s 0 = client state unavailable)
+static void connect_dhcp(const uint8_t *bssid, uint8_t channel, uint32_t lease_s) {
+    mock_netif_state_t *st = mock_netif_state();
+    st->connected = true;
+    memcpy(st->ap.bssid, bssid, 6);
+    st->ap.primary = channel;
+    st->have_dhcp = lease_s > 0;
+    st->lease_s = lease_s;
+    st->ip.ip.addr = IP4(192, 168, 1, 50);
+    st->ip.netmask.addr = IP4(255, 255, 255, 0);
+    st->ip.gw.addr = IP4(192, 168, 1, 1);
+    st->dns[0].ip.ip4.addr = IP4(192, 168, 1, 1);
+    st->dns[1].ip.ip4.addr = IP4(9, 9, 9, 9);
+}
+
+// Start of a connect as on a fresh wake: DHCP client running, no address yet
+static wifi_path_t begin(const char *ssid, const char *password, bool use_dhcp,
+                         wifi_sta_config_t *sta) {
+    mock_netif_state_t *st = mock_netif_state();
+    st->dhcpc_running = true;
+    memset(&st->ip, 0, sizeof(st->ip));
+    memset(st->dns, 0, sizeof(st->dns));
+    memset(sta, 0, sizeof(*sta));
+    sta->scan_method = WIFI_ALL_CHANNEL_SCAN;
+    return wifi_cache_begin(ssid, password, use_dhcp, mock_netif(), sta);
+}
+
+static void test_lease_window(void) {
+    // Reused from the start of the lease until T1, half the lease time
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3600, 1000), 1800);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3600, 2799), 1);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3600, 2800), 0);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3600, 1000000), 0);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3601, 2800), 0);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3602, 2800), 1);
+
+    // Clock before the lease start (set back): not trusted
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 3600, 999), 0);
+
+    // Too short to reuse, or unknown
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 1, 1000), 0);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, 0, 1000), 0);
+    CHECK_EQ(wifi_cache_lease_left_s(1000, UINT32_MAX, 1000), UINT32_MAX / 2);
+}
+
+static void test_paths(void) {
+    mock_netif_state_t *st = mock_netif_state();
+    wifi_sta_config_t sta;
+
+    // Nothing cached: full path, config untouched
+    mock_netif_reset();
+    wifi_cache_invalidate();
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FULL);
+    CHECK(!sta.bssid_set);
+    CHECK_EQ(sta.channel, 0);
+    CHECK_EQ(st->dhcpc_stops, 0);
+
+    // After a DHCP connect: AP and lease
+    connect_dhcp(bssid_a, 6, 86400);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST_LEASE);
+    CHECK(sta.bssid_set);
+    CHECK(memcmp(sta.bssid, bssid_a, 6) == 0);
+    CHECK_EQ(sta.channel, 6);
+    CHECK_EQ(sta.scan_method, WIFI_FAST_SCAN);
+    CHECK(!st->dhcpc_running);
+    CHECK_EQ(st->ip.ip.addr, IP4(192, 168, 1, 50));
+    CHECK_EQ(st->ip.gw.addr, IP4(192, 168, 1, 1));
+    CHECK_EQ(st->dns[1].ip.ip4.addr, IP4(9, 9, 9, 9));
+
+    // Static address: the AP only, DHCP left alone
+    uint32_t stops = st->dhcpc_stops;
+    CHECK_EQ(begin("home", "secret", false, &sta), WIFI_PATH_FAST);
+    CHECK(sta.bssid_set);
+    CHECK_EQ(st->dhcpc_stops, stops);
+    CHECK_EQ(st->ip.ip.addr, 0);
+
+    // Other credentials: full path (also when only the split differs)
+    CHECK_EQ(begin("home", "other", true, &sta), WIFI_PATH_FULL);
+    CHECK_EQ(begin("homes", "ecret", true, &sta), WIFI_PATH_FULL);
+    CHECK(!sta.bssid_set);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST_LEASE);
+
+    // A connect on the reused lease keeps it for the same AP
+    wifi_cache_store(mock_netif(), "home", "secret", false);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST_LEASE);
+
+    // ... but not for another AP, which is cached without a lease
+    connect_dhcp(bssid_b, 11, 86400);
+    wifi_cache_store(mock_netif(), "home", "secret", false);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST);
+    CHECK(memcmp(sta.bssid, bssid_b, 6) == 0);
+    CHECK_EQ(sta.channel, 11);
+    CHECK(st->dhcpc_running);
+
+    // Lease time unknown (DHCP client state not readable): the AP only
+    connect_dhcp(bssid_a, 1, 0);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST);
+    CHECK_EQ(sta.channel, 1);
+
+    // A lease too short to reach T1 is not reused
+    connect_dhcp(bssid_a, 1, 1);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST);
+
+    // Applying the lease fails: DHCP back on, the AP is still used
+    connect_dhcp(bssid_a, 1, 7200);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    st->set_ip_err = ESP_FAIL;
+    uint32_t starts = st->dhcpc_starts;
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST);
+    CHECK(st->dhcpc_running);
+    CHECK_EQ(st->dhcpc_starts, starts + 1);
+    st->set_ip_err = ESP_OK;
+
+    // No AP info after the connect: nothing changes
+    st->connected = false;
+    wifi_cache_invalidate();
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FULL);
+}
+
+static void test_fallback(void) {
+    mock_netif_state_t *st = mock_netif_state();
+    wifi_sta_config_t sta;
+    mock_netif_reset();
+    wifi_cache_invalidate();
+
+    // Failed fast connect with the lease: address cleared, DHCP restarted,
+    // and the next connect takes the full path
+    connect_dhcp(bssid_a, 6, 86400);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    wifi_path_t path = begin("home", "secret", true, &sta);
+    CHECK_EQ(path, WIFI_PATH_FAST_LEASE);
+    uint32_t starts = st->dhcpc_starts;
+    wifi_cache_fast_failed(mock_netif(), path);
+    CHECK(st->dhcpc_running);
+    CHECK_EQ(st->dhcpc_starts, starts + 1);
+    CHECK_EQ(st->ip.ip.addr, 0);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FULL);
+
+    // Without the lease DHCP was never stopped and is not restarted
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    path = begin("home", "secret", false, &sta);
+    CHECK_EQ(path, WIFI_PATH_FAST);
+    starts = st->dhcpc_starts;
+    wifi_cache_fast_failed(mock_netif(), path);
+    CHECK_EQ(st->dhcpc_starts, starts);
+    CHECK_EQ(begin("home", "secret", false, &sta), WIFI_PATH_FULL);
+
+    // The full connect caches the AP again
+    connect_dhcp(bssid_b, 3, 3600);
+    wifi_cache_store(mock_netif(), "home", "secret", true);
+    CHECK_EQ(begin("home", "secret", true, &sta), WIFI_PATH_FAST_LEASE);
+    CHECK_EQ(sta.channel, 3);
+}
+
+static void test_stats(void) {
+    wifi_cache_stats_t s;
+    wifi_cache_get_stats(&s);
+    wifi_cache_stats_t before = s;
+
+    wifi_cache_record(WIFI_PATH_FULL, true, 3200);
+    wifi_cache_record(WIFI_PATH_FAST_LEASE, false, 1500);
+    wifi_cache_record(WIFI_PATH_FULL, false, 10000);
+    wifi_cache_record(WIFI_PATH_FAST, true, 450);
+    wifi_cache_get_stats(&s);
+    CHECK_EQ(s.full_ok, before.full_ok + 1);
+    CHECK_EQ(s.fast_fail, before.fast_fail + 1);    // A failed full connect is no fast failure
+    CHECK_EQ(s.fast_ok, before.fast_ok + 1);
+    CHECK_EQ(s.last_path, WIFI_PATH_FAST);
+    CHECK_EQ(s.last_ms, 450);
+    CHECK_EQ(s.last_fast_ms, 450);
+    CHECK_EQ(s.last_full_ms, 3200);
+
+    CHECK_STR(wifi_cache_path_name(WIFI_PATH_FAST_LEASE), "fast+lease");
+    CHECK_STR(wifi_cache_path_name(WIFI_PATH_NONE), "none");
+}
+
+int main(void) {
+    test_lease_window();
+    test_paths();
+    test_fallback();
+    test_stats();
+    return TEST_RESULT();
+}
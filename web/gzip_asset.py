@@ -0,0 +1,24 @@
+#!/usr/bin/env python3
+"""Gzip a web asset for embedding in the firmware.
+
+Usage: gzip_asset.py <input> <output>
+
+The gzip header carries no timestamp or file name, so the same input always
+gives the same bytes (and the same ETag on the device).
+"""
+
+import gzip
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: gzip_asset.py <input> <output>")
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    with open(sys.argv[2], "wb") as f:
+        f.write(gzip.compress(data, compresslevel=9, mtime=0))
+
+
+if __name__ == "__main__":
+    main()